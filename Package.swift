@@ -1,34 +1,63 @@
 // swift-tools-version: 5.9
 import PackageDescription
 
+// Foundation-only pieces of the sender (CSenderCore is also built by host/ for
+// the Linux sender). They build and test on Linux too:
+//   swift test && swift run -c release rtt-bench
+var targets: [Target] = [
+    .target(
+        name: "CSenderCore",
+        path: "Sources/CSenderCore"
+    ),
+    .target(
+        name: "MirrorStats",
+        dependencies: ["CSenderCore"],
+        path: "Sources/MirrorStats"
+    ),
+    .executableTarget(
+        name: "rtt-bench",
+        dependencies: ["MirrorStats"],
+        path: "Sources/RTTBench"
+    ),
+    .testTarget(
+        name: "MirrorStatsTests",
+        dependencies: ["MirrorStats"],
+        path: "Tests/MirrorStatsTests"
+    ),
+]
+
+#if os(macOS)
+targets += [
+    .target(
+        name: "CVirtualDisplay",
+        path: "Sources/CVirtualDisplay",
+        publicHeadersPath: "include"
+    ),
+    .target(
+        name: "MirrorEngine",
+        dependencies: ["CVirtualDisplay", "CSenderCore", "MirrorStats"],
+        path: "Sources/MirrorEngine"
+    ),
+    .executableTarget(
+        name: "daylight-mirror",
+        dependencies: ["MirrorEngine", "MirrorStats"],
+        path: "Sources/Mirror"
+    ),
+    .executableTarget(
+        name: "DaylightMirror",
+        dependencies: ["MirrorEngine"],
+        path: "Sources/App"
+    ),
+    .testTarget(
+        name: "MirrorEngineTests",
+        dependencies: ["MirrorEngine", "MirrorStats"],
+        path: "Tests/MirrorEngineTests"
+    ),
+]
+#endif
+
 let package = Package(
     name: "daylight-mirror",
     platforms: [.macOS(.v14)],
-    targets: [
-        .target(
-            name: "CVirtualDisplay",
-            path: "Sources/CVirtualDisplay",
-            publicHeadersPath: "include"
-        ),
-        .target(
-            name: "MirrorEngine",
-            dependencies: ["CVirtualDisplay"],
-            path: "Sources/MirrorEngine"
-        ),
-        .executableTarget(
-            name: "daylight-mirror",
-            dependencies: ["MirrorEngine"],
-            path: "Sources/Mirror"
-        ),
-        .executableTarget(
-            name: "DaylightMirror",
-            dependencies: ["MirrorEngine"],
-            path: "Sources/App"
-        ),
-        .testTarget(
-            name: "MirrorEngineTests",
-            dependencies: ["MirrorEngine"],
-            path: "Tests/MirrorEngineTests"
-        )
-    ]
+    targets: targets
 )
@@ -0,0 +1,391 @@
+// adb_client.c — adb server smart-socket client; see adb_client.h.
+
+#include "adb_client.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef MSG_NOSIGNAL
+#define ADB_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define ADB_SEND_FLAGS 0
+#endif
+
+static int fail(adb_client *c, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(c->error, sizeof(c->error), fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+void adb_client_init(adb_client *c, int port) {
+    memset(c, 0, sizeof(*c));
+    if (port <= 0) {
+        const char *env = getenv("ANDROID_ADB_SERVER_PORT");
+        port = env ? atoi(env) : 0;
+        if (port <= 0 || port > 65535) port = ADB_DEFAULT_PORT;
+    }
+    c->port = port;
+    c->timeout_ms = 2000;
+}
+
+// MARK: - Wire
+
+static int connect_server(adb_client *c) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return fail(c, "socket: %s", strerror(errno));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (c->timeout_ms > 0) {
+        struct timeval tv = { c->timeout_ms / 1000, (c->timeout_ms % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)c->port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int err = errno;
+        close(fd);
+        return fail(c, "cannot connect to adb server on port %d: %s", c->port, strerror(err));
+    }
+    return fd;
+}
+
+static int write_all(adb_client *c, int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, ADB_SEND_FLAGS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return fail(c, "write to adb server: %s", strerror(errno));
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Exactly `len` bytes; -1 on error or early EOF.
+static int read_exact(adb_client *c, int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return fail(c, "read from adb server: %s", strerror(errno));
+        if (n == 0) return fail(c, "adb server closed the connection");
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_request(adb_client *c, int fd, const char *service) {
+    size_t len = strlen(service);
+    if (len > 0xffff) return fail(c, "service name too long");
+    char prefix[5];
+    snprintf(prefix, sizeof(prefix), "%04x", (unsigned)len);
+    if (write_all(c, fd, prefix, 4) < 0) return -1;
+    return write_all(c, fd, service, len);
+}
+
+static int read_hex_length(adb_client *c, int fd) {
+    char hex[5] = {0};
+    if (read_exact(c, fd, hex, 4) < 0) return -1;
+    char *end;
+    long len = strtol(hex, &end, 16);
+    if (end != hex + 4 || len < 0) return fail(c, "bad length prefix '%.4s'", hex);
+    return (int)len;
+}
+
+// Length-prefixed string into `out` (truncated, NUL-terminated); the rest of
+// an oversized payload is read and dropped. Returns the stored length.
+static int read_payload(adb_client *c, int fd, char *out, size_t cap) {
+    int len = read_hex_length(c, fd);
+    if (len < 0) return -1;
+    size_t keep = cap > 0 && (size_t)len >= cap ? cap - 1 : (size_t)len;
+    if (cap == 0) keep = 0;
+    if (read_exact(c, fd, out, keep) < 0) return -1;
+    if (cap > 0) out[keep] = '\0';
+    char sink[256];
+    for (size_t left = (size_t)len - keep; left > 0;) {
+        size_t n = left < sizeof(sink) ? left : sizeof(sink);
+        if (read_exact(c, fd, sink, n) < 0) return -1;
+        left -= n;
+    }
+    return (int)keep;
+}
+
+// "OKAY", or "FAIL" + message (copied into c->error).
+static int read_status(adb_client *c, int fd) {
+    char status[4];
+    if (read_exact(c, fd, status, 4) < 0) return -1;
+    if (memcmp(status, "OKAY", 4) == 0) return 0;
+    if (memcmp(status, "FAIL", 4) == 0) {
+        char msg[sizeof(c->error)];
+        if (read_payload(c, fd, msg, sizeof(msg)) < 0) return -1;
+        return fail(c, "%s", msg);
+    }
+    return fail(c, "unexpected reply '%.4s'", status);
+}
+
+// Connect and send `service`, going through a device transport first when
+// `device` is set. Returns the socket after the service's OKAY, or -1.
+static int open_service(adb_client *c, int device, const char *serial, const char *service) {
+    int fd = connect_server(c);
+    if (fd < 0) return -1;
+    if (device) {
+        char transport[128];
+        if (serial) snprintf(transport, sizeof(transport), "host:transport:%s", serial);
+        else snprintf(transport, sizeof(transport), "host:transport-any");
+        if (send_request(c, fd, transport) < 0 || read_status(c, fd) < 0) goto fail;
+    }
+    if (send_request(c, fd, service) < 0 || read_status(c, fd) < 0) goto fail;
+    return fd;
+fail:
+    close(fd);
+    return -1;
+}
+
+// MARK: - Host services
+
+int adb_client_version(adb_client *c) {
+    int fd = open_service(c, 0, NULL, "host:version");
+    if (fd < 0) return -1;
+    char buf[16];
+    int n = read_payload(c, fd, buf, sizeof(buf));
+    close(fd);
+    if (n < 0) return -1;
+    char *end;
+    long version = strtol(buf, &end, 16);
+    if (n == 0 || *end != '\0') return fail(c, "bad version '%s'", buf);
+    return (int)version;
+}
+
+int adb_parse_devices(const char *text, size_t len, adb_device *out, int max) {
+    int count = 0;
+    const char *p = text, *stop = text + len;
+    while (p < stop) {
+        const char *eol = memchr(p, '\n', (size_t)(stop - p));
+        if (!eol) eol = stop;
+        const char *tab = memchr(p, '\t', (size_t)(eol - p));
+        if (tab && tab > p) {
+            if (count < max) {
+                adb_device *d = &out[count];
+                size_t sn = (size_t)(tab - p), st = (size_t)(eol - tab - 1);
+                if (st > 0 && tab[st] == '\r') st--;
+                if (sn >= sizeof(d->serial)) sn = sizeof(d->serial) - 1;
+                if (st >= sizeof(d->state)) st = sizeof(d->state) - 1;
+                memcpy(d->serial, p, sn);
+                d->serial[sn] = '\0';
+                memcpy(d->state, tab + 1, st);
+                d->state[st] = '\0';
+            }
+            count++;
+        }
+        p = eol + 1;
+    }
+    return count;
+}
+
+int adb_client_devices(adb_client *c, adb_device *out, int max) {
+    int fd = open_service(c, 0, NULL, "host:devices");
+    if (fd < 0) return -1;
+    char buf[4096];
+    int n = read_payload(c, fd, buf, sizeof(buf));
+    close(fd);
+    if (n < 0) return -1;
+    return adb_parse_devices(buf, (size_t)n, out, max);
+}
+
+// MARK: - Device services
+
+// reverse:* services answer twice: the stream opening, then the result.
+static int reverse_command(adb_client *c, const char *serial, const char *service) {
+    int fd = open_service(c, 1, serial, service);
+    if (fd < 0) return -1;
+    int rc = read_status(c, fd);
+    close(fd);
+    return rc;
+}
+
+int adb_client_reverse(adb_client *c, const char *serial, const char *remote, const char *local) {
+    char service[256];
+    snprintf(service, sizeof(service), "reverse:forward:%s;%s", remote, local);
+    return reverse_command(c, serial, service);
+}
+
+int adb_client_reverse_remove(adb_client *c, const char *serial, const char *remote) {
+    char service[256];
+    snprintf(service, sizeof(service), "reverse:killforward:%s", remote);
+    return reverse_command(c, serial, service);
+}
+
+int adb_client_reverse_list(adb_client *c, const char *serial, char *out, size_t cap) {
+    int fd = open_service(c, 1, serial, "reverse:list-forward");
+    if (fd < 0) return -1;
+    int n = read_status(c, fd) < 0 ? -1 : read_payload(c, fd, out, cap);
+    close(fd);
+    return n;
+}
+
+int adb_client_shell(adb_client *c, const char *serial, const char *command, char *out, size_t cap) {
+    if (cap == 0) return fail(c, "no output buffer");
+    size_t len = strlen(command);
+    char *service = malloc(len + 7);
+    if (!service) return fail(c, "out of memory");
+    memcpy(service, "shell:", 6);
+    memcpy(service + 6, command, len + 1);
+    int fd = open_service(c, 1, serial, service);
+    free(service);
+    if (fd < 0) return -1;
+
+    size_t used = 0;
+    for (;;) {
+        char sink[256];
+        char *dst = used < cap - 1 ? out + used : sink;
+        size_t room = used < cap - 1 ? cap - 1 - used : sizeof(sink);
+        ssize_t n = recv(fd, dst, room, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            close(fd);
+            return fail(c, "read shell output: %s", strerror(errno));
+        }
+        if (n == 0) break;
+        if (dst != sink) used += (size_t)n;
+    }
+    close(fd);
+    out[used] = '\0';
+    return (int)used;
+}
+
+// MARK: - Device tracking
+
+int adb_client_track_open(adb_client *c) {
+    int fd = open_service(c, 0, NULL, "host:track-devices");
+    if (fd < 0) return -1;
+    // Lists arrive only on change: wait for them indefinitely.
+    struct timeval none = { 0, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+    return fd;
+}
+
+int adb_client_track_next(adb_client *c, int fd, adb_device *out, int max) {
+    char buf[4096];
+    int n = read_payload(c, fd, buf, sizeof(buf));
+    if (n < 0) return -1;
+    return adb_parse_devices(buf, (size_t)n, out, max);
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Sleeps up to `ms`, returning early once the tracker is stopped.
+static void tracker_sleep(adb_tracker *t, int ms) {
+    int64_t until = now_ms() + ms;
+    while (t->running && now_ms() < until) {
+        struct timespec slice = { 0, 10 * 1000000 };
+        nanosleep(&slice, NULL);
+    }
+}
+
+static void tracker_report(adb_tracker *t, const char *serial) {
+    if (strcmp(t->serial, serial ? serial : "") == 0) return;
+    snprintf(t->serial, sizeof(t->serial), "%s", serial ? serial : "");
+    if (t->on_change) t->on_change(t->ctx, serial);
+}
+
+static void *tracker_thread(void *arg) {
+    adb_tracker *t = (adb_tracker *)arg;
+    int backoff = t->min_backoff_ms;
+    int64_t lost_at = now_ms();         // no subscription yet
+    int64_t started_at = 0;             // last start_server call
+    while (t->running) {
+        int fd = adb_client_track_open(&t->client);
+        if (fd < 0) {
+            int64_t now = now_ms();
+            if (now - lost_at >= t->grace_ms) {
+                tracker_report(t, NULL);
+                if (t->start_server && (t->server_starts == 0 || now - started_at >= t->max_backoff_ms)) {
+                    t->server_starts++;
+                    t->start_server(t->ctx);
+                    started_at = now_ms();
+                    continue;           // try the new server right away
+                }
+            }
+            tracker_sleep(t, backoff);
+            backoff = backoff * 2 < t->max_backoff_ms ? backoff * 2 : t->max_backoff_ms;
+            continue;
+        }
+        pthread_mutex_lock(&t->lock);
+        t->fd = fd;
+        int stopped = !t->running;
+        pthread_mutex_unlock(&t->lock);
+        if (!stopped) {
+            t->connections++;
+            backoff = t->min_backoff_ms;
+            adb_device devices[16];
+            int n;
+            while (t->running && (n = adb_client_track_next(&t->client, fd, devices, 16)) >= 0) {
+                const char *ready = NULL;
+                for (int i = 0; i < n && i < 16 && !ready; i++) {
+                    if (strcmp(devices[i].state, "device") == 0) ready = devices[i].serial;
+                }
+                tracker_report(t, ready);
+            }
+        }
+        pthread_mutex_lock(&t->lock);
+        t->fd = -1;
+        pthread_mutex_unlock(&t->lock);
+        close(fd);
+        lost_at = now_ms();
+    }
+    return NULL;
+}
+
+void adb_tracker_init(adb_tracker *t, int port, adb_tracker_fn on_change, void *ctx) {
+    memset(t, 0, sizeof(*t));
+    adb_client_init(&t->client, port);
+    t->on_change = on_change;
+    t->ctx = ctx;
+    t->min_backoff_ms = 50;
+    t->max_backoff_ms = 2000;
+    t->grace_ms = 3000;
+    t->fd = -1;
+}
+
+int adb_tracker_start(adb_tracker *t) {
+    if (pthread_mutex_init(&t->lock, NULL) != 0) return -1;
+    t->running = 1;
+    if (pthread_create(&t->thread, NULL, tracker_thread, t) != 0) {
+        t->running = 0;
+        pthread_mutex_destroy(&t->lock);
+        return -1;
+    }
+    t->thread_started = 1;
+    return 0;
+}
+
+void adb_tracker_stop(adb_tracker *t) {
+    if (!t->thread_started) return;
+    pthread_mutex_lock(&t->lock);
+    t->running = 0;
+    if (t->fd >= 0) shutdown(t->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    t->thread_started = 0;
+    pthread_mutex_destroy(&t->lock);
+}
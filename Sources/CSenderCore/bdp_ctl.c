@@ -0,0 +1,195 @@
+// bdp_ctl.c — Bandwidth-delay-product backpressure; see bdp_ctl.h.
+
+#include "bdp_ctl.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// MARK: - Windowed max filter
+
+static void filter_reset(bdp_filter *f, int64_t t, double v) {
+    for (int i = 0; i < 3; i++) {
+        f->t[i] = t;
+        f->v[i] = v;
+    }
+}
+
+// Port of the Linux kernel's minmax_running_max (lib/win_minmax.c).
+static void filter_update(bdp_filter *f, int64_t window, int64_t t, double v) {
+    if (v >= f->v[0] || t - f->t[2] > window) {
+        filter_reset(f, t, v);
+        return;
+    }
+    if (v >= f->v[1]) {
+        f->t[2] = f->t[1] = t;
+        f->v[2] = f->v[1] = v;
+    } else if (v >= f->v[2]) {
+        f->t[2] = t;
+        f->v[2] = v;
+    }
+
+    int64_t dt = t - f->t[0];
+    if (dt > window) {
+        // The best sample aged out: promote the others and take this one third.
+        f->t[0] = f->t[1]; f->v[0] = f->v[1];
+        f->t[1] = f->t[2]; f->v[1] = f->v[2];
+        f->t[2] = t;       f->v[2] = v;
+        if (t - f->t[0] > window) {
+            f->t[0] = f->t[1]; f->v[0] = f->v[1];
+            f->t[1] = f->t[2]; f->v[1] = f->v[2];
+        }
+    } else if (f->t[1] == f->t[0] && dt > window / 4) {
+        // A quarter of the window passed with one sample: start a second.
+        f->t[2] = f->t[1] = t;
+        f->v[2] = f->v[1] = v;
+    } else if (f->t[2] == f->t[1] && dt > window / 2) {
+        f->t[2] = t;
+        f->v[2] = v;
+    }
+}
+
+// MARK: - Controller
+
+void bdp_config_default(bdp_config *cfg) {
+    cfg->fps = 120;
+    cfg->gain = 2.0;
+    cfg->min_frames = 2;
+    cfg->max_frames = 6;
+    cfg->cold_frames = 4;
+    // Keyframes now come only on join, request or codec switch, so the rate
+    // max must outlast app-limited stretches (typing) rather than an IDR
+    // cadence; 2 s keeps the last full-rate sample without lagging a slowdown.
+    cfg->bw_window_us = 2000000;
+    cfg->rtt_window_us = 10000000;
+    cfg->capacity = 256;
+}
+
+int bdp_ctl_init(bdp_ctl *c, const bdp_config *cfg) {
+    memset(c, 0, sizeof(*c));
+    c->cfg = *cfg;
+    if (send_ring_init(&c->ring, cfg->capacity) < 0) return -1;
+    c->frames = (bdp_frame *)calloc(send_ring_capacity(&c->ring), sizeof(bdp_frame));
+    if (!c->frames) {
+        send_ring_free(&c->ring);
+        return -1;
+    }
+    return 0;
+}
+
+void bdp_ctl_free(bdp_ctl *c) {
+    send_ring_free(&c->ring);
+    free(c->frames);
+    c->frames = NULL;
+}
+
+void bdp_ctl_reset(bdp_ctl *c) {
+    send_ring_reset(&c->ring);
+    c->inflight_bytes = 0;
+}
+
+double bdp_ctl_bandwidth(const bdp_ctl *c) {
+    return c->rate_samples ? c->bw.v[0] : 0;
+}
+
+double bdp_ctl_frame_rate(const bdp_ctl *c) {
+    return c->rate_samples ? c->frame_rate.v[0] : 0;
+}
+
+int64_t bdp_ctl_min_rtt_us(const bdp_ctl *c) {
+    return c->rate_samples ? (int64_t)-c->rtt.v[0] : 0;
+}
+
+double bdp_ctl_window_bytes(const bdp_ctl *c) {
+    double frame = c->frame_bytes > 0 ? c->frame_bytes : 1;
+    if (c->rate_samples == 0) return c->cfg.cold_frames * frame;
+
+    double rtt_s = bdp_ctl_min_rtt_us(c) / 1e6;
+    double rate = bdp_ctl_bandwidth(c);
+    if (rate > bdp_ctl_frame_rate(c) * frame) rate = bdp_ctl_frame_rate(c) * frame;
+    double window = c->cfg.gain * rate * rtt_s;
+    // Frames an empty pipeline holds at the capture rate, plus one: sending
+    // those never queues, whatever the rate estimate says.
+    int floor_frames = (int)ceil(rtt_s * c->cfg.fps) + 1;
+    if (floor_frames < c->cfg.min_frames) floor_frames = c->cfg.min_frames;
+    if (window < floor_frames * frame) window = floor_frames * frame;
+    if (window > c->cfg.max_frames * frame) window = c->cfg.max_frames * frame;
+    return window;
+}
+
+int bdp_ctl_window_frames(const bdp_ctl *c) {
+    double frame = c->frame_bytes > 0 ? c->frame_bytes : 1;
+    int n = (int)(bdp_ctl_window_bytes(c) / frame + 0.5);
+    if (n < c->cfg.min_frames) n = c->cfg.min_frames;
+    if (n > c->cfg.max_frames) n = c->cfg.max_frames;
+    return n;
+}
+
+int bdp_ctl_should_send(const bdp_ctl *c) {
+    uint32_t n = bdp_ctl_inflight(c);
+    if (n < (uint32_t)c->cfg.min_frames) return 1;
+    if (n >= (uint32_t)c->cfg.max_frames) return 0;
+    return c->inflight_bytes + c->frame_bytes <= bdp_ctl_window_bytes(c);
+}
+
+void bdp_ctl_on_send(bdp_ctl *c, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us) {
+    if (!keyframe || c->frame_bytes == 0) {
+        c->frame_bytes = c->frame_bytes == 0 ? bytes : c->frame_bytes + (bytes - c->frame_bytes) / 8;
+    }
+    // Nothing inflight: the next delivery interval starts now, not at the
+    // last ACK (which would count the idle gap against the link).
+    if (bdp_ctl_inflight(c) == 0) {
+        c->delivered_us = now_us;
+        c->first_sent_us = now_us;
+    }
+
+    bdp_frame *f = &c->frames[seq & c->ring.mask];
+    uint64_t expired = c->ring.expired;
+    send_ring_record(&c->ring, seq, now_us);
+    if (c->ring.expired != expired) c->inflight_bytes -= f->bytes;
+
+    f->bytes = bytes;
+    f->app_limited = c->inflight_bytes + bytes < bdp_ctl_window_bytes(c);
+    f->delivered = c->delivered;
+    f->delivered_frames = c->delivered_frames;
+    f->delivered_us = c->delivered_us;
+    f->first_sent_us = c->first_sent_us;
+    f->sent_us = now_us;
+    c->inflight_bytes += bytes;
+}
+
+int bdp_ctl_on_ack(bdp_ctl *c, uint32_t seq, int64_t now_us) {
+    int64_t sent_us;
+    if (!send_ring_ack(&c->ring, seq, &sent_us)) return 0;
+    bdp_frame *f = &c->frames[seq & c->ring.mask];
+    c->inflight_bytes -= f->bytes;
+    c->delivered += f->bytes;
+    c->delivered_frames++;
+    c->delivered_us = now_us;
+    c->first_sent_us = f->sent_us;
+
+    int64_t rtt = now_us - sent_us;
+    if (rtt < 1) rtt = 1;
+    if (c->rate_samples == 0) filter_reset(&c->rtt, now_us, (double)-rtt);
+    else filter_update(&c->rtt, c->cfg.rtt_window_us, now_us, (double)-rtt);
+
+    // The rate over whichever was longer, sending or ACKing this frame's
+    // interval, so neither a send burst nor ACK compression inflates it.
+    int64_t send_elapsed = f->sent_us - f->first_sent_us;
+    int64_t ack_elapsed = now_us - f->delivered_us;
+    int64_t interval = send_elapsed > ack_elapsed ? send_elapsed : ack_elapsed;
+    if (interval < rtt) interval = rtt;
+    double rate = (double)(c->delivered - f->delivered) * 1e6 / (double)interval;
+    double frames = (double)(c->delivered_frames - f->delivered_frames) * 1e6 / (double)interval;
+    if (c->rate_samples == 0) {
+        filter_reset(&c->bw, now_us, rate);
+        filter_reset(&c->frame_rate, now_us, frames);
+    } else {
+        if (!f->app_limited || rate >= c->bw.v[0])
+            filter_update(&c->bw, c->cfg.bw_window_us, now_us, rate);
+        if (!f->app_limited || frames >= c->frame_rate.v[0])
+            filter_update(&c->frame_rate, c->cfg.bw_window_us, now_us, frames);
+    }
+    c->rate_samples++;
+    return 1;
+}
@@ -0,0 +1,127 @@
+// adb_client.h — Minimal client for the adb server's smart-socket protocol.
+//
+// The adb binary is itself only a client of the adb server (localhost:5037);
+// talking to the server directly saves a fork/exec per command, which is most
+// of the cost of `adb devices` polling, tunnel setup and settings queries.
+//
+// Wire format: each request is a 4-digit hex length followed by the service
+// name; the server answers "OKAY" or "FAIL" + hex length + message. Device
+// services (reverse:, shell:) first pick a device with host:transport:<serial>
+// (or host:transport-any) on the same connection. Every call opens its own
+// connection, as the adb binary does.
+//
+// Only the services the senders need: host:version, host:devices,
+// host:track-devices, reverse:forward / killforward / list-forward, and legacy
+// shell: (output until the device closes the stream; no exit status).
+// Installing packages uses the sync protocol and stays with the adb binary.
+//
+// adb_tracker keeps a host:track-devices subscription open on its own thread
+// and reports when the ready device changes, so connects and disconnects are
+// seen as the server sees them instead of on the next poll. If the server goes
+// away (kill-server, a new SDK's adb replacing it) the tracker reconnects with
+// exponential backoff; the device is reported gone only once the server has
+// been unreachable for the grace period, so a quick restart does not flap the
+// mirror. Past the grace period it also calls start_server, if set, at most once
+// per max_backoff_ms: after `adb kill-server` nothing else brings the server
+// back.
+//
+// Pure C, blocking sockets with a timeout, no global state (the tracker owns
+// one thread): ADBBridge and USBDeviceMonitor (via CSenderCore) and the Linux
+// sender share it; host/tests/test_adb_client.c runs it against a stand-in
+// server.
+
+#ifndef ADB_CLIENT_H
+#define ADB_CLIENT_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADB_DEFAULT_PORT 5037
+
+typedef struct {
+    int port;
+    int timeout_ms;             // per connect/read/write; 0 = none
+    char error[256];            // why the last call failed
+} adb_client;
+
+typedef struct {
+    char serial[64];
+    char state[32];             // "device", "offline", "unauthorized", ...
+} adb_device;
+
+// `port` <= 0 uses ANDROID_ADB_SERVER_PORT if set, else 5037.
+void adb_client_init(adb_client *c, int port);
+
+// The server's protocol version, or -1 if it is not reachable.
+int adb_client_version(adb_client *c);
+
+// Fills up to `max` devices; returns how many the server listed (may exceed
+// `max`), or -1.
+int adb_client_devices(adb_client *c, adb_device *out, int max);
+
+// Parses a host:devices payload ("serial\tstate\n" lines). Same return rule.
+int adb_parse_devices(const char *text, size_t len, adb_device *out, int max);
+
+// `serial` NULL selects the only attached device (host:transport-any).
+// `remote` and `local` are adb socket specs such as "tcp:8888".
+int adb_client_reverse(adb_client *c, const char *serial, const char *remote, const char *local);
+int adb_client_reverse_remove(adb_client *c, const char *serial, const char *remote);
+
+// Reverse tunnels as "serial remote local\n" lines, NUL-terminated in `out`.
+// Returns the length (truncated to cap - 1), or -1.
+int adb_client_reverse_list(adb_client *c, const char *serial, char *out, size_t cap);
+
+// Runs `command` with the device's shell and collects its output, NUL-
+// terminated in `out`. Returns the length (truncated to cap - 1), or -1.
+int adb_client_shell(adb_client *c, const char *serial, const char *command, char *out, size_t cap);
+
+// MARK: - Device tracking
+
+// Subscribes to host:track-devices. Returns the socket, or -1. The server sends
+// the full device list right away and again on every change.
+int adb_client_track_open(adb_client *c);
+
+// Blocks for the next list on a track socket. Same return rule as
+// adb_client_devices; -1 also when the server closed the stream.
+int adb_client_track_next(adb_client *c, int fd, adb_device *out, int max);
+
+// `serial` is the ready device (state "device"), or NULL when there is none.
+typedef void (*adb_tracker_fn)(void *ctx, const char *serial);
+// Launches the adb server (`adb start-server`); may block until it is up.
+typedef void (*adb_tracker_start_fn)(void *ctx);
+
+typedef struct {
+    adb_client client;
+    adb_tracker_fn on_change;
+    void *ctx;
+    int min_backoff_ms;         // first reconnect delay (doubles per failure)
+    int max_backoff_ms;
+    int grace_ms;               // server unreachable this long = device gone
+    adb_tracker_start_fn start_server;  // optional; called with ctx
+
+    pthread_t thread;
+    int thread_started;
+    volatile int running;
+    pthread_mutex_t lock;       // fd, so stop() can unblock the reader
+    int fd;
+    char serial[64];            // last reported ready device, "" if none
+    volatile int connections;   // successful subscriptions, including the first
+    volatile int server_starts; // start_server calls
+} adb_tracker;
+
+// `port` as for adb_client_init. Defaults: 50 ms to 2 s backoff, 3 s grace.
+void adb_tracker_init(adb_tracker *t, int port, adb_tracker_fn on_change, void *ctx);
+
+// Starts the tracking thread; `on_change` is called from it. Returns 0 or -1.
+int adb_tracker_start(adb_tracker *t);
+void adb_tracker_stop(adb_tracker *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
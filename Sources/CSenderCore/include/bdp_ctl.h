@@ -0,0 +1,115 @@
+// bdp_ctl.h — Frame backpressure from the link's bandwidth-delay product.
+//
+// Replaces the fixed "inflight > max(2, min(6, 120 / rtt))" rule. From the
+// ACK stream the controller estimates:
+//   - delivery rate: bytes and frames ACKed over the interval they took, BBR
+//     style, each kept in a windowed max filter. Samples taken while the
+//     sender was not filling the window (app-limited) may only raise them, so
+//     a quiet screen does not talk the estimates down. The frame rate matters
+//     when the decoder, not the tunnel, is the bottleneck: a keyframe moves
+//     many bytes quickly but still costs one decode.
+//   - base RTT: windowed min of send-to-ACK times (link + decode).
+//   - frame size: EWMA of non-key frame payloads.
+// The window is gain x rate x base RTT bytes, taking the lower of the byte
+// rate and frame rate x frame size. It never drops below the frames an empty
+// pipeline holds at the capture rate plus one, nor exceeds max_frames frames.
+// A frame is skipped when it would not fit.
+//
+// Keyframes are always sent (the caller decides that); they count towards the
+// window, so the deltas behind a large IDR wait for it to drain.
+//
+// Same rules as send_ring.h: pure C, no locking, shared by TCPServer (through
+// MirrorStats) and the Linux sender; host/link_sim.c compares it with the old
+// rule on modelled USB links.
+
+#ifndef BDP_CTL_H
+#define BDP_CTL_H
+
+#include <stdint.h>
+#include "send_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    double fps;                 // capture rate (sets the pipeline floor)
+    double gain;                // window = gain x bandwidth x base RTT
+    int min_frames;             // always allow this many frames inflight
+    int max_frames;             // never more than this many
+    int cold_frames;            // window before the first rate sample
+    int64_t bw_window_us;       // span of the delivery-rate max filter
+    int64_t rtt_window_us;      // span of the base-RTT min filter
+    uint32_t capacity;          // frames tracked (send_ring capacity)
+} bdp_config;
+
+// Kathleen Nichols' windowed max: the best, second-best and third-best
+// samples from successive sub-windows. O(1) per update.
+typedef struct {
+    int64_t t[3];
+    double v[3];
+} bdp_filter;
+
+typedef struct {
+    uint32_t bytes;
+    uint8_t app_limited;        // the window had room when this frame went out
+    uint64_t delivered;         // bytes ACKed when this frame was sent
+    uint64_t delivered_frames;  // frames ACKed then
+    int64_t delivered_us;       // time of the last ACK before it was sent
+    int64_t first_sent_us;      // send time of the frame that ACK was for
+    int64_t sent_us;
+} bdp_frame;
+
+typedef struct {
+    bdp_config cfg;
+    send_ring ring;
+    bdp_frame *frames;          // parallel to ring slots
+    uint64_t inflight_bytes;
+    uint64_t delivered;
+    uint64_t delivered_frames;
+    int64_t delivered_us;
+    int64_t first_sent_us;
+    bdp_filter bw;              // bytes/s
+    bdp_filter frame_rate;      // frames/s
+    bdp_filter rtt;             // -µs (a max filter over negated RTTs)
+    double frame_bytes;         // EWMA of delta frame sizes; 0 until the first
+    uint64_t rate_samples;
+} bdp_ctl;
+
+void bdp_config_default(bdp_config *cfg);
+
+// Returns 0, or -1 if allocation failed.
+int bdp_ctl_init(bdp_ctl *c, const bdp_config *cfg);
+void bdp_ctl_free(bdp_ctl *c);
+
+// New connection: forget inflight frames. Estimates are kept; the filters
+// replace them within their windows if the new path differs.
+void bdp_ctl_reset(bdp_ctl *c);
+
+// Frame `seq` (`bytes` of payload) went out at `now_us`.
+void bdp_ctl_on_send(bdp_ctl *c, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us);
+
+// ACK for `seq` arrived at `now_us`. Returns 1 if it matched a pending frame.
+int bdp_ctl_on_ack(bdp_ctl *c, uint32_t seq, int64_t now_us);
+
+// 1 if a delta frame of typical size fits in the window now.
+int bdp_ctl_should_send(const bdp_ctl *c);
+
+// Window in bytes and in typical frames (clamped to min/max_frames).
+double bdp_ctl_window_bytes(const bdp_ctl *c);
+int bdp_ctl_window_frames(const bdp_ctl *c);
+
+// Estimates: 0 until the first sample.
+double bdp_ctl_bandwidth(const bdp_ctl *c);     // bytes/s
+double bdp_ctl_frame_rate(const bdp_ctl *c);    // frames/s
+int64_t bdp_ctl_min_rtt_us(const bdp_ctl *c);
+
+static inline uint32_t bdp_ctl_inflight(const bdp_ctl *c) {
+    return send_ring_inflight(&c->ring);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+// phase_ctl.h — Lock the sender's capture ticks to the receiver's display latch.
+//
+// Capture and display run on unrelated clocks, so a frame is ready at the
+// receiver at a random point of its vsync period and waits half a period on
+// average for the next latch. The receiver reports, for each frame it shows,
+// the latch deadline it was released for as a time after the frame arrived,
+// how long before that deadline it was ready (the slack), and its vsync
+// period. This controller maps each report into the sender clock through
+// the frame's send time and the one-way delay (half the base RTT):
+//
+//   latch = send + one_way + arrival→latch
+//   ready = latch - slack
+//   delay = ready - capture                (capture → ready at the receiver)
+//
+// and tracks the latch grid (anchor and period, so clock drift is followed)
+// with a second-order loop, and the delay as an average plus mean deviation.
+// Ticks are then placed so a frame with typical delay is ready margin_us
+// (plus two deviations) before a latch deadline.
+//
+// Same rules as send_ring.h: pure C, no locking, shared by TCPServer and
+// CompositorPacer (through MirrorStats); host/phase_sim.c runs it against a
+// simulated receiver with a drifting clock.
+
+#ifndef PHASE_CTL_H
+#define PHASE_CTL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PHASE_CTL_FRAMES 64     // sends remembered for matching reports (power of two)
+
+typedef struct {
+    int64_t tick_us;            // sender frame interval (1e6 / fps)
+    int64_t margin_us;          // aim for frames ready this long before the latch deadline
+    double phase_gain;          // share of the latch-grid error corrected per report
+    double period_gain;         // share of it folded into the period (drift)
+    double delay_gain;          // weight of one report in the delay average
+    int lock_reports;           // reports before ticks are steered
+} phase_config;
+
+typedef struct {
+    uint32_t seq;
+    uint8_t valid;
+    int64_t capture_us;
+    int64_t send_us;
+} phase_frame;
+
+typedef struct {
+    phase_config cfg;
+    phase_frame frames[PHASE_CTL_FRAMES];
+    uint64_t reports;           // matched reports since the last reset
+    uint64_t unmatched;         // reports for frames no longer remembered
+    double latch_us;            // a recent latch deadline (sender clock), the grid anchor
+    double period_us;           // receiver vsync period in sender time
+    double delay_us;            // capture → ready, average
+    double delay_dev_us;        // its mean deviation
+    double error_us;            // last report: measured − predicted latch deadline
+    double slack_us;            // last report's slack
+} phase_ctl;
+
+void phase_config_default(phase_config *cfg, double fps);
+
+void phase_ctl_init(phase_ctl *c, const phase_config *cfg);
+
+// New connection: forget frames and the grid; ticks run free until relocked.
+void phase_ctl_reset(phase_ctl *c);
+
+// Frame `seq`, captured at capture_us, went out at send_us.
+void phase_ctl_on_send(phase_ctl *c, uint32_t seq, int64_t capture_us, int64_t send_us);
+
+// The receiver's report for frame `seq` (µs, its own clock: only differences
+// are used). one_way_us estimates the sender → receiver delay. Returns 1 if
+// the frame was known.
+int phase_ctl_on_report(phase_ctl *c, uint32_t seq, uint32_t arrival_to_latch_us,
+                        uint32_t slack_us, uint32_t period_us, int64_t one_way_us);
+
+// 1 once enough reports arrived to steer ticks.
+int phase_ctl_locked(const phase_ctl *c);
+
+// Tick interval: tick_us rounded to a whole number of vsyncs (or a whole
+// fraction of one, above the display rate). tick_us until locked.
+int64_t phase_ctl_interval_us(const phase_ctl *c);
+
+// The first steered tick at least half an interval after last_tick_us, so a
+// phase correction never bunches two ticks together. 0 while unlocked.
+int64_t phase_ctl_next_tick(const phase_ctl *c, int64_t last_tick_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
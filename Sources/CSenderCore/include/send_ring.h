@@ -0,0 +1,69 @@
+// send_ring.h — Send-timestamp table for ACK round trips, indexed by seq & mask.
+//
+// Both senders remember when each frame went out so the receiver's ACK
+// ([DA 7A][seq]) can be turned into an RTT and the number of unACKed frames
+// bounds what goes out next. The table is a power-of-two ring: frame `seq`
+// lives in slot seq & mask, so recording, ACKing and eviction are each one
+// slot access. A frame still pending when its slot is reused (capacity frames
+// later) counts as expired: its ACK is never coming.
+//
+// Inflight is derived from three monotonic counters (sent - acked - expired)
+// rather than adjusted and clamped, and reset() bumps an epoch instead of
+// clearing slots, so nothing here scans the table.
+//
+// Pure C, no locking: the Mac sender (TCPServer via MirrorStats) and the Linux
+// sender (host/sender_server.c) each call it under their own lock.
+
+#ifndef SEND_RING_H
+#define SEND_RING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t seq;
+    uint32_t tag;        // (epoch << 1) | 1 while pending; anything else is free
+    int64_t sent_us;
+} send_ring_slot;
+
+typedef struct {
+    send_ring_slot *slots;
+    uint32_t mask;       // capacity - 1
+    uint32_t epoch;      // starts at 1 so zeroed slots never match
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t expired;    // overwritten while pending
+} send_ring;
+
+// Capacity is rounded up to a power of two (at least 2). Returns 0, or -1 if
+// allocation failed.
+int send_ring_init(send_ring *r, uint32_t capacity);
+void send_ring_free(send_ring *r);
+
+// Forget every pending frame (new connection). O(1).
+void send_ring_reset(send_ring *r);
+
+// Frame `seq` went out at `now_us`.
+void send_ring_record(send_ring *r, uint32_t seq, int64_t now_us);
+
+// ACK for `seq`: 1 with its send time if it was pending, 0 for duplicates,
+// ACKs of expired frames and ACKs from before the last reset.
+int send_ring_ack(send_ring *r, uint32_t seq, int64_t *sent_us);
+
+static inline uint32_t send_ring_capacity(const send_ring *r) {
+    return r->mask + 1;
+}
+
+// Frames sent and neither ACKed nor expired.
+static inline uint32_t send_ring_inflight(const send_ring *r) {
+    return (uint32_t)(r->sent - r->acked - r->expired);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
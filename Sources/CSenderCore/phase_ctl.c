@@ -0,0 +1,100 @@
+// phase_ctl.c — Capture tick phase locked to the receiver's latch; see phase_ctl.h.
+
+#include "phase_ctl.h"
+
+#include <math.h>
+#include <string.h>
+
+// A reported period this far from the tracked one is a refresh-rate change:
+// start over rather than slew.
+#define PERIOD_CHANGE 0.02
+
+void phase_config_default(phase_config *cfg, double fps) {
+    cfg->tick_us = (int64_t)llround(1e6 / (fps > 0 ? fps : 60));
+    cfg->margin_us = 1000;
+    cfg->phase_gain = 1.0 / 8;
+    cfg->period_gain = 1.0 / 256;
+    cfg->delay_gain = 1.0 / 16;
+    cfg->lock_reports = 8;
+}
+
+void phase_ctl_init(phase_ctl *c, const phase_config *cfg) {
+    memset(c, 0, sizeof(*c));
+    c->cfg = *cfg;
+}
+
+void phase_ctl_reset(phase_ctl *c) {
+    phase_config cfg = c->cfg;
+    uint64_t unmatched = c->unmatched;
+    phase_ctl_init(c, &cfg);
+    c->unmatched = unmatched;
+}
+
+void phase_ctl_on_send(phase_ctl *c, uint32_t seq, int64_t capture_us, int64_t send_us) {
+    phase_frame *f = &c->frames[seq & (PHASE_CTL_FRAMES - 1)];
+    f->seq = seq;
+    f->valid = 1;
+    f->capture_us = capture_us;
+    f->send_us = send_us;
+}
+
+int phase_ctl_on_report(phase_ctl *c, uint32_t seq, uint32_t arrival_to_latch_us,
+                        uint32_t slack_us, uint32_t period_us, int64_t one_way_us) {
+    phase_frame *f = &c->frames[seq & (PHASE_CTL_FRAMES - 1)];
+    if (!f->valid || f->seq != seq || period_us == 0) {
+        c->unmatched++;
+        return 0;
+    }
+    f->valid = 0;
+
+    double latch = (double)f->send_us + (double)one_way_us + arrival_to_latch_us;
+    double delay = latch - slack_us - (double)f->capture_us;
+    c->slack_us = slack_us;
+    if (c->reports == 0 || fabs(period_us - c->period_us) > period_us * PERIOD_CHANGE) {
+        c->latch_us = latch;
+        c->period_us = period_us;
+        c->delay_us = delay;
+        c->delay_dev_us = 0;
+        c->error_us = 0;
+        c->reports = 1;
+        return 1;
+    }
+
+    // Second-order loop on the latch grid: the phase takes a share of the
+    // error, the period a smaller share spread over the vsyncs since the anchor.
+    double n = floor((latch - c->latch_us) / c->period_us + 0.5);
+    double predicted = c->latch_us + n * c->period_us;
+    double err = latch - predicted;
+    c->latch_us = predicted + c->cfg.phase_gain * err;
+    if (n >= 1) c->period_us += c->cfg.period_gain * err / n;
+    c->error_us = err;
+
+    double dev = fabs(delay - c->delay_us);
+    c->delay_us += c->cfg.delay_gain * (delay - c->delay_us);
+    c->delay_dev_us += c->cfg.delay_gain * (dev - c->delay_dev_us);
+    c->reports++;
+    return 1;
+}
+
+int phase_ctl_locked(const phase_ctl *c) {
+    return c->reports >= (uint64_t)c->cfg.lock_reports;
+}
+
+static double interval(const phase_ctl *c) {
+    double p = c->period_us, t = (double)c->cfg.tick_us;
+    if (t >= p) return p * floor(t / p + 0.5);
+    return p / floor(p / t + 0.5);
+}
+
+int64_t phase_ctl_interval_us(const phase_ctl *c) {
+    if (!phase_ctl_locked(c)) return c->cfg.tick_us;
+    return (int64_t)llround(interval(c));
+}
+
+int64_t phase_ctl_next_tick(const phase_ctl *c, int64_t last_tick_us) {
+    if (!phase_ctl_locked(c)) return 0;
+    double step = interval(c);
+    double after = (double)last_tick_us + step / 2;
+    double anchor = c->latch_us - c->cfg.margin_us - c->delay_us - 2 * c->delay_dev_us;
+    return (int64_t)ceil(anchor + ceil((after - anchor) / step) * step);
+}
@@ -0,0 +1,52 @@
+// send_ring.c — Send-timestamp ring; see send_ring.h.
+
+#include "send_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t pending_tag(const send_ring *r) {
+    return (r->epoch << 1) | 1u;
+}
+
+int send_ring_init(send_ring *r, uint32_t capacity) {
+    memset(r, 0, sizeof(*r));
+    uint32_t n = 2;
+    while (n < capacity && n < (1u << 31)) n <<= 1;
+    r->slots = (send_ring_slot *)calloc(n, sizeof(send_ring_slot));
+    if (!r->slots) return -1;
+    r->mask = n - 1;
+    r->epoch = 1;
+    return 0;
+}
+
+void send_ring_free(send_ring *r) {
+    free(r->slots);
+    r->slots = NULL;
+}
+
+void send_ring_reset(send_ring *r) {
+    // Old tags can only match again after 2^31 resets.
+    r->epoch = (r->epoch + 1) & 0x7FFFFFFFu;
+    if (r->epoch == 0) r->epoch = 1;
+    r->sent = r->acked = r->expired = 0;
+}
+
+void send_ring_record(send_ring *r, uint32_t seq, int64_t now_us) {
+    send_ring_slot *s = &r->slots[seq & r->mask];
+    uint32_t tag = pending_tag(r);
+    if (s->tag == tag) r->expired++;
+    s->seq = seq;
+    s->tag = tag;
+    s->sent_us = now_us;
+    r->sent++;
+}
+
+int send_ring_ack(send_ring *r, uint32_t seq, int64_t *sent_us) {
+    send_ring_slot *s = &r->slots[seq & r->mask];
+    if (s->tag != pending_tag(r) || s->seq != seq) return 0;
+    s->tag = 0;
+    r->acked++;
+    if (sent_us) *sent_us = s->sent_us;
+    return 1;
+}
@@ -21,6 +21,7 @@
 
 import Foundation
 @preconcurrency import MirrorEngine
+import MirrorStats
 
 // MARK: - Constants
 
@@ -95,9 +96,24 @@ func controlSocketExists() -> Bool {
 /// Connect to the running engine's control socket, send a command, return the response.
 /// Returns nil if no engine is running or the socket doesn't exist.
 func sendControlCommand(_ command: String) -> String? {
+    guard let fd = connectControlSocket() else { return nil }
+    defer { close(fd) }
+
+    // Send command with newline terminator
+    let msg = command + "\n"
+    _ = msg.withCString { ptr in send(fd, ptr, strlen(ptr), 0) }
+
+    // Read response
+    var buffer = [CChar](repeating: 0, count: 1024)
+    let bytesRead = recv(fd, &buffer, buffer.count - 1, 0)
+    guard bytesRead > 0 else { return nil }
+    return String(cString: buffer).trimmingCharacters(in: .whitespacesAndNewlines)
+}
+
+/// Connect to the control socket. Returns the fd (caller closes) or nil.
+func connectControlSocket() -> Int32? {
     let fd = socket(AF_UNIX, SOCK_STREAM, 0)
     guard fd >= 0 else { return nil }
-    defer { close(fd) }
 
     var addr = sockaddr_un()
     addr.sun_family = sa_family_t(AF_UNIX)
@@ -113,17 +129,8 @@ func sendControlCommand(_ command: String) -> String? {
             connect(fd, sockPtr, socklen_t(MemoryLayout<sockaddr_un>.size))
         }
     }
-    guard connectResult == 0 else { return nil }
-
-    // Send command with newline terminator
-    let msg = command + "\n"
-    _ = msg.withCString { ptr in send(fd, ptr, strlen(ptr), 0) }
-
-    // Read response
-    var buffer = [CChar](repeating: 0, count: 1024)
-    let bytesRead = recv(fd, &buffer, buffer.count - 1, 0)
-    guard bytesRead > 0 else { return nil }
-    return String(cString: buffer).trimmingCharacters(in: .whitespacesAndNewlines)
+    guard connectResult == 0 else { close(fd); return nil }
+    return fd
 }
 
 /// Ensure an engine is running (CLI or GUI), send a control command, print result, exit.
@@ -401,7 +408,74 @@ func commandFontSmoothing() {
     }
 }
 
-/// `daylight-mirror latency` — print latency diagnostics. With `--watch`, polls every 2s.
+/// `latency --watch` against an engine that supports SUBSCRIBE: redraws once per
+/// streamed StatsDelta line with rates and RTT / processing quantiles over the
+/// last second and the last 10 seconds (merged lines). Returns false if the
+/// engine does not know SUBSCRIBE; exits when the engine goes away.
+func watchLatencyStream() -> Bool {
+    guard let fd = connectControlSocket() else { return false }
+    _ = "SUBSCRIBE 1000\n".withCString { ptr in send(fd, ptr, strlen(ptr), 0) }
+
+    var pending = [UInt8]()
+    var subscribed = false
+    var recent: [StatsDelta] = []
+    var chunk = [UInt8](repeating: 0, count: 4096)
+
+    func quantiles(_ h: LatencyHistogram) -> String {
+        guard h.total > 0 else { return "-" }
+        return String(format: "%.1f / %.1f / %.1f ms", h.quantile(0.5), h.quantile(0.95), h.quantile(0.99))
+    }
+
+    func render(_ last: StatsDelta) {
+        var window = StatsDelta()
+        recent.forEach { window.merge($0) }
+        print("\u{1B}[2J\u{1B}[H", terminator: "")
+        print("Daylight Mirror — Latency Diagnostics (live)")
+        print("============================================")
+        print(String(format: "Captured:         %.1f fps", last.rate(last.captured)))
+        print(String(format: "Encoded:          %.1f fps (%.1f unchanged, %.1f skipped)",
+                     last.rate(last.encoded), last.rate(last.unchanged), last.rate(last.skipped)))
+        print(String(format: "Sent:             %.1f fps, %.1f KB/s",
+                     last.rate(last.sent), Double(last.bytes) * 1000 / 1024 / max(last.intervalMs, 1)))
+        print("")
+        print("                  p50 / p95 / p99")
+        print("Process (1 s):    \(quantiles(last.process))")
+        print(String(format: "Process (%2.0f s):   ", window.intervalMs / 1000) + quantiles(window.process))
+        print("RTT (1 s):        \(quantiles(last.rtt))")
+        print(String(format: "RTT (%2.0f s):       ", window.intervalMs / 1000) + quantiles(window.rtt))
+        if window.acks == 0 {
+            print("")
+            print("(Waiting for ACKs from Daylight — is the Android app updated?)")
+        }
+    }
+
+    while true {
+        let n = recv(fd, &chunk, chunk.count, 0)
+        guard n > 0 else {
+            close(fd)
+            if !subscribed { return false }
+            print("")
+            print("Daylight Mirror stopped.")
+            exit(0)
+        }
+        pending.append(contentsOf: chunk[0..<n])
+        while let newline = pending.firstIndex(of: UInt8(ascii: "\n")) {
+            let line = String(decoding: pending[..<newline], as: UTF8.self)
+            pending.removeSubrange(...newline)
+            if !subscribed {
+                guard line.hasPrefix("OK subscribed") else { close(fd); return false }
+                subscribed = true
+            } else if let delta = StatsDelta(line: line) {
+                recent.append(delta)
+                if recent.count > 10 { recent.removeFirst() }
+                render(delta)
+            }
+        }
+    }
+}
+
+/// `daylight-mirror latency` — print latency diagnostics. With `--watch`, streams
+/// live stats over SUBSCRIBE (or polls every 2s on engines without it).
 func commandLatency() {
     let watch = args.contains("--watch") || args.contains("-w")
 
@@ -464,6 +538,11 @@ func commandLatency() {
     }
 
     if watch {
+        guard controlSocketExists() else {
+            print("ERROR: Daylight Mirror is not running.")
+            exit(1)
+        }
+        if watchLatencyStream() { exit(0) }
         printLatency()
         let timer = DispatchSource.makeTimerSource(queue: .main)
         timer.schedule(deadline: .now() + 2, repeating: 2.0)
@@ -493,7 +572,7 @@ func printUsage() {
     print("                             portrait-cozy, portrait-balanced, portrait-sharp)")
     print("  fontsmoothing [on|off]   Get or set macOS font smoothing (off = crisper text)")
     print("  latency                  Print latency diagnostics (RTT, jitter, processing times)")
-    print("  latency --watch          Continuously poll latency stats every 2 seconds")
+    print("  latency --watch          Live rates and p50/p95/p99 (last 1 s and 10 s), once a second")
     print("  restart                  Full stop + start cycle")
     print("")
     print("The `start` command keeps the process alive. Stop it with Ctrl+C or `daylight-mirror stop`.")
@@ -3,13 +3,21 @@
 // Manages the adb binary (bundled or PATH), reverse tunnels, device queries,
 // companion APK installation, and app launching on the Daylight DC-1.
 //
-// KEY DESIGN: All adb commands run via `/bin/sh -c` to inherit the user's full
-// shell environment. This is critical because GUI apps (.app bundles launched via
-// Finder/Spotlight) get a stripped environment — adb may start a SEPARATE server
-// instance that doesn't know about the USB device. Running through sh ensures we
-// talk to the SAME adb server as the user's terminal.
+// Device queries, tunnels and shell commands talk to the adb server directly
+// over its localhost socket (CSenderCore/adb_client.h) instead of forking an adb
+// client per command: device checks and each settings query used to cost a
+// process launch, now they cost one local connection. USBDeviceMonitor keeps
+// a host:track-devices subscription on the same server instead of polling.
+//
+// KEY DESIGN: everything is pinned to the SAME adb server as the user's terminal.
+// GUI apps (.app bundles launched via Finder/Spotlight) get a stripped
+// environment, so the server port (ANDROID_ADB_SERVER_PORT) and the environment
+// for the commands that still run the adb binary (start-server, install) come
+// from the user's login shell. Otherwise adb may start a SEPARATE server
+// instance that doesn't know about the USB device.
 
 import Foundation
+import CSenderCore
 
 struct ADBBridge {
     /// Resolved path to the adb binary. Prefers system adb (user-managed, up-to-date),
@@ -100,6 +108,12 @@ struct ADBBridge {
     /// Without this, `adb devices` can silently fail on first use.
     @discardableResult
     static func ensureServerRunning() -> Bool {
+        var client = makeClient()
+        let version = adb_client_version(&client)
+        if version >= 0 {
+            NSLog("[ADB] Server running (protocol %d, port %d)", version, client.port)
+            return true
+        }
         let stderr = Pipe()
         guard let process = makeADBProcess(["start-server"]) else { return false }
         process.standardOutput = FileHandle.nullDevice
@@ -112,7 +126,7 @@ struct ADBBridge {
         }
         process.waitUntilExit()
         if process.terminationStatus == 0 {
-            NSLog("[ADB] Server running")
+            NSLog("[ADB] Server started")
             return true
         }
         let errOutput = String(data: stderr.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
@@ -120,65 +134,67 @@ struct ADBBridge {
         return false
     }
 
-    static func connectedDevice() -> String? {
-        let stdout = Pipe()
-        let stderr = Pipe()
-        guard let process = makeADBProcess(["devices"]) else {
-            NSLog("[ADB] connectedDevice: no adb binary")
-            return nil
-        }
-        process.standardOutput = stdout
-        process.standardError = stderr
-        do {
-            try process.run()
-        } catch {
-            NSLog("[ADB] connectedDevice: failed to launch — %@", "\(error)")
+    // MARK: - adb server socket
+
+    /// The adb server port the user's shell would use (0 = the default, 5037).
+    static var serverPort: Int32 {
+        shellEnvironment["ANDROID_ADB_SERVER_PORT"].flatMap { Int32($0) } ?? 0
+    }
+
+    /// A client for the adb server on `serverPort`.
+    private static func makeClient() -> adb_client {
+        var client = adb_client()
+        adb_client_init(&client, serverPort)
+        return client
+    }
+
+    /// A NUL-terminated C char array (imported as a tuple) as a String.
+    private static func cString<T>(_ chars: T) -> String {
+        withUnsafeBytes(of: chars) { String(decoding: $0.prefix { $0 != 0 }, as: UTF8.self) }
+    }
+
+    /// Runs `command` with the device's shell and returns its output, or nil if
+    /// the server or device could not be reached.
+    private static func shell(_ command: String, capacity: Int = 4096) -> String? {
+        var client = makeClient()
+        var output = [CChar](repeating: 0, count: capacity)
+        let n = adb_client_shell(&client, nil, command, &output, output.count)
+        guard n >= 0 else {
+            NSLog("[ADB] shell '%@': %@", command, cString(client.error))
             return nil
         }
-        process.waitUntilExit()
-        let output = String(data: stdout.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-        let errOutput = String(data: stderr.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-        if process.terminationStatus != 0 {
-            NSLog("[ADB] connectedDevice: exit %d — %@", process.terminationStatus, errOutput.trimmingCharacters(in: .whitespacesAndNewlines))
+        return String(decoding: output[..<Int(n)].map { UInt8(bitPattern: $0) }, as: UTF8.self)
+    }
+
+    static func connectedDevice() -> String? {
+        var client = makeClient()
+        var devices = [adb_device](repeating: adb_device(), count: 16)
+        let count = adb_client_devices(&client, &devices, Int32(devices.count))
+        guard count >= 0 else {
+            NSLog("[ADB] connectedDevice: %@", cString(client.error))
             return nil
         }
-        for line in output.split(separator: "\n").dropFirst() {
-            let parts = line.split(separator: "\t")
-            if parts.count >= 2 && parts[1] == "device" {
-                return String(parts[0])
-            }
-            if parts.count >= 2 {
-                NSLog("[ADB] connectedDevice: device %@ status '%@' (not ready)", String(parts[0]), String(parts[1]))
+        for device in devices.prefix(Int(count)) {
+            let serial = cString(device.serial)
+            let state = cString(device.state)
+            if state == "device" {
+                return serial
             }
+            NSLog("[ADB] connectedDevice: device %@ status '%@' (not ready)", serial, state)
         }
-        NSLog("[ADB] connectedDevice: no device found in output: %@", output.trimmingCharacters(in: .whitespacesAndNewlines))
+        NSLog("[ADB] connectedDevice: no device found (%d listed)", count)
         return nil
     }
 
     @discardableResult
     static func setupReverseTunnel(port: UInt16) -> Bool {
-        let stdout = Pipe()
-        let stderr = Pipe()
-        guard let process = makeADBProcess(["reverse", "tcp:\(port)", "tcp:\(port)"]) else { return false }
-        process.standardOutput = stdout
-        process.standardError = stderr
-        do {
-            try process.run()
-        } catch {
-            NSLog("[ADB] setupReverseTunnel: failed to launch — %@", "\(error)")
+        var client = makeClient()
+        let spec = "tcp:\(port)"
+        guard adb_client_reverse(&client, nil, spec, spec) == 0 else {
+            NSLog("[ADB] setupReverseTunnel: %@", cString(client.error))
             return false
         }
-        process.waitUntilExit()
-        let stdOutput = String(data: stdout.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-        if process.terminationStatus != 0 {
-            let errOutput = String(data: stderr.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-            NSLog("[ADB] setupReverseTunnel: exit %d — stdout='%@' stderr='%@'",
-                  process.terminationStatus,
-                  stdOutput.trimmingCharacters(in: .whitespacesAndNewlines),
-                  errOutput.trimmingCharacters(in: .whitespacesAndNewlines))
-            return false
-        }
-        NSLog("[ADB] setupReverseTunnel: success — stdout='%@'", stdOutput.trimmingCharacters(in: .whitespacesAndNewlines))
+        NSLog("[ADB] setupReverseTunnel: success")
 
         let verified = verifyReverseTunnel(port: port)
         if !verified {
@@ -188,58 +204,36 @@ struct ADBBridge {
     }
 
     private static func verifyReverseTunnel(port: UInt16) -> Bool {
-        let stdout = Pipe()
-        guard let process = makeADBProcess(["reverse", "--list"]) else { return false }
-        process.standardOutput = stdout
-        process.standardError = FileHandle.nullDevice
-        try? process.run()
-        process.waitUntilExit()
-        let output = String(data: stdout.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-        let found = output.contains("tcp:\(port)")
+        var client = makeClient()
+        var list = [CChar](repeating: 0, count: 1024)
+        let n = adb_client_reverse_list(&client, nil, &list, list.count)
+        let output = n >= 0
+            ? String(decoding: list[..<Int(n)].map { UInt8(bitPattern: $0) }, as: UTF8.self)
+            : cString(client.error)
+        let found = n >= 0 && output.contains("tcp:\(port)")
         NSLog("[ADB] verifyReverseTunnel: %@ (output='%@')", found ? "VERIFIED" : "NOT FOUND", output.trimmingCharacters(in: .whitespacesAndNewlines))
         return found
     }
 
     @discardableResult
     static func removeReverseTunnel(port: UInt16) -> Bool {
-        guard let process = makeADBProcess(["reverse", "--remove", "tcp:\(port)"]) else { return false }
-        process.standardOutput = FileHandle.nullDevice
-        process.standardError = FileHandle.nullDevice
-        try? process.run()
-        process.waitUntilExit()
-        return process.terminationStatus == 0
+        var client = makeClient()
+        return adb_client_reverse_remove(&client, nil, "tcp:\(port)") == 0
     }
 
     static func querySystemSetting(_ setting: String) -> Int? {
-        let pipe = Pipe()
-        guard let process = makeADBProcess(["shell", "settings", "get", "system", setting]) else { return nil }
-        process.standardOutput = pipe
-        process.standardError = FileHandle.nullDevice
-        try? process.run()
-        process.waitUntilExit()
-        if let str = String(data: pipe.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8)?
-            .trimmingCharacters(in: .whitespacesAndNewlines) {
-            return Int(str)
+        shell("settings get system \(setting)").flatMap {
+            Int($0.trimmingCharacters(in: .whitespacesAndNewlines))
         }
-        return nil
     }
 
     static func setSystemSetting(_ setting: String, value: Int) {
-        guard let process = makeADBProcess(["shell", "settings", "put", "system", setting, "\(value)"]) else { return }
-        process.standardOutput = FileHandle.nullDevice
-        process.standardError = FileHandle.nullDevice
-        try? process.run()
+        _ = shell("settings put system \(setting) \(value)")
     }
 
     /// Check if the companion Android app is installed on the connected device.
     static func isAppInstalled() -> Bool {
-        let pipe = Pipe()
-        guard let process = makeADBProcess(["shell", "pm", "list", "packages", "com.daylight.mirror"]) else { return false }
-        process.standardOutput = pipe
-        process.standardError = FileHandle.nullDevice
-        try? process.run()
-        process.waitUntilExit()
-        let output = String(data: pipe.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
+        let output = shell("pm list packages com.daylight.mirror") ?? ""
         return output.contains("package:com.daylight.mirror")
     }
 
@@ -272,23 +266,13 @@ struct ADBBridge {
     /// Launch the companion app. When `forceRestart` is true, uses `-S` to stop any
     /// existing instance first, ensuring a fresh TCP connection through the tunnel.
     static func launchApp(forceRestart: Bool = false) {
-        var args = ["shell", "am", "start"]
-        if forceRestart { args.append("-S") }
-        args += ["-n", "com.daylight.mirror/.MirrorActivity"]
-        let stderr = Pipe()
-        guard let process = makeADBProcess(args) else { return }
-        process.standardOutput = FileHandle.nullDevice
-        process.standardError = stderr
-        do {
-            try process.run()
-        } catch {
-            NSLog("[ADB] launchApp: failed to launch — %@", "\(error)")
-            return
-        }
-        process.waitUntilExit()
-        if process.terminationStatus != 0 {
-            let errOutput = String(data: stderr.fileHandleForReading.readDataToEndOfFile(), encoding: .utf8) ?? ""
-            NSLog("[ADB] launchApp: exit %d — %@", process.terminationStatus, errOutput.trimmingCharacters(in: .whitespacesAndNewlines))
+        var command = "am start"
+        if forceRestart { command += " -S" }
+        command += " -n com.daylight.mirror/.MirrorActivity"
+        guard let output = shell(command) else { return }
+        // `am` reports failures on its output; the legacy shell service has no exit status.
+        if output.contains("Error") {
+            NSLog("[ADB] launchApp: %@", output.trimmingCharacters(in: .whitespacesAndNewlines))
         } else {
             NSLog("[ADB] Launched Daylight Mirror on device%@", forceRestart ? " (force-restart)" : "")
         }
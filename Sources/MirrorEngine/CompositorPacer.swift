@@ -11,6 +11,12 @@
 // Uses CADisplayLink (macOS 14+) for vsync-aligned timing. The 4x4 dirty
 // region forces WindowServer to recomposite the target display every frame.
 //
+// With PHASE_LOCK the ticks follow the receiver's display instead: a one-shot
+// timer is rescheduled at each tick for the time `phaseSource` returns, which
+// puts the frame just ahead of the receiver's latch (TCPServer/phase_ctl.h),
+// or one interval later until the phase is locked. The capture callback and
+// encode submission follow the composite, so they move with the tick.
+//
 // IMPORTANT: The dirty-pixel window must live on the virtual display's
 // NSScreen, not NSScreen.main. If the window is on the built-in display,
 // only that display's compositor sees dirty regions — the virtual display
@@ -30,7 +36,11 @@ class CompositorPacer {
     private var tickGapSumMs: Double = 0
     private var tickGapMaxMs: Double = 0
     private var tickOverruns: UInt64 = 0
-    private let dirtySize: CGFloat = {
+    /// Next tick (CACurrentMediaTime seconds) after the given one, or nil to run
+    /// free. Only used with PHASE_LOCK; asked at every tick.
+    var phaseSource: ((Double) -> Double?)?
+    /// Side of the pacer window in points; ScreenCapture ignores updates inside it.
+    static let dirtySize: CGFloat = {
         guard let raw = ProcessInfo.processInfo.environment["DAYLIGHT_DIRTY_SIZE"],
               let value = Double(raw),
               value >= 1 else { return 32 }
@@ -67,7 +77,7 @@ class CompositorPacer {
         // Avoid AppKit window tab indexing/background bookkeeping work.
         NSWindow.allowsAutomaticWindowTabbing = false
 
-        let dirtySize = self.dirtySize
+        let dirtySize = Self.dirtySize
         let dirtyLabel = "\(Int(dirtySize))x\(Int(dirtySize))"
 
         // Dirty region to force compositing every frame.
@@ -94,7 +104,16 @@ class CompositorPacer {
 
         // Use CADisplayLink from the target screen for vsync-aligned ticking.
         // If virtual display has no NSScreen (mirror mode), use a timer.
-        if let targetScreen = targetScreen {
+        if PHASE_LOCK {
+            let t = DispatchSource.makeTimerSource(flags: .strict, queue: .main)
+            t.setEventHandler { [weak self] in
+                self?.phaseTick()
+            }
+            t.schedule(deadline: .now())
+            t.resume()
+            self.timer = t
+            print("[Pacer] Started on display \(targetDisplayID) (phase-locked timer, \(dirtyLabel), target \(TARGET_FPS)fps)")
+        } else if let targetScreen = targetScreen {
             print("[Pacer] Target screen max FPS: \(targetScreen.maximumFramesPerSecond)")
             let dl = targetScreen.displayLink(target: self, selector: #selector(tick))
             dl.preferredFrameRateRange = CAFrameRateRange(minimum: Float(TARGET_FPS), maximum: Float(TARGET_FPS), preferred: Float(TARGET_FPS))
@@ -125,6 +144,15 @@ class CompositorPacer {
         performToggle()
     }
 
+    /// One-shot: toggle, then schedule the next tick from the phase lock.
+    private func phaseTick() {
+        performToggle()
+        let last = lastTickTime
+        let next = phaseSource?(last) ?? last + 1.0 / Double(TARGET_FPS)
+        let delay = max(0, next - CACurrentMediaTime())
+        timer?.schedule(deadline: .now() + delay, leeway: .microseconds(100))
+    }
+
     private func performToggle() {
         let now = CACurrentMediaTime()
         let expectedMs = 1000.0 / Double(TARGET_FPS)
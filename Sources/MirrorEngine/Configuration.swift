@@ -4,11 +4,13 @@
 // configuration values used across the engine.
 
 import Foundation
+import MirrorStats
 
 let TCP_PORT: UInt16 = 8888
 let TARGET_FPS: Int = 120  // DC-1 panel supports up to 120Hz
-let ENCODER_BPP: Double = 0.45  // HEVC with preprocessing - balance quality vs bandwidth
+let ENCODER_BPP: Double = 0.45  // HEVC/H.264 with preprocessing - balance quality vs bandwidth
 let KEYFRAME_INTERVAL: Int = 120
+let UNCHANGED_KEEPALIVE_FRAMES: Int = 30  // encode at least every 250ms while only the pacer changes
 
 // Resolution presets matching Daylight DC-1's native 1600x1200 panel.
 // Landscape presets are 4:3. Portrait presets are 3:4 (1200x1600 native).
@@ -62,15 +64,122 @@ public enum DisplayResolution: String, CaseIterable, Identifiable {
 let MAGIC_FRAME: [UInt8] = [0xDA, 0x7E]
 let MAGIC_CMD: [UInt8] = [0xDA, 0x7F]
 let MAGIC_ACK: [UInt8] = [0xDA, 0x7A]  // ACK from Android → Mac for RTT measurement
+let MAGIC_VSYNC: [UInt8] = [0xDA, 0x7B]  // vsync report from Android → Mac (after CMD_VSYNC_REPORTS)
 let FLAG_KEYFRAME: UInt8 = 0x01
+let FLAG_GREY_LZ4: UInt8 = 0x02    // LZ4 greyscale payload (Linux sender only; the Mac sends HEVC/H.264)
+let FLAG_GREY_TILES: UInt8 = 0x04  // with FLAG_GREY_LZ4: changed-tile layout
+let FLAG_FRAME_TIMING: UInt8 = 0x08  // payload starts with a FRAME_TIMING_SIZE sender timing block
 let CMD_BRIGHTNESS: UInt8 = 0x01
 let CMD_WARMTH: UInt8 = 0x02
 let CMD_BACKLIGHT_TOGGLE: UInt8 = 0x03
 let CMD_RESOLUTION: UInt8 = 0x04
+let CMD_REQUEST_KEYFRAME: UInt8 = 0x05  // Android → Mac: decoder watchdog recovered, send an IDR
+let CMD_CODECS: UInt8 = 0x06            // Android → Mac: decodable codecs, fastest first (packed)
+let CMD_CODEC: UInt8 = 0x07             // Mac → Android: codec of the frames that follow
+let CMD_FEATURES: UInt8 = 0x08          // Android → Mac: optional protocol features (FEATURE_* bits)
+let CMD_VSYNC_REPORTS: UInt8 = 0x09     // Mac → Android: 1 = send a vsync report per shown frame
+let FEATURE_FRAME_TIMING: UInt8 = 0x01  // receiver strips FLAG_FRAME_TIMING blocks
+
+// Codec ids on the wire (MIRROR_CODEC_* in mirror_protocol.h). Without negotiation
+// the stream is HEVC.
+let CODEC_HEVC: UInt8 = 0
+let CODEC_H264: UInt8 = 1
+let CODEC_AV1: UInt8 = 2
+let CODEC_COUNT: UInt8 = 3
+
+/// Codecs VideoToolbox encodes here, in the order used when receivers have no
+/// preference. `DAYLIGHT_CODEC=h264|hevc` pins one for experiments.
+let ENCODER_CODECS: [UInt8] = {
+    switch ProcessInfo.processInfo.environment["DAYLIGHT_CODEC"] {
+    case "h264": return [CODEC_H264]
+    case "hevc": return [CODEC_HEVC]
+    default: return [CODEC_HEVC, CODEC_H264]
+    }
+}()
+
+/// `DAYLIGHT_PHASE_LOCK=1`: receivers report the display latch each frame made
+/// (CMD_VSYNC_REPORTS) and CompositorPacer ticks so frames are ready just ahead
+/// of it (phase_ctl.h). Off by default.
+let PHASE_LOCK: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_PHASE_LOCK"] == "1"
+
+func codecName(_ id: UInt8) -> String {
+    switch id {
+    case CODEC_HEVC: return "hevc"
+    case CODEC_H264: return "h264"
+    case CODEC_AV1: return "av1"
+    default: return "codec\(id)"
+    }
+}
+
+/// Unpack a CMD_CODECS value: up to four ids, two bits each (id + 1) from the low
+/// bits up, a zero field ends the list. Same as mirror_codecs_unpack().
+func unpackCodecList(_ value: UInt8) -> [UInt8] {
+    var ids: [UInt8] = []
+    var shift: UInt8 = 0
+    while shift < 8 {
+        let field = (value >> shift) & 3
+        if field == 0 { break }
+        ids.append(field - 1)
+        shift += 2
+    }
+    return ids
+}
+
+/// The receiver's fastest codec that is also in `allowed`; HEVC if none is.
+/// Same as mirror_codec_pick().
+func pickCodec(ranked: [UInt8], allowed: Set<UInt8>) -> UInt8 {
+    return ranked.first { allowed.contains($0) } ?? CODEC_HEVC
+}
 
 // Frame header: [DA 7E] [flags:1] [seq:4 LE] [len:4 LE] [payload] = 11 bytes
 // ACK packet:   [DA 7A] [seq:4 LE] = 6 bytes (sent by Android after rendering)
+// Upstream cmd: [DA 7F] [cmd] [value] = 4 bytes (CMD_REQUEST_KEYFRAME, CMD_CODECS, CMD_FEATURES)
+// Vsync report: [DA 7B] [seq:4 LE] [arrival→latch µs:4 LE] [slack µs:4 LE] [period µs:4 LE]
+//               = 18 bytes, the latch deadline a shown frame was released for (see phase_ctl.h)
 let FRAME_HEADER_SIZE = 11
+let VSYNC_REPORT_SIZE = 18
+
+// Timing block, with FLAG_FRAME_TIMING, at the start of the payload (counted in len):
+// [capture→submit µs:4 LE] [encoder queue µs:4 LE] [encode µs:4 LE]. Only sent to
+// receivers that advertised FEATURE_FRAME_TIMING; TCPServer strips it for others.
+let FRAME_TIMING_SIZE = 12
+
+/// Fill in the frame header at the start of `frame`, whose first FRAME_HEADER_SIZE
+/// bytes were reserved and whose remaining bytes are the payload. Building the
+/// frame in one buffer avoids copying the payload behind a separate header.
+/// With `timing`, the FRAME_TIMING_SIZE bytes after the header must also have
+/// been reserved; they are filled in and FLAG_FRAME_TIMING is set.
+func writeFrameHeader(into frame: inout Data, isKeyframe: Bool, sequenceNumber: UInt32,
+                      timing: EncodeAttribution? = nil) {
+    precondition(frame.count >= FRAME_HEADER_SIZE + (timing == nil ? 0 : FRAME_TIMING_SIZE))
+    let payloadLength = UInt32(frame.count - FRAME_HEADER_SIZE)
+    func micros(_ ms: Double) -> UInt32 { UInt32(min(max(ms * 1000, 0), Double(UInt32.max)).rounded()) }
+    frame.withUnsafeMutableBytes { raw in
+        raw[0] = MAGIC_FRAME[0]
+        raw[1] = MAGIC_FRAME[1]
+        raw[2] = (isKeyframe ? FLAG_KEYFRAME : 0) | (timing == nil ? 0 : FLAG_FRAME_TIMING)
+        raw.storeBytes(of: sequenceNumber.littleEndian, toByteOffset: 3, as: UInt32.self)
+        raw.storeBytes(of: payloadLength.littleEndian, toByteOffset: 7, as: UInt32.self)
+        if let t = timing {
+            raw.storeBytes(of: micros(t.captureToSubmitMs).littleEndian, toByteOffset: FRAME_HEADER_SIZE, as: UInt32.self)
+            raw.storeBytes(of: micros(t.queueMs).littleEndian, toByteOffset: FRAME_HEADER_SIZE + 4, as: UInt32.self)
+            raw.storeBytes(of: micros(t.encodeMs).littleEndian, toByteOffset: FRAME_HEADER_SIZE + 8, as: UInt32.self)
+        }
+    }
+}
+
+/// `frame` as sent to a receiver that does not know FLAG_FRAME_TIMING: a new
+/// header without the flag and the payload after the timing block. The payload
+/// is a slice of `frame` (no copy). Nil if `frame` carries no timing block.
+func frameWithoutTiming(_ frame: Data) -> (header: Data, payload: Data)? {
+    guard frame.count >= FRAME_HEADER_SIZE + FRAME_TIMING_SIZE else { return nil }
+    var header = Data(frame.prefix(FRAME_HEADER_SIZE))
+    guard header[2] & FLAG_FRAME_TIMING != 0 else { return nil }
+    header[2] &= ~FLAG_FRAME_TIMING
+    let payloadLength = UInt32(frame.count - FRAME_HEADER_SIZE - FRAME_TIMING_SIZE)
+    header.withUnsafeMutableBytes { $0.storeBytes(of: payloadLength.littleEndian, toByteOffset: 7, as: UInt32.self) }
+    return (header, frame.suffix(from: frame.startIndex + FRAME_HEADER_SIZE + FRAME_TIMING_SIZE))
+}
 
 let BRIGHTNESS_STEP: Int = 15
 let WARMTH_STEP: Int = 20
@@ -3,8 +3,14 @@
 // Accepts newline-terminated text commands on /tmp/daylight-mirror.sock, dispatches
 // to MirrorEngine on the main queue, returns a response, and closes. Runs inside
 // whichever process owns the engine (GUI app or CLI daemon). 11 commands.
+//
+// SUBSCRIBE [interval_ms] is the exception: the connection stays open and gets a
+// StatsDelta line (counter deltas + histogram snapshots, see StatsStream.swift)
+// every interval (default 1000 ms) until the client hangs up. Lines are built
+// from the engine's StatsRecorder off the main queue.
 
 import Foundation
+import MirrorStats
 
 public class ControlSocket {
     public static let socketPath = "/tmp/daylight-mirror.sock"
@@ -12,6 +18,9 @@ public class ControlSocket {
     private let engine: MirrorEngine
     private var fd: Int32 = -1
     private var acceptSource: DispatchSourceRead?
+    private let subscriptionQueue = DispatchQueue(label: "control-subscriptions", qos: .utility)
+    private var subscriptions: [Int32: DispatchSourceTimer] = [:]   // subscriptionLock
+    private let subscriptionLock = NSLock()
 
     public init(engine: MirrorEngine) {
         self.engine = engine
@@ -65,6 +74,11 @@ public class ControlSocket {
         acceptSource?.cancel()
         acceptSource = nil
         fd = -1
+        subscriptionLock.lock()
+        let open = subscriptions.values
+        subscriptions.removeAll()
+        subscriptionLock.unlock()
+        open.forEach { $0.cancel() }
     }
 
     private func acceptConnection() {
@@ -79,6 +93,12 @@ public class ControlSocket {
         let rawCommand = String(cString: buffer)
             .trimmingCharacters(in: .whitespacesAndNewlines)
 
+        let words = rawCommand.split(separator: " ")
+        if words.first?.uppercased() == "SUBSCRIBE" {
+            subscribe(clientFD, intervalMs: words.count > 1 ? Int(words[1]) : nil)
+            return
+        }
+
         // Dispatch to main queue where the engine lives (@MainActor)
         DispatchQueue.main.async { [weak self] in
             guard let self = self else { close(clientFD); return }
@@ -90,6 +110,60 @@ public class ControlSocket {
         }
     }
 
+    // MARK: - SUBSCRIBE
+
+    private func subscribe(_ clientFD: Int32, intervalMs requested: Int?) {
+        let intervalMs = max(100, min(60_000, requested ?? 1000))
+        var one: Int32 = 1
+        setsockopt(clientFD, SOL_SOCKET, SO_NOSIGPIPE, &one, socklen_t(MemoryLayout<Int32>.size))
+        // A subscriber that stops reading is dropped rather than stalling the others.
+        var timeout = timeval(tv_sec: 1, tv_usec: 0)
+        setsockopt(clientFD, SOL_SOCKET, SO_SNDTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+        guard Self.sendLine(clientFD, StatsDelta.header(intervalMs: intervalMs)) else {
+            close(clientFD)
+            return
+        }
+
+        let stats = engine.stats
+        var previous = stats.snapshot()
+        let timer = DispatchSource.makeTimerSource(queue: subscriptionQueue)
+        timer.schedule(deadline: .now() + .milliseconds(intervalMs), repeating: .milliseconds(intervalMs),
+                       leeway: .milliseconds(intervalMs / 20))
+        timer.setEventHandler { [weak self] in
+            let current = stats.snapshot()
+            let delta = StatsDelta(from: previous, to: current)
+            previous = current
+            if !Self.sendLine(clientFD, delta.line) { self?.unsubscribe(clientFD) }
+        }
+        timer.setCancelHandler { close(clientFD) }
+        subscriptionLock.lock()
+        subscriptions[clientFD] = timer
+        subscriptionLock.unlock()
+        timer.resume()
+        print("[Socket] Stats subscriber connected (every \(intervalMs) ms)")
+    }
+
+    private func unsubscribe(_ clientFD: Int32) {
+        subscriptionLock.lock()
+        let timer = subscriptions.removeValue(forKey: clientFD)
+        subscriptionLock.unlock()
+        timer?.cancel()
+        if timer != nil { print("[Socket] Stats subscriber disconnected") }
+    }
+
+    /// Write `line` + newline completely; false once the client is gone.
+    private static func sendLine(_ clientFD: Int32, _ line: String) -> Bool {
+        let bytes = Array((line + "\n").utf8)
+        var offset = 0
+        while offset < bytes.count {
+            let n = bytes[offset...].withUnsafeBytes { send(clientFD, $0.baseAddress, $0.count, 0) }
+            if n < 0 && errno == EINTR { continue }
+            guard n > 0 else { return false }
+            offset += n
+        }
+        return true
+    }
+
     /// Parse and execute a control command. Returns the response string.
     private func handleCommand(_ raw: String) -> String {
         let parts = raw.split(separator: " ", maxSplits: 1).map(String.init)
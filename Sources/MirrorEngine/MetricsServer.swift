@@ -0,0 +1,129 @@
+// MetricsServer.swift — Opt-in OpenMetrics endpoint for Prometheus scrapers.
+//
+// DAYLIGHT_METRICS_PORT=<port> serves GET /metrics on 127.0.0.1:<port> (never on
+// other interfaces: put a reverse proxy or node-exporter-style relay in front to
+// scrape remotely). One request per connection, like ControlSocket; the body is
+// OpenMetrics.exposition (MirrorStats) of the engine's cumulative StatsRecorder
+// snapshot plus gauges read on the main queue.
+
+import Foundation
+import MirrorStats
+
+public class MetricsServer {
+    /// Port from DAYLIGHT_METRICS_PORT, or nil when the endpoint is off.
+    public static var configuredPort: UInt16? {
+        ProcessInfo.processInfo.environment["DAYLIGHT_METRICS_PORT"].flatMap { UInt16($0) }.flatMap { $0 > 0 ? $0 : nil }
+    }
+
+    private let engine: MirrorEngine
+    private let port: UInt16
+    private var fd: Int32 = -1
+    private var acceptSource: DispatchSourceRead?
+
+    public init(engine: MirrorEngine, port: UInt16) {
+        self.engine = engine
+        self.port = port
+    }
+
+    public func start() {
+        fd = socket(AF_INET, SOCK_STREAM, 0)
+        guard fd >= 0 else { print("[Metrics] Failed to create socket"); return }
+
+        var one: Int32 = 1
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, socklen_t(MemoryLayout<Int32>.size))
+
+        var addr = sockaddr_in()
+        addr.sin_len = UInt8(MemoryLayout<sockaddr_in>.size)
+        addr.sin_family = sa_family_t(AF_INET)
+        addr.sin_port = port.bigEndian
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1")
+
+        let bindResult = withUnsafePointer(to: &addr) { ptr in
+            ptr.withMemoryRebound(to: sockaddr.self, capacity: 1) { sockPtr in
+                bind(fd, sockPtr, socklen_t(MemoryLayout<sockaddr_in>.size))
+            }
+        }
+        guard bindResult == 0 else {
+            print("[Metrics] Failed to bind port \(port): \(String(cString: strerror(errno)))")
+            close(fd); fd = -1; return
+        }
+
+        guard listen(fd, 8) == 0 else {
+            print("[Metrics] Failed to listen: \(String(cString: strerror(errno)))")
+            close(fd); fd = -1; return
+        }
+
+        let source = DispatchSource.makeReadSource(fileDescriptor: fd, queue: .global())
+        source.setEventHandler { [weak self] in self?.acceptConnection() }
+        source.setCancelHandler { [weak self] in
+            if let fd = self?.fd, fd >= 0 { close(fd) }
+        }
+        source.resume()
+        acceptSource = source
+
+        print("[Metrics] Serving OpenMetrics at http://127.0.0.1:\(port)/metrics")
+    }
+
+    public func stop() {
+        acceptSource?.cancel()
+        acceptSource = nil
+        fd = -1
+    }
+
+    private func acceptConnection() {
+        let clientFD = accept(fd, nil, nil)
+        guard clientFD >= 0 else { return }
+        var one: Int32 = 1
+        setsockopt(clientFD, SOL_SOCKET, SO_NOSIGPIPE, &one, socklen_t(MemoryLayout<Int32>.size))
+        var timeout = timeval(tv_sec: 2, tv_usec: 0)
+        setsockopt(clientFD, SOL_SOCKET, SO_RCVTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+        setsockopt(clientFD, SOL_SOCKET, SO_SNDTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+
+        // Only the request line matters; headers and any body are ignored.
+        var buffer = [CChar](repeating: 0, count: 2048)
+        let bytesRead = recv(clientFD, &buffer, buffer.count - 1, 0)
+        guard bytesRead > 0 else { close(clientFD); return }
+        let requestLine = String(cString: buffer).prefix { $0 != "\r" && $0 != "\n" }
+        let parts = requestLine.split(separator: " ")
+
+        guard parts.count >= 2, parts[0] == "GET" || parts[0] == "HEAD" else {
+            respond(clientFD, status: "405 Method Not Allowed", contentType: "text/plain", body: "GET /metrics\n")
+            return
+        }
+        guard parts[1] == "/metrics" || parts[1].hasPrefix("/metrics?") else {
+            respond(clientFD, status: "404 Not Found", contentType: "text/plain", body: "GET /metrics\n")
+            return
+        }
+        let headOnly = parts[0] == "HEAD"
+
+        // Gauges are @Published engine state: read them where the engine lives.
+        DispatchQueue.main.async { [weak self] in
+            guard let self = self else { close(clientFD); return }
+            let gauges = self.engine.metricsGauges()
+            let totals = self.engine.stats.snapshot()
+            DispatchQueue.global(qos: .utility).async {
+                let body = OpenMetrics.exposition(totals, gauges)
+                self.respond(clientFD, status: "200 OK", contentType: OpenMetrics.contentType,
+                             body: body, headOnly: headOnly)
+            }
+        }
+    }
+
+    private func respond(_ clientFD: Int32, status: String, contentType: String, body: String,
+                         headOnly: Bool = false) {
+        let payload = Array(body.utf8)
+        var response = Array(("HTTP/1.1 \(status)\r\n"
+            + "Content-Type: \(contentType)\r\n"
+            + "Content-Length: \(payload.count)\r\n"
+            + "Connection: close\r\n\r\n").utf8)
+        if !headOnly { response += payload }
+        var offset = 0
+        while offset < response.count {
+            let n = response[offset...].withUnsafeBytes { send(clientFD, $0.baseAddress, $0.count, 0) }
+            if n < 0 && errno == EINTR { continue }
+            guard n > 0 else { break }
+            offset += n
+        }
+        close(clientFD)
+    }
+}
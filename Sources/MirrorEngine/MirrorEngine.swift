@@ -13,6 +13,7 @@
 
 import Foundation
 import AppKit
+import MirrorStats
 
 public class MirrorEngine: ObservableObject {
     // RELEASE: Bump this BEFORE creating a GitHub release. Also upload both
@@ -32,10 +33,12 @@ public class MirrorEngine: ObservableObject {
     @Published public var totalFrames: Int = 0
     @Published public var frameSizeKB: Int = 0
     @Published public var greyMs: Double = 0      // Image processing time
-    @Published public var compressMs: Double = 0   // HEVC encode time per frame
+    @Published public var compressMs: Double = 0   // HEVC/H.264 encode time per frame
     @Published public var jitterMs: Double = 0     // SCStream delivery jitter (deviation from expected interval)
     @Published public var rttMs: Double = 0        // Round-trip latency (Mac send → Android ACK)
+    @Published public var rttP50Ms: Double = 0     // Median RTT
     @Published public var rttP95Ms: Double = 0     // 95th percentile RTT
+    @Published public var rttP99Ms: Double = 0     // 99th percentile RTT
     @Published public var skippedFrames: Int = 0  // Frames skipped due to Android backpressure
     @Published public var fontSmoothingDisabled: Bool = false
     @Published public var deviceDetected: Bool = false
@@ -45,12 +48,17 @@ public class MirrorEngine: ObservableObject {
         didSet { UserDefaults.standard.set(resolution.rawValue, forKey: "resolution") }
     }
 
+    /// Cumulative frame, byte and latency counters across restarts; streamed by
+    /// the control socket's SUBSCRIBE and exported by MetricsServer.
+    public let stats = StatsRecorder()
+
     private var displayManager: VirtualDisplayManager?
     private var tcpServer: TCPServer?
     private var capture: ScreenCapture?
     private var displayController: DisplayController?
     private var compositorPacer: CompositorPacer?
     private var controlSocket: ControlSocket?
+    private var metricsServer: MetricsServer?
     private var usbMonitor: USBDeviceMonitor?
     /// When true, auto-start/stop mirroring based on USB device state.
     @Published public var autoMirrorEnabled: Bool = true {
@@ -73,10 +81,17 @@ public class MirrorEngine: ObservableObject {
             let sock = ControlSocket(engine: self)
             sock.start()
             self.controlSocket = sock
+
+            // Prometheus/OpenMetrics endpoint — opt-in, localhost only.
+            if let port = MetricsServer.configuredPort {
+                let metrics = MetricsServer(engine: self, port: port)
+                metrics.start()
+                self.metricsServer = metrics
+            }
         }
 
         // USB device monitoring — auto-detect DC-1 connect/disconnect
-        // Ensure adb server is running before polling, otherwise `adb devices` returns nothing.
+        // Ensure adb server is running before tracking; the tracker reconnects if it restarts later.
         DispatchQueue.global(qos: .utility).async {
             if ADBBridge.isAvailable() { ADBBridge.ensureServerRunning() }
             DispatchQueue.main.async { [weak self] in
@@ -205,6 +220,7 @@ public class MirrorEngine: ObservableObject {
             let tcp = try TCPServer(port: TCP_PORT)
             tcp.frameWidth = UInt16(w)
             tcp.frameHeight = UInt16(h)
+            tcp.stats = stats
             tcp.onClientCountChanged = { [weak self] count in
                 DispatchQueue.main.async {
                     self?.clientCount = count
@@ -213,11 +229,14 @@ public class MirrorEngine: ObservableObject {
             tcp.onLatencyStats = { [weak self] stats in
                 DispatchQueue.main.async {
                     self?.rttMs = stats.rttAvgMs
+                    self?.rttP50Ms = stats.rttP50Ms
                     self?.rttP95Ms = stats.rttP95Ms
+                    self?.rttP99Ms = stats.rttP99Ms
                 }
             }
             tcp.start()
             tcpServer = tcp
+            pacer.phaseSource = { [weak tcp] last in tcp?.nextCaptureTick(after: last) }
 
         } catch {
             status = .error("Server failed: \(error.localizedDescription)")
@@ -252,6 +271,7 @@ public class MirrorEngine: ObservableObject {
                 self?.skippedFrames = skipped
             }
         }
+        cap.stats = stats
         capture = cap
         do {
             try await cap.start()
@@ -464,4 +484,22 @@ public class MirrorEngine: ObservableObject {
         fontSmoothingDisabled = !enabled
         print("[Engine] Font smoothing \(enabled ? "enabled" : "disabled")")
     }
+
+    /// Point-in-time values for the metrics endpoint; counters come from `stats`.
+    func metricsGauges() -> MetricsGauges {
+        var g = MetricsGauges()
+        g.running = status == .running
+        g.clients = clientCount
+        g.fps = fps
+        g.processAvgMs = greyMs
+        g.encodeAvgMs = compressMs
+        g.rttP50Ms = rttP50Ms
+        g.rttP95Ms = rttP95Ms
+        g.rttP99Ms = rttP99Ms
+        if let tcp = tcpServer {
+            g.inflightFrames = tcp.inflightFrames
+            g.backpressureWindowFrames = tcp.backpressureWindow().frames
+        }
+        return g
+    }
 }
@@ -1,8 +1,9 @@
-// ScreenCapture.swift — Mac screen capture with VideoToolbox HEVC hardware encode.
+// ScreenCapture.swift — Mac screen capture with VideoToolbox HEVC/H.264 hardware encode.
 //
 // Captures the virtual display via CGDisplayStream (loaded at runtime via dlsym
 // to bypass macOS 15 SDK deprecation), wraps each IOSurface as a CVPixelBuffer,
-// and feeds it into a VTCompressionSession for low-latency HEVC encoding.
+// and feeds it into a VTCompressionSession for low-latency HEVC (or H.264, when the
+// receivers decode it faster) encoding.
 // The encoded NAL units (Annex B) are broadcast over TCP to the Android receiver.
 
 import Foundation
@@ -14,6 +15,7 @@ import VideoToolbox
 import CoreMedia
 import Metal
 import os.lock
+import MirrorStats
 
 // MARK: - Screen Capture Errors
 
@@ -39,6 +41,10 @@ private typealias CGDisplayStreamCreateFn = @convention(c) (
 ) -> OpaquePointer?
 private typealias CGDisplayStreamStartFn = @convention(c) (OpaquePointer) -> Int32
 private typealias CGDisplayStreamStopFn = @convention(c) (OpaquePointer) -> Int32
+private typealias CGDisplayStreamUpdateGetRectsFn = @convention(c) (
+    OpaquePointer, Int32, UnsafeMutablePointer<Int>
+) -> UnsafePointer<CGRect>?
+private let kCGDisplayStreamUpdateDirtyRects: Int32 = 2
 
 private func copyPixelBuffer(_ source: CVPixelBuffer) -> CVPixelBuffer? {
     CVPixelBufferLockBaseAddress(source, .readOnly)
@@ -63,6 +69,8 @@ private func copyPixelBuffer(_ source: CVPixelBuffer) -> CVPixelBuffer? {
     return dest
 }
 
+/// The inflight limit used before TCPServer's bandwidth-delay-product window.
+/// Still selectable with DAYLIGHT_BACKPRESSURE=legacy for comparison.
 func adaptiveBackpressureThreshold(rttMs: Double) -> Int {
     max(2, min(6, Int(120.0 / max(rttMs, 1.0))))
 }
@@ -79,11 +87,13 @@ class ScreenCapture: NSObject {
     // CGDisplayStream runtime handles
     private var cgHandle: UnsafeMutableRawPointer?
     private var displayStream: OpaquePointer?
+    private var updateGetRects: CGDisplayStreamUpdateGetRectsFn?
 
     // VideoToolbox encoder
     private var vtSession: VTCompressionSession?
     private var encoderFormatDesc: CMFormatDescription?
     private var vtSessionSelfRef: Unmanaged<ScreenCapture>?
+    private var encoderCodec: UInt8 = CODEC_HEVC
 
 
     // Frame dimensions
@@ -95,17 +105,30 @@ class ScreenCapture: NSObject {
     var skippedFrames: Int = 0
     var skippedInflight: Int = 0
     var skippedEncoderQueue: Int = 0
+    /// Frames where only the CompositorPacer window changed (see FrameChangeFilter).
+    private var changeFilter = FrameChangeFilter(ignoring: [], keepaliveInterval: UNCHANGED_KEEPALIVE_FRAMES)
     var lastStatTime: Date = Date()
     var convertTimeSum: Double = 0
-    var compressTimeSum: Double = 0
     var statFrames: Int = 0
     var lastCompressedSize: Int = 0
     var lastInflightFrames: Int = 0
     var lastBackpressureThreshold: Int = 0
     var lastRTTMs: Double = 0
     var encoderQueueDepth: Int = 0
+    /// Capture/submit times per frame, keyed by the token passed as
+    /// sourceFrameRefcon; splits encoder latency into queue wait and encode.
+    private var encoderTimeline = EncoderTimeline()      // encoderLock
+    private var encodeTimeSum: Double = 0                // encoderLock, since the last stats print
+    private var encodeQueueSum: Double = 0               // encoderLock
+    private var encodedFrames: Int = 0                   // encoderLock
 
     private let disableSkipBackpressure: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_DISABLE_SKIP_BACKPRESSURE"] == "1"
+    private let legacyBackpressure: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_BACKPRESSURE"] == "legacy"
+    private let disableUnchangedSkip: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_DISABLE_UNCHANGED_SKIP"] == "1"
+    /// IDR every KEYFRAME_INTERVAL frames (DAYLIGHT_KEYFRAMES=periodic). By default
+    /// keyframes go out only for the first frame, a codec switch, a joining client
+    /// or a receiver request, so the stream has no periodic bitrate spikes.
+    private let periodicKeyframes: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_KEYFRAMES"] == "periodic"
     private let maxEncoderQueueDepth: Int = {
         guard let raw = ProcessInfo.processInfo.environment["DAYLIGHT_MAX_ENC_QUEUE"],
               let value = Int(raw),
@@ -119,6 +142,8 @@ class ScreenCapture: NSObject {
 
     /// Callback: (fps, bandwidthMB, frameSizeKB, totalFrames, greyMs, compressMs, jitterMs, skipped)
     var onStats: ((Double, Double, Int, Int, Double, Double, Double, Int) -> Void)?
+    /// Per-frame counters for the control socket's SUBSCRIBE stream.
+    var stats: StatsRecorder?
 
     // Synchronization lock for shared state accessed from multiple threads
     private var encoderLock = os_unfair_lock()
@@ -147,7 +172,7 @@ class ScreenCapture: NSObject {
         try setupEncoder()
 
         print("Capturing display: \(expectedWidth)x\(expectedHeight) pixels (ID: \(targetDisplayID))")
-        print("[Capture] backpressure config: skip=\(disableSkipBackpressure ? "disabled" : "enabled") maxEncQ=\(maxEncoderQueueDepth)")
+        print("[Capture] backpressure config: skip=\(disableSkipBackpressure ? "disabled" : "enabled") window=\(legacyBackpressure ? "legacy" : "bdp") maxEncQ=\(maxEncoderQueueDepth)")
 
         guard let cg = dlopen("/System/Library/Frameworks/CoreGraphics.framework/CoreGraphics", RTLD_LAZY) else {
             throw ScreenCaptureError.contentEnumerationFailed(
@@ -164,6 +189,16 @@ class ScreenCapture: NSObject {
                         userInfo: [NSLocalizedDescriptionKey: "Failed to resolve CGDisplayStream symbols"]))
         }
         _ = stopSym
+        if !disableUnchangedSkip, let rectsSym = dlsym(cg, "CGDisplayStreamUpdateGetRects") {
+            updateGetRects = unsafeBitCast(rectsSym, to: CGDisplayStreamUpdateGetRectsFn.self)
+        }
+        // The pacer window sits at the display's top-left; capture is in pixels.
+        let pointWidth = CGDisplayBounds(targetDisplayID).width
+        let scale = pointWidth > 0 ? Double(frameWidth) / Double(pointWidth) : 1
+        changeFilter = FrameChangeFilter(
+            ignoring: [FrameChangeFilter.pacerRegion(dirtySize: Double(CompositorPacer.dirtySize), scale: scale)],
+            keepaliveInterval: UNCHANGED_KEEPALIVE_FRAMES)
+        print("[Capture] unchanged-frame skip: \(updateGetRects != nil ? "enabled" : "disabled") (keepalive every \(UNCHANGED_KEEPALIVE_FRAMES) frames)")
 
         let createFn = unsafeBitCast(createSym, to: CGDisplayStreamCreateFn.self)
         let startFn  = unsafeBitCast(startSym,  to: CGDisplayStreamStartFn.self)
@@ -188,8 +223,8 @@ class ScreenCapture: NSObject {
             pixelFormat,
             properties as CFDictionary,
             captureQueue,
-            { [weak self] (status: Int32, _: UInt64, surface: IOSurfaceRef?, _: OpaquePointer?) in
-                self?.handleFrame(status: status, surface: surface)
+            { [weak self] (status: Int32, _: UInt64, surface: IOSurfaceRef?, update: OpaquePointer?) in
+                self?.handleFrame(status: status, surface: surface, update: update)
             }
         ) else {
             throw ScreenCaptureError.contentEnumerationFailed(
@@ -209,7 +244,7 @@ class ScreenCapture: NSObject {
         }
 
         lastStatTime = Date()
-        print("Capture started at \(TARGET_FPS)fps -- CGDisplayStream + VideoToolbox HEVC")
+        print("Capture started at \(TARGET_FPS)fps -- CGDisplayStream + VideoToolbox \(codecName(encoderCodec))")
     }
 
     func stop() async {
@@ -246,12 +281,13 @@ class ScreenCapture: NSObject {
             kVTVideoEncoderSpecification_EnableLowLatencyRateControl: true
         ]
 
+        let isH264 = encoderCodec == CODEC_H264
         var session: VTCompressionSession?
         let status = VTCompressionSessionCreate(
             allocator: nil,
             width: Int32(frameWidth),
             height: Int32(frameHeight),
-            codecType: kCMVideoCodecType_HEVC,
+            codecType: isH264 ? kCMVideoCodecType_H264 : kCMVideoCodecType_HEVC,
             encoderSpecification: encoderSpec as CFDictionary,
             imageBufferAttributes: [
                 kCVPixelBufferPixelFormatTypeKey: sourcePixelFormat,
@@ -276,15 +312,20 @@ class ScreenCapture: NSObject {
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_RealTime, value: kCFBooleanTrue)
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_AllowFrameReordering, value: kCFBooleanFalse)
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_ProfileLevel,
-                             value: kVTProfileLevel_HEVC_Main_AutoLevel)
+                             value: isH264 ? kVTProfileLevel_H264_High_AutoLevel
+                                           : kVTProfileLevel_HEVC_Main_AutoLevel)
         let envBpp = ProcessInfo.processInfo.environment["DAYLIGHT_ENCODER_BPP"].flatMap(Double.init)
         let encoderBpp = (envBpp ?? ENCODER_BPP)
         let bitrate = Int(Double(frameWidth * frameHeight * TARGET_FPS) * encoderBpp)
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_AverageBitRate,
                              value: bitrate as CFNumber)
+        // VideoToolbox has no rolling intra-refresh setting; without periodic
+        // keyframes the encoder is told never to insert one itself (0 = no limit)
+        // and every IDR is forced from handleFrame.
+        let keyframeInterval = periodicKeyframes ? KEYFRAME_INTERVAL : 0
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_MaxKeyFrameInterval,
-                             value: KEYFRAME_INTERVAL as CFNumber)
-        let keyframeSeconds = Double(KEYFRAME_INTERVAL) / Double(TARGET_FPS)
+                             value: keyframeInterval as CFNumber)
+        let keyframeSeconds = Double(keyframeInterval) / Double(TARGET_FPS)
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_MaxKeyFrameIntervalDuration,
                              value: keyframeSeconds as CFNumber)
         VTSessionSetProperty(session, key: kVTCompressionPropertyKey_ExpectedFrameRate,
@@ -292,14 +333,56 @@ class ScreenCapture: NSObject {
 
         VTCompressionSessionPrepareToEncodeFrames(session)
         vtSession = session
-        print(String(format: "VideoToolbox HEVC encoder ready: %dx%d @ %dMbps (bpp=%.3f)",
-                     frameWidth, frameHeight, bitrate / 1_000_000, encoderBpp))
+        print(String(format: "VideoToolbox %@ encoder ready: %dx%d @ %dMbps (bpp=%.3f)",
+                     codecName(encoderCodec), frameWidth, frameHeight, bitrate / 1_000_000, encoderBpp))
+    }
+
+    /// Replace the compression session with one for `codec`. Frames still in the
+    /// old session are emitted first, so nothing of the old codec follows the
+    /// CMD_CODEC announcement.
+    private func switchEncoder(to codec: UInt8) {
+        if let session = vtSession {
+            VTCompressionSessionCompleteFrames(session, untilPresentationTimeStamp: .invalid)
+            VTCompressionSessionInvalidate(session)
+            vtSession = nil
+        }
+        if let ref = vtSessionSelfRef {
+            ref.release()
+            vtSessionSelfRef = nil
+        }
+        encoderFormatDesc = nil
+        os_unfair_lock_lock(&encoderLock)
+        encoderTimeline.reset()
+        os_unfair_lock_unlock(&encoderLock)
+        let previous = encoderCodec
+        encoderCodec = codec
+        do {
+            try setupEncoder()
+        } catch {
+            print("[Capture] \(codecName(codec)) encoder failed (\(error)), staying on \(codecName(previous))")
+            encoderCodec = previous
+            try? setupEncoder()
+        }
+        tcpServer.setStreamCodec(encoderCodec)
     }
 
     // MARK: - Frame callback
 
-    private func handleFrame(status: Int32, surface: IOSurfaceRef?) {
+    /// What changed since the previous update, in frame pixels; nil if unknown.
+    private func dirtyRects(_ update: OpaquePointer?) -> [DirtyRect]? {
+        guard let update = update, let getRects = updateGetRects else { return nil }
+        var count = 0
+        guard let rects = getRects(update, kCGDisplayStreamUpdateDirtyRects, &count) else { return nil }
+        return (0..<count).map {
+            let r = rects[$0]
+            return DirtyRect(x: Double(r.origin.x), y: Double(r.origin.y),
+                             width: Double(r.size.width), height: Double(r.size.height))
+        }
+    }
+
+    private func handleFrame(status: Int32, surface: IOSurfaceRef?, update: OpaquePointer?) {
         guard status == 0, let surface = surface else { return }
+        stats?.recordCaptured()
 
         let t0 = CACurrentMediaTime()
 
@@ -314,30 +397,58 @@ class ScreenCapture: NSObject {
         }
         lastCallbackTime = t0
 
+        // Clients (or their codec adverts) changed: move to the fastest codec they all decode.
+        var switchedCodec = false
+        if let codec = tcpServer.takeCodecChoice(encodable: ENCODER_CODECS), codec != encoderCodec {
+            switchEncoder(to: codec)
+            switchedCodec = true
+        }
+
         // Backpressure: drop frames when Android can't keep up or encoder queue is full.
         let inflight = tcpServer.inflightFrames
-        let isScheduledKeyframe = (frameCount % KEYFRAME_INTERVAL == 0)
+        let isScheduledKeyframe = periodicKeyframes ? frameCount % KEYFRAME_INTERVAL == 0 : frameCount == 0
+        // A receiver that joined, recovered its decoder or just switched codec
+        // skips everything until an IDR; never drop it.
+        let isRequestedKeyframe = tcpServer.takeKeyframeRequest() || switchedCodec
+
+        // Nothing but the pacer window changed: the last encoded frame is still
+        // current, so skip processing and encoding (keyframes and keepalives aside).
+        if updateGetRects != nil,
+           changeFilter.decide(dirtyRects: dirtyRects(update),
+                               force: isScheduledKeyframe || isRequestedKeyframe) == .skip {
+            stats?.recordUnchanged()
+            frameCount += 1
+            return
+        }
+
         let rtt = tcpServer.latencyStats?.rttAvgMs ?? 15.0
-        let adaptiveThreshold = adaptiveBackpressureThreshold(rttMs: rtt)
+        let overInflight: Bool
+        if legacyBackpressure {
+            lastBackpressureThreshold = adaptiveBackpressureThreshold(rttMs: rtt)
+            overInflight = inflight > lastBackpressureThreshold
+        } else {
+            let window = tcpServer.backpressureWindow()
+            lastBackpressureThreshold = window.frames
+            overInflight = !window.allowsFrame
+        }
         lastInflightFrames = inflight
-        lastBackpressureThreshold = adaptiveThreshold
         lastRTTMs = rtt
 
         os_unfair_lock_lock(&encoderLock)
         let currentQueueDepth = encoderQueueDepth
         os_unfair_lock_unlock(&encoderLock)
 
-        let overInflight = inflight > adaptiveThreshold
         let overQueue = currentQueueDepth >= maxEncoderQueueDepth
-        if !disableSkipBackpressure && (overInflight || overQueue) && !isScheduledKeyframe {
+        if !disableSkipBackpressure && (overInflight || overQueue) && !isScheduledKeyframe && !isRequestedKeyframe {
             skippedFrames += 1
             if overInflight { skippedInflight += 1 }
             if overQueue { skippedEncoderQueue += 1 }
+            stats?.recordSkipped(overInflight ? .inflight : .encoderQueue)
             frameCount += 1
             return
         }
 
-        let isKeyframe = isScheduledKeyframe
+        let isKeyframe = isScheduledKeyframe || isRequestedKeyframe
 
         IOSurfaceLock(surface, .readOnly, nil)
         let iosurfaceObj = unsafeBitCast(surface, to: IOSurface.self)
@@ -371,6 +482,7 @@ class ScreenCapture: NSObject {
         let presentationTime = CMTimeMake(value: Int64(frameCount), timescale: Int32(TARGET_FPS))
         os_unfair_lock_lock(&encoderLock)
         encoderQueueDepth += 1
+        let token = encoderTimeline.submit(capturedAt: t0, submittedAt: CACurrentMediaTime())
         os_unfair_lock_unlock(&encoderLock)
         VTCompressionSessionEncodeFrame(
             session,
@@ -378,54 +490,69 @@ class ScreenCapture: NSObject {
             presentationTimeStamp: presentationTime,
             duration: .invalid,
             frameProperties: frameProps,
-            sourceFrameRefcon: nil,
+            sourceFrameRefcon: UnsafeMutableRawPointer(bitPattern: token),
             infoFlagsOut: nil
         )
-
-        let t3 = CACurrentMediaTime()
+        changeFilter.encoded()
+        stats?.recordEncoded(processMs: (t2 - t1) * 1000)
 
         IOSurfaceUnlock(surface, .readOnly, nil)
 
         frameCount += 1
         statFrames += 1
         convertTimeSum += (t2 - t1) * 1000
-        compressTimeSum += (t3 - t2) * 1000
 
         let now = Date()
         if now.timeIntervalSince(lastStatTime) >= 5.0 {
             let fps = Double(statFrames) / now.timeIntervalSince(lastStatTime)
             let avgProcess = statFrames > 0 ? convertTimeSum / Double(statFrames) : 0
-            let avgCompress = statFrames > 0 ? compressTimeSum / Double(statFrames) : 0
-            
+
             os_unfair_lock_lock(&encoderLock)
             let currentQueueDepth = encoderQueueDepth
             let currentCompressedSize = lastCompressedSize
+            let avgCompress = encodedFrames > 0 ? encodeTimeSum / Double(encodedFrames) : 0
+            let avgEncodeQueue = encodedFrames > 0 ? encodeQueueSum / Double(encodedFrames) : 0
+            encodeTimeSum = 0
+            encodeQueueSum = 0
+            encodedFrames = 0
             os_unfair_lock_unlock(&encoderLock)
             
             let bw = Double(currentCompressedSize) * fps / 1024 / 1024
             let avgJitter = jitterSamples.isEmpty ? 0.0 : jitterSamples.reduce(0, +) / Double(jitterSamples.count)
 
-            print(String(format: "FPS: %.1f | process: %.2fms | encode: %.1fms | jitter: %.1fms | inflight: %d/%d | encQ: %d | rtt: %.1fms | frame: %dKB | ~%.1fMB/s | total: %d | skipped: %d (I:%d Q:%d)",
-                         fps, avgProcess, avgCompress, avgJitter,
+            print(String(format: "FPS: %.1f | process: %.2fms | encode: %.1fms (+%.1fms queued) | jitter: %.1fms | inflight: %d/%d | encQ: %d | rtt: %.1fms | frame: %dKB | ~%.1fMB/s | total: %d | skipped: %d (I:%d Q:%d) | unchanged: %llu",
+                         fps, avgProcess, avgCompress, avgEncodeQueue, avgJitter,
                          lastInflightFrames, lastBackpressureThreshold, currentQueueDepth, lastRTTMs,
-                         currentCompressedSize / 1024, bw, frameCount, skippedFrames, skippedInflight, skippedEncoderQueue))
+                         currentCompressedSize / 1024, bw, frameCount, skippedFrames, skippedInflight, skippedEncoderQueue,
+                         changeFilter.skipped))
             onStats?(fps, bw, currentCompressedSize / 1024, frameCount, avgProcess, avgCompress, avgJitter, skippedFrames)
 
             statFrames = 0
             convertTimeSum = 0
-            compressTimeSum = 0
             lastStatTime = now
         }
     }
 
     // MARK: - VTCompressionSession output callback
 
-    func handleEncoderOutput(status: OSStatus, flags: VTEncodeInfoFlags, sampleBuffer: CMSampleBuffer?) {
+    func handleEncoderOutput(status: OSStatus, flags: VTEncodeInfoFlags, sampleBuffer: CMSampleBuffer?,
+                             token: Int) {
+        let now = CACurrentMediaTime()
         os_unfair_lock_lock(&encoderLock)
         encoderQueueDepth = max(0, encoderQueueDepth - 1)
+        // Completed even if dropped: the encoder was busy with it either way.
+        let timing = encoderTimeline.complete(token, at: now)
         os_unfair_lock_unlock(&encoderLock)
         guard status == noErr, let sampleBuffer = sampleBuffer else { return }
         guard !flags.contains(.frameDropped) else { return }
+        if let timing = timing {
+            os_unfair_lock_lock(&encoderLock)
+            encodeTimeSum += timing.encodeMs
+            encodeQueueSum += timing.queueMs
+            encodedFrames += 1
+            os_unfair_lock_unlock(&encoderLock)
+            stats?.recordEncoderOutput(timing)
+        }
 
         let attachments = CMSampleBufferGetSampleAttachmentsArray(sampleBuffer, createIfNecessary: false)
         var isIDR = false
@@ -434,35 +561,6 @@ class ScreenCapture: NSObject {
             isIDR = !notSync
         }
 
-        var annexB = Data()
-
-        if isIDR {
-            if let fmtDesc = CMSampleBufferGetFormatDescription(sampleBuffer) {
-                var paramCount = 0
-                CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(
-                    fmtDesc, parameterSetIndex: 0,
-                    parameterSetPointerOut: nil,
-                    parameterSetSizeOut: nil,
-                    parameterSetCountOut: &paramCount,
-                    nalUnitHeaderLengthOut: nil)
-                for i in 0..<paramCount {
-                    var nalPtr: UnsafePointer<UInt8>? = nil
-                    var nalLen = 0
-                    CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(
-                        fmtDesc, parameterSetIndex: i,
-                        parameterSetPointerOut: &nalPtr,
-                        parameterSetSizeOut: &nalLen,
-                        parameterSetCountOut: nil,
-                        nalUnitHeaderLengthOut: nil)
-                    if let nalPtr = nalPtr, nalLen > 0 {
-                        annexB.append(contentsOf: [0x00, 0x00, 0x00, 0x01])
-                        annexB.append(nalPtr, count: nalLen)
-                    }
-                }
-                encoderFormatDesc = fmtDesc
-            }
-        }
-
         guard let dataBuffer = CMSampleBufferGetDataBuffer(sampleBuffer) else { return }
         var totalLength = 0
         var dataPointer: UnsafeMutablePointer<Int8>? = nil
@@ -471,27 +569,75 @@ class ScreenCapture: NSObject {
             totalLengthOut: &totalLength, dataPointerOut: &dataPointer)
         guard blockStatus == kCMBlockBufferNoErr, let dataPointer = dataPointer else { return }
 
+        // Build the wire frame in a single buffer: header space up front, filled in
+        // once the payload length and sequence number are known. Sized for the
+        // slices (AVCC length prefixes become start codes of the same size) plus
+        // parameter sets, so appends never reallocate and the payload is not
+        // copied again behind a separate header in broadcast(). The timing block
+        // (FLAG_FRAME_TIMING) sits between header and slices.
+        let prefixSize = FRAME_HEADER_SIZE + (timing == nil ? 0 : FRAME_TIMING_SIZE)
+        var frame = Data(capacity: prefixSize + totalLength + (isIDR ? 512 : 0))
+        frame.append(contentsOf: [UInt8](repeating: 0, count: prefixSize))
+
+        if isIDR {
+            if let fmtDesc = CMSampleBufferGetFormatDescription(sampleBuffer) {
+                appendParameterSets(of: fmtDesc, to: &frame)
+                encoderFormatDesc = fmtDesc
+            }
+        }
+
         var offset = 0
         while offset < totalLength - 4 {
             let rawLen = dataPointer.advanced(by: offset).withMemoryRebound(to: UInt32.self, capacity: 1) { $0.pointee }
             let nalLen = Int(CFSwapInt32BigToHost(rawLen))
             offset += 4
             guard offset + nalLen <= totalLength else { break }
-            annexB.append(contentsOf: [0x00, 0x00, 0x00, 0x01])
+            frame.append(contentsOf: [0x00, 0x00, 0x00, 0x01])
             dataPointer.advanced(by: offset).withMemoryRebound(to: UInt8.self, capacity: nalLen) { ptr in
-                annexB.append(ptr, count: nalLen)
+                frame.append(ptr, count: nalLen)
             }
             offset += nalLen
         }
 
-        guard !annexB.isEmpty else { return }
+        guard frame.count > prefixSize else { return }
 
         os_unfair_lock_lock(&encoderLock)
-        lastCompressedSize = annexB.count
+        lastCompressedSize = frame.count - prefixSize
         let seq = frameSequence
         frameSequence &+= 1
         os_unfair_lock_unlock(&encoderLock)
-        tcpServer.broadcast(payload: annexB, isKeyframe: isIDR, sequenceNumber: seq)
+        writeFrameHeader(into: &frame, isKeyframe: isIDR, sequenceNumber: seq, timing: timing)
+        tcpServer.broadcast(frame: frame, isKeyframe: isIDR, sequenceNumber: seq,
+                            capturedAt: timing.map { now - $0.captureToEncodedMs / 1000 })
+    }
+}
+
+/// Append the VPS/SPS/PPS (HEVC) or SPS/PPS (H.264) of `fmtDesc` as Annex B NAL
+/// units, so every keyframe is decodable on its own.
+private func appendParameterSets(of fmtDesc: CMFormatDescription, to frame: inout Data) {
+    let isH264 = CMFormatDescriptionGetMediaSubType(fmtDesc) == kCMVideoCodecType_H264
+    func parameterSet(_ index: Int, _ ptr: UnsafeMutablePointer<UnsafePointer<UInt8>?>?,
+                      _ len: UnsafeMutablePointer<Int>?, _ count: UnsafeMutablePointer<Int>?) {
+        if isH264 {
+            CMVideoFormatDescriptionGetH264ParameterSetAtIndex(
+                fmtDesc, parameterSetIndex: index, parameterSetPointerOut: ptr,
+                parameterSetSizeOut: len, parameterSetCountOut: count, nalUnitHeaderLengthOut: nil)
+        } else {
+            CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(
+                fmtDesc, parameterSetIndex: index, parameterSetPointerOut: ptr,
+                parameterSetSizeOut: len, parameterSetCountOut: count, nalUnitHeaderLengthOut: nil)
+        }
+    }
+    var paramCount = 0
+    parameterSet(0, nil, nil, &paramCount)
+    for i in 0..<paramCount {
+        var nalPtr: UnsafePointer<UInt8>? = nil
+        var nalLen = 0
+        parameterSet(i, &nalPtr, &nalLen, nil)
+        if let nalPtr = nalPtr, nalLen > 0 {
+            frame.append(contentsOf: [0x00, 0x00, 0x00, 0x01])
+            frame.append(nalPtr, count: nalLen)
+        }
     }
 }
 
@@ -506,5 +652,6 @@ private func vtOutputCallback(
 ) {
     guard let refCon = outputCallbackRefCon else { return }
     let capture = Unmanaged<ScreenCapture>.fromOpaque(refCon).takeUnretainedValue()
-    capture.handleEncoderOutput(status: status, flags: infoFlags, sampleBuffer: sampleBuffer)
+    capture.handleEncoderOutput(status: status, flags: infoFlags, sampleBuffer: sampleBuffer,
+                                token: Int(bitPattern: sourceFrameRefCon))
 }
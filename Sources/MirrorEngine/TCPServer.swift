@@ -1,10 +1,12 @@
 // TCPServer.swift — Native TCP frame server for Daylight Mirror.
 //
-// Sends H.264 Annex B NAL units to connected Android clients over raw TCP.
+// Sends HEVC or H.264 Annex B NAL units to connected Android clients over raw TCP.
 // Protocol: [DA 7E] [flags] [seq:4 LE] [len:4 LE] [payload]. Also sends
-// resolution and brightness/warmth commands.
+// resolution, codec and brightness/warmth commands, and collects each client's
+// decodable codecs (CMD_CODECS) so ScreenCapture can pick the stream codec.
 
 import Foundation
+import MirrorStats
 import Network
 import QuartzCore
 
@@ -13,7 +15,9 @@ struct LatencyStats {
     var rttMinMs: Double = 0
     var rttMaxMs: Double = 0
     var rttAvgMs: Double = 0
+    var rttP50Ms: Double = 0
     var rttP95Ms: Double = 0
+    var rttP99Ms: Double = 0
     var acksReceived: Int = 0
     var ackRate: Double = 0
 }
@@ -27,6 +31,7 @@ class TCPServer {
     var onClientCountChanged: ((Int) -> Void)?
     var onLatencyStats: ((LatencyStats) -> Void)?
     private(set) var latencyStats: LatencyStats?
+    var stats: StatsRecorder?
     var frameWidth: UInt16 = 1024 {
         didSet {
             lock.lock(); lastKeyframeData = nil; lock.unlock()
@@ -45,19 +50,91 @@ class TCPServer {
     private var lastBrightness: UInt8 = 128
     private var lastWarmth: UInt8 = 128
 
-    private var sendTimestamps: [UInt32: Double] = [:]
+    private let sendTimes = SendTimestamps(capacity: 256)   // rttLock
+    private let backpressure = BDPController(fps: Double(TARGET_FPS))   // rttLock
     private let rttLock = NSLock()
-    private var rttSamples: [Double] = []
-    private let rttWindowSize = 150
+    private var rttWindow = RTTWindow(capacity: 150)
     private var totalAcks: Int = 0
     private var lastAckStatsTime: Double = CACurrentMediaTime()
-    private var _inflightFrames: Int = 0
     private let verboseRTTLogs: Bool = ProcessInfo.processInfo.environment["DAYLIGHT_VERBOSE_RTT"] == "1"
 
+    /// With PHASE_LOCK: the newest receiver's vsync reports steer capture ticks
+    /// (a second display has its own phase).
+    private let phase = PhaseController(fps: Double(TARGET_FPS))   // rttLock
+    private var phaseReceiver: ObjectIdentifier?                   // rttLock
+
+    private var keyframeRequested = false
+
+    // Codec negotiation (rttLock). Clients that never advertise decode HEVC only.
+    private var receiverCodecs: [ObjectIdentifier: [UInt8]] = [:]
+    private var latestCodecAdvert: [UInt8] = []
+    private var awaitingAdvert: [ObjectIdentifier: Double] = [:]   // connect time
+    private let advertGraceSeconds = 0.5
+    private var codecChoiceDirty = false
+    /// Codec of the frames being broadcast; announced to clients on connect.
+    private(set) var streamCodec: UInt8 = CODEC_HEVC
+    /// Clients that advertised FEATURE_FRAME_TIMING (rttLock); the rest get frames
+    /// with the timing block stripped.
+    private var timingReceivers = Set<ObjectIdentifier>()
+
+    /// The codec the stream should switch to, if the set of clients or their
+    /// adverts changed since the last call; nil otherwise or with no clients.
+    /// Picks the most recent advertiser's fastest codec that `encodable` contains
+    /// and every connected client decodes. Thread-safe.
+    func takeCodecChoice(encodable: [UInt8]) -> UInt8? {
+        lock.lock()
+        let ids = connections.map { ObjectIdentifier($0) }
+        lock.unlock()
+        rttLock.lock()
+        defer { rttLock.unlock() }
+        guard codecChoiceDirty, !ids.isEmpty else { return nil }
+        // A client that just connected advertises right away, unless it predates
+        // negotiation; give it a moment so it doesn't force a switch and back.
+        let now = CACurrentMediaTime()
+        if awaitingAdvert.values.contains(where: { now - $0 < advertGraceSeconds }) { return nil }
+        codecChoiceDirty = false
+        var allowed = Set(encodable)
+        for id in ids {
+            allowed.formIntersection(receiverCodecs[id] ?? [CODEC_HEVC])
+        }
+        return pickCodec(ranked: latestCodecAdvert + encodable, allowed: allowed)
+    }
+
+    /// Announce a new stream codec. The cached keyframe belongs to the old codec
+    /// and is dropped; the caller sends a fresh keyframe next.
+    func setStreamCodec(_ codec: UInt8) {
+        lock.lock()
+        streamCodec = codec
+        lastKeyframeData = nil
+        lock.unlock()
+        sendCommand(CMD_CODEC, value: codec)
+        print("[TCP] Stream codec: \(codecName(codec))")
+    }
+
+    /// True once per upstream CMD_REQUEST_KEYFRAME (a receiver joined mid-stream, or
+    /// its decoder watchdog flushed or rebuilt the decoder, and it cannot decode until
+    /// the next IDR) and once per new client. Thread-safe (rttLock); clears the request.
+    func takeKeyframeRequest() -> Bool {
+        rttLock.lock()
+        let val = keyframeRequested
+        keyframeRequested = false
+        rttLock.unlock()
+        return val
+    }
+
     /// Number of frames sent but not yet ACK'd by Android. Thread-safe (reads rttLock).
     var inflightFrames: Int {
         rttLock.lock()
-        let val = _inflightFrames
+        let val = sendTimes.inflight
+        rttLock.unlock()
+        return val
+    }
+
+    /// Whether the next delta frame fits in the bandwidth-delay-product window,
+    /// and that window in frames (for stats). Thread-safe (reads rttLock).
+    func backpressureWindow() -> (allowsFrame: Bool, frames: Int) {
+        rttLock.lock()
+        let val = (backpressure.shouldSend, backpressure.windowFrames)
         rttLock.unlock()
         return val
     }
@@ -88,17 +165,29 @@ class TCPServer {
                     let cachedKeyframe = self.lastKeyframeData
                     self.lock.unlock()
                     self.rttLock.lock()
-                    self._inflightFrames = 0
-                    self.sendTimestamps.removeAll()
+                    self.sendTimes.reset()
+                    self.backpressure.reset()
+                    self.codecChoiceDirty = true
+                    self.awaitingAdvert[ObjectIdentifier(conn)] = CACurrentMediaTime()
+                    // The cached keyframe can be minutes old without periodic IDRs, and
+                    // the frames since are gone: start the new client on a fresh one.
+                    self.keyframeRequested = true
+                    if PHASE_LOCK {
+                        self.phase.reset()
+                        self.phaseReceiver = ObjectIdentifier(conn)
+                    }
                     self.rttLock.unlock()
                     self.onClientCountChanged?(count)
 
-                    // Tell client our frame dimensions and display state before sending frames
+                    // Tell client our frame dimensions, codec and display state before sending frames
                     self.sendResolution(to: conn)
+                    self.sendCodec(to: conn)
                     self.sendDisplayState(to: conn)
+                    if PHASE_LOCK { self.sendVsyncReports(to: conn) }
 
                     if let kf = cachedKeyframe {
-                        conn.send(content: kf, completion: .contentProcessed { _ in })
+                        // Not advertised anything yet: no timing block.
+                        self.send(kf, to: conn, withTiming: false)
                         print("[TCP] Sent cached keyframe (\(kf.count) bytes)")
                     } else {
                         print("[TCP] No cached keyframe yet — client will get next broadcast keyframe")
@@ -110,6 +199,16 @@ class TCPServer {
                     self.connections.removeAll { $0 === conn }
                     let count = self.connections.count
                     self.lock.unlock()
+                    self.rttLock.lock()
+                    self.receiverCodecs.removeValue(forKey: ObjectIdentifier(conn))
+                    self.timingReceivers.remove(ObjectIdentifier(conn))
+                    self.awaitingAdvert.removeValue(forKey: ObjectIdentifier(conn))
+                    self.codecChoiceDirty = true
+                    if self.phaseReceiver == ObjectIdentifier(conn) {
+                        self.phaseReceiver = nil
+                        self.phase.reset()
+                    }
+                    self.rttLock.unlock()
                     self.onClientCountChanged?(count)
                     print("[TCP] Client disconnected (\(state))")
                 default: break
@@ -133,92 +232,118 @@ class TCPServer {
         conn.receive(minimumIncompleteLength: 1, maximumLength: 65536) { [weak self] data, _, _, error in
             guard let self = self, error == nil, let data = data else { return }
             self.rttLock.lock()
-            self.parseAckData(data)
+            let stats = self.parseAckData(data, from: conn)
             self.rttLock.unlock()
+            // Outside rttLock: broadcast() and inflightFrames must not wait on observers.
+            if let stats = stats { self.onLatencyStats?(stats) }
             self.receiveLoop(conn)
         }
     }
 
-    private var ackParseBuffer = Data()
-
-    /// Must be called with rttLock held.
-    private func parseAckData(_ data: Data) {
-        ackParseBuffer.append(data)
-
-        var scanned = 0
-        while ackParseBuffer.count >= 6 {
-            guard ackParseBuffer[ackParseBuffer.startIndex] == MAGIC_ACK[0]
-                    && ackParseBuffer[ackParseBuffer.index(ackParseBuffer.startIndex, offsetBy: 1)] == MAGIC_ACK[1] else {
-                ackParseBuffer.removeFirst()
-                scanned += 1
-                if scanned > 256 {
-                    ackParseBuffer.removeAll()
-                    return
+    private var upstream = UpstreamParser()
+
+    /// Must be called with rttLock held. Returns the stats after the last ACK in
+    /// `data`, or nil if it held none.
+    private func parseAckData(_ data: Data, from conn: NWConnection) -> LatencyStats? {
+        var latest: LatencyStats?
+        upstream.feed(data) { packet in
+            switch packet {
+            case .command(let cmd, let value):
+                handleUpstreamCommand(cmd, value: value, from: conn)
+            case .ack(let seq):
+                if let stats = recordAck(seq) { latest = stats }
+            case .vsyncReport(let seq, let arrivalToLatchUs, let slackUs, let periodUs):
+                guard phaseReceiver == ObjectIdentifier(conn) else { break }
+                let wasLocked = phase.isLocked
+                phase.report(seq, arrivalToLatchUs: arrivalToLatchUs, slackUs: slackUs, periodUs: periodUs,
+                             oneWay: backpressure.minRTTMs / 2000)
+                if phase.isLocked && !wasLocked {
+                    print(String(format: "[TCP] Capture locked to receiver vsync: period %.3fms, capture→ready %.1fms",
+                                 phase.periodMs, phase.delayMs))
                 }
-                continue
             }
+        }
+        return latest
+    }
 
-            let base = ackParseBuffer.startIndex
-            let b0 = UInt32(ackParseBuffer[ackParseBuffer.index(base, offsetBy: 2)])
-            let b1 = UInt32(ackParseBuffer[ackParseBuffer.index(base, offsetBy: 3)]) << 8
-            let b2 = UInt32(ackParseBuffer[ackParseBuffer.index(base, offsetBy: 4)]) << 16
-            let b3 = UInt32(ackParseBuffer[ackParseBuffer.index(base, offsetBy: 5)]) << 24
-            let seq = b0 | b1 | b2 | b3
-            ackParseBuffer.removeFirst(6)
-
-            let now = CACurrentMediaTime()
-
-            guard let sendTime = sendTimestamps.removeValue(forKey: seq) else {
-                continue
-            }
-            _inflightFrames -= 1
-            if _inflightFrames < 0 { _inflightFrames = 0 }
-            let rtt = (now - sendTime) * 1000.0
-            rttSamples.append(rtt)
-            if rttSamples.count > rttWindowSize {
-                rttSamples.removeFirst(rttSamples.count - rttWindowSize)
-            }
-            totalAcks += 1
-
-            let sorted = rttSamples.sorted()
-            let avg = sorted.reduce(0, +) / Double(sorted.count)
-            let p95Index = min(Int(Double(sorted.count) * 0.95), sorted.count - 1)
-
-            let elapsed = now - lastAckStatsTime
-            let rate = elapsed > 0 ? Double(totalAcks) / elapsed : 0
-
-            let stats = LatencyStats(
-                rttMs: rtt,
-                rttMinMs: sorted.first ?? 0,
-                rttMaxMs: sorted.last ?? 0,
-                rttAvgMs: avg,
-                rttP95Ms: sorted[p95Index],
-                acksReceived: totalAcks,
-                ackRate: rate
-            )
-
-            if verboseRTTLogs && totalAcks % 30 == 0 {
-                print(String(format: "[RTT] last: %.1fms | avg: %.1fms | p95: %.1fms | min: %.1fms | max: %.1fms | acks: %d",
-                             stats.rttMs, stats.rttAvgMs, stats.rttP95Ms, stats.rttMinMs, stats.rttMaxMs, stats.acksReceived))
+    /// Must be called with rttLock held.
+    private func handleUpstreamCommand(_ cmd: UInt8, value: UInt8, from conn: NWConnection) {
+        if cmd == CMD_REQUEST_KEYFRAME {
+            if !keyframeRequested { print("[TCP] Receiver requested a keyframe") }
+            stats?.recordKeyframeRequest()
+            keyframeRequested = true
+        } else if cmd == CMD_CODECS {
+            let codecs = unpackCodecList(value)
+            receiverCodecs[ObjectIdentifier(conn)] = codecs
+            awaitingAdvert.removeValue(forKey: ObjectIdentifier(conn))
+            latestCodecAdvert = codecs
+            codecChoiceDirty = true
+            print("[TCP] Receiver decodes: \(codecs.map(codecName).joined(separator: ", "))")
+        } else if cmd == CMD_FEATURES {
+            if value & FEATURE_FRAME_TIMING != 0 {
+                timingReceivers.insert(ObjectIdentifier(conn))
+            } else {
+                timingReceivers.remove(ObjectIdentifier(conn))
             }
+        }
+    }
 
-            latencyStats = stats
-            onLatencyStats?(stats)
+    /// Must be called with rttLock held. O(1): no sorting, no allocation.
+    private func recordAck(_ seq: UInt32) -> LatencyStats? {
+        let now = CACurrentMediaTime()
+        backpressure.ack(seq, at: now)
+        guard let sendTime = sendTimes.ack(seq) else { return nil }
+        let rtt = (now - sendTime) * 1000.0
+        rttWindow.add(rtt)
+        totalAcks += 1
+        stats?.recordAck(rttMs: rtt)
+
+        let elapsed = now - lastAckStatsTime
+        let rate = elapsed > 0 ? Double(totalAcks) / elapsed : 0
+
+        let stats = LatencyStats(
+            rttMs: rtt,
+            rttMinMs: rttWindow.min,
+            rttMaxMs: rttWindow.max,
+            rttAvgMs: rttWindow.average,
+            rttP50Ms: rttWindow.quantile(0.5),
+            rttP95Ms: rttWindow.quantile(0.95),
+            rttP99Ms: rttWindow.quantile(0.99),
+            acksReceived: totalAcks,
+            ackRate: rate
+        )
+
+        if verboseRTTLogs && totalAcks % 30 == 0 {
+            print(String(format: "[RTT] last: %.1fms | avg: %.1fms | p95: %.1fms | min: %.1fms | max: %.1fms | acks: %d",
+                         stats.rttMs, stats.rttAvgMs, stats.rttP95Ms, stats.rttMinMs, stats.rttMaxMs, stats.acksReceived))
         }
+
+        latencyStats = stats
+        return stats
     }
 
     func broadcast(payload: Data, isKeyframe: Bool, sequenceNumber: UInt32 = 0) {
-        var header = Data(capacity: FRAME_HEADER_SIZE)
-        header.append(contentsOf: MAGIC_FRAME)
-        header.append(isKeyframe ? FLAG_KEYFRAME : 0)
-        var seq = sequenceNumber.littleEndian
-        header.append(Data(bytes: &seq, count: 4))
-        var len = UInt32(payload.count).littleEndian
-        header.append(Data(bytes: &len, count: 4))
-
-        var frame = header
+        var frame = Data(capacity: FRAME_HEADER_SIZE + payload.count)
+        frame.append(contentsOf: [UInt8](repeating: 0, count: FRAME_HEADER_SIZE))
         frame.append(payload)
+        writeFrameHeader(into: &frame, isKeyframe: isKeyframe, sequenceNumber: sequenceNumber)
+        broadcast(frame: frame, isKeyframe: isKeyframe, sequenceNumber: sequenceNumber)
+    }
+
+    /// The capture tick after `lastTick` (CACurrentMediaTime seconds) that puts
+    /// the frame just ahead of the receiver's latch, or nil while phase lock is
+    /// off or not yet locked. Thread-safe (rttLock).
+    func nextCaptureTick(after lastTick: Double) -> Double? {
+        guard PHASE_LOCK else { return nil }
+        rttLock.lock()
+        defer { rttLock.unlock() }
+        return phase.nextTick(after: lastTick)
+    }
 
+    /// Send a complete frame (header already written, see `writeFrameHeader`).
+    /// The same buffer is cached and handed to every connection — no copies.
+    /// `capturedAt` (CACurrentMediaTime seconds) feeds the phase lock.
+    func broadcast(frame: Data, isKeyframe: Bool, sequenceNumber: UInt32, capturedAt: Double? = nil) {
         let sendTime = CACurrentMediaTime()
 
         lock.lock()
@@ -227,19 +352,31 @@ class TCPServer {
         lock.unlock()
 
         rttLock.lock()
-        sendTimestamps[sequenceNumber] = sendTime
-        _inflightFrames += 1
-        // Evict old entries to prevent unbounded growth
-        if sendTimestamps.count > 300 {
-            let evicted = sendTimestamps.count
-            let cutoff = sequenceNumber &- 300
-            sendTimestamps = sendTimestamps.filter { $0.key > cutoff }
-            _inflightFrames -= (evicted - sendTimestamps.count)
-            if _inflightFrames < 0 { _inflightFrames = 0 }
+        // Reusing a slot evicts whatever was there; no sweep needed.
+        sendTimes.record(sequenceNumber, at: sendTime)
+        backpressure.recordSend(sequenceNumber, bytes: frame.count - FRAME_HEADER_SIZE,
+                                isKeyframe: isKeyframe, at: sendTime)
+        if PHASE_LOCK, let capturedAt = capturedAt {
+            phase.recordSend(sequenceNumber, capturedAt: capturedAt, sentAt: sendTime)
         }
+        let timing = conns.map { timingReceivers.contains(ObjectIdentifier($0)) }
         rttLock.unlock()
+        stats?.recordSent(bytes: frame.count - FRAME_HEADER_SIZE, keyframe: isKeyframe)
 
-        for conn in conns {
+        for (conn, withTiming) in zip(conns, timing) {
+            send(frame, to: conn, withTiming: withTiming)
+        }
+    }
+
+    /// Send a complete frame, dropping its timing block (if any) for clients
+    /// that did not advertise FEATURE_FRAME_TIMING.
+    private func send(_ frame: Data, to conn: NWConnection, withTiming: Bool) {
+        if !withTiming, let stripped = frameWithoutTiming(frame) {
+            conn.batch {
+                conn.send(content: stripped.header, completion: .contentProcessed { _ in })
+                conn.send(content: stripped.payload, completion: .contentProcessed { _ in })
+            }
+        } else {
             conn.send(content: frame, completion: .contentProcessed { _ in })
         }
     }
@@ -284,6 +421,28 @@ class TCPServer {
         print("[TCP] Sent brightness: \(self.lastBrightness)")
     }
 
+    /// Ask a client for vsync reports: [DA 7F] [09] [1]. Receivers that predate
+    /// them ignore the command.
+    func sendVsyncReports(to conn: NWConnection) {
+        var packet = Data(capacity: 4)
+        packet.append(contentsOf: MAGIC_CMD)
+        packet.append(CMD_VSYNC_REPORTS)
+        packet.append(1)
+        conn.send(content: packet, completion: .contentProcessed { _ in })
+    }
+
+    /// Send the stream codec to a specific client: [DA 7F] [07] [codec]
+    func sendCodec(to conn: NWConnection) {
+        lock.lock()
+        let codec = streamCodec
+        lock.unlock()
+        var packet = Data(capacity: 4)
+        packet.append(contentsOf: MAGIC_CMD)
+        packet.append(CMD_CODEC)
+        packet.append(codec)
+        conn.send(content: packet, completion: .contentProcessed { _ in })
+    }
+
     /// Send resolution command to a specific client: [DA 7F] [04] [w:2 LE] [h:2 LE]
     func sendResolution(to conn: NWConnection) {
         var packet = Data(capacity: 7)
@@ -1,13 +1,20 @@
-// USBDeviceMonitor.swift — USB device detection via ADB polling.
+// USBDeviceMonitor.swift — USB device detection via adb device tracking.
 //
-// Polls `adb devices` every 2 seconds to detect USB connect/disconnect.
+// Subscribes to the adb server's host:track-devices stream (adb_tracker in
+// CSenderCore/adb_client.h), which pushes the device list whenever it changes, so
+// connects and disconnects arrive as the server sees them rather than on a poll.
+// The tracker reconnects when the adb server restarts and only reports the
+// device gone if the server stays away for a few seconds; after that it runs
+// `adb start-server` (ADBBridge.ensureServerRunning) every couple of seconds
+// until one comes back, so `adb kill-server` does not lose the device for good.
 // Calls onDeviceConnected/onDeviceDisconnected on the main queue when state changes.
 // Used by MirrorEngine for auto-start/stop based on DC-1 presence.
 
 import Foundation
+import CSenderCore
 
 class USBDeviceMonitor {
-    private var timer: DispatchSourceTimer?
+    private var tracker: UnsafeMutablePointer<adb_tracker>?
     private var wasConnected = false
     var onDeviceConnected: (() -> Void)?
     var onDeviceDisconnected: (() -> Void)?
@@ -17,30 +24,45 @@ class USBDeviceMonitor {
             print("[USB] No adb available — device monitoring disabled")
             return
         }
-        let t = DispatchSource.makeTimerSource(queue: .global(qos: .utility))
-        t.schedule(deadline: .now(), repeating: .seconds(2))
-        t.setEventHandler { [weak self] in
-            guard let self = self else { return }
-            let connected = ADBBridge.connectedDevice() != nil
-            if connected && !self.wasConnected {
-                self.wasConnected = true
-                print("[USB] Device connected")
-                DispatchQueue.main.async { self.onDeviceConnected?() }
-            } else if !connected && self.wasConnected {
-                self.wasConnected = false
-                print("[USB] Device disconnected")
-                DispatchQueue.main.async { self.onDeviceDisconnected?() }
-            }
+        guard tracker == nil else { return }
+        let t = UnsafeMutablePointer<adb_tracker>.allocate(capacity: 1)
+        adb_tracker_init(t, ADBBridge.serverPort, { ctx, serial in
+            guard let ctx = ctx else { return }
+            let monitor = Unmanaged<USBDeviceMonitor>.fromOpaque(ctx).takeUnretainedValue()
+            monitor.deviceChanged(serial.map { String(cString: $0) })
+        }, Unmanaged.passUnretained(self).toOpaque())
+        t.pointee.start_server = { _ in _ = ADBBridge.ensureServerRunning() }
+        guard adb_tracker_start(t) == 0 else {
+            t.deallocate()
+            print("[USB] Could not start the device tracker — device monitoring disabled")
+            return
         }
-        t.resume()
-        timer = t
-        print("[USB] Device monitoring started (polling adb every 2s)")
+        tracker = t
+        print("[USB] Device monitoring started (adb host:track-devices)")
     }
 
     func stop() {
-        timer?.cancel()
-        timer = nil
+        guard let t = tracker else { return }
+        adb_tracker_stop(t)
+        t.deallocate()
+        tracker = nil
     }
 
+    deinit { stop() }
+
     var isDeviceConnected: Bool { wasConnected }
+
+    /// Called on the tracker thread when the ready device changes.
+    private func deviceChanged(_ serial: String?) {
+        let connected = serial != nil
+        if connected && !wasConnected {
+            wasConnected = true
+            print("[USB] Device connected (\(serial ?? ""))")
+            DispatchQueue.main.async { self.onDeviceConnected?() }
+        } else if !connected && wasConnected {
+            wasConnected = false
+            print("[USB] Device disconnected")
+            DispatchQueue.main.async { self.onDeviceDisconnected?() }
+        }
+    }
 }
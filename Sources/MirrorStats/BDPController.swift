@@ -0,0 +1,53 @@
+// BDPController.swift — Swift face of bdp_ctl.c, the frame backpressure window.
+//
+// Estimates delivery rate and base RTT from ACKs and allows as many frames
+// inflight as the bandwidth-delay product holds (see bdp_ctl.h). The Linux
+// sender runs the same C unit, and host/tools/mirror_linksim compares it with
+// the old RTT-threshold rule on modelled USB links.
+
+import CSenderCore
+
+/// Not thread-safe; callers serialize.
+public final class BDPController {
+    private var ctl = bdp_ctl()
+
+    /// `fps` is the capture rate; the window never drops below what an empty
+    /// pipeline holds at that rate.
+    public init(fps: Double = 120) {
+        var cfg = bdp_config()
+        bdp_config_default(&cfg)
+        cfg.fps = fps
+        precondition(bdp_ctl_init(&ctl, &cfg) == 0, "bdp_ctl allocation failed")
+    }
+
+    deinit {
+        bdp_ctl_free(&ctl)
+    }
+
+    /// True if a delta frame of typical size fits in the window now.
+    public var shouldSend: Bool { bdp_ctl_should_send(&ctl) != 0 }
+    /// The window in typical frames.
+    public var windowFrames: Int { Int(bdp_ctl_window_frames(&ctl)) }
+    public var inflight: Int { Int(bdp_ctl_inflight(&ctl)) }
+    /// Delivery rate estimate in bytes/s; 0 before the first ACK.
+    public var bandwidth: Double { bdp_ctl_bandwidth(&ctl) }
+    /// Base RTT estimate in ms; 0 before the first ACK.
+    public var minRTTMs: Double { Double(bdp_ctl_min_rtt_us(&ctl)) / 1000 }
+
+    /// Frame `seq` with `bytes` of payload went out at `time` (seconds).
+    public func recordSend(_ seq: UInt32, bytes: Int, isKeyframe: Bool, at time: Double) {
+        bdp_ctl_on_send(&ctl, seq, UInt32(clamping: bytes), isKeyframe ? 1 : 0, Int64((time * 1e6).rounded()))
+    }
+
+    /// ACK for `seq` at `time` (seconds). False for duplicate, expired or
+    /// pre-reset ACKs.
+    @discardableResult
+    public func ack(_ seq: UInt32, at time: Double) -> Bool {
+        bdp_ctl_on_ack(&ctl, seq, Int64((time * 1e6).rounded())) != 0
+    }
+
+    /// Forget inflight frames (a client connected); the estimates are kept.
+    public func reset() {
+        bdp_ctl_reset(&ctl)
+    }
+}
@@ -0,0 +1,94 @@
+// EncoderTimeline.swift — Per-frame latency attribution for the async encoder.
+//
+// VTCompressionSessionEncodeFrame returns once the frame is queued; the encoded
+// frame arrives later on the encoder's thread, so timing the call says nothing
+// about encode latency. ScreenCapture records each frame's capture and submit
+// times here and passes the returned token through sourceFrameRefcon; the
+// output callback completes the token. The encoder works on one frame at a
+// time, so a frame submitted while the previous one was still encoding starts
+// when that one comes out:
+//
+//   start        = max(submit, previous output)
+//   queue wait   = start - submit
+//   encode       = output - start
+//   capture → encoded = output - capture
+//
+// Slots are token & mask of a power-of-two ring (as in send_ring.c): submit
+// and complete are one slot access, and a token whose slot was reused (or
+// never recorded) completes as nil instead of mis-attributing.
+
+import Foundation
+
+public struct EncodeAttribution: Equatable {
+    public var captureToSubmitMs: Double    // image processing and backpressure checks
+    public var queueMs: Double              // waiting behind earlier frames in the encoder
+    public var encodeMs: Double
+
+    public init(captureToSubmitMs: Double, queueMs: Double, encodeMs: Double) {
+        self.captureToSubmitMs = captureToSubmitMs
+        self.queueMs = queueMs
+        self.encodeMs = encodeMs
+    }
+
+    public var captureToEncodedMs: Double { captureToSubmitMs + queueMs + encodeMs }
+}
+
+/// Not thread-safe; callers serialize.
+public struct EncoderTimeline {
+    private var tokens: [Int]
+    private var capturedAt: [Double]
+    private var submittedAt: [Double]
+    private let mask: Int
+    private var lastOutput: Double = 0
+    private var nextToken = 1
+    /// Completions with no matching submission (slot reused or unknown token).
+    public private(set) var unmatched: UInt64 = 0
+
+    /// Rounded up to a power of two; must exceed the frames the encoder holds.
+    public init(capacity: Int = 64) {
+        var size = 1
+        while size < max(capacity, 2) { size <<= 1 }
+        tokens = [Int](repeating: 0, count: size)
+        capturedAt = [Double](repeating: 0, count: size)
+        submittedAt = [Double](repeating: 0, count: size)
+        mask = size - 1
+    }
+
+    public var capacity: Int { mask + 1 }
+
+    /// A frame captured at `capture` goes to the encoder at `submit` (seconds).
+    /// Returns its token, never 0, so it fits a non-nil sourceFrameRefcon.
+    public mutating func submit(capturedAt capture: Double, submittedAt submit: Double) -> Int {
+        let token = nextToken
+        nextToken = nextToken == Int.max ? 1 : nextToken + 1
+        let slot = token & mask
+        tokens[slot] = token
+        capturedAt[slot] = capture
+        submittedAt[slot] = submit
+        return token
+    }
+
+    /// The encoder returned frame `token` at `time`, encoded or dropped.
+    /// Either way it occupied the encoder, so later frames queue behind it.
+    public mutating func complete(_ token: Int, at time: Double) -> EncodeAttribution? {
+        let slot = token & mask
+        guard token != 0, tokens[slot] == token else {
+            unmatched += 1
+            return nil
+        }
+        tokens[slot] = 0
+        let submit = submittedAt[slot]
+        let start = max(submit, lastOutput)
+        lastOutput = max(lastOutput, time)
+        return EncodeAttribution(captureToSubmitMs: max(0, submit - capturedAt[slot]) * 1000,
+                                 queueMs: max(0, start - submit) * 1000,
+                                 encodeMs: max(0, time - start) * 1000)
+    }
+
+    /// A new encoder session: nothing is queued ahead of the next frame.
+    /// Tokens keep counting, so late completions from the old session miss.
+    public mutating func reset() {
+        for i in tokens.indices { tokens[i] = 0 }
+        lastOutput = 0
+    }
+}
@@ -0,0 +1,91 @@
+// FrameChangeFilter.swift — Skip encoding frames whose only change is the pacer.
+//
+// CompositorPacer toggles a small window at TARGET_FPS so CGDisplayStream keeps
+// delivering frames, which means every delivered frame is "dirty" even on a
+// static screen. Each CGDisplayStream update carries the rects that changed
+// since the previous one; if all of them lie inside ignored regions (the
+// pacer's), the frame is identical to the last one as far as the receiver is
+// concerned and can skip image processing and encoding.
+//
+// Two things keep that safe:
+//   - a real change that was not encoded (backpressure dropped it) stays
+//     pending until an encode actually happens, since later updates only
+//     report what changed after it;
+//   - after `keepaliveInterval` unchanged frames one is encoded anyway, so
+//     ACKs, RTT stats and the receiver's decoder watchdog keep ticking.
+
+import Foundation
+
+/// A rect in display-stream pixel coordinates (origin top-left).
+public struct DirtyRect: Equatable {
+    public var x: Double
+    public var y: Double
+    public var width: Double
+    public var height: Double
+
+    public init(x: Double, y: Double, width: Double, height: Double) {
+        self.x = x
+        self.y = y
+        self.width = width
+        self.height = height
+    }
+
+    public var isEmpty: Bool { width <= 0 || height <= 0 }
+
+    public func contains(_ r: DirtyRect) -> Bool {
+        r.x >= x && r.y >= y && r.x + r.width <= x + width && r.y + r.height <= y + height
+    }
+}
+
+public struct FrameChangeFilter {
+    public enum Decision: Equatable {
+        case encode      // something changed (or the change is unknown)
+        case keepalive   // nothing changed for keepaliveInterval frames
+        case skip        // only ignored regions changed
+    }
+
+    public let ignored: [DirtyRect]
+    public let keepaliveInterval: Int
+    public private(set) var unchangedRun = 0
+    public private(set) var skipped: UInt64 = 0
+    public private(set) var keepalives: UInt64 = 0
+    private var pendingChange = true   // nothing has been encoded yet
+
+    public init(ignoring ignored: [DirtyRect], keepaliveInterval: Int) {
+        self.ignored = ignored
+        self.keepaliveInterval = max(1, keepaliveInterval)
+    }
+
+    /// The pacer window: `dirtySize` points square at the top-left of the
+    /// display, in pixels at `scale`, grown by `padding` pixels for rounding.
+    public static func pacerRegion(dirtySize: Double, scale: Double, padding: Double = 2) -> DirtyRect {
+        let side = dirtySize * max(scale, 1) + padding
+        return DirtyRect(x: 0, y: 0, width: side, height: side)
+    }
+
+    /// True if `rects` contains anything outside the ignored regions.
+    public func hasVisibleChange(_ rects: [DirtyRect]) -> Bool {
+        rects.contains { r in !r.isEmpty && !ignored.contains { $0.contains(r) } }
+    }
+
+    /// Decide for one delivered frame. `dirtyRects` is nil when the stream did
+    /// not say what changed; `force` is set for keyframes, which always encode.
+    /// Call `encoded()` once the frame has actually gone to the encoder.
+    public mutating func decide(dirtyRects: [DirtyRect]?, force: Bool = false) -> Decision {
+        if dirtyRects.map(hasVisibleChange) ?? true { pendingChange = true }
+        if force || pendingChange { return .encode }
+        unchangedRun += 1
+        if unchangedRun >= keepaliveInterval {
+            keepalives += 1
+            return .keepalive
+        }
+        skipped += 1
+        return .skip
+    }
+
+    /// The frame from the last `decide` was submitted to the encoder.
+    public mutating func encoded() {
+        pendingChange = false
+        unchangedRun = 0
+    }
+}
@@ -0,0 +1,113 @@
+// LatencyHistogram.swift — Log-bucketed latency histogram with removal.
+//
+// Buckets are 1/16 of an octave wide from 0.125 ms to 8 s, so any quantile read
+// back is within ~4.5% of the exact sample value, and adding, removing or
+// reading costs the same whatever the number of samples. RTTWindow keeps one in
+// step with its ring so quantiles follow the sliding window; StatsRecorder keeps
+// cumulative ones whose differences SUBSCRIBE streams as sparse snapshots.
+
+import Foundation
+
+public struct LatencyHistogram: Equatable {
+    /// Buckets per octave (power of two).
+    public static let bucketsPerOctave = 16
+    /// Lower bound of bucket 1; bucket 0 holds everything below it.
+    public static let lowestMs = 0.125
+    /// Octaves above lowestMs; the last bucket also holds everything above 8 s.
+    public static let octaves = 16
+    public static let bucketCount = octaves * bucketsPerOctave + 1
+
+    public private(set) var counts: [Int32]
+    public private(set) var total: Int = 0
+
+    public init() {
+        counts = [Int32](repeating: 0, count: LatencyHistogram.bucketCount)
+    }
+
+    /// Bucket holding `ms`.
+    public static func bucket(for ms: Double) -> Int {
+        guard ms >= lowestMs else { return 0 }
+        let position = log2(ms / lowestMs) * Double(bucketsPerOctave)
+        return Swift.min(Int(position) + 1, bucketCount - 1)
+    }
+
+    /// Smallest value that lands in `bucket` (0 for the underflow bucket).
+    public static func lowerBound(of bucket: Int) -> Double {
+        guard bucket > 0 else { return 0 }
+        return lowestMs * exp2(Double(bucket - 1) / Double(bucketsPerOctave))
+    }
+
+    public mutating func add(_ ms: Double) {
+        counts[LatencyHistogram.bucket(for: ms)] += 1
+        total += 1
+    }
+
+    /// Remove a value previously added (the bucket is recomputed from it).
+    public mutating func remove(_ ms: Double) {
+        let b = LatencyHistogram.bucket(for: ms)
+        guard counts[b] > 0 else { return }
+        counts[b] -= 1
+        total -= 1
+    }
+
+    public mutating func reset() {
+        for i in counts.indices { counts[i] = 0 }
+        total = 0
+    }
+
+    /// Add every sample of `other`.
+    public mutating func merge(_ other: LatencyHistogram) {
+        for b in counts.indices { counts[b] += other.counts[b] }
+        total += other.total
+    }
+
+    /// Samples added since `earlier`, a previous copy of this histogram (only adds
+    /// in between, so no bucket goes negative).
+    public func subtracting(_ earlier: LatencyHistogram) -> LatencyHistogram {
+        var delta = self
+        for b in counts.indices { delta.counts[b] -= earlier.counts[b] }
+        delta.total -= earlier.total
+        return delta
+    }
+
+    /// Non-empty buckets as comma-separated `bucket:count` pairs, "-" when empty.
+    public var sparseDescription: String {
+        guard total > 0 else { return "-" }
+        var pairs: [String] = []
+        for b in counts.indices where counts[b] != 0 { pairs.append("\(b):\(counts[b])") }
+        return pairs.joined(separator: ",")
+    }
+
+    /// Parses `sparseDescription`. nil on a malformed pair or out-of-range bucket.
+    public init?(sparse: String) {
+        self.init()
+        guard sparse != "-" else { return }
+        for pair in sparse.split(separator: ",") {
+            let parts = pair.split(separator: ":")
+            guard parts.count == 2, let b = Int(parts[0]), let n = Int32(parts[1]),
+                  b >= 0, b < LatencyHistogram.bucketCount, n >= 0 else { return nil }
+            counts[b] += n
+            total += Int(n)
+        }
+    }
+
+    /// Value of the sample at index `Int(total * q)` of the sorted samples (the
+    /// same rank the sort-based p95 used), interpolated inside its bucket.
+    /// 0 when empty.
+    public func quantile(_ q: Double) -> Double {
+        guard total > 0 else { return 0 }
+        let rank = Swift.min(Swift.max(Int(Double(total) * q), 0), total - 1)
+        var seen = 0
+        for b in 0..<counts.count where counts[b] > 0 {
+            let n = Int(counts[b])
+            if seen + n > rank {
+                let lo = LatencyHistogram.lowerBound(of: b)
+                let hi = b + 1 < LatencyHistogram.bucketCount ? LatencyHistogram.lowerBound(of: b + 1) : lo * 2
+                let within = (Double(rank - seen) + 0.5) / Double(n)
+                return lo + (hi - lo) * within
+            }
+            seen += n
+        }
+        return LatencyHistogram.lowerBound(of: LatencyHistogram.bucketCount - 1)
+    }
+}
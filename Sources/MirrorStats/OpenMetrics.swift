@@ -0,0 +1,166 @@
+// OpenMetrics.swift — OpenMetrics text exposition of the engine's counters.
+//
+// MetricsServer (opt-in, DAYLIGHT_METRICS_PORT) serves this at /metrics for
+// Prometheus and friends. Counters and the RTT / processing histograms come from
+// StatsRecorder's cumulative snapshot, so scrapers compute rates and quantiles
+// over their own windows; MetricsGauges carries the point-in-time values the
+// engine already tracks (fps, inflight, the recent RTT window's quantiles).
+//
+// Histograms are exported in seconds at half-octave resolution (every 8th
+// LatencyHistogram bucket boundary, ~33 series) rather than all 257 buckets.
+
+import Foundation
+
+/// Values sampled at scrape time rather than counted.
+public struct MetricsGauges: Equatable {
+    public var running = false
+    public var clients = 0
+    public var fps: Double = 0
+    public var inflightFrames = 0
+    public var backpressureWindowFrames = 0
+    public var processAvgMs: Double = 0     // 5 s averages, as in `latency`
+    public var encodeAvgMs: Double = 0
+    public var rttP50Ms: Double = 0         // recent RTT window (last 150 ACKs)
+    public var rttP95Ms: Double = 0
+    public var rttP99Ms: Double = 0
+
+    public init() {}
+}
+
+/// Builds one exposition: metric families in order, then `# EOF`.
+public struct OpenMetricsWriter {
+    public private(set) var text = ""
+
+    public init() {}
+
+    public mutating func counter(_ name: String, help: String, unit: String? = nil,
+                                 _ samples: [(labels: [(String, String)], value: UInt64)]) {
+        family(name, type: "counter", help: help, unit: unit)
+        for s in samples { sample(name + "_total", s.labels, String(s.value)) }
+    }
+
+    public mutating func counter(_ name: String, help: String, unit: String? = nil, value: UInt64) {
+        counter(name, help: help, unit: unit, [(labels: [], value: value)])
+    }
+
+    public mutating func gauge(_ name: String, help: String, unit: String? = nil, value: Double) {
+        family(name, type: "gauge", help: help, unit: unit)
+        sample(name, [], Self.format(value))
+    }
+
+    /// Quantiles only (no count or sum): a view of a sliding window.
+    public mutating func summary(_ name: String, help: String, unit: String? = nil,
+                                 quantiles: [(q: Double, value: Double)]) {
+        family(name, type: "summary", help: help, unit: unit)
+        for (q, value) in quantiles { sample(name, [("quantile", Self.format(q))], Self.format(value)) }
+    }
+
+    /// `histogram` (milliseconds) in seconds, cumulative buckets every `step`
+    /// LatencyHistogram boundaries plus +Inf.
+    public mutating func histogram(_ name: String, help: String, _ histogram: LatencyHistogram,
+                                   sumMs: Double, step: Int = LatencyHistogram.bucketsPerOctave / 2) {
+        family(name, type: "histogram", help: help, unit: "seconds")
+        var cumulative = 0
+        var next = 0
+        for boundary in stride(from: 1, to: LatencyHistogram.bucketCount, by: max(step, 1)) {
+            while next < boundary {
+                cumulative += Int(histogram.counts[next])
+                next += 1
+            }
+            let le = LatencyHistogram.lowerBound(of: boundary) / 1000
+            sample(name + "_bucket", [("le", Self.format(le))], String(cumulative))
+        }
+        sample(name + "_bucket", [("le", "+Inf")], String(histogram.total))
+        sample(name + "_count", [], String(histogram.total))
+        sample(name + "_sum", [], Self.format(sumMs / 1000))
+    }
+
+    /// The finished exposition.
+    public var finished: String { text + "# EOF\n" }
+
+    private mutating func family(_ name: String, type: String, help: String, unit: String?) {
+        text += "# TYPE \(name) \(type)\n"
+        if let unit = unit { text += "# UNIT \(name) \(unit)\n" }
+        text += "# HELP \(name) \(Self.escape(help))\n"
+    }
+
+    private mutating func sample(_ name: String, _ labels: [(String, String)], _ value: String) {
+        text += name
+        if !labels.isEmpty {
+            text += "{" + labels.map { "\($0.0)=\"\(Self.escape($0.1))\"" }.joined(separator: ",") + "}"
+        }
+        text += " \(value)\n"
+    }
+
+    static func format(_ value: Double) -> String {
+        if value.isNaN { return "NaN" }
+        if value.isInfinite { return value > 0 ? "+Inf" : "-Inf" }
+        return "\(value)"
+    }
+
+    /// HELP text and label values share OpenMetrics' escaping.
+    static func escape(_ s: String) -> String {
+        var out = ""
+        for c in s {
+            switch c {
+            case "\\": out += "\\\\"
+            case "\n": out += "\\n"
+            case "\"": out += "\\\""
+            default: out.append(c)
+            }
+        }
+        return out
+    }
+}
+
+public enum OpenMetrics {
+    public static let contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8"
+    public static let prefix = "daylight_mirror_"
+
+    /// The engine's metrics: `totals` since launch plus `gauges` sampled now.
+    public static func exposition(_ totals: StatsSnapshot, _ gauges: MetricsGauges) -> String {
+        var w = OpenMetricsWriter()
+        let p = prefix
+
+        w.gauge(p + "running", help: "1 while mirroring.", value: gauges.running ? 1 : 0)
+        w.gauge(p + "clients", help: "Connected receivers.", value: Double(gauges.clients))
+        w.gauge(p + "fps", help: "Frames encoded per second (5 s average).", value: gauges.fps)
+        w.gauge(p + "inflight_frames", help: "Frames sent and not yet acknowledged.",
+                value: Double(gauges.inflightFrames))
+        w.gauge(p + "backpressure_window_frames", help: "Frames the backpressure window allows in flight.",
+                value: Double(gauges.backpressureWindowFrames))
+
+        w.counter(p + "frames_captured", help: "Frames delivered by the display stream.", value: totals.captured)
+        w.counter(p + "frames_encoded", help: "Frames submitted to the encoder.", value: totals.encoded)
+        w.counter(p + "frames_sent", help: "Frames broadcast to receivers.", value: totals.sent)
+        w.counter(p + "keyframes_sent", help: "Keyframes broadcast to receivers.", value: totals.keyframes)
+        w.counter(p + "frames_skipped", help: "Captured frames not encoded, by reason.", [
+            (labels: [("reason", "inflight")], value: totals.skippedInflight),
+            (labels: [("reason", "encoder_queue")], value: totals.skippedEncoderQueue),
+            (labels: [("reason", "unchanged")], value: totals.unchanged),
+        ])
+        w.counter(p + "sent_bytes", help: "Frame payload bytes broadcast.", unit: "bytes", value: totals.bytes)
+
+        w.counter(p + "receiver_acks", help: "Frame ACKs from receivers.", value: totals.acks)
+        w.counter(p + "receiver_keyframe_requests", help: "Keyframes requested by receiver decoder watchdogs.",
+                  value: totals.keyframeRequests)
+        w.histogram(p + "rtt_seconds", help: "Send to receiver ACK round trip.", totals.rtt, sumMs: totals.rttSumMs)
+        w.summary(p + "rtt_recent_seconds", help: "Round trip over the last 150 ACKs.", unit: "seconds", quantiles: [
+            (0.5, gauges.rttP50Ms / 1000), (0.95, gauges.rttP95Ms / 1000), (0.99, gauges.rttP99Ms / 1000),
+        ])
+
+        w.histogram(p + "process_seconds", help: "Per-frame image processing before encode.", totals.process,
+                    sumMs: totals.processSumMs)
+        w.gauge(p + "process_avg_seconds", help: "Image processing time (5 s average).", unit: "seconds",
+                value: gauges.processAvgMs / 1000)
+        w.gauge(p + "encode_avg_seconds", help: "Encode time (5 s average).", unit: "seconds",
+                value: gauges.encodeAvgMs / 1000)
+        w.histogram(p + "encoder_queue_seconds", help: "Per-frame wait behind earlier frames in the encoder.",
+                    totals.encodeQueue, sumMs: totals.encodeQueueSumMs)
+        w.histogram(p + "encode_seconds", help: "Per-frame encode time, excluding queue wait.", totals.encode,
+                    sumMs: totals.encodeSumMs)
+        w.histogram(p + "capture_to_encoded_seconds", help: "Display stream callback to encoded frame.",
+                    totals.captureToEncoded, sumMs: totals.captureToEncodedSumMs)
+        return w.finished
+    }
+}
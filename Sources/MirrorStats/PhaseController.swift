@@ -0,0 +1,58 @@
+// PhaseController.swift — Swift face of phase_ctl.c, capture ticks locked to
+// the receiver's display latch.
+//
+// TCPServer records each frame's capture and send time and feeds the
+// receiver's vsync reports back in; CompositorPacer asks for its next tick.
+// Until enough reports have arrived there is no steered tick and the pacer
+// runs free. host/tools/mirror_phasesim runs the same C unit against a
+// simulated receiver with a drifting clock.
+
+import CSenderCore
+
+/// Not thread-safe; callers serialize.
+public final class PhaseController {
+    private var ctl = phase_ctl()
+
+    /// `fps` is the capture rate the pacer ticks at.
+    public init(fps: Double = 120) {
+        var cfg = phase_config()
+        phase_config_default(&cfg, fps)
+        phase_ctl_init(&ctl, &cfg)
+    }
+
+    public var isLocked: Bool { phase_ctl_locked(&ctl) != 0 }
+    /// Tick interval in seconds: whole vsyncs (or whole fractions of one) once locked.
+    public var interval: Double { Double(phase_ctl_interval_us(&ctl)) / 1e6 }
+    /// Capture → ready at the receiver, ms.
+    public var delayMs: Double { ctl.delay_us / 1000 }
+    /// The receiver's vsync period in sender time, ms; 0 before the first report.
+    public var periodMs: Double { ctl.period_us / 1000 }
+    /// Last report: how long before its latch deadline the frame was ready, ms.
+    public var slackMs: Double { ctl.slack_us / 1000 }
+    public var reports: UInt64 { ctl.reports }
+
+    /// Frame `seq`, captured at `capturedAt`, went out at `sentAt` (seconds).
+    public func recordSend(_ seq: UInt32, capturedAt: Double, sentAt: Double) {
+        phase_ctl_on_send(&ctl, seq, Int64((capturedAt * 1e6).rounded()), Int64((sentAt * 1e6).rounded()))
+    }
+
+    /// A vsync report for `seq`; `oneWay` (seconds) is the sender → receiver
+    /// delay, half the base RTT. False if the frame is no longer remembered.
+    @discardableResult
+    public func report(_ seq: UInt32, arrivalToLatchUs: UInt32, slackUs: UInt32, periodUs: UInt32,
+                       oneWay: Double) -> Bool {
+        phase_ctl_on_report(&ctl, seq, arrivalToLatchUs, slackUs, periodUs, Int64((oneWay * 1e6).rounded())) != 0
+    }
+
+    /// The next steered tick (seconds) at least half an interval after
+    /// `lastTick`, or nil until locked.
+    public func nextTick(after lastTick: Double) -> Double? {
+        let t = phase_ctl_next_tick(&ctl, Int64((lastTick * 1e6).rounded()))
+        return t == 0 ? nil : Double(t) / 1e6
+    }
+
+    /// A new receiver: its display has its own phase.
+    public func reset() {
+        phase_ctl_reset(&ctl)
+    }
+}
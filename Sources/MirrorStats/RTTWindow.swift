@@ -0,0 +1,118 @@
+// RTTWindow.swift — Sliding-window RTT statistics in constant time per sample.
+//
+// TCPServer used to keep the last 150 RTTs in an array, drop the oldest with
+// removeFirst and sort a copy on every ACK to read min/max/avg/p95. Here the
+// window is a fixed ring; the running sum gives the average, two monotonic
+// queues give min and max, and a LatencyHistogram updated on insert and
+// eviction gives quantiles. Nothing allocates after init.
+
+import Foundation
+
+/// Not thread-safe; callers serialize.
+public struct RTTWindow {
+    public let capacity: Int
+    private var ring: [Double]
+    private var added = 0               // samples ever added; ring slot = added % capacity
+    public private(set) var last: Double = 0
+    private var sum: Double = 0
+    private var minQueue: MonotonicQueue
+    private var maxQueue: MonotonicQueue
+    public private(set) var histogram = LatencyHistogram()
+
+    public init(capacity: Int = 150) {
+        precondition(capacity > 0, "RTTWindow capacity must be positive")
+        self.capacity = capacity
+        ring = [Double](repeating: 0, count: capacity)
+        minQueue = MonotonicQueue(capacity: capacity, keepsMinimum: true)
+        maxQueue = MonotonicQueue(capacity: capacity, keepsMinimum: false)
+    }
+
+    /// Samples currently in the window.
+    public var count: Int { Swift.min(added, capacity) }
+
+    public mutating func add(_ ms: Double) {
+        let slot = added % capacity
+        if added >= capacity {
+            let evicted = ring[slot]
+            sum -= evicted
+            histogram.remove(evicted)
+        }
+        ring[slot] = ms
+        sum += ms
+        histogram.add(ms)
+        // Expire first so the queues never hold more than `capacity` entries.
+        minQueue.expire(before: added + 1 - capacity)
+        maxQueue.expire(before: added + 1 - capacity)
+        minQueue.push(index: added, value: ms)
+        maxQueue.push(index: added, value: ms)
+        added += 1
+        last = ms
+        // Adding and subtracting doubles drifts; resum once per lap.
+        if added % capacity == 0 { sum = ring.reduce(0, +) }
+    }
+
+    public var average: Double { count > 0 ? sum / Double(count) : 0 }
+    public var min: Double { minQueue.front ?? 0 }
+    public var max: Double { maxQueue.front ?? 0 }
+
+    /// Histogram quantile, clamped to the exact window min and max.
+    public func quantile(_ q: Double) -> Double {
+        guard count > 0 else { return 0 }
+        return Swift.min(Swift.max(histogram.quantile(q), min), max)
+    }
+
+    public mutating func reset() {
+        added = 0
+        sum = 0
+        last = 0
+        histogram.reset()
+        minQueue.reset()
+        maxQueue.reset()
+    }
+}
+
+/// Window minimum (or maximum): sample indices with values that can still
+/// become the extreme, oldest first, in a fixed ring. Each sample is pushed
+/// and popped at most once, so upkeep is amortized O(1).
+struct MonotonicQueue {
+    private var indices: [Int]
+    private var values: [Double]
+    private var head = 0
+    private var count = 0
+    private let keepsMinimum: Bool
+
+    init(capacity: Int, keepsMinimum: Bool) {
+        indices = [Int](repeating: 0, count: capacity)
+        values = [Double](repeating: 0, count: capacity)
+        self.keepsMinimum = keepsMinimum
+    }
+
+    var front: Double? { count > 0 ? values[head] : nil }
+
+    mutating func push(index: Int, value: Double) {
+        // Older samples that are no better than the new one can never be the extreme again.
+        while count > 0 {
+            let back = (head + count - 1) % values.count
+            let dominated = keepsMinimum ? values[back] >= value : values[back] <= value
+            if !dominated { break }
+            count -= 1
+        }
+        let slot = (head + count) % values.count
+        indices[slot] = index
+        values[slot] = value
+        count += 1
+    }
+
+    /// Drop samples older than `index`.
+    mutating func expire(before index: Int) {
+        while count > 0 && indices[head] < index {
+            head = (head + 1) % values.count
+            count -= 1
+        }
+    }
+
+    mutating func reset() {
+        head = 0
+        count = 0
+    }
+}
@@ -0,0 +1,46 @@
+// SendTimestamps.swift — Swift face of send_ring.c, the send-time table.
+//
+// The same C unit backs the Linux sender (host/sender_server.c), so both
+// senders agree on how ACKs match frames and what counts as inflight. Frame
+// `seq` lives in slot seq & mask of a power-of-two ring: recording, ACKing and
+// evicting are one slot access each, and nothing is ever filtered or rebuilt.
+
+import CSenderCore
+
+/// Not thread-safe; callers serialize.
+public final class SendTimestamps {
+    private var ring = send_ring()
+
+    /// Rounded up to a power of two. Frames still unACKed `capacity` sends
+    /// later are counted as expired and stop counting as inflight.
+    public init(capacity: UInt32 = 512) {
+        precondition(send_ring_init(&ring, capacity) == 0, "send_ring allocation failed")
+    }
+
+    deinit {
+        send_ring_free(&ring)
+    }
+
+    public var capacity: Int { Int(send_ring_capacity(&ring)) }
+    /// Frames sent and neither ACKed nor expired.
+    public var inflight: Int { Int(send_ring_inflight(&ring)) }
+    public var expired: UInt64 { ring.expired }
+
+    /// Frame `seq` went out at `time` (seconds, e.g. CACurrentMediaTime()).
+    public func record(_ seq: UInt32, at time: Double) {
+        send_ring_record(&ring, seq, Int64((time * 1e6).rounded()))
+    }
+
+    /// Send time of `seq` if it was pending; nil for duplicate, expired or
+    /// pre-reset ACKs. The frame stops counting as inflight.
+    public func ack(_ seq: UInt32) -> Double? {
+        var sentUs: Int64 = 0
+        guard send_ring_ack(&ring, seq, &sentUs) != 0 else { return nil }
+        return Double(sentUs) / 1e6
+    }
+
+    /// Forget every pending frame (a client connected). O(1).
+    public func reset() {
+        send_ring_reset(&ring)
+    }
+}
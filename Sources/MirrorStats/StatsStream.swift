@@ -0,0 +1,229 @@
+// StatsStream.swift — Cumulative engine counters and the SUBSCRIBE line format.
+//
+// ControlSocket's SUBSCRIBE keeps the connection open and pushes one line per
+// interval with what changed since the previous line: counter deltas plus
+// sparse snapshots of the RTT, per-frame processing and encoder (queue wait,
+// encode, capture → encoded; see EncoderTimeline) histograms. Histograms
+// add, so a reader gets quantiles for any span (the last second, the last
+// minute) by merging lines, without the engine keeping per-subscriber windows.
+//
+//   STATS t_ms=81000 interval_ms=1000 captured=120 encoded=31 sent=31 skipped=0
+//         unchanged=89 bytes=412345 acks=31 rtt=52:3,60:28 process=20:31
+//         enc_queue=0:30,12:1 encode=55:31 capture_encoded=74:30,76:1
+//
+// (one line on the wire). Histogram buckets are LatencyHistogram buckets; the
+// SUBSCRIBE reply header states the layout so external tools need no copy of
+// this file. OpenMetrics.swift renders the cumulative snapshot for scrapers.
+
+import Foundation
+
+/// Cumulative counters since the recorder was created.
+public struct StatsSnapshot: Equatable {
+    public var timeMs: Double = 0
+    public var captured: UInt64 = 0     // frames delivered by the display stream
+    public var encoded: UInt64 = 0      // frames submitted to the encoder
+    public var sent: UInt64 = 0         // frames broadcast to receivers
+    public var skipped: UInt64 = 0      // dropped by backpressure
+    public var skippedInflight: UInt64 = 0      // ...because the window was full
+    public var skippedEncoderQueue: UInt64 = 0  // ...because the encoder was behind
+    public var unchanged: UInt64 = 0    // not encoded: only the pacer changed
+    public var keyframes: UInt64 = 0    // of `sent`
+    public var bytes: UInt64 = 0        // payload bytes broadcast
+    public var acks: UInt64 = 0
+    public var keyframeRequests: UInt64 = 0     // receiver decoder recoveries
+    public var rtt = LatencyHistogram()
+    public var rttSumMs: Double = 0
+    public var process = LatencyHistogram()
+    public var processSumMs: Double = 0
+    public var encodeQueue = LatencyHistogram()
+    public var encodeQueueSumMs: Double = 0
+    public var encode = LatencyHistogram()
+    public var encodeSumMs: Double = 0
+    public var captureToEncoded = LatencyHistogram()
+    public var captureToEncodedSumMs: Double = 0
+
+    public init() {}
+}
+
+/// Records engine events from the capture, encoder and network threads.
+public final class StatsRecorder: @unchecked Sendable {
+    private let lock = NSLock()
+    private var totals = StatsSnapshot()
+
+    public init() {}
+
+    public enum SkipReason { case inflight, encoderQueue }
+
+    public func recordCaptured() { update { $0.captured += 1 } }
+    public func recordUnchanged() { update { $0.unchanged += 1 } }
+    public func recordKeyframeRequest() { update { $0.keyframeRequests += 1 } }
+
+    /// A frame dropped by backpressure; a full window wins over a full encoder queue.
+    public func recordSkipped(_ reason: SkipReason) {
+        update {
+            $0.skipped += 1
+            switch reason {
+            case .inflight: $0.skippedInflight += 1
+            case .encoderQueue: $0.skippedEncoderQueue += 1
+            }
+        }
+    }
+
+    /// A frame went to the encoder after `processMs` of image processing.
+    public func recordEncoded(processMs: Double) {
+        update {
+            $0.encoded += 1
+            $0.process.add(processMs)
+            $0.processSumMs += processMs
+        }
+    }
+
+    public func recordSent(bytes: Int, keyframe: Bool = false) {
+        update {
+            $0.sent += 1
+            if keyframe { $0.keyframes += 1 }
+            $0.bytes += UInt64(bytes)
+        }
+    }
+
+    /// The encoder returned a frame (see EncoderTimeline).
+    public func recordEncoderOutput(_ a: EncodeAttribution) {
+        update {
+            $0.encodeQueue.add(a.queueMs)
+            $0.encodeQueueSumMs += a.queueMs
+            $0.encode.add(a.encodeMs)
+            $0.encodeSumMs += a.encodeMs
+            $0.captureToEncoded.add(a.captureToEncodedMs)
+            $0.captureToEncodedSumMs += a.captureToEncodedMs
+        }
+    }
+
+    public func recordAck(rttMs: Double) {
+        update {
+            $0.acks += 1
+            $0.rtt.add(rttMs)
+            $0.rttSumMs += rttMs
+        }
+    }
+
+    /// Totals so far, stamped with `timeMs` (defaults to system uptime).
+    public func snapshot(timeMs: Double = ProcessInfo.processInfo.systemUptime * 1000) -> StatsSnapshot {
+        lock.lock()
+        var s = totals
+        lock.unlock()
+        s.timeMs = timeMs
+        return s
+    }
+
+    private func update(_ body: (inout StatsSnapshot) -> Void) {
+        lock.lock()
+        body(&totals)
+        lock.unlock()
+    }
+}
+
+/// What happened between two snapshots; one SUBSCRIBE line.
+public struct StatsDelta: Equatable {
+    public var timeMs: Double = 0       // end of the interval
+    public var intervalMs: Double = 0
+    public var captured: UInt64 = 0
+    public var encoded: UInt64 = 0
+    public var sent: UInt64 = 0
+    public var skipped: UInt64 = 0
+    public var unchanged: UInt64 = 0
+    public var bytes: UInt64 = 0
+    public var acks: UInt64 = 0
+    public var rtt = LatencyHistogram()
+    public var process = LatencyHistogram()
+    public var encodeQueue = LatencyHistogram()
+    public var encode = LatencyHistogram()
+    public var captureToEncoded = LatencyHistogram()
+
+    public init() {}
+
+    public init(from old: StatsSnapshot, to new: StatsSnapshot) {
+        timeMs = new.timeMs
+        intervalMs = new.timeMs - old.timeMs
+        captured = new.captured &- old.captured
+        encoded = new.encoded &- old.encoded
+        sent = new.sent &- old.sent
+        skipped = new.skipped &- old.skipped
+        unchanged = new.unchanged &- old.unchanged
+        bytes = new.bytes &- old.bytes
+        acks = new.acks &- old.acks
+        rtt = new.rtt.subtracting(old.rtt)
+        process = new.process.subtracting(old.process)
+        encodeQueue = new.encodeQueue.subtracting(old.encodeQueue)
+        encode = new.encode.subtracting(old.encode)
+        captureToEncoded = new.captureToEncoded.subtracting(old.captureToEncoded)
+    }
+
+    /// Extend this interval with the one that followed it.
+    public mutating func merge(_ next: StatsDelta) {
+        timeMs = next.timeMs
+        intervalMs += next.intervalMs
+        captured += next.captured
+        encoded += next.encoded
+        sent += next.sent
+        skipped += next.skipped
+        unchanged += next.unchanged
+        bytes += next.bytes
+        acks += next.acks
+        rtt.merge(next.rtt)
+        process.merge(next.process)
+        encodeQueue.merge(next.encodeQueue)
+        encode.merge(next.encode)
+        captureToEncoded.merge(next.captureToEncoded)
+    }
+
+    /// Frames per second of `count` over this interval.
+    public func rate(_ count: UInt64) -> Double {
+        intervalMs > 0 ? Double(count) * 1000 / intervalMs : 0
+    }
+
+    /// First line of a SUBSCRIBE reply: the interval and histogram layout.
+    public static func header(intervalMs: Int) -> String {
+        "OK subscribed interval_ms=\(intervalMs) buckets=\(LatencyHistogram.bucketCount)"
+            + " buckets_per_octave=\(LatencyHistogram.bucketsPerOctave) lowest_ms=\(LatencyHistogram.lowestMs)"
+    }
+
+    public var line: String {
+        "STATS t_ms=\(Int64(timeMs.rounded())) interval_ms=\(Int64(intervalMs.rounded()))"
+            + " captured=\(captured) encoded=\(encoded) sent=\(sent) skipped=\(skipped)"
+            + " unchanged=\(unchanged) bytes=\(bytes) acks=\(acks)"
+            + " rtt=\(rtt.sparseDescription) process=\(process.sparseDescription)"
+            + " enc_queue=\(encodeQueue.sparseDescription) encode=\(encode.sparseDescription)"
+            + " capture_encoded=\(captureToEncoded.sparseDescription)"
+    }
+
+    /// Parses `line`. Unknown keys are ignored so the format can grow; nil if
+    /// it is not a STATS line or a known field is malformed.
+    public init?(line: String) {
+        let fields = line.split(separator: " ")
+        guard fields.first == "STATS" else { return nil }
+        self.init()
+        for field in fields.dropFirst() {
+            let kv = field.split(separator: "=", maxSplits: 1)
+            guard kv.count == 2 else { return nil }
+            let value = String(kv[1])
+            switch kv[0] {
+            case "t_ms": guard let v = Double(value) else { return nil }; timeMs = v
+            case "interval_ms": guard let v = Double(value) else { return nil }; intervalMs = v
+            case "captured": guard let v = UInt64(value) else { return nil }; captured = v
+            case "encoded": guard let v = UInt64(value) else { return nil }; encoded = v
+            case "sent": guard let v = UInt64(value) else { return nil }; sent = v
+            case "skipped": guard let v = UInt64(value) else { return nil }; skipped = v
+            case "unchanged": guard let v = UInt64(value) else { return nil }; unchanged = v
+            case "bytes": guard let v = UInt64(value) else { return nil }; bytes = v
+            case "acks": guard let v = UInt64(value) else { return nil }; acks = v
+            case "rtt": guard let h = LatencyHistogram(sparse: value) else { return nil }; rtt = h
+            case "process": guard let h = LatencyHistogram(sparse: value) else { return nil }; process = h
+            case "enc_queue": guard let h = LatencyHistogram(sparse: value) else { return nil }; encodeQueue = h
+            case "encode": guard let h = LatencyHistogram(sparse: value) else { return nil }; encode = h
+            case "capture_encoded":
+                guard let h = LatencyHistogram(sparse: value) else { return nil }; captureToEncoded = h
+            default: break
+            }
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// UpstreamParser.swift — Receiver → sender packet parser with a read cursor.
+//
+// The receiver sends ACKs [DA 7A][seq:4 LE], 4-byte commands [DA 7F][cmd][value]
+// (keyframe requests, codec adverts) and, once asked, vsync reports
+// [DA 7B][seq][arrival→latch µs][ready→latch µs][period µs] (4 LE each) on the
+// same socket, split arbitrarily by TCP. Parsing used to consume a Data buffer with removeFirst, shifting every
+// remaining byte per packet; this walks a cursor over a byte array and moves
+// only the unparsed tail (under one packet) once per read.
+
+import Foundation
+
+public enum UpstreamPacket: Equatable {
+    case ack(seq: UInt32)
+    case command(cmd: UInt8, value: UInt8)
+    case vsyncReport(seq: UInt32, arrivalToLatchUs: UInt32, slackUs: UInt32, periodUs: UInt32)
+}
+
+public struct UpstreamParser {
+    /// Same bytes as MAGIC_ACK / MAGIC_CMD in Configuration.swift.
+    public static let ackMagic: [UInt8] = [0xDA, 0x7A]
+    public static let commandMagic: [UInt8] = [0xDA, 0x7F]
+    /// Same bytes as MAGIC_VSYNC in Configuration.swift.
+    public static let vsyncMagic: [UInt8] = [0xDA, 0x7B]
+    public static let ackSize = 6
+    public static let commandSize = 4
+    public static let vsyncReportSize = 18
+    /// Garbage bytes skipped in one read before the buffer is dropped as out of sync.
+    public static let maxSkip = 256
+
+    private var buffer: [UInt8] = []
+    private var cursor = 0
+    public private(set) var skippedBytes = 0
+
+    public init() {
+        buffer.reserveCapacity(4096)
+    }
+
+    /// Bytes received but not yet parsed (a partial packet).
+    public var pending: Int { buffer.count - cursor }
+
+    /// Append one read and hand every complete packet to `handle`, in order.
+    public mutating func feed<Bytes: Sequence>(_ bytes: Bytes, _ handle: (UpstreamPacket) -> Void)
+        where Bytes.Element == UInt8 {
+        buffer.append(contentsOf: bytes)
+        var skipped = 0
+        while buffer.count - cursor >= UpstreamParser.commandSize {
+            let m0 = buffer[cursor], m1 = buffer[cursor + 1]
+            if m0 == UpstreamParser.commandMagic[0] && m1 == UpstreamParser.commandMagic[1] {
+                handle(.command(cmd: buffer[cursor + 2], value: buffer[cursor + 3]))
+                cursor += UpstreamParser.commandSize
+                continue
+            }
+            if m0 == UpstreamParser.vsyncMagic[0] && m1 == UpstreamParser.vsyncMagic[1] {
+                if buffer.count - cursor < UpstreamParser.vsyncReportSize { break }
+                handle(.vsyncReport(seq: le32(cursor + 2), arrivalToLatchUs: le32(cursor + 6),
+                                    slackUs: le32(cursor + 10), periodUs: le32(cursor + 14)))
+                cursor += UpstreamParser.vsyncReportSize
+                continue
+            }
+            guard m0 == UpstreamParser.ackMagic[0] && m1 == UpstreamParser.ackMagic[1] else {
+                cursor += 1
+                skipped += 1
+                skippedBytes += 1
+                if skipped > UpstreamParser.maxSkip {
+                    buffer.removeAll(keepingCapacity: true)
+                    cursor = 0
+                    return
+                }
+                continue
+            }
+            if buffer.count - cursor < UpstreamParser.ackSize { break }
+            handle(.ack(seq: le32(cursor + 2)))
+            cursor += UpstreamParser.ackSize
+        }
+        compact()
+    }
+
+    private func le32(_ at: Int) -> UInt32 {
+        UInt32(buffer[at]) | UInt32(buffer[at + 1]) << 8 | UInt32(buffer[at + 2]) << 16 | UInt32(buffer[at + 3]) << 24
+    }
+
+    public mutating func reset() {
+        buffer.removeAll(keepingCapacity: true)
+        cursor = 0
+    }
+
+    /// Move the unparsed tail to the front; the capacity is kept.
+    private mutating func compact() {
+        if cursor == buffer.count {
+            buffer.removeAll(keepingCapacity: true)
+        } else if cursor > 0 {
+            buffer.removeSubrange(0..<cursor)
+        }
+        cursor = 0
+    }
+}
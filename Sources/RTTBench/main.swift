@@ -0,0 +1,84 @@
+// main.swift — rtt-bench: per-ACK cost of the sender's RTT bookkeeping.
+//
+// Compares the old TCPServer path (Data.removeFirst parsing, array window with
+// removeFirst, sort per ACK) with UpstreamParser + RTTWindow on the same
+// synthetic ACK stream. Foundation-only, so it runs on Linux too.
+//
+// Usage: swift run -c release rtt-bench [acks]
+
+import Foundation
+import MirrorStats
+
+let ackCount = CommandLine.arguments.count > 1 ? Int(CommandLine.arguments[1]) ?? 200_000 : 200_000
+let window = 150
+
+// ACKs in reads of 1-3 packets, as TCP delivers them at 120 fps.
+var reads: [Data] = []
+var rtts: [Double] = []
+var seed: UInt64 = 1
+func next() -> UInt64 {
+    seed = seed &* 6364136223846793005 &+ 1442695040888963407
+    return seed >> 33
+}
+var seq: UInt32 = 0
+while seq < UInt32(ackCount) {
+    var read = Data()
+    for _ in 0..<(1 + Int(next() % 3)) {
+        read.append(contentsOf: [0xDA, 0x7A, UInt8(seq & 0xFF), UInt8((seq >> 8) & 0xFF),
+                                 UInt8((seq >> 16) & 0xFF), UInt8(seq >> 24)])
+        rtts.append(5 + Double(next() % 15_000) / 1000)
+        seq += 1
+    }
+    reads.append(read)
+}
+
+// Each body returns a sum of everything it computed so the work is not optimized away.
+var sink = 0.0
+func measure(_ name: String, _ body: () -> Double) {
+    let start = ProcessInfo.processInfo.systemUptime
+    sink += body()
+    let elapsed = ProcessInfo.processInfo.systemUptime - start
+    print(name.padding(toLength: 26, withPad: " ", startingAt: 0) +
+          String(format: "%8.1f ns/ack", elapsed * 1e9 / Double(rtts.count)))
+}
+
+print("rtt-bench: \(rtts.count) ACKs, window \(window)")
+
+measure("sort-per-ack (old)") {
+    var buffer = Data()
+    var samples: [Double] = []
+    var checksum = 0.0
+    var i = 0
+    for read in reads {
+        buffer.append(read)
+        while buffer.count >= 6 {
+            buffer.removeFirst(6)
+            samples.append(rtts[i])
+            i += 1
+            if samples.count > window { samples.removeFirst(samples.count - window) }
+            let sorted = samples.sorted()
+            let avg = sorted.reduce(0, +) / Double(sorted.count)
+            let p95 = sorted[min(Int(Double(sorted.count) * 0.95), sorted.count - 1)]
+            checksum += avg + p95 + sorted[0] + sorted[sorted.count - 1]
+        }
+    }
+    return checksum
+}
+
+measure("ring + histogram (new)") {
+    var parser = UpstreamParser()
+    var w = RTTWindow(capacity: window)
+    var checksum = 0.0
+    var i = 0
+    for read in reads {
+        parser.feed(read) { packet in
+            guard case .ack = packet else { return }
+            w.add(rtts[i])
+            i += 1
+            checksum += w.average + w.quantile(0.95) + w.min + w.max
+        }
+    }
+    return checksum
+}
+
+if sink.isNaN { print("unreachable") }
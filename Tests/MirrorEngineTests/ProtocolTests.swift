@@ -1,4 +1,5 @@
 import XCTest
+import MirrorStats
 @testable import MirrorEngine
 
 final class ProtocolTests: XCTestCase {
@@ -42,8 +43,18 @@ final class ProtocolTests: XCTestCase {
         XCTAssertEqual(CMD_RESOLUTION, 0x04)
     }
 
+    func testCmdRequestKeyframe() {
+        XCTAssertEqual(CMD_REQUEST_KEYFRAME, 0x05)
+    }
+
+    func testCmdCodecs() {
+        XCTAssertEqual(CMD_CODECS, 0x06)
+        XCTAssertEqual(CMD_CODEC, 0x07)
+    }
+
     func testCommandIDsAreUnique() {
-        let ids: [UInt8] = [CMD_BRIGHTNESS, CMD_WARMTH, CMD_BACKLIGHT_TOGGLE, CMD_RESOLUTION]
+        let ids: [UInt8] = [CMD_BRIGHTNESS, CMD_WARMTH, CMD_BACKLIGHT_TOGGLE, CMD_RESOLUTION,
+                            CMD_REQUEST_KEYFRAME, CMD_CODECS, CMD_CODEC]
         XCTAssertEqual(ids.count, Set(ids).count, "All command IDs must be unique")
     }
 
@@ -130,10 +141,33 @@ final class ProtocolTests: XCTestCase {
         XCTAssertEqual(header[2], 0x00)
     }
 
+    func testWriteFrameHeaderInPlace() {
+        let payload: [UInt8] = [0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xAF]
+        var frame = Data(repeating: 0, count: FRAME_HEADER_SIZE)
+        frame.append(contentsOf: payload)
+        writeFrameHeader(into: &frame, isKeyframe: true, sequenceNumber: 0x01020304)
+
+        var expected = Data(capacity: FRAME_HEADER_SIZE)
+        expected.append(contentsOf: MAGIC_FRAME)
+        expected.append(FLAG_KEYFRAME)
+        var seq = UInt32(0x01020304).littleEndian
+        expected.append(Data(bytes: &seq, count: 4))
+        var len = UInt32(payload.count).littleEndian
+        expected.append(Data(bytes: &len, count: 4))
+        expected.append(contentsOf: payload)
+
+        XCTAssertEqual(frame, expected, "In-place header must match the concatenated layout")
+    }
+
     func testAckMagicBytes() {
         XCTAssertEqual(MAGIC_ACK, [0xDA, 0x7A])
     }
 
+    func testUpstreamParserMagicMatchesProtocol() {
+        XCTAssertEqual(UpstreamParser.ackMagic, MAGIC_ACK)
+        XCTAssertEqual(UpstreamParser.commandMagic, MAGIC_CMD)
+    }
+
     func testAllMagicBytesAreUnique() {
         XCTAssertNotEqual(MAGIC_FRAME, MAGIC_CMD)
         XCTAssertNotEqual(MAGIC_FRAME, MAGIC_ACK)
@@ -181,6 +215,28 @@ final class ProtocolTests: XCTestCase {
         XCTAssertEqual(packet[3], 42, "Value byte is at offset 3")
     }
 
+    // MARK: - Codec negotiation
+
+    func testCodecIdsMatchReceiver() {
+        XCTAssertEqual(CODEC_HEVC, 0, "HEVC must stay 0: the stream before negotiation")
+        XCTAssertEqual(CODEC_H264, 1)
+        XCTAssertEqual(CODEC_AV1, 2)
+    }
+
+    func testUnpackCodecList() {
+        // AV1, H.264, HEVC packed fastest first as (id + 1) in two-bit fields
+        let packed: UInt8 = 3 | (2 << 2) | (1 << 4)
+        XCTAssertEqual(unpackCodecList(packed), [CODEC_AV1, CODEC_H264, CODEC_HEVC])
+        XCTAssertEqual(unpackCodecList(0), [])
+    }
+
+    func testPickCodecPrefersReceiverOrder() {
+        let allowed: Set<UInt8> = [CODEC_HEVC, CODEC_H264]
+        XCTAssertEqual(pickCodec(ranked: [CODEC_AV1, CODEC_H264, CODEC_HEVC], allowed: allowed), CODEC_H264)
+        XCTAssertEqual(pickCodec(ranked: [CODEC_AV1], allowed: allowed), CODEC_HEVC)
+        XCTAssertEqual(pickCodec(ranked: [], allowed: []), CODEC_HEVC)
+    }
+
     // MARK: - Step constants
 
     func testBrightnessStepIsPositive() {
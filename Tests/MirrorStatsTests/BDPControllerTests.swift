@@ -0,0 +1,45 @@
+import XCTest
+@testable import MirrorStats
+
+final class BDPControllerTests: XCTestCase {
+
+    private let period = 1.0 / 120
+
+    func testColdWindowAllowsFrames() {
+        let c = BDPController()
+        XCTAssertTrue(c.shouldSend)
+        XCTAssertEqual(c.bandwidth, 0)
+        XCTAssertEqual(c.minRTTMs, 0)
+    }
+
+    func testSteadyStreamWindowIsPipelinePlusOne() {
+        // 10 KB per frame at 120 fps, ACKed 5 ms after sending.
+        let c = BDPController(fps: 120)
+        for seq in UInt32(0)..<240 {
+            let t = Double(seq) * period
+            if seq > 0 { XCTAssertTrue(c.ack(seq - 1, at: t - period + 0.005)) }
+            c.recordSend(seq, bytes: 10_000, isKeyframe: false, at: t)
+        }
+        XCTAssertEqual(c.minRTTMs, 5, accuracy: 0.01)
+        XCTAssertEqual(c.windowFrames, 2)
+        XCTAssertEqual(c.inflight, 1)
+        XCTAssertTrue(c.shouldSend)
+        c.recordSend(240, bytes: 10_000, isKeyframe: false, at: 240 * period)
+        XCTAssertFalse(c.shouldSend)
+        XCTAssertFalse(c.ack(500, at: 241 * period), "never sent")
+    }
+
+    func testResetForgetsInflightKeepsEstimates() {
+        let c = BDPController()
+        c.recordSend(1, bytes: 5000, isKeyframe: false, at: 0)
+        XCTAssertTrue(c.ack(1, at: 0.004))
+        c.recordSend(2, bytes: 5000, isKeyframe: false, at: 0.01)
+        c.recordSend(3, bytes: 500_000, isKeyframe: true, at: 0.02)
+        XCTAssertFalse(c.shouldSend)
+        c.reset()
+        XCTAssertEqual(c.inflight, 0)
+        XCTAssertTrue(c.shouldSend)
+        XCTAssertEqual(c.minRTTMs, 4, accuracy: 0.01)
+        XCTAssertFalse(c.ack(3, at: 0.03), "ACK from the previous connection")
+    }
+}
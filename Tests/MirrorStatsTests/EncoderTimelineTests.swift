@@ -0,0 +1,69 @@
+import XCTest
+@testable import MirrorStats
+
+final class EncoderTimelineTests: XCTestCase {
+
+    func testIdleEncoderHasNoQueueWait() {
+        var t = EncoderTimeline()
+        let token = t.submit(capturedAt: 1.000, submittedAt: 1.002)
+        XCTAssertNotEqual(token, 0)
+        let a = t.complete(token, at: 1.006)!
+        XCTAssertEqual(a.captureToSubmitMs, 2, accuracy: 1e-6)
+        XCTAssertEqual(a.queueMs, 0, accuracy: 1e-6)
+        XCTAssertEqual(a.encodeMs, 4, accuracy: 1e-6)
+        XCTAssertEqual(a.captureToEncodedMs, 6, accuracy: 1e-6)
+    }
+
+    func testBackToBackFramesQueueBehindEachOther() {
+        var t = EncoderTimeline()
+        // Three frames submitted 1 ms apart; each takes 5 ms to encode.
+        let a = t.submit(capturedAt: 0.000, submittedAt: 0.001)
+        let b = t.submit(capturedAt: 0.001, submittedAt: 0.002)
+        let c = t.submit(capturedAt: 0.002, submittedAt: 0.003)
+        let ra = t.complete(a, at: 0.006)!
+        let rb = t.complete(b, at: 0.011)!
+        let rc = t.complete(c, at: 0.016)!
+        XCTAssertEqual(ra.queueMs, 0, accuracy: 1e-6)
+        XCTAssertEqual(rb.queueMs, 4, accuracy: 1e-6)
+        XCTAssertEqual(rb.encodeMs, 5, accuracy: 1e-6)
+        XCTAssertEqual(rc.queueMs, 8, accuracy: 1e-6)
+        XCTAssertEqual(rc.encodeMs, 5, accuracy: 1e-6)
+        XCTAssertEqual(rc.captureToEncodedMs, 14, accuracy: 1e-6)
+    }
+
+    func testDroppedFrameStillOccupiesEncoder() {
+        var t = EncoderTimeline()
+        let a = t.submit(capturedAt: 0, submittedAt: 0)
+        let b = t.submit(capturedAt: 0, submittedAt: 0.001)
+        _ = t.complete(a, at: 0.010)        // dropped by the encoder: result unused
+        let rb = t.complete(b, at: 0.012)!
+        XCTAssertEqual(rb.queueMs, 9, accuracy: 1e-6)
+        XCTAssertEqual(rb.encodeMs, 2, accuracy: 1e-6)
+    }
+
+    func testStaleAndUnknownTokensMiss() {
+        var t = EncoderTimeline(capacity: 4)
+        XCTAssertEqual(t.capacity, 4)
+        let first = t.submit(capturedAt: 0, submittedAt: 0)
+        for _ in 0..<4 { _ = t.submit(capturedAt: 0, submittedAt: 0) }   // wraps onto `first`
+        XCTAssertNil(t.complete(first, at: 1))
+        XCTAssertNil(t.complete(0, at: 1))
+        XCTAssertEqual(t.unmatched, 2)
+
+        let token = t.submit(capturedAt: 0, submittedAt: 0)
+        XCTAssertNotNil(t.complete(token, at: 0.001))
+        XCTAssertNil(t.complete(token, at: 0.002))          // completed twice
+    }
+
+    func testResetForgetsQueuedFrames() {
+        var t = EncoderTimeline()
+        let old = t.submit(capturedAt: 0, submittedAt: 0)
+        _ = t.complete(t.submit(capturedAt: 0, submittedAt: 0), at: 0.050)
+        t.reset()
+        XCTAssertNil(t.complete(old, at: 0.060))
+        let fresh = t.submit(capturedAt: 0.001, submittedAt: 0.002)
+        let r = t.complete(fresh, at: 0.005)!
+        XCTAssertEqual(r.queueMs, 0, accuracy: 1e-6)    // not queued behind the old session
+        XCTAssertEqual(r.encodeMs, 3, accuracy: 1e-6)
+    }
+}
@@ -0,0 +1,87 @@
+import XCTest
+@testable import MirrorStats
+
+final class FrameChangeFilterTests: XCTestCase {
+
+    private let pacer = FrameChangeFilter.pacerRegion(dirtySize: 32, scale: 2)
+    private let pacerDirt = [DirtyRect(x: 0, y: 0, width: 64, height: 64)]
+    private let typing = [DirtyRect(x: 400, y: 300, width: 12, height: 20)]
+
+    private func filter(keepalive: Int = 30) -> FrameChangeFilter {
+        FrameChangeFilter(ignoring: [pacer], keepaliveInterval: keepalive)
+    }
+
+    func testPacerRegionCoversScaledWindow() {
+        XCTAssertEqual(pacer, DirtyRect(x: 0, y: 0, width: 66, height: 66))
+        XCTAssertEqual(FrameChangeFilter.pacerRegion(dirtySize: 4, scale: 0.5, padding: 0).width, 4)
+    }
+
+    func testFirstFrameAlwaysEncodes() {
+        var f = filter()
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .encode)
+    }
+
+    func testPacerOnlyFramesSkip() {
+        var f = filter()
+        _ = f.decide(dirtyRects: typing)
+        f.encoded()
+        for _ in 0..<10 {
+            XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .skip)
+        }
+        XCTAssertEqual(f.decide(dirtyRects: []), .skip, "no dirty rects at all")
+        XCTAssertEqual(f.skipped, 11)
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt + typing), .encode)
+    }
+
+    func testRectStraddlingPacerEdgeIsAChange() {
+        var f = filter()
+        _ = f.decide(dirtyRects: nil)
+        f.encoded()
+        XCTAssertEqual(f.decide(dirtyRects: [DirtyRect(x: 60, y: 0, width: 20, height: 10)]), .encode)
+    }
+
+    func testUnknownChangeEncodes() {
+        var f = filter()
+        _ = f.decide(dirtyRects: typing)
+        f.encoded()
+        XCTAssertEqual(f.decide(dirtyRects: nil), .encode)
+    }
+
+    func testDroppedChangeStaysPending() {
+        var f = filter()
+        _ = f.decide(dirtyRects: typing)
+        f.encoded()
+        // A change arrives, but backpressure drops the frame: no encoded().
+        XCTAssertEqual(f.decide(dirtyRects: typing), .encode)
+        // Later updates only report the pacer; the change still has to go out.
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .encode)
+        f.encoded()
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .skip)
+    }
+
+    func testKeepaliveAfterUnchangedRun() {
+        var f = filter(keepalive: 4)
+        _ = f.decide(dirtyRects: typing)
+        f.encoded()
+        var decisions: [FrameChangeFilter.Decision] = []
+        for _ in 0..<10 {
+            let d = f.decide(dirtyRects: pacerDirt)
+            decisions.append(d)
+            if d != .skip { f.encoded() }
+        }
+        XCTAssertEqual(decisions, [.skip, .skip, .skip, .keepalive, .skip, .skip, .skip, .keepalive, .skip, .skip])
+        XCTAssertEqual(f.keepalives, 2)
+    }
+
+    func testForcedKeyframeEncodesAndResetsRun() {
+        var f = filter(keepalive: 3)
+        _ = f.decide(dirtyRects: typing)
+        f.encoded()
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .skip)
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt, force: true), .encode)
+        f.encoded()
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .skip)
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .skip)
+        XCTAssertEqual(f.decide(dirtyRects: pacerDirt), .keepalive)
+    }
+}
@@ -0,0 +1,117 @@
+import XCTest
+@testable import MirrorStats
+
+final class OpenMetricsTests: XCTestCase {
+
+    private func samples(_ text: String, _ name: String) -> [String] {
+        text.split(separator: "\n").map(String.init).filter { $0.hasPrefix(name + " ") || $0.hasPrefix(name + "{") }
+    }
+
+    func testCounterAndGaugeFamilies() {
+        var w = OpenMetricsWriter()
+        w.counter("x_frames", help: "Frames.", value: 42)
+        w.counter("x_sent_bytes", help: "Bytes.", unit: "bytes", value: 7)
+        w.gauge("x_fps", help: "FPS.", value: 59.5)
+        let text = w.finished
+        XCTAssertEqual(text, """
+            # TYPE x_frames counter
+            # HELP x_frames Frames.
+            x_frames_total 42
+            # TYPE x_sent_bytes counter
+            # UNIT x_sent_bytes bytes
+            # HELP x_sent_bytes Bytes.
+            x_sent_bytes_total 7
+            # TYPE x_fps gauge
+            # HELP x_fps FPS.
+            x_fps 59.5
+            # EOF
+
+            """)
+    }
+
+    func testLabelsAndEscaping() {
+        var w = OpenMetricsWriter()
+        w.counter("x_skips", help: "a \\ b\nc", [
+            (labels: [("reason", "in\"flight")], value: 1),
+            (labels: [("reason", "queue"), ("host", "a\\b")], value: 2),
+        ])
+        let text = w.finished
+        XCTAssertTrue(text.contains("# HELP x_skips a \\\\ b\\nc\n"))
+        XCTAssertTrue(text.contains("x_skips_total{reason=\"in\\\"flight\"} 1\n"))
+        XCTAssertTrue(text.contains("x_skips_total{reason=\"queue\",host=\"a\\\\b\"} 2\n"))
+        XCTAssertEqual(OpenMetricsWriter.format(.infinity), "+Inf")
+        XCTAssertEqual(OpenMetricsWriter.format(.nan), "NaN")
+    }
+
+    func testHistogramBucketsAreCumulativeSeconds() {
+        var h = LatencyHistogram()
+        for ms in [0.05, 3.0, 3.0, 12.0, 20_000.0] { h.add(ms) }
+        var w = OpenMetricsWriter()
+        w.histogram("x_rtt_seconds", help: "RTT.", h, sumMs: 2500)
+        let text = w.finished
+        XCTAssertTrue(text.contains("# TYPE x_rtt_seconds histogram\n# UNIT x_rtt_seconds seconds\n"))
+
+        let buckets = samples(text, "x_rtt_seconds_bucket")
+        XCTAssertEqual(buckets.count, (LatencyHistogram.bucketCount - 1) / 8 + 1)
+        XCTAssertEqual(buckets.first, "x_rtt_seconds_bucket{le=\"0.000125\"} 1")
+        XCTAssertEqual(buckets.last, "x_rtt_seconds_bucket{le=\"+Inf\"} 5")
+
+        // Monotonic, and each count matches the histogram below its bound.
+        var previous = 0
+        for line in buckets.dropLast() {
+            let le = Double(line.split(separator: "\"")[1])!
+            let count = Int(line.split(separator: " ").last!)!
+            XCTAssertGreaterThanOrEqual(count, previous)
+            let expected = [0.05, 3.0, 3.0, 12.0, 20_000.0].filter { $0 < le * 1000 }.count
+            XCTAssertEqual(count, expected, line)
+            previous = count
+        }
+        XCTAssertEqual(samples(text, "x_rtt_seconds_count"), ["x_rtt_seconds_count 5"])
+        XCTAssertEqual(samples(text, "x_rtt_seconds_sum"), ["x_rtt_seconds_sum 2.5"])
+    }
+
+    func testEngineExposition() {
+        let recorder = StatsRecorder()
+        for _ in 0..<10 { recorder.recordCaptured() }
+        recorder.recordUnchanged()
+        recorder.recordSkipped(.inflight)
+        recorder.recordSkipped(.encoderQueue)
+        recorder.recordEncoded(processMs: 1.5)
+        recorder.recordSent(bytes: 5000, keyframe: true)
+        recorder.recordSent(bytes: 1000)
+        recorder.recordAck(rttMs: 8)
+        recorder.recordKeyframeRequest()
+
+        var gauges = MetricsGauges()
+        gauges.running = true
+        gauges.clients = 1
+        gauges.inflightFrames = 2
+        gauges.rttP95Ms = 12
+        let text = OpenMetrics.exposition(recorder.snapshot(timeMs: 0), gauges)
+
+        XCTAssertTrue(text.hasSuffix("\n# EOF\n"))
+        XCTAssertEqual(samples(text, "daylight_mirror_running"), ["daylight_mirror_running 1.0"])
+        XCTAssertEqual(samples(text, "daylight_mirror_frames_captured_total"), ["daylight_mirror_frames_captured_total 10"])
+        XCTAssertEqual(samples(text, "daylight_mirror_keyframes_sent_total"), ["daylight_mirror_keyframes_sent_total 1"])
+        XCTAssertEqual(samples(text, "daylight_mirror_sent_bytes_total"), ["daylight_mirror_sent_bytes_total 6000"])
+        XCTAssertEqual(samples(text, "daylight_mirror_frames_skipped_total"), [
+            "daylight_mirror_frames_skipped_total{reason=\"inflight\"} 1",
+            "daylight_mirror_frames_skipped_total{reason=\"encoder_queue\"} 1",
+            "daylight_mirror_frames_skipped_total{reason=\"unchanged\"} 1",
+        ])
+        XCTAssertEqual(samples(text, "daylight_mirror_receiver_keyframe_requests_total"),
+                       ["daylight_mirror_receiver_keyframe_requests_total 1"])
+        XCTAssertTrue(text.contains("daylight_mirror_rtt_recent_seconds{quantile=\"0.95\"} 0.012\n"))
+        XCTAssertTrue(text.contains("daylight_mirror_rtt_seconds_count 1\n"))
+
+        // Every sample belongs to the family declared before it.
+        var family = ""
+        for line in text.split(separator: "\n") where line != "# EOF" {
+            if line.hasPrefix("# TYPE ") {
+                family = String(line.split(separator: " ")[2])
+            } else if !line.hasPrefix("#") {
+                XCTAssertTrue(line.hasPrefix(family), "\(line) outside \(family)")
+            }
+        }
+    }
+}
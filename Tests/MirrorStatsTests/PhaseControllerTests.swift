@@ -0,0 +1,47 @@
+import XCTest
+@testable import MirrorStats
+
+final class PhaseControllerTests: XCTestCase {
+
+    private let periodUs: UInt32 = 16_667
+
+    /// Frame `seq` captured at `t` (seconds), sent 5 ms later, arriving 1 ms
+    /// after that and ready 3 ms later, shown at the next latch deadline of a
+    /// 60 Hz grid starting at 3 ms.
+    private func show(_ c: PhaseController, _ seq: UInt32, capturedAt t: Double) {
+        let send = t + 0.005, arrival = send + 0.001, ready = arrival + 0.003
+        let period = Double(periodUs) / 1e6
+        let latch = 0.003 + (((ready - 0.003) / period).rounded(.up)) * period
+        c.recordSend(seq, capturedAt: t, sentAt: send)
+        XCTAssertTrue(c.report(seq, arrivalToLatchUs: UInt32(((latch - arrival) * 1e6).rounded()),
+                               slackUs: UInt32(((latch - ready) * 1e6).rounded()), periodUs: periodUs,
+                               oneWay: 0.001))
+    }
+
+    func testFreeRunningUntilLocked() {
+        let c = PhaseController(fps: 60)
+        XCTAssertNil(c.nextTick(after: 0))
+        XCTAssertEqual(c.interval, 1.0 / 60, accuracy: 1e-6)
+        XCTAssertFalse(c.report(9, arrivalToLatchUs: 5000, slackUs: 1000, periodUs: periodUs, oneWay: 0.001))
+        for seq in UInt32(0)..<7 { show(c, seq, capturedAt: 0.007 + Double(seq) / 60) }
+        XCTAssertFalse(c.isLocked)
+        show(c, 7, capturedAt: 0.007 + 7.0 / 60)
+        XCTAssertTrue(c.isLocked)
+        c.reset()
+        XCTAssertFalse(c.isLocked)
+        XCTAssertEqual(c.reports, 0)
+    }
+
+    func testSteeredTicksAreReadyJustBeforeTheLatch() {
+        let c = PhaseController(fps: 60)
+        for seq in UInt32(0)..<20 { show(c, seq, capturedAt: 0.007 + Double(seq) / 60) }
+        XCTAssertEqual(c.delayMs, 9, accuracy: 0.01)
+        XCTAssertEqual(c.periodMs, 16.667, accuracy: 0.01)
+        XCTAssertEqual(c.slackMs, 3.667, accuracy: 0.01)     // free-running, 7 ms after the grid
+
+        let tick = c.nextTick(after: 20.0 / 60)!
+        XCTAssertGreaterThanOrEqual(tick, 20.0 / 60 + 0.008)
+        show(c, 20, capturedAt: tick)
+        XCTAssertEqual(c.slackMs, 1, accuracy: 0.002)          // the 1 ms margin
+    }
+}
@@ -0,0 +1,117 @@
+import XCTest
+@testable import MirrorStats
+
+final class RTTWindowTests: XCTestCase {
+
+    /// The sort-per-ACK computation TCPServer used before RTTWindow.
+    private func reference(_ window: ArraySlice<Double>) -> (min: Double, max: Double, avg: Double, p95: Double) {
+        let sorted = window.sorted()
+        let p95Index = min(Int(Double(sorted.count) * 0.95), sorted.count - 1)
+        return (sorted.first!, sorted.last!, sorted.reduce(0, +) / Double(sorted.count), sorted[p95Index])
+    }
+
+    private func randomRTTs(_ n: Int, seed: UInt64) -> [Double] {
+        var state = seed
+        return (0..<n).map { _ in
+            state = state &* 6364136223846793005 &+ 1442695040888963407
+            let u = Double(state >> 11) / Double(1 << 53)
+            // Mostly 5-20 ms with occasional spikes, like USB RTTs.
+            return u < 0.97 ? 5 + u * 15 : 40 + u * 200
+        }
+    }
+
+    // MARK: - Window
+
+    func testEmptyWindowReadsZero() {
+        let w = RTTWindow(capacity: 8)
+        XCTAssertEqual(w.count, 0)
+        XCTAssertEqual(w.average, 0)
+        XCTAssertEqual(w.min, 0)
+        XCTAssertEqual(w.max, 0)
+        XCTAssertEqual(w.quantile(0.95), 0)
+    }
+
+    func testMatchesSortedReferenceOverSlidingWindow() {
+        let samples = randomRTTs(2000, seed: 42)
+        var w = RTTWindow(capacity: 150)
+        for (i, rtt) in samples.enumerated() {
+            w.add(rtt)
+            let ref = reference(samples[max(0, i - 149)...i])
+            XCTAssertEqual(w.count, min(i + 1, 150))
+            XCTAssertEqual(w.last, rtt)
+            XCTAssertEqual(w.min, ref.min, "min at sample \(i)")
+            XCTAssertEqual(w.max, ref.max, "max at sample \(i)")
+            XCTAssertEqual(w.average, ref.avg, accuracy: 1e-9, "avg at sample \(i)")
+            // Histogram quantile: within one bucket (1/16 octave, ~4.5%).
+            XCTAssertEqual(w.quantile(0.95), ref.p95, accuracy: ref.p95 * 0.045, "p95 at sample \(i)")
+        }
+    }
+
+    func testEvictionForgetsOldExtremes() {
+        var w = RTTWindow(capacity: 4)
+        for rtt in [100.0, 1, 2, 3] { w.add(rtt) }
+        XCTAssertEqual(w.max, 100)
+        XCTAssertEqual(w.min, 1)
+        w.add(4)
+        XCTAssertEqual(w.max, 4, "100 ms left the window")
+        w.add(5)
+        XCTAssertEqual(w.min, 2, "1 ms left the window")
+        XCTAssertEqual(w.average, (2 + 3 + 4 + 5) / 4)
+        XCTAssertEqual(w.histogram.total, 4)
+    }
+
+    func testMonotonicInputsKeepExtremesExact() {
+        // Rising then falling sequences are the worst case for the monotonic queues.
+        var w = RTTWindow(capacity: 16)
+        for i in 0..<64 { w.add(Double(i)) }
+        XCTAssertEqual(w.min, 48)
+        XCTAssertEqual(w.max, 63)
+        for i in (0..<64).reversed() { w.add(Double(i)) }
+        XCTAssertEqual(w.min, 0)
+        XCTAssertEqual(w.max, 15)
+    }
+
+    func testResetEmptiesWindow() {
+        var w = RTTWindow(capacity: 4)
+        for rtt in [5.0, 6, 7] { w.add(rtt) }
+        w.reset()
+        XCTAssertEqual(w.count, 0)
+        XCTAssertEqual(w.histogram.total, 0)
+        w.add(9)
+        XCTAssertEqual(w.min, 9)
+        XCTAssertEqual(w.average, 9)
+    }
+
+    // MARK: - Histogram
+
+    func testHistogramBucketsAreMonotonic() {
+        var previous = -1
+        for ms in stride(from: 0.0, through: 10_000, by: 0.37) {
+            let b = LatencyHistogram.bucket(for: ms)
+            XCTAssertGreaterThanOrEqual(b, previous)
+            XCTAssertLessThan(b, LatencyHistogram.bucketCount)
+            previous = b
+        }
+        XCTAssertEqual(LatencyHistogram.bucket(for: 0), 0)
+        XCTAssertEqual(LatencyHistogram.bucket(for: 1e9), LatencyHistogram.bucketCount - 1)
+    }
+
+    func testHistogramValueFallsInsideItsBucket() {
+        for ms in [0.2, 1.0, 7.5, 16.7, 33.3, 250, 4000] {
+            let b = LatencyHistogram.bucket(for: ms)
+            XCTAssertLessThanOrEqual(LatencyHistogram.lowerBound(of: b), ms)
+            XCTAssertGreaterThan(LatencyHistogram.lowerBound(of: b + 1), ms)
+        }
+    }
+
+    func testHistogramRemoveUndoesAdd() {
+        var h = LatencyHistogram()
+        h.add(12)
+        h.add(30)
+        h.remove(12)
+        XCTAssertEqual(h.total, 1)
+        XCTAssertEqual(h.quantile(0.5), 30, accuracy: 30 * 0.045)
+        h.remove(12)   // not present: ignored
+        XCTAssertEqual(h.total, 1)
+    }
+}
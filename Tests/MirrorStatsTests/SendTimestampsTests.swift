@@ -0,0 +1,76 @@
+import XCTest
+@testable import MirrorStats
+
+final class SendTimestampsTests: XCTestCase {
+
+    func testAckReturnsSendTimeOnce() {
+        let t = SendTimestamps(capacity: 8)
+        t.record(5, at: 1.25)
+        t.record(6, at: 1.5)
+        XCTAssertEqual(t.inflight, 2)
+        XCTAssertEqual(t.ack(6), 1.5)
+        XCTAssertNil(t.ack(6), "duplicate ACK")
+        XCTAssertNil(t.ack(14), "same slot as 6, never sent")
+        XCTAssertEqual(t.inflight, 1)
+    }
+
+    func testCapacityRoundsUpAndOldFramesExpire() {
+        let t = SendTimestamps(capacity: 300)
+        XCTAssertEqual(t.capacity, 512)
+        for seq in UInt32(0)..<600 { t.record(seq, at: Double(seq)) }
+        XCTAssertEqual(t.inflight, 512)
+        XCTAssertEqual(t.expired, 88)
+        XCTAssertNil(t.ack(10), "overwritten by seq 522")
+        XCTAssertEqual(t.ack(522), 522)
+    }
+
+    func testResetForgetsPendingFrames() {
+        let t = SendTimestamps(capacity: 16)
+        for seq in UInt32(1)...10 { t.record(seq, at: 0) }
+        t.reset()
+        XCTAssertEqual(t.inflight, 0)
+        XCTAssertNil(t.ack(3), "ACK from the previous connection")
+        t.record(3, at: 2)
+        XCTAssertEqual(t.ack(3), 2)
+    }
+
+    /// Random sends, ACKs and resets against the dictionary TCPServer used to
+    /// keep, with its eviction replaced by "a later send on the same slot".
+    func testRandomOperationsMatchDictionaryModel() {
+        var state: UInt64 = 7
+        func next() -> UInt32 {
+            state = state &* 6364136223846793005 &+ 1442695040888963407
+            return UInt32(truncatingIfNeeded: state >> 33)
+        }
+        for capacity in [UInt32(4), 64, 512] {
+            let t = SendTimestamps(capacity: capacity)
+            let mask = capacity - 1
+            var model: [UInt32: Double] = [:]
+            var seq = next()
+            var now = 0.0
+            for step in 0..<50_000 {
+                let op = next() % 100
+                now += Double(next() % 5000) / 1e6
+                if op < 50 {
+                    if op == 0 { seq &+= next() % (3 * capacity) }
+                    if let stale = model.keys.first(where: { $0 & mask == seq & mask }) {
+                        model[stale] = nil
+                    }
+                    t.record(seq, at: now)
+                    model[seq] = (now * 1e6).rounded() / 1e6
+                    seq &+= 1
+                } else if op < 99 {
+                    let target = seq &- 1 &- next() % (2 * capacity + 2)
+                    let got = t.ack(target)
+                    let want = model.removeValue(forKey: target)
+                    XCTAssertEqual(got.map { ($0 * 1e6).rounded() }, want.map { ($0 * 1e6).rounded() },
+                                   "ack \(target) at step \(step)")
+                } else {
+                    t.reset()
+                    model.removeAll()
+                }
+                XCTAssertEqual(t.inflight, model.count, "inflight at step \(step)")
+            }
+        }
+    }
+}
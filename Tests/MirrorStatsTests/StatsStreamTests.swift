@@ -0,0 +1,113 @@
+import XCTest
+@testable import MirrorStats
+
+final class StatsStreamTests: XCTestCase {
+
+    func testSparseHistogramRoundTrip() {
+        var h = LatencyHistogram()
+        XCTAssertEqual(h.sparseDescription, "-")
+        XCTAssertEqual(LatencyHistogram(sparse: "-"), h)
+        for ms in [0.05, 3.0, 3.1, 12.0, 20_000.0] { h.add(ms) }
+        let parsed = LatencyHistogram(sparse: h.sparseDescription)
+        XCTAssertEqual(parsed, h)
+        XCTAssertEqual(parsed?.total, 5)
+        XCTAssertNil(LatencyHistogram(sparse: "3:x"))
+        XCTAssertNil(LatencyHistogram(sparse: "\(LatencyHistogram.bucketCount):1"))
+    }
+
+    func testHistogramSubtractAndMerge() {
+        var cumulative = LatencyHistogram()
+        cumulative.add(5)
+        let earlier = cumulative
+        cumulative.add(5)
+        cumulative.add(40)
+        var delta = cumulative.subtracting(earlier)
+        XCTAssertEqual(delta.total, 2)
+        XCTAssertEqual(delta.counts[LatencyHistogram.bucket(for: 5)], 1)
+        delta.merge(earlier)
+        XCTAssertEqual(delta, cumulative)
+    }
+
+    func testDeltaBetweenSnapshots() {
+        let recorder = StatsRecorder()
+        let s0 = recorder.snapshot(timeMs: 1000)
+        for i in 0..<120 {
+            recorder.recordCaptured()
+            if i % 4 == 0 {
+                recorder.recordEncoded(processMs: 1.5)
+                recorder.recordSent(bytes: 1000)
+                recorder.recordAck(rttMs: Double(10 + i % 8))
+            } else {
+                recorder.recordUnchanged()
+            }
+        }
+        recorder.recordSkipped(.inflight)
+        recorder.recordEncoderOutput(EncodeAttribution(captureToSubmitMs: 2, queueMs: 1, encodeMs: 4))
+        let s1 = recorder.snapshot(timeMs: 2000)
+        let d = StatsDelta(from: s0, to: s1)
+        XCTAssertEqual(d.intervalMs, 1000)
+        XCTAssertEqual(d.captured, 120)
+        XCTAssertEqual(d.encoded, 30)
+        XCTAssertEqual(d.sent, 30)
+        XCTAssertEqual(d.unchanged, 90)
+        XCTAssertEqual(d.skipped, 1)
+        XCTAssertEqual(d.bytes, 30_000)
+        XCTAssertEqual(d.rtt.total, 30)
+        XCTAssertEqual(d.rate(d.captured), 120, accuracy: 1e-9)
+        XCTAssertEqual(d.process.quantile(0.5), 1.5, accuracy: 1.5 * 0.05)
+        XCTAssertEqual(d.encode.total, 1)
+        XCTAssertEqual(d.captureToEncoded.quantile(0.5), 7, accuracy: 7 * 0.05)
+
+        // Nothing happened: an all-zero line, not a repeat of the last one.
+        let idle = StatsDelta(from: s1, to: recorder.snapshot(timeMs: 3000))
+        XCTAssertEqual(idle.captured, 0)
+        XCTAssertEqual(idle.rtt.total, 0)
+    }
+
+    func testLineRoundTrip() {
+        var d = StatsDelta()
+        d.timeMs = 81_000
+        d.intervalMs = 1000
+        d.captured = 120
+        d.encoded = 31
+        d.sent = 31
+        d.unchanged = 89
+        d.bytes = 412_345
+        d.acks = 31
+        d.rtt.add(3)
+        d.rtt.add(7.5)
+        d.process.add(1.2)
+        d.encode.add(4.5)
+        d.captureToEncoded.add(7)
+        let line = d.line
+        XCTAssertTrue(line.hasPrefix("STATS t_ms=81000 interval_ms=1000 captured=120 "))
+        XCTAssertFalse(line.contains("\n"))
+        XCTAssertEqual(StatsDelta(line: line), d)
+        XCTAssertEqual(StatsDelta(line: line + " future_field=7"), d)
+        XCTAssertNil(StatsDelta(line: "OK subscribed interval_ms=1000"))
+        XCTAssertNil(StatsDelta(line: "STATS captured=lots"))
+    }
+
+    func testMergedLinesGiveWindowQuantiles() {
+        var window = StatsDelta()
+        for second in 0..<10 {
+            var d = StatsDelta()
+            d.timeMs = Double(second + 1) * 1000
+            d.intervalMs = 1000
+            d.acks = 100
+            for i in 0..<100 { d.rtt.add(second == 9 && i >= 50 ? 80 : 10) }
+            window.merge(d)
+        }
+        XCTAssertEqual(window.intervalMs, 10_000)
+        XCTAssertEqual(window.rate(window.acks), 100, accuracy: 1e-9)
+        XCTAssertEqual(window.rtt.quantile(0.5), 10, accuracy: 0.5)
+        XCTAssertEqual(window.rtt.quantile(0.99), 80, accuracy: 4)
+    }
+
+    func testHeaderDescribesBuckets() {
+        let header = StatsDelta.header(intervalMs: 250)
+        XCTAssertTrue(header.hasPrefix("OK subscribed interval_ms=250 "))
+        XCTAssertTrue(header.contains("buckets=\(LatencyHistogram.bucketCount)"))
+        XCTAssertTrue(header.contains("lowest_ms=0.125"))
+    }
+}
@@ -0,0 +1,89 @@
+import XCTest
+@testable import MirrorStats
+
+final class UpstreamParserTests: XCTestCase {
+
+    private func ack(_ seq: UInt32) -> [UInt8] {
+        [0xDA, 0x7A, UInt8(seq & 0xFF), UInt8((seq >> 8) & 0xFF),
+         UInt8((seq >> 16) & 0xFF), UInt8(seq >> 24)]
+    }
+
+    private func command(_ cmd: UInt8, _ value: UInt8) -> [UInt8] {
+        [0xDA, 0x7F, cmd, value]
+    }
+
+    private func vsyncReport(_ seq: UInt32, _ arrivalToLatch: UInt32, _ slack: UInt32, _ period: UInt32) -> [UInt8] {
+        [0xDA, 0x7B] + [seq, arrivalToLatch, slack, period].flatMap { v in
+            (0..<4).map { UInt8((v >> ($0 * 8)) & 0xFF) }
+        }
+    }
+
+    private func parse(_ parser: inout UpstreamParser, _ bytes: [UInt8]) -> [UpstreamPacket] {
+        var out: [UpstreamPacket] = []
+        parser.feed(bytes) { out.append($0) }
+        return out
+    }
+
+    func testAcksAndCommandsInOneRead() {
+        var p = UpstreamParser()
+        let packets = parse(&p, ack(1) + command(0x06, 0x09) + ack(0x0403_0201) + command(0x05, 1))
+        XCTAssertEqual(packets, [.ack(seq: 1), .command(cmd: 0x06, value: 0x09),
+                                 .ack(seq: 0x0403_0201), .command(cmd: 0x05, value: 1)])
+        XCTAssertEqual(p.pending, 0)
+    }
+
+    func testPacketsSplitAtEveryByte() {
+        let stream = ack(7) + command(0x06, 0x02) + ack(8) + ack(9)
+        var p = UpstreamParser()
+        var out: [UpstreamPacket] = []
+        for byte in stream {
+            p.feed([byte]) { out.append($0) }
+        }
+        XCTAssertEqual(out, [.ack(seq: 7), .command(cmd: 0x06, value: 0x02), .ack(seq: 8), .ack(seq: 9)])
+        XCTAssertEqual(p.pending, 0)
+    }
+
+    func testPartialAckWaitsForTheRest() {
+        var p = UpstreamParser()
+        let bytes = ack(300)
+        XCTAssertEqual(parse(&p, Array(bytes[0..<5])), [])
+        XCTAssertEqual(p.pending, 5)
+        XCTAssertEqual(parse(&p, [bytes[5]]), [.ack(seq: 300)])
+    }
+
+    func testGarbageIsSkippedUntilMagic() {
+        var p = UpstreamParser()
+        let packets = parse(&p, [0x00, 0x13, 0xDA] + ack(5))
+        XCTAssertEqual(packets, [.ack(seq: 5)])
+        XCTAssertEqual(p.skippedBytes, 3)
+    }
+
+    func testLongGarbageRunDropsBuffer() {
+        var p = UpstreamParser()
+        let junk = [UInt8](repeating: 0x55, count: UpstreamParser.maxSkip + 10)
+        XCTAssertEqual(parse(&p, junk + ack(1)), [])
+        XCTAssertEqual(p.pending, 0)
+        // Back in sync on the next read.
+        XCTAssertEqual(parse(&p, ack(2)), [.ack(seq: 2)])
+    }
+
+    func testVsyncReportsWaitForAllTheirBytes() {
+        var p = UpstreamParser()
+        let report = vsyncReport(42, 9_000, 1_200, 16_667)
+        XCTAssertEqual(report.count, UpstreamParser.vsyncReportSize)
+        let stream = ack(41) + report + ack(42)
+        XCTAssertEqual(parse(&p, Array(stream[0..<10])), [.ack(seq: 41)])
+        XCTAssertEqual(p.pending, 4)
+        XCTAssertEqual(parse(&p, Array(stream[10...])),
+                       [.vsyncReport(seq: 42, arrivalToLatchUs: 9_000, slackUs: 1_200, periodUs: 16_667),
+                        .ack(seq: 42)])
+        XCTAssertEqual(p.skippedBytes, 0)
+    }
+
+    func testParsesDataReads() {
+        var p = UpstreamParser()
+        var out: [UpstreamPacket] = []
+        p.feed(Data(ack(11) + ack(12))) { out.append($0) }
+        XCTAssertEqual(out, [.ack(seq: 11), .ack(seq: 12)])
+    }
+}
@@ -0,0 +1,130 @@
+// mirror_codec.c — Codec table: wire id, MIME type and decoder format keys, plus
+// the random access scan used when joining a stream mid-GOP.
+
+#include "mirror_codec.h"
+#include "mirror_protocol.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Every codec: ask for the low-latency decode path (API 30+). Vendor keys
+// are per SoC and chosen by calibration (mirror_tuning.c).
+static const mirror_format_key avc_keys[] = {
+    { "low-latency", 1 },
+    { NULL, 0 },
+};
+
+static const mirror_format_key hevc_keys[] = {
+    { "low-latency", 1 },
+    { NULL, 0 },
+};
+
+static const mirror_format_key av1_keys[] = {
+    { "low-latency", 1 },
+    { NULL, 0 },
+};
+
+static const mirror_codec_info codecs[MIRROR_CODEC_COUNT] = {
+    [MIRROR_CODEC_HEVC] = { MIRROR_CODEC_HEVC, "hevc", "video/hevc", hevc_keys },
+    [MIRROR_CODEC_H264] = { MIRROR_CODEC_H264, "h264", "video/avc", avc_keys },
+    [MIRROR_CODEC_AV1] = { MIRROR_CODEC_AV1, "av1", "video/av01", av1_keys },
+};
+
+const mirror_codec_info *mirror_codec_get(uint8_t id) {
+    return id < MIRROR_CODEC_COUNT ? &codecs[id] : NULL;
+}
+
+const mirror_codec_info *mirror_codec_find(const char *mime_or_name) {
+    for (int i = 0; i < MIRROR_CODEC_COUNT; i++) {
+        if (strcmp(codecs[i].mime, mime_or_name) == 0 || strcmp(codecs[i].name, mime_or_name) == 0) {
+            return &codecs[i];
+        }
+    }
+    return NULL;
+}
+
+// MARK: - Random access points
+
+// SEI payload type of recovery_point() in both H.264 and HEVC.
+#define SEI_RECOVERY_POINT 6
+
+// Reads RBSP bytes, skipping emulation prevention bytes (00 00 03).
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    int zeros;
+} rbsp_reader;
+
+static int rbsp_byte(rbsp_reader *r) {
+    if (r->p >= r->end) return -1;
+    uint8_t b = *r->p++;
+    if (r->zeros >= 2 && b == 0x03) {
+        r->zeros = 0;
+        if (r->p >= r->end) return -1;
+        b = *r->p++;
+    }
+    r->zeros = b == 0 ? r->zeros + 1 : 0;
+    return b;
+}
+
+// sei_message() type or size: 0xFF bytes each add 255, the last byte ends it.
+static int sei_value(rbsp_reader *r) {
+    int value = 0, b;
+    while ((b = rbsp_byte(r)) == 0xFF) value += 255;
+    return b < 0 ? -1 : value + b;
+}
+
+static int sei_has_recovery_point(const uint8_t *payload, const uint8_t *end) {
+    rbsp_reader r = { payload, end, 0 };
+    // Stop at rbsp_trailing_bits (0x80) or when the NAL runs out.
+    while (r.p < r.end && *r.p != 0x80) {
+        int type = sei_value(&r);
+        int size = sei_value(&r);
+        if (type < 0 || size < 0) return 0;
+        if (type == SEI_RECOVERY_POINT) return 1;
+        for (int i = 0; i < size; i++) {
+            if (rbsp_byte(&r) < 0) return 0;
+        }
+    }
+    return 0;
+}
+
+// Start of the NAL after the next 00 00 01 at or after p; end if there is none.
+static const uint8_t *next_nal(const uint8_t *p, const uint8_t *end) {
+    for (; end - p >= 3; p++) {
+        if (p[2] > 1) {
+            p += 2;
+        } else if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            return p + 3;
+        }
+    }
+    return end;
+}
+
+int mirror_codec_random_access(const mirror_codec_info *codec, const uint8_t *au, size_t len) {
+    int hevc = codec->id == MIRROR_CODEC_HEVC;
+    if (!hevc && codec->id != MIRROR_CODEC_H264) return 0;
+
+    const uint8_t *end = au + len;
+    int params = 0, irap = 0, recovery = 0;
+    const uint8_t *nal = next_nal(au, end);
+    while (nal < end) {
+        const uint8_t *next = next_nal(nal, end);
+        // Up to the next 00 00 01 (a 4-byte start code leaves one zero behind).
+        const uint8_t *nal_end = next < end ? next - 3 : end;
+        if (hevc) {
+            uint8_t type = (nal[0] >> 1) & 0x3F;
+            if (type >= 32 && type <= 34) params |= 1 << (type - 32);     // VPS, SPS, PPS
+            else if (type >= 16 && type <= 21) irap = 1;                   // BLA, IDR, CRA
+            else if (type == 39 && nal_end - nal > 2) recovery |= sei_has_recovery_point(nal + 2, nal_end);
+        } else {
+            uint8_t type = nal[0] & 0x1F;
+            if (type == 7 || type == 8) params |= 1 << (type - 7);         // SPS, PPS
+            else if (type == 5) irap = 1;                                  // IDR
+            else if (type == 6 && nal_end - nal > 1) recovery |= sei_has_recovery_point(nal + 1, nal_end);
+        }
+        nal = next;
+    }
+    int all_params = hevc ? 0x7 : 0x3;
+    return params == all_params && (irap || recovery);
+}
@@ -0,0 +1,42 @@
+// mirror_codec.h — Video codecs the receiver can decode, by wire id and MIME type.
+//
+// The protocol names codecs by MIRROR_CODEC_* id (mirror_protocol.h); decoder
+// backends configure by MIME type plus a few per-codec format keys. This table is
+// the only place the two meet, so adding a codec is one entry here and one id.
+// The keys here are the defaults for every device; mirror_tuning.h layers
+// per-SoC keys on top. The Annex B scan below is the only bitstream parsing
+// the receiver does.
+
+#ifndef MIRROR_CODEC_H
+#define MIRROR_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// An int32 AMediaFormat key set when configuring the decoder. Keys a decoder
+// does not know are ignored by MediaCodec, so vendor keys are safe everywhere.
+typedef struct {
+    const char *key;
+    int32_t value;
+} mirror_format_key;
+
+typedef struct {
+    uint8_t id;                     // MIRROR_CODEC_*
+    const char *name;               // short name for logs and tool options ("hevc")
+    const char *mime;               // "video/hevc"
+    const mirror_format_key *keys;  // terminated by a NULL key
+} mirror_codec_info;
+
+// NULL if the id is unknown.
+const mirror_codec_info *mirror_codec_get(uint8_t id);
+// Match by MIME type or short name; NULL if neither matches.
+const mirror_codec_info *mirror_codec_find(const char *mime_or_name);
+
+// Whether a fresh decoder can start at this access unit even though it is not
+// flagged as a keyframe: it carries parameter sets plus an IRAP picture (HEVC
+// IDR/CRA/BLA, H.264 IDR) or a recovery point SEI, as encoders in
+// gradual intra-refresh mode emit instead of periodic IDRs. Scans Annex B
+// start codes; always 0 for AV1 (its keyframes are always flagged).
+int mirror_codec_random_access(const mirror_codec_info *codec, const uint8_t *au, size_t len);
+
+#endif
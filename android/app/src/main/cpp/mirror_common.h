@@ -0,0 +1,35 @@
+// mirror_common.h — Logging and clock helpers shared by the Android and host builds.
+//
+// On Android, LOGI/LOGE go to logcat under the "DaylightMirror" tag. Host builds
+// (Linux CI, benchmarks) print the same lines to stderr so output is comparable.
+
+#ifndef MIRROR_COMMON_H
+#define MIRROR_COMMON_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define TAG "DaylightMirror"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#else
+#include <stdio.h>
+extern int mirror_log_quiet;  // set by host tests/benchmarks to silence LOGI
+#define LOGI(...) do { if (!mirror_log_quiet) { fprintf(stderr, "I/" TAG ": " __VA_ARGS__); fputc('\n', stderr); } } while (0)
+#define LOGE(...) do { fprintf(stderr, "E/" TAG ": " __VA_ARGS__); fputc('\n', stderr); } while (0)
+#endif
+
+static inline double ms_diff(struct timespec a, struct timespec b) {
+    return ((b.tv_sec - a.tv_sec) * 1000.0) + ((b.tv_nsec - a.tv_nsec) / 1e6);
+}
+
+static inline int64_t mirror_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif
@@ -0,0 +1,77 @@
+// mirror_decoder.h — Decoder backend interface for the receiver core.
+//
+// Mirrors the slice of the AMediaCodec API the receive loop uses, so the Android
+// backend (mirror_native.c) is a thin wrapper around MediaCodec and host builds can
+// plug in the mock decoder (host/mock_decoder.c) without any NDK headers.
+//
+// All calls are made with the receiver's codec mutex held; backends need no locking
+// of their own unless they expose state to other threads.
+
+#ifndef MIRROR_DECODER_H
+#define MIRROR_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "mirror_codec.h"
+
+// Same values as AMEDIACODEC_BUFFER_FLAG_KEY_FRAME and _END_OF_STREAM.
+#define MIRROR_BUFFER_FLAG_KEY_FRAME 2
+#define MIRROR_BUFFER_FLAG_END_OF_STREAM 4
+
+typedef struct {
+    int32_t size;
+    int64_t pts_us;
+    uint32_t flags;
+} mirror_output_info;
+
+// Luma plane of a decoded frame held in memory (8-bit Y, row stride in bytes).
+typedef struct {
+    const uint8_t *y;
+    uint32_t width, height;
+    uint32_t stride;
+} mirror_output_image;
+
+typedef struct {
+    const char *name;
+    // (Re)build the decoder for the given codec (MIME type and format keys) and
+    // stream size. Returns 1 on success, 0 on failure.
+    int (*configure)(void *ctx, const mirror_codec_info *codec, uint32_t width, uint32_t height);
+    // Stop and free the decoder. Safe to call when nothing is configured.
+    void (*release)(void *ctx);
+    // Returns an input slot index, or a negative value if none freed up within timeout_us.
+    ssize_t (*dequeue_input)(void *ctx, int64_t timeout_us);
+    uint8_t *(*get_input)(void *ctx, size_t idx, size_t *capacity);
+    int (*queue_input)(void *ctx, size_t idx, size_t len, int64_t pts_us, uint32_t flags);
+    // Returns an output index, or a negative value if nothing is ready within timeout_us.
+    ssize_t (*dequeue_output)(void *ctx, mirror_output_info *info, int64_t timeout_us);
+    int (*release_output)(void *ctx, size_t idx, int render);
+    // Render output for display at present_ns (CLOCK_MONOTONIC; the compositor
+    // latches it for the vsync at that time and drops older buffers due by then:
+    // AMediaCodec_releaseOutputBufferAtTime). Optional; without it, or before the
+    // platform ticks the receiver's vsync clock, output renders at once.
+    int (*release_output_at)(void *ctx, size_t idx, int64_t present_ns);
+    // Drop every queued input and pending output, keeping the configuration
+    // (AMediaCodec_flush). The next input must be a keyframe. Returns 1 on
+    // success. Optional; the watchdog rebuilds the decoder without it.
+    int (*flush)(void *ctx);
+    // Send output to the platform's current window (attach=1) or to a sink that
+    // is never shown (attach=0), keeping the decoder and its reference frames
+    // (AMediaCodec_setOutputSurface). Returns 1 on success. Optional; without it
+    // the decoder is released while detached and rebuilt on attach.
+    int (*set_output)(void *ctx, int attach);
+    // Like configure, but with no surface: output stays in memory and is read
+    // with get_output (headless benchmarks, mirror_replay.h). Optional.
+    int (*configure_memory)(void *ctx, const mirror_codec_info *codec, uint32_t width, uint32_t height);
+    // Luma plane of held output idx, valid until it is released. Returns 1 on
+    // success; only after configure_memory.
+    int (*get_output)(void *ctx, size_t idx, mirror_output_image *img);
+} mirror_decoder_ops;
+
+typedef struct {
+    const mirror_decoder_ops *ops;
+    void *ctx;
+} mirror_decoder;
+
+#endif
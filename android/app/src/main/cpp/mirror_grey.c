@@ -0,0 +1,138 @@
+// mirror_grey.c — LZ4 greyscale frame decoder (delta and tile layouts).
+
+#include "mirror_grey.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "lz4.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void mirror_grey_init(mirror_grey_decoder *d) {
+    memset(d, 0, sizeof(*d));
+}
+
+void mirror_grey_free(mirror_grey_decoder *d) {
+    free(d->frame);
+    free(d->scratch);
+    memset(d, 0, sizeof(*d));
+}
+
+static int ensure_size(mirror_grey_decoder *d, uint32_t width, uint32_t height) {
+    if (d->frame && d->width == width && d->height == height) return 1;
+    size_t n = (size_t)width * height;
+    uint8_t *frame = (uint8_t *)calloc(n, 1);
+    if (!frame) return 0;
+    free(d->frame);
+    d->frame = frame;
+    d->width = width;
+    d->height = height;
+    d->have_keyframe = 0;
+    return 1;
+}
+
+static uint8_t *scratch(mirror_grey_decoder *d, size_t n) {
+    if (n > d->scratch_capacity) {
+        uint8_t *buf = (uint8_t *)realloc(d->scratch, n);
+        if (!buf) return NULL;
+        d->scratch = buf;
+        d->scratch_capacity = n;
+    }
+    return d->scratch;
+}
+
+// dst ^= src. Word-at-a-time; the compiler widens this to NEON/SSE.
+static void xor_into(uint8_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < n; i++) dst[i] ^= src[i];
+}
+
+static int decode_delta(mirror_grey_decoder *d, int keyframe, const uint8_t *payload, size_t len) {
+    size_t n = (size_t)d->width * d->height;
+    if (keyframe) {
+        int got = LZ4_decompress_safe((const char *)payload, (char *)d->frame, (int)len, (int)n);
+        if (got != (int)n) {
+            LOGE("Grey keyframe: LZ4 returned %d, expected %zu", got, n);
+            d->have_keyframe = 0;
+            return 0;
+        }
+        d->have_keyframe = 1;
+        return 1;
+    }
+
+    uint8_t *delta = scratch(d, n);
+    if (!delta) return 0;
+    int got = LZ4_decompress_safe((const char *)payload, (char *)delta, (int)len, (int)n);
+    if (got != (int)n) {
+        LOGE("Grey delta: LZ4 returned %d, expected %zu", got, n);
+        d->have_keyframe = 0;
+        return 0;
+    }
+    xor_into(d->frame, delta, n);
+    return 1;
+}
+
+static int decode_tiles(mirror_grey_decoder *d, int keyframe, const uint8_t *payload, size_t len) {
+    if (len < 4) return 0;
+    uint32_t tile = read_le16(payload);
+    uint32_t count = read_le16(payload + 2);
+    if (tile == 0) return 0;
+    uint32_t cols = (d->width + tile - 1) / tile;
+    uint32_t rows = (d->height + tile - 1) / tile;
+    size_t index_bytes = (size_t)count * 2;
+    if (len < 4 + index_bytes) return 0;
+    const uint8_t *indices = payload + 4;
+
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t idx = read_le16(indices + 2 * i);
+        if (idx >= cols * rows) return 0;
+        uint32_t tx = idx % cols, ty = idx / cols;
+        uint32_t w = tx * tile + tile > d->width ? d->width - tx * tile : tile;
+        uint32_t h = ty * tile + tile > d->height ? d->height - ty * tile : tile;
+        total += (size_t)w * h;
+    }
+
+    uint8_t *pixels = scratch(d, total ? total : 1);
+    if (!pixels) return 0;
+    const uint8_t *block = indices + index_bytes;
+    int got = LZ4_decompress_safe((const char *)block, (char *)pixels,
+                                  (int)(len - 4 - index_bytes), (int)total);
+    if (got != (int)total) {
+        LOGE("Grey tiles: LZ4 returned %d, expected %zu", got, total);
+        d->have_keyframe = 0;
+        return 0;
+    }
+
+    const uint8_t *src = pixels;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t idx = read_le16(indices + 2 * i);
+        uint32_t tx = idx % cols, ty = idx / cols;
+        uint32_t w = tx * tile + tile > d->width ? d->width - tx * tile : tile;
+        uint32_t h = ty * tile + tile > d->height ? d->height - ty * tile : tile;
+        uint8_t *dst = d->frame + (size_t)ty * tile * d->width + tx * tile;
+        for (uint32_t y = 0; y < h; y++) {
+            memcpy(dst, src, w);
+            dst += d->width;
+            src += w;
+        }
+    }
+    if (keyframe) d->have_keyframe = 1;
+    return 1;
+}
+
+int mirror_grey_decode(mirror_grey_decoder *d, uint32_t width, uint32_t height,
+                       uint8_t flags, const uint8_t *payload, size_t len) {
+    if (!ensure_size(d, width, height)) return 0;
+    int keyframe = (flags & FLAG_KEYFRAME) != 0;
+    if (!keyframe && !d->have_keyframe) return 0;
+    if (flags & FLAG_GREY_TILES) return decode_tiles(d, keyframe, payload, len);
+    return decode_delta(d, keyframe, payload, len);
+}
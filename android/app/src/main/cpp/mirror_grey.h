@@ -0,0 +1,40 @@
+// mirror_grey.h — CPU decoder for LZ4 greyscale frames (FLAG_GREY_LZ4).
+//
+// The Mac sends HEVC; the Linux sender (host/tools/mirror_send.c) sends 8-bit
+// greyscale compressed with the vendored lz4.c in one of two payload layouts:
+//
+//   delta (FLAG_GREY_LZ4):
+//     LZ4 block that decompresses to width*height bytes — the frame itself on a
+//     keyframe, otherwise the XOR of this frame with the previous one.
+//
+//   tiles (FLAG_GREY_LZ4 | FLAG_GREY_TILES):
+//     [tile:2 LE] [count:2 LE] [index:2 LE × count] [LZ4 block]
+//     The block holds the absolute pixels of each listed tile (row-major tile
+//     index, tiles clipped at the right/bottom edge), concatenated row by row.
+//
+// Width and height come from the last CMD_RESOLUTION.
+
+#ifndef MIRROR_GREY_H
+#define MIRROR_GREY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint8_t *frame;         // current greyscale frame, width*height bytes
+    uint8_t *scratch;       // decompression target
+    size_t scratch_capacity;
+    int have_keyframe;      // deltas are dropped until the first keyframe
+} mirror_grey_decoder;
+
+void mirror_grey_init(mirror_grey_decoder *d);
+void mirror_grey_free(mirror_grey_decoder *d);
+
+// Decode one payload into d->frame. Returns 1 if the frame was updated, 0 if the
+// payload was dropped (corrupt, or a delta before the first keyframe).
+int mirror_grey_decode(mirror_grey_decoder *d, uint32_t width, uint32_t height,
+                       uint8_t flags, const uint8_t *payload, size_t len);
+
+#endif
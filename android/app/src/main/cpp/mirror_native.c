@@ -1,525 +1,752 @@
-// mirror_native.c — Daylight Mirror native receiver with MediaCodec HEVC decode.
+// mirror_native.c — Daylight Mirror Android glue: JNI, MediaCodec decoder, Surface.
 //
-// Receives HEVC Annex B NAL units over TCP (ADB reverse tunnel),
-// feeds them into a MediaCodec hardware decoder configured with a Surface,
-// and lets the hardware compositor render directly — zero CPU copy in the hot path.
+// The receive/parse/ACK loop lives in mirror_receiver.c and is platform-independent.
+// This file provides its two backends on Android:
+//   - a MediaCodec decoder configured with the SurfaceView's ANativeWindow, so the
+//     hardware compositor renders directly — zero CPU copy in the hot path. While
+//     the Surface is gone its output goes to an unread ImageReader instead, so
+//     the connection and decoder outlive screen-off and app switches
+//   - platform callbacks that resize the window, call back into MirrorActivity and
+//     blit LZ4 greyscale frames (Linux sender) into the window on the CPU
+//   - a Choreographer thread that ticks the receiver's vsync clock, so decoded
+//     frames are released for the vsync they can make
+//     (AMediaCodec_releaseOutputBufferAtTime) rather than whenever they are ready
+//   - frame-rendered callbacks (API 33+) that tell the receiver when each frame
+//     actually reached the display
+//   - a surface-less configuration whose output buffers are read in memory, for
+//     headless replay of recorded streams (nativeReplay, mirror_replay.h)
 //
-// Protocol: [0xDA 0x7E] [flags:1B] [seq:4B LE] [length:4B LE] [HEVC Annex B payload]
-//   flags bit 0: 1=IDR (keyframe), 0=inter frame
-// ACK:      [0xDA 0x7A] [seq:4B LE] — sent back after each frame is queued to decoder
+// Protocol: see mirror_protocol.h.
 
 #include <jni.h>
+#include <android/choreographer.h>
+#include <android/looper.h>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
-#include <android/log.h>
 #include <media/NdkMediaCodec.h>
 #include <media/NdkMediaFormat.h>
+#include <media/NdkImageReader.h>
+#include <dlfcn.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-#include <errno.h>
 #include <pthread.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netinet/tcp.h>
-#include <arpa/inet.h>
-#include <sys/resource.h>
-
-#ifndef AMEDIACODEC_BUFFER_FLAG_KEY_FRAME
-#define AMEDIACODEC_BUFFER_FLAG_KEY_FRAME 2
+#include <sys/system_properties.h>
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
 #endif
-#ifndef AMEDIAFORMAT_KEY_LOW_LATENCY
-#define AMEDIAFORMAT_KEY_LOW_LATENCY "low-latency"
-#endif
-
-#define TAG "DaylightMirror"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
-
-// Default resolution (updated dynamically via CMD_RESOLUTION from server)
-#define DEFAULT_FRAME_W 1024
-#define DEFAULT_FRAME_H 768
 
-#define MAGIC_FRAME_0 0xDA
-#define MAGIC_FRAME_1 0x7E
-#define MAGIC_CMD_1   0x7F
-#define MAGIC_ACK_1   0x7A
-#define FLAG_KEYFRAME 0x01
-#define FRAME_HEADER_SIZE 11
-#define CMD_BRIGHTNESS 0x01
-#define CMD_RESOLUTION 0x04
+#include "mirror_codec.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mirror_replay.h"
+#include "mirror_tuning.h"
 
-// Global state
+// Global state. g_window is swapped under g_receiver.codec_mutex.
 static ANativeWindow *g_window = NULL;
-static pthread_t g_decode_thread;
-static volatile int g_running = 0;
 static JavaVM *g_jvm = NULL;
-static jobject g_activity = NULL;
-static char g_host[64] = "127.0.0.1";
-static int g_port = 8888;
-static int g_sock = -1;
+static jobject g_activity = NULL;     // NULL while no live activity; see set_activity
+static pthread_mutex_t g_activity_lock = PTHREAD_MUTEX_INITIALIZER;
+static mirror_receiver g_receiver;
+static int g_receiver_initialized = 0;
+static mirror_tuning g_tuning;
 
-static uint32_t g_frame_w = DEFAULT_FRAME_W;
-static uint32_t g_frame_h = DEFAULT_FRAME_H;
+// MediaCodec decoder (guarded by g_receiver.codec_mutex)
+static AMediaCodec *g_codec = NULL;
+// Output sink while detached: an ImageReader nobody reads (frames are never
+// rendered to it; MediaCodec only needs a live surface to switch to).
+static AImageReader *g_sink_reader = NULL;
+static ANativeWindow *g_sink_window = NULL;
+// Output layout of a surface-less decoder, read from its output format on the
+// first get_output after configure or a format change (stride 0: unknown).
+static mirror_output_image g_memory_layout;
+
+// MARK: - JNI callbacks
+
+// Attach the calling thread if needed.
+static JNIEnv *activity_env(int *attached) {
+    *attached = 0;
+    if (!g_jvm) return NULL;
+    JNIEnv *env;
+    if ((*g_jvm)->GetEnv(g_jvm, (void **)&env, JNI_VERSION_1_6) != JNI_OK) {
+        (*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL);
+        *attached = 1;
+    }
+    return env;
+}
 
-// Receive buffer — reused across frames
-static uint8_t *g_nal_buf = NULL;
-static uint32_t g_nal_buf_capacity = 0;
+// A local ref to the current activity, or NULL between a destroy and the next
+// instance. Taken under the lock so set_activity cannot delete it mid-call.
+static jobject activity_ref(JNIEnv *env) {
+    pthread_mutex_lock(&g_activity_lock);
+    jobject activity = g_activity ? (*env)->NewLocalRef(env, g_activity) : NULL;
+    pthread_mutex_unlock(&g_activity_lock);
+    return activity;
+}
 
-// MediaCodec decoder
-static AMediaCodec *g_codec = NULL;
-static pthread_mutex_t g_codec_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-static void set_thread_realtime(const char *name) {
-    struct sched_param param;
-    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
-        setpriority(PRIO_PROCESS, 0, -10);
-        LOGI("%s: SCHED_FIFO unavailable, using nice=-10", name);
-    } else {
-        LOGI("%s: SCHED_FIFO priority %d", name, param.sched_priority);
+// Look up a void method on MirrorActivity and call it; dropped without one.
+static void call_activity_bool(const char *method, int value) {
+    int attached;
+    JNIEnv *env = activity_env(&attached);
+    if (!env) return;
+    jobject activity = activity_ref(env);
+    if (activity) {
+        jclass cls = (*env)->GetObjectClass(env, activity);
+        jmethodID mid = (*env)->GetMethodID(env, cls, method, "(Z)V");
+        if (mid) (*env)->CallVoidMethod(env, activity, mid, (jboolean)(value ? 1 : 0));
+        (*env)->DeleteLocalRef(env, cls);
+        (*env)->DeleteLocalRef(env, activity);
     }
+    if (attached) (*g_jvm)->DetachCurrentThread(g_jvm);
 }
 
-static int read_exact(int sock, void *buf, int n) {
-    int total = 0;
-    while (total < n) {
-        int r = recv(sock, (uint8_t *)buf + total, n - total, MSG_WAITALL);
-        if (r < 0 && errno == EINTR) continue;
-        if (r <= 0) return -1;
-        total += r;
+static void call_activity_int(const char *method, int value) {
+    int attached;
+    JNIEnv *env = activity_env(&attached);
+    if (!env) return;
+    jobject activity = activity_ref(env);
+    if (activity) {
+        jclass cls = (*env)->GetObjectClass(env, activity);
+        jmethodID mid = (*env)->GetMethodID(env, cls, method, "(I)V");
+        if (mid) (*env)->CallVoidMethod(env, activity, mid, (jint)value);
+        (*env)->DeleteLocalRef(env, cls);
+        (*env)->DeleteLocalRef(env, activity);
     }
-    return total;
+    if (attached) (*g_jvm)->DetachCurrentThread(g_jvm);
 }
 
-static double ms_diff(struct timespec a, struct timespec b) {
-    return ((b.tv_sec - a.tv_sec) * 1000.0) + ((b.tv_nsec - a.tv_nsec) / 1e6);
+static void android_on_connection_state(void *ctx, int connected) {
+    (void)ctx;
+    call_activity_bool("onConnectionState", connected);
 }
 
-static void send_ack(int sock, uint32_t seq) {
-    uint8_t ack[6];
-    ack[0] = MAGIC_FRAME_0;
-    ack[1] = MAGIC_ACK_1;
-    ack[2] = (uint8_t)(seq & 0xFF);
-    ack[3] = (uint8_t)((seq >> 8) & 0xFF);
-    ack[4] = (uint8_t)((seq >> 16) & 0xFF);
-    ack[5] = (uint8_t)((seq >> 24) & 0xFF);
-    send(sock, ack, 6, MSG_NOSIGNAL);
+static void android_on_resolution(void *ctx, uint32_t width, uint32_t height) {
+    (void)ctx;
+    pthread_mutex_lock(&g_receiver.codec_mutex);
+    if (g_window) {
+        ANativeWindow_setBuffersGeometry(g_window, (int32_t)width, (int32_t)height, 0);
+    }
+    pthread_mutex_unlock(&g_receiver.codec_mutex);
+    call_activity_bool("setOrientation", height > width);
 }
 
-static void notify_connection_state(int connected) {
-    if (!g_jvm || !g_activity) return;
-    JNIEnv *env;
-    int attached = 0;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **)&env, JNI_VERSION_1_6) != JNI_OK) {
-        (*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL);
-        attached = 1;
+static void android_on_command(void *ctx, uint8_t cmd, uint8_t value) {
+    (void)ctx;
+    if (cmd == CMD_BRIGHTNESS) {
+        call_activity_int("setBrightness", value);
+    } else if (cmd == CMD_WARMTH) {
+        call_activity_int("setWarmth", value);
     }
-    jclass cls = (*env)->GetObjectClass(env, g_activity);
-    jmethodID mid = (*env)->GetMethodID(env, cls, "onConnectionState", "(Z)V");
-    if (mid) (*env)->CallVoidMethod(env, g_activity, mid, (jboolean)(connected ? 1 : 0));
-    if (attached) (*g_jvm)->DetachCurrentThread(g_jvm);
 }
 
-static AMediaCodec *build_decoder(ANativeWindow *window, uint32_t width, uint32_t height) {
-    AMediaCodec *codec = AMediaCodec_createDecoderByType("video/hevc");
-    if (!codec) {
-        LOGE("AMediaCodec_createDecoderByType failed");
+// Expand one row of 8-bit grey to RGBX.
+static void grey_to_rgbx(uint32_t *dst, const uint8_t *src, uint32_t width) {
+    uint32_t x = 0;
+#if defined(__ARM_NEON)
+    uint8x16_t opaque = vdupq_n_u8(0xFF);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t g = vld1q_u8(src + x);
+        uint8x16x4_t px = { { g, g, g, opaque } };
+        vst4q_u8((uint8_t *)(dst + x), px);
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t g = src[x];
+        dst[x] = 0xFF000000u | (g << 16) | (g << 8) | g;
+    }
+}
+
+static void android_present_grey(void *ctx, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    (void)ctx;
+    if (!g_window) return;
+    if ((uint32_t)ANativeWindow_getWidth(g_window) != width ||
+        (uint32_t)ANativeWindow_getHeight(g_window) != height ||
+        ANativeWindow_getFormat(g_window) != WINDOW_FORMAT_RGBX_8888) {
+        ANativeWindow_setBuffersGeometry(g_window, (int32_t)width, (int32_t)height,
+                                         WINDOW_FORMAT_RGBX_8888);
+    }
+
+    ANativeWindow_Buffer buf;
+    if (ANativeWindow_lock(g_window, &buf, NULL) != 0) {
+        LOGE("ANativeWindow_lock failed");
+        return;
+    }
+    uint32_t w = (uint32_t)buf.width < width ? (uint32_t)buf.width : width;
+    uint32_t h = (uint32_t)buf.height < height ? (uint32_t)buf.height : height;
+    for (uint32_t y = 0; y < h; y++) {
+        grey_to_rgbx((uint32_t *)buf.bits + (size_t)y * buf.stride, pixels + (size_t)y * width, w);
+    }
+    ANativeWindow_unlockAndPost(g_window);
+}
+
+static const mirror_platform_ops android_platform_ops = {
+    .on_connection_state = android_on_connection_state,
+    .on_resolution = android_on_resolution,
+    .on_command = android_on_command,
+    .present_grey = android_present_grey,
+};
+
+// MARK: - MediaCodec decoder backend
+
+static AMediaCodec *build_decoder(ANativeWindow *window, const mirror_codec_info *codec,
+                                  uint32_t width, uint32_t height) {
+    AMediaCodec *mc = AMediaCodec_createDecoderByType(codec->mime);
+    if (!mc) {
+        LOGE("AMediaCodec_createDecoderByType(%s) failed", codec->mime);
         return NULL;
     }
 
     AMediaFormat *fmt = AMediaFormat_new();
-    AMediaFormat_setString(fmt, AMEDIAFORMAT_KEY_MIME, "video/hevc");
+    AMediaFormat_setString(fmt, AMEDIAFORMAT_KEY_MIME, codec->mime);
     AMediaFormat_setInt32(fmt, AMEDIAFORMAT_KEY_WIDTH, (int32_t)width);
     AMediaFormat_setInt32(fmt, AMEDIAFORMAT_KEY_HEIGHT, (int32_t)height);
-    AMediaFormat_setInt32(fmt, AMEDIAFORMAT_KEY_LOW_LATENCY, 1);
+    for (const mirror_format_key *k = codec->keys; k->key; k++) {
+        AMediaFormat_setInt32(fmt, k->key, k->value);
+    }
 
-    media_status_t status = AMediaCodec_configure(codec, fmt, window, NULL, 0);
+    media_status_t status = AMediaCodec_configure(mc, fmt, window, NULL, 0);
     AMediaFormat_delete(fmt);
     if (status != AMEDIA_OK) {
-        LOGE("AMediaCodec_configure failed: %d (%ux%u)", status, width, height);
-        AMediaCodec_delete(codec);
+        LOGE("AMediaCodec_configure failed: %d (%s %ux%u)", status, codec->name, width, height);
+        AMediaCodec_delete(mc);
         return NULL;
     }
 
-    status = AMediaCodec_start(codec);
+    status = AMediaCodec_start(mc);
     if (status != AMEDIA_OK) {
-        LOGE("AMediaCodec_start failed: %d (%ux%u)", status, width, height);
-        AMediaCodec_delete(codec);
+        LOGE("AMediaCodec_start failed: %d (%s %ux%u)", status, codec->name, width, height);
+        AMediaCodec_delete(mc);
         return NULL;
     }
 
-    return codec;
+    return mc;
 }
 
-// Create and start a MediaCodec H.264 decoder targeting the given Surface.
-// Returns 0 on failure, 1 on success.
-static int create_decoder(ANativeWindow *window, uint32_t width, uint32_t height) {
-    AMediaCodec *codec = build_decoder(window, width, height);
-    if (!codec) {
-        // Some devices only allow one active hardware decoder instance.
-        // Retry after tearing down the old instance, if any.
-        pthread_mutex_lock(&g_codec_mutex);
-        AMediaCodec *old = g_codec;
-        g_codec = NULL;
-        pthread_mutex_unlock(&g_codec_mutex);
-
-        if (old) {
-            LOGI("Retrying decoder configure after tearing down old instance");
-            AMediaCodec_stop(old);
-            AMediaCodec_delete(old);
-            codec = build_decoder(window, width, height);
-        }
-    }
+// MediaCodec reports each frame the Surface's consumer actually showed, with the
+// presentation timestamp it was queued with (the frame's seq) and the display
+// time (CLOCK_MONOTONIC). Calls come from MediaCodec's own looper thread.
+static void on_frame_rendered(AMediaCodec *codec, void *userdata, int64_t media_time_us, int64_t system_ns) {
+    (void)codec;
+    (void)userdata;
+    mirror_receiver_frame_rendered(&g_receiver, media_time_us, system_ns);
+}
 
-    if (!codec) {
-        return 0;
+// AMediaCodec_setOnFrameRenderedCallback is API 33; older releases get no
+// display timestamps and stats.display stays empty.
+static void watch_rendered_frames(AMediaCodec *mc) {
+    typedef void (*on_rendered_fn)(AMediaCodec *, void *, int64_t, int64_t);
+    typedef media_status_t (*set_callback_fn)(AMediaCodec *, on_rendered_fn, void *);
+    static set_callback_fn set_callback;
+    static int resolved;
+    if (!resolved) {
+        void *lib = dlopen("libmediandk.so", RTLD_NOW);
+        if (lib) set_callback = (set_callback_fn)dlsym(lib, "AMediaCodec_setOnFrameRenderedCallback");
+        resolved = 1;
+        if (!set_callback) LOGI("No frame-rendered callbacks (API < 33): display latency not measured");
     }
-
-    pthread_mutex_lock(&g_codec_mutex);
-    if (g_codec) {
-        AMediaCodec_stop(g_codec);
-        AMediaCodec_delete(g_codec);
+    if (set_callback && set_callback(mc, on_frame_rendered, NULL) != AMEDIA_OK) {
+        LOGE("AMediaCodec_setOnFrameRenderedCallback failed");
     }
-    g_codec = codec;
-    g_frame_w = width;
-    g_frame_h = height;
-    pthread_mutex_unlock(&g_codec_mutex);
-
-    LOGI("MediaCodec HEVC decoder started: %ux%u", width, height);
-    return 1;
 }
 
-static void destroy_decoder(void) {
-    pthread_mutex_lock(&g_codec_mutex);
+static void mediacodec_release(void *ctx) {
+    (void)ctx;
     if (g_codec) {
         AMediaCodec_stop(g_codec);
         AMediaCodec_delete(g_codec);
         g_codec = NULL;
     }
-    pthread_mutex_unlock(&g_codec_mutex);
 }
 
-// Feed one NAL unit buffer into the decoder, render output to Surface.
-// Returns 0 on fatal error.
-static int feed_nal(const uint8_t *data, size_t len, int is_idr, uint32_t seq, int sock,
-                    double *out_decode_ms) {
-    struct timespec t0, t1;
-    clock_gettime(CLOCK_MONOTONIC, &t0);
+// Create and start a MediaCodec decoder for `codec` targeting the current Surface.
+// Returns 0 on failure, 1 on success.
+static int mediacodec_configure(void *ctx, const mirror_codec_info *codec, uint32_t width,
+                                uint32_t height) {
+    if (!g_window) return 0;
+    AMediaCodec *mc = build_decoder(g_window, codec, width, height);
+    if (!mc && g_codec) {
+        // Some devices only allow one active hardware decoder instance.
+        // Retry after tearing down the old instance.
+        LOGI("Retrying decoder configure after tearing down old instance");
+        mediacodec_release(ctx);
+        mc = build_decoder(g_window, codec, width, height);
+    }
 
-    pthread_mutex_lock(&g_codec_mutex);
-    AMediaCodec *codec = g_codec;
-    if (!codec) {
-        pthread_mutex_unlock(&g_codec_mutex);
+    if (!mc) {
         return 0;
     }
 
-    // Get input buffer with 2ms timeout
-    ssize_t input_idx = AMediaCodec_dequeueInputBuffer(codec, 2000);
-    if (input_idx < 0) {
-        pthread_mutex_unlock(&g_codec_mutex);
-        // Timeout — frame dropped, still ACK so sender inflight does not ratchet up.
-        send_ack(sock, seq);
-        return 1;
-    }
+    mediacodec_release(ctx);
+    g_codec = mc;
+    watch_rendered_frames(mc);
+    return 1;
+}
 
-    size_t buf_size = 0;
-    uint8_t *input_buf = AMediaCodec_getInputBuffer(codec, (size_t)input_idx, &buf_size);
-    if (!input_buf || len > buf_size) {
-        AMediaCodec_queueInputBuffer(codec, (size_t)input_idx, 0, 0, 0, 0);
-        pthread_mutex_unlock(&g_codec_mutex);
-        LOGE("Input buffer too small: need %zu, have %zu", len, buf_size);
-        send_ack(sock, seq);
-        return 1;
-    }
+// Surface-less: decoded frames stay in output buffers for get_output.
+static int mediacodec_configure_memory(void *ctx, const mirror_codec_info *codec, uint32_t width,
+                                       uint32_t height) {
+    mediacodec_release(ctx);
+    g_codec = build_decoder(NULL, codec, width, height);
+    memset(&g_memory_layout, 0, sizeof(g_memory_layout));
+    return g_codec != NULL;
+}
+
+// Visible size and row stride of the luma plane, which starts the buffer in
+// every YUV420 layout decoders output. Keys a decoder leaves out fall back to
+// the frame size.
+static void read_memory_layout(void) {
+    AMediaFormat *fmt = AMediaCodec_getOutputFormat(g_codec);
+    int32_t w = 0, h = 0, stride = 0, right = -1, bottom = -1;
+    AMediaFormat_getInt32(fmt, AMEDIAFORMAT_KEY_WIDTH, &w);
+    AMediaFormat_getInt32(fmt, AMEDIAFORMAT_KEY_HEIGHT, &h);
+    AMediaFormat_getInt32(fmt, "stride", &stride);
+    if (AMediaFormat_getInt32(fmt, "crop-right", &right) && right >= 0 && right < w) w = right + 1;
+    if (AMediaFormat_getInt32(fmt, "crop-bottom", &bottom) && bottom >= 0 && bottom < h) h = bottom + 1;
+    AMediaFormat_delete(fmt);
+    g_memory_layout.width = w > 0 ? (uint32_t)w : 0;
+    g_memory_layout.height = h > 0 ? (uint32_t)h : 0;
+    g_memory_layout.stride = stride >= w && stride > 0 ? (uint32_t)stride : g_memory_layout.width;
+}
+
+static int mediacodec_get_output(void *ctx, size_t idx, mirror_output_image *img) {
+    (void)ctx;
+    size_t size = 0;
+    uint8_t *buf = AMediaCodec_getOutputBuffer(g_codec, idx, &size);
+    if (!buf) return 0;
+    if (!g_memory_layout.stride) read_memory_layout();
+    *img = g_memory_layout;
+    img->y = buf;
+    return img->stride && (size_t)img->stride * img->height <= size;
+}
+
+static ssize_t mediacodec_dequeue_input(void *ctx, int64_t timeout_us) {
+    (void)ctx;
+    return AMediaCodec_dequeueInputBuffer(g_codec, timeout_us);
+}
 
-    memcpy(input_buf, data, len);
-    uint32_t flags = is_idr ? AMEDIACODEC_BUFFER_FLAG_KEY_FRAME : 0;
-    AMediaCodec_queueInputBuffer(codec, (size_t)input_idx, 0, len, 0, flags);
+static uint8_t *mediacodec_get_input(void *ctx, size_t idx, size_t *capacity) {
+    (void)ctx;
+    return AMediaCodec_getInputBuffer(g_codec, idx, capacity);
+}
+
+static int mediacodec_queue_input(void *ctx, size_t idx, size_t len, int64_t pts_us, uint32_t flags) {
+    (void)ctx;
+    return AMediaCodec_queueInputBuffer(g_codec, idx, 0, len, (uint64_t)pts_us, flags) == AMEDIA_OK;
+}
 
-    // Drain all available output buffers and render to Surface
+static ssize_t mediacodec_dequeue_output(void *ctx, mirror_output_info *out, int64_t timeout_us) {
+    (void)ctx;
     AMediaCodecBufferInfo info;
-    ssize_t output_idx;
-    while ((output_idx = AMediaCodec_dequeueOutputBuffer(codec, &info, 0)) >= 0) {
-        // render=true pushes directly to the configured Surface/ANativeWindow
-        AMediaCodec_releaseOutputBuffer(codec, (size_t)output_idx, info.size > 0);
-    }
+    ssize_t idx = AMediaCodec_dequeueOutputBuffer(g_codec, &info, timeout_us);
     // AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED and AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED
-    // are negative values — silently ignored here, they don't require action.
+    // are negative values — the caller ignores them, they don't require action
+    // beyond re-reading the layout of in-memory output.
+    if (idx == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) g_memory_layout.stride = 0;
+    if (idx >= 0) {
+        out->size = info.size;
+        out->pts_us = info.presentationTimeUs;
+        out->flags = info.flags;
+    }
+    return idx;
+}
 
-    pthread_mutex_unlock(&g_codec_mutex);
+static int mediacodec_release_output(void *ctx, size_t idx, int render) {
+    (void)ctx;
+    // render=true pushes directly to the configured Surface/ANativeWindow
+    return AMediaCodec_releaseOutputBuffer(g_codec, idx, render != 0) == AMEDIA_OK;
+}
 
-    clock_gettime(CLOCK_MONOTONIC, &t1);
-    *out_decode_ms = ms_diff(t0, t1);
+static int mediacodec_release_output_at(void *ctx, size_t idx, int64_t present_ns) {
+    (void)ctx;
+    return AMediaCodec_releaseOutputBufferAtTime(g_codec, idx, present_ns) == AMEDIA_OK;
+}
 
-    send_ack(sock, seq);
-    return 1;
+static int mediacodec_flush(void *ctx) {
+    (void)ctx;
+    // Synchronous mode: input buffers can be dequeued again straight away.
+    return AMediaCodec_flush(g_codec) == AMEDIA_OK;
 }
 
-static void *decode_thread(void *arg) {
-    (void)arg;
-    set_thread_realtime("decode_thread");
-    LOGI("Decode thread started, connecting to %s:%d", g_host, g_port);
-
-    // Initial receive buffer
-    g_nal_buf_capacity = 2 * 1024 * 1024;  // 2MB — plenty for any single access unit
-    g_nal_buf = (uint8_t *)malloc(g_nal_buf_capacity);
-    if (!g_nal_buf) {
-        LOGE("Failed to allocate NAL buffer");
+static ANativeWindow *sink_window(void) {
+    if (g_sink_window) return g_sink_window;
+    if (AImageReader_new(64, 64, AIMAGE_FORMAT_YUV_420_888, 2, &g_sink_reader) != AMEDIA_OK) {
+        LOGE("AImageReader_new failed");
+        g_sink_reader = NULL;
         return NULL;
     }
+    if (AImageReader_getWindow(g_sink_reader, &g_sink_window) != AMEDIA_OK) {
+        AImageReader_delete(g_sink_reader);
+        g_sink_reader = NULL;
+        g_sink_window = NULL;
+    }
+    return g_sink_window;
+}
 
-    while (g_running) {
-        int sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (sock < 0) {
-            LOGE("socket() failed: %s", strerror(errno));
-            sleep(1);
-            continue;
-        }
+static int mediacodec_set_output(void *ctx, int attach) {
+    (void)ctx;
+    ANativeWindow *target = attach ? g_window : sink_window();
+    if (!g_codec || !target) return 0;
+    media_status_t status = AMediaCodec_setOutputSurface(g_codec, target);
+    if (status != AMEDIA_OK) {
+        LOGE("AMediaCodec_setOutputSurface(%s) failed: %d", attach ? "window" : "sink", status);
+        return 0;
+    }
+    return 1;
+}
 
-        int flag = 1;
-        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-        setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, &flag, sizeof(flag));
-        int rcvbuf = 2 * 1024 * 1024;  // 2MB — H.264 frames are larger than LZ4 deltas
-        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
-
-        struct sockaddr_in addr;
-        memset(&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(g_port);
-        inet_pton(AF_INET, g_host, &addr.sin_addr);
-
-        LOGI("Connecting to %s:%d ...", g_host, g_port);
-        if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-            LOGE("connect() failed: %s (is ADB reverse tunnel set up?)", strerror(errno));
-            close(sock);
-            sleep(1);
-            continue;
-        }
+static const mirror_decoder_ops mediacodec_decoder_ops = {
+    .name = "MediaCodec",
+    .configure = mediacodec_configure,
+    .release = mediacodec_release,
+    .dequeue_input = mediacodec_dequeue_input,
+    .get_input = mediacodec_get_input,
+    .queue_input = mediacodec_queue_input,
+    .dequeue_output = mediacodec_dequeue_output,
+    .release_output = mediacodec_release_output,
+    .release_output_at = mediacodec_release_output_at,
+    .flush = mediacodec_flush,
+    .set_output = mediacodec_set_output,
+    .configure_memory = mediacodec_configure_memory,
+    .get_output = mediacodec_get_output,
+};
+
+// MARK: - Codec probe
+
+// Software fallbacks that MediaCodec hands out when there is no hardware decoder.
+static int is_software_codec(const char *name) {
+    return strncmp(name, "c2.android.", 11) == 0 || strncmp(name, "OMX.google.", 11) == 0;
+}
 
-        g_sock = sock;
-        LOGI("Connected to server %s:%d", g_host, g_port);
-
-        int frame_count = 0;
-        int stat_frames = 0;
-        int dropped_frames = 0;
-        uint32_t last_seq = 0;
-        int has_last_seq = 0;
-        double recv_sum = 0, decode_sum = 0;
-        struct timespec stat_start;
-        clock_gettime(CLOCK_MONOTONIC, &stat_start);
-
-        while (g_running) {
-            struct timespec t0, t1;
-            clock_gettime(CLOCK_MONOTONIC, &t0);
-
-            uint8_t magic[2];
-            if (read_exact(sock, magic, 2) < 0) {
-                LOGE("Connection lost");
-                break;
-            }
-            if (magic[0] != MAGIC_FRAME_0) {
-                LOGE("Bad magic: 0x%02x 0x%02x", magic[0], magic[1]);
-                break;
-            }
-
-            // Command packet [DA 7F cmd ...]
-            if (magic[1] == MAGIC_CMD_1) {
-                uint8_t cmd;
-                if (read_exact(sock, &cmd, 1) < 0) break;
-
-                if (cmd == CMD_RESOLUTION) {
-                    uint8_t res_data[4];
-                    if (read_exact(sock, res_data, 4) < 0) break;
-                    uint32_t new_w = res_data[0] | (res_data[1] << 8);
-                    uint32_t new_h = res_data[2] | (res_data[3] << 8);
-                    if (new_w > 0 && new_h > 0 && new_w <= 4096 && new_h <= 4096) {
-                        LOGI("Resolution → %ux%u, recreating decoder", new_w, new_h);
-                        if (g_window) {
-                            ANativeWindow_setBuffersGeometry(g_window, (int32_t)new_w, (int32_t)new_h, 0);
-                            create_decoder(g_window, new_w, new_h);
-                        }
-
-                        if (g_jvm && g_activity) {
-                            JNIEnv *env2;
-                            int attached2 = 0;
-                            if ((*g_jvm)->GetEnv(g_jvm, (void **)&env2, JNI_VERSION_1_6) != JNI_OK) {
-                                (*g_jvm)->AttachCurrentThread(g_jvm, &env2, NULL);
-                                attached2 = 1;
-                            }
-                            jclass cls2 = (*env2)->GetObjectClass(env2, g_activity);
-                            jmethodID mid2 = (*env2)->GetMethodID(env2, cls2, "setOrientation", "(Z)V");
-                            if (mid2) {
-                                (*env2)->CallVoidMethod(env2, g_activity, mid2,
-                                    (jboolean)(new_h > new_w ? 1 : 0));
-                            }
-                            if (attached2) (*g_jvm)->DetachCurrentThread(g_jvm);
-                        }
-                    }
-                    continue;
-                }
-
-                uint8_t value;
-                if (read_exact(sock, &value, 1) < 0) break;
-                if (g_jvm && g_activity) {
-                    JNIEnv *env;
-                    int attached = 0;
-                    if ((*g_jvm)->GetEnv(g_jvm, (void **)&env, JNI_VERSION_1_6) != JNI_OK) {
-                        (*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL);
-                        attached = 1;
-                    }
-                    jclass cls = (*env)->GetObjectClass(env, g_activity);
-                    if (cmd == CMD_BRIGHTNESS) {
-                        jmethodID mid = (*env)->GetMethodID(env, cls, "setBrightness", "(I)V");
-                        if (mid) (*env)->CallVoidMethod(env, g_activity, mid, (jint)value);
-                    } else if (cmd == 0x02) {
-                        jmethodID mid = (*env)->GetMethodID(env, cls, "setWarmth", "(I)V");
-                        if (mid) (*env)->CallVoidMethod(env, g_activity, mid, (jint)value);
-                    }
-                    if (attached) (*g_jvm)->DetachCurrentThread(g_jvm);
-                }
-                continue;
-            }
-
-            if (magic[1] != MAGIC_FRAME_1) {
-                LOGE("Unknown packet type: 0x%02x", magic[1]);
-                break;
-            }
-
-            // Frame header: [flags:1] [seq:4 LE] [len:4 LE]
-            uint8_t frame_hdr[9];
-            if (read_exact(sock, frame_hdr, 9) < 0) {
-                LOGE("Connection lost reading frame header");
-                break;
-            }
-
-            uint8_t flags       = frame_hdr[0];
-            uint32_t seq        = frame_hdr[1] | ((uint32_t)frame_hdr[2] << 8) |
-                                  ((uint32_t)frame_hdr[3] << 16) | ((uint32_t)frame_hdr[4] << 24);
-            uint32_t payload_len = frame_hdr[5] | ((uint32_t)frame_hdr[6] << 8) |
-                                   ((uint32_t)frame_hdr[7] << 16) | ((uint32_t)frame_hdr[8] << 24);
-
-            if (has_last_seq && seq != last_seq + 1) {
-                int gap = (int)(seq - last_seq - 1);
-                if (gap > 0 && gap < 1000) dropped_frames += gap;
-            }
-            last_seq = seq;
-            has_last_seq = 1;
-
-            // Grow receive buffer if needed
-            if (payload_len > g_nal_buf_capacity) {
-                uint8_t *new_buf = (uint8_t *)realloc(g_nal_buf, payload_len);
-                if (!new_buf) {
-                    LOGE("Failed to grow NAL buffer to %u bytes", payload_len);
-                    break;
-                }
-                g_nal_buf = new_buf;
-                g_nal_buf_capacity = payload_len;
-            }
-
-            if (read_exact(sock, g_nal_buf, (int)payload_len) < 0) {
-                LOGE("Failed to read payload");
-                break;
-            }
-            clock_gettime(CLOCK_MONOTONIC, &t1);
-
-            double decode_ms = 0.0;
-            if (!feed_nal(g_nal_buf, payload_len, (flags & FLAG_KEYFRAME) != 0, seq, sock, &decode_ms)) {
-                LOGE("feed_nal fatal error, reconnecting");
-                break;
-            }
-
-            if (frame_count == 0) {
-                notify_connection_state(1);
-            }
-
-            recv_sum += ms_diff(t0, t1);
-            decode_sum += decode_ms;
-            frame_count++;
-            stat_frames++;
-
-            struct timespec now;
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            double elapsed = (now.tv_sec - stat_start.tv_sec) +
-                             (now.tv_nsec - stat_start.tv_nsec) / 1e9;
-            if (elapsed >= 5.0 && stat_frames > 0) {
-                double fps = stat_frames / elapsed;
-                LOGI("FPS: %.1f | recv: %.1fms | decode: %.1fms | %uKB %s | drops: %d | total: %d",
-                     fps,
-                     recv_sum / stat_frames,
-                     decode_sum / stat_frames,
-                     payload_len / 1024,
-                     (flags & FLAG_KEYFRAME) ? "IDR" : "P",
-                     dropped_frames,
-                     frame_count);
-                stat_frames = 0;
-                recv_sum = 0;
-                decode_sum = 0;
-                dropped_frames = 0;
-                stat_start = now;
-            }
+// 1 if the default decoder for `codec` is hardware. AMediaCodec_getName is API
+// 28; on older releases every decoder that can be created counts.
+static int has_hardware_decoder(const mirror_codec_info *codec) {
+    typedef media_status_t (*get_name_fn)(AMediaCodec *, char **);
+    typedef void (*release_name_fn)(AMediaCodec *, char *);
+    static get_name_fn get_name;
+    static release_name_fn release_name;
+    static int resolved;
+    if (!resolved) {
+        void *lib = dlopen("libmediandk.so", RTLD_NOW);
+        if (lib) {
+            get_name = (get_name_fn)dlsym(lib, "AMediaCodec_getName");
+            release_name = (release_name_fn)dlsym(lib, "AMediaCodec_releaseName");
         }
+        resolved = 1;
+    }
 
-        if (g_sock >= 0) {
-            close(g_sock);
-            g_sock = -1;
+    AMediaCodec *mc = AMediaCodec_createDecoderByType(codec->mime);
+    if (!mc) return 0;
+    int hardware = 1;
+    char *name = NULL;
+    if (get_name && release_name && get_name(mc, &name) == AMEDIA_OK && name) {
+        hardware = !is_software_codec(name);
+        LOGI("Codec probe: %s → %s%s", codec->mime, name, hardware ? "" : " (software, skipped)");
+        release_name(mc, name);
+    }
+    AMediaCodec_delete(mc);
+    return hardware;
+}
+
+// Fill the receiver's advertised codec list with the hardware decoders present,
+// in default preference order: HEVC (what the Mac encodes best), then H.264
+// and AV1.
+static void probe_codecs(mirror_receiver *r) {
+    static const uint8_t preference[] = { MIRROR_CODEC_HEVC, MIRROR_CODEC_H264, MIRROR_CODEC_AV1 };
+    r->n_codecs = 0;
+    for (size_t i = 0; i < sizeof(preference); i++) {
+        if (has_hardware_decoder(mirror_codec_get(preference[i]))) {
+            r->codecs[r->n_codecs++] = preference[i];
         }
-        LOGI("Disconnected, reconnecting in 1s...");
-        notify_connection_state(0);
-        sleep(1);
     }
+}
+
+// MARK: - Decoder tuning
+
+// SoC name for the tuning profiles: ro.soc.model (Android 12+, "SM8450",
+// "MT6789"), else the board platform ("mt6789", "exynos990").
+static void read_soc(char soc[PROP_VALUE_MAX]) {
+    if (__system_property_get("ro.soc.model", soc) > 0) return;
+    if (__system_property_get("ro.board.platform", soc) > 0) return;
+    __system_property_get("ro.hardware", soc);
+}
+
+// <filesDir>/decoder_tuning.txt, or "" if the activity has no files dir.
+static void tuning_cache_path(JNIEnv *env, jobject activity, char *out, size_t len) {
+    out[0] = '\0';
+    jclass cls = (*env)->GetObjectClass(env, activity);
+    jmethodID get_files_dir = (*env)->GetMethodID(env, cls, "getFilesDir", "()Ljava/io/File;");
+    jobject dir = get_files_dir ? (*env)->CallObjectMethod(env, activity, get_files_dir) : NULL;
+    if (!dir) return;
+    jclass file_cls = (*env)->GetObjectClass(env, dir);
+    jmethodID get_path = (*env)->GetMethodID(env, file_cls, "getAbsolutePath", "()Ljava/lang/String;");
+    jstring path = get_path ? (jstring)(*env)->CallObjectMethod(env, dir, get_path) : NULL;
+    if (path) {
+        const char *chars = (*env)->GetStringUTFChars(env, path, NULL);
+        snprintf(out, len, "%s/decoder_tuning.txt", chars);
+        (*env)->ReleaseStringUTFChars(env, path, chars);
+        (*env)->DeleteLocalRef(env, path);
+    }
+    (*env)->DeleteLocalRef(env, dir);
+}
+
+// Profiles for this SoC, cached per build fingerprint. Calibration itself runs
+// on the decode thread (mirror_receiver_tune), decoding to memory.
+static void init_tuning(JNIEnv *env, jobject activity) {
+    char soc[PROP_VALUE_MAX] = "";
+    char fingerprint[PROP_VALUE_MAX] = "";
+    char cache[256];
+    read_soc(soc);
+    __system_property_get("ro.build.fingerprint", fingerprint);
+    tuning_cache_path(env, activity, cache, sizeof(cache));
+    mirror_tuning_init(&g_tuning, NULL, soc, fingerprint, cache);
+    LOGI("Decoder tuning: SoC %s, cache %s", soc[0] ? soc : "unknown", cache[0] ? cache : "none");
+}
+
+// MARK: - Vsync source
+//
+// Choreographer delivers frame callbacks on a looper thread; this one exists
+// only to tick the receiver's vsync clock. Each callback reposts itself, so
+// callbacks keep coming at the display rate until the thread is stopped.
+
+static pthread_t g_vsync_thread;
+static volatile int g_vsync_running = 0;
+
+// frameTimeNanos is CLOCK_MONOTONIC, the clock releaseOutputBufferAtTime uses.
+// `long` is 64-bit on arm64, the only ABI the DC-1 runs.
+static void on_vsync(long frame_time_ns, void *data) {
+    if (!g_vsync_running) return;
+    mirror_receiver_vsync(&g_receiver, (int64_t)frame_time_ns);
+    AChoreographer_postFrameCallback(AChoreographer_getInstance(), on_vsync, data);
+}
 
-    free(g_nal_buf);
-    g_nal_buf = NULL;
-    g_nal_buf_capacity = 0;
-    LOGI("Decode thread exited");
+static void *vsync_thread(void *arg) {
+    (void)arg;
+    ALooper_prepare(0);
+    AChoreographer *choreographer = AChoreographer_getInstance();
+    if (!choreographer) {
+        LOGE("AChoreographer_getInstance failed; presenting without vsync alignment");
+        return NULL;
+    }
+    AChoreographer_postFrameCallback(choreographer, on_vsync, NULL);
+    // Short polls so stop needs no looper wake-up.
+    while (g_vsync_running) ALooper_pollOnce(100, NULL, NULL, NULL);
     return NULL;
 }
 
-// JNI: called from Kotlin when Surface is ready
+static void start_vsync(void) {
+    if (g_vsync_running) return;
+    g_vsync_running = 1;
+    if (pthread_create(&g_vsync_thread, NULL, vsync_thread, NULL) != 0) g_vsync_running = 0;
+}
+
+static void stop_vsync(void) {
+    if (!g_vsync_running) return;
+    g_vsync_running = 0;
+    pthread_join(g_vsync_thread, NULL);
+}
+
+// MARK: - JNI entry points
+
+// Point the activity global ref at the current MirrorActivity instance, or at
+// nothing (NULL) once it is destroyed; callbacks meanwhile are dropped.
+static void set_activity(JNIEnv *env, jobject thiz) {
+    (*env)->GetJavaVM(env, &g_jvm);
+    jobject activity = thiz ? (*env)->NewGlobalRef(env, thiz) : NULL;
+    pthread_mutex_lock(&g_activity_lock);
+    jobject old = g_activity;
+    g_activity = activity;
+    pthread_mutex_unlock(&g_activity_lock);
+    if (old) (*env)->DeleteGlobalRef(env, old);
+}
+
+// Swap the output window under codec_mutex (the decode thread draws grey frames
+// and resizes buffers through it). Returns the previous window.
+static ANativeWindow *swap_window(ANativeWindow *window) {
+    pthread_mutex_lock(&g_receiver.codec_mutex);
+    ANativeWindow *old = g_window;
+    g_window = window;
+    if (window && g_receiver.frame_w && !g_receiver.grey_active) {
+        ANativeWindow_setBuffersGeometry(window, (int32_t)g_receiver.frame_w,
+                                         (int32_t)g_receiver.frame_h, 0);
+    }
+    pthread_mutex_unlock(&g_receiver.codec_mutex);
+    return old;
+}
+
+// JNI: called from Kotlin when Surface is ready. Starts the session the first
+// time; after that, hands the running session the new Surface.
 JNIEXPORT void JNICALL
 Java_com_daylight_mirror_MirrorActivity_nativeStart(
     JNIEnv *env, jobject thiz, jobject surface, jstring host, jint port)
 {
-    if (g_running) return;
+    if (g_receiver_initialized && g_receiver.running) {
+        set_activity(env, thiz);
+        ANativeWindow *old = swap_window(ANativeWindow_fromSurface(env, surface));
+        if (old) ANativeWindow_release(old);
+        int kept = mirror_receiver_attach_output(&g_receiver);
+        LOGI("Surface attached (%s)", kept ? "decoder kept" : "decoder rebuilt");
+        return;
+    }
 
-    (*env)->GetJavaVM(env, &g_jvm);
-    g_activity = (*env)->NewGlobalRef(env, thiz);
+    if (!g_receiver_initialized) {
+        mirror_receiver_init(&g_receiver, &mediacodec_decoder_ops, NULL,
+                             &android_platform_ops, NULL);
+        probe_codecs(&g_receiver);
+        g_receiver.features = MIRROR_FEATURE_FRAME_TIMING;
+        init_tuning(env, thiz);
+        mirror_receiver_set_tuning(&g_receiver, &g_tuning);
+        g_receiver_initialized = 1;
+    }
 
-    g_window = ANativeWindow_fromSurface(env, surface);
+    set_activity(env, thiz);
+    ANativeWindow *old = swap_window(ANativeWindow_fromSurface(env, surface));
+    if (old) ANativeWindow_release(old);
+    g_receiver.output_detached = 0;   // no decode thread yet; a stop while detached left it set
 
     const char *host_str = (*env)->GetStringUTFChars(env, host, NULL);
-    strncpy(g_host, host_str, sizeof(g_host) - 1);
+    char host_buf[64];
+    strncpy(host_buf, host_str, sizeof(host_buf) - 1);
+    host_buf[sizeof(host_buf) - 1] = '\0';
     (*env)->ReleaseStringUTFChars(env, host, host_str);
-    g_port = port;
-
-    g_running = 1;
 
     // Create decoder now — decode thread will also check on startup
-    create_decoder(g_window, g_frame_w, g_frame_h);
+    mirror_receiver_create_decoder(&g_receiver, g_receiver.frame_w, g_receiver.frame_h);
 
-    pthread_create(&g_decode_thread, NULL, decode_thread, NULL);
+    mirror_receiver_start(&g_receiver, host_buf, port);
+    start_vsync();
 }
 
-// JNI: called from Kotlin when Surface is destroyed
+// JNI: called from Kotlin when Surface is destroyed. The session, socket and
+// decoder keep running; output moves off the Surface before it goes.
 JNIEXPORT void JNICALL
-Java_com_daylight_mirror_MirrorActivity_nativeStop(
+Java_com_daylight_mirror_MirrorActivity_nativeDetach(
     JNIEnv *env, jobject thiz)
 {
-    g_running = 0;
-    if (g_sock >= 0) {
-        shutdown(g_sock, SHUT_RDWR);
-        close(g_sock);
-        g_sock = -1;
-    }
-    pthread_join(g_decode_thread, NULL);
-    destroy_decoder();
-    if (g_window) {
-        ANativeWindow_release(g_window);
-        g_window = NULL;
+    (void)env;
+    (void)thiz;
+    if (!g_receiver_initialized || !g_receiver.running) return;
+    mirror_receiver_detach_output(&g_receiver);
+    ANativeWindow *old = swap_window(NULL);
+    if (old) ANativeWindow_release(old);
+}
+
+// JNI: the activity is destroyed but not finishing (a configuration change it
+// does not handle, or the system recreating it). The session keeps running for
+// the next instance, which hands it a Surface and itself in nativeStart; until
+// then nothing renders and no callbacks reach the dead instance.
+JNIEXPORT void JNICALL
+Java_com_daylight_mirror_MirrorActivity_nativeRelease(
+    JNIEnv *env, jobject thiz)
+{
+    (void)thiz;
+    if (!g_receiver_initialized) return;
+    if (g_receiver.running) {
+        mirror_receiver_detach_output(&g_receiver);
+        ANativeWindow *old = swap_window(NULL);
+        if (old) ANativeWindow_release(old);
+    }
+    set_activity(env, NULL);
+}
+
+// The whole file, or NULL (and *len = 0) if it is empty or cannot be read.
+static uint8_t *read_recording(const char *path, size_t *len) {
+    *len = 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    uint8_t *buf = NULL;
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) buf = (uint8_t *)malloc((size_t)size);
+    if (buf && fread(buf, 1, (size_t)size, f) == (size_t)size) {
+        *len = (size_t)size;
+    } else {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+// JNI: decode a recording (mirror_recv --record) headless, as fast as the
+// decoder goes, and return a one-line summary. `golden` (may be null) is a
+// checksum file to compare against, `write_golden` (may be null) receives
+// this run's checksums. Runs on the caller's thread and needs the decoder to
+// itself, so the activity never starts a session in replay mode.
+JNIEXPORT jstring JNICALL
+Java_com_daylight_mirror_MirrorActivity_nativeReplay(
+    JNIEnv *env, jobject thiz, jstring path, jstring golden, jstring write_golden)
+{
+    (void)thiz;
+    char result[256];
+    if (g_receiver_initialized && g_receiver.running) {
+        return (*env)->NewStringUTF(env, "Replay: a mirroring session is running");
+    }
+    const char *path_str = (*env)->GetStringUTFChars(env, path, NULL);
+    const char *golden_str = golden ? (*env)->GetStringUTFChars(env, golden, NULL) : NULL;
+    const char *write_str = write_golden ? (*env)->GetStringUTFChars(env, write_golden, NULL) : NULL;
+
+    size_t len = 0;
+    uint8_t *stream = read_recording(path_str, &len);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = golden_str || write_str;
+    uint32_t *sums = NULL;
+    if (stream && golden_str) {
+        int max = (int)(len / FRAME_HEADER_SIZE) + 1;
+        sums = (uint32_t *)malloc((size_t)max * sizeof(uint32_t));
+        cfg.n_golden = sums ? mirror_replay_load_golden(golden_str, sums, max) : -1;
+        cfg.golden = cfg.n_golden >= 0 ? sums : NULL;
+    }
+
+    mirror_decoder dec = { &mediacodec_decoder_ops, NULL };
+    mirror_replay_result res;
+    if (!stream) {
+        snprintf(result, sizeof(result), "Replay: cannot read %s", path_str);
+    } else if (golden_str && !cfg.golden) {
+        snprintf(result, sizeof(result), "Replay: cannot read golden checksums %s", golden_str);
+    } else if (mirror_replay_run(&dec, stream, len, &cfg, &res) < 0) {
+        snprintf(result, sizeof(result), "Replay: %s failed to decode", path_str);
+    } else {
+        int n = snprintf(result, sizeof(result),
+                         "Replay: %d frames, %d decoded, %d skipped in %.2fs: %.1f fps, "
+                         "latency %.2f avg / %.2f p95 / %.2f max ms",
+                         res.frames, res.decoded, res.skipped, res.seconds, res.fps,
+                         res.latency_ms_avg, res.latency_ms_p95, res.latency_ms_max);
+        if (cfg.golden && n > 0 && (size_t)n < sizeof(result)) {
+            snprintf(result + n, sizeof(result) - (size_t)n, ", %d mismatches (first %d)",
+                     res.mismatches, res.first_mismatch);
+        }
+        if (write_str && mirror_replay_save_golden(write_str, res.checksums, res.decoded) < 0) {
+            LOGE("Replay: cannot write %s", write_str);
+        }
+        mirror_replay_result_free(&res);
     }
-    if (g_activity) {
-        (*env)->DeleteGlobalRef(env, g_activity);
-        g_activity = NULL;
+    LOGI("%s", result);
+
+    free(sums);
+    free(stream);
+    if (write_str) (*env)->ReleaseStringUTFChars(env, write_golden, write_str);
+    if (golden_str) (*env)->ReleaseStringUTFChars(env, golden, golden_str);
+    (*env)->ReleaseStringUTFChars(env, path, path_str);
+    return (*env)->NewStringUTF(env, result);
+}
+
+// JNI: called from Kotlin when the activity finishes
+JNIEXPORT void JNICALL
+Java_com_daylight_mirror_MirrorActivity_nativeStop(
+    JNIEnv *env, jobject thiz)
+{
+    (void)thiz;
+    if (!g_receiver_initialized) return;
+    stop_vsync();
+    mirror_receiver_stop(&g_receiver);
+    mirror_receiver_destroy_decoder(&g_receiver);
+    ANativeWindow *old = swap_window(NULL);
+    if (old) ANativeWindow_release(old);
+    if (g_sink_reader) {
+        AImageReader_delete(g_sink_reader);   // owns g_sink_window
+        g_sink_reader = NULL;
+        g_sink_window = NULL;
     }
+    set_activity(env, NULL);
 }
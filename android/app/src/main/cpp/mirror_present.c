@@ -0,0 +1,89 @@
+// mirror_present.c — Present timestamps matched to released frames; see mirror_present.h.
+
+#include "mirror_present.h"
+
+#include <string.h>
+
+#define SLOT(seq) ((seq) & (MIRROR_PRESENT_FRAMES - 1))
+
+void mirror_present_init(mirror_present *p) {
+    memset(p, 0, sizeof(*p));
+    pthread_mutex_init(&p->lock, NULL);
+}
+
+void mirror_present_free(mirror_present *p) {
+    pthread_mutex_destroy(&p->lock);
+}
+
+void mirror_present_reset(mirror_present *p) {
+    pthread_mutex_lock(&p->lock);
+    p->head = p->tail = 0;
+    pthread_mutex_unlock(&p->lock);
+    memset(p->frames, 0, sizeof(p->frames));
+}
+
+void mirror_present_released(mirror_present *p, uint32_t seq, int64_t arrival_ns, int64_t decoded_ns,
+                             int64_t target_ns) {
+    mirror_present_frame *f = &p->frames[SLOT(seq)];
+    f->seq = seq;
+    f->pending = 1;
+    f->arrival_ns = arrival_ns;
+    f->decoded_ns = decoded_ns;
+    f->target_ns = target_ns;
+}
+
+void mirror_present_shown(mirror_present *p, uint32_t seq, int64_t shown_ns) {
+    pthread_mutex_lock(&p->lock);
+    if (p->tail - p->head < MIRROR_PRESENT_FRAMES) {
+        mirror_present_report *rep = &p->reports[p->tail++ % MIRROR_PRESENT_FRAMES];
+        rep->seq = seq;
+        rep->shown_ns = shown_ns;
+    } else {
+        p->dropped++;
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void match(mirror_present *p, const mirror_present_report *rep, mirror_present_stats *st) {
+    mirror_present_frame *f = &p->frames[SLOT(rep->seq)];
+    if (!f->pending || f->seq != rep->seq) {
+        st->unmatched++;
+        return;
+    }
+    f->pending = 0;
+    // Shown in order: anything released before this frame and still waiting
+    // was replaced before its latch.
+    for (int i = 0; i < MIRROR_PRESENT_FRAMES; i++) {
+        mirror_present_frame *o = &p->frames[i];
+        if (o->pending && (int32_t)(o->seq - rep->seq) < 0) {
+            o->pending = 0;
+            st->undisplayed++;
+        }
+    }
+
+    double ms = (rep->shown_ns - f->decoded_ns) / 1e6;
+    st->display_ms_last = ms;
+    if (ms > st->display_ms_max) st->display_ms_max = ms;
+    st->display_ms_sum += ms;
+    st->displayed++;
+    if (f->arrival_ns) {
+        st->arrival_ms_sum += (rep->shown_ns - f->arrival_ns) / 1e6;
+        st->arrival_samples++;
+    }
+    if (f->target_ns) {
+        double off = (rep->shown_ns - f->target_ns) / 1e6;
+        st->latch_ms_sum += off < 0 ? -off : off;
+        st->latch_samples++;
+    }
+}
+
+void mirror_present_collect(mirror_present *p, mirror_present_stats *st) {
+    mirror_present_report batch[MIRROR_PRESENT_FRAMES];
+    unsigned n = 0;
+    pthread_mutex_lock(&p->lock);
+    while (p->head != p->tail) batch[n++] = p->reports[p->head++ % MIRROR_PRESENT_FRAMES];
+    st->unmatched += p->dropped;
+    p->dropped = 0;
+    pthread_mutex_unlock(&p->lock);
+    for (unsigned i = 0; i < n; i++) match(p, &batch[i], st);
+}
@@ -0,0 +1,82 @@
+// mirror_present.h — When decoded frames actually reached the display.
+//
+// Releasing an output buffer for render only hands it to the compositor; the
+// panel shows it at a later latch, or never if a newer buffer was due by then.
+// The platform reports the frames it really showed (MediaCodec's frame-rendered
+// callback on Android, API 33+) with their presentation timestamp, which the
+// receiver sets to the frame's seq, and the time the frame was shown. The
+// decode thread records each frame it releases for render and matches the
+// reports against them:
+//
+//   decoded → shown   the latency releaseOutputBuffer timings cannot see
+//   received → shown  glass end of the receiver's share of glass-to-glass
+//   shown − target    how far from its target vsync the frame was latched
+//
+// Reports arrive in display order, so a frame released before a shown one and
+// not reported itself never made it to the panel. MediaCodec may skip reports
+// under load, which counts a shown frame as undisplayed; without any reports
+// (older Android) nothing is counted at all.
+
+#ifndef MIRROR_PRESENT_H
+#define MIRROR_PRESENT_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define MIRROR_PRESENT_FRAMES 64    // frames tracked and reports queued (power of two)
+
+typedef struct {
+    uint64_t displayed;         // frames with a present timestamp
+    uint64_t undisplayed;       // released for render, a later frame was shown instead
+    uint64_t unmatched;         // reports for frames no longer tracked (or dropped: queue full)
+    double display_ms_last;     // decoded → shown
+    double display_ms_max;
+    double display_ms_sum;      // over displayed
+    double arrival_ms_sum;      // received → shown
+    uint64_t arrival_samples;
+    double latch_ms_sum;        // |shown − target vsync|, frames released for a vsync
+    uint64_t latch_samples;
+} mirror_present_stats;
+
+typedef struct {
+    uint32_t seq;
+    uint8_t pending;            // released for render, no report yet
+    int64_t arrival_ns;         // 0 if unknown
+    int64_t decoded_ns;
+    int64_t target_ns;          // 0 if released for immediate render
+} mirror_present_frame;
+
+typedef struct {
+    uint32_t seq;
+    int64_t shown_ns;
+} mirror_present_report;
+
+typedef struct {
+    // Reports come from the platform's thread; the lock guards only this queue.
+    pthread_mutex_t lock;
+    mirror_present_report reports[MIRROR_PRESENT_FRAMES];
+    unsigned head, tail;
+    uint64_t dropped;
+    // Released frames; released, collect and reset are serialised by the
+    // caller (the receiver's codec mutex).
+    mirror_present_frame frames[MIRROR_PRESENT_FRAMES];
+} mirror_present;
+
+void mirror_present_init(mirror_present *p);
+void mirror_present_free(mirror_present *p);
+
+// The decoder is gone or flushed: forget released frames and queued reports.
+void mirror_present_reset(mirror_present *p);
+
+// Frame `seq` was released for render at decoded_ns, for the vsync at
+// target_ns (0: at once). arrival_ns is when it was received, 0 if unknown.
+void mirror_present_released(mirror_present *p, uint32_t seq, int64_t arrival_ns, int64_t decoded_ns,
+                             int64_t target_ns);
+
+// Any thread: frame `seq` was shown at shown_ns (CLOCK_MONOTONIC).
+void mirror_present_shown(mirror_present *p, uint32_t seq, int64_t shown_ns);
+
+// Match queued reports against released frames into `st`.
+void mirror_present_collect(mirror_present *p, mirror_present_stats *st);
+
+#endif
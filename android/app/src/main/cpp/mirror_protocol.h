@@ -0,0 +1,193 @@
+// mirror_protocol.h — Daylight Mirror wire protocol constants and packet helpers.
+//
+// Frame:   [0xDA 0x7E] [flags:1B] [seq:4B LE] [length:4B LE] [payload]
+// Command: [0xDA 0x7F] [cmd:1B] [value:1B]   (CMD_RESOLUTION: [w:2B LE] [h:2B LE])
+// ACK:     [0xDA 0x7A] [seq:4B LE]           — receiver → sender, one per frame
+//
+// The receiver also sends 4-byte command packets upstream: CMD_REQUEST_KEYFRAME
+// (value: MIRROR_KEYFRAME_REASON_*) and, once per connection, CMD_CODECS. Senders
+// that do not know them skip them while scanning for ACKs.
+//
+// Codec negotiation: a receiver that knows its hardware sends CMD_CODECS with the
+// codecs it decodes, fastest first (mirror_codecs_pack). The sender picks the
+// first one it can encode (mirror_codec_pick) and announces it with CMD_CODEC
+// before the next keyframe. Without either packet the stream is HEVC.
+//
+// Frame flags: bit 0 keyframe. Payloads are Annex B (H.264/HEVC) or AV1 OBUs, as
+// selected by CMD_CODEC, unless FLAG_GREY_LZ4 is set, in which case they are LZ4
+// greyscale (see mirror_grey.h).
+//
+// Sender timing: a receiver that sends CMD_FEATURES with MIRROR_FEATURE_FRAME_TIMING
+// may get frames with FLAG_FRAME_TIMING, whose payload (and length) starts with
+// FRAME_TIMING_SIZE bytes: [capture→submit µs:4 LE] [encoder queue µs:4 LE]
+// [encode µs:4 LE], then the usual payload. Senders strip the block for receivers
+// that did not advertise the feature.
+//
+// Vsync reports: a sender that locks its capture phase to the display sends
+// CMD_VSYNC_REPORTS (value 1). From then on the receiver sends, for each frame
+// it releases for a vsync, [0xDA 0x7B] [seq:4 LE] [arrival→latch µs:4 LE]
+// [ready→latch µs:4 LE] [vsync period µs:4 LE]: when the latch deadline falls
+// after the frame arrived and after it was decoded (the slack). The sender maps
+// the deadline into its own clock through the frame's send time.
+//
+// Must stay in sync with Configuration.swift on the Mac side.
+
+#ifndef MIRROR_PROTOCOL_H
+#define MIRROR_PROTOCOL_H
+
+#include <stdint.h>
+
+#define MAGIC_FRAME_0 0xDA
+#define MAGIC_FRAME_1 0x7E
+#define MAGIC_CMD_1   0x7F
+#define MAGIC_ACK_1   0x7A
+#define MAGIC_VSYNC_1 0x7B
+#define FLAG_KEYFRAME 0x01
+#define FLAG_GREY_LZ4 0x02    // LZ4 greyscale payload (Linux sender)
+#define FLAG_GREY_TILES 0x04  // with FLAG_GREY_LZ4: changed-tile layout
+#define FLAG_FRAME_TIMING 0x08  // payload starts with a FRAME_TIMING_SIZE timing block
+#define FRAME_HEADER_SIZE 11
+#define FRAME_TIMING_SIZE 12
+#define ACK_SIZE 6
+#define VSYNC_REPORT_SIZE 18
+#define CMD_SIZE 4
+#define RESOLUTION_CMD_SIZE 7
+#define CMD_BRIGHTNESS 0x01
+#define CMD_WARMTH     0x02
+#define CMD_BACKLIGHT_TOGGLE 0x03
+#define CMD_RESOLUTION 0x04
+#define CMD_REQUEST_KEYFRAME 0x05   // receiver → sender: send an IDR as soon as possible
+#define CMD_CODECS     0x06         // receiver → sender: value = ranked codec list
+#define CMD_CODEC      0x07         // sender → receiver: value = MIRROR_CODEC_* of the stream
+#define CMD_FEATURES   0x08         // receiver → sender: value = MIRROR_FEATURE_* bits
+#define CMD_VSYNC_REPORTS 0x09      // sender → receiver: value 1 = send vsync reports, 0 = stop
+
+#define MIRROR_FEATURE_FRAME_TIMING 0x01   // understands FLAG_FRAME_TIMING
+
+#define MIRROR_KEYFRAME_REASON_STALL   1   // decoder watchdog flushed or rebuilt the decoder
+#define MIRROR_KEYFRAME_REASON_JOIN    2   // new session or decoder, no random access point yet
+
+// Codec ids on the wire. HEVC is 0 so that a zeroed field means the legacy stream.
+#define MIRROR_CODEC_HEVC  0
+#define MIRROR_CODEC_H264  1
+#define MIRROR_CODEC_AV1   2
+#define MIRROR_CODEC_COUNT 3
+#define MIRROR_CODEC_BIT(id) (1u << (id))
+#define MIRROR_MAX_CODECS  4     // entries in one CMD_CODECS value
+
+static inline uint32_t read_le32(const uint8_t *p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void write_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+static inline void write_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+static inline void encode_frame_header(uint8_t hdr[FRAME_HEADER_SIZE], uint8_t flags,
+                                       uint32_t seq, uint32_t len) {
+    hdr[0] = MAGIC_FRAME_0;
+    hdr[1] = MAGIC_FRAME_1;
+    hdr[2] = flags;
+    write_le32(hdr + 3, seq);
+    write_le32(hdr + 7, len);
+}
+
+// Sender-side latency of one frame, from a FLAG_FRAME_TIMING block.
+typedef struct {
+    uint32_t capture_us;        // display capture → encoder submission
+    uint32_t queue_us;          // waiting behind earlier frames in the encoder
+    uint32_t encode_us;
+} mirror_frame_timing;
+
+static inline void encode_frame_timing(uint8_t block[FRAME_TIMING_SIZE], const mirror_frame_timing *t) {
+    write_le32(block, t->capture_us);
+    write_le32(block + 4, t->queue_us);
+    write_le32(block + 8, t->encode_us);
+}
+
+static inline void decode_frame_timing(const uint8_t block[FRAME_TIMING_SIZE], mirror_frame_timing *t) {
+    t->capture_us = read_le32(block);
+    t->queue_us = read_le32(block + 4);
+    t->encode_us = read_le32(block + 8);
+}
+
+static inline void encode_ack(uint8_t ack[ACK_SIZE], uint32_t seq) {
+    ack[0] = MAGIC_FRAME_0;
+    ack[1] = MAGIC_ACK_1;
+    write_le32(ack + 2, seq);
+}
+
+static inline void encode_vsync_report(uint8_t pkt[VSYNC_REPORT_SIZE], uint32_t seq,
+                                       uint32_t arrival_to_latch_us, uint32_t slack_us,
+                                       uint32_t period_us) {
+    pkt[0] = MAGIC_FRAME_0;
+    pkt[1] = MAGIC_VSYNC_1;
+    write_le32(pkt + 2, seq);
+    write_le32(pkt + 6, arrival_to_latch_us);
+    write_le32(pkt + 10, slack_us);
+    write_le32(pkt + 14, period_us);
+}
+
+static inline void encode_command(uint8_t pkt[CMD_SIZE], uint8_t cmd, uint8_t value) {
+    pkt[0] = MAGIC_FRAME_0;
+    pkt[1] = MAGIC_CMD_1;
+    pkt[2] = cmd;
+    pkt[3] = value;
+}
+
+static inline void encode_resolution(uint8_t pkt[RESOLUTION_CMD_SIZE], uint16_t w, uint16_t h) {
+    pkt[0] = MAGIC_FRAME_0;
+    pkt[1] = MAGIC_CMD_1;
+    pkt[2] = CMD_RESOLUTION;
+    write_le16(pkt + 3, w);
+    write_le16(pkt + 5, h);
+}
+
+// CMD_CODECS value: up to four codec ids, fastest first, two bits each (id + 1)
+// from the low bits up; a zero field ends the list.
+static inline uint8_t mirror_codecs_pack(const uint8_t *ranked, int n) {
+    uint8_t v = 0;
+    int shift = 0;
+    for (int i = 0; i < n && shift < 2 * MIRROR_MAX_CODECS; i++) {
+        if (ranked[i] >= MIRROR_CODEC_COUNT) continue;
+        v |= (uint8_t)((ranked[i] + 1) << shift);
+        shift += 2;
+    }
+    return v;
+}
+
+// Returns the number of ids written to `out`.
+static inline int mirror_codecs_unpack(uint8_t v, uint8_t out[MIRROR_MAX_CODECS]) {
+    int n = 0;
+    for (int shift = 0; shift < 2 * MIRROR_MAX_CODECS; shift += 2) {
+        uint8_t field = (v >> shift) & 3;
+        if (field == 0) break;
+        out[n++] = (uint8_t)(field - 1);
+    }
+    return n;
+}
+
+// The receiver's fastest codec among `allowed` (MIRROR_CODEC_BIT mask: what the
+// sender encodes and every other receiver decodes). HEVC if none match.
+static inline uint8_t mirror_codec_pick(const uint8_t *ranked, int n, uint32_t allowed) {
+    for (int i = 0; i < n; i++) {
+        if (ranked[i] < MIRROR_CODEC_COUNT && (allowed & MIRROR_CODEC_BIT(ranked[i]))) {
+            return ranked[i];
+        }
+    }
+    return MIRROR_CODEC_HEVC;
+}
+
+#endif
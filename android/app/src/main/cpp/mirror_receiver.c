@@ -0,0 +1,985 @@
+// mirror_receiver.c — Receive loop, protocol parse and ACK logic for Daylight Mirror.
+//
+// Receives compressed access units (HEVC by default, or the codec negotiated
+// with CMD_CODECS/CMD_CODEC) over TCP (ADB reverse tunnel on device, loopback
+// on host), feeds them into the configured decoder backend and ACKs each
+// frame so the Mac can measure RTT and bound inflight frames. LZ4 greyscale
+// frames from the Linux sender are decoded on the CPU (mirror_grey.c) and handed
+// to the platform instead.
+//
+// No NDK or JNI dependencies — see mirror_receiver.h for the backend interfaces.
+
+#include "mirror_receiver.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#ifndef __ANDROID__
+int mirror_log_quiet = 0;
+#endif
+
+#define NAL_BUF_INITIAL (2 * 1024 * 1024)  // 2MB — plenty for any single access unit
+
+static void set_thread_realtime(const char *name) {
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        setpriority(PRIO_PROCESS, 0, -10);
+        LOGI("%s: SCHED_FIFO unavailable, using nice=-10", name);
+    } else {
+        LOGI("%s: SCHED_FIFO priority %d", name, param.sched_priority);
+    }
+}
+
+static int blocking_read(void *ctx, int sock, void *buf, int n) {
+    (void)ctx;
+    int total = 0;
+    while (total < n) {
+        int r = recv(sock, (uint8_t *)buf + total, n - total, MSG_WAITALL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        total += r;
+    }
+    return total;
+}
+
+const mirror_transport_ops mirror_blocking_transport_ops = {
+    .name = "blocking",
+    .read = blocking_read,
+};
+
+static int read_exact(mirror_receiver *r, int sock, void *buf, int n) {
+    return r->transport.ops->read(r->transport.ctx, sock, buf, n);
+}
+
+static void send_upstream(mirror_receiver *r, int sock, const uint8_t *buf, int n) {
+    if (r->transport.ops->write) {
+        r->transport.ops->write(r->transport.ctx, sock, buf, n);
+    } else {
+        send(sock, buf, (size_t)n, MSG_NOSIGNAL);
+    }
+}
+
+static void send_ack(mirror_receiver *r, int sock, uint32_t seq) {
+    uint8_t ack[ACK_SIZE];
+    encode_ack(ack, seq);
+    send_upstream(r, sock, ack, ACK_SIZE);
+}
+
+static void notify_connection_state(mirror_receiver *r, int connected) {
+    if (r->platform && r->platform->on_connection_state) {
+        r->platform->on_connection_state(r->platform_ctx, connected);
+    }
+}
+
+void mirror_receiver_init(mirror_receiver *r,
+                          const mirror_decoder_ops *decoder_ops, void *decoder_ctx,
+                          const mirror_platform_ops *platform_ops, void *platform_ctx) {
+    memset(r, 0, sizeof(*r));
+    strncpy(r->host, "127.0.0.1", sizeof(r->host) - 1);
+    r->port = 8888;
+    r->sock = -1;
+    r->decoder.ops = decoder_ops;
+    r->decoder.ctx = decoder_ctx;
+    r->platform = platform_ops;
+    r->platform_ctx = platform_ctx;
+    r->transport.ops = &mirror_blocking_transport_ops;
+    r->frame_w = DEFAULT_FRAME_W;
+    r->frame_h = DEFAULT_FRAME_H;
+    r->codec = mirror_codec_get(MIRROR_CODEC_HEVC);
+    r->held_output = -1;
+    r->input_timeout_us = 2000;
+    r->stall_inputs = 30;
+    r->stall_us = 500000;
+    r->stat_interval_s = 5.0;
+    r->realtime = 1;
+    r->record_fd = -1;
+    r->present_lead_us = 2000;
+    mirror_vsync_init(&r->vsync);
+    mirror_present_init(&r->present);
+    mirror_grey_init(&r->grey);
+    pthread_mutex_init(&r->codec_mutex, NULL);
+}
+
+void mirror_receiver_free(mirror_receiver *r) {
+    mirror_receiver_stop(r);
+    mirror_receiver_destroy_decoder(r);
+    free(r->nal_buf);
+    r->nal_buf = NULL;
+    r->nal_buf_capacity = 0;
+    mirror_grey_free(&r->grey);
+    mirror_vsync_free(&r->vsync);
+    mirror_present_free(&r->present);
+    pthread_mutex_destroy(&r->codec_mutex);
+}
+
+// A new decoder, or a new session on the old one, has no usable references:
+// skip P-frames until a keyframe or recovery point. The first skipped frame asks
+// the sender for a keyframe, so joining a stream without periodic IDRs costs
+// one round trip. Called with codec_mutex held.
+static void await_join(mirror_receiver *r) {
+    r->wd_awaiting_key = 1;
+    r->wd_joining = 1;
+    r->wd_key_requested_us = mirror_now_us() - r->stall_us;
+}
+
+// Called with codec_mutex held. While the output is detached there is no window
+// to configure against: remember the size and build on attach.
+static int configure_decoder(mirror_receiver *r, uint32_t width, uint32_t height) {
+    r->held_output = -1;
+    if (r->calibrating) {
+        r->frame_w = width;
+        r->frame_h = height;
+        r->grey_active = 0;
+        r->calibration_rebuild = 1;
+        LOGI("Calibrating, %s decoder deferred: %ux%u", r->codec->name, width, height);
+        return 0;
+    }
+    if (r->output_detached) {
+        if (r->codec_ready) r->decoder.ops->release(r->decoder.ctx);
+        r->codec_ready = 0;
+        r->frame_w = width;
+        r->frame_h = height;
+        r->grey_active = 0;
+        LOGI("Output detached, %s decoder deferred: %ux%u", r->codec->name, width, height);
+        return 0;
+    }
+    int ok = r->decoder.ops->configure(r->decoder.ctx, r->codec, width, height);
+    r->codec_ready = ok;
+    if (ok) {
+        r->frame_w = width;
+        r->frame_h = height;
+        r->grey_active = 0;
+        r->wd_stage = MIRROR_WD_IDLE;
+        r->wd_inputs = 0;
+        await_join(r);
+        r->wd_last_output_us = mirror_now_us();
+        mirror_present_reset(&r->present);
+        LOGI("%s %s decoder started: %ux%u", r->decoder.ops->name, r->codec->name, width, height);
+    }
+    return ok;
+}
+
+int mirror_receiver_create_decoder(mirror_receiver *r, uint32_t width, uint32_t height) {
+    pthread_mutex_lock(&r->codec_mutex);
+    int ok = configure_decoder(r, width, height);
+    pthread_mutex_unlock(&r->codec_mutex);
+    return ok;
+}
+
+void mirror_receiver_destroy_decoder(mirror_receiver *r) {
+    pthread_mutex_lock(&r->codec_mutex);
+    if (r->codec_ready) {
+        r->decoder.ops->release(r->decoder.ctx);
+        r->codec_ready = 0;
+    }
+    r->held_output = -1;
+    r->present_target_ns = 0;
+    mirror_present_reset(&r->present);
+    pthread_mutex_unlock(&r->codec_mutex);
+}
+
+// MARK: - Decoder watchdog
+//
+// A decoder that stops producing output (bad NAL, Surface hiccup) otherwise
+// fills its input slots, every later frame times out in dequeue_input and is
+// dropped-but-ACKed, and nothing changes until a reconnect. All watchdog
+// functions run on the decode thread with codec_mutex held.
+
+static void request_keyframe(mirror_receiver *r, int sock, int64_t now) {
+    uint8_t pkt[CMD_SIZE];
+    encode_command(pkt, CMD_REQUEST_KEYFRAME,
+                   r->wd_joining ? MIRROR_KEYFRAME_REASON_JOIN : MIRROR_KEYFRAME_REASON_STALL);
+    send_upstream(r, sock, pkt, CMD_SIZE);
+    r->stats.keyframe_requests++;
+    r->wd_key_requested_us = now;
+}
+
+// Flush on the first stall; rebuild if the decoder stalls again before any
+// output (or cannot flush). Either way the next decodable frame is a keyframe.
+static void watchdog_recover(mirror_receiver *r, int sock, int64_t now) {
+    const mirror_decoder_ops *dec = r->decoder.ops;
+    void *ctx = r->decoder.ctx;
+
+    if (r->wd_stage == MIRROR_WD_IDLE) {
+        r->stats.stalls++;
+        LOGE("Decoder stalled: %d inputs, %.0fms without output", r->wd_inputs,
+             (now - r->wd_first_input_us) / 1000.0);
+    }
+    r->held_output = -1;   // returned to the decoder by the flush or release
+    mirror_present_reset(&r->present);
+    if (r->wd_stage == MIRROR_WD_IDLE && dec->flush && dec->flush(ctx)) {
+        r->wd_stage = MIRROR_WD_FLUSHED;
+        r->stats.flushes++;
+        LOGI("Decoder flushed, requesting keyframe");
+    } else {
+        dec->release(ctx);
+        r->codec_ready = dec->configure(ctx, r->codec, r->frame_w, r->frame_h);
+        r->wd_stage = MIRROR_WD_REBUILT;
+        r->stats.rebuilds++;
+        LOGI("Decoder rebuilt (%s), requesting keyframe", r->codec_ready ? "ok" : "failed");
+    }
+    r->wd_inputs = 0;
+    r->wd_awaiting_key = 1;
+    r->wd_joining = 0;
+    request_keyframe(r, sock, now);
+}
+
+// Account for one input (queued or timed out) and whether any output came back.
+static void watchdog_note(mirror_receiver *r, int sock, int produced) {
+    if (r->stall_inputs <= 0) return;
+    int64_t now = mirror_now_us();
+    if (produced) {
+        if (r->wd_stage != MIRROR_WD_IDLE) {
+            double ms = (now - r->wd_last_output_us) / 1000.0;
+            r->stats.recoveries++;
+            r->stats.recover_ms_last = ms;
+            if (ms > r->stats.recover_ms_max) r->stats.recover_ms_max = ms;
+            LOGI("Decoder recovered after %.0fms (%s)", ms,
+                 r->wd_stage == MIRROR_WD_FLUSHED ? "flush" : "rebuild");
+            r->wd_stage = MIRROR_WD_IDLE;
+        }
+        r->wd_inputs = 0;
+        r->wd_last_output_us = now;
+        return;
+    }
+    if (r->wd_inputs++ == 0) r->wd_first_input_us = now;
+    if (r->wd_inputs >= r->stall_inputs || now - r->wd_first_input_us >= r->stall_us) {
+        watchdog_recover(r, sock, now);
+    }
+}
+
+// While waiting for a keyframe: 1 if this frame must be skipped. An unflagged
+// access unit the decoder can start at (recovery point SEI, CRA) ends the wait
+// too. Asks again every stall_us in case the request or the keyframe was lost.
+static int watchdog_skip(mirror_receiver *r, int sock, const uint8_t *data, size_t len, int is_idr) {
+    if (!r->wd_awaiting_key) return 0;
+    if (is_idr || mirror_codec_random_access(r->codec, data, len)) {
+        if (!is_idr) r->stats.recovery_points++;
+        r->wd_awaiting_key = 0;
+        r->wd_joining = 0;
+        return 0;
+    }
+    int64_t now = mirror_now_us();
+    if (now - r->wd_key_requested_us >= r->stall_us) request_keyframe(r, sock, now);
+    if (r->wd_joining) r->stats.join_drops++;
+    else r->stats.recovery_drops++;
+    return 1;
+}
+
+// Count frames that reached the window; the first after an attach ends the resume.
+static void note_rendered(mirror_receiver *r, int rendered) {
+    r->stats.rendered += (uint64_t)rendered;
+    if (rendered > 0 && r->resume_us) {
+        double ms = (mirror_now_us() - r->resume_us) / 1000.0;
+        r->resume_us = 0;
+        r->stats.resumes++;
+        r->stats.resume_ms_last = ms;
+        if (ms > r->stats.resume_ms_max) r->stats.resume_ms_max = ms;
+        LOGI("Output resumed: first frame %.1fms after attach", ms);
+    }
+}
+
+// Show decoded frame idx. With a vsync clock it is released for the first
+// vsync the compositor can still latch it for; a frame already released for
+// that vsync is superseded (the compositor drops it). Judder compares the
+// interval between the vsyncs two frames are shown at with the interval
+// between their decodes: 0 when presentation keeps the decoder's cadence.
+static void present_output(mirror_receiver *r, int sock, size_t idx, int64_t pts_us) {
+    const mirror_decoder_ops *dec = r->decoder.ops;
+    int64_t now_ns = mirror_now_us() * 1000;
+    int64_t target = dec->release_output_at
+        ? mirror_vsync_next(&r->vsync, now_ns + r->present_lead_us * 1000) : 0;
+    uint32_t seq = (uint32_t)pts_us;
+    int slot = seq & (MIRROR_ARRIVALS - 1);
+    int64_t arrival_us = r->arrival_seq[slot] == seq ? r->arrival_us[slot] : 0;
+    mirror_present_released(&r->present, seq, arrival_us * 1000, now_ns, target);
+    if (!target) {
+        dec->release_output(r->decoder.ctx, idx, 1);
+        r->present_target_ns = 0;
+        return;
+    }
+    dec->release_output_at(r->decoder.ctx, idx, target);
+
+    mirror_receiver_stats *st = &r->stats;
+    double slack = (target - now_ns) / 1e6 - r->present_lead_us / 1000.0;
+    st->slack_ms_last = slack;
+    if (!st->timed_presents || slack < st->slack_ms_min) st->slack_ms_min = slack;
+    st->slack_ms_sum += slack;
+    st->timed_presents++;
+    if (target == r->present_target_ns) {
+        st->superseded++;
+    } else if (r->present_target_ns) {
+        double judder = (target - r->present_target_ns - (now_ns - r->present_decoded_ns)) / 1e6;
+        st->judder_ms_sum += judder < 0 ? -judder : judder;
+        st->judder_samples++;
+    }
+    r->present_target_ns = target;
+    r->present_decoded_ns = now_ns;
+
+    if (r->vsync_reports && arrival_us) {
+        int64_t latch_us = target / 1000 - r->present_lead_us;
+        uint8_t pkt[VSYNC_REPORT_SIZE];
+        encode_vsync_report(pkt, seq, (uint32_t)(latch_us - arrival_us),
+                            (uint32_t)(latch_us - now_ns / 1000),
+                            (uint32_t)(mirror_vsync_period(&r->vsync) / 1000));
+        send_upstream(r, sock, pkt, VSYNC_REPORT_SIZE);
+        st->vsync_reports++;
+    }
+}
+
+// Release every ready output buffer: the newest is shown, older ones decoded
+// in the same pass would only be replaced before the next latch and are
+// dropped. While the output is detached the newest is held instead. Reports of
+// frames shown since the last pass are matched first. Returns the number of
+// frames decoded, rendered or not.
+static int drain_output(mirror_receiver *r, int sock) {
+    const mirror_decoder_ops *dec = r->decoder.ops;
+    mirror_output_info info;
+    ssize_t output_idx, newest = -1;
+    int64_t newest_pts = 0;
+    int decoded = 0;
+    mirror_present_collect(&r->present, &r->stats.display);
+    while ((output_idx = dec->dequeue_output(r->decoder.ctx, &info, 0)) >= 0) {
+        if (info.size <= 0) {
+            dec->release_output(r->decoder.ctx, (size_t)output_idx, 0);
+            continue;
+        }
+        decoded++;
+        if (r->output_detached) {
+            if (r->held_output >= 0) dec->release_output(r->decoder.ctx, (size_t)r->held_output, 0);
+            r->held_output = (int)output_idx;
+            continue;
+        }
+        if (newest >= 0) {
+            dec->release_output(r->decoder.ctx, (size_t)newest, 0);
+            r->stats.superseded++;
+        }
+        newest = output_idx;
+        newest_pts = info.pts_us;
+    }
+    if (newest >= 0) present_output(r, sock, (size_t)newest, newest_pts);
+    note_rendered(r, newest >= 0);
+    return decoded;
+}
+
+// Feed one access unit into the decoder and render whatever output is ready.
+// Returns 0 on fatal error (no decoder).
+static int feed_nal(mirror_receiver *r, const uint8_t *data, size_t len, int is_idr,
+                    uint32_t seq, int sock, double *out_decode_ms) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    pthread_mutex_lock(&r->codec_mutex);
+    if (!r->codec_ready) {
+        // Detached without a decoder: nothing to show, keep the sender moving.
+        int detached = r->output_detached;
+        pthread_mutex_unlock(&r->codec_mutex);
+        if (detached) send_ack(r, sock, seq);
+        return detached;
+    }
+    const mirror_decoder_ops *dec = r->decoder.ops;
+    void *ctx = r->decoder.ctx;
+
+    if (watchdog_skip(r, sock, data, len, is_idr)) {
+        pthread_mutex_unlock(&r->codec_mutex);
+        send_ack(r, sock, seq);
+        return 1;
+    }
+
+    ssize_t input_idx = dec->dequeue_input(ctx, r->input_timeout_us);
+    if (input_idx < 0) {
+        // Timeout — frame dropped, still ACK so sender inflight does not ratchet up.
+        r->stats.input_timeouts++;
+        watchdog_note(r, sock, drain_output(r, sock) > 0);
+        pthread_mutex_unlock(&r->codec_mutex);
+        send_ack(r, sock, seq);
+        return 1;
+    }
+
+    size_t buf_size = 0;
+    uint8_t *input_buf = dec->get_input(ctx, (size_t)input_idx, &buf_size);
+    if (!input_buf || len > buf_size) {
+        dec->queue_input(ctx, (size_t)input_idx, 0, 0, 0);
+        pthread_mutex_unlock(&r->codec_mutex);
+        LOGE("Input buffer too small: need %zu, have %zu", len, buf_size);
+        send_ack(r, sock, seq);
+        return 1;
+    }
+
+    memcpy(input_buf, data, len);
+    // seq as the timestamp names the frame again when it comes out.
+    dec->queue_input(ctx, (size_t)input_idx, len, seq, is_idr ? MIRROR_BUFFER_FLAG_KEY_FRAME : 0);
+    r->arrival_seq[seq & (MIRROR_ARRIVALS - 1)] = seq;
+    r->arrival_us[seq & (MIRROR_ARRIVALS - 1)] = (int64_t)t0.tv_sec * 1000000 + t0.tv_nsec / 1000;
+
+    // Drain all available output buffers and render to the window
+    watchdog_note(r, sock, drain_output(r, sock) > 0);
+
+    pthread_mutex_unlock(&r->codec_mutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *out_decode_ms = ms_diff(t0, t1);
+
+    send_ack(r, sock, seq);
+    return 1;
+}
+
+// Decode an LZ4 greyscale frame and present it. The window cannot have a
+// MediaCodec and a CPU producer at once, so the decoder backend is released the
+// first time a grey frame arrives in a session.
+static void present_grey(mirror_receiver *r, const uint8_t *data, size_t len, uint8_t flags,
+                        uint32_t seq, int sock, double *out_decode_ms) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (!r->grey_active) {
+        LOGI("LZ4 greyscale stream — releasing %s decoder for CPU rendering", r->decoder.ops->name);
+        mirror_receiver_destroy_decoder(r);
+        r->grey_active = 1;
+    }
+
+    if (mirror_grey_decode(&r->grey, r->frame_w, r->frame_h, flags, data, len)) {
+        // The platform swaps windows under codec_mutex.
+        pthread_mutex_lock(&r->codec_mutex);
+        if (!r->output_detached) {
+            if (r->platform && r->platform->present_grey) {
+                r->platform->present_grey(r->platform_ctx, r->grey.frame, r->grey.width, r->grey.height);
+            }
+            note_rendered(r, 1);
+        }
+        pthread_mutex_unlock(&r->codec_mutex);
+    } else {
+        r->stats.grey_dropped++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *out_decode_ms = ms_diff(t0, t1);
+    send_ack(r, sock, seq);
+}
+
+// MARK: - Vsync
+
+void mirror_receiver_vsync(mirror_receiver *r, int64_t vsync_ns) {
+    mirror_vsync_tick(&r->vsync, vsync_ns);
+}
+
+void mirror_receiver_frame_rendered(mirror_receiver *r, int64_t pts_us, int64_t shown_ns) {
+    mirror_present_shown(&r->present, (uint32_t)pts_us, shown_ns);
+}
+
+// MARK: - Output surface
+//
+// Screen off, app switch and window resize destroy the Surface but not the
+// stream. The session keeps reading, decoding and ACKing; only rendering stops,
+// so the sender sees no gap and the decoder keeps its references.
+
+void mirror_receiver_detach_output(mirror_receiver *r) {
+    pthread_mutex_lock(&r->codec_mutex);
+    if (!r->output_detached) {
+        const mirror_decoder_ops *dec = r->decoder.ops;
+        r->output_detached = 1;
+        r->resume_us = 0;
+        r->stats.detaches++;
+        if (r->codec_ready && !(dec->set_output && dec->set_output(r->decoder.ctx, 0))) {
+            LOGI("%s decoder cannot switch output, releasing it until attach", dec->name);
+            dec->release(r->decoder.ctx);
+            r->codec_ready = 0;
+            r->held_output = -1;
+        }
+    }
+    pthread_mutex_unlock(&r->codec_mutex);
+}
+
+int mirror_receiver_attach_output(mirror_receiver *r) {
+    pthread_mutex_lock(&r->codec_mutex);
+    if (!r->output_detached) {
+        pthread_mutex_unlock(&r->codec_mutex);
+        return 1;
+    }
+    const mirror_decoder_ops *dec = r->decoder.ops;
+    void *ctx = r->decoder.ctx;
+    r->output_detached = 0;
+    r->resume_us = mirror_now_us();
+
+    int kept = 1;
+    if (r->grey_active) {
+        // The last grey frame is still in the decoder's buffer.
+        if (r->grey.have_keyframe && r->platform && r->platform->present_grey) {
+            r->platform->present_grey(r->platform_ctx, r->grey.frame, r->grey.width, r->grey.height);
+            note_rendered(r, 1);
+        }
+    } else if (r->codec_ready && dec->set_output && dec->set_output(ctx, 1)) {
+        if (r->held_output >= 0) {
+            dec->release_output(ctx, (size_t)r->held_output, 1);
+            r->held_output = -1;
+            note_rendered(r, 1);
+        }
+    } else {
+        // Released on detach, deferred, or the switch back failed: build for the
+        // new window. The join logic asks for a keyframe on the next P-frame.
+        if (r->codec_ready) dec->release(ctx);
+        r->codec_ready = 0;
+        r->stats.resume_rebuilds++;
+        configure_decoder(r, r->frame_w, r->frame_h);
+        kept = 0;
+    }
+    pthread_mutex_unlock(&r->codec_mutex);
+    return kept;
+}
+
+// The sender announced the stream codec. A change rebuilds the decoder before
+// the keyframe that follows; greyscale streams pick it up on their way back.
+static void set_codec(mirror_receiver *r, uint8_t id) {
+    const mirror_codec_info *codec = r->tuning ? mirror_tuning_codec(r->tuning, id) : mirror_codec_get(id);
+    if (!codec) {
+        LOGE("Unknown codec %u from sender, keeping %s", id, r->codec->name);
+        return;
+    }
+    if (codec == r->codec) return;
+    LOGI("Codec → %s (%s)", codec->name, codec->mime);
+    r->codec = codec;
+    r->stats.codec_switches++;
+    if (!r->grey_active) mirror_receiver_create_decoder(r, r->frame_w, r->frame_h);
+}
+
+void mirror_receiver_set_tuning(mirror_receiver *r, mirror_tuning *t) {
+    r->tuning = t;
+    if (t) r->codec = mirror_tuning_codec(t, r->codec->id);
+}
+
+void mirror_receiver_tune(mirror_receiver *r) {
+    mirror_tuning *t = r->tuning;
+    if (!t) return;
+    pthread_mutex_lock(&r->codec_mutex);
+    int was_ready = r->codec_ready;
+    int calibrate = !t->ready;
+    if (calibrate) {
+        // Calibration takes seconds and owns the decoder meanwhile; it runs
+        // unlocked so a Surface going away is never held up behind it.
+        if (was_ready) {
+            r->decoder.ops->release(r->decoder.ctx);
+            r->codec_ready = 0;
+        }
+        r->calibrating = 1;
+        r->calibration_rebuild = was_ready;
+    }
+    pthread_mutex_unlock(&r->codec_mutex);
+
+    if (calibrate) {
+        uint8_t current = r->codec->id;
+        if (r->n_codecs > 0) {
+            mirror_tuning_run(t, &r->decoder, r->codecs, r->n_codecs);
+        } else {
+            mirror_tuning_run(t, &r->decoder, &current, 1);
+        }
+    }
+
+    pthread_mutex_lock(&r->codec_mutex);
+    r->calibrating = 0;
+    r->n_codecs = mirror_tuning_rank(t, r->codecs, r->n_codecs);
+    r->codec = mirror_tuning_codec(t, r->codec->id);
+    if (calibrate && r->calibration_rebuild && !r->codec_ready) configure_decoder(r, r->frame_w, r->frame_h);
+    r->calibration_rebuild = 0;
+    pthread_mutex_unlock(&r->codec_mutex);
+}
+
+// Tell the sender which codecs this device decodes, fastest first.
+static void advertise_codecs(mirror_receiver *r, int sock) {
+    if (r->n_codecs <= 0) return;
+    uint8_t pkt[CMD_SIZE];
+    encode_command(pkt, CMD_CODECS, mirror_codecs_pack(r->codecs, r->n_codecs));
+    send_upstream(r, sock, pkt, CMD_SIZE);
+}
+
+// Tell the sender which optional protocol features this receiver understands.
+static void advertise_features(mirror_receiver *r, int sock) {
+    if (!r->features) return;
+    uint8_t pkt[CMD_SIZE];
+    encode_command(pkt, CMD_FEATURES, r->features);
+    send_upstream(r, sock, pkt, CMD_SIZE);
+}
+
+// Append to the recording; a failed write ends it (the fd stays the caller's).
+static void record(mirror_receiver *r, const uint8_t *buf, size_t n) {
+    while (r->record_fd >= 0 && n > 0) {
+        ssize_t w = write(r->record_fd, buf, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            LOGE("Recording stopped: %s", strerror(errno));
+            r->record_fd = -1;
+            return;
+        }
+        buf += w;
+        n -= (size_t)w;
+    }
+}
+
+// Handle a command packet body after [DA 7F]. Returns 0 if the connection died.
+static int handle_command(mirror_receiver *r, int sock) {
+    uint8_t cmd;
+    if (read_exact(r, sock, &cmd, 1) < 0) return 0;
+    r->stats.commands++;
+
+    if (cmd == CMD_RESOLUTION) {
+        uint8_t res_data[4];
+        if (read_exact(r, sock, res_data, 4) < 0) return 0;
+        uint32_t new_w = read_le16(res_data);
+        uint32_t new_h = read_le16(res_data + 2);
+        if (r->record_fd >= 0) {
+            uint8_t pkt[RESOLUTION_CMD_SIZE];
+            encode_resolution(pkt, (uint16_t)new_w, (uint16_t)new_h);
+            record(r, pkt, sizeof(pkt));
+        }
+        if (new_w > 0 && new_h > 0 && new_w <= 4096 && new_h <= 4096) {
+            if (r->platform && r->platform->on_resolution) {
+                r->platform->on_resolution(r->platform_ctx, new_w, new_h);
+            }
+            if (r->grey_active) {
+                LOGI("Resolution → %ux%u (greyscale)", new_w, new_h);
+                r->frame_w = new_w;
+                r->frame_h = new_h;
+            } else {
+                LOGI("Resolution → %ux%u, recreating decoder", new_w, new_h);
+                mirror_receiver_create_decoder(r, new_w, new_h);
+            }
+        }
+        return 1;
+    }
+
+    uint8_t value;
+    if (read_exact(r, sock, &value, 1) < 0) return 0;
+    if (cmd == CMD_CODEC) {
+        if (r->record_fd >= 0) {
+            uint8_t pkt[CMD_SIZE];
+            encode_command(pkt, cmd, value);
+            record(r, pkt, sizeof(pkt));
+        }
+        set_codec(r, value);
+        return 1;
+    }
+    if (cmd == CMD_VSYNC_REPORTS) {
+        r->vsync_reports = value != 0;
+        LOGI("Vsync reports %s", r->vsync_reports ? "on" : "off");
+        return 1;
+    }
+    if (r->platform && r->platform->on_command) {
+        r->platform->on_command(r->platform_ctx, cmd, value);
+    }
+    return 1;
+}
+
+static int ensure_nal_buf(mirror_receiver *r, uint32_t len) {
+    if (len <= r->nal_buf_capacity && r->nal_buf) return 1;
+    uint32_t cap = len > NAL_BUF_INITIAL ? len : NAL_BUF_INITIAL;
+    uint8_t *new_buf = (uint8_t *)realloc(r->nal_buf, cap);
+    if (!new_buf) {
+        LOGE("Failed to grow NAL buffer to %u bytes", cap);
+        return 0;
+    }
+    r->nal_buf = new_buf;
+    r->nal_buf_capacity = cap;
+    return 1;
+}
+
+int mirror_receiver_session(mirror_receiver *r, int sock) {
+    if (!ensure_nal_buf(r, NAL_BUF_INITIAL)) return 0;
+    const mirror_transport_ops *transport = r->transport.ops;
+    if (transport->attach && transport->attach(r->transport.ctx, sock) < 0) {
+        LOGE("%s transport failed to attach", transport->name);
+        return 0;
+    }
+    // A new sender announces its codec before the first keyframe; one that
+    // never does (older Mac builds) streams HEVC.
+    set_codec(r, MIRROR_CODEC_HEVC);
+    r->vsync_reports = 0;
+    advertise_codecs(r, sock);
+    advertise_features(r, sock);
+    r->stats.sessions++;
+    // A decoder kept from the last session holds that stream's references.
+    pthread_mutex_lock(&r->codec_mutex);
+    await_join(r);
+    pthread_mutex_unlock(&r->codec_mutex);
+
+    int frame_count = 0;
+    int stat_frames = 0;
+    int dropped_frames = 0;
+    uint32_t last_seq = 0;
+    int has_last_seq = 0;
+    double recv_sum = 0, decode_sum = 0;
+    uint64_t timed_start = 0, encode_us_start = 0, queue_us_start = 0;
+    uint64_t presents_start = r->stats.timed_presents, superseded_start = r->stats.superseded;
+    uint64_t judder_n_start = r->stats.judder_samples;
+    double slack_start = r->stats.slack_ms_sum, judder_start = r->stats.judder_ms_sum;
+    mirror_present_stats display_start = r->stats.display;
+    struct timespec stat_start;
+    clock_gettime(CLOCK_MONOTONIC, &stat_start);
+
+    while (r->running) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        uint8_t magic[2];
+        if (read_exact(r, sock, magic, 2) < 0) {
+            LOGE("Connection lost");
+            break;
+        }
+        if (magic[0] != MAGIC_FRAME_0) {
+            LOGE("Bad magic: 0x%02x 0x%02x", magic[0], magic[1]);
+            break;
+        }
+
+        // Command packet [DA 7F cmd ...]
+        if (magic[1] == MAGIC_CMD_1) {
+            if (!handle_command(r, sock)) break;
+            continue;
+        }
+
+        if (magic[1] != MAGIC_FRAME_1) {
+            LOGE("Unknown packet type: 0x%02x", magic[1]);
+            break;
+        }
+
+        // Frame header: [flags:1] [seq:4 LE] [len:4 LE]
+        uint8_t frame_hdr[FRAME_HEADER_SIZE - 2];
+        if (read_exact(r, sock, frame_hdr, sizeof(frame_hdr)) < 0) {
+            LOGE("Connection lost reading frame header");
+            break;
+        }
+
+        uint8_t flags        = frame_hdr[0];
+        uint32_t seq         = read_le32(frame_hdr + 1);
+        uint32_t payload_len = read_le32(frame_hdr + 5);
+
+        if (has_last_seq && seq != last_seq + 1) {
+            int gap = (int)(seq - last_seq - 1);
+            if (gap > 0 && gap < 1000) {
+                dropped_frames += gap;
+                r->stats.seq_gaps += (uint64_t)gap;
+            }
+        }
+        last_seq = seq;
+        has_last_seq = 1;
+
+        // Decode straight out of the transport's buffer when it can lend one.
+        const uint8_t *payload = NULL;
+        if (r->transport.ops->view) {
+            payload = r->transport.ops->view(r->transport.ctx, sock, (int)payload_len);
+        } else if (ensure_nal_buf(r, payload_len) &&
+                   read_exact(r, sock, r->nal_buf, (int)payload_len) >= 0) {
+            payload = r->nal_buf;
+        }
+        if (!payload) {
+            LOGE("Failed to read payload");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        if ((flags & FLAG_FRAME_TIMING) && payload_len >= FRAME_TIMING_SIZE) {
+            mirror_frame_timing *t = &r->stats.timing_last;
+            decode_frame_timing(payload, t);
+            r->stats.timed_frames++;
+            r->stats.sender_capture_us += t->capture_us;
+            r->stats.sender_queue_us += t->queue_us;
+            r->stats.sender_encode_us += t->encode_us;
+            payload += FRAME_TIMING_SIZE;
+            payload_len -= FRAME_TIMING_SIZE;
+        }
+        if (r->record_fd >= 0) {
+            uint8_t hdr[FRAME_HEADER_SIZE];
+            encode_frame_header(hdr, (uint8_t)(flags & ~FLAG_FRAME_TIMING), seq, payload_len);
+            record(r, hdr, sizeof(hdr));
+            record(r, payload, payload_len);
+        }
+
+        double decode_ms = 0.0;
+        if (flags & FLAG_GREY_LZ4) {
+            present_grey(r, payload, payload_len, flags, seq, sock, &decode_ms);
+        } else {
+            if (r->grey_active) {
+                // Sender switched back to HEVC; hand the window back to the decoder.
+                mirror_receiver_create_decoder(r, r->frame_w, r->frame_h);
+            }
+            if (!feed_nal(r, payload, payload_len, (flags & FLAG_KEYFRAME) != 0, seq, sock, &decode_ms)) {
+                LOGE("feed_nal fatal error, reconnecting");
+                break;
+            }
+        }
+
+        if (frame_count == 0) {
+            notify_connection_state(r, 1);
+        }
+
+        recv_sum += ms_diff(t0, t1);
+        decode_sum += decode_ms;
+        frame_count++;
+        stat_frames++;
+        r->stats.frames++;
+        r->stats.bytes += payload_len;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - stat_start.tv_sec) +
+                         (now.tv_nsec - stat_start.tv_nsec) / 1e9;
+        if (elapsed >= r->stat_interval_s && stat_frames > 0) {
+            double fps = stat_frames / elapsed;
+            uint64_t timed = r->stats.timed_frames - timed_start;
+            char sender[64] = "";
+            if (timed > 0) {
+                snprintf(sender, sizeof(sender), " | mac enc: %.1fms +%.1fms queued",
+                         (r->stats.sender_encode_us - encode_us_start) / 1000.0 / timed,
+                         (r->stats.sender_queue_us - queue_us_start) / 1000.0 / timed);
+            }
+            uint64_t presents = r->stats.timed_presents - presents_start;
+            uint64_t judder_n = r->stats.judder_samples - judder_n_start;
+            char vsync[96] = "";
+            if (presents > 0) {
+                snprintf(vsync, sizeof(vsync), " | vsync: slack %.1fms judder %.1fms superseded %llu",
+                         (r->stats.slack_ms_sum - slack_start) / presents,
+                         judder_n ? (r->stats.judder_ms_sum - judder_start) / judder_n : 0.0,
+                         (unsigned long long)(r->stats.superseded - superseded_start));
+            }
+            const mirror_present_stats *ds = &r->stats.display;
+            uint64_t shown = ds->displayed - display_start.displayed;
+            uint64_t arrivals = ds->arrival_samples - display_start.arrival_samples;
+            char display[96] = "";
+            if (shown > 0) {
+                snprintf(display, sizeof(display), " | shown: %.1fms after decode, %.1fms after recv, missed %llu",
+                         (ds->display_ms_sum - display_start.display_ms_sum) / shown,
+                         arrivals ? (ds->arrival_ms_sum - display_start.arrival_ms_sum) / arrivals : 0.0,
+                         (unsigned long long)(ds->undisplayed - display_start.undisplayed));
+            }
+            LOGI("FPS: %.1f | recv: %.1fms | decode: %.1fms%s%s%s | %uKB %s | drops: %d | total: %d",
+                 fps,
+                 recv_sum / stat_frames,
+                 decode_sum / stat_frames,
+                 sender,
+                 vsync,
+                 display,
+                 payload_len / 1024,
+                 (flags & FLAG_KEYFRAME) ? "IDR" : "P",
+                 dropped_frames,
+                 frame_count);
+            timed_start = r->stats.timed_frames;
+            encode_us_start = r->stats.sender_encode_us;
+            queue_us_start = r->stats.sender_queue_us;
+            presents_start = r->stats.timed_presents;
+            superseded_start = r->stats.superseded;
+            judder_n_start = r->stats.judder_samples;
+            slack_start = r->stats.slack_ms_sum;
+            judder_start = r->stats.judder_ms_sum;
+            display_start = r->stats.display;
+            stat_frames = 0;
+            recv_sum = 0;
+            decode_sum = 0;
+            dropped_frames = 0;
+            stat_start = now;
+        }
+    }
+
+    if (transport->detach) transport->detach(r->transport.ctx);
+    return frame_count;
+}
+
+static int connect_to_server(mirror_receiver *r) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        LOGE("socket() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, &flag, sizeof(flag));
+    int rcvbuf = 2 * 1024 * 1024;  // 2MB — HEVC keyframes are far larger than LZ4 deltas were
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(r->port);
+    inet_pton(AF_INET, r->host, &addr.sin_addr);
+
+    LOGI("Connecting to %s:%d ...", r->host, r->port);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        LOGE("connect() failed: %s (is ADB reverse tunnel set up?)", strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static void *decode_thread(void *arg) {
+    mirror_receiver *r = (mirror_receiver *)arg;
+    if (r->realtime) set_thread_realtime("decode_thread");
+    LOGI("Decode thread started, connecting to %s:%d", r->host, r->port);
+
+    if (!ensure_nal_buf(r, NAL_BUF_INITIAL)) {
+        LOGE("Failed to allocate NAL buffer");
+        return NULL;
+    }
+    mirror_receiver_tune(r);
+
+    while (r->running) {
+        int sock = connect_to_server(r);
+        if (sock < 0) {
+            sleep(1);
+            continue;
+        }
+
+        r->sock = sock;
+        LOGI("Connected to server %s:%d", r->host, r->port);
+
+        mirror_receiver_session(r, sock);
+
+        r->sock = -1;
+        close(sock);
+        LOGI("Disconnected, reconnecting in 1s...");
+        notify_connection_state(r, 0);
+        if (r->running) sleep(1);
+    }
+
+    free(r->nal_buf);
+    r->nal_buf = NULL;
+    r->nal_buf_capacity = 0;
+    LOGI("Decode thread exited");
+    return NULL;
+}
+
+int mirror_receiver_start(mirror_receiver *r, const char *host, int port) {
+    if (r->running) return 0;
+    strncpy(r->host, host, sizeof(r->host) - 1);
+    r->host[sizeof(r->host) - 1] = '\0';
+    r->port = port;
+    r->running = 1;
+    if (pthread_create(&r->thread, NULL, decode_thread, r) != 0) {
+        LOGE("pthread_create failed: %s", strerror(errno));
+        r->running = 0;
+        return 0;
+    }
+    r->thread_started = 1;
+    return 1;
+}
+
+void mirror_receiver_stop(mirror_receiver *r) {
+    r->running = 0;
+    int sock = r->sock;
+    if (sock >= 0) {
+        // Unblocks recv() in the decode thread; the thread closes the socket itself.
+        shutdown(sock, SHUT_RDWR);
+    }
+    if (r->thread_started) {
+        pthread_join(r->thread, NULL);
+        r->thread_started = 0;
+    }
+}
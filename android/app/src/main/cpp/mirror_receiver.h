@@ -0,0 +1,247 @@
+// mirror_receiver.h — Platform-independent receiver core for Daylight Mirror.
+//
+// Owns the TCP connect loop, protocol parsing, receive buffer, decoder feeding and
+// ACKs. Everything platform-specific sits behind small interfaces:
+//   - mirror_decoder_ops (mirror_decoder.h): MediaCodec on Android, mock on host
+//   - mirror_platform_ops (below): window geometry, UI callbacks, display commands
+//   - mirror_transport_ops (mirror_transport.h): socket reads, blocking by default
+//
+// The Android build wires these to NDK/JNI in mirror_native.c; the host build
+// (host/CMakeLists.txt) links the same core against the mock decoder for tests
+// and loopback benchmarks.
+
+#ifndef MIRROR_RECEIVER_H
+#define MIRROR_RECEIVER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "mirror_decoder.h"
+#include "mirror_grey.h"
+#include "mirror_present.h"
+#include "mirror_protocol.h"
+#include "mirror_transport.h"
+#include "mirror_tuning.h"
+#include "mirror_vsync.h"
+
+// Default resolution (updated dynamically via CMD_RESOLUTION from server)
+#define DEFAULT_FRAME_W 1024
+#define DEFAULT_FRAME_H 768
+
+// Arrival times kept for vsync reports: frames the decoder may hold (power of two)
+#define MIRROR_ARRIVALS 32
+
+typedef struct {
+    // Connection came up (first frame decoded) or went away.
+    void (*on_connection_state)(void *ctx, int connected);
+    // Stream resolution changed; resize the output window before the decoder is rebuilt.
+    void (*on_resolution)(void *ctx, uint32_t width, uint32_t height);
+    // Single-byte display command (brightness, warmth, ...).
+    void (*on_command)(void *ctx, uint8_t cmd, uint8_t value);
+    // Show a decoded greyscale frame (LZ4 streams). The decoder backend has been
+    // released first, so the window is free for CPU rendering.
+    void (*present_grey)(void *ctx, const uint8_t *pixels, uint32_t width, uint32_t height);
+} mirror_platform_ops;
+
+// Cumulative counters since mirror_receiver_init(). Read by tests and benchmarks.
+typedef struct {
+    uint64_t frames;          // frames received and handed to the decoder path
+    uint64_t bytes;           // payload bytes received
+    uint64_t seq_gaps;        // frames missing from the sequence (lost upstream)
+    uint64_t input_timeouts;  // no decoder input slot within input_timeout_us
+    uint64_t rendered;        // output buffers released with render=1 (or grey frames presented)
+    uint64_t grey_dropped;    // LZ4 grey payloads that failed to decode
+    uint64_t commands;        // command packets handled
+    uint64_t sessions;        // connections served
+    uint64_t codec_switches;  // CMD_CODEC changed the stream codec
+
+    // Sender timing blocks (FLAG_FRAME_TIMING), summed for averages
+    uint64_t timed_frames;
+    uint64_t sender_capture_us;
+    uint64_t sender_queue_us;
+    uint64_t sender_encode_us;
+    mirror_frame_timing timing_last;
+
+    // Decoder watchdog (see stall_inputs below)
+    uint64_t stalls;          // times the decoder stopped producing output
+    uint64_t flushes;
+    uint64_t rebuilds;
+    uint64_t keyframe_requests;
+    uint64_t recovery_drops;  // P-frames skipped while waiting for the requested keyframe
+    uint64_t join_drops;      // P-frames skipped before a new decoder's first random access point
+    uint64_t recovery_points; // joins at an unflagged random access point (intra-refresh streams)
+    uint64_t recoveries;      // stalls that ended with output again
+    double recover_ms_last;   // last output before the stall → first output after it
+    double recover_ms_max;
+
+    // Output surface detach/attach (screen off, app switch, window resize)
+    uint64_t detaches;
+    uint64_t resumes;         // attaches followed by a rendered frame
+    uint64_t resume_rebuilds; // attaches that had to rebuild the decoder
+    double resume_ms_last;    // attach → first frame rendered
+    double resume_ms_max;
+
+    // Vsync-aligned presentation (see present_lead_us below)
+    uint64_t timed_presents;  // frames released for a target vsync
+    uint64_t superseded;      // decoded frames never shown: a newer one took their vsync
+    double slack_ms_last;     // release → latch deadline (target vsync − present_lead_us)
+    double slack_ms_min;
+    double slack_ms_sum;      // over timed_presents
+    double judder_ms_sum;     // |shown interval − decoded interval| between consecutive shown frames
+    uint64_t judder_samples;
+    uint64_t vsync_reports;   // sent upstream (CMD_VSYNC_REPORTS)
+
+    // Frames the platform reported shown (mirror_receiver_frame_rendered)
+    mirror_present_stats display;
+} mirror_receiver_stats;
+
+// Recovery stage of the decoder watchdog.
+typedef enum {
+    MIRROR_WD_IDLE = 0,       // decoder producing output
+    MIRROR_WD_FLUSHED,        // stalled; flushed and waiting for a keyframe
+    MIRROR_WD_REBUILT,        // flush did not help (or is unsupported); decoder rebuilt
+} mirror_wd_stage;
+
+typedef struct {
+    char host[64];
+    int port;
+    volatile int running;
+    volatile int sock;
+
+    mirror_decoder decoder;
+    pthread_mutex_t codec_mutex;
+    int codec_ready;
+    const mirror_codec_info *codec;     // stream codec, set by CMD_CODEC (HEVC by default)
+    // Codecs this device decodes, fastest first, advertised with CMD_CODECS at the
+    // start of every session. Empty: no advert, the sender keeps to HEVC.
+    uint8_t codecs[MIRROR_MAX_CODECS];
+    int n_codecs;
+    // MIRROR_FEATURE_* bits advertised with CMD_FEATURES at session start; 0 sends
+    // no advert. Timing blocks are stripped whether or not they were asked for.
+    uint8_t features;
+    // Per-SoC decoder configuration (NULL: codec defaults). Loaded or
+    // calibrated on the decode thread before the first connect.
+    mirror_tuning *tuning;
+    // Calibration owns the decoder backend without holding codec_mutex, so
+    // detach and attach never wait for it. Builds requested meanwhile are
+    // deferred to its end. Both written with codec_mutex held.
+    int calibrating;
+    int calibration_rebuild;
+    uint32_t frame_w;
+    uint32_t frame_h;
+
+    const mirror_platform_ops *platform;
+    void *platform_ctx;
+
+    mirror_transport transport; // socket reader; set before start()/session()
+
+    // LZ4 greyscale frames bypass the decoder backend
+    mirror_grey_decoder grey;
+    int grey_active;            // decoder released for CPU rendering until next create_decoder
+
+    // Receive buffer — reused across frames
+    uint8_t *nal_buf;
+    uint32_t nal_buf_capacity;
+
+    int64_t input_timeout_us;   // dequeueInputBuffer wait before a frame is dropped (2ms)
+
+    // Decoder watchdog: the decoder counts as stalled after stall_inputs inputs
+    // (queued or timed out) without any output, or when the oldest of them has
+    // waited stall_us. Recovery flushes and asks the sender for a keyframe;
+    // if the decoder stalls again before producing output it is rebuilt.
+    int stall_inputs;           // 0 disables the watchdog (default 30)
+    int64_t stall_us;           // (default 500ms)
+    mirror_wd_stage wd_stage;
+    int wd_inputs;              // inputs since the last output
+    int64_t wd_first_input_us;  // oldest of those inputs
+    int64_t wd_last_output_us;
+    // Output detached (mirror_receiver_detach_output): frames still decode and are
+    // ACKed, nothing is rendered, and the newest decoded frame is held back so an
+    // attach can show it at once. Written with codec_mutex held.
+    volatile int output_detached;
+    int held_output;            // output index held while detached, -1 if none
+    int64_t resume_us;          // attach time, until the first frame renders; 0 if none
+
+    // Vsync-aligned presentation: once the platform ticks the vsync clock
+    // (mirror_receiver_vsync) and the backend has release_output_at, each frame
+    // is released for the first vsync at least present_lead_us away, the time
+    // the compositor needs before its latch. Frames decoded for the same vsync
+    // supersede each other so only the newest is shown. Without vsync ticks,
+    // output renders as soon as it is decoded.
+    mirror_vsync vsync;
+    int64_t present_lead_us;    // (default 2ms)
+    int64_t present_target_ns;  // vsync the previous frame was released for, 0 if none
+    int64_t present_decoded_ns; // when that frame was released
+    // The sender asked for a report of each frame's latch deadline
+    // (CMD_VSYNC_REPORTS); cleared at session start. Frames are queued with
+    // their seq as the presentation timestamp, and the time each was handed to
+    // the decoder is kept by seq for the report.
+    int vsync_reports;
+    uint32_t arrival_seq[MIRROR_ARRIVALS];
+    int64_t arrival_us[MIRROR_ARRIVALS];
+    // Frames released for render, matched against the platform's reports of
+    // when they were actually shown (stats.display).
+    mirror_present present;
+
+    int wd_awaiting_key;        // drop P-frames until a keyframe arrives
+    int wd_joining;             // ...because the session or decoder is new, not after a stall
+    int64_t wd_key_requested_us;
+    double stat_interval_s;     // logcat stats period (5s)
+    // Append the stream to this fd for mirror_replay: frames without their
+    // timing blocks, plus CMD_CODEC and CMD_RESOLUTION. -1 (default) is off.
+    int record_fd;
+    int realtime;               // request SCHED_FIFO for the decode thread
+
+    mirror_receiver_stats stats;
+
+    pthread_t thread;
+    int thread_started;
+} mirror_receiver;
+
+void mirror_receiver_init(mirror_receiver *r,
+                          const mirror_decoder_ops *decoder_ops, void *decoder_ctx,
+                          const mirror_platform_ops *platform_ops, void *platform_ctx);
+void mirror_receiver_free(mirror_receiver *r);
+
+// Build (or rebuild) the decoder for width x height. Returns 1 on success, 0 on failure.
+int mirror_receiver_create_decoder(mirror_receiver *r, uint32_t width, uint32_t height);
+void mirror_receiver_destroy_decoder(mirror_receiver *r);
+
+// The output surface is going away: keep the session and decoder running with
+// output switched to a sink (decoder_ops.set_output) or, without one, the decoder
+// released. Frames keep being ACKed. Call before the window is destroyed.
+void mirror_receiver_detach_output(mirror_receiver *r);
+// A new output surface is ready (the platform's window already points at it).
+// Returns 1 if decoding carried on where it was — the newest frame is shown at
+// once — or 0 if the decoder had to be rebuilt and will wait for a keyframe.
+// Either way stats.resume_ms_last times attach → first rendered frame.
+int mirror_receiver_attach_output(mirror_receiver *r);
+
+// A display vsync happened at vsync_ns (CLOCK_MONOTONIC). Call from the
+// platform's vsync callback, on any thread.
+void mirror_receiver_vsync(mirror_receiver *r, int64_t vsync_ns);
+
+// The frame queued with presentation timestamp pts_us (its seq) was shown on
+// the display at shown_ns (CLOCK_MONOTONIC). Call from the platform's
+// frame-rendered callback, on any thread; matched on the decode thread.
+void mirror_receiver_frame_rendered(mirror_receiver *r, int64_t pts_us, int64_t shown_ns);
+
+// Use `t` for every decoder built from now on. Call before start().
+void mirror_receiver_set_tuning(mirror_receiver *r, mirror_tuning *t);
+// Load or calibrate the tuning if it is not ready yet, rank the advertised
+// codecs by measured latency and rebuild the decoder if one was running. The
+// decode thread calls this before connecting; no-op without a tuning. Detach
+// and attach do not wait for calibration, which decodes to memory when the
+// backend can.
+void mirror_receiver_tune(mirror_receiver *r);
+
+// Serve one already-connected stream until it closes, errors or the receiver is
+// stopped. Does not close `sock`. Returns the number of frames processed.
+int mirror_receiver_session(mirror_receiver *r, int sock);
+
+// Spawn the decode thread: connect to host:port, serve, reconnect every 1s.
+// Returns 1 if the thread was started.
+int mirror_receiver_start(mirror_receiver *r, const char *host, int port);
+// Stop the decode thread and wait for it. The decoder is left configured.
+void mirror_receiver_stop(mirror_receiver *r);
+
+#endif
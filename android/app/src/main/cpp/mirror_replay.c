@@ -0,0 +1,317 @@
+// mirror_replay.c — Recorded stream → decoder → memory, timed; see mirror_replay.h.
+
+#include "mirror_replay.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DIMENSION 4096
+
+typedef struct {
+    const mirror_decoder *dec;
+    const mirror_replay_config *cfg;
+    mirror_replay_result *out;
+    const mirror_codec_info *codec;
+    uint32_t width, height;
+    int configured;
+    int joined;                 // a random access point has been queued
+    int inflight;
+    int64_t *queued_us;         // by frame index (the presentation timestamp)
+    double *latency_ms;         // by output index
+    int capacity;               // entries in both (frames in the recording)
+    int64_t first_us, last_us;
+} replay;
+
+// One packet of the recording.
+typedef struct {
+    int is_frame;
+    uint8_t flags;
+    const uint8_t *payload;
+    uint32_t len;
+    uint8_t cmd;
+    uint8_t value;
+    uint32_t width, height;     // CMD_RESOLUTION
+} packet;
+
+// Parse the packet at *pos. Returns 1, 0 at the end of the stream or -1 if it
+// is malformed. Commands other than CMD_CODEC and CMD_RESOLUTION are 4 bytes
+// and carry nothing replay needs.
+static int next_packet(const uint8_t *stream, size_t len, size_t *pos, packet *pkt) {
+    size_t p = *pos;
+    if (p == len) return 0;
+    if (len - p < CMD_SIZE || stream[p] != MAGIC_FRAME_0) return -1;
+    memset(pkt, 0, sizeof(*pkt));
+    if (stream[p + 1] == MAGIC_CMD_1) {
+        pkt->cmd = stream[p + 2];
+        if (pkt->cmd == CMD_RESOLUTION) {
+            if (len - p < RESOLUTION_CMD_SIZE) return -1;
+            pkt->width = read_le16(stream + p + 3);
+            pkt->height = read_le16(stream + p + 5);
+            *pos = p + RESOLUTION_CMD_SIZE;
+        } else {
+            pkt->value = stream[p + 3];
+            *pos = p + CMD_SIZE;
+        }
+        return 1;
+    }
+    if (stream[p + 1] != MAGIC_FRAME_1 || len - p < FRAME_HEADER_SIZE) return -1;
+    pkt->is_frame = 1;
+    pkt->flags = stream[p + 2];
+    pkt->len = read_le32(stream + p + 7);
+    if (pkt->len > len - p - FRAME_HEADER_SIZE) return -1;
+    pkt->payload = stream + p + FRAME_HEADER_SIZE;
+    if ((pkt->flags & FLAG_FRAME_TIMING) && pkt->len >= FRAME_TIMING_SIZE) {
+        pkt->payload += FRAME_TIMING_SIZE;
+        pkt->len -= FRAME_TIMING_SIZE;
+    }
+    *pos = p + FRAME_HEADER_SIZE + read_le32(stream + p + 7);
+    return 1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void note_checksum(replay *rp, size_t idx, int n) {
+    mirror_replay_result *out = rp->out;
+    mirror_output_image img;
+    uint32_t sum = 0;
+    if (rp->dec->ops->get_output(rp->dec->ctx, idx, &img)) sum = mirror_luma_checksum(&img);
+    out->checksums[n] = sum;
+    if (rp->cfg->golden && (n >= rp->cfg->n_golden || rp->cfg->golden[n] != sum)) {
+        if (out->first_mismatch < 0) out->first_mismatch = n;
+        out->mismatches++;
+    }
+}
+
+// Take every ready output, waiting up to wait_us for the first. Format and
+// buffer-change notices come back as negative indices; keep waiting for a
+// real buffer until the deadline. Returns the number of frames taken.
+static int take_outputs(replay *rp, int64_t wait_us) {
+    const mirror_decoder_ops *ops = rp->dec->ops;
+    int taken = 0;
+    int64_t deadline = mirror_now_us() + wait_us;
+    for (;;) {
+        mirror_output_info info;
+        int64_t now = mirror_now_us();
+        ssize_t idx = ops->dequeue_output(rp->dec->ctx, &info, taken || now >= deadline ? 0 : deadline - now);
+        if (idx < 0) {
+            if (taken || mirror_now_us() >= deadline) return taken;
+            continue;
+        }
+        if (info.size <= 0) {   // end of stream
+            ops->release_output(rp->dec->ctx, (size_t)idx, 0);
+            continue;
+        }
+        if (rp->out->decoded >= rp->capacity) {   // more outputs than inputs
+            ops->release_output(rp->dec->ctx, (size_t)idx, 0);
+            continue;
+        }
+        now = mirror_now_us();
+        int n = rp->out->decoded++;
+        int64_t frame = info.pts_us;
+        if (frame >= 0 && frame < rp->out->frames) rp->latency_ms[n] = (now - rp->queued_us[frame]) / 1000.0;
+        if (rp->cfg->checksums) note_checksum(rp, (size_t)idx, n);
+        ops->release_output(rp->dec->ctx, (size_t)idx, 0);
+        rp->last_us = now;
+        rp->inflight--;
+        taken++;
+    }
+}
+
+// Queue end of stream and take what is still inside the decoder.
+static void finish_decoder(replay *rp) {
+    const mirror_decoder_ops *ops = rp->dec->ops;
+    ssize_t in = ops->dequeue_input(rp->dec->ctx, rp->cfg->output_timeout_us);
+    if (in >= 0) ops->queue_input(rp->dec->ctx, (size_t)in, 0, 0, MIRROR_BUFFER_FLAG_END_OF_STREAM);
+    while (rp->inflight > 0 && take_outputs(rp, rp->cfg->output_timeout_us) > 0) {}
+    rp->inflight = 0;
+}
+
+static int configure(replay *rp) {
+    if (rp->configured) {
+        finish_decoder(rp);
+        rp->dec->ops->release(rp->dec->ctx);
+        rp->out->reconfigures++;
+    }
+    rp->configured = rp->dec->ops->configure_memory(rp->dec->ctx, rp->codec, rp->width, rp->height);
+    rp->joined = 0;
+    if (!rp->configured) {
+        LOGE("Replay: %s %ux%u decoder failed to configure", rp->codec->name, rp->width, rp->height);
+    }
+    return rp->configured;
+}
+
+static int feed(replay *rp, const packet *pkt) {
+    const mirror_decoder_ops *ops = rp->dec->ops;
+    void *ctx = rp->dec->ctx;
+    if (!rp->configured && !configure(rp)) return 0;
+    if (!rp->joined) {
+        rp->joined = (pkt->flags & FLAG_KEYFRAME) || mirror_codec_random_access(rp->codec, pkt->payload, pkt->len);
+        if (!rp->joined) {
+            rp->out->skipped++;
+            return 1;
+        }
+    }
+
+    ssize_t in;
+    while ((in = ops->dequeue_input(ctx, 0)) < 0) {
+        if (take_outputs(rp, rp->cfg->output_timeout_us) > 0) continue;
+        if ((in = ops->dequeue_input(ctx, rp->cfg->output_timeout_us)) >= 0) break;
+        LOGE("Replay: decoder stopped taking input after %d frames", rp->out->frames);
+        return 0;
+    }
+    size_t capacity = 0;
+    uint8_t *buf = ops->get_input(ctx, (size_t)in, &capacity);
+    if (!buf || pkt->len > capacity) {
+        ops->queue_input(ctx, (size_t)in, 0, 0, 0);
+        rp->out->skipped++;
+        return 1;
+    }
+    memcpy(buf, pkt->payload, pkt->len);
+    int frame = rp->out->frames++;
+    rp->queued_us[frame] = mirror_now_us();
+    if (!rp->first_us) rp->first_us = rp->queued_us[frame];
+    ops->queue_input(ctx, (size_t)in, pkt->len, frame,
+                     (pkt->flags & FLAG_KEYFRAME) ? MIRROR_BUFFER_FLAG_KEY_FRAME : 0);
+    rp->inflight++;
+    take_outputs(rp, 0);
+    return 1;
+}
+
+void mirror_replay_default_config(mirror_replay_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->codec = MIRROR_CODEC_HEVC;
+    cfg->width = DEFAULT_FRAME_W;
+    cfg->height = DEFAULT_FRAME_H;
+    cfg->output_timeout_us = 500000;
+}
+
+int mirror_replay_run(const mirror_decoder *dec, const uint8_t *stream, size_t len,
+                      const mirror_replay_config *cfg, mirror_replay_result *out) {
+    memset(out, 0, sizeof(*out));
+    out->first_mismatch = -1;
+    const mirror_decoder_ops *ops = dec->ops;
+    if (!ops->configure_memory || (cfg->checksums && !ops->get_output)) {
+        LOGE("Replay: %s decoder cannot decode to memory", ops->name);
+        return -1;
+    }
+
+    // Size the per-frame arrays and reject a malformed recording up front.
+    int frames = 0;
+    packet pkt;
+    size_t pos = 0;
+    int rc;
+    while ((rc = next_packet(stream, len, &pos, &pkt)) > 0) frames += pkt.is_frame;
+    if (rc < 0) {
+        LOGE("Replay: malformed recording at byte %zu", pos);
+        return -1;
+    }
+
+    replay rp = { 0 };
+    rp.dec = dec;
+    rp.cfg = cfg;
+    rp.out = out;
+    rp.codec = cfg->tuning ? mirror_tuning_codec(cfg->tuning, cfg->codec) : mirror_codec_get(cfg->codec);
+    rp.width = cfg->width;
+    rp.height = cfg->height;
+    rp.capacity = frames;
+    rp.queued_us = (int64_t *)calloc((size_t)frames + 1, sizeof(int64_t));
+    rp.latency_ms = (double *)calloc((size_t)frames + 1, sizeof(double));
+    out->checksums = cfg->checksums ? (uint32_t *)calloc((size_t)frames + 1, sizeof(uint32_t)) : NULL;
+    if (!rp.codec || !rp.queued_us || !rp.latency_ms || (cfg->checksums && !out->checksums)) {
+        free(rp.queued_us);
+        free(rp.latency_ms);
+        mirror_replay_result_free(out);
+        return -1;
+    }
+
+    int ok = 1;
+    pos = 0;
+    while (ok && next_packet(stream, len, &pos, &pkt) > 0) {
+        if (pkt.is_frame) {
+            if (pkt.flags & FLAG_GREY_LZ4) out->skipped++;
+            else ok = feed(&rp, &pkt);
+        } else if (pkt.cmd == CMD_CODEC && pkt.value != rp.codec->id && mirror_codec_get(pkt.value)) {
+            rp.codec = cfg->tuning ? mirror_tuning_codec(cfg->tuning, pkt.value) : mirror_codec_get(pkt.value);
+            if (rp.configured) ok = configure(&rp);
+        } else if (pkt.cmd == CMD_RESOLUTION && pkt.width && pkt.height && pkt.width <= MAX_DIMENSION &&
+                   pkt.height <= MAX_DIMENSION && (pkt.width != rp.width || pkt.height != rp.height)) {
+            rp.width = pkt.width;
+            rp.height = pkt.height;
+            if (rp.configured) ok = configure(&rp);
+        }
+    }
+    if (rp.configured) {
+        finish_decoder(&rp);
+        ops->release(dec->ctx);
+    }
+
+    int n = out->decoded;
+    if (cfg->golden && n < cfg->n_golden) {
+        if (out->first_mismatch < 0) out->first_mismatch = n;
+        out->mismatches += cfg->n_golden - n;
+    }
+    if (n > 0) {
+        out->seconds = (rp.last_us - rp.first_us) / 1e6;
+        out->fps = out->seconds > 0 ? n / out->seconds : 0;
+        double sum = 0;
+        for (int i = 0; i < n; i++) sum += rp.latency_ms[i];
+        out->latency_ms_avg = sum / n;
+        qsort(rp.latency_ms, (size_t)n, sizeof(double), cmp_double);
+        out->latency_ms_p50 = rp.latency_ms[n / 2];
+        out->latency_ms_p95 = rp.latency_ms[(int)(0.95 * (n - 1))];
+        out->latency_ms_max = rp.latency_ms[n - 1];
+    }
+    free(rp.queued_us);
+    free(rp.latency_ms);
+    if (!ok) {
+        mirror_replay_result_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void mirror_replay_result_free(mirror_replay_result *res) {
+    free(res->checksums);
+    res->checksums = NULL;
+}
+
+uint32_t mirror_luma_checksum(const mirror_output_image *img) {
+    uint32_t h = 2166136261u;
+    for (uint32_t y = 0; y < img->height; y++) {
+        const uint8_t *row = img->y + (size_t)y * img->stride;
+        for (uint32_t x = 0; x < img->width; x++) {
+            h ^= row[x];
+            h *= 16777619u;
+        }
+    }
+    return h;
+}
+
+int mirror_replay_load_golden(const char *path, uint32_t *out, int max) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[64];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f)) {
+        char *end;
+        unsigned long v = strtoul(line, &end, 16);
+        if (end != line && line[0] != '#') out[n++] = (uint32_t)v;
+    }
+    fclose(f);
+    return n;
+}
+
+int mirror_replay_save_golden(const char *path, const uint32_t *sums, int n) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "# luma checksums, one per decoded frame (mirror_replay)\n");
+    for (int i = 0; i < n; i++) fprintf(f, "%08x\n", sums[i]);
+    return fclose(f) == 0 ? 0 : -1;
+}
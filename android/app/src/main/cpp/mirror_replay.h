@@ -0,0 +1,73 @@
+// mirror_replay.h — Headless decode of a recorded stream, for benchmarks and
+// output verification.
+//
+// A recording is the sender → receiver byte stream (mirror_protocol.h) as the
+// receiver appends it with record_fd: frames with their timing blocks
+// stripped, plus the CMD_CODEC and CMD_RESOLUTION packets that shape decoding.
+// Replay configures the decoder without a surface (configure_memory), feeds
+// every access unit as fast as the decoder takes them and reads each output
+// buffer in memory:
+//
+//   - throughput: frames decoded per second, wall clock
+//   - latency: queue → output per frame (average, p50, p95, max)
+//   - optionally a checksum of every frame's luma plane, in output order, and
+//     a comparison with golden checksums from an earlier run (one per line)
+//
+// LZ4 greyscale frames are skipped; they never reach the decoder. Runs on any
+// decoder backend, so host tests drive it with the mock decoder.
+
+#ifndef MIRROR_REPLAY_H
+#define MIRROR_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mirror_decoder.h"
+#include "mirror_tuning.h"
+
+typedef struct {
+    uint8_t codec;                  // until the stream's CMD_CODEC (HEVC)
+    uint32_t width, height;         // until its CMD_RESOLUTION (DEFAULT_FRAME_W/H)
+    const mirror_tuning *tuning;    // tuned configurations, NULL for codec defaults
+    int64_t output_timeout_us;      // wait for output while nothing else can move (500ms)
+    int checksums;                  // read and checksum the luma plane of every output
+    const uint32_t *golden;         // expected checksums, compared when set
+    int n_golden;
+} mirror_replay_config;
+
+typedef struct {
+    int frames;                     // access units queued
+    int decoded;                    // output buffers received
+    int skipped;                    // greyscale or oversized frames
+    int reconfigures;               // codec or resolution changes mid-stream
+    double seconds;                 // first queue → last output
+    double fps;                     // decoded / seconds
+    double latency_ms_avg;
+    double latency_ms_p50;
+    double latency_ms_p95;
+    double latency_ms_max;
+    uint32_t *checksums;            // `decoded` entries with cfg.checksums; free with _result_free
+    int mismatches;                 // against cfg.golden, including missing frames
+    int first_mismatch;             // output index, -1 if none
+} mirror_replay_result;
+
+void mirror_replay_default_config(mirror_replay_config *cfg);
+
+// Decode `len` bytes of recorded stream. Returns 0 on success, -1 if the
+// backend has no configure_memory (or no get_output with checksums), the
+// decoder cannot be configured or the stream is malformed. On -1 nothing
+// needs freeing.
+int mirror_replay_run(const mirror_decoder *dec, const uint8_t *stream, size_t len,
+                      const mirror_replay_config *cfg, mirror_replay_result *out);
+
+void mirror_replay_result_free(mirror_replay_result *res);
+
+// FNV-1a over the visible luma bytes, row by row (stride padding excluded).
+uint32_t mirror_luma_checksum(const mirror_output_image *img);
+
+// Golden checksum file: one hex checksum per line, '#' starts a comment.
+// Returns the number read (at most `max`), or -1 if the file cannot be opened.
+int mirror_replay_load_golden(const char *path, uint32_t *out, int max);
+// Returns 0 on success.
+int mirror_replay_save_golden(const char *path, const uint32_t *sums, int n);
+
+#endif
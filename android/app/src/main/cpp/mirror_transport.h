@@ -0,0 +1,43 @@
+// mirror_transport.h — Socket read backend interface for the receiver core.
+//
+// The receive loop only ever asks for "exactly n bytes from this socket". The
+// default backend does that with blocking recv(MSG_WAITALL), as on device; host
+// builds can swap in buffered epoll or io_uring readers (host/transport.c) to
+// compare syscall overhead and tail latency without touching the parser.
+//
+// All calls are made from the decode thread. mirror_receiver_stop() unblocks a
+// read with shutdown(), so a socket backend must return -1 once the peer or a
+// shutdown closes the stream. Backends without a socket (host shared-memory
+// rings) also carry the ACKs upstream, and are unblocked by their owner.
+
+#ifndef MIRROR_TRANSPORT_H
+#define MIRROR_TRANSPORT_H
+
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    // Start reading a newly connected socket. Returns 0 on success, -1 on failure.
+    // Optional.
+    int (*attach)(void *ctx, int sock);
+    // Read exactly n bytes. Returns n, or -1 on EOF or error.
+    int (*read)(void *ctx, int sock, void *buf, int n);
+    // Zero-copy read: pointer to the next n bytes, valid until the next
+    // read() or view(). NULL on EOF or error. Optional; used for frame payloads.
+    const uint8_t *(*view)(void *ctx, int sock, int n);
+    // Send n bytes to the sender (ACKs). Optional; send() on the socket otherwise.
+    void (*write)(void *ctx, int sock, const void *buf, int n);
+    // Session over: drop buffered bytes and pending requests. Does not close the
+    // socket. Optional.
+    void (*detach)(void *ctx);
+} mirror_transport_ops;
+
+typedef struct {
+    const mirror_transport_ops *ops;
+    void *ctx;
+} mirror_transport;
+
+// Blocking recv(MSG_WAITALL). Stateless; ctx is unused.
+extern const mirror_transport_ops mirror_blocking_transport_ops;
+
+#endif
@@ -0,0 +1,367 @@
+// mirror_tuning.c — Decoder tuning profiles, calibration and the on-disk cache.
+
+#include "mirror_tuning.h"
+#include "mirror_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// MARK: - Profiles
+//
+// Keys a decoder does not know are ignored, so a variant that does nothing on
+// some part just times the same as "default" and loses the tie.
+
+// Decoder thread priority 0 (realtime) and an operating rate far above the
+// stream's, so the decoder runs at top clocks instead of pacing itself.
+#define REALTIME_KEYS { "priority", 0 }, { "operating-rate", 32767 }
+
+static const mirror_format_key no_keys[] = { { NULL, 0 } };
+static const mirror_format_key realtime_keys[] = { REALTIME_KEYS, { NULL, 0 } };
+
+static const mirror_tuning_variant generic_variants[] = {
+    { "default", no_keys },
+    { "realtime", realtime_keys },
+    { NULL, NULL },
+};
+
+// MediaTek: the vdec low-latency mode skips the decoder's internal output
+// queue; on Dimensity parts it is worth more than everything else together.
+static const mirror_format_key mtk_keys[] = { { "vdec-lowlatency", 1 }, { NULL, 0 } };
+static const mirror_format_key mtk_realtime_keys[] = {
+    { "vdec-lowlatency", 1 }, REALTIME_KEYS, { NULL, 0 },
+};
+
+static const mirror_tuning_variant mtk_variants[] = {
+    { "mtk-lowlatency", mtk_keys },
+    { "mtk-lowlatency-realtime", mtk_realtime_keys },
+    { NULL, NULL },
+};
+
+// Qualcomm H.264/HEVC: the sender never reorders frames, so the decoder may
+// output in decode order instead of holding frames for a reorder window.
+static const mirror_format_key qti_keys[] = {
+    { "vendor.qti-ext-dec-picture-order.enable", 1 },
+    { "vendor.qti-ext-dec-low-latency.enable", 1 },
+    { NULL, 0 },
+};
+static const mirror_format_key qti_realtime_keys[] = {
+    { "vendor.qti-ext-dec-picture-order.enable", 1 },
+    { "vendor.qti-ext-dec-low-latency.enable", 1 },
+    REALTIME_KEYS,
+    { NULL, 0 },
+};
+
+static const mirror_tuning_variant qti_variants[] = {
+    { "qti-lowlatency", qti_keys },
+    { "qti-lowlatency-realtime", qti_realtime_keys },
+    { NULL, NULL },
+};
+
+// Samsung Exynos: the RTC low-latency extension.
+static const mirror_format_key exynos_keys[] = {
+    { "vendor.rtc-ext-dec-low-latency.enable", 1 },
+    { NULL, 0 },
+};
+
+static const mirror_tuning_variant exynos_variants[] = {
+    { "exynos-lowlatency", exynos_keys },
+    { NULL, NULL },
+};
+
+const mirror_tuning_profile mirror_tuning_profiles[] = {
+    { "mt", NULL, mtk_variants },
+    { "sm", "hevc", qti_variants },
+    { "sm", "h264", qti_variants },
+    { "sdm", "hevc", qti_variants },
+    { "sdm", "h264", qti_variants },
+    { "msm", "hevc", qti_variants },
+    { "msm", "h264", qti_variants },
+    { "exynos", NULL, exynos_variants },
+    { "s5e", NULL, exynos_variants },
+    { "", NULL, generic_variants },
+    { NULL, NULL, NULL },
+};
+
+// Codec defaults followed by the variant's keys (MediaFormat keeps the last
+// value set, so a variant can override a default).
+static void apply_variant(mirror_tuned_codec *tc, const mirror_tuning_variant *variant) {
+    int n = 0;
+    for (const mirror_format_key *k = mirror_codec_get(tc->info.id)->keys; k->key; k++) {
+        if (n < MIRROR_TUNING_MAX_KEYS) tc->keys[n++] = *k;
+    }
+    for (const mirror_format_key *k = variant ? variant->keys : NULL; k && k->key; k++) {
+        if (n < MIRROR_TUNING_MAX_KEYS) tc->keys[n++] = *k;
+    }
+    tc->keys[n].key = NULL;
+    tc->keys[n].value = 0;
+    tc->variant = variant;
+}
+
+void mirror_tuning_init(mirror_tuning *t, const mirror_tuning_profile *profiles, const char *soc,
+                        const char *fingerprint, const char *cache_path) {
+    memset(t, 0, sizeof(*t));
+    t->profiles = profiles ? profiles : mirror_tuning_profiles;
+    snprintf(t->soc, sizeof(t->soc), "%s", soc ? soc : "");
+    snprintf(t->fingerprint, sizeof(t->fingerprint), "%s", fingerprint ? fingerprint : "");
+    snprintf(t->cache_path, sizeof(t->cache_path), "%s", cache_path ? cache_path : "");
+    t->rounds = 2;
+    t->frame_timeout_us = 200000;
+    for (uint8_t id = 0; id < MIRROR_CODEC_COUNT; id++) {
+        mirror_tuned_codec *tc = &t->codecs[id];
+        tc->info = *mirror_codec_get(id);
+        tc->info.keys = tc->keys;
+        apply_variant(tc, NULL);
+    }
+}
+
+int mirror_tuning_candidates(const mirror_tuning *t, const mirror_codec_info *codec,
+                             const mirror_tuning_variant **out, int max) {
+    int n = 0;
+    for (const mirror_tuning_profile *p = t->profiles; p->soc_prefix; p++) {
+        if (strncasecmp(t->soc, p->soc_prefix, strlen(p->soc_prefix)) != 0) continue;
+        if (p->codec && strcmp(p->codec, codec->name) != 0) continue;
+        for (const mirror_tuning_variant *v = p->variants; v->name && n < max; v++) {
+            int seen = 0;
+            for (int i = 0; i < n; i++) seen |= strcmp(out[i]->name, v->name) == 0;
+            if (!seen) out[n++] = v;
+        }
+    }
+    return n;
+}
+
+const mirror_codec_info *mirror_tuning_codec(const mirror_tuning *t, uint8_t id) {
+    return id < MIRROR_CODEC_COUNT ? &t->codecs[id].info : NULL;
+}
+
+// MARK: - Calibration
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Decode the test stream `rounds` times with `codec`, one access unit in flight
+// at a time. Returns the median queue → output latency, or -1 if fewer than
+// half of the access units came out.
+static int64_t time_variant(const mirror_tuning *t, const mirror_decoder *dec,
+                            const mirror_codec_info *codec, const mirror_test_stream *ts) {
+    const mirror_decoder_ops *ops = dec->ops;
+    // Nothing is rendered, so a backend that can decode to memory leaves the
+    // Surface alone.
+    int (*configure)(void *, const mirror_codec_info *, uint32_t, uint32_t) =
+        ops->configure_memory ? ops->configure_memory : ops->configure;
+    if (!configure(dec->ctx, codec, ts->width, ts->height)) return -1;
+
+    int total = ts->frames * t->rounds;
+    int64_t *samples = (int64_t *)calloc((size_t)total, sizeof(int64_t));
+    int n = 0;
+    for (int i = 0; samples && i < total; i++) {
+        int f = i % ts->frames;
+        size_t offset = 0;
+        for (int j = 0; j < f; j++) offset += ts->sizes[j];
+
+        ssize_t in = ops->dequeue_input(dec->ctx, t->frame_timeout_us);
+        if (in < 0) break;
+        size_t capacity = 0;
+        uint8_t *buf = ops->get_input(dec->ctx, (size_t)in, &capacity);
+        if (!buf || capacity < ts->sizes[f]) {
+            ops->queue_input(dec->ctx, (size_t)in, 0, 0, 0);
+            break;
+        }
+        memcpy(buf, ts->data + offset, ts->sizes[f]);
+        int64_t queued = mirror_now_us();
+        ops->queue_input(dec->ctx, (size_t)in, ts->sizes[f], i, f == 0 ? MIRROR_BUFFER_FLAG_KEY_FRAME : 0);
+
+        // Format and buffer-change notices come back as negative indices; keep
+        // waiting for a real buffer until the deadline.
+        int64_t deadline = queued + t->frame_timeout_us;
+        mirror_output_info info;
+        ssize_t out = -1;
+        for (int64_t now = queued; out < 0 && now < deadline; now = mirror_now_us()) {
+            out = ops->dequeue_output(dec->ctx, &info, deadline - now);
+        }
+        if (out < 0) continue;
+        samples[n++] = mirror_now_us() - queued;
+        ops->release_output(dec->ctx, (size_t)out, 0);
+    }
+    ops->release(dec->ctx);
+
+    int64_t median = -1;
+    if (n * 2 >= total) {
+        qsort(samples, (size_t)n, sizeof(int64_t), cmp_i64);
+        median = samples[n / 2];
+    }
+    free(samples);
+    return median;
+}
+
+int mirror_tuning_calibrate(mirror_tuning *t, const mirror_decoder *dec, uint8_t codec) {
+    const mirror_test_stream *ts = mirror_test_stream_get(codec);
+    if (!ts) return 0;
+    mirror_tuned_codec *tc = &t->codecs[codec];
+    const mirror_tuning_variant *cands[MIRROR_TUNING_MAX_CANDIDATES];
+    int n = mirror_tuning_candidates(t, &tc->info, cands, MIRROR_TUNING_MAX_CANDIDATES);
+
+    const mirror_tuning_variant *best = NULL;
+    int64_t best_us = 0;
+    for (int i = 0; i < n; i++) {
+        apply_variant(tc, cands[i]);
+        int64_t us = time_variant(t, dec, &tc->info, ts);
+        if (us < 0) {
+            LOGI("Calibrate %s/%s: failed", tc->info.name, cands[i]->name);
+        } else {
+            LOGI("Calibrate %s/%s: median %.2fms", tc->info.name, cands[i]->name, us / 1000.0);
+        }
+        if (us >= 0 && (!best || us < best_us)) {
+            best = cands[i];
+            best_us = us;
+        }
+    }
+
+    apply_variant(tc, best);
+    tc->state = best ? MIRROR_TUNE_OK : MIRROR_TUNE_FAILED;
+    tc->latency_us = best ? best_us : 0;
+    if (best) {
+        LOGI("Tuning %s on %s: %s (%.2fms)", tc->info.name, t->soc[0] ? t->soc : "unknown SoC",
+             best->name, best_us / 1000.0);
+    } else {
+        LOGE("Tuning %s: no configuration decoded the test stream", tc->info.name);
+    }
+    return best != NULL;
+}
+
+void mirror_tuning_run(mirror_tuning *t, const mirror_decoder *dec, const uint8_t *codecs, int n) {
+    if (t->cache_path[0] && mirror_tuning_load(t, t->cache_path)) {
+        LOGI("Decoder tuning loaded from %s", t->cache_path);
+        t->ready = 1;
+        return;
+    }
+    for (int i = 0; i < n; i++) mirror_tuning_calibrate(t, dec, codecs[i]);
+    if (t->cache_path[0] && !mirror_tuning_save(t, t->cache_path)) {
+        LOGE("Could not write decoder tuning cache %s", t->cache_path);
+    }
+    t->ready = 1;
+}
+
+// MARK: - Cache
+//
+//   daylight-mirror-tuning <version>
+//   fingerprint <ro.build.fingerprint>
+//   soc <soc>
+//   codec <name> <variant|-> <latency_us>      one per calibrated codec; "-" = failed
+
+#define CACHE_MAGIC "daylight-mirror-tuning"
+
+int mirror_tuning_save(const mirror_tuning *t, const char *path) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return 0;
+    fprintf(f, CACHE_MAGIC " %d\nfingerprint %s\nsoc %s\n", MIRROR_TUNING_VERSION, t->fingerprint,
+            t->soc);
+    for (int id = 0; id < MIRROR_CODEC_COUNT; id++) {
+        const mirror_tuned_codec *tc = &t->codecs[id];
+        if (tc->state == MIRROR_TUNE_NONE) continue;
+        fprintf(f, "codec %s %s %lld\n", tc->info.name,
+                tc->state == MIRROR_TUNE_OK ? tc->variant->name : "-", (long long)tc->latency_us);
+    }
+    int ok = fclose(f) == 0;
+    // Rename so a crash mid-write never leaves a half file that parses.
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+// Rest of a "key value" line, or NULL if the key does not match.
+static const char *line_value(char *line, const char *key) {
+    size_t n = strlen(key);
+    if (strncmp(line, key, n) != 0 || line[n] != ' ') return NULL;
+    line[strcspn(line, "\n")] = '\0';
+    return line + n + 1;
+}
+
+static const mirror_tuning_variant *find_variant(const mirror_tuning *t, const mirror_codec_info *codec,
+                                                 const char *name) {
+    const mirror_tuning_variant *cands[MIRROR_TUNING_MAX_CANDIDATES];
+    int n = mirror_tuning_candidates(t, codec, cands, MIRROR_TUNING_MAX_CANDIDATES);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(cands[i]->name, name) == 0) return cands[i];
+    }
+    return NULL;
+}
+
+int mirror_tuning_load(mirror_tuning *t, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    char line[300];
+    const char *v;
+    int ok = fgets(line, sizeof(line), f) && (v = line_value(line, CACHE_MAGIC)) &&
+             atoi(v) == MIRROR_TUNING_VERSION &&
+             fgets(line, sizeof(line), f) && (v = line_value(line, "fingerprint")) &&
+             strcmp(v, t->fingerprint) == 0 &&
+             fgets(line, sizeof(line), f) && (v = line_value(line, "soc")) && strcmp(v, t->soc) == 0;
+
+    // Parse into a copy so a bad line leaves the current tuning untouched.
+    mirror_tuned_codec parsed[MIRROR_CODEC_COUNT];
+    memcpy(parsed, t->codecs, sizeof(parsed));
+    for (int id = 0; id < MIRROR_CODEC_COUNT; id++) parsed[id].state = MIRROR_TUNE_NONE;
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        char name[16], variant[64];
+        long long latency;
+        if (sscanf(line, "codec %15s %63s %lld", name, variant, &latency) != 3 || latency < 0) {
+            ok = 0;
+            break;
+        }
+        const mirror_codec_info *codec = mirror_codec_find(name);
+        if (!codec) { ok = 0; break; }
+        mirror_tuned_codec *tc = &parsed[codec->id];
+        if (strcmp(variant, "-") == 0) {
+            apply_variant(tc, NULL);
+            tc->state = MIRROR_TUNE_FAILED;
+            tc->latency_us = 0;
+            continue;
+        }
+        const mirror_tuning_variant *var = find_variant(t, codec, variant);
+        if (!var) { ok = 0; break; }      // profile table changed: recalibrate
+        apply_variant(tc, var);
+        tc->state = MIRROR_TUNE_OK;
+        tc->latency_us = latency;
+    }
+    fclose(f);
+    if (!ok) return 0;
+
+    // The key arrays moved with the copy; point each codec back at its own.
+    memcpy(t->codecs, parsed, sizeof(parsed));
+    for (int id = 0; id < MIRROR_CODEC_COUNT; id++) t->codecs[id].info.keys = t->codecs[id].keys;
+    return 1;
+}
+
+// MARK: - Ranking
+
+int mirror_tuning_rank(const mirror_tuning *t, uint8_t *codecs, int n) {
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (codecs[i] >= MIRROR_CODEC_COUNT || t->codecs[codecs[i]].state == MIRROR_TUNE_FAILED) continue;
+        codecs[kept++] = codecs[i];
+    }
+    // Insertion sort, stable: calibrated by latency, then uncalibrated as listed.
+    for (int i = 1; i < kept; i++) {
+        uint8_t c = codecs[i];
+        const mirror_tuned_codec *tc = &t->codecs[c];
+        int j = i - 1;
+        while (j >= 0) {
+            const mirror_tuned_codec *prev = &t->codecs[codecs[j]];
+            int before = tc->state == MIRROR_TUNE_OK &&
+                         (prev->state != MIRROR_TUNE_OK || tc->latency_us < prev->latency_us);
+            if (!before) break;
+            codecs[j + 1] = codecs[j];
+            j--;
+        }
+        codecs[j + 1] = c;
+    }
+    return kept;
+}
@@ -0,0 +1,115 @@
+// mirror_tuning.h — Per-SoC decoder tuning profiles and startup self-calibration.
+//
+// Which AMediaFormat keys give the lowest decode latency depends on the SoC: on
+// MediaTek parts the vendor low-latency key and operating rate matter a lot,
+// Qualcomm wants its own picture-order key, and some decoders get slower with
+// keys that help elsewhere. Rather than guess, the receiver tries every candidate
+// configuration for its SoC once:
+//
+//   - the profile table lists configuration variants by SoC prefix and codec
+//   - calibration configures the decoder with each variant, feeds a small
+//     embedded test stream one access unit at a time, measures queue → output
+//     latency and keeps the variant with the lowest median
+//   - results are cached in a text file keyed by build fingerprint, so later
+//     launches skip calibration until a system update changes the fingerprint
+//
+// Calibrated codecs are also ranked by latency for the CMD_CODECS advert.
+// Everything here runs on the caller's decoder backend, so the host tests drive
+// it with the mock decoder.
+
+#ifndef MIRROR_TUNING_H
+#define MIRROR_TUNING_H
+
+#include <stdint.h>
+#include "mirror_codec.h"
+#include "mirror_decoder.h"
+#include "mirror_protocol.h"
+
+#define MIRROR_TUNING_VERSION 1         // bump when the built-in profiles change
+#define MIRROR_TUNING_MAX_KEYS 8        // codec keys + variant keys
+#define MIRROR_TUNING_MAX_CANDIDATES 8
+
+// One decoder configuration to try: format keys added to the codec's own.
+typedef struct {
+    const char *name;               // stable; stored in the cache
+    const mirror_format_key *keys;  // terminated by a NULL key
+} mirror_tuning_variant;
+
+// Variants for SoCs whose name starts with soc_prefix (case-insensitive; ""
+// matches every SoC), for one codec or all of them.
+typedef struct {
+    const char *soc_prefix;
+    const char *codec;                      // short name ("hevc"), NULL for every codec
+    const mirror_tuning_variant *variants;  // terminated by a NULL name
+} mirror_tuning_profile;
+
+// Built-in profile table, terminated by a NULL soc_prefix. Generic variants last.
+extern const mirror_tuning_profile mirror_tuning_profiles[];
+
+typedef enum {
+    MIRROR_TUNE_NONE = 0,   // not calibrated: codec defaults
+    MIRROR_TUNE_OK,         // variant decoded the test stream fastest
+    MIRROR_TUNE_FAILED,     // no variant decoded the test stream
+} mirror_tune_state;
+
+typedef struct {
+    mirror_codec_info info;             // what the receiver configures with
+    mirror_format_key keys[MIRROR_TUNING_MAX_KEYS + 1];
+    const mirror_tuning_variant *variant;
+    mirror_tune_state state;
+    int64_t latency_us;                 // median test-stream decode latency
+} mirror_tuned_codec;
+
+typedef struct {
+    const mirror_tuning_profile *profiles;
+    char soc[64];                       // ro.soc.model / ro.board.platform on Android
+    char fingerprint[128];              // cache key: ro.build.fingerprint on Android
+    char cache_path[256];               // empty: no cache
+    int rounds;                         // passes over the test stream per variant (2)
+    int64_t frame_timeout_us;           // wait per access unit before giving up (200ms)
+    int ready;                          // loaded or calibrated
+    mirror_tuned_codec codecs[MIRROR_CODEC_COUNT];
+} mirror_tuning;
+
+// Short, fixed test stream for one codec: 176x144, access units back to back.
+typedef struct {
+    const uint8_t *data;
+    const uint32_t *sizes;
+    int frames;
+    uint32_t width, height;
+} mirror_test_stream;
+
+// NULL if there is no test stream for the codec.
+const mirror_test_stream *mirror_test_stream_get(uint8_t codec);
+
+// `profiles` NULL selects the built-in table. Every codec starts on its defaults.
+void mirror_tuning_init(mirror_tuning *t, const mirror_tuning_profile *profiles, const char *soc,
+                        const char *fingerprint, const char *cache_path);
+
+// Variants to try for this SoC and codec, most specific first; a name listed by
+// several matching profiles is tried once. Returns the count.
+int mirror_tuning_candidates(const mirror_tuning *t, const mirror_codec_info *codec,
+                             const mirror_tuning_variant **out, int max);
+
+// The configuration to build the decoder with. Never NULL for a known id.
+const mirror_codec_info *mirror_tuning_codec(const mirror_tuning *t, uint8_t id);
+
+// Time every candidate on `dec` and keep the fastest. The decoder must be
+// released; it is left released. Returns 1 if any variant decoded the stream.
+int mirror_tuning_calibrate(mirror_tuning *t, const mirror_decoder *dec, uint8_t codec);
+
+// Load the cache if it matches this build, otherwise calibrate `codecs` and
+// save. Marks the tuning ready either way.
+void mirror_tuning_run(mirror_tuning *t, const mirror_decoder *dec, const uint8_t *codecs, int n);
+
+// Cache file I/O. Load returns 1 only for a file written by this version for
+// this fingerprint and SoC whose variants all still exist.
+int mirror_tuning_save(const mirror_tuning *t, const char *path);
+int mirror_tuning_load(mirror_tuning *t, const char *path);
+
+// Reorder `codecs` fastest first by calibrated latency and drop codecs that
+// failed calibration. Uncalibrated codecs keep their order after the rest.
+// Returns the new count.
+int mirror_tuning_rank(const mirror_tuning *t, uint8_t *codecs, int n);
+
+#endif
@@ -0,0 +1,85 @@
+// mirror_tuning_streams.c — Embedded calibration streams for mirror_tuning.c.
+//
+// 176x144, 8 frames each: one keyframe then seven predicted frames, with no
+// frame reordering, so every access unit should come out as soon as it decodes.
+//   - HEVC: x265 (ultrafast, zerolatency), a dark square moving over grey
+//   - H.264: Constrained Baseline, flat grey I-frame then skipped P-frames
+//   - AV1: libaom realtime mode, same content as HEVC; temporal units as sent
+//
+// Small on purpose: calibration times the decoder pipeline, not pixel throughput.
+
+#include "mirror_tuning.h"
+
+#include <stddef.h>
+
+static const uint8_t hevc_data[] = {
+    0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+    0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xba, 0x02, 0x40, 0x00, 0x00, 0x00, 0x01,
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+    0x00, 0x3c, 0xa0, 0x16, 0x20, 0x24, 0x59, 0x6e, 0x92, 0x93, 0x0b, 0x80, 0x40, 0x00, 0x00, 0xfa,
+    0x00, 0x00, 0x3a, 0x98, 0x02, 0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x71, 0x81, 0x12, 0x00,
+    0x00, 0x01, 0x28, 0x01, 0xac, 0x66, 0x0a, 0xba, 0x5e, 0x33, 0x07, 0x2c, 0x40, 0x0f, 0xe5, 0x60,
+    0x08, 0x20, 0x82, 0x23, 0xd9, 0xf4, 0xa8, 0xc6, 0x76, 0x23, 0xa5, 0x62, 0x93, 0x1f, 0xe9, 0x7c,
+    0xb1, 0xcb, 0xdf, 0x12, 0x94, 0xaf, 0x40, 0x0b, 0x30, 0xfc, 0x00, 0x00, 0x03, 0x00, 0xf5, 0x80,
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x09, 0x78, 0x84, 0xc0, 0x9b, 0x8a, 0x92, 0xb1, 0xf8,
+    0x48, 0x60, 0x6d, 0xb3, 0x4a, 0xc0, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x11, 0xfe, 0x21,
+    0x10, 0x9b, 0x88, 0x1b, 0x11, 0xe6, 0x88, 0xa0, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x19,
+    0xfe, 0x21, 0x10, 0x9b, 0x86, 0x80, 0xce, 0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x21,
+    0xfe, 0x21, 0x30, 0x9b, 0x84, 0x7c, 0xba, 0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x29,
+    0xfe, 0x21, 0x10, 0x9b, 0x84, 0x7c, 0xba, 0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x31,
+    0xfe, 0x21, 0x30, 0x9b, 0x84, 0x7c, 0xba, 0x80, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x39,
+    0xfe, 0x21, 0x10, 0x9b, 0x84, 0x7c, 0xba, 0x80,
+};
+static const uint32_t hevc_sizes[] = { 128, 22, 18, 16, 16, 16, 16, 16 };
+
+static const uint8_t h264_data[] = {
+    0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e, 0xda, 0x0b, 0x13, 0xa0, 0x1e, 0x11, 0x08, 0xd4,
+    0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80, 0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0xa2,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72, 0x72,
+    0x72, 0x72, 0x78, 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x22, 0x80, 0xc9, 0x00, 0x00, 0x00, 0x01,
+    0x41, 0x9a, 0x42, 0x80, 0xc9, 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x62, 0x80, 0xc9, 0x00, 0x00,
+    0x00, 0x01, 0x41, 0x9a, 0x82, 0x80, 0xc9, 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0xa2, 0x80, 0xc9,
+    0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0xc2, 0x80, 0xc9, 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0xe2,
+    0x80, 0xc9,
+};
+static const uint32_t h264_sizes[] = { 131, 9, 9, 9, 9, 9, 9, 9 };
+
+static const uint8_t av1_data[] = {
+    0x12, 0x00, 0x0a, 0x0b, 0x00, 0x00, 0x00, 0x03, 0xbd, 0x7c, 0x79, 0xb5, 0xf2, 0x00, 0x80, 0x32,
+    0x34, 0x10, 0x00, 0x80, 0x00, 0x00, 0xc3, 0x2e, 0x26, 0xeb, 0x1b, 0x28, 0x1f, 0xbe, 0xf9, 0xbf,
+    0xaa, 0xa0, 0x23, 0x95, 0xbf, 0xbc, 0xfe, 0x2a, 0x49, 0x1a, 0xcf, 0x59, 0xa3, 0x5b, 0x57, 0xd2,
+    0x60, 0x63, 0x03, 0x84, 0x98, 0xcb, 0x73, 0x9a, 0xe7, 0x06, 0x40, 0xc0, 0xfc, 0x86, 0x30, 0xab,
+    0x9d, 0x37, 0x17, 0x37, 0xbc, 0x12, 0x00, 0x32, 0x28, 0x30, 0x03, 0x80, 0x80, 0xfd, 0xf8, 0x06,
+    0x94, 0x60, 0x22, 0x8a, 0x28, 0x8a, 0x08, 0x12, 0x80, 0x00, 0x97, 0x82, 0x4a, 0x67, 0xe0, 0xc2,
+    0xd7, 0xab, 0xa3, 0x5d, 0xa5, 0xc0, 0x03, 0x09, 0xda, 0xb9, 0x7b, 0x5a, 0xbf, 0xd5, 0x55, 0x52,
+    0x20, 0x12, 0x00, 0x32, 0x1d, 0x30, 0x04, 0x01, 0x05, 0x7d, 0xf8, 0x06, 0x96, 0x00, 0x2a, 0xaa,
+    0xaa, 0x8a, 0x09, 0x12, 0x80, 0x00, 0x97, 0x7c, 0x96, 0xfc, 0x7d, 0x4e, 0x2c, 0x89, 0xcd, 0x6f,
+    0x5d, 0x18, 0x12, 0x00, 0x32, 0x1d, 0x30, 0x06, 0x02, 0x09, 0xfd, 0xf8, 0x06, 0x96, 0x00, 0x2a,
+    0xaa, 0xaa, 0x8a, 0x09, 0x12, 0x80, 0x00, 0x96, 0x93, 0x3d, 0xa8, 0x9d, 0x82, 0x77, 0x07, 0xda,
+    0x98, 0xed, 0xe4, 0x12, 0x00, 0x32, 0x1a, 0x30, 0x08, 0x04, 0x0e, 0x7d, 0xf8, 0x06, 0x95, 0xe0,
+    0x2a, 0xaa, 0xaa, 0x8a, 0x09, 0x12, 0x80, 0x00, 0x94, 0x9e, 0x17, 0xc3, 0x32, 0xbf, 0x35, 0x37,
+    0xeb, 0x12, 0x00, 0x32, 0x1b, 0x30, 0x0a, 0x08, 0x12, 0xfd, 0xf9, 0x06, 0x95, 0x80, 0x28, 0xa2,
+    0x8a, 0x0a, 0x08, 0x12, 0x00, 0x00, 0x92, 0x4e, 0x07, 0x66, 0x99, 0xe9, 0xe8, 0x14, 0x20, 0x3a,
+    0x12, 0x00, 0x32, 0x1a, 0x30, 0x0c, 0x00, 0x54, 0x7d, 0xfa, 0x06, 0x94, 0xa0, 0x24, 0x92, 0x49,
+    0x0a, 0x08, 0x12, 0x00, 0x00, 0x8f, 0xef, 0xe9, 0x18, 0x9a, 0x43, 0xf2, 0x3a, 0x18, 0x12, 0x00,
+    0x32, 0x19, 0x30, 0x0e, 0x00, 0x80, 0xfd, 0xfb, 0x06, 0x93, 0xe0, 0x20, 0x82, 0x08, 0x0a, 0x08,
+    0x12, 0x00, 0x00, 0x8d, 0xa3, 0x42, 0x34, 0xdd, 0x44, 0x28, 0x18,
+};
+static const uint32_t av1_sizes[] = { 69, 44, 33, 33, 30, 31, 30, 29 };
+
+#define STREAM(name) { name##_data, name##_sizes, sizeof(name##_sizes) / sizeof(name##_sizes[0]), 176, 144 }
+
+static const mirror_test_stream streams[MIRROR_CODEC_COUNT] = {
+    [MIRROR_CODEC_HEVC] = STREAM(hevc),
+    [MIRROR_CODEC_H264] = STREAM(h264),
+    [MIRROR_CODEC_AV1] = STREAM(av1),
+};
+
+const mirror_test_stream *mirror_test_stream_get(uint8_t codec) {
+    return codec < MIRROR_CODEC_COUNT ? &streams[codec] : NULL;
+}
@@ -0,0 +1,58 @@
+// mirror_vsync.c — Display vsync clock: refresh period estimate and prediction.
+
+#include "mirror_vsync.h"
+
+#include <string.h>
+
+#define SEED_INTERVALS 8
+// Intervals spanning more vsyncs than this are a pause, not a measurement.
+#define MAX_SPAN 8
+// Averaging weight of one interval, 1/16: ~0.1 s to follow a 120 Hz rate change.
+#define PERIOD_SHIFT 4
+
+void mirror_vsync_init(mirror_vsync *v) {
+    memset(v, 0, sizeof(*v));
+    v->seed_left = SEED_INTERVALS;
+    pthread_mutex_init(&v->lock, NULL);
+}
+
+void mirror_vsync_free(mirror_vsync *v) {
+    pthread_mutex_destroy(&v->lock);
+}
+
+void mirror_vsync_tick(mirror_vsync *v, int64_t vsync_ns) {
+    pthread_mutex_lock(&v->lock);
+    int64_t d = vsync_ns - v->last_ns;
+    if (v->last_ns && d <= 0) {
+        pthread_mutex_unlock(&v->lock);
+        return;
+    }
+    if (v->last_ns && d < MIRROR_VSYNC_STALE_NS) {
+        if (v->seed_left > 0) {
+            if (!v->seed_ns || d < v->seed_ns) v->seed_ns = d;
+            if (--v->seed_left == 0) v->period_ns = v->seed_ns;
+        } else {
+            int64_t span = (d + v->period_ns / 2) / v->period_ns;
+            if (span >= 1 && span <= MAX_SPAN) v->period_ns += (d / span - v->period_ns) >> PERIOD_SHIFT;
+        }
+    }
+    v->last_ns = vsync_ns;
+    v->ticks++;
+    pthread_mutex_unlock(&v->lock);
+}
+
+int64_t mirror_vsync_next(mirror_vsync *v, int64_t t_ns) {
+    pthread_mutex_lock(&v->lock);
+    int64_t last = v->last_ns, period = v->period_ns;
+    pthread_mutex_unlock(&v->lock);
+    if (!period || t_ns - last > MIRROR_VSYNC_STALE_NS) return 0;
+    if (t_ns <= last) return last;
+    return last + (t_ns - last + period - 1) / period * period;
+}
+
+int64_t mirror_vsync_period(mirror_vsync *v) {
+    pthread_mutex_lock(&v->lock);
+    int64_t period = v->period_ns;
+    pthread_mutex_unlock(&v->lock);
+    return period;
+}
@@ -0,0 +1,45 @@
+// mirror_vsync.h — Display vsync clock for vsync-aligned presentation.
+//
+// The platform ticks it with each display vsync timestamp (AChoreographer frame
+// callbacks on Android, CLOCK_MONOTONIC nanoseconds) from its own thread; the
+// decode thread asks it which vsync a frame released now can still make and
+// releases the decoded buffer for that time (AMediaCodec_releaseOutputBufferAtTime).
+//
+// The refresh period is seeded from the shortest of the first few tick intervals
+// (callbacks can skip vsyncs, never split them) and then follows an average of
+// intervals divided by the number of vsyncs they span, so 60/90/120 Hz panels
+// need no configuration and slow drift is tracked.
+
+#ifndef MIRROR_VSYNC_H
+#define MIRROR_VSYNC_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+// Ticks older than this no longer predict anything (callbacks stopped: screen
+// off, app in the background); mirror_vsync_next returns 0 until they resume.
+#define MIRROR_VSYNC_STALE_NS 1000000000LL
+
+typedef struct {
+    pthread_mutex_t lock;       // tick and query come from different threads
+    int64_t last_ns;            // latest vsync, 0 before the first tick
+    int64_t period_ns;          // 0 until seeded
+    int64_t seed_ns;            // shortest interval so far while seeding
+    int seed_left;              // intervals still to seed from
+    uint64_t ticks;
+} mirror_vsync;
+
+void mirror_vsync_init(mirror_vsync *v);
+void mirror_vsync_free(mirror_vsync *v);
+
+// A vsync happened at vsync_ns. Out-of-order or repeated timestamps are ignored.
+void mirror_vsync_tick(mirror_vsync *v, int64_t vsync_ns);
+
+// The first predicted vsync at or after t_ns, or 0 while the clock is unseeded
+// or stale.
+int64_t mirror_vsync_next(mirror_vsync *v, int64_t t_ns);
+
+// Estimated refresh period in nanoseconds, 0 while unseeded.
+int64_t mirror_vsync_period(mirror_vsync *v);
+
+#endif
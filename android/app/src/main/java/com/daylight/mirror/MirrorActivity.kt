@@ -1,6 +1,8 @@
 // MirrorActivity — minimal Activity that creates a SurfaceView and hands it to native code.
 // All heavy lifting (socket, LZ4, delta, render) happens in C via JNI.
 // Shows a status overlay when disconnected/reconnecting. Screen clears to white on disconnect.
+// Started with a "replay" extra it decodes that recording headless instead of mirroring
+// (benchmarks and output checks; see docs/performance.md).
 package com.daylight.mirror
 
 import android.animation.ObjectAnimator
@@ -37,8 +39,18 @@ class MirrorActivity : Activity() {
         port: Int,
     )
 
+    private external fun nativeDetach()
+
     private external fun nativeStop()
 
+    private external fun nativeRelease()
+
+    private external fun nativeReplay(
+        path: String,
+        golden: String?,
+        writeGolden: String?,
+    ): String
+
     private lateinit var statusTitle: TextView
     private lateinit var statusHint: TextView
     private lateinit var statusContainer: LinearLayout
@@ -119,6 +131,12 @@ class MirrorActivity : Activity() {
                 start()
             }
 
+        val replay = intent.getStringExtra("replay")
+        if (replay != null) {
+            startReplay(replay, intent.getStringExtra("golden"), intent.getStringExtra("write_golden"))
+            return
+        }
+
         surfaceView.holder.addCallback(
             object : SurfaceHolder.Callback {
                 override fun surfaceCreated(holder: SurfaceHolder) {
@@ -135,13 +153,41 @@ class MirrorActivity : Activity() {
                     height: Int,
                 ) {}
 
+                // Screen off, app switch: keep the connection and decoder, render nowhere.
+                // The next surfaceCreated resumes on the same session.
                 override fun surfaceDestroyed(holder: SurfaceHolder) {
-                    nativeStop()
+                    nativeDetach()
                 }
             },
         )
     }
 
+    // Decode a recording off the UI thread and show the summary (also in logcat).
+    private fun startReplay(
+        path: String,
+        golden: String?,
+        writeGolden: String?,
+    ) {
+        statusTitle.text = "Replaying ${path.substringAfterLast('/')}..."
+        statusHint.text = ""
+        Thread {
+            val result = nativeReplay(path, golden, writeGolden)
+            runOnUiThread {
+                pulseAnimator?.cancel()
+                statusTitle.alpha = 1f
+                statusTitle.text = "Replay finished"
+                statusHint.text = result
+            }
+        }.start()
+    }
+
+    // Finishing ends the session. Otherwise (recreated for a config change we don't
+    // handle) it keeps running for the next instance, but lets go of this one.
+    override fun onDestroy() {
+        if (isFinishing) nativeStop() else nativeRelease()
+        super.onDestroy()
+    }
+
     // / Called from native code when connection state changes.
     // / State machine with asymmetric debounce:
     // /   connected → disconnected: wait 2s before showing overlay (native reconnect loop is 1s)
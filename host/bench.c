@@ -0,0 +1,198 @@
+// bench.c — Timing harness, JSON results and baseline comparison for mirror_bench.
+
+#include "bench.h"
+#include "host_util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// MARK: - Timing
+
+int bench_measure(bench_result *out, const char *name, bench_fn fn, void *state,
+                  size_t bytes_per_op, int min_ms, int reps) {
+    memset(out, 0, sizeof(*out));
+    snprintf(out->name, sizeof(out->name), "%s", name);
+    if (reps < 1) reps = 1;
+
+    // Double the op count until one call is long enough to time.
+    uint64_t ops = 1;
+    for (;;) {
+        int64_t t0 = mirror_now_us();
+        if (fn(state, ops) < 0) return -1;
+        int64_t us = mirror_now_us() - t0;
+        if (us >= (int64_t)min_ms * 1000 || ops >= (1ull << 40)) break;
+        // Jump most of the way once there is a usable measurement.
+        if (us > 1000) {
+            uint64_t want = (uint64_t)((double)ops * min_ms * 1000.0 / (double)us * 1.1) + 1;
+            ops = want > ops * 2 ? want : ops * 2;
+        } else {
+            ops *= 2;
+        }
+    }
+
+    double *ns = (double *)malloc(sizeof(double) * (size_t)reps);
+    if (!ns) return -1;
+    for (int i = 0; i < reps; i++) {
+        int64_t t0 = mirror_now_us();
+        if (fn(state, ops) < 0) {
+            free(ns);
+            return -1;
+        }
+        ns[i] = (double)(mirror_now_us() - t0) * 1000.0 / (double)ops;
+    }
+    out->ns_per_op = percentile(ns, (size_t)reps, 0.5);
+    out->min_ns_per_op = ns[0];     // sorted by percentile()
+    out->mb_per_s = bytes_per_op && out->ns_per_op > 0
+                        ? (double)bytes_per_op / out->ns_per_op * 1000.0
+                        : 0;
+    out->ops = ops;
+    free(ns);
+    return 0;
+}
+
+// MARK: - JSON
+
+void bench_write_json(FILE *f, const char *machine, const bench_result *results, int n) {
+    fprintf(f, "{\n  \"version\": 1,\n  \"machine\": \"");
+    for (const char *p = machine; *p; p++) {
+        if (*p == '"' || *p == '\\') fputc('\\', f);
+        if ((unsigned char)*p >= 0x20) fputc(*p, f);
+    }
+    fprintf(f, "\",\n  \"results\": [\n");
+    for (int i = 0; i < n; i++) {
+        const bench_result *r = &results[i];
+        fprintf(f,
+                "    { \"name\": \"%s\", \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, "
+                "\"mb_per_s\": %.1f, \"ops\": %llu }%s\n",
+                r->name, r->ns_per_op, r->min_ns_per_op, r->mb_per_s,
+                (unsigned long long)r->ops, i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+// Find `"key":` inside [p, end) and return a pointer just past the colon.
+static const char *find_key(const char *p, const char *end, const char *key) {
+    size_t klen = strlen(key);
+    for (; p + klen + 2 < end; p++) {
+        if (p[0] == '"' && strncmp(p + 1, key, klen) == 0 && p[klen + 1] == '"') {
+            p += klen + 2;
+            while (p < end && (*p == ' ' || *p == ':')) p++;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int read_number(const char *p, const char *end, double *out) {
+    if (!p || p >= end) return -1;
+    char *stop;
+    *out = strtod(p, &stop);
+    return stop == p ? -1 : 0;
+}
+
+int bench_load_json(const char *path, bench_result *out, int max) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = size > 0 ? (char *)malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, f) != (size_t)size) {
+        free(text);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    text[size] = '\0';
+    const char *end = text + size;
+
+    const char *p = find_key(text, end, "results");
+    if (!p || *p != '[') {
+        free(text);
+        return -1;
+    }
+    int n = 0;
+    while (n < max && (p = strchr(p, '{')) != NULL) {
+        const char *close = strchr(p, '}');
+        if (!close) break;
+        bench_result *r = &out[n];
+        memset(r, 0, sizeof(*r));
+        const char *name = find_key(p, close, "name");
+        double ops = 0;
+        if (!name || *name != '"' || read_number(find_key(p, close, "ns_per_op"), close,
+                                                 &r->ns_per_op) < 0) {
+            free(text);
+            return -1;
+        }
+        name++;
+        const char *name_end = memchr(name, '"', (size_t)(close - name));
+        if (!name_end || name_end - name >= BENCH_NAME_MAX) {
+            free(text);
+            return -1;
+        }
+        memcpy(r->name, name, (size_t)(name_end - name));
+        read_number(find_key(p, close, "min_ns_per_op"), close, &r->min_ns_per_op);
+        read_number(find_key(p, close, "mb_per_s"), close, &r->mb_per_s);
+        read_number(find_key(p, close, "ops"), close, &ops);
+        r->ops = (uint64_t)ops;
+        n++;
+        p = close + 1;
+    }
+    free(text);
+    return n;
+}
+
+// MARK: - Compare
+
+static const bench_result *find_result(const bench_result *v, int n, const char *name) {
+    for (int i = 0; i < n; i++) {
+        if (strcmp(v[i].name, name) == 0) return &v[i];
+    }
+    return NULL;
+}
+
+static double compared_ns(const bench_result *r) {
+    return r->min_ns_per_op > 0 ? r->min_ns_per_op : r->ns_per_op;
+}
+
+static double change_pct(const bench_result *base, const bench_result *r) {
+    double b = compared_ns(base);
+    return b > 0 ? (compared_ns(r) / b - 1.0) * 100.0 : 0;
+}
+
+int bench_regressed(const bench_result *base, const bench_result *r, double tolerance_pct) {
+    return change_pct(base, r) > tolerance_pct;
+}
+
+int bench_compare(const bench_result *base, int n_base, const bench_result *cur, int n_cur,
+                  double tolerance_pct, FILE *report) {
+    int regressions = 0;
+    if (report) {
+        fprintf(report, "%-28s %12s %12s %8s\n", "case", "base best", "best", "change");
+    }
+    for (int i = 0; i < n_cur; i++) {
+        const bench_result *b = find_result(base, n_base, cur[i].name);
+        if (!b) {
+            if (report) fprintf(report, "%-28s %12s %12.1f %8s  new\n", cur[i].name, "-",
+                                compared_ns(&cur[i]), "");
+            continue;
+        }
+        int regressed = bench_regressed(b, &cur[i], tolerance_pct);
+        regressions += regressed;
+        if (report) {
+            fprintf(report, "%-28s %12.1f %12.1f %+7.1f%%%s\n", cur[i].name, compared_ns(b),
+                    compared_ns(&cur[i]), change_pct(b, &cur[i]), regressed ? "  REGRESSION" : "");
+        }
+    }
+    for (int i = 0; i < n_base && report; i++) {
+        if (!find_result(cur, n_cur, base[i].name)) {
+            fprintf(report, "%-28s %12.1f %12s %8s  not run\n", base[i].name, compared_ns(&base[i]),
+                    "-", "");
+        }
+    }
+    if (report) {
+        fprintf(report, "%d regression%s beyond %.0f%%\n", regressions,
+                regressions == 1 ? "" : "s", tolerance_pct);
+    }
+    return regressions;
+}
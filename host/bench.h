@@ -0,0 +1,58 @@
+// bench.h — Timing harness, JSON results and baseline comparison for mirror_bench.
+//
+// A benchmark case runs `ops` operations per call. bench_measure() grows the op
+// count until one call takes at least min_ms, then times `reps` calls and keeps
+// the median and best ns/op. Comparisons use the best: scheduler noise only ever
+// makes a run slower, so the fastest run is the most repeatable number.
+//
+// Results are written as one flat JSON document:
+//
+//   { "version": 1, "machine": "...", "results": [
+//       { "name": "lz4.decode_delta", "ns_per_op": 412.5, "min_ns_per_op": 401.2,
+//         "mb_per_s": 2481.0, "ops": 8192 }, ... ] }
+//
+// bench_load_json() reads that format back (and nothing more general), so a
+// baseline committed to the repo can be compared against a fresh run.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define BENCH_NAME_MAX 64
+#define BENCH_MAX_RESULTS 64
+
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    double ns_per_op;           // median over reps
+    double min_ns_per_op;       // best rep; what bench_compare() uses
+    double mb_per_s;            // from the median; 0 when the case moves no bytes
+    uint64_t ops;               // ops per timed call
+} bench_result;
+
+// Runs `ops` operations; returns 0, or -1 if the case failed.
+typedef int (*bench_fn)(void *state, uint64_t ops);
+
+// Calibrate and time `fn`. `bytes_per_op` (0 if meaningless) gives mb_per_s.
+// Returns 0 on success, -1 if the case failed.
+int bench_measure(bench_result *out, const char *name, bench_fn fn, void *state,
+                  size_t bytes_per_op, int min_ms, int reps);
+
+// 1 if `r` is more than tolerance_pct slower than `base`.
+int bench_regressed(const bench_result *base, const bench_result *r, double tolerance_pct);
+
+void bench_write_json(FILE *f, const char *machine, const bench_result *results, int n);
+// Returns the number of results read into `out`, or -1 if the file is unreadable
+// or not in the format above.
+int bench_load_json(const char *path, bench_result *out, int max);
+
+// Compare `cur` against `base` by best ns/op (the median for results without
+// one). A case is a regression when it is more than tolerance_pct slower. Cases
+// missing from either side are listed but do not fail. Writes a table to
+// `report` (if not NULL) and returns the number of regressions.
+int bench_compare(const bench_result *base, int n_base, const bench_result *cur, int n_cur,
+                  double tolerance_pct, FILE *report);
+
+#endif
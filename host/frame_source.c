@@ -0,0 +1,153 @@
+// frame_source.c — Raw grey/BGRA and Y4M readers (see frame_source.h).
+
+#include "frame_source.h"
+#include "grey_convert.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int frame_source_parse_format(const char *s, frame_format *out) {
+    if (strcmp(s, "grey") == 0 || strcmp(s, "gray") == 0) { *out = FRAME_GREY; return 0; }
+    if (strcmp(s, "bgra") == 0) { *out = FRAME_BGRA; return 0; }
+    if (strcmp(s, "y4m") == 0) { *out = FRAME_Y4M; return 0; }
+    return -1;
+}
+
+// Read one header line (up to '\n') into buf. Returns length or -1.
+static int read_line(FILE *f, char *buf, size_t cap) {
+    size_t n = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n') {
+        if (n + 1 < cap) buf[n++] = (char)c;
+    }
+    if (c == EOF && n == 0) return -1;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+// Parse "YUV4MPEG2 W<w> H<h> ... C<colorspace>" and size the planes.
+static int parse_y4m_header(frame_source *src) {
+    char line[512];
+    if (read_line(src->file, line, sizeof(line)) < 0 || strncmp(line, "YUV4MPEG2", 9) != 0) {
+        fprintf(stderr, "[Source] Not a YUV4MPEG2 stream\n");
+        return -1;
+    }
+    const char *chroma = "420";
+    char *save = NULL;
+    for (char *tok = strtok_r(line + 9, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        if (tok[0] == 'W') src->width = (uint32_t)atoi(tok + 1);
+        else if (tok[0] == 'H') src->height = (uint32_t)atoi(tok + 1);
+        else if (tok[0] == 'C') chroma = tok + 1;
+    }
+    if (src->width == 0 || src->height == 0) {
+        fprintf(stderr, "[Source] Y4M header has no W/H\n");
+        return -1;
+    }
+    if (strstr(chroma, "p1") || strstr(chroma, "p9")) {
+        fprintf(stderr, "[Source] Only 8-bit Y4M is supported (got C%s)\n", chroma);
+        return -1;
+    }
+
+    size_t w = src->width, h = src->height;
+    size_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+    if (strncmp(chroma, "mono", 4) == 0) src->skip_bytes = 0;
+    else if (strncmp(chroma, "444", 3) == 0) src->skip_bytes = 2 * w * h;
+    else if (strncmp(chroma, "422", 3) == 0) src->skip_bytes = 2 * cw * h;
+    else if (strncmp(chroma, "420", 3) == 0) src->skip_bytes = 2 * cw * ch;
+    else {
+        fprintf(stderr, "[Source] Unsupported Y4M colorspace C%s\n", chroma);
+        return -1;
+    }
+    src->frame_bytes = w * h + src->skip_bytes;
+    return 0;
+}
+
+int frame_source_open_file(frame_source *src, FILE *file, frame_format format,
+                           uint32_t width, uint32_t height, int loop) {
+    memset(src, 0, sizeof(*src));
+    src->file = file;
+    src->format = format;
+    src->width = width;
+    src->height = height;
+    src->loop = loop;
+
+    if (format == FRAME_Y4M) {
+        if (parse_y4m_header(src) < 0) return -1;
+    } else {
+        if (width == 0 || height == 0) {
+            fprintf(stderr, "[Source] Raw input needs --size WxH\n");
+            return -1;
+        }
+        src->frame_bytes = (size_t)width * height * (format == FRAME_BGRA ? 4 : 1);
+    }
+    if (format == FRAME_BGRA) {
+        src->raw = (uint8_t *)malloc(src->frame_bytes);
+        if (!src->raw) return -1;
+    }
+    src->data_start = ftell(file);
+    return 0;
+}
+
+int frame_source_open(frame_source *src, const char *path, frame_format format,
+                      uint32_t width, uint32_t height, int loop) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (frame_source_open_file(src, f, format, width, height, loop) < 0) {
+        if (f != stdin) fclose(f);
+        return -1;
+    }
+    src->owns_file = f != stdin;
+    return 0;
+}
+
+void frame_source_close(frame_source *src) {
+    if (src->owns_file && src->file) fclose(src->file);
+    free(src->raw);
+    memset(src, 0, sizeof(*src));
+}
+
+static int skip(FILE *f, size_t n) {
+    uint8_t buf[4096];
+    while (n > 0) {
+        size_t chunk = n < sizeof(buf) ? n : sizeof(buf);
+        if (fread(buf, 1, chunk, f) != chunk) return -1;
+        n -= chunk;
+    }
+    return 0;
+}
+
+// One attempt at reading a frame; 0 at a clean end of stream.
+static int read_once(frame_source *src, uint8_t *grey) {
+    size_t luma = (size_t)src->width * src->height;
+    switch (src->format) {
+    case FRAME_GREY:
+        if (fread(grey, 1, luma, src->file) != luma) return 0;
+        return 1;
+    case FRAME_BGRA:
+        if (fread(src->raw, 1, src->frame_bytes, src->file) != src->frame_bytes) return 0;
+        grey_from_bgra(grey, src->raw, src->width, src->height, (size_t)src->width * 4);
+        return 1;
+    case FRAME_Y4M: {
+        char line[256];
+        if (read_line(src->file, line, sizeof(line)) < 0) return 0;
+        if (strncmp(line, "FRAME", 5) != 0) return -1;
+        if (fread(grey, 1, luma, src->file) != luma) return 0;
+        if (skip(src->file, src->skip_bytes) < 0) return 0;
+        return 1;
+    }
+    }
+    return -1;
+}
+
+int frame_source_read(frame_source *src, uint8_t *grey) {
+    int r = read_once(src, grey);
+    if (r == 0 && src->loop && src->frames_read > 0 && src->data_start >= 0 &&
+        fseek(src->file, src->data_start, SEEK_SET) == 0) {
+        r = read_once(src, grey);
+    }
+    if (r == 1) src->frames_read++;
+    return r;
+}
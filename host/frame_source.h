@@ -0,0 +1,55 @@
+// frame_source.h — Raw and Y4M frame readers for the Linux sender.
+//
+// Reads fixed-size frames from a file or pipe ("-" for stdin) and delivers them
+// as 8-bit greyscale:
+//   grey — width*height bytes per frame, used as-is
+//   bgra — width*height*4 bytes per frame, converted with grey_convert
+//   y4m  — YUV4MPEG2 stream; the luma plane is the greyscale image and chroma is
+//          skipped. Width and height come from the stream header.
+// Regular files can be looped for long-running benchmarks.
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    FRAME_GREY = 0,
+    FRAME_BGRA,
+    FRAME_Y4M,
+} frame_format;
+
+typedef struct {
+    FILE *file;
+    int owns_file;
+    frame_format format;
+    uint32_t width;
+    uint32_t height;
+    size_t frame_bytes;     // bytes per frame on disk (Y4M: planes only)
+    size_t skip_bytes;      // Y4M: chroma bytes after the luma plane
+    long data_start;        // offset of the first frame, for looping
+    int loop;
+    uint8_t *raw;           // BGRA staging buffer
+    uint64_t frames_read;
+} frame_source;
+
+// Parses "grey", "bgra" or "y4m". Returns 0 on success.
+int frame_source_parse_format(const char *s, frame_format *out);
+
+// Open `path` ("-" = stdin). For raw formats width/height must be given; for Y4M
+// they are read from the header (pass 0). Returns 0 on success, -1 on error
+// (message printed).
+int frame_source_open(frame_source *src, const char *path, frame_format format,
+                      uint32_t width, uint32_t height, int loop);
+// Same, over an already-open stream (not closed by frame_source_close).
+int frame_source_open_file(frame_source *src, FILE *file, frame_format format,
+                           uint32_t width, uint32_t height, int loop);
+void frame_source_close(frame_source *src);
+
+// Read the next frame into `grey` (width*height bytes).
+// Returns 1 on success, 0 at end of stream, -1 on a malformed stream.
+int frame_source_read(frame_source *src, uint8_t *grey);
+
+#endif
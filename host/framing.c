@@ -0,0 +1,106 @@
+// framing.c — iovec frame descriptors and sendmsg() with partial-write resume.
+
+#include "framing.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+static const uint8_t START_CODE[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+void frame_iov_init(frame_iov *f) {
+    f->iov[0].iov_base = f->header;
+    f->iov[0].iov_len = FRAME_HEADER_SIZE;
+    f->iovcnt = 1;
+    f->payload_len = 0;
+    f->overflow = 0;
+}
+
+int frame_iov_add(frame_iov *f, const void *data, size_t len) {
+    if (len == 0) return 0;
+    if (f->iovcnt >= FRAME_IOV_MAX) {
+        f->overflow = 1;
+        return -1;
+    }
+    f->iov[f->iovcnt].iov_base = (void *)data;
+    f->iov[f->iovcnt].iov_len = len;
+    f->iovcnt++;
+    f->payload_len += len;
+    return 0;
+}
+
+int frame_iov_add_nal(frame_iov *f, const void *nal, size_t len) {
+    if (f->iovcnt + 2 > FRAME_IOV_MAX) {
+        f->overflow = 1;
+        return -1;
+    }
+    frame_iov_add(f, START_CODE, sizeof(START_CODE));
+    frame_iov_add(f, nal, len);
+    return 0;
+}
+
+int frame_iov_add_avcc(frame_iov *f, const uint8_t *data, size_t len) {
+    int count = 0;
+    size_t off = 0;
+    while (off + 4 <= len) {
+        uint32_t nal_len = ((uint32_t)data[off] << 24) | ((uint32_t)data[off + 1] << 16) |
+                           ((uint32_t)data[off + 2] << 8) | data[off + 3];
+        off += 4;
+        if (nal_len > len - off) return -1;
+        if (frame_iov_add_nal(f, data + off, nal_len) < 0) return -1;
+        off += nal_len;
+        count++;
+    }
+    return off == len ? count : -1;
+}
+
+void frame_iov_finish(frame_iov *f, uint8_t flags, uint32_t seq) {
+    encode_frame_header(f->header, flags, seq, (uint32_t)f->payload_len);
+}
+
+size_t frame_iov_size(const frame_iov *f) {
+    return FRAME_HEADER_SIZE + f->payload_len;
+}
+
+void frame_iov_flatten(const frame_iov *f, uint8_t *dst) {
+    for (int i = 0; i < f->iovcnt; i++) {
+        memcpy(dst, f->iov[i].iov_base, f->iov[i].iov_len);
+        dst += f->iov[i].iov_len;
+    }
+}
+
+int iov_send_all(int fd, const struct iovec *iov, int iovcnt) {
+    struct iovec local[FRAME_IOV_MAX];
+    if (iovcnt > FRAME_IOV_MAX) return -1;
+    memcpy(local, iov, (size_t)iovcnt * sizeof(*iov));
+
+    struct iovec *cur = local;
+    int left = iovcnt;
+    while (left > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = cur;
+        msg.msg_iovlen = (size_t)left;
+        ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+
+        // Skip fully written regions, trim the partially written one.
+        size_t n = (size_t)w;
+        while (left > 0 && n >= cur->iov_len) {
+            n -= cur->iov_len;
+            cur++;
+            left--;
+        }
+        if (left > 0) {
+            cur->iov_base = (uint8_t *)cur->iov_base + n;
+            cur->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+int frame_iov_send(int fd, const frame_iov *f) {
+    if (f->overflow) return -1;
+    return iov_send_all(fd, f->iov, f->iovcnt);
+}
@@ -0,0 +1,62 @@
+// framing.h — Scatter-gather protocol framing: build a frame as an iovec list.
+//
+// The copy-based path (ScreenCapture → TCPServer.broadcast) materialises every
+// frame several times: Annex B is built by appending start codes and NALs into a
+// growing buffer, then header + payload are concatenated into another one. Here a
+// frame is described instead as a list of regions pointing at the encoder's own
+// memory:
+//
+//   [frame header] [start code] [VPS] [start code] [SPS] ... [start code] [slice] ...
+//
+// and sent with one sendmsg(). Start codes and the header live inside the
+// descriptor; NAL bytes are never copied. The referenced memory must stay valid
+// until frame_iov_send() returns (or frame_iov_flatten() has copied it).
+//
+// Portable POSIX C: used by the Linux sender and the host benchmarks.
+
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "mirror_protocol.h"
+
+#define FRAME_IOV_MAX 64    // header + 2 per NAL; IDRs carry ~3 parameter sets + slices
+
+typedef struct {
+    uint8_t header[FRAME_HEADER_SIZE];
+    struct iovec iov[FRAME_IOV_MAX];
+    int iovcnt;
+    size_t payload_len;
+    int overflow;           // more regions than FRAME_IOV_MAX were added
+} frame_iov;
+
+// Start an empty frame. iov[0] is reserved for the header.
+void frame_iov_init(frame_iov *f);
+
+// Append raw payload bytes (no start code).
+int frame_iov_add(frame_iov *f, const void *data, size_t len);
+// Append one NAL unit preceded by a 4-byte Annex B start code.
+int frame_iov_add_nal(frame_iov *f, const void *nal, size_t len);
+// Append every NAL of an AVCC/HVCC buffer (4-byte big-endian length prefixes, as
+// VideoToolbox emits), each as start code + NAL. Returns the number of NALs, or
+// -1 on a truncated buffer or iovec overflow.
+int frame_iov_add_avcc(frame_iov *f, const uint8_t *data, size_t len);
+
+// Fill in the header once the payload is complete.
+void frame_iov_finish(frame_iov *f, uint8_t flags, uint32_t seq);
+
+// Total bytes on the wire (header + payload).
+size_t frame_iov_size(const frame_iov *f);
+// Copy the whole frame into `dst` (frame_iov_size bytes), e.g. for a keyframe cache.
+void frame_iov_flatten(const frame_iov *f, uint8_t *dst);
+
+// Send the frame with sendmsg(MSG_NOSIGNAL), resuming after partial writes.
+// Returns 0 on success, -1 on error. `f` is not modified.
+int frame_iov_send(int fd, const frame_iov *f);
+// Same for an arbitrary iovec list (e.g. header + payload without start codes).
+int iov_send_all(int fd, const struct iovec *iov, int iovcnt);
+
+#endif
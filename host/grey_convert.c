@@ -0,0 +1,89 @@
+// grey_convert.c — SIMD BGRA → greyscale (see grey_convert.h).
+
+#include "grey_convert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define W_B 29
+#define W_G 150
+#define W_R 77
+
+void grey_from_bgra_scalar(uint8_t *dst, const uint8_t *src, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        const uint8_t *p = src + 4 * i;
+        dst[i] = (uint8_t)((W_B * p[0] + W_G * p[1] + W_R * p[2] + 128) >> 8);
+    }
+}
+
+#if defined(__SSE2__)
+// 8 pixels per iteration: widen to 16-bit, madd against (B,G,R,A) weights to get
+// (B·wb + G·wg, R·wr) pairs, fold the pairs, round, shift and pack.
+static size_t row_simd(uint8_t *dst, const uint8_t *src, size_t pixels) {
+    const __m128i weights = _mm_setr_epi16(W_B, W_G, W_R, 0, W_B, W_G, W_R, 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(128);
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 4 * i + 16));
+        __m128i a_lo = _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), weights);
+        __m128i a_hi = _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), weights);
+        __m128i b_lo = _mm_madd_epi16(_mm_unpacklo_epi8(b, zero), weights);
+        __m128i b_hi = _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), weights);
+        // Each register holds two pixels as (BG, RA) 32-bit partial sums.
+        a_lo = _mm_add_epi32(a_lo, _mm_srli_epi64(a_lo, 32));
+        a_hi = _mm_add_epi32(a_hi, _mm_srli_epi64(a_hi, 32));
+        b_lo = _mm_add_epi32(b_lo, _mm_srli_epi64(b_lo, 32));
+        b_hi = _mm_add_epi32(b_hi, _mm_srli_epi64(b_hi, 32));
+        // Gather lanes 0 and 2 of each: pixels 0..3 and 4..7.
+        __m128i pa = _mm_unpacklo_epi64(_mm_shuffle_epi32(a_lo, _MM_SHUFFLE(3, 3, 2, 0)),
+                                        _mm_shuffle_epi32(a_hi, _MM_SHUFFLE(3, 3, 2, 0)));
+        __m128i pb = _mm_unpacklo_epi64(_mm_shuffle_epi32(b_lo, _MM_SHUFFLE(3, 3, 2, 0)),
+                                        _mm_shuffle_epi32(b_hi, _MM_SHUFFLE(3, 3, 2, 0)));
+        pa = _mm_srli_epi32(_mm_add_epi32(pa, round), 8);
+        pb = _mm_srli_epi32(_mm_add_epi32(pb, round), 8);
+        __m128i y16 = _mm_packs_epi32(pa, pb);
+        __m128i y8 = _mm_packus_epi16(y16, zero);
+        _mm_storel_epi64((__m128i *)(dst + i), y8);
+    }
+    return i;
+}
+#elif defined(__ARM_NEON)
+// 16 pixels per iteration with de-interleaving loads and widening multiply-accumulate.
+static size_t row_simd(uint8_t *dst, const uint8_t *src, size_t pixels) {
+    const uint8x8_t wb = vdup_n_u8(W_B), wg = vdup_n_u8(W_G), wr = vdup_n_u8(W_R);
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t px = vld4q_u8(src + 4 * i);
+        uint16x8_t lo = vmull_u8(vget_low_u8(px.val[0]), wb);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[1]), wg);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[2]), wr);
+        uint16x8_t hi = vmull_u8(vget_high_u8(px.val[0]), wb);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[1]), wg);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[2]), wr);
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+    return i;
+}
+#else
+static size_t row_simd(uint8_t *dst, const uint8_t *src, size_t pixels) {
+    (void)dst;
+    (void)src;
+    (void)pixels;
+    return 0;
+}
+#endif
+
+void grey_from_bgra(uint8_t *dst, const uint8_t *src, uint32_t width, uint32_t height,
+                    size_t src_stride) {
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = src + (size_t)y * src_stride;
+        uint8_t *out = dst + (size_t)y * width;
+        size_t done = row_simd(out, row, width);
+        grey_from_bgra_scalar(out + done, row + 4 * done, width - done);
+    }
+}
@@ -0,0 +1,20 @@
+// grey_convert.h — BGRA → 8-bit greyscale for the Linux sender.
+//
+// BT.601 luma with 8-bit fixed-point weights: Y = (29·B + 150·G + 77·R + 128) >> 8.
+// SSE2 on x86-64, NEON on ARM, scalar elsewhere; all paths produce identical output.
+
+#ifndef GREY_CONVERT_H
+#define GREY_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Convert `width` x `height` BGRA pixels (row stride `src_stride` bytes) into a
+// tightly packed greyscale image.
+void grey_from_bgra(uint8_t *dst, const uint8_t *src, uint32_t width, uint32_t height,
+                    size_t src_stride);
+
+// Scalar reference, used by the SIMD paths for row tails and by the tests.
+void grey_from_bgra_scalar(uint8_t *dst, const uint8_t *src, size_t pixels);
+
+#endif
@@ -0,0 +1,138 @@
+// grey_encoder.c — LZ4 delta / changed-tile encoder (see grey_encoder.h).
+
+#include "grey_encoder.h"
+#include "mirror_protocol.h"
+#include "lz4.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE_HEADER 4
+
+static uint32_t tile_count(const grey_encoder *e) {
+    uint32_t cols = (e->width + e->tile - 1) / e->tile;
+    uint32_t rows = (e->height + e->tile - 1) / e->tile;
+    return cols * rows;
+}
+
+int grey_encoder_init(grey_encoder *e, grey_mode mode, uint32_t width, uint32_t height,
+                      uint32_t tile) {
+    memset(e, 0, sizeof(*e));
+    e->mode = mode;
+    e->width = width;
+    e->height = height;
+    e->tile = tile;
+    if (mode == GREY_MODE_TILES && (tile == 0 || tile > 0xFFFF || tile_count(e) > 0xFFFF)) return -1;
+
+    size_t n = (size_t)width * height;
+    size_t index_bytes = mode == GREY_MODE_TILES ? TILE_HEADER + 2 * (size_t)tile_count(e) : 0;
+    e->out_capacity = index_bytes + (size_t)LZ4_compressBound((int)n);
+    e->prev = (uint8_t *)malloc(n);
+    e->work = (uint8_t *)malloc(n);
+    e->out = (uint8_t *)malloc(e->out_capacity);
+    if (!e->prev || !e->work || !e->out) {
+        grey_encoder_free(e);
+        return -1;
+    }
+    return 0;
+}
+
+void grey_encoder_free(grey_encoder *e) {
+    free(e->prev);
+    free(e->work);
+    free(e->out);
+    memset(e, 0, sizeof(*e));
+}
+
+static void xor_frames(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        x ^= y;
+        memcpy(dst + i, &x, 8);
+    }
+    for (; i < n; i++) dst[i] = a[i] ^ b[i];
+}
+
+static size_t encode_delta(grey_encoder *e, const uint8_t *frame, int keyframe, uint8_t *out,
+                           size_t cap) {
+    size_t n = (size_t)e->width * e->height;
+    const uint8_t *src = frame;
+    if (!keyframe) {
+        xor_frames(e->work, frame, e->prev, n);
+        src = e->work;
+    }
+    int c = LZ4_compress_default((const char *)src, (char *)out, (int)n, (int)cap);
+    return c > 0 ? (size_t)c : 0;
+}
+
+static int tile_changed(const grey_encoder *e, const uint8_t *frame, uint32_t x0, uint32_t y0,
+                        uint32_t w, uint32_t h) {
+    size_t off = (size_t)y0 * e->width + x0;
+    for (uint32_t y = 0; y < h; y++, off += e->width) {
+        if (memcmp(frame + off, e->prev + off, w) != 0) return 1;
+    }
+    return 0;
+}
+
+static size_t encode_tiles(grey_encoder *e, const uint8_t *frame, int keyframe, uint8_t *out,
+                           size_t cap) {
+    uint32_t cols = (e->width + e->tile - 1) / e->tile;
+    uint32_t total = tile_count(e);
+    if (cap < TILE_HEADER + 2 * (size_t)total) return 0;
+    uint8_t *indices = out + TILE_HEADER;
+    uint8_t *gather = e->work;
+    uint32_t count = 0;
+
+    for (uint32_t idx = 0; idx < total; idx++) {
+        uint32_t x0 = (idx % cols) * e->tile, y0 = (idx / cols) * e->tile;
+        uint32_t w = x0 + e->tile > e->width ? e->width - x0 : e->tile;
+        uint32_t h = y0 + e->tile > e->height ? e->height - y0 : e->tile;
+        if (!keyframe && !tile_changed(e, frame, x0, y0, w, h)) continue;
+
+        write_le16(indices + 2 * count, (uint16_t)idx);
+        count++;
+        const uint8_t *src = frame + (size_t)y0 * e->width + x0;
+        for (uint32_t y = 0; y < h; y++) {
+            memcpy(gather, src, w);
+            gather += w;
+            src += e->width;
+        }
+    }
+
+    write_le16(out, (uint16_t)e->tile);
+    write_le16(out + 2, (uint16_t)count);
+    size_t header = TILE_HEADER + 2 * (size_t)count;
+    int raw = (int)(gather - e->work);
+    int c = LZ4_compress_default((const char *)e->work, (char *)out + header, raw,
+                                 (int)(cap - header));
+    if (c <= 0 && raw > 0) return 0;
+    return header + (size_t)(c > 0 ? c : 0);
+}
+
+size_t grey_encode_into(grey_encoder *e, const uint8_t *frame, int keyframe, uint8_t *out,
+                        size_t cap, uint8_t *flags) {
+    if (!e->have_prev) keyframe = 1;
+    *flags = FLAG_GREY_LZ4 | (keyframe ? FLAG_KEYFRAME : 0);
+
+    size_t n;
+    if (e->mode == GREY_MODE_TILES) {
+        *flags |= FLAG_GREY_TILES;
+        n = encode_tiles(e, frame, keyframe, out, cap);
+    } else {
+        n = encode_delta(e, frame, keyframe, out, cap);
+    }
+    if (n == 0) return 0;
+
+    memcpy(e->prev, frame, (size_t)e->width * e->height);
+    e->have_prev = 1;
+    return n;
+}
+
+const uint8_t *grey_encode(grey_encoder *e, const uint8_t *frame, int keyframe,
+                           uint8_t *flags, size_t *len) {
+    *len = grey_encode_into(e, frame, keyframe, e->out, e->out_capacity, flags);
+    return *len ? e->out : NULL;
+}
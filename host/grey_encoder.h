@@ -0,0 +1,53 @@
+// grey_encoder.h — LZ4 greyscale encoder for the Linux sender.
+//
+// Produces the payloads decoded by mirror_grey.c on the receiver:
+//   GREY_MODE_DELTA — LZ4 of the frame (keyframe) or of its XOR with the last
+//                     encoded frame. Static regions XOR to zero and compress to
+//                     almost nothing.
+//   GREY_MODE_TILES — only tiles whose pixels changed, LZ4-compressed together.
+//                     Cheaper to encode than a full-frame delta when little of the
+//                     screen changes; keyframes list every tile.
+
+#ifndef GREY_ENCODER_H
+#define GREY_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    GREY_MODE_DELTA = 0,
+    GREY_MODE_TILES,
+} grey_mode;
+
+typedef struct {
+    grey_mode mode;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile;          // tile edge in pixels (tiles mode)
+
+    uint8_t *prev;          // last encoded frame (the receiver's current frame)
+    uint8_t *work;          // XOR delta or gathered tile pixels
+    uint8_t *out;           // encoded payload
+    size_t out_capacity;
+    int have_prev;
+} grey_encoder;
+
+// Returns 0 on success, -1 on allocation failure or an unusable tile size.
+int grey_encoder_init(grey_encoder *e, grey_mode mode, uint32_t width, uint32_t height,
+                      uint32_t tile);
+void grey_encoder_free(grey_encoder *e);
+
+// Encode one greyscale frame. A delta is only possible after a keyframe, so the
+// first frame is always encoded as one. On return *flags holds the frame flags
+// (FLAG_GREY_LZ4, plus FLAG_GREY_TILES / FLAG_KEYFRAME as applicable) and the
+// returned pointer (valid until the next call) holds *len payload bytes.
+const uint8_t *grey_encode(grey_encoder *e, const uint8_t *frame, int keyframe,
+                           uint8_t *flags, size_t *len);
+
+// Same, but encode into caller memory (e.g. a frame buffer lent by the server).
+// `cap` of e->out_capacity is always enough. Returns the payload length, or 0 if
+// the frame could not be encoded.
+size_t grey_encode_into(grey_encoder *e, const uint8_t *frame, int keyframe, uint8_t *out,
+                        size_t cap, uint8_t *flags);
+
+#endif
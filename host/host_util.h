@@ -0,0 +1,66 @@
+// host_util.h — Small helpers shared by the host tools and tests.
+
+#ifndef HOST_UTIL_H
+#define HOST_UTIL_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include "mirror_common.h"
+
+static inline int write_all(int fd, const void *buf, size_t n) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static inline int read_all(int fd, void *buf, size_t n) {
+    uint8_t *p = (uint8_t *)buf;
+    while (n > 0) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static inline void sleep_until_us(int64_t t) {
+    int64_t now = mirror_now_us();
+    if (t <= now) return;
+    int64_t d = t - now;
+    struct timespec ts = { (time_t)(d / 1000000), (long)((d % 1000000) * 1000) };
+    nanosleep(&ts, NULL);
+}
+
+// Deterministic LCG for the simulators: the same seed gives the same run.
+static inline uint64_t rng_next(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+static inline int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts `v` in place and returns the q-quantile (0..1), nearest-rank.
+static inline double percentile(double *v, size_t n, double q) {
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(double), cmp_double);
+    size_t idx = (size_t)(q * (double)n);
+    if (idx >= n) idx = n - 1;
+    return v[idx];
+}
+
+#endif
@@ -0,0 +1,331 @@
+// link_sim.c — Discrete-event sender → USB tunnel → decoder simulation; see link_sim.h.
+
+#include "link_sim.h"
+#include "bdp_ctl.h"
+#include "host_util.h"
+#include "send_ring.h"
+#include "sender_server.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// MARK: - Models
+
+// Rates are what `adb reverse` sustains, not the bus rate: adbd copies every
+// chunk through userspace on both ends. Decode costs are the DC-1's HEVC
+// decoder at 1600x1200.
+static const link_model models[] = {
+    { "usb2", "USB 2.0 adb reverse (DC-1 default)",
+      35.0, 400, 400, 65536, 80, 150, 1000000, 3000, 2500, 15.0 },
+    { "usb2-busy", "USB 2.0 sharing the bus, slow host",
+      10.0, 800, 800, 16384, 120, 400, 250000, 6000, 2500, 15.0 },
+    { "usb2-hiccup", "USB 2.0 with a 40 ms adbd stall every 2 s",
+      35.0, 400, 400, 65536, 80, 150, 2000000, 40000, 2500, 15.0 },
+    { "usb3", "USB 3 adb reverse",
+      150.0, 200, 200, 262144, 40, 50, 2000000, 1000, 2500, 15.0 },
+    { "slow-decode", "USB 2.0, decoder slower than the capture rate",
+      35.0, 400, 400, 65536, 80, 150, 1000000, 3000, 8000, 25.0 },
+};
+
+const link_model *link_sim_models(int *count) {
+    *count = (int)(sizeof(models) / sizeof(models[0]));
+    return models;
+}
+
+const link_model *link_sim_find_model(const char *name) {
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+        if (strcmp(models[i].name, name) == 0) return &models[i];
+    }
+    return NULL;
+}
+
+// MARK: - Controllers
+
+static void none_on_send(void *ctx, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us) {
+    (void)ctx; (void)seq; (void)bytes; (void)keyframe; (void)now_us;
+}
+static void none_on_ack(void *ctx, uint32_t seq, int64_t now_us) {
+    (void)ctx; (void)seq; (void)now_us;
+}
+static int none_should_send(void *ctx, int64_t now_us) {
+    (void)ctx; (void)now_us;
+    return 1;
+}
+static int none_window(void *ctx) {
+    (void)ctx;
+    return 0;
+}
+static void none_destroy(void *ctx) {
+    (void)ctx;
+}
+
+// The rule both senders used before bdp_ctl: average RTT over the last
+// SENDER_RTT_WINDOW ACKs, 15 ms until the first.
+typedef struct {
+    send_ring ring;
+    double rtt_ms[SENDER_RTT_WINDOW];
+    int rtt_count;
+    int rtt_next;
+} legacy_ctl;
+
+static void legacy_on_send(void *ctx, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us) {
+    (void)bytes; (void)keyframe;
+    send_ring_record(&((legacy_ctl *)ctx)->ring, seq, now_us);
+}
+
+static void legacy_on_ack(void *ctx, uint32_t seq, int64_t now_us) {
+    legacy_ctl *l = (legacy_ctl *)ctx;
+    int64_t sent_us;
+    if (!send_ring_ack(&l->ring, seq, &sent_us)) return;
+    l->rtt_ms[l->rtt_next] = (now_us - sent_us) / 1000.0;
+    l->rtt_next = (l->rtt_next + 1) % SENDER_RTT_WINDOW;
+    if (l->rtt_count < SENDER_RTT_WINDOW) l->rtt_count++;
+}
+
+static int legacy_window(void *ctx) {
+    legacy_ctl *l = (legacy_ctl *)ctx;
+    double sum = 0;
+    for (int i = 0; i < l->rtt_count; i++) sum += l->rtt_ms[i];
+    return sender_backpressure_threshold(l->rtt_count ? sum / l->rtt_count : 15.0);
+}
+
+static int legacy_should_send(void *ctx, int64_t now_us) {
+    (void)now_us;
+    return (int)send_ring_inflight(&((legacy_ctl *)ctx)->ring) <= legacy_window(ctx);
+}
+
+static void legacy_destroy(void *ctx) {
+    send_ring_free(&((legacy_ctl *)ctx)->ring);
+    free(ctx);
+}
+
+static void bdp_on_send(void *ctx, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us) {
+    bdp_ctl_on_send((bdp_ctl *)ctx, seq, bytes, keyframe, now_us);
+}
+static void bdp_on_ack(void *ctx, uint32_t seq, int64_t now_us) {
+    bdp_ctl_on_ack((bdp_ctl *)ctx, seq, now_us);
+}
+static int bdp_should_send(void *ctx, int64_t now_us) {
+    (void)now_us;
+    return bdp_ctl_should_send((bdp_ctl *)ctx);
+}
+static int bdp_window(void *ctx) {
+    return bdp_ctl_window_frames((bdp_ctl *)ctx);
+}
+static void bdp_destroy(void *ctx) {
+    bdp_ctl_free((bdp_ctl *)ctx);
+    free(ctx);
+}
+
+int link_sim_controller_create(link_sim_controller *c, const char *name, int fps) {
+    memset(c, 0, sizeof(*c));
+    if (strcmp(name, "none") == 0) {
+        *c = (link_sim_controller){ "none", NULL, none_on_send, none_on_ack, none_should_send,
+                                    none_window, none_destroy };
+        return 0;
+    }
+    if (strcmp(name, "legacy") == 0) {
+        legacy_ctl *l = (legacy_ctl *)calloc(1, sizeof(*l));
+        if (!l || send_ring_init(&l->ring, SENDER_SEQ_SLOTS) < 0) {
+            free(l);
+            return -1;
+        }
+        *c = (link_sim_controller){ "legacy", l, legacy_on_send, legacy_on_ack, legacy_should_send,
+                                    legacy_window, legacy_destroy };
+        return 0;
+    }
+    if (strcmp(name, "bdp") == 0) {
+        bdp_ctl *b = (bdp_ctl *)calloc(1, sizeof(*b));
+        bdp_config cfg;
+        bdp_config_default(&cfg);
+        cfg.fps = fps;
+        if (!b || bdp_ctl_init(b, &cfg) < 0) {
+            free(b);
+            return -1;
+        }
+        *c = (link_sim_controller){ "bdp", b, bdp_on_send, bdp_on_ack, bdp_should_send,
+                                    bdp_window, bdp_destroy };
+        return 0;
+    }
+    return -1;
+}
+
+void link_sim_controller_destroy(link_sim_controller *c) {
+    if (c->destroy) c->destroy(c->ctx);
+    c->destroy = NULL;
+}
+
+// MARK: - Event queue
+
+typedef enum { EV_ACK = 0, EV_CAPTURE = 1 } event_kind;   // ACKs first on ties
+
+typedef struct {
+    int64_t t;
+    uint64_t order;             // insertion order breaks remaining ties
+    event_kind kind;
+    uint32_t seq;
+} sim_event;
+
+typedef struct {
+    sim_event *heap;
+    size_t n, cap;
+    uint64_t next_order;
+} event_queue;
+
+static int event_before(const sim_event *a, const sim_event *b) {
+    if (a->t != b->t) return a->t < b->t;
+    if (a->kind != b->kind) return a->kind < b->kind;
+    return a->order < b->order;
+}
+
+static int event_push(event_queue *q, int64_t t, event_kind kind, uint32_t seq) {
+    if (q->n == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 256;
+        sim_event *h = (sim_event *)realloc(q->heap, cap * sizeof(*h));
+        if (!h) return -1;
+        q->heap = h;
+        q->cap = cap;
+    }
+    size_t i = q->n++;
+    q->heap[i] = (sim_event){ t, q->next_order++, kind, seq };
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!event_before(&q->heap[i], &q->heap[parent])) break;
+        sim_event tmp = q->heap[i];
+        q->heap[i] = q->heap[parent];
+        q->heap[parent] = tmp;
+        i = parent;
+    }
+    return 0;
+}
+
+static sim_event event_pop(event_queue *q) {
+    sim_event top = q->heap[0];
+    q->heap[0] = q->heap[--q->n];
+    size_t i = 0;
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < q->n && event_before(&q->heap[l], &q->heap[m])) m = l;
+        if (r < q->n && event_before(&q->heap[r], &q->heap[m])) m = r;
+        if (m == i) break;
+        sim_event tmp = q->heap[i];
+        q->heap[i] = q->heap[m];
+        q->heap[m] = tmp;
+        i = m;
+    }
+    return top;
+}
+
+// MARK: - Stages
+
+typedef struct {
+    const link_model *m;
+    uint64_t rng;
+    int64_t link_free_us;
+    int64_t decoder_free_us;
+    int64_t busy_us;
+} sim_path;
+
+// If t falls in a stall, when the stall ends.
+static int64_t after_stall(const link_model *m, int64_t t) {
+    if (m->stall_period_us <= 0 || t < m->stall_period_us) return t;
+    int64_t phase = t % m->stall_period_us;
+    return phase < m->stall_us ? t - phase + m->stall_us : t;
+}
+
+// Push `bytes` through the tunnel starting no earlier than `now`; returns when
+// the last chunk reaches the receiver.
+static int64_t tunnel_transfer(sim_path *p, uint32_t bytes, int64_t now) {
+    const link_model *m = p->m;
+    int64_t t = now > p->link_free_us ? now : p->link_free_us;
+    uint32_t left = bytes;
+    while (left > 0) {
+        uint32_t chunk = left < m->chunk_bytes ? left : m->chunk_bytes;
+        t = after_stall(m, t);
+        int64_t dur = (int64_t)(chunk / m->rate_mbs) + m->chunk_overhead_us;
+        if (m->jitter_us > 0) dur += (int64_t)(rng_next(&p->rng) % (uint64_t)(m->jitter_us + 1));
+        int64_t end = t + dur;
+        // A stall starting mid-chunk pauses it.
+        if (m->stall_period_us > 0) {
+            int64_t next_stall = (t / m->stall_period_us + 1) * m->stall_period_us;
+            if (next_stall < end) end += m->stall_us;
+        }
+        p->busy_us += dur;
+        t = end;
+        left -= chunk;
+    }
+    p->link_free_us = t;
+    return t + m->latency_us;
+}
+
+static int64_t decode(sim_path *p, uint32_t bytes, int64_t arrive) {
+    int64_t start = arrive > p->decoder_free_us ? arrive : p->decoder_free_us;
+    p->decoder_free_us = start + p->m->decode_us + (int64_t)(p->m->decode_us_per_kb * bytes / 1024.0);
+    return p->decoder_free_us;
+}
+
+// MARK: - Run
+
+int link_sim_run(const link_model *model, const loadgen_config *load, int fps, int frames,
+                 link_sim_controller *ctl, link_sim_result *out) {
+    memset(out, 0, sizeof(*out));
+    double *latency_ms = (double *)malloc((size_t)(frames > 0 ? frames : 1) * sizeof(double));
+    event_queue q = { 0 };
+    if (!latency_ms) return -1;
+
+    loadgen lg;
+    loadgen_init(&lg, load);
+    sim_path path = { model, load->seed ^ 0x5DEECE66DULL, 0, 0, 0 };
+    int64_t period_us = 1000000 / fps;
+    uint32_t seq = 0;
+    uint64_t acked = 0;
+    double inflight_sum = 0, window_sum = 0;
+    int64_t last_t = 0;
+    int rc = 0;
+
+    if (frames > 0) rc = event_push(&q, 0, EV_CAPTURE, 0);
+    while (rc == 0 && q.n > 0) {
+        sim_event ev = event_pop(&q);
+        last_t = ev.t;
+        if (ev.kind == EV_ACK) {
+            ctl->on_ack(ctl->ctx, ev.seq, ev.t);
+            acked++;
+            continue;
+        }
+
+        loadgen_frame f;
+        loadgen_next(&lg, &f);
+        int key = (f.flags & FLAG_KEYFRAME) != 0;
+        out->frames++;
+        inflight_sum += (double)(out->sent - acked);
+        window_sum += ctl->window(ctl->ctx);
+
+        if (key || ctl->should_send(ctl->ctx, ev.t)) {
+            ctl->on_send(ctl->ctx, seq, f.size, key, ev.t);
+            int64_t done = decode(&path, f.size, tunnel_transfer(&path, f.size, ev.t));
+            latency_ms[out->sent] = (done - ev.t) / 1000.0;
+            out->sent++;
+            out->bytes += f.size;
+            rc = event_push(&q, done + model->ack_latency_us, EV_ACK, seq++);
+        } else {
+            out->skipped++;
+        }
+        if (rc == 0 && out->frames < (uint64_t)frames) {
+            rc = event_push(&q, (int64_t)out->frames * period_us, EV_CAPTURE, 0);
+        }
+    }
+    free(q.heap);
+
+    if (rc == 0) {
+        out->p50_ms = percentile(latency_ms, out->sent, 0.50);
+        out->p95_ms = percentile(latency_ms, out->sent, 0.95);
+        out->p99_ms = percentile(latency_ms, out->sent, 0.99);
+        out->max_ms = out->sent ? latency_ms[out->sent - 1] : 0;   // sorted by percentile()
+        out->skip_rate = out->frames ? (double)out->skipped / out->frames : 0;
+        out->avg_inflight = out->frames ? inflight_sum / out->frames : 0;
+        out->avg_window = out->frames ? window_sum / out->frames : 0;
+        out->link_busy = last_t > 0 ? (double)path.busy_us / last_t : 0;
+    }
+    free(latency_ms);
+    return rc;
+}
@@ -0,0 +1,76 @@
+// link_sim.h — Deterministic discrete-event model of the sender → USB → receiver path.
+//
+// Frames from a loadgen schedule are captured at a fixed rate and pass a
+// backpressure controller, then three FIFO stages: the adb USB tunnel (chunked
+// transfer at a link rate, per-chunk overhead and jitter, periodic stalls while
+// adbd is descheduled), the receiver's decoder, and the ACK's return trip.
+// ACK arrivals are events on a time-ordered queue that the controller sees
+// before the next capture tick, exactly as a sender would.
+//
+// Everything is seeded, so two runs with the same inputs give identical
+// results and candidate controllers can be compared frame for frame on
+// capture-to-decode latency and skip rate (tools/mirror_linksim.c).
+
+#ifndef LINK_SIM_H
+#define LINK_SIM_H
+
+#include <stdint.h>
+#include "loadgen.h"
+
+typedef struct {
+    const char *name;
+    const char *description;
+    double rate_mbs;            // tunnel throughput, MB/s
+    int64_t latency_us;         // one-way propagation, sender → receiver
+    int64_t ack_latency_us;     // receiver → sender
+    uint32_t chunk_bytes;       // adb forwards the stream in chunks of this size
+    int64_t chunk_overhead_us;  // per-chunk cost (USB transaction + adbd copy)
+    int64_t jitter_us;          // extra uniform delay per chunk, 0..jitter
+    int64_t stall_period_us;    // adbd stalls every period (0 = never)...
+    int64_t stall_us;           // ...for this long
+    int64_t decode_us;          // receiver decode per frame
+    double decode_us_per_kb;    // plus this much per KB of payload
+} link_model;
+
+// Built-in USB tunnel models.
+const link_model *link_sim_models(int *count);
+const link_model *link_sim_find_model(const char *name);
+
+// A candidate backpressure controller. Keyframes are always sent; for other
+// frames should_send() decides.
+typedef struct {
+    const char *name;
+    void *ctx;
+    void (*on_send)(void *ctx, uint32_t seq, uint32_t bytes, int keyframe, int64_t now_us);
+    void (*on_ack)(void *ctx, uint32_t seq, int64_t now_us);
+    int (*should_send)(void *ctx, int64_t now_us);
+    int (*window)(void *ctx);   // allowed inflight frames, for reporting
+    void (*destroy)(void *ctx);
+} link_sim_controller;
+
+// Built-in controllers:
+//   none   — never skips
+//   legacy — inflight > max(2, min(6, 120 / avg RTT)) (the old rule)
+//   bdp    — bdp_ctl with its default config
+// Returns 0, or -1 for an unknown name.
+int link_sim_controller_create(link_sim_controller *c, const char *name, int fps);
+void link_sim_controller_destroy(link_sim_controller *c);
+
+typedef struct {
+    uint64_t frames;            // captured
+    uint64_t sent;
+    uint64_t skipped;
+    uint64_t bytes;
+    double skip_rate;           // skipped / frames
+    double p50_ms, p95_ms, p99_ms, max_ms;  // capture → decoded, sent frames
+    double avg_inflight;        // at capture ticks
+    double avg_window;
+    double link_busy;           // fraction of time the tunnel was transferring
+} link_sim_result;
+
+// Simulate `frames` captures at `fps` from `load` over `model`.
+// Returns 0, or -1 if out of memory.
+int link_sim_run(const link_model *model, const loadgen_config *load, int fps, int frames,
+                 link_sim_controller *ctl, link_sim_result *out);
+
+#endif
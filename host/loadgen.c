@@ -0,0 +1,322 @@
+// loadgen.c — Synthetic frame schedules and the paced send/ACK runner.
+
+#include "loadgen.h"
+#include "host_util.h"
+
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_PAYLOAD 64
+#define MAX_PAYLOAD (8u * 1024 * 1024)
+
+// MARK: - Random numbers
+
+// splitmix64: tiny, fast, and good enough for size distributions.
+static uint64_t next_u64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in (0, 1).
+static double next_unit(uint64_t *state) {
+    return ((next_u64(state) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double next_normal(uint64_t *state) {
+    double u1 = next_unit(state), u2 = next_unit(state);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+// MARK: - Profiles
+
+const char *loadgen_profile_name(loadgen_profile p) {
+    switch (p) {
+    case LOADGEN_CONSTANT: return "constant";
+    case LOADGEN_TYPING: return "typing";
+    case LOADGEN_SCROLLING: return "scrolling";
+    case LOADGEN_VIDEO: return "video";
+    }
+    return "?";
+}
+
+int loadgen_parse_profile(const char *s, loadgen_profile *out) {
+    static const loadgen_profile all[] = { LOADGEN_CONSTANT, LOADGEN_TYPING, LOADGEN_SCROLLING, LOADGEN_VIDEO };
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        if (strcmp(s, loadgen_profile_name(all[i])) == 0) {
+            *out = all[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Defaults are typical HEVC P-frame sizes from the Mac sender at 1600x1200.
+uint32_t loadgen_default_p_size(loadgen_profile p) {
+    switch (p) {
+    case LOADGEN_CONSTANT: return 20000;
+    case LOADGEN_TYPING: return 3000;
+    case LOADGEN_SCROLLING: return 30000;
+    case LOADGEN_VIDEO: return 60000;
+    }
+    return 20000;
+}
+
+void loadgen_default_config(loadgen_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->profile = LOADGEN_CONSTANT;
+    cfg->idr_size = 400000;
+    cfg->idr_interval = 120;
+    cfg->burst_rate = 0;
+    cfg->burst_frames = 30;
+    cfg->burst_scale = 4.0;
+    cfg->command_interval = 0;
+    cfg->seed = 1;
+}
+
+void loadgen_init(loadgen *lg, const loadgen_config *cfg) {
+    memset(lg, 0, sizeof(*lg));
+    lg->cfg = *cfg;
+    lg->rng = cfg->seed;
+}
+
+static uint32_t clamp_size(double v) {
+    if (v < MIN_PAYLOAD) return MIN_PAYLOAD;
+    if (v > MAX_PAYLOAD) return MAX_PAYLOAD;
+    return (uint32_t)v;
+}
+
+static uint32_t p_frame_size(loadgen *lg) {
+    double median = lg->cfg.p_size ? lg->cfg.p_size : loadgen_default_p_size(lg->cfg.profile);
+    switch (lg->cfg.profile) {
+    case LOADGEN_CONSTANT:
+        return clamp_size(median);
+    case LOADGEN_TYPING:
+        // A third of frames at typing speed carry no visible change at all.
+        if (next_unit(&lg->rng) < 0.33) return clamp_size(median * 0.05);
+        return clamp_size(median * exp(0.6 * next_normal(&lg->rng)));
+    case LOADGEN_SCROLLING:
+        return clamp_size(median * exp(0.25 * next_normal(&lg->rng)));
+    case LOADGEN_VIDEO: {
+        // Content motion comes and goes on a ~2s cycle at 120fps.
+        double rhythm = 1.0 + 0.3 * sin(lg->seq * (6.283185307179586 / 240.0));
+        return clamp_size(median * rhythm * exp(0.2 * next_normal(&lg->rng)));
+    }
+    }
+    return clamp_size(median);
+}
+
+// Alternate brightness and warmth with a value that walks the full range.
+static void next_command(loadgen *lg, uint8_t pkt[CMD_SIZE]) {
+    uint8_t step = lg->command_phase++;
+    uint8_t cmd = (step & 1) ? CMD_WARMTH : CMD_BRIGHTNESS;
+    encode_command(pkt, cmd, (uint8_t)(step * 37));
+}
+
+void loadgen_next(loadgen *lg, loadgen_frame *out) {
+    memset(out, 0, sizeof(*out));
+    out->seq = lg->seq;
+
+    int idr = lg->seq == 0 ||
+              (!lg->cfg.intra_refresh && lg->cfg.idr_interval > 0 &&
+               lg->seq % (uint32_t)lg->cfg.idr_interval == 0);
+
+    if (lg->burst_left == 0 && lg->cfg.burst_rate > 0 && next_unit(&lg->rng) < lg->cfg.burst_rate) {
+        // Geometric length with the configured mean, at least one frame.
+        double mean = lg->cfg.burst_frames > 1 ? lg->cfg.burst_frames : 1;
+        lg->burst_left = 1 + (int)(-log(next_unit(&lg->rng)) * (mean - 1));
+    }
+
+    if (idr) {
+        out->flags = FLAG_KEYFRAME;
+        out->size = clamp_size(lg->cfg.idr_size);
+    } else {
+        out->size = p_frame_size(lg);
+    }
+    if (lg->burst_left > 0) {
+        out->burst = 1;
+        if (!idr) out->size = clamp_size(out->size * lg->cfg.burst_scale);
+        lg->burst_left--;
+    }
+    if (!idr && lg->cfg.intra_refresh && lg->cfg.idr_interval > 0) {
+        out->size = clamp_size((double)out->size + (double)lg->cfg.idr_size / lg->cfg.idr_interval);
+    }
+
+    if (lg->cfg.command_interval > 0 &&
+        ++lg->frames_since_command >= (uint64_t)lg->cfg.command_interval) {
+        lg->frames_since_command = 0;
+        out->has_command = 1;
+        next_command(lg, out->command);
+    }
+
+    lg->seq++;
+}
+
+void loadgen_fill_payload(uint8_t *buf, uint32_t len) {
+    static const uint8_t prefix[] = { 0x00, 0x00, 0x00, 0x01, 0x4C, 0x01 };  // FD_NUT (38)
+    if (len <= sizeof(prefix)) {
+        memset(buf, 0, len);
+        return;
+    }
+    memcpy(buf, prefix, sizeof(prefix));
+    memset(buf + sizeof(prefix), 0xFF, len - sizeof(prefix) - 1);
+    buf[len - 1] = 0x80;  // rbsp_trailing_bits
+}
+
+// MARK: - Runner
+
+typedef struct {
+    int fd;
+    uint32_t base_seq;
+    int frames;
+    const int64_t *send_us;
+    double *ack_ms;
+    pthread_mutex_t lock;
+    int acked;
+    int64_t last_ack_us;
+    volatile int stop;
+} ack_reader;
+
+static void *ack_thread(void *arg) {
+    ack_reader *a = (ack_reader *)arg;
+    uint8_t ack[ACK_SIZE];
+    while (!a->stop) {
+        struct pollfd pfd = { a->fd, POLLIN, 0 };
+        int pr = poll(&pfd, 1, 50);
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr < 0) break;
+        if (pr == 0) continue;
+        if (read_all(a->fd, ack, 2) < 0) break;
+        if (ack[0] == MAGIC_FRAME_0 && ack[1] == MAGIC_CMD_1) {
+            // Upstream command (watchdog keyframe request): skip it, keep ACKs aligned.
+            if (read_all(a->fd, ack + 2, CMD_SIZE - 2) < 0) break;
+            continue;
+        }
+        if (read_all(a->fd, ack + 2, ACK_SIZE - 2) < 0) break;
+        int64_t now = mirror_now_us();
+        if (ack[0] != MAGIC_FRAME_0 || ack[1] != MAGIC_ACK_1) continue;
+
+        // ACKs from an earlier run on the same connection fall outside the window.
+        uint32_t idx = read_le32(ack + 2) - a->base_seq;
+        if (idx >= (uint32_t)a->frames || a->ack_ms[idx] >= 0) continue;
+        pthread_mutex_lock(&a->lock);
+        a->ack_ms[idx] = (now - a->send_us[idx]) / 1000.0;
+        a->acked++;
+        a->last_ack_us = now;
+        pthread_mutex_unlock(&a->lock);
+    }
+    return NULL;
+}
+
+static int send_bytes(int fd, FILE *record, const void *buf, size_t n) {
+    if (record) fwrite(buf, 1, n, record);
+    return write_all(fd, buf, n);
+}
+
+int loadgen_run(int fd, loadgen *lg, int fps, int frames, int drain_ms,
+                FILE *record, loadgen_result *out) {
+    memset(out, 0, sizeof(*out));
+    if (fps <= 0 || frames <= 0) return -1;
+
+    int64_t *send_us = (int64_t *)calloc((size_t)frames, sizeof(int64_t));
+    double *ack_ms = (double *)malloc((size_t)frames * sizeof(double));
+    for (int i = 0; i < frames; i++) ack_ms[i] = -1;
+
+    ack_reader a = { .fd = fd, .base_seq = lg->seq, .frames = frames,
+                     .send_us = send_us, .ack_ms = ack_ms };
+    pthread_mutex_init(&a.lock, NULL);
+    pthread_t reader;
+    pthread_create(&reader, NULL, ack_thread, &a);
+
+    uint32_t buf_cap = 0;
+    uint8_t *buf = NULL;
+    int status = 0;
+    int64_t period_us = 1000000 / fps;
+    int64_t t0 = mirror_now_us();
+    int64_t next = t0;
+
+    for (int i = 0; i < frames; i++) {
+        loadgen_frame f;
+        loadgen_next(lg, &f);
+
+        if (f.has_command) {
+            if (send_bytes(fd, record, f.command, CMD_SIZE) < 0) { status = -1; break; }
+            out->commands_sent++;
+        }
+
+        uint32_t total = FRAME_HEADER_SIZE + f.size;
+        if (total > buf_cap) {
+            free(buf);
+            buf_cap = total;
+            buf = (uint8_t *)malloc(buf_cap);
+        }
+        encode_frame_header(buf, f.flags, f.seq, f.size);
+        loadgen_fill_payload(buf + FRAME_HEADER_SIZE, f.size);
+
+        int64_t now = mirror_now_us();
+        if (now - next > period_us) out->late_frames++;
+        send_us[i] = now;
+        if (send_bytes(fd, record, buf, total) < 0) { status = -1; break; }
+        out->frames_sent++;
+        out->bytes_sent += f.size;
+
+        next += period_us;
+        sleep_until_us(next);
+    }
+    int64_t send_end = mirror_now_us();
+
+    int64_t drain_deadline = send_end + (int64_t)drain_ms * 1000;
+    for (;;) {
+        pthread_mutex_lock(&a.lock);
+        int done = (uint64_t)a.acked >= out->frames_sent;
+        pthread_mutex_unlock(&a.lock);
+        if (done || mirror_now_us() >= drain_deadline) break;
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+    a.stop = 1;
+    pthread_join(reader, NULL);
+    pthread_mutex_destroy(&a.lock);
+
+    int64_t end = a.last_ack_us > send_end ? a.last_ack_us : send_end;
+    out->frames_acked = (uint64_t)a.acked;
+    out->elapsed_s = (end - t0) / 1e6;
+    double send_s = (send_end - t0) / 1e6;
+    out->send_fps = send_s > 0 ? out->frames_sent / send_s : 0;
+    // ACK rate spans first send to last ACK, so a receiver that falls behind
+    // and drains its backlog after the sender stops shows up as a lower rate.
+    double ack_s = a.last_ack_us > t0 ? (a.last_ack_us - t0) / 1e6 : 0;
+    if (ack_s < send_s) ack_s = send_s;
+    out->ack_fps = ack_s > 0 ? out->frames_acked / ack_s : 0;
+    out->mbps = send_s > 0 ? out->bytes_sent * 8.0 / send_s / 1e6 : 0;
+
+    size_t n = 0;
+    double sum = 0;
+    for (int i = 0; i < frames; i++) {
+        if (ack_ms[i] >= 0) {
+            ack_ms[n++] = ack_ms[i];
+            sum += ack_ms[i];
+        }
+    }
+    if (n > 0) {
+        out->ack_avg_ms = sum / n;
+        out->ack_p50_ms = percentile(ack_ms, n, 0.50);
+        out->ack_p95_ms = percentile(ack_ms, n, 0.95);
+        out->ack_p99_ms = percentile(ack_ms, n, 0.99);
+        out->ack_max_ms = ack_ms[n - 1];
+    }
+
+    free(buf);
+    free(send_us);
+    free(ack_ms);
+    return status;
+}
+
+int loadgen_saturated(const loadgen_result *res, int fps) {
+    if (fps <= 0) return 0;
+    if (res->ack_fps < 0.95 * fps) return 1;
+    return res->ack_p95_ms > 1000.0 / fps;
+}
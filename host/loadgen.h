@@ -0,0 +1,106 @@
+// loadgen.h — Synthetic Daylight Mirror traffic: frame-size models and a paced runner.
+//
+// The generator produces a deterministic (seeded) schedule of frames and command
+// packets that looks like what the Mac sender emits for a given kind of screen
+// activity:
+//   typing    — mostly tiny P-frames (glyphs, cursor), many near-empty
+//   scrolling — medium P-frames with little variance
+//   video     — large P-frames with a slow rhythm (motion content)
+//   constant  — every P-frame exactly p_size bytes
+// Keyframes come every idr_interval frames, or with intra_refresh the same intra
+// bytes are spread over the interval as a rolling refresh (the encoder codes a
+// slice of the picture intra in every frame) and only the first frame is an IDR.
+// On top of the profile, bursty motion phases (window drags, page flips) scale
+// frame sizes up for a geometrically distributed number of frames, and command
+// packets (brightness/warmth) can be injected between frames.
+//
+// loadgen_run() writes the schedule to a connected receiver at a fixed frame rate
+// and measures throughput and per-frame ACK latency.
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "mirror_protocol.h"
+
+typedef enum {
+    LOADGEN_CONSTANT = 0,
+    LOADGEN_TYPING,
+    LOADGEN_SCROLLING,
+    LOADGEN_VIDEO,
+} loadgen_profile;
+
+typedef struct {
+    loadgen_profile profile;
+    uint32_t p_size;            // median P-frame payload; 0 = profile default
+    uint32_t idr_size;          // IDR payload
+    int idr_interval;           // frames between IDRs; 0 = only the first frame
+    int intra_refresh;          // no IDR after the first: every P-frame carries
+                                // idr_size / idr_interval more intra-coded bytes
+    double burst_rate;          // per-frame probability of starting a motion burst
+    int burst_frames;           // mean burst length in frames
+    double burst_scale;         // P-frame size multiplier during a burst
+    int command_interval;       // inject a command every N frames; 0 = none
+    uint64_t seed;
+} loadgen_config;
+
+typedef struct {
+    uint32_t seq;
+    uint8_t flags;              // FLAG_KEYFRAME for IDRs
+    uint32_t size;              // payload bytes
+    int burst;                  // frame is inside a motion burst
+    int has_command;            // a command packet precedes this frame
+    uint8_t command[CMD_SIZE];
+} loadgen_frame;
+
+typedef struct {
+    loadgen_config cfg;
+    uint64_t rng;
+    uint32_t seq;
+    int burst_left;
+    uint64_t frames_since_command;
+    uint8_t command_phase;
+} loadgen;
+
+const char *loadgen_profile_name(loadgen_profile p);
+// Parses "constant", "typing", "scrolling" or "video". Returns 0 on success.
+int loadgen_parse_profile(const char *s, loadgen_profile *out);
+// Median P-frame size used when cfg.p_size is 0.
+uint32_t loadgen_default_p_size(loadgen_profile p);
+
+void loadgen_default_config(loadgen_config *cfg);
+void loadgen_init(loadgen *lg, const loadgen_config *cfg);
+// Produce the next frame of the schedule.
+void loadgen_next(loadgen *lg, loadgen_frame *out);
+
+// Fill `buf` with a payload the receiver can hand to a real decoder without
+// erroring: an Annex-B start code followed by an HEVC filler-data NAL.
+void loadgen_fill_payload(uint8_t *buf, uint32_t len);
+
+typedef struct {
+    uint64_t frames_sent;
+    uint64_t frames_acked;
+    uint64_t bytes_sent;
+    uint64_t commands_sent;
+    uint64_t late_frames;       // sender fell more than one period behind schedule
+    double elapsed_s;
+    double send_fps;
+    double ack_fps;
+    double mbps;                // payload megabits per second actually sent
+    double ack_avg_ms, ack_p50_ms, ack_p95_ms, ack_p99_ms, ack_max_ms;
+} loadgen_result;
+
+// Send `frames` frames from `lg` to `fd` at `fps`, reading ACKs concurrently.
+// Waits up to `drain_ms` after the last frame for outstanding ACKs. If `record`
+// is non-NULL every byte written is also appended to it (raw protocol stream).
+// Returns 0 on success, -1 if the connection failed before all frames were sent
+// (the result still describes what was sent).
+int loadgen_run(int fd, loadgen *lg, int fps, int frames, int drain_ms,
+                FILE *record, loadgen_result *out);
+
+// True if the receive path did not keep up: ACK rate more than 5% below the
+// target rate, or p95 ACK latency above one frame period.
+int loadgen_saturated(const loadgen_result *res, int fps);
+
+#endif
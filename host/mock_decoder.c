@@ -0,0 +1,358 @@
+// mock_decoder.c — Simulated MediaCodec backend for the host receiver build.
+//
+// Time is real (CLOCK_MONOTONIC): dequeue calls sleep until a slot frees up or the
+// timeout expires, so loopback benchmarks see the same blocking behaviour as on
+// device. See mock_decoder.h for the model.
+
+#include "mock_decoder.h"
+#include "host_util.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { IN_FREE = 0, IN_DEQUEUED, IN_DECODING };
+enum { OUT_FREE = 0, OUT_READY, OUT_HELD };
+
+// Move every finished decode into the output FIFO, oldest first. Decode stalls
+// while all output slots are occupied, like a real codec whose client stops draining.
+static void advance(mock_decoder *d, int64_t now) {
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < d->cfg.input_slots; i++) {
+            if (d->in_state[i] == IN_DECODING && d->in_done_at[i] <= now &&
+                (next < 0 || d->in_done_at[i] < d->in_done_at[next])) {
+                next = i;
+            }
+        }
+        if (next < 0) return;
+
+        int out = -1;
+        for (int i = 0; i < d->cfg.output_slots; i++) {
+            if (d->out_state[i] == OUT_FREE) { out = i; break; }
+        }
+        if (out < 0) return;
+
+        d->out_state[out] = OUT_READY;
+        d->out_info[out].size = d->in_len[next];
+        d->out_info[out].pts_us = d->in_pts[next];
+        d->out_info[out].flags = d->in_flags[next];
+        d->out_queued_at[out] = d->in_queued_at[next];
+        d->out_hash[out] = d->in_hash[next];
+        d->out_order[out] = d->out_next_order++;
+        d->in_state[next] = IN_FREE;
+        d->decoded++;
+    }
+}
+
+// Earliest pending decode completion, or `fallback` if nothing is decoding.
+static int64_t next_event(const mock_decoder *d, int64_t fallback) {
+    int64_t t = fallback;
+    for (int i = 0; i < d->cfg.input_slots; i++) {
+        if (d->in_state[i] == IN_DECODING && d->in_done_at[i] < t) t = d->in_done_at[i];
+    }
+    return t;
+}
+
+static int mock_configure(void *ctx, const mirror_codec_info *codec, uint32_t width,
+                          uint32_t height) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    int64_t decode_us = d->cfg.decode_latency_us;
+    for (const mirror_format_key *k = codec->keys; k->key; k++) {
+        if (strcmp(k->key, "mock-fail") == 0 && k->value) return 0;
+        if (strcmp(k->key, "mock-decode-us") == 0) decode_us = k->value;
+    }
+    pthread_mutex_lock(&d->lock);
+    d->codec = codec;
+    d->decode_latency_us = decode_us;
+    memset(d->in_state, 0, sizeof(d->in_state));
+    memset(d->out_state, 0, sizeof(d->out_state));
+    d->decoder_free_at = 0;
+    d->latch_present_ns = 0;
+    d->stall = MOCK_STALL_NONE;
+    d->width = width;
+    d->height = height;
+    d->output_attached = 1;
+    d->to_memory = 0;
+    d->configured = 1;
+    d->configures++;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+// Like configure with a NULL window: output stays in the decoder's buffers,
+// which get_output exposes as a luma plane per slot.
+static int mock_configure_memory(void *ctx, const mirror_codec_info *codec, uint32_t width,
+                                 uint32_t height) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    if (!mock_configure(ctx, codec, width, height)) return 0;
+    uint32_t stride = (width + 63) & ~63u;   // hardware pads rows
+    size_t size = (size_t)stride * height;
+    pthread_mutex_lock(&d->lock);
+    for (int i = 0; i < d->cfg.output_slots; i++) {
+        if (size > d->out_luma_size) {
+            free(d->out_luma[i]);
+            d->out_luma[i] = (uint8_t *)malloc(size);
+        }
+        if (!d->out_luma[i]) {
+            pthread_mutex_unlock(&d->lock);
+            return 0;
+        }
+    }
+    if (size > d->out_luma_size) d->out_luma_size = size;
+    d->stride = stride;
+    d->output_attached = 0;
+    d->to_memory = 1;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static void mock_release(void *ctx) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    pthread_mutex_lock(&d->lock);
+    d->configured = 0;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static ssize_t mock_dequeue_input(void *ctx, int64_t timeout_us) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    int64_t deadline = mirror_now_us() + timeout_us;
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        int64_t now = mirror_now_us();
+        advance(d, now);
+        for (int i = 0; i < d->cfg.input_slots; i++) {
+            if (d->in_state[i] == IN_FREE) {
+                d->in_state[i] = IN_DEQUEUED;
+                pthread_mutex_unlock(&d->lock);
+                return i;
+            }
+        }
+        if (now >= deadline) {
+            d->input_timeouts++;
+            pthread_mutex_unlock(&d->lock);
+            return -1;
+        }
+        int64_t wake = next_event(d, deadline);
+        if (wake > deadline) wake = deadline;
+        pthread_mutex_unlock(&d->lock);
+        sleep_until_us(wake);
+        pthread_mutex_lock(&d->lock);
+    }
+}
+
+static uint8_t *mock_get_input(void *ctx, size_t idx, size_t *capacity) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    if (idx >= (size_t)d->cfg.input_slots) return NULL;
+    *capacity = d->cfg.input_capacity;
+    return d->in_buf[idx];
+}
+
+static int mock_queue_input(void *ctx, size_t idx, size_t len, int64_t pts_us, uint32_t flags) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    if (idx >= (size_t)d->cfg.input_slots) return 0;
+    pthread_mutex_lock(&d->lock);
+    int64_t now = mirror_now_us();
+    if (len == 0) {
+        d->in_state[idx] = IN_FREE;
+        pthread_mutex_unlock(&d->lock);
+        return 1;
+    }
+    d->in_state[idx] = IN_DECODING;
+    if (d->stall != MOCK_STALL_NONE) {
+        d->in_done_at[idx] = INT64_MAX;     // held until flush or reconfigure
+    } else {
+        int64_t start = d->decoder_free_at > now ? d->decoder_free_at : now;
+        d->decoder_free_at = start + d->decode_latency_us;
+        d->in_done_at[idx] = d->decoder_free_at;
+    }
+    d->in_queued_at[idx] = now;
+    d->in_len[idx] = (int32_t)len;
+    d->in_pts[idx] = pts_us;
+    d->in_flags[idx] = flags;
+    // FNV-1a of the access unit: the "picture" get_output draws from it.
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ d->in_buf[idx][i]) * 16777619u;
+    d->in_hash[idx] = h;
+    d->queued++;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static ssize_t mock_dequeue_output(void *ctx, mirror_output_info *info, int64_t timeout_us) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    int64_t deadline = mirror_now_us() + timeout_us;
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        int64_t now = mirror_now_us();
+        advance(d, now);
+        int best = -1;
+        for (int i = 0; i < d->cfg.output_slots; i++) {
+            if (d->out_state[i] == OUT_READY &&
+                (best < 0 || d->out_order[i] < d->out_order[best])) {
+                best = i;
+            }
+        }
+        if (best >= 0) {
+            d->out_state[best] = OUT_HELD;
+            *info = d->out_info[best];
+            pthread_mutex_unlock(&d->lock);
+            return best;
+        }
+        if (now >= deadline) {
+            pthread_mutex_unlock(&d->lock);
+            return -1;
+        }
+        int64_t wake = next_event(d, deadline);
+        if (wake > deadline) wake = deadline;
+        pthread_mutex_unlock(&d->lock);
+        sleep_until_us(wake);
+        pthread_mutex_lock(&d->lock);
+    }
+}
+
+static int release(mock_decoder *d, size_t idx, int render, int64_t present_ns) {
+    if (idx >= (size_t)d->cfg.output_slots) return 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->out_state[idx] != OUT_HELD) {
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+    int64_t latency = mirror_now_us() - d->out_queued_at[idx];
+    d->latency_sum_us += latency;
+    if (latency > d->latency_max_us) d->latency_max_us = latency;
+    if (render) d->rendered++; else d->discarded++;
+    if (render && !d->output_attached) d->rendered_detached++;
+    if (present_ns) {
+        d->timed_renders++;
+        d->last_present_ns = present_ns;
+    }
+    // The compositor: a timed frame is shown unless the next one takes its slot.
+    int64_t shown_pts[2], shown_ns[2];
+    int n_shown = 0;
+    if (render && d->on_rendered) {
+        if (d->latch_present_ns && (!present_ns || present_ns > d->latch_present_ns)) {
+            shown_pts[n_shown] = d->latch_pts_us;
+            shown_ns[n_shown++] = d->latch_present_ns;
+        }
+        d->latch_present_ns = present_ns;
+        d->latch_pts_us = d->out_info[idx].pts_us;
+        if (!present_ns) {
+            shown_pts[n_shown] = d->out_info[idx].pts_us;
+            shown_ns[n_shown++] = mirror_now_us() * 1000;
+        }
+    }
+    d->out_state[idx] = OUT_FREE;
+    pthread_mutex_unlock(&d->lock);
+    for (int i = 0; i < n_shown; i++) d->on_rendered(d->on_rendered_ctx, shown_pts[i], shown_ns[i]);
+    return 1;
+}
+
+static int mock_release_output(void *ctx, size_t idx, int render) {
+    return release((mock_decoder *)ctx, idx, render, 0);
+}
+
+static int mock_release_output_at(void *ctx, size_t idx, int64_t present_ns) {
+    return release((mock_decoder *)ctx, idx, 1, present_ns);
+}
+
+// Like AMediaCodec_flush: every input slot is returned, decoded-but-undrained
+// output is discarded.
+static int mock_flush(void *ctx) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    pthread_mutex_lock(&d->lock);
+    memset(d->in_state, 0, sizeof(d->in_state));
+    memset(d->out_state, 0, sizeof(d->out_state));
+    d->decoder_free_at = 0;
+    d->latch_present_ns = 0;
+    if (d->stall == MOCK_STALL_FLUSHABLE) d->stall = MOCK_STALL_NONE;
+    d->flushes++;
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+static int mock_set_output(void *ctx, int attach) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    pthread_mutex_lock(&d->lock);
+    int ok = d->configured && !d->set_output_fails;
+    if (ok) {
+        d->output_attached = attach;
+        d->output_switches++;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+// A deterministic picture of the held frame: every luma row is derived from
+// the input's hash, so equal streams produce equal checksums.
+static int mock_get_output(void *ctx, size_t idx, mirror_output_image *img) {
+    mock_decoder *d = (mock_decoder *)ctx;
+    if (idx >= (size_t)d->cfg.output_slots) return 0;
+    pthread_mutex_lock(&d->lock);
+    int ok = d->to_memory && d->out_state[idx] == OUT_HELD;
+    if (ok) {
+        uint8_t *plane = d->out_luma[idx];
+        for (uint32_t y = 0; y < d->height; y++) {
+            memset(plane + (size_t)y * d->stride, (uint8_t)((d->out_hash[idx] * (y + 1)) >> 24), d->width);
+        }
+        img->y = plane;
+        img->width = d->width;
+        img->height = d->height;
+        img->stride = d->stride;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+const mirror_decoder_ops mock_decoder_ops = {
+    .name = "Mock",
+    .configure = mock_configure,
+    .release = mock_release,
+    .dequeue_input = mock_dequeue_input,
+    .get_input = mock_get_input,
+    .queue_input = mock_queue_input,
+    .dequeue_output = mock_dequeue_output,
+    .release_output = mock_release_output,
+    .release_output_at = mock_release_output_at,
+    .flush = mock_flush,
+    .set_output = mock_set_output,
+    .configure_memory = mock_configure_memory,
+    .get_output = mock_get_output,
+};
+
+void mock_decoder_default_config(mock_decoder_config *cfg) {
+    cfg->input_slots = 4;
+    cfg->output_slots = 4;
+    cfg->decode_latency_us = 3000;
+    cfg->input_capacity = 2 * 1024 * 1024;
+}
+
+void mock_decoder_init(mock_decoder *d, const mock_decoder_config *cfg) {
+    memset(d, 0, sizeof(*d));
+    d->cfg = *cfg;
+    d->decode_latency_us = cfg->decode_latency_us;
+    if (d->cfg.input_slots < 1) d->cfg.input_slots = 1;
+    if (d->cfg.input_slots > MOCK_MAX_SLOTS) d->cfg.input_slots = MOCK_MAX_SLOTS;
+    if (d->cfg.output_slots < 1) d->cfg.output_slots = 1;
+    if (d->cfg.output_slots > MOCK_MAX_SLOTS) d->cfg.output_slots = MOCK_MAX_SLOTS;
+    for (int i = 0; i < d->cfg.input_slots; i++) {
+        d->in_buf[i] = (uint8_t *)malloc(d->cfg.input_capacity);
+    }
+    pthread_mutex_init(&d->lock, NULL);
+}
+
+void mock_decoder_free(mock_decoder *d) {
+    for (int i = 0; i < MOCK_MAX_SLOTS; i++) {
+        free(d->in_buf[i]);
+        d->in_buf[i] = NULL;
+        free(d->out_luma[i]);
+        d->out_luma[i] = NULL;
+    }
+    pthread_mutex_destroy(&d->lock);
+}
+
+void mock_decoder_stall(mock_decoder *d, mock_stall stall) {
+    pthread_mutex_lock(&d->lock);
+    d->stall = stall;
+    pthread_mutex_unlock(&d->lock);
+}
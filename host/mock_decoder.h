@@ -0,0 +1,119 @@
+// mock_decoder.h — Simulated MediaCodec for host builds of the receiver core.
+//
+// Models the two properties of the DC-1 hardware decoder that shape receiver
+// latency: a fixed per-frame decode time (frames decode serially) and a small pool
+// of input slots that stay busy until their frame has been decoded. With few slots
+// and slow decode, dequeue_input times out exactly as AMediaCodec does on device.
+//
+// No pixels reach a window — output buffers carry only size/pts/flags. Configured
+// to memory (configure_memory), get_output draws a luma plane derived from the
+// access unit's bytes, so replay checksums are deterministic per stream.
+//
+// Tests can make it stall the way a wedged hardware decoder does: inputs are
+// accepted but never decode, so input slots run out and dequeue_input times out.
+// A flush() clears a MOCK_STALL_FLUSHABLE stall; only reconfiguring clears
+// MOCK_STALL_WEDGED.
+//
+// set_output moves output between the window and a sink; set_output_fails makes
+// it fail the way devices without AMediaCodec_setOutputSurface support do.
+//
+// release_output_at renders like release_output and records the present time.
+//
+// With on_rendered set, the mock also plays the compositor behind MediaCodec's
+// frame-rendered callback: an immediate render is shown at once, a timed one
+// at its present time once a later release shows it was latched, or never if
+// the next timed release targets the same time (it replaced it).
+//
+// Two format keys stand in for vendor tuning keys in calibration tests:
+// "mock-decode-us" overrides decode_latency_us for that configuration and
+// "mock-fail" makes configure fail.
+
+#ifndef MOCK_DECODER_H
+#define MOCK_DECODER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "mirror_decoder.h"
+
+#define MOCK_MAX_SLOTS 16
+
+typedef enum {
+    MOCK_STALL_NONE = 0,
+    MOCK_STALL_FLUSHABLE,
+    MOCK_STALL_WEDGED,
+} mock_stall;
+
+typedef struct {
+    int input_slots;            // input buffers exposed (MediaCodec: typically 4-8)
+    int output_slots;           // decoded frames held before the decoder stalls
+    int64_t decode_latency_us;  // time to decode one access unit
+    size_t input_capacity;      // bytes per input buffer
+} mock_decoder_config;
+
+typedef struct {
+    mock_decoder_config cfg;
+    pthread_mutex_t lock;       // guards the counters below for cross-thread readers
+
+    int configured;
+    const mirror_codec_info *codec;  // from the last configure
+    int64_t decode_latency_us;       // cfg value or the "mock-decode-us" key
+    uint32_t width, height;
+    mock_stall stall;
+    int output_attached;        // set_output target; rendering while detached is counted
+    int set_output_fails;
+
+    // Input slots: FREE → DEQUEUED → DECODING (until done_at) → FREE
+    int in_state[MOCK_MAX_SLOTS];
+    int64_t in_done_at[MOCK_MAX_SLOTS];
+    int64_t in_queued_at[MOCK_MAX_SLOTS];
+    int32_t in_len[MOCK_MAX_SLOTS];
+    int64_t in_pts[MOCK_MAX_SLOTS];
+    uint32_t in_flags[MOCK_MAX_SLOTS];
+    uint32_t in_hash[MOCK_MAX_SLOTS];
+    uint8_t *in_buf[MOCK_MAX_SLOTS];
+    int64_t decoder_free_at;    // decode is serial: next frame starts when this passes
+
+    // Output FIFO of decoded frames, plus buffers the client holds
+    int out_state[MOCK_MAX_SLOTS];
+    mirror_output_info out_info[MOCK_MAX_SLOTS];
+    int64_t out_queued_at[MOCK_MAX_SLOTS];
+    uint64_t out_order[MOCK_MAX_SLOTS];
+    uint64_t out_next_order;
+    uint32_t out_hash[MOCK_MAX_SLOTS];
+
+    // Decode to memory: a padded luma plane per output slot
+    int to_memory;
+    uint8_t *out_luma[MOCK_MAX_SLOTS];
+    size_t out_luma_size;
+    uint32_t stride;
+
+    // Counters
+    uint64_t configures;
+    uint64_t queued;
+    uint64_t decoded;
+    uint64_t rendered;
+    uint64_t discarded;          // released with render=0
+    uint64_t input_timeouts;
+    uint64_t flushes;
+    uint64_t output_switches;
+    uint64_t rendered_detached;  // render=1 while output went to the sink (a bug)
+    uint64_t timed_renders;      // release_output_at
+    int64_t last_present_ns;
+    // Frame-rendered callback (pts as queued, shown time); called without the lock.
+    void (*on_rendered)(void *ctx, int64_t pts_us, int64_t shown_ns);
+    void *on_rendered_ctx;
+    int64_t latch_pts_us;        // timed frame waiting for its present time
+    int64_t latch_present_ns;    // 0 if none
+    int64_t latency_sum_us;      // queue_input → release_output
+    int64_t latency_max_us;
+} mock_decoder;
+
+extern const mirror_decoder_ops mock_decoder_ops;
+
+void mock_decoder_default_config(mock_decoder_config *cfg);
+void mock_decoder_init(mock_decoder *d, const mock_decoder_config *cfg);
+void mock_decoder_free(mock_decoder *d);
+// Inputs queued from now on never decode until the stall is cleared.
+void mock_decoder_stall(mock_decoder *d, mock_stall stall);
+
+#endif
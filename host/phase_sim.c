@@ -0,0 +1,129 @@
+// phase_sim.c — Capture tick phase vs a drifting receiver display; see phase_sim.h.
+
+#include "phase_sim.h"
+#include "phase_ctl.h"
+#include "host_util.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARMUP_US 1000000
+#define MAX_REPORTS 256
+
+void phase_sim_default_config(phase_sim_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->fps = 120;
+    cfg->refresh_hz = 60;
+    cfg->drift_ppm = 50;
+    cfg->pipeline_us = 6000;
+    cfg->pipeline_jitter_us = 1500;
+    cfg->link_us = 1000;
+    cfg->link_jitter_us = 300;
+    cfg->decode_us = 3000;
+    cfg->lead_us = 2000;
+    cfg->seed = 1;
+}
+
+static int64_t jitter(uint64_t *rng, int64_t max) {
+    return max > 0 ? (int64_t)(rng_next(rng) % (uint64_t)(max + 1)) : 0;
+}
+
+typedef struct {
+    int64_t at_us;              // reaches the sender
+    uint32_t seq;
+    uint32_t arrival_to_latch_us;
+    uint32_t slack_us;
+    uint32_t period_us;
+} sim_report;
+
+int phase_sim_run(const phase_sim_config *cfg, double seconds, phase_sim_result *out) {
+    memset(out, 0, sizeof(*out));
+    size_t max_frames = (size_t)(seconds * cfg->fps) + 2;
+    double *g2g = (double *)malloc(max_frames * sizeof(double));
+    if (!g2g) return -1;
+
+    phase_config pc;
+    phase_config_default(&pc, cfg->fps);
+    phase_ctl ctl;
+    phase_ctl_init(&ctl, &pc);
+
+    // Receiver time = sender time × rate; its vsyncs sit at v0 + k × period.
+    double rate = 1 + cfg->drift_ppm * 1e-6;
+    double period_r = 1e6 / cfg->refresh_hz;
+    uint64_t rng = cfg->seed ^ 0x9E3779B97F4A7C15ULL;
+    double v0 = (double)(rng_next(&rng) % 1000) / 1000.0 * period_r;
+
+    sim_report reports[MAX_REPORTS];
+    unsigned head = 0, tail = 0;
+    int64_t end_us = (int64_t)(seconds * 1e6), lock_us = 0;
+    double wait_sum = 0;
+    size_t n_shown = 0;
+
+    // The newest frame released for a vsync is only shown once a later frame
+    // targets a later vsync (or the run ends).
+    int64_t prev_vsync = -1;
+    double prev_g2g = 0, prev_wait = 0;
+    int prev_measured = 0;
+
+    uint32_t seq = 0;
+    for (int64_t tick = 0; tick < end_us; seq++) {
+        while (head != tail && reports[head % MAX_REPORTS].at_us <= tick) {
+            const sim_report *rep = &reports[head++ % MAX_REPORTS];
+            phase_ctl_on_report(&ctl, rep->seq, rep->arrival_to_latch_us, rep->slack_us, rep->period_us,
+                                cfg->link_us);
+            if (!lock_us && phase_ctl_locked(&ctl)) lock_us = tick;
+        }
+        out->frames++;
+
+        int64_t send = tick + cfg->pipeline_us + jitter(&rng, cfg->pipeline_jitter_us);
+        phase_ctl_on_send(&ctl, seq, tick, send);
+        int64_t arrival = send + cfg->link_us + jitter(&rng, cfg->link_jitter_us);
+        double arrival_r = arrival * rate;
+        double ready_r = arrival_r + cfg->decode_us;
+        int64_t k = (int64_t)ceil((ready_r + cfg->lead_us - v0) / period_r);
+        double vsync_r = v0 + k * period_r;
+        double latch_r = vsync_r - cfg->lead_us;
+
+        if (k != prev_vsync && prev_measured) {
+            g2g[n_shown++] = prev_g2g;
+            wait_sum += prev_wait;
+        }
+        prev_vsync = k;
+        prev_g2g = (vsync_r / rate - tick) / 1000.0;
+        prev_wait = (latch_r - ready_r) / 1000.0;
+        prev_measured = tick >= WARMUP_US;
+
+        if (tail - head < MAX_REPORTS) {
+            sim_report *rep = &reports[tail++ % MAX_REPORTS];
+            rep->at_us = (int64_t)(ready_r / rate) + cfg->link_us + jitter(&rng, cfg->link_jitter_us);
+            rep->seq = seq;
+            rep->arrival_to_latch_us = (uint32_t)llround(latch_r - arrival_r);
+            rep->slack_us = (uint32_t)llround(latch_r - ready_r);
+            rep->period_us = (uint32_t)llround(period_r);
+        }
+
+        int64_t next = cfg->locked ? phase_ctl_next_tick(&ctl, tick) : 0;
+        tick = next ? next : tick + pc.tick_us;
+    }
+    if (prev_measured) {
+        g2g[n_shown++] = prev_g2g;
+        wait_sum += prev_wait;
+    }
+
+    out->shown = n_shown;
+    if (n_shown) {
+        double sum = 0;
+        for (size_t i = 0; i < n_shown; i++) sum += g2g[i];
+        out->g2g_avg_ms = sum / n_shown;
+        out->wait_avg_ms = wait_sum / n_shown;
+        out->g2g_p95_ms = percentile(g2g, n_shown, 0.95);
+    }
+    if (cfg->locked && lock_us) out->lock_ms = lock_us / 1000.0;
+    if (ctl.reports) {
+        double actual = period_r / rate;
+        out->period_err_ppm = (ctl.period_us - actual) / actual * 1e6;
+    }
+    free(g2g);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// phase_sim.h — Sender capture ticks against a receiver display on its own clock.
+//
+// The sender captures on ticks of its clock; each frame takes a jittery
+// pipeline (composite + encode) and link delay to reach the receiver, decodes,
+// and is released for the first vsync at least lead_us away, as
+// mirror_receiver.c does. The receiver clock runs drift_ppm fast and starts at
+// a random phase. Reports of every shown frame travel back over the link to a
+// phase_ctl, which steers the ticks when `locked` is set; otherwise they run
+// free at the capture rate.
+//
+// Glass-to-glass here is capture tick → the vsync the frame is shown at, in
+// sender time: the part of the path the tick phase can change. Seeded and
+// deterministic (tools/mirror_phasesim.c).
+
+#ifndef PHASE_SIM_H
+#define PHASE_SIM_H
+
+#include <stdint.h>
+
+typedef struct {
+    double fps;                 // sender capture rate
+    double refresh_hz;          // receiver display
+    double drift_ppm;           // receiver clock rate error
+    int64_t pipeline_us;        // capture → send
+    int64_t pipeline_jitter_us; // plus uniform 0..jitter
+    int64_t link_us;            // one way, each direction
+    int64_t link_jitter_us;
+    int64_t decode_us;
+    int64_t lead_us;            // receiver release lead before the vsync
+    int locked;                 // steer ticks with phase_ctl
+    uint64_t seed;
+} phase_sim_config;
+
+typedef struct {
+    uint64_t frames;            // captured
+    uint64_t shown;             // presented (not superseded), after warm-up
+    double wait_avg_ms;         // ready at the receiver → latch deadline
+    double g2g_avg_ms;          // capture → vsync shown
+    double g2g_p95_ms;
+    double lock_ms;             // time to lock, 0 if free-running or never locked
+    double period_err_ppm;      // tracked period vs the receiver's, in sender time
+} phase_sim_result;
+
+void phase_sim_default_config(phase_sim_config *cfg);
+
+// Simulate `seconds` of capture; the first second is warm-up and not measured.
+// Returns 0, or -1 if out of memory.
+int phase_sim_run(const phase_sim_config *cfg, double seconds, phase_sim_result *out);
+
+#endif
@@ -0,0 +1,528 @@
+// sender_server.c — Multi-client frame server with keyframe cache and ACK tracking.
+
+#include "sender_server.h"
+#include "framing.h"
+#include "host_util.h"
+#include "mirror_codec.h"
+#include "mirror_protocol.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+int sender_backpressure_threshold(double rtt_ms) {
+    int t = (int)(120.0 / (rtt_ms > 1.0 ? rtt_ms : 1.0));
+    if (t > 6) t = 6;
+    if (t < 2) t = 2;
+    return t;
+}
+
+// MARK: - ACK tracking
+
+static void reset_tracking(sender_server *s) {
+    pthread_mutex_lock(&s->rtt_lock);
+    send_ring_reset(&s->seq_ring);
+    bdp_ctl_reset(&s->backpressure);
+    pthread_mutex_unlock(&s->rtt_lock);
+}
+
+static void track_send(sender_server *s, uint32_t seq, size_t len, uint8_t flags) {
+    int64_t now = mirror_now_us();
+    pthread_mutex_lock(&s->rtt_lock);
+    send_ring_record(&s->seq_ring, seq, now);
+    bdp_ctl_on_send(&s->backpressure, seq, (uint32_t)len, (flags & FLAG_KEYFRAME) != 0, now);
+    pthread_mutex_unlock(&s->rtt_lock);
+}
+
+static void track_ack(sender_server *s, uint32_t seq) {
+    int64_t now = mirror_now_us();
+    int64_t sent_us;
+    pthread_mutex_lock(&s->rtt_lock);
+    bdp_ctl_on_ack(&s->backpressure, seq, now);
+    if (send_ring_ack(&s->seq_ring, seq, &sent_us)) {
+        s->rtt_ms[s->rtt_next] = (now - sent_us) / 1000.0;
+        s->rtt_next = (s->rtt_next + 1) % SENDER_RTT_WINDOW;
+        if (s->rtt_count < SENDER_RTT_WINDOW) s->rtt_count++;
+        s->acks++;
+    }
+    pthread_mutex_unlock(&s->rtt_lock);
+}
+
+// A receiver asked for a keyframe (decoder watchdog recovery) or listed the
+// codecs it decodes; this sender only streams greyscale, so the list is just
+// logged. Must be called with s->lock held.
+static void note_upstream_command(sender_server *s, uint8_t cmd, uint8_t value) {
+    if (cmd == CMD_CODECS) {
+        uint8_t ids[MIRROR_MAX_CODECS];
+        int n = mirror_codecs_unpack(value, ids);
+        fprintf(stderr, "Receiver decodes:");
+        for (int i = 0; i < n; i++) {
+            const mirror_codec_info *c = mirror_codec_get(ids[i]);
+            fprintf(stderr, " %s", c ? c->name : "?");
+        }
+        fprintf(stderr, "%s\n", n ? "" : " (none)");
+        return;
+    }
+    if (cmd != CMD_REQUEST_KEYFRAME) return;
+    if (!s->keyframe_wanted) fprintf(stderr, "Receiver requested a keyframe\n");
+    s->keyframe_wanted = 1;
+}
+
+// Feed received bytes through the client's upstream assembler: 6-byte ACKs and
+// 4-byte commands, resyncing on garbage the same way TCPServer.parseAckData does.
+// Must be called with s->lock held.
+static void parse_acks(sender_server *s, sender_client *c, const uint8_t *data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (c->ack_len == 0 && data[i] != MAGIC_FRAME_0) continue;
+        if (c->ack_len == 1 && data[i] != MAGIC_ACK_1 && data[i] != MAGIC_CMD_1) {
+            c->ack_len = data[i] == MAGIC_FRAME_0 ? 1 : 0;
+            continue;
+        }
+        c->ack_buf[c->ack_len++] = data[i];
+        if (c->ack_buf[1] == MAGIC_CMD_1 && c->ack_len == CMD_SIZE) {
+            note_upstream_command(s, c->ack_buf[2], c->ack_buf[3]);
+            c->ack_len = 0;
+        } else if (c->ack_len == ACK_SIZE) {
+            track_ack(s, read_le32(c->ack_buf + 2));
+            c->ack_len = 0;
+        }
+    }
+}
+
+// MARK: - Connections
+
+// Must be called with s->lock held.
+static int sendv_locked(sender_client *c, const struct iovec *iov, int iovcnt) {
+    if (c->dead) return -1;
+    if (iov_send_all(c->fd, iov, iovcnt) < 0) {
+        c->dead = 1;
+        shutdown(c->fd, SHUT_RDWR);
+        return -1;
+    }
+    return 0;
+}
+
+static int send_locked(sender_client *c, const void *buf, size_t n) {
+    struct iovec iov = { (void *)buf, n };
+    return sendv_locked(c, &iov, 1);
+}
+
+static void add_client(sender_server *s, int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    // Bound how long a stalled receiver can block the encode loop.
+    struct timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    pthread_mutex_lock(&s->lock);
+    if (s->n_clients == SENDER_MAX_CLIENTS) {
+        pthread_mutex_unlock(&s->lock);
+        fprintf(stderr, "[TCP] Too many clients, rejecting\n");
+        close(fd);
+        return;
+    }
+    sender_client *c = &s->clients[s->n_clients++];
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    reset_tracking(s);
+
+    // Tell the client our frame dimensions and display state before any frames
+    uint8_t res[RESOLUTION_CMD_SIZE];
+    encode_resolution(res, s->width, s->height);
+    send_locked(c, res, sizeof(res));
+    if (s->brightness >= 0) {
+        uint8_t cmd[CMD_SIZE];
+        encode_command(cmd, CMD_BRIGHTNESS, (uint8_t)s->brightness);
+        send_locked(c, cmd, sizeof(cmd));
+    }
+    if (s->keyframe_len > 0) {
+        send_locked(c, s->keyframe, s->keyframe_len);
+        fprintf(stderr, "[TCP] Client connected, sent cached keyframe (%zu bytes)\n", s->keyframe_len);
+    } else {
+        fprintf(stderr, "[TCP] Client connected, no cached keyframe yet\n");
+    }
+    s->keyframe_wanted = 1;
+    int count = s->n_clients;
+    pthread_mutex_unlock(&s->lock);
+    fprintf(stderr, "[TCP] %d client(s)\n", count);
+}
+
+// Must be called with s->lock held.
+static void remove_client_locked(sender_server *s, int i) {
+    close(s->clients[i].fd);
+    s->clients[i] = s->clients[--s->n_clients];
+    fprintf(stderr, "[TCP] Client disconnected, %d left\n", s->n_clients);
+}
+
+static void *server_thread(void *arg) {
+    sender_server *s = (sender_server *)arg;
+    struct pollfd pfds[SENDER_MAX_CLIENTS + 1];
+    int fds[SENDER_MAX_CLIENTS];
+
+    while (s->running) {
+        pthread_mutex_lock(&s->lock);
+        for (int i = s->n_clients - 1; i >= 0; i--) {
+            if (s->clients[i].dead) remove_client_locked(s, i);
+        }
+        int n = s->n_clients;
+        for (int i = 0; i < n; i++) {
+            fds[i] = s->clients[i].fd;
+            pfds[i + 1] = (struct pollfd){ fds[i], POLLIN, 0 };
+        }
+        pthread_mutex_unlock(&s->lock);
+        pfds[0] = (struct pollfd){ s->listen_fd, POLLIN, 0 };
+
+        int pr = poll(pfds, (nfds_t)n + 1, 100);
+        if (pr <= 0) continue;
+
+        if (pfds[0].revents & POLLIN) {
+            int fd = accept(s->listen_fd, NULL, NULL);
+            if (fd >= 0) add_client(s, fd);
+        }
+
+        // Only this thread closes client fds, so fds[] is still valid here.
+        for (int i = 0; i < n; i++) {
+            if (!pfds[i + 1].revents) continue;
+            uint8_t buf[4096];
+            ssize_t r = recv(fds[i], buf, sizeof(buf), MSG_DONTWAIT);
+            if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+
+            pthread_mutex_lock(&s->lock);
+            for (int j = 0; j < s->n_clients; j++) {
+                if (s->clients[j].fd != fds[i]) continue;
+                if (r <= 0) remove_client_locked(s, j);
+                else parse_acks(s, &s->clients[j], buf, (size_t)r);
+                break;
+            }
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+    return NULL;
+}
+
+// MARK: - Public API
+
+int sender_server_start(sender_server *s, int port, uint16_t width, uint16_t height) {
+    memset(s, 0, sizeof(*s));
+    s->width = width;
+    s->height = height;
+    s->brightness = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_mutex_init(&s->rtt_lock, NULL);
+
+    s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (s->listen_fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(s->listen_fd, 4) < 0) {
+        perror("bind/listen");
+        close(s->listen_fd);
+        return -1;
+    }
+    socklen_t addr_len = sizeof(addr);
+    getsockname(s->listen_fd, (struct sockaddr *)&addr, &addr_len);
+    s->port = ntohs(addr.sin_port);
+    bdp_config bp;
+    bdp_config_default(&bp);
+    if (send_ring_init(&s->seq_ring, SENDER_SEQ_SLOTS) < 0) {
+        close(s->listen_fd);
+        return -1;
+    }
+    if (bdp_ctl_init(&s->backpressure, &bp) < 0) {
+        send_ring_free(&s->seq_ring);
+        close(s->listen_fd);
+        return -1;
+    }
+
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, server_thread, s) != 0) {
+        bdp_ctl_free(&s->backpressure);
+        send_ring_free(&s->seq_ring);
+        close(s->listen_fd);
+        return -1;
+    }
+    s->thread_started = 1;
+    fprintf(stderr, "TCP server on tcp://localhost:%d\n", s->port);
+    return 0;
+}
+
+void sender_server_stop(sender_server *s) {
+    s->running = 0;
+    if (s->thread_started) {
+        pthread_join(s->thread, NULL);
+        s->thread_started = 0;
+    }
+    if (s->shm_thread_started) {
+        shm_link_close(s->shm);
+        pthread_join(s->shm_thread, NULL);
+        s->shm_thread_started = 0;
+    }
+    free(s->frame_buf);
+    s->frame_buf = NULL;
+    for (int i = 0; i < s->n_clients; i++) close(s->clients[i].fd);
+    s->n_clients = 0;
+    if (s->listen_fd >= 0) close(s->listen_fd);
+    s->listen_fd = -1;
+    free(s->keyframe);
+    s->keyframe = NULL;
+    send_ring_free(&s->seq_ring);
+    bdp_ctl_free(&s->backpressure);
+    pthread_mutex_destroy(&s->lock);
+    pthread_mutex_destroy(&s->rtt_lock);
+}
+
+int sender_server_client_count(sender_server *s) {
+    pthread_mutex_lock(&s->lock);
+    int n = 0;
+    for (int i = 0; i < s->n_clients; i++) n += !s->clients[i].dead;
+    n += s->shm_connected || s->shm_join_pending;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
+
+int sender_server_wait_for_client(sender_server *s) {
+    while (s->running) {
+        if (sender_server_client_count(s) > 0) return 1;
+        sleep_until_us(mirror_now_us() + 10000);
+    }
+    return 0;
+}
+
+// Must be called with s->lock held.
+static void cache_keyframe_locked(sender_server *s, const uint8_t *hdr, const uint8_t *payload,
+                                  size_t len) {
+    size_t total = FRAME_HEADER_SIZE + len;
+    if (total > s->keyframe_capacity) {
+        uint8_t *buf = (uint8_t *)realloc(s->keyframe, total);
+        if (!buf) return;
+        s->keyframe = buf;
+        s->keyframe_capacity = total;
+    }
+    memcpy(s->keyframe, hdr, FRAME_HEADER_SIZE);
+    memcpy(s->keyframe + FRAME_HEADER_SIZE, payload, len);
+    s->keyframe_len = total;
+}
+
+// MARK: - Shared memory
+
+// Must be called with s->lock held. Only the encode thread writes to the ring.
+static int shm_write_locked(sender_server *s, const struct iovec *iov, int iovcnt) {
+    if (!s->shm_connected) return -1;
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+    uint8_t *p = shm_ring_reserve(&s->shm->down, total);
+    if (!p) {
+        s->shm_connected = 0;
+        return -1;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+    shm_ring_commit(&s->shm->down, total);
+    return 0;
+}
+
+static int shm_send_locked(sender_server *s, const void *buf, size_t n) {
+    struct iovec iov = { (void *)buf, n };
+    return shm_write_locked(s, &iov, 1);
+}
+
+// Greet a newly attached receiver the way add_client() greets a TCP one.
+// Must be called with s->lock held, from the encode thread.
+static void shm_join_locked(sender_server *s) {
+    if (!s->shm_join_pending) return;
+    s->shm_join_pending = 0;
+    s->shm_connected = 1;
+    reset_tracking(s);
+
+    uint8_t res[RESOLUTION_CMD_SIZE];
+    encode_resolution(res, s->width, s->height);
+    shm_send_locked(s, res, sizeof(res));
+    if (s->brightness >= 0) {
+        uint8_t cmd[CMD_SIZE];
+        encode_command(cmd, CMD_BRIGHTNESS, (uint8_t)s->brightness);
+        shm_send_locked(s, cmd, sizeof(cmd));
+    }
+    if (s->keyframe_len > 0) shm_send_locked(s, s->keyframe, s->keyframe_len);
+    s->keyframe_wanted = 1;
+    fprintf(stderr, "[SHM] Receiver attached\n");
+}
+
+// Waits for the receiver, then reads its ACKs until the link closes.
+static void *shm_ack_thread(void *arg) {
+    sender_server *s = (sender_server *)arg;
+    while (s->running && !shm_link_wait_attached(s->shm, 100)) {
+    }
+    if (!s->running) return NULL;
+    pthread_mutex_lock(&s->lock);
+    s->shm_join_pending = 1;
+    pthread_mutex_unlock(&s->lock);
+
+    // The receiver writes whole packets, so the magic says how much follows.
+    uint8_t pkt[ACK_SIZE];
+    while (shm_ring_read(&s->shm->up, pkt, 2) == 0) {
+        if (pkt[0] != MAGIC_FRAME_0) continue;
+        if (pkt[1] == MAGIC_ACK_1) {
+            if (shm_ring_read(&s->shm->up, pkt + 2, ACK_SIZE - 2) < 0) break;
+            track_ack(s, read_le32(pkt + 2));
+        } else if (pkt[1] == MAGIC_CMD_1) {
+            if (shm_ring_read(&s->shm->up, pkt + 2, CMD_SIZE - 2) < 0) break;
+            pthread_mutex_lock(&s->lock);
+            note_upstream_command(s, pkt[2], pkt[3]);
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+    pthread_mutex_lock(&s->lock);
+    s->shm_connected = s->shm_join_pending = 0;
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+int sender_server_attach_shm(sender_server *s, shm_link *link) {
+    s->shm = link;
+    if (pthread_create(&s->shm_thread, NULL, shm_ack_thread, s) != 0) {
+        s->shm = NULL;
+        return -1;
+    }
+    s->shm_thread_started = 1;
+    char path[64];
+    shm_link_path(link, path, sizeof(path));
+    fprintf(stderr, "SHM link at %s\n", path);
+    return 0;
+}
+
+// MARK: - Frames
+
+void sender_server_broadcast(sender_server *s, const uint8_t *payload, size_t len,
+                             uint8_t flags, uint32_t seq) {
+    uint8_t hdr[FRAME_HEADER_SIZE];
+    encode_frame_header(hdr, flags, seq, (uint32_t)len);
+
+    pthread_mutex_lock(&s->lock);
+    shm_join_locked(s);
+    if (flags & FLAG_KEYFRAME) cache_keyframe_locked(s, hdr, payload, len);
+    track_send(s, seq, len, flags);
+    // Header and payload leave in one sendmsg(): no concatenation copy, and with
+    // TCP_NODELAY no separate 11-byte segment ahead of every frame.
+    struct iovec iov[2] = { { hdr, sizeof(hdr) }, { (void *)payload, len } };
+    for (int i = 0; i < s->n_clients; i++) sendv_locked(&s->clients[i], iov, 2);
+    shm_write_locked(s, iov, 2);
+    pthread_mutex_unlock(&s->lock);
+}
+
+uint8_t *sender_server_frame_buffer(sender_server *s, size_t max_len) {
+    size_t total = FRAME_HEADER_SIZE + max_len;
+    pthread_mutex_lock(&s->lock);
+    shm_join_locked(s);
+    int use_ring = s->shm_connected;
+    pthread_mutex_unlock(&s->lock);
+
+    // Only this thread produces into the ring, so the reservation holds unlocked.
+    uint8_t *p = use_ring ? shm_ring_reserve(&s->shm->down, total) : NULL;
+    s->frame_in_ring = p != NULL;
+    if (use_ring && !p) {
+        pthread_mutex_lock(&s->lock);
+        s->shm_connected = 0;           // link closed (or frame larger than the ring)
+        pthread_mutex_unlock(&s->lock);
+    }
+    if (!p) {
+        if (total > s->frame_buf_capacity) {
+            uint8_t *buf = (uint8_t *)realloc(s->frame_buf, total);
+            if (!buf) return NULL;
+            s->frame_buf = buf;
+            s->frame_buf_capacity = total;
+        }
+        p = s->frame_buf;
+    }
+    s->frame_ptr = p;
+    return p + FRAME_HEADER_SIZE;
+}
+
+void sender_server_commit_frame(sender_server *s, size_t len, uint8_t flags, uint32_t seq) {
+    uint8_t *frame = s->frame_ptr;
+    size_t total = FRAME_HEADER_SIZE + len;
+    encode_frame_header(frame, flags, seq, (uint32_t)len);
+
+    pthread_mutex_lock(&s->lock);
+    if (flags & FLAG_KEYFRAME) cache_keyframe_locked(s, frame, frame + FRAME_HEADER_SIZE, len);
+    track_send(s, seq, len, flags);
+    struct iovec iov = { frame, total };
+    for (int i = 0; i < s->n_clients; i++) sendv_locked(&s->clients[i], &iov, 1);
+    if (s->frame_in_ring) shm_ring_commit(&s->shm->down, total);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void sender_server_send_command(sender_server *s, uint8_t cmd, uint8_t value) {
+    uint8_t pkt[CMD_SIZE];
+    encode_command(pkt, cmd, value);
+    pthread_mutex_lock(&s->lock);
+    if (cmd == CMD_BRIGHTNESS) s->brightness = value;
+    for (int i = 0; i < s->n_clients; i++) send_locked(&s->clients[i], pkt, sizeof(pkt));
+    shm_send_locked(s, pkt, sizeof(pkt));
+    pthread_mutex_unlock(&s->lock);
+}
+
+int sender_server_take_keyframe_request(sender_server *s) {
+    pthread_mutex_lock(&s->lock);
+    int wanted = s->keyframe_wanted;
+    s->keyframe_wanted = 0;
+    pthread_mutex_unlock(&s->lock);
+    return wanted;
+}
+
+int sender_server_inflight(sender_server *s) {
+    pthread_mutex_lock(&s->rtt_lock);
+    int n = (int)send_ring_inflight(&s->seq_ring);
+    pthread_mutex_unlock(&s->rtt_lock);
+    return n;
+}
+
+void sender_server_set_capture_fps(sender_server *s, double fps) {
+    pthread_mutex_lock(&s->rtt_lock);
+    s->backpressure.cfg.fps = fps;
+    pthread_mutex_unlock(&s->rtt_lock);
+}
+
+int sender_server_should_send(sender_server *s) {
+    pthread_mutex_lock(&s->rtt_lock);
+    int ok = bdp_ctl_should_send(&s->backpressure);
+    pthread_mutex_unlock(&s->rtt_lock);
+    return ok;
+}
+
+int sender_server_window_frames(sender_server *s) {
+    pthread_mutex_lock(&s->rtt_lock);
+    int n = bdp_ctl_window_frames(&s->backpressure);
+    pthread_mutex_unlock(&s->rtt_lock);
+    return n;
+}
+
+double sender_server_rtt_avg_ms(sender_server *s, double fallback_ms) {
+    pthread_mutex_lock(&s->rtt_lock);
+    double sum = 0;
+    for (int i = 0; i < s->rtt_count; i++) sum += s->rtt_ms[i];
+    double avg = s->rtt_count ? sum / s->rtt_count : fallback_ms;
+    pthread_mutex_unlock(&s->rtt_lock);
+    return avg;
+}
+
+uint64_t sender_server_acks(sender_server *s) {
+    pthread_mutex_lock(&s->rtt_lock);
+    uint64_t n = s->acks;
+    pthread_mutex_unlock(&s->rtt_lock);
+    return n;
+}
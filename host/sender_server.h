@@ -0,0 +1,121 @@
+// sender_server.h — TCP frame server for the Linux sender (TCPServer.swift equivalent).
+//
+// Listens on the protocol port, and for every receiver that connects:
+//   - sends the current resolution (and brightness, if one was set)
+//   - sends the cached last keyframe so the screen is not blank
+//   - asks the encoder for a fresh keyframe, since later deltas are relative to
+//     the newest frame rather than the cached one
+//   - reads ACKs, matching them to send times for RTT and inflight counts
+// A background thread accepts connections and reads ACKs; broadcast() is called
+// from the encode loop.
+//
+// A same-host receiver can also be served over a shared-memory link
+// (sender_server_attach_shm). It is treated like one more client; frames written
+// with sender_server_frame_buffer/commit_frame are then encoded straight into the
+// ring, so the payload is never copied on its way to the receiver.
+
+#ifndef SENDER_SERVER_H
+#define SENDER_SERVER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bdp_ctl.h"
+#include "send_ring.h"
+#include "shm_ring.h"
+
+#define SENDER_MAX_CLIENTS 8
+#define SENDER_SEQ_SLOTS 512        // send timestamps kept for RTT (power of two)
+#define SENDER_RTT_WINDOW 150       // samples in the RTT average (TCPServer: 150)
+
+typedef struct {
+    int fd;
+    int dead;                       // write failed; the server thread will close it
+    uint8_t ack_buf[6];
+    int ack_len;
+} sender_client;
+
+typedef struct {
+    int listen_fd;
+    int port;                       // bound port (useful when started with 0)
+    pthread_t thread;
+    int thread_started;
+    volatile int running;
+
+    pthread_mutex_t lock;           // clients, keyframe cache, socket writes
+    sender_client clients[SENDER_MAX_CLIENTS];
+    int n_clients;
+    uint16_t width;
+    uint16_t height;
+    int brightness;                 // re-sent on connect; -1 = never set
+    uint8_t *keyframe;              // last keyframe packet (header + payload)
+    size_t keyframe_len;
+    size_t keyframe_capacity;
+    int keyframe_wanted;            // a receiver joined or asked since the last keyframe
+
+    uint8_t *frame_buf;             // frame_buffer() memory when not lending ring space
+    size_t frame_buf_capacity;
+    uint8_t *frame_ptr;             // header of the frame being built
+    int frame_in_ring;
+
+    shm_link *shm;                  // shared-memory receiver, or NULL
+    int shm_join_pending;           // receiver attached; greet it from the encode thread
+    int shm_connected;
+    pthread_t shm_thread;
+    int shm_thread_started;
+
+    pthread_mutex_t rtt_lock;       // everything below
+    send_ring seq_ring;             // send time per seq; inflight is derived from it
+    bdp_ctl backpressure;           // skip decisions from the link's BDP
+    double rtt_ms[SENDER_RTT_WINDOW];
+    int rtt_count;
+    int rtt_next;
+    uint64_t acks;
+} sender_server;
+
+// Bind (port 0 = any free port) and start the server thread.
+// Returns 0 on success, -1 on error.
+int sender_server_start(sender_server *s, int port, uint16_t width, uint16_t height);
+void sender_server_stop(sender_server *s);
+
+int sender_server_client_count(sender_server *s);
+// Block until a receiver is connected or the server stops. Returns 1 if connected.
+int sender_server_wait_for_client(sender_server *s);
+
+// Send one frame to every client. Keyframes are cached for late joiners.
+void sender_server_broadcast(sender_server *s, const uint8_t *payload, size_t len,
+                             uint8_t flags, uint32_t seq);
+void sender_server_send_command(sender_server *s, uint8_t cmd, uint8_t value);
+
+// Zero-copy variant of broadcast(): returns room for a payload of up to max_len
+// bytes (ring space when a shared-memory receiver is connected), which the caller
+// fills and passes to commit_frame(). Call both from the encode thread; a buffer
+// that is not committed is simply reused by the next call.
+uint8_t *sender_server_frame_buffer(sender_server *s, size_t max_len);
+void sender_server_commit_frame(sender_server *s, size_t len, uint8_t flags, uint32_t seq);
+
+// Serve a receiver over `link` (not owned) in addition to TCP. Frames and
+// commands go to it once it has accepted; stop() closes the link.
+int sender_server_attach_shm(sender_server *s, shm_link *link);
+
+// True once after a receiver connects: the next frame should be a keyframe.
+int sender_server_take_keyframe_request(sender_server *s);
+
+// Frames sent but not yet ACKed.
+int sender_server_inflight(sender_server *s);
+// Average RTT over the last SENDER_RTT_WINDOW ACKs, or `fallback_ms` before any.
+double sender_server_rtt_avg_ms(sender_server *s, double fallback_ms);
+uint64_t sender_server_acks(sender_server *s);
+
+// Capture rate the backpressure window assumes (default 120).
+void sender_server_set_capture_fps(sender_server *s, double fps);
+// 1 if a delta frame fits in the bandwidth-delay-product window (bdp_ctl.h).
+int sender_server_should_send(sender_server *s);
+// That window in typical frames, for stats.
+int sender_server_window_frames(sender_server *s);
+
+// The fixed inflight limit used before bdp_ctl — same rule as
+// adaptiveBackpressureThreshold in ScreenCapture.swift: max(2, min(6, 120 / rtt)).
+int sender_backpressure_threshold(double rtt_ms);
+
+#endif
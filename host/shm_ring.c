@@ -0,0 +1,286 @@
+// shm_ring.c — memfd SPSC rings with futex wakeups (see shm_ring.h).
+
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x474E524Du          // "MRNG"
+#define SHM_UP_CAPACITY (64u << 10)
+#define SHM_SPIN 256                   // polls before sleeping on the futex
+
+// One page per ring. Producer- and consumer-written fields sit on separate
+// cache lines.
+struct shm_ring_ctl {
+    uint32_t magic;
+    uint32_t closed;
+    uint64_t capacity;
+    uint32_t attached;                  // down ring only: a receiver is reading
+
+    _Alignas(64) uint64_t head;         // bytes committed (producer)
+    uint32_t data_seq;                  // futex: bumped on every commit
+    uint32_t consumer_sleeping;
+
+    _Alignas(64) uint64_t tail;         // bytes released (consumer)
+    uint32_t space_seq;                 // futex: bumped on every release
+    uint32_t producer_sleeping;
+};
+
+static size_t page_size(void) {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void futex_wait(uint32_t *word, uint32_t seen) {
+    syscall(SYS_futex, word, FUTEX_WAIT, seen, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// MARK: - Mapping
+
+// Map `cap` bytes of the file at `off` twice, back to back, at `at`.
+static int map_twice(uint8_t *at, int fd, size_t off, size_t cap) {
+    if (mmap(at, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t)off) == MAP_FAILED ||
+        mmap(at + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t)off) == MAP_FAILED) {
+        return -1;
+    }
+    return 0;
+}
+
+// File layout: [down ctl page][down data][up ctl page][up data].
+static int map_link(shm_link *l, int fd, size_t down_cap, size_t up_cap) {
+    size_t page = page_size();
+    l->fd = fd;
+    l->map_size = page + 2 * down_cap + page + 2 * up_cap;
+    l->map = (uint8_t *)mmap(NULL, l->map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (l->map == MAP_FAILED) {
+        l->map = NULL;
+        return -1;
+    }
+    uint8_t *up_ctl = l->map + page + 2 * down_cap;
+    if (mmap(l->map, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        map_twice(l->map + page, fd, page, down_cap) < 0 ||
+        mmap(up_ctl, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             (off_t)(page + down_cap)) == MAP_FAILED ||
+        map_twice(up_ctl + page, fd, 2 * page + down_cap, up_cap) < 0) {
+        munmap(l->map, l->map_size);
+        l->map = NULL;
+        return -1;
+    }
+    l->down = (shm_ring){ (shm_ring_ctl *)l->map, l->map + page, down_cap, 0 };
+    l->up = (shm_ring){ (shm_ring_ctl *)up_ctl, up_ctl + page, up_cap, 0 };
+    return 0;
+}
+
+int shm_link_create(shm_link *l, size_t capacity) {
+    memset(l, 0, sizeof(*l));
+    l->fd = -1;
+    size_t page = page_size();
+    size_t down_cap = (capacity + page - 1) / page * page;
+    size_t up_cap = SHM_UP_CAPACITY < page ? page : SHM_UP_CAPACITY;
+
+    int fd = memfd_create("daylight-mirror", MFD_CLOEXEC);
+    if (fd < 0) {
+        perror("memfd_create");
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)(2 * page + down_cap + up_cap)) < 0 || map_link(l, fd, down_cap, up_cap) < 0) {
+        perror("shm link");
+        close(fd);
+        l->fd = -1;
+        return -1;
+    }
+    // ftruncate zero-filled the control pages.
+    l->down.ctl->capacity = down_cap;
+    l->up.ctl->capacity = up_cap;
+    __atomic_store_n(&l->up.ctl->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    __atomic_store_n(&l->down.ctl->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int shm_link_open_fd(shm_link *l, int fd) {
+    memset(l, 0, sizeof(*l));
+    l->fd = -1;
+    size_t page = page_size();
+    shm_ring_ctl down, up;
+    if (pread(fd, &down, sizeof(down), 0) != (ssize_t)sizeof(down) || down.magic != SHM_MAGIC ||
+        down.capacity == 0 || down.capacity % page != 0 ||
+        pread(fd, &up, sizeof(up), (off_t)(page + down.capacity)) != (ssize_t)sizeof(up) ||
+        up.magic != SHM_MAGIC || up.capacity == 0 || up.capacity % page != 0) {
+        fprintf(stderr, "shm link: not a Daylight Mirror ring\n");
+        return -1;
+    }
+    if (map_link(l, fd, down.capacity, up.capacity) < 0) {
+        perror("shm link");
+        l->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int shm_link_open_path(shm_link *l, const char *path) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (shm_link_open_fd(l, fd) < 0) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+void shm_link_free(shm_link *l) {
+    if (l->map) munmap(l->map, l->map_size);
+    if (l->fd >= 0) close(l->fd);
+    memset(l, 0, sizeof(*l));
+    l->fd = -1;
+}
+
+void shm_link_path(const shm_link *l, char *buf, size_t len) {
+    snprintf(buf, len, "/proc/%d/fd/%d", (int)getpid(), l->fd);
+}
+
+void shm_link_accept(shm_link *l) {
+    __atomic_store_n(&l->down.ctl->attached, 1, __ATOMIC_SEQ_CST);
+    // Sender waits for this on the down ring's space futex.
+    __atomic_fetch_add(&l->down.ctl->space_seq, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&l->down.ctl->space_seq);
+}
+
+int shm_link_wait_attached(shm_link *l, int timeout_ms) {
+    shm_ring_ctl *c = l->down.ctl;
+    int64_t waited_ms = 0;
+    while (!__atomic_load_n(&c->attached, __ATOMIC_SEQ_CST) && !__atomic_load_n(&c->closed, __ATOMIC_SEQ_CST)) {
+        if (timeout_ms >= 0 && waited_ms >= timeout_ms) break;
+        uint32_t seq = __atomic_load_n(&c->space_seq, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&c->attached, __ATOMIC_SEQ_CST)) break;
+        struct timespec ts = { 0, 10 * 1000000 };
+        syscall(SYS_futex, &c->space_seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+        waited_ms += 10;
+    }
+    return __atomic_load_n(&c->attached, __ATOMIC_SEQ_CST) != 0;
+}
+
+static void close_ring(shm_ring *r) {
+    shm_ring_ctl *c = r->ctl;
+    __atomic_store_n(&c->closed, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&c->data_seq, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&c->space_seq, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&c->data_seq);
+    futex_wake(&c->space_seq);
+}
+
+void shm_link_close(shm_link *l) {
+    if (!l->map) return;
+    close_ring(&l->down);
+    close_ring(&l->up);
+}
+
+// MARK: - Waiting
+
+static int is_closed(const shm_ring *r) {
+    return __atomic_load_n(&r->ctl->closed, __ATOMIC_SEQ_CST) != 0;
+}
+
+// Consumer: wait until `need` bytes past tail are committed.
+static int wait_data(shm_ring *r, uint64_t need) {
+    shm_ring_ctl *c = r->ctl;
+    uint64_t tail = c->tail;
+    for (;;) {
+        for (int i = 0; i < SHM_SPIN; i++) {
+            if (__atomic_load_n(&c->head, __ATOMIC_ACQUIRE) - tail >= need) return 0;
+            if (is_closed(r)) return -1;
+            cpu_relax();
+        }
+        uint32_t seq = __atomic_load_n(&c->data_seq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&c->consumer_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&c->head, __ATOMIC_SEQ_CST) - tail < need && !is_closed(r)) {
+            futex_wait(&c->data_seq, seq);
+        }
+        __atomic_store_n(&c->consumer_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Producer: wait until `n` bytes are free.
+static int wait_space(shm_ring *r, uint64_t n) {
+    shm_ring_ctl *c = r->ctl;
+    uint64_t head = c->head;
+    for (;;) {
+        for (int i = 0; i < SHM_SPIN; i++) {
+            if (is_closed(r)) return -1;
+            if (r->capacity - (head - __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE)) >= n) return 0;
+            cpu_relax();
+        }
+        uint32_t seq = __atomic_load_n(&c->space_seq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&c->producer_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (r->capacity - (head - __atomic_load_n(&c->tail, __ATOMIC_SEQ_CST)) < n && !is_closed(r)) {
+            futex_wait(&c->space_seq, seq);
+        }
+        __atomic_store_n(&c->producer_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+// MARK: - Ring operations
+
+uint8_t *shm_ring_reserve(shm_ring *r, size_t n) {
+    if (n > r->capacity || wait_space(r, n) < 0) return NULL;
+    return r->data + r->ctl->head % r->capacity;
+}
+
+void shm_ring_commit(shm_ring *r, size_t n) {
+    shm_ring_ctl *c = r->ctl;
+    __atomic_store_n(&c->head, c->head + n, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&c->data_seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&c->consumer_sleeping, __ATOMIC_SEQ_CST)) futex_wake(&c->data_seq);
+}
+
+int shm_ring_write(shm_ring *r, const void *buf, size_t n) {
+    uint8_t *p = shm_ring_reserve(r, n);
+    if (!p) return -1;
+    memcpy(p, buf, n);
+    shm_ring_commit(r, n);
+    return 0;
+}
+
+const uint8_t *shm_ring_peek(shm_ring *r, size_t n) {
+    if (r->held + n > r->capacity || wait_data(r, r->held + n) < 0) return NULL;
+    const uint8_t *p = r->data + (r->ctl->tail + r->held) % r->capacity;
+    r->held += n;
+    return p;
+}
+
+void shm_ring_release(shm_ring *r) {
+    if (r->held == 0) return;
+    shm_ring_ctl *c = r->ctl;
+    __atomic_store_n(&c->tail, c->tail + r->held, __ATOMIC_SEQ_CST);
+    r->held = 0;
+    __atomic_fetch_add(&c->space_seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&c->producer_sleeping, __ATOMIC_SEQ_CST)) futex_wake(&c->space_seq);
+}
+
+int shm_ring_read(shm_ring *r, void *buf, size_t n) {
+    const uint8_t *p = shm_ring_peek(r, n);
+    if (!p) return -1;
+    memcpy(buf, p, n);
+    shm_ring_release(r);
+    return 0;
+}
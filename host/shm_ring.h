@@ -0,0 +1,83 @@
+// shm_ring.h — memfd-backed SPSC byte rings for same-host sender/receiver runs.
+//
+// A shm_link is one memfd holding two single-producer/single-consumer rings:
+//   down — protocol stream, sender → receiver (same bytes as the TCP socket)
+//   up   — ACKs, receiver → sender
+// Each ring's data region is mapped twice back to back, so any run of up to
+// `capacity` bytes starting anywhere in the ring is contiguous in memory. That
+// lets the sender encode straight into ring space (shm_ring_reserve/commit) and
+// the receiver parse and decode straight out of it (shm_ring_peek/release):
+// frame bytes are never copied between the two.
+//
+// Head/tail are monotonic byte counters in a shared control page. Readers and
+// writers spin briefly, then sleep on a futex word the other side bumps, and only
+// issue FUTEX_WAKE when the peer has announced it is sleeping.
+//
+// The fd can be shared with another process through fork(), SCM_RIGHTS, or its
+// /proc/<pid>/fd/<n> path (shm_link_path), which is what the tools use.
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_LINK_DEFAULT_CAPACITY (32u << 20)   // down ring; up ring is 64 KB
+
+typedef struct shm_ring_ctl shm_ring_ctl;
+
+typedef struct {
+    shm_ring_ctl *ctl;
+    uint8_t *data;              // capacity bytes, mapped twice
+    uint64_t capacity;
+    uint64_t held;              // consumer: bytes peeked but not yet released
+} shm_ring;
+
+typedef struct {
+    int fd;
+    shm_ring down;
+    shm_ring up;
+    uint8_t *map;               // control pages + data, for unmapping
+    size_t map_size;
+} shm_link;
+
+// Create a link in a fresh memfd. `capacity` (down ring) is rounded up to pages.
+// Returns 0 on success, -1 on error.
+int shm_link_create(shm_link *l, size_t capacity);
+// Map an existing link from its fd or a path such as /proc/<pid>/fd/<n>.
+int shm_link_open_fd(shm_link *l, int fd);
+int shm_link_open_path(shm_link *l, const char *path);
+void shm_link_free(shm_link *l);
+// "/proc/<pid>/fd/<n>" for another process to open.
+void shm_link_path(const shm_link *l, char *buf, size_t len);
+
+// Receiver side: announce that someone is reading the down ring.
+void shm_link_accept(shm_link *l);
+// Sender side: block until a receiver accepted, or `timeout_ms` (-1 = forever).
+// Returns 1 if a receiver is attached.
+int shm_link_wait_attached(shm_link *l, int timeout_ms);
+// Mark both rings closed and wake every waiter. Either side may call it.
+void shm_link_close(shm_link *l);
+
+// MARK: - Ring operations
+//
+// All waiting calls return NULL / -1 once the ring is closed (after any bytes
+// still queued have been consumed).
+
+// Producer: n contiguous writable bytes (n <= capacity), waiting for space.
+uint8_t *shm_ring_reserve(shm_ring *r, size_t n);
+// Producer: publish the first n bytes of the last reservation.
+void shm_ring_commit(shm_ring *r, size_t n);
+// Producer: reserve + copy + commit.
+int shm_ring_write(shm_ring *r, const void *buf, size_t n);
+
+// Consumer: pointer to the next n bytes after anything already peeked (all of it
+// at most `capacity`), waiting for them. The bytes stay valid and unconsumed
+// until shm_ring_release().
+const uint8_t *shm_ring_peek(shm_ring *r, size_t n);
+// Consumer: hand back everything peeked so far.
+void shm_ring_release(shm_ring *r);
+// Consumer: peek + copy + release.
+int shm_ring_read(shm_ring *r, void *buf, size_t n);
+
+#endif
@@ -0,0 +1,557 @@
+// test_adb_client.c — adb smart-socket client against a stand-in adb server.
+
+#include "test_util.h"
+#include "adb_client.h"
+#include "host_util.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// MARK: - Stand-in server
+//
+// Serves one connection at a time the way the adb server does: host services
+// answer directly, host:transport* binds the connection to a device, and the
+// device's reverse: and shell: services answer after that. A host:track-devices
+// connection is kept open and gets the list again on every fake_set_devices().
+
+typedef struct {
+    int listen_fd;
+    int port;
+    pthread_t thread;
+    volatile int stop;
+    pthread_mutex_t lock;           // devices, track_fd
+    const char *devices;            // host:devices payload
+    int track_fd;                   // open host:track-devices subscriber, or -1
+    char reverses[512];             // "serial remote local\n" lines
+    int connections;
+    int silent;                     // accept but never answer
+    char last_service[256];
+} fake_adb;
+
+static int read_n(int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_str(int fd, const char *s) {
+    send(fd, s, strlen(s), MSG_NOSIGNAL);
+}
+
+static void send_payload(int fd, const char *s) {
+    char hex[5];
+    snprintf(hex, sizeof(hex), "%04x", (unsigned)strlen(s));
+    send_str(fd, hex);
+    send_str(fd, s);
+}
+
+static void send_fail(int fd, const char *msg) {
+    send_str(fd, "FAIL");
+    send_payload(fd, msg);
+}
+
+static int read_request(int fd, char *out, size_t cap) {
+    char hex[5] = {0};
+    if (read_n(fd, hex, 4) < 0) return -1;
+    size_t len = strtoul(hex, NULL, 16);
+    if (len >= cap) return -1;
+    if (read_n(fd, out, len) < 0) return -1;
+    out[len] = '\0';
+    return 0;
+}
+
+// Serial of the only device in state "device", or of `want` if it is one.
+static int find_device(const fake_adb *f, const char *want, char *serial, size_t cap) {
+    int matches = 0;
+    const char *p = f->devices;
+    while (*p) {
+        const char *tab = strchr(p, '\t'), *eol = strchr(p, '\n');
+        if (!tab || !eol) break;
+        size_t n = (size_t)(tab - p);
+        int ready = strncmp(tab + 1, "device\n", 7) == 0;
+        if (ready && (!want || (strlen(want) == n && strncmp(p, want, n) == 0))) {
+            if (n < cap) {
+                memcpy(serial, p, n);
+                serial[n] = '\0';
+            }
+            matches++;
+        }
+        p = eol + 1;
+    }
+    return matches;
+}
+
+static void remove_reverse(fake_adb *f, const char *serial, const char *remote, int *found) {
+    char needle[512];
+    snprintf(needle, sizeof(needle), "%s %s ", serial, remote);
+    char *line = strstr(f->reverses, needle);
+    *found = line != NULL;
+    if (!line) return;
+    char *eol = strchr(line, '\n');
+    memmove(line, eol + 1, strlen(eol + 1) + 1);
+}
+
+// Returns 1 if the connection stays open as a device-tracking subscription.
+static int serve(fake_adb *f, int fd) {
+    char req[256], serial[64] = "";
+    int bound = 0;
+    while (read_request(fd, req, sizeof(req)) == 0) {
+        snprintf(f->last_service, sizeof(f->last_service), "%s", req);
+        if (strcmp(req, "host:version") == 0) {
+            send_str(fd, "OKAY");
+            send_payload(fd, "0029");
+            return 0;
+        } else if (strcmp(req, "host:devices") == 0) {
+            pthread_mutex_lock(&f->lock);
+            send_str(fd, "OKAY");
+            send_payload(fd, f->devices);
+            pthread_mutex_unlock(&f->lock);
+            return 0;
+        } else if (strcmp(req, "host:track-devices") == 0) {
+            pthread_mutex_lock(&f->lock);
+            send_str(fd, "OKAY");
+            send_payload(fd, f->devices);
+            if (f->track_fd >= 0) close(f->track_fd);
+            f->track_fd = fd;
+            pthread_mutex_unlock(&f->lock);
+            return 1;
+        } else if (strncmp(req, "host:transport:", 15) == 0) {
+            if (find_device(f, req + 15, serial, sizeof(serial)) != 1) {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "device '%s' not found", req + 15);
+                send_fail(fd, msg);
+                return 0;
+            }
+            bound = 1;
+            send_str(fd, "OKAY");
+        } else if (strcmp(req, "host:transport-any") == 0) {
+            int n = find_device(f, NULL, serial, sizeof(serial));
+            if (n != 1) {
+                send_fail(fd, n ? "more than one device/emulator" : "no devices/emulators found");
+                return 0;
+            }
+            bound = 1;
+            send_str(fd, "OKAY");
+        } else if (bound && strncmp(req, "reverse:forward:", 16) == 0) {
+            char *spec = req + 16, *semi = strchr(spec, ';');
+            *semi = '\0';
+            int found;
+            remove_reverse(f, serial, spec, &found);   // rebinding replaces
+            size_t used = strlen(f->reverses);
+            snprintf(f->reverses + used, sizeof(f->reverses) - used, "%s %s %s\n", serial, spec, semi + 1);
+            send_str(fd, "OKAYOKAY");
+            return 0;
+        } else if (bound && strncmp(req, "reverse:killforward:", 20) == 0) {
+            int found;
+            remove_reverse(f, serial, req + 20, &found);
+            send_str(fd, "OKAY");
+            if (found) send_str(fd, "OKAY");
+            else send_fail(fd, "listener not found");
+            return 0;
+        } else if (bound && strcmp(req, "reverse:list-forward") == 0) {
+            send_str(fd, "OKAYOKAY");
+            send_payload(fd, f->reverses);
+            return 0;
+        } else if (bound && strncmp(req, "shell:", 6) == 0) {
+            send_str(fd, "OKAY");
+            if (strcmp(req + 6, "settings get system screen_brightness") == 0) {
+                send_str(fd, "128\n");
+            } else if (strcmp(req + 6, "yes") == 0) {
+                char block[1000];
+                memset(block, 'y', sizeof(block));
+                for (int i = 0; i < 10; i++) send(fd, block, sizeof(block), MSG_NOSIGNAL);
+            } else {
+                send_str(fd, req + 6);
+            }
+            return 0;
+        } else {
+            send_fail(fd, "unknown host service");
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static void *fake_thread(void *arg) {
+    fake_adb *f = (fake_adb *)arg;
+    while (!f->stop) {
+        int fd = accept(f->listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        f->connections++;
+        if (f->silent) {
+            while (!f->stop) sleep_until_us(mirror_now_us() + 1000);
+        } else if (serve(f, fd)) {
+            continue;
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+// `port` 0 picks a free one.
+static void fake_start_on(fake_adb *f, const char *devices, int port) {
+    memset(f, 0, sizeof(*f));
+    pthread_mutex_init(&f->lock, NULL);
+    f->devices = devices;
+    f->track_fd = -1;
+    f->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(f->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    CHECK_EQ(bind(f->listen_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    CHECK_EQ(listen(f->listen_fd, 4), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(f->listen_fd, (struct sockaddr *)&addr, &len);
+    f->port = ntohs(addr.sin_port);
+    pthread_create(&f->thread, NULL, fake_thread, f);
+}
+
+static void fake_start(fake_adb *f, const char *devices) {
+    fake_start_on(f, devices, 0);
+}
+
+// Like the adb server exiting: the listener and any subscription go away.
+static void fake_stop(fake_adb *f) {
+    f->stop = 1;
+    shutdown(f->listen_fd, SHUT_RDWR);
+    close(f->listen_fd);
+    pthread_join(f->thread, NULL);
+    if (f->track_fd >= 0) close(f->track_fd);
+    pthread_mutex_destroy(&f->lock);
+}
+
+static void fake_set_devices(fake_adb *f, const char *devices) {
+    pthread_mutex_lock(&f->lock);
+    f->devices = devices;
+    if (f->track_fd >= 0) send_payload(f->track_fd, devices);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static const char *const ONE_DEVICE = "DC1A0042\tdevice\n";
+static const char *const TWO_DEVICES = "emulator-5554\toffline\nDC1A0042\tdevice\nR5CT\tunauthorized\n";
+
+// MARK: - Tests
+
+static void test_parse_devices(void) {
+    adb_device d[2];
+    const char *text = "a\tdevice\r\nbad-line\n\nb\toffline\nc\tunauthorized";
+    CHECK_EQ(adb_parse_devices(text, strlen(text), d, 2), 3);
+    CHECK(strcmp(d[0].serial, "a") == 0 && strcmp(d[0].state, "device") == 0);
+    CHECK(strcmp(d[1].serial, "b") == 0 && strcmp(d[1].state, "offline") == 0);
+    CHECK_EQ(adb_parse_devices("", 0, d, 2), 0);
+
+    char longer[200];
+    memset(longer, 's', 100);
+    strcpy(longer + 100, "\tdevice\n");
+    CHECK_EQ(adb_parse_devices(longer, strlen(longer), d, 1), 1);
+    CHECK_EQ(strlen(d[0].serial), sizeof(d[0].serial) - 1);
+}
+
+static void test_port_from_environment(void) {
+    adb_client c;
+    unsetenv("ANDROID_ADB_SERVER_PORT");
+    adb_client_init(&c, 0);
+    CHECK_EQ(c.port, ADB_DEFAULT_PORT);
+    setenv("ANDROID_ADB_SERVER_PORT", "5038", 1);
+    adb_client_init(&c, 0);
+    CHECK_EQ(c.port, 5038);
+    adb_client_init(&c, 6000);
+    CHECK_EQ(c.port, 6000);
+    unsetenv("ANDROID_ADB_SERVER_PORT");
+}
+
+static void test_host_services(void) {
+    fake_adb f;
+    fake_start(&f, TWO_DEVICES);
+    adb_client c;
+    adb_client_init(&c, f.port);
+
+    CHECK_EQ(adb_client_version(&c), 41);
+    adb_device d[8];
+    CHECK_EQ(adb_client_devices(&c, d, 8), 3);
+    CHECK(strcmp(d[1].serial, "DC1A0042") == 0);
+    CHECK(strcmp(d[1].state, "device") == 0);
+    CHECK(strcmp(d[2].state, "unauthorized") == 0);
+    CHECK_EQ(f.connections, 2);   // one connection per request, like adb
+    fake_stop(&f);
+}
+
+static void test_reverse_tunnel(void) {
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    adb_client c;
+    adb_client_init(&c, f.port);
+
+    CHECK_EQ(adb_client_reverse(&c, NULL, "tcp:8888", "tcp:8888"), 0);
+    CHECK(strcmp(f.last_service, "reverse:forward:tcp:8888;tcp:8888") == 0);
+    CHECK_EQ(adb_client_reverse(&c, "DC1A0042", "tcp:9000", "tcp:9001"), 0);
+
+    char list[256];
+    int n = adb_client_reverse_list(&c, NULL, list, sizeof(list));
+    CHECK_EQ(n, (int)strlen(list));
+    CHECK(strstr(list, "DC1A0042 tcp:8888 tcp:8888\n") != NULL);
+    CHECK(strstr(list, "DC1A0042 tcp:9000 tcp:9001\n") != NULL);
+
+    CHECK_EQ(adb_client_reverse_remove(&c, NULL, "tcp:9000"), 0);
+    CHECK_EQ(adb_client_reverse_remove(&c, NULL, "tcp:9000"), -1);
+    CHECK(strcmp(c.error, "listener not found") == 0);
+    adb_client_reverse_list(&c, NULL, list, sizeof(list));
+    CHECK(strcmp(list, "DC1A0042 tcp:8888 tcp:8888\n") == 0);
+
+    // Truncated listing still drains the payload.
+    char tiny[8];
+    CHECK_EQ(adb_client_reverse_list(&c, NULL, tiny, sizeof(tiny)), 7);
+    CHECK(strcmp(tiny, "DC1A004") == 0);
+    fake_stop(&f);
+}
+
+static void test_transport_errors(void) {
+    fake_adb f;
+    fake_start(&f, "");
+    adb_client c;
+    adb_client_init(&c, f.port);
+    CHECK_EQ(adb_client_reverse(&c, NULL, "tcp:8888", "tcp:8888"), -1);
+    CHECK(strcmp(c.error, "no devices/emulators found") == 0);
+    fake_stop(&f);
+
+    fake_start(&f, TWO_DEVICES);
+    adb_client_init(&c, f.port);
+    char out[64];
+    CHECK_EQ(adb_client_shell(&c, "R5CT", "id", out, sizeof(out)), -1);
+    CHECK(strcmp(c.error, "device 'R5CT' not found") == 0);
+    CHECK_EQ(adb_client_shell(&c, "DC1A0042", "id", out, sizeof(out)), 2);
+    fake_stop(&f);
+}
+
+static void test_shell(void) {
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    adb_client c;
+    adb_client_init(&c, f.port);
+
+    char out[64];
+    CHECK_EQ(adb_client_shell(&c, NULL, "settings get system screen_brightness", out, sizeof(out)), 4);
+    CHECK(strcmp(out, "128\n") == 0);
+    CHECK(strcmp(f.last_service, "shell:settings get system screen_brightness") == 0);
+
+    // Output beyond the buffer is read and dropped, not left on the socket.
+    CHECK_EQ(adb_client_shell(&c, NULL, "yes", out, sizeof(out)), 63);
+    CHECK_EQ(out[62], 'y');
+    CHECK_EQ(out[63], '\0');
+    fake_stop(&f);
+}
+
+static void test_server_unreachable(void) {
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    int port = f.port;
+    fake_stop(&f);                // nothing listens there now
+
+    adb_client c;
+    adb_client_init(&c, port);
+    CHECK_EQ(adb_client_version(&c), -1);
+    CHECK(strstr(c.error, "cannot connect to adb server") != NULL);
+}
+
+static void test_timeout(void) {
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    f.silent = 1;
+    adb_client c;
+    adb_client_init(&c, f.port);
+    c.timeout_ms = 50;
+    int64_t t0 = mirror_now_us();
+    adb_device d[1];
+    CHECK_EQ(adb_client_devices(&c, d, 1), -1);
+    int64_t elapsed = mirror_now_us() - t0;
+    CHECK(elapsed >= 40000 && elapsed < 1000000);
+    fake_stop(&f);
+}
+
+// MARK: - Device tracking
+
+typedef struct {
+    pthread_mutex_t lock;
+    int events;
+    char serial[64];                // last reported, "" for none
+    int64_t at_us;                  // when it was reported
+} track_log;
+
+static void on_track(void *ctx, const char *serial) {
+    track_log *log = (track_log *)ctx;
+    pthread_mutex_lock(&log->lock);
+    log->events++;
+    snprintf(log->serial, sizeof(log->serial), "%s", serial ? serial : "");
+    log->at_us = mirror_now_us();
+    pthread_mutex_unlock(&log->lock);
+}
+
+static int wait_events(track_log *log, int n, int timeout_ms) {
+    int64_t deadline = mirror_now_us() + (int64_t)timeout_ms * 1000;
+    for (;;) {
+        pthread_mutex_lock(&log->lock);
+        int events = log->events;
+        pthread_mutex_unlock(&log->lock);
+        if (events >= n) return 1;
+        if (mirror_now_us() >= deadline) return 0;
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+}
+
+static void test_track_stream_parsing(void) {
+    fake_adb f;
+    fake_start(&f, "");
+    adb_client c;
+    adb_client_init(&c, f.port);
+    int fd = adb_client_track_open(&c);
+    CHECK(fd >= 0);
+    adb_device d[4];
+    CHECK_EQ(adb_client_track_next(&c, fd, d, 4), 0);          // initial, empty
+    fake_set_devices(&f, TWO_DEVICES);
+    CHECK_EQ(adb_client_track_next(&c, fd, d, 4), 3);
+    CHECK(strcmp(d[1].serial, "DC1A0042") == 0);
+    fake_stop(&f);
+    CHECK_EQ(adb_client_track_next(&c, fd, d, 4), -1);         // server went away
+    close(fd);
+}
+
+static void test_tracker_reports_changes_promptly(void) {
+    fake_adb f;
+    fake_start(&f, "emulator-5554\toffline\n");
+    track_log log = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    adb_tracker t;
+    adb_tracker_init(&t, f.port, on_track, &log);
+    CHECK_EQ(adb_tracker_start(&t), 0);
+    while (t.connections == 0) sleep_until_us(mirror_now_us() + 1000);
+    sleep_until_us(mirror_now_us() + 20000);
+    CHECK_EQ(log.events, 0);                                    // nothing ready yet
+
+    int64_t plugged = mirror_now_us();
+    fake_set_devices(&f, TWO_DEVICES);
+    CHECK(wait_events(&log, 1, 1000));
+    CHECK(strcmp(log.serial, "DC1A0042") == 0);
+    CHECK(log.at_us - plugged < 50000);                         // pushed, not polled
+
+    fake_set_devices(&f, ONE_DEVICE);                           // same ready device
+    fake_set_devices(&f, "DC1A0042\toffline\n");
+    CHECK(wait_events(&log, 2, 1000));
+    CHECK(strcmp(log.serial, "") == 0);
+    CHECK_EQ(log.events, 2);
+
+    int64_t t0 = mirror_now_us();
+    adb_tracker_stop(&t);                                       // unblocks the reader
+    CHECK(mirror_now_us() - t0 < 200000);
+    fake_stop(&f);
+}
+
+static void test_tracker_survives_server_restart(void) {
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    int port = f.port;
+    track_log log = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    adb_tracker t;
+    adb_tracker_init(&t, port, on_track, &log);
+    t.grace_ms = 1000;
+    CHECK_EQ(adb_tracker_start(&t), 0);
+    CHECK(wait_events(&log, 1, 1000));
+
+    // kill-server / start-server: down for ~200 ms, device still attached.
+    fake_stop(&f);
+    sleep_until_us(mirror_now_us() + 200000);
+    fake_start_on(&f, ONE_DEVICE, port);
+    int64_t deadline = mirror_now_us() + 2000000;
+    while (t.connections < 2 && mirror_now_us() < deadline) sleep_until_us(mirror_now_us() + 1000);
+    CHECK_EQ(t.connections, 2);
+    sleep_until_us(mirror_now_us() + 50000);
+    CHECK_EQ(log.events, 1);                                    // no disconnect flap
+
+    // Server gone for longer than the grace period: the device is gone too.
+    fake_stop(&f);
+    CHECK(wait_events(&log, 2, 3000));
+    CHECK(strcmp(log.serial, "") == 0);
+
+    // Back again: picked up after backoff (capped at max_backoff_ms).
+    fake_start_on(&f, ONE_DEVICE, port);
+    CHECK(wait_events(&log, 3, t.max_backoff_ms + 1000));
+    CHECK(strcmp(log.serial, "DC1A0042") == 0);
+    adb_tracker_stop(&t);
+    fake_stop(&f);
+}
+
+// The start_server hook: brings the stand-in server back on the same port.
+static fake_adb restarted;
+static int restart_port;
+static int64_t restarted_at_us;
+
+static void start_fake_server(void *ctx) {
+    (void)ctx;
+    restarted_at_us = mirror_now_us();
+    fake_start_on(&restarted, ONE_DEVICE, restart_port);
+}
+
+static void start_nothing(void *ctx) {
+    (void)ctx;
+}
+
+static void test_tracker_starts_a_killed_server(void) {
+    // `adb kill-server`: nothing listens until the tracker starts a server.
+    fake_adb f;
+    fake_start(&f, ONE_DEVICE);
+    restart_port = f.port;
+    fake_stop(&f);
+
+    track_log log = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    adb_tracker t;
+    adb_tracker_init(&t, restart_port, on_track, &log);
+    t.grace_ms = 300;
+    t.start_server = start_fake_server;
+    int64_t t0 = mirror_now_us();
+    CHECK_EQ(adb_tracker_start(&t), 0);
+    CHECK(wait_events(&log, 1, 2000));
+    CHECK(strcmp(log.serial, "DC1A0042") == 0);
+    CHECK_EQ(t.server_starts, 1);
+    CHECK(restarted_at_us - t0 >= 300000);                      // not before the grace period
+    sleep_until_us(mirror_now_us() + 50000);
+    CHECK_EQ(t.server_starts, 1);                               // reachable: left alone
+    adb_tracker_stop(&t);
+    fake_stop(&restarted);
+
+    // A start that does not take is retried at the capped backoff, not in a loop.
+    adb_tracker_init(&t, restart_port, NULL, NULL);
+    t.grace_ms = 100;
+    t.max_backoff_ms = 200;
+    t.start_server = start_nothing;
+    CHECK_EQ(adb_tracker_start(&t), 0);
+    sleep_until_us(mirror_now_us() + 1000000);
+    adb_tracker_stop(&t);
+    CHECK(t.server_starts >= 3 && t.server_starts <= 6);
+}
+
+int main(void) {
+    RUN_TEST(test_parse_devices);
+    RUN_TEST(test_port_from_environment);
+    RUN_TEST(test_host_services);
+    RUN_TEST(test_reverse_tunnel);
+    RUN_TEST(test_transport_errors);
+    RUN_TEST(test_shell);
+    RUN_TEST(test_server_unreachable);
+    RUN_TEST(test_timeout);
+    RUN_TEST(test_track_stream_parsing);
+    RUN_TEST(test_tracker_reports_changes_promptly);
+    RUN_TEST(test_tracker_survives_server_restart);
+    RUN_TEST(test_tracker_starts_a_killed_server);
+    return TEST_EXIT();
+}
@@ -0,0 +1,206 @@
+// test_backpressure.c — BDP controller estimates and window, and the link
+// simulator it is judged on.
+
+#include "test_util.h"
+#include "bdp_ctl.h"
+#include "link_sim.h"
+#include "loadgen.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PERIOD_US 8333      // 120 fps
+
+static void init_ctl(bdp_ctl *c) {
+    bdp_config cfg;
+    bdp_config_default(&cfg);
+    CHECK_EQ(bdp_ctl_init(c, &cfg), 0);
+}
+
+// MARK: - Controller
+
+static void test_cold_window(void) {
+    bdp_ctl c;
+    init_ctl(&c);
+    CHECK(bdp_ctl_should_send(&c));
+    CHECK_EQ(bdp_ctl_bandwidth(&c), 0);
+    bdp_ctl_on_send(&c, 0, 10000, 0, 0);
+    CHECK_EQ(bdp_ctl_window_frames(&c), c.cfg.cold_frames);
+    CHECK_EQ((int64_t)bdp_ctl_window_bytes(&c), c.cfg.cold_frames * 10000);
+    bdp_ctl_free(&c);
+}
+
+static void test_steady_stream_estimates(void) {
+    // 10 KB every frame, each ACKed 5 ms after it was sent.
+    bdp_ctl c;
+    init_ctl(&c);
+    for (uint32_t seq = 0; seq < 600; seq++) {
+        int64_t t = (int64_t)seq * PERIOD_US;
+        if (seq > 0) CHECK_EQ(bdp_ctl_on_ack(&c, seq - 1, t - PERIOD_US + 5000), 1);
+        bdp_ctl_on_send(&c, seq, 10000, 0, t);
+    }
+    CHECK_EQ(bdp_ctl_min_rtt_us(&c), 5000);
+    // The first frame found an idle pipe: 10 KB delivered in its 5 ms RTT. The
+    // steady stream after it is app-limited (1.2 MB/s), so it cannot lower that.
+    CHECK(fabs(bdp_ctl_bandwidth(&c) - 2e6) < 1);
+    CHECK(fabs(bdp_ctl_frame_rate(&c) - 200) < 0.01);
+    // One frame in a 5 ms pipe at 120 fps, plus one: 2 frames.
+    CHECK_EQ(bdp_ctl_window_frames(&c), 2);
+    CHECK_EQ(bdp_ctl_inflight(&c), 1);
+    CHECK(bdp_ctl_should_send(&c));
+    bdp_ctl_on_send(&c, 600, 10000, 0, 600 * PERIOD_US);
+    CHECK(!bdp_ctl_should_send(&c));
+    CHECK_EQ(bdp_ctl_on_ack(&c, 600, 600 * PERIOD_US + 5000), 1);
+    CHECK_EQ(bdp_ctl_on_ack(&c, 600, 600 * PERIOD_US + 5000), 0);   // duplicate
+    bdp_ctl_free(&c);
+}
+
+static void test_keyframe_holds_back_deltas(void) {
+    bdp_ctl c;
+    init_ctl(&c);
+    for (uint32_t seq = 0; seq < 50; seq++) {
+        int64_t t = (int64_t)seq * PERIOD_US;
+        if (seq > 0) bdp_ctl_on_ack(&c, seq - 1, t - PERIOD_US + 3000);
+        bdp_ctl_on_send(&c, seq, 5000, 0, t);
+    }
+    bdp_ctl_on_ack(&c, 49, 49 * PERIOD_US + 3000);
+    CHECK_EQ(bdp_ctl_inflight(&c), 0);
+
+    // A keyframe 40x the typical delta fills the window on its own...
+    bdp_ctl_on_send(&c, 50, 200000, 1, 50 * PERIOD_US);
+    CHECK(c.frame_bytes < 6000);          // keyframes do not skew the size estimate
+    CHECK(c.cfg.min_frames > 1);
+    CHECK(bdp_ctl_should_send(&c));       // ...but min_frames still lets one through
+    bdp_ctl_on_send(&c, 51, 5000, 0, 51 * PERIOD_US);
+    CHECK(!bdp_ctl_should_send(&c));
+    bdp_ctl_on_ack(&c, 50, 51 * PERIOD_US + 4000);
+    CHECK(bdp_ctl_should_send(&c));
+    bdp_ctl_free(&c);
+}
+
+static void test_expired_frames_release_bytes(void) {
+    bdp_config cfg;
+    bdp_config_default(&cfg);
+    cfg.capacity = 8;
+    cfg.max_frames = 100;
+    bdp_ctl c;
+    CHECK_EQ(bdp_ctl_init(&c, &cfg), 0);
+    for (uint32_t seq = 0; seq < 20; seq++) bdp_ctl_on_send(&c, seq, 1000 + seq, 0, seq * PERIOD_US);
+    CHECK_EQ(bdp_ctl_inflight(&c), 8);
+    uint64_t expect = 0;
+    for (uint32_t seq = 12; seq < 20; seq++) expect += 1000 + seq;
+    CHECK_EQ(c.inflight_bytes, expect);
+
+    bdp_ctl_reset(&c);
+    CHECK_EQ(bdp_ctl_inflight(&c), 0);
+    CHECK_EQ(c.inflight_bytes, 0);
+    CHECK_EQ(bdp_ctl_on_ack(&c, 19, 20 * PERIOD_US), 0);   // from before the reset
+    bdp_ctl_free(&c);
+}
+
+static void test_queue_lowers_rate_estimate(void) {
+    // The link drains 2 KB/ms. Send 20 KB frames at 120 fps (2.4 KB/ms) with
+    // no backpressure: the queue grows, the sends are window-limited, and the
+    // estimate must come down to the drain rate.
+    bdp_config cfg;
+    bdp_config_default(&cfg);
+    cfg.bw_window_us = 500000;
+    bdp_ctl c;
+    CHECK_EQ(bdp_ctl_init(&c, &cfg), 0);
+    int64_t link_free = 0;
+    int64_t ack_at[400];
+    uint32_t next_ack = 0;
+    for (uint32_t seq = 0; seq < 400; seq++) {
+        int64_t t = (int64_t)seq * PERIOD_US;
+        while (next_ack < seq && ack_at[next_ack] <= t) {
+            bdp_ctl_on_ack(&c, next_ack, ack_at[next_ack]);
+            next_ack++;
+        }
+        bdp_ctl_on_send(&c, seq, 20000, 0, t);
+        link_free = (link_free > t ? link_free : t) + 10000;
+        ack_at[seq] = link_free + 1000;
+    }
+    CHECK(bdp_ctl_bandwidth(&c) < 2.2e6);
+    CHECK(bdp_ctl_bandwidth(&c) > 1.8e6);
+    bdp_ctl_free(&c);
+}
+
+// MARK: - Simulator
+
+static int run(const char *model, loadgen_profile profile, const char *ctl_name,
+               link_sim_result *r) {
+    loadgen_config load;
+    loadgen_default_config(&load);
+    load.profile = profile;
+    load.burst_rate = 0.005;
+    link_sim_controller ctl;
+    if (link_sim_controller_create(&ctl, ctl_name, 120) < 0) return -1;
+    int rc = link_sim_run(link_sim_find_model(model), &load, 120, 120 * 30, &ctl, r);
+    link_sim_controller_destroy(&ctl);
+    return rc;
+}
+
+static void test_sim_is_deterministic(void) {
+    link_sim_result a, b;
+    CHECK_EQ(run("usb2-busy", LOADGEN_VIDEO, "bdp", &a), 0);
+    CHECK_EQ(run("usb2-busy", LOADGEN_VIDEO, "bdp", &b), 0);
+    CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+    CHECK_EQ(a.frames, 120 * 30);
+    CHECK_EQ(a.sent + a.skipped, a.frames);
+}
+
+static void test_sim_idle_link_latency(void) {
+    // Constant 20 KB frames over USB 3: no queueing anywhere, so latency is
+    // transfer + propagation + decode.
+    link_sim_result r;
+    loadgen_config load;
+    loadgen_default_config(&load);
+    load.idr_interval = 0;
+    load.idr_size = 20000;
+    link_sim_controller ctl;
+    CHECK_EQ(link_sim_controller_create(&ctl, "none", 120), 0);
+    const link_model *m = link_sim_find_model("usb3");
+    CHECK(m != NULL);
+    CHECK_EQ(link_sim_run(m, &load, 120, 1200, &ctl, &r), 0);
+    link_sim_controller_destroy(&ctl);
+    double base_ms = (20000 / m->rate_mbs + m->chunk_overhead_us + m->latency_us + m->decode_us +
+                      m->decode_us_per_kb * 20000 / 1024.0) / 1000.0;
+    CHECK_EQ(r.skipped, 0);
+    CHECK(r.p50_ms >= base_ms && r.p50_ms <= base_ms + m->jitter_us / 1000.0);
+    CHECK(r.max_ms < base_ms + m->stall_us / 1000.0 + 0.1);
+}
+
+static void test_sim_overload_without_backpressure(void) {
+    link_sim_result r;
+    CHECK_EQ(run("usb2-busy", LOADGEN_VIDEO, "none", &r), 0);
+    CHECK_EQ(r.skipped, 0);
+    CHECK(r.p95_ms > 1000);     // the tunnel is slower than the stream: unbounded queue
+    CHECK(r.link_busy > 0.95);  // all but the adbd stalls
+}
+
+static void test_sim_bdp_beats_legacy_tail(void) {
+    static const char *const models[] = { "usb2", "usb2-busy", "usb2-hiccup", "slow-decode" };
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+        link_sim_result legacy, bdp;
+        CHECK_EQ(run(models[i], LOADGEN_VIDEO, "legacy", &legacy), 0);
+        CHECK_EQ(run(models[i], LOADGEN_VIDEO, "bdp", &bdp), 0);
+        if (bdp.p95_ms >= legacy.p95_ms * 0.9 || bdp.skip_rate > legacy.skip_rate + 0.05) {
+            fprintf(stderr, "%s: bdp p95 %.1f skip %.3f, legacy p95 %.1f skip %.3f\n", models[i],
+                    bdp.p95_ms, bdp.skip_rate, legacy.p95_ms, legacy.skip_rate);
+            test_failures++;
+        }
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_cold_window);
+    RUN_TEST(test_steady_stream_estimates);
+    RUN_TEST(test_keyframe_holds_back_deltas);
+    RUN_TEST(test_expired_frames_release_bytes);
+    RUN_TEST(test_queue_lowers_rate_estimate);
+    RUN_TEST(test_sim_is_deterministic);
+    RUN_TEST(test_sim_idle_link_latency);
+    RUN_TEST(test_sim_overload_without_backpressure);
+    RUN_TEST(test_sim_bdp_beats_legacy_tail);
+    return TEST_EXIT();
+}
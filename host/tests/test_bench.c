@@ -0,0 +1,98 @@
+// test_bench.c — Benchmark harness: JSON round trip and baseline comparison.
+
+#include "test_util.h"
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bench_result make(const char *name, double ns) {
+    bench_result r;
+    memset(&r, 0, sizeof(r));
+    snprintf(r.name, sizeof(r.name), "%s", name);
+    r.ns_per_op = ns;
+    r.min_ns_per_op = ns * 0.9;
+    r.mb_per_s = ns > 0 ? 1000.0 / ns : 0;
+    r.ops = 1024;
+    return r;
+}
+
+static void test_json_round_trip(void) {
+    bench_result out[3] = { make("lz4.decode_delta_typing", 412.5), make("ack.shm", 1830.0),
+                            make("e2e.tcp_grey_typing", 95000.25) };
+    char path[] = "/tmp/test_bench_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    bench_write_json(f, "Linux x86_64, \"quoted\" cpu", out, 3);
+    fclose(f);
+
+    bench_result in[BENCH_MAX_RESULTS];
+    CHECK_EQ(bench_load_json(path, in, BENCH_MAX_RESULTS), 3);
+    for (int i = 0; i < 3; i++) {
+        CHECK(strcmp(in[i].name, out[i].name) == 0);
+        CHECK(in[i].ns_per_op > out[i].ns_per_op - 0.06 && in[i].ns_per_op < out[i].ns_per_op + 0.06);
+        CHECK(in[i].min_ns_per_op > 0);
+        CHECK_EQ(in[i].ops, 1024);
+    }
+    CHECK_EQ(bench_load_json(path, in, 2), 2);
+    unlink(path);
+    CHECK_EQ(bench_load_json("/nonexistent/bench.json", in, BENCH_MAX_RESULTS), -1);
+}
+
+static void test_load_rejects_other_json(void) {
+    char path[] = "/tmp/test_bench_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "w");
+    fputs("{ \"cases\": [ { \"name\": \"x\", \"ns_per_op\": 1 } ] }\n", f);
+    fclose(f);
+    bench_result in[4];
+    CHECK_EQ(bench_load_json(path, in, 4), -1);
+    unlink(path);
+}
+
+static void test_compare_flags_regressions(void) {
+    bench_result base[3] = { make("a", 100), make("b", 100), make("gone", 50) };
+    bench_result cur[3] = { make("a", 114), make("b", 116), make("new", 10) };
+    // 14% slower is inside a 15% tolerance, 16% is not; unmatched cases never fail.
+    CHECK_EQ(bench_compare(base, 3, cur, 3, 15, NULL), 1);
+    CHECK_EQ(bench_compare(base, 3, cur, 3, 20, NULL), 0);
+    CHECK_EQ(bench_compare(base, 3, cur, 3, 10, NULL), 2);
+
+    // Faster is never a regression.
+    bench_result faster[1] = { make("a", 10) };
+    CHECK_EQ(bench_compare(base, 3, faster, 1, 0, NULL), 0);
+}
+
+static int counter_fn(void *state, uint64_t ops) {
+    volatile uint64_t *n = (volatile uint64_t *)state;
+    for (uint64_t i = 0; i < ops; i++) (*n)++;
+    return 0;
+}
+
+static int failing_fn(void *state, uint64_t ops) {
+    (void)state;
+    (void)ops;
+    return -1;
+}
+
+static void test_measure_calibrates(void) {
+    uint64_t n = 0;
+    bench_result r;
+    CHECK_EQ(bench_measure(&r, "counter", counter_fn, &n, 8, 5, 3), 0);
+    CHECK(strcmp(r.name, "counter") == 0);
+    CHECK(r.ops > 1000);                   // grew until a run took 5 ms
+    CHECK(r.ns_per_op > 0);
+    CHECK(r.min_ns_per_op <= r.ns_per_op);
+    CHECK(r.mb_per_s > 0);
+    CHECK_EQ(bench_measure(&r, "fails", failing_fn, NULL, 0, 5, 3), -1);
+}
+
+int main(void) {
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_load_rejects_other_json);
+    RUN_TEST(test_compare_flags_regressions);
+    RUN_TEST(test_measure_calibrates);
+    return TEST_EXIT();
+}
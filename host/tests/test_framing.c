@@ -0,0 +1,166 @@
+// test_framing.c — iovec framing: AVCC conversion, header, partial writes.
+
+#include "test_util.h"
+#include "framing.h"
+#include "host_util.h"
+#include "mirror_protocol.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const uint8_t SC[4] = { 0, 0, 0, 1 };
+
+// Append a 4-byte big-endian length prefix and `len` bytes of `fill`.
+static size_t put_avcc(uint8_t *dst, uint8_t fill, size_t len) {
+    dst[0] = (uint8_t)(len >> 24);
+    dst[1] = (uint8_t)(len >> 16);
+    dst[2] = (uint8_t)(len >> 8);
+    dst[3] = (uint8_t)len;
+    memset(dst + 4, fill, len);
+    return 4 + len;
+}
+
+static void test_avcc_to_annexb(void) {
+    uint8_t vps[] = { 0x40, 0x01, 0xAA };
+    uint8_t avcc[64];
+    size_t n = put_avcc(avcc, 0x26, 10);
+    n += put_avcc(avcc + n, 0x02, 5);
+
+    frame_iov f;
+    frame_iov_init(&f);
+    CHECK_EQ(frame_iov_add_nal(&f, vps, sizeof(vps)), 0);
+    CHECK_EQ(frame_iov_add_avcc(&f, avcc, n), 2);
+    frame_iov_finish(&f, FLAG_KEYFRAME, 42);
+    CHECK_EQ(f.iovcnt, 7);
+    CHECK_EQ(f.payload_len, 4 + 3 + 4 + 10 + 4 + 5);
+    CHECK_EQ(frame_iov_size(&f), FRAME_HEADER_SIZE + f.payload_len);
+
+    // Same bytes the copy path (header + start codes + NALs appended) produces.
+    uint8_t expect[64];
+    size_t e = 0;
+    encode_frame_header(expect, FLAG_KEYFRAME, 42, (uint32_t)f.payload_len);
+    e += FRAME_HEADER_SIZE;
+    memcpy(expect + e, SC, 4); e += 4;
+    memcpy(expect + e, vps, sizeof(vps)); e += sizeof(vps);
+    memcpy(expect + e, SC, 4); e += 4;
+    memset(expect + e, 0x26, 10); e += 10;
+    memcpy(expect + e, SC, 4); e += 4;
+    memset(expect + e, 0x02, 5); e += 5;
+
+    uint8_t flat[64];
+    frame_iov_flatten(&f, flat);
+    CHECK_EQ(e, frame_iov_size(&f));
+    CHECK(memcmp(flat, expect, e) == 0);
+}
+
+static void test_avcc_rejects_truncated(void) {
+    uint8_t avcc[32];
+    size_t n = put_avcc(avcc, 0x26, 10);
+    frame_iov f;
+    frame_iov_init(&f);
+    CHECK_EQ(frame_iov_add_avcc(&f, avcc, n - 1), -1);
+    frame_iov_init(&f);
+    CHECK_EQ(frame_iov_add_avcc(&f, avcc, n + 2), -1);  // trailing partial prefix
+}
+
+static void test_overflow_is_reported(void) {
+    uint8_t nal = 0x26;
+    frame_iov f;
+    frame_iov_init(&f);
+    int added = 0;
+    while (frame_iov_add_nal(&f, &nal, 1) == 0) added++;
+    CHECK_EQ(added, (FRAME_IOV_MAX - 1) / 2);
+    CHECK(f.overflow);
+    CHECK_EQ(frame_iov_send(-1, &f), -1);
+}
+
+typedef struct {
+    int fd;
+    uint8_t *buf;
+    size_t len;
+} drain_args;
+
+static void *drain_thread(void *arg) {
+    drain_args *d = (drain_args *)arg;
+    // Small reads so the writer keeps hitting a full socket buffer.
+    size_t got = 0;
+    while (got < d->len) {
+        size_t want = d->len - got < 1000 ? d->len - got : 1000;
+        ssize_t r = recv(d->fd, d->buf + got, want, 0);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    d->len = got;
+    return NULL;
+}
+
+static void test_send_resumes_partial_writes(void) {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    int small = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    // Uneven region sizes so partial writes land mid-region.
+    enum { NALS = 12 };
+    uint8_t *nals[NALS];
+    size_t sizes[NALS];
+    frame_iov f;
+    frame_iov_init(&f);
+    for (int i = 0; i < NALS; i++) {
+        sizes[i] = 1 + (size_t)i * 7919;
+        nals[i] = (uint8_t *)malloc(sizes[i]);
+        for (size_t j = 0; j < sizes[i]; j++) nals[i][j] = (uint8_t)(i * 31 + j);
+        frame_iov_add_nal(&f, nals[i], sizes[i]);
+    }
+    frame_iov_finish(&f, 0, 7);
+    size_t total = frame_iov_size(&f);
+    uint8_t *expect = (uint8_t *)malloc(total);
+    frame_iov_flatten(&f, expect);
+
+    drain_args d = { sv[1], (uint8_t *)malloc(total), total };
+    pthread_t t;
+    pthread_create(&t, NULL, drain_thread, &d);
+    CHECK_EQ(frame_iov_send(sv[0], &f), 0);
+    pthread_join(t, NULL);
+
+    CHECK_EQ(d.len, total);
+    CHECK(memcmp(d.buf, expect, total) == 0);
+    CHECK_EQ(read_le32(d.buf + 3), 7);
+    CHECK_EQ(read_le32(d.buf + 7), total - FRAME_HEADER_SIZE);
+
+    // Descriptor is untouched, so it can be sent again (e.g. to another client).
+    CHECK_EQ(f.iov[0].iov_len, FRAME_HEADER_SIZE);
+    CHECK(f.iov[2].iov_base == nals[0]);
+
+    for (int i = 0; i < NALS; i++) free(nals[i]);
+    free(expect);
+    free(d.buf);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+static void test_send_to_closed_peer_fails(void) {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    close(sv[1]);
+    uint8_t nal[100] = { 0 };
+    frame_iov f;
+    frame_iov_init(&f);
+    frame_iov_add_nal(&f, nal, sizeof(nal));
+    frame_iov_finish(&f, 0, 0);
+    CHECK_EQ(frame_iov_send(sv[0], &f), -1);  // EPIPE, no SIGPIPE
+    close(sv[0]);
+}
+
+int main(void) {
+    RUN_TEST(test_avcc_to_annexb);
+    RUN_TEST(test_avcc_rejects_truncated);
+    RUN_TEST(test_overflow_is_reported);
+    RUN_TEST(test_send_resumes_partial_writes);
+    RUN_TEST(test_send_to_closed_peer_fails);
+    return TEST_EXIT();
+}
@@ -0,0 +1,157 @@
+// test_grey.c — Greyscale conversion, LZ4 grey codec round trips and frame sources.
+
+#include "test_util.h"
+#include "frame_source.h"
+#include "grey_convert.h"
+#include "grey_encoder.h"
+#include "mirror_grey.h"
+#include "mirror_protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define W 203   // odd sizes exercise SIMD tails and clipped edge tiles
+#define H 97
+
+static uint64_t rng = 7;
+static uint8_t rnd8(void) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint8_t)(rng >> 56);
+}
+
+static void test_simd_matches_scalar(void) {
+    uint8_t *bgra = (uint8_t *)malloc(W * H * 4);
+    for (int i = 0; i < W * H * 4; i++) bgra[i] = rnd8();
+    // Extremes: pure white must stay 255, pure black 0.
+    memset(bgra, 0xFF, 16 * 4);
+    memset(bgra + 16 * 4, 0x00, 16 * 4);
+
+    uint8_t simd[W * H], ref[W * H];
+    grey_from_bgra(simd, bgra, W, H, W * 4);
+    grey_from_bgra_scalar(ref, bgra, W * H);
+    CHECK(memcmp(simd, ref, sizeof(ref)) == 0);
+    CHECK_EQ(simd[0], 255);
+    CHECK_EQ(simd[16], 0);
+    free(bgra);
+}
+
+// A "screen": flat background with some text-like noise that moves a little.
+static void make_frame(uint8_t *f, int t) {
+    memset(f, 0xE0, W * H);
+    for (int y = 10; y < 30; y++) {
+        for (int x = 20 + t; x < 80 + t && x < W; x++) f[y * W + x] = (uint8_t)((x * 7 + y * 3) & 0xFF);
+    }
+}
+
+static void round_trip(grey_mode mode) {
+    grey_encoder enc;
+    CHECK_EQ(grey_encoder_init(&enc, mode, W, H, 32), 0);
+    mirror_grey_decoder dec;
+    mirror_grey_init(&dec);
+
+    uint8_t frame[W * H];
+    for (int t = 0; t < 10; t++) {
+        make_frame(frame, t * 3);
+        uint8_t flags;
+        size_t len;
+        const uint8_t *payload = grey_encode(&enc, frame, t == 5, &flags, &len);
+        CHECK(payload != NULL);
+        CHECK(flags & FLAG_GREY_LZ4);
+        CHECK_EQ((flags & FLAG_KEYFRAME) != 0, t == 0 || t == 5);
+        CHECK_EQ((flags & FLAG_GREY_TILES) != 0, mode == GREY_MODE_TILES);
+        if (t > 0 && t != 5) CHECK(len < W * H / 4);  // deltas are small
+        CHECK_EQ(mirror_grey_decode(&dec, W, H, flags, payload, len), 1);
+        CHECK(memcmp(dec.frame, frame, sizeof(frame)) == 0);
+    }
+
+    // An unchanged frame still decodes (empty delta / zero tiles).
+    uint8_t flags;
+    size_t len;
+    const uint8_t *payload = grey_encode(&enc, frame, 0, &flags, &len);
+    CHECK_EQ(mirror_grey_decode(&dec, W, H, flags, payload, len), 1);
+    CHECK(memcmp(dec.frame, frame, sizeof(frame)) == 0);
+
+    mirror_grey_free(&dec);
+    grey_encoder_free(&enc);
+}
+
+static void test_delta_round_trip(void) { round_trip(GREY_MODE_DELTA); }
+static void test_tiles_round_trip(void) { round_trip(GREY_MODE_TILES); }
+
+static void test_delta_before_keyframe_dropped(void) {
+    grey_encoder enc;
+    grey_encoder_init(&enc, GREY_MODE_DELTA, W, H, 0);
+    uint8_t frame[W * H];
+    make_frame(frame, 0);
+    uint8_t flags;
+    size_t len;
+    grey_encode(&enc, frame, 1, &flags, &len);
+    make_frame(frame, 1);
+    const uint8_t *payload = grey_encode(&enc, frame, 0, &flags, &len);
+
+    mirror_grey_decoder dec;
+    mirror_grey_init(&dec);
+    CHECK_EQ(mirror_grey_decode(&dec, W, H, flags, payload, len), 0);
+    // Corrupt payloads are rejected rather than overrunning the frame.
+    uint8_t junk[64];
+    memset(junk, 0xF0, sizeof(junk));
+    CHECK_EQ(mirror_grey_decode(&dec, W, H, FLAG_GREY_LZ4 | FLAG_KEYFRAME, junk, sizeof(junk)), 0);
+    CHECK_EQ(dec.have_keyframe, 0);
+    mirror_grey_free(&dec);
+    grey_encoder_free(&enc);
+}
+
+static void test_y4m_source(void) {
+    // Two 4x2 4:2:0 frames: 8 luma + 2×(2×1) chroma bytes each.
+    static const char header[] = "YUV4MPEG2 W4 H2 F60:1 Ip A1:1 C420jpeg\n";
+    uint8_t stream[256];
+    size_t n = 0;
+    memcpy(stream, header, sizeof(header) - 1);
+    n += sizeof(header) - 1;
+    for (int f = 0; f < 2; f++) {
+        memcpy(stream + n, "FRAME\n", 6);
+        n += 6;
+        for (int i = 0; i < 8; i++) stream[n++] = (uint8_t)(f * 100 + i);
+        for (int i = 0; i < 4; i++) stream[n++] = 0x80;
+    }
+
+    FILE *f = fmemopen(stream, n, "rb");
+    frame_source src;
+    CHECK_EQ(frame_source_open_file(&src, f, FRAME_Y4M, 0, 0, 1), 0);
+    CHECK_EQ(src.width, 4);
+    CHECK_EQ(src.height, 2);
+    uint8_t grey[8];
+    CHECK_EQ(frame_source_read(&src, grey), 1);
+    CHECK_EQ(grey[7], 7);
+    CHECK_EQ(frame_source_read(&src, grey), 1);
+    CHECK_EQ(grey[0], 100);
+    // --loop rewinds to the first frame.
+    CHECK_EQ(frame_source_read(&src, grey), 1);
+    CHECK_EQ(grey[0], 0);
+    frame_source_close(&src);
+    fclose(f);
+}
+
+static void test_bgra_source(void) {
+    uint8_t px[2 * 4] = { 0, 0, 255, 255, 255, 255, 255, 255 };  // red, white
+    FILE *f = fmemopen(px, sizeof(px), "rb");
+    frame_source src;
+    CHECK_EQ(frame_source_open_file(&src, f, FRAME_BGRA, 2, 1, 0), 0);
+    uint8_t grey[2];
+    CHECK_EQ(frame_source_read(&src, grey), 1);
+    CHECK_EQ(grey[0], (77 * 255 + 128) >> 8);
+    CHECK_EQ(grey[1], 255);
+    CHECK_EQ(frame_source_read(&src, grey), 0);
+    frame_source_close(&src);
+    fclose(f);
+}
+
+int main(void) {
+    RUN_TEST(test_simd_matches_scalar);
+    RUN_TEST(test_delta_round_trip);
+    RUN_TEST(test_tiles_round_trip);
+    RUN_TEST(test_delta_before_keyframe_dropped);
+    RUN_TEST(test_y4m_source);
+    RUN_TEST(test_bgra_source);
+    return TEST_EXIT();
+}
@@ -0,0 +1,247 @@
+// test_loadgen.c — Frame-size profiles, schedule shape and the paced runner.
+
+#include "test_util.h"
+#include "host_util.h"
+#include "loadgen.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+static loadgen_config base_config(loadgen_profile p) {
+    loadgen_config cfg;
+    loadgen_default_config(&cfg);
+    cfg.profile = p;
+    cfg.seed = 42;
+    return cfg;
+}
+
+static double median_p_size(loadgen_profile p, int n) {
+    loadgen_config cfg = base_config(p);
+    cfg.idr_interval = 0;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+    double *sizes = (double *)malloc((size_t)n * sizeof(double));
+    loadgen_frame f;
+    loadgen_next(&lg, &f);  // first frame is always an IDR
+    for (int i = 0; i < n; i++) {
+        loadgen_next(&lg, &f);
+        sizes[i] = f.size;
+    }
+    double m = percentile(sizes, (size_t)n, 0.5);
+    free(sizes);
+    return m;
+}
+
+static void test_same_seed_same_schedule(void) {
+    loadgen_config cfg = base_config(LOADGEN_VIDEO);
+    cfg.burst_rate = 0.05;
+    cfg.command_interval = 7;
+    loadgen a, b;
+    loadgen_init(&a, &cfg);
+    loadgen_init(&b, &cfg);
+    for (int i = 0; i < 500; i++) {
+        loadgen_frame fa, fb;
+        loadgen_next(&a, &fa);
+        loadgen_next(&b, &fb);
+        CHECK(memcmp(&fa, &fb, sizeof(fa)) == 0);
+    }
+}
+
+static void test_idr_interval_and_commands(void) {
+    loadgen_config cfg = base_config(LOADGEN_CONSTANT);
+    cfg.idr_interval = 10;
+    cfg.command_interval = 4;
+    cfg.p_size = 1234;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+    int idrs = 0, cmds = 0, brightness = 0, warmth = 0;
+    for (int i = 0; i < 100; i++) {
+        loadgen_frame f;
+        loadgen_next(&lg, &f);
+        CHECK_EQ(f.seq, i);
+        if (f.flags & FLAG_KEYFRAME) {
+            idrs++;
+            CHECK_EQ(i % 10, 0);
+            CHECK_EQ(f.size, cfg.idr_size);
+        } else {
+            CHECK_EQ(f.size, 1234);
+        }
+        if (f.has_command) {
+            cmds++;
+            CHECK_EQ(f.command[0], MAGIC_FRAME_0);
+            CHECK_EQ(f.command[1], MAGIC_CMD_1);
+            if (f.command[2] == CMD_BRIGHTNESS) brightness++;
+            if (f.command[2] == CMD_WARMTH) warmth++;
+        }
+    }
+    CHECK_EQ(idrs, 10);
+    CHECK_EQ(cmds, 25);
+    CHECK(brightness > 0 && warmth > 0);
+    CHECK_EQ(brightness + warmth, cmds);
+}
+
+static void test_intra_refresh_spreads_keyframe_bytes(void) {
+    loadgen_config cfg = base_config(LOADGEN_CONSTANT);
+    cfg.idr_interval = 10;
+    cfg.idr_size = 50000;
+    cfg.p_size = 1000;
+    cfg.intra_refresh = 1;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+    int idrs = 0;
+    for (int i = 0; i < 100; i++) {
+        loadgen_frame f;
+        loadgen_next(&lg, &f);
+        if (f.flags & FLAG_KEYFRAME) {
+            idrs++;
+            CHECK_EQ(i, 0);
+        } else {
+            CHECK_EQ(f.size, 1000 + 5000);
+        }
+    }
+    CHECK_EQ(idrs, 1);
+}
+
+static void test_profiles_are_ordered(void) {
+    double typing = median_p_size(LOADGEN_TYPING, 2000);
+    double scrolling = median_p_size(LOADGEN_SCROLLING, 2000);
+    double video = median_p_size(LOADGEN_VIDEO, 2000);
+    CHECK(typing < scrolling);
+    CHECK(scrolling < video);
+    // Medians land near the profile defaults.
+    CHECK(scrolling > 0.8 * loadgen_default_p_size(LOADGEN_SCROLLING));
+    CHECK(scrolling < 1.2 * loadgen_default_p_size(LOADGEN_SCROLLING));
+}
+
+static void test_bursts_scale_p_frames(void) {
+    loadgen_config cfg = base_config(LOADGEN_CONSTANT);
+    cfg.idr_interval = 0;
+    cfg.p_size = 1000;
+    cfg.burst_rate = 0.02;
+    cfg.burst_frames = 20;
+    cfg.burst_scale = 5.0;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+    int in_burst = 0;
+    for (int i = 0; i < 5000; i++) {
+        loadgen_frame f;
+        loadgen_next(&lg, &f);
+        if (f.flags & FLAG_KEYFRAME) continue;
+        CHECK_EQ(f.size, f.burst ? 5000 : 1000);
+        in_burst += f.burst;
+    }
+    // Expected share of burst frames: 20 / (20 + 1/0.02) ≈ 29%.
+    CHECK(in_burst > 5000 * 0.15);
+    CHECK(in_burst < 5000 * 0.45);
+}
+
+static void test_filler_payload(void) {
+    uint8_t buf[32];
+    loadgen_fill_payload(buf, sizeof(buf));
+    CHECK_EQ(buf[3], 0x01);
+    CHECK_EQ(buf[4] >> 1, 38);  // HEVC FD_NUT
+    CHECK_EQ(buf[31], 0x80);
+}
+
+typedef struct {
+    mirror_receiver *r;
+    int fd;
+} session_arg;
+
+static void *session_thread(void *arg) {
+    session_arg *s = (session_arg *)arg;
+    mirror_receiver_session(s->r, s->fd);
+    return NULL;
+}
+
+// Count frames and commands in a recorded raw protocol stream.
+static void parse_record(const uint8_t *p, size_t n, int *frames, int *commands) {
+    size_t i = 0;
+    *frames = *commands = 0;
+    while (i + 2 <= n && p[i] == MAGIC_FRAME_0) {
+        if (p[i + 1] == MAGIC_CMD_1) {
+            i += p[i + 2] == CMD_RESOLUTION ? RESOLUTION_CMD_SIZE : CMD_SIZE;
+            (*commands)++;
+        } else if (p[i + 1] == MAGIC_FRAME_1) {
+            i += FRAME_HEADER_SIZE + read_le32(p + i + 7);
+            (*frames)++;
+        } else {
+            break;
+        }
+    }
+    CHECK_EQ(i, n);
+}
+
+static void test_run_against_receiver(void) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    mock_decoder_config mcfg;
+    mock_decoder_default_config(&mcfg);
+    mcfg.decode_latency_us = 500;
+    mock_decoder dec;
+    mock_decoder_init(&dec, &mcfg);
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &dec, NULL, NULL);
+    r.realtime = 0;
+    r.running = 1;
+    mirror_receiver_create_decoder(&r, r.frame_w, r.frame_h);
+    session_arg sa = { &r, fds[1] };
+    pthread_t rx;
+    pthread_create(&rx, NULL, session_thread, &sa);
+
+    loadgen_config cfg = base_config(LOADGEN_TYPING);
+    cfg.idr_size = 50000;
+    cfg.idr_interval = 30;
+    cfg.command_interval = 10;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+
+    char *rec_buf = NULL;
+    size_t rec_len = 0;
+    FILE *rec = open_memstream(&rec_buf, &rec_len);
+
+    loadgen_result res;
+    CHECK_EQ(loadgen_run(fds[0], &lg, 500, 100, 1000, rec, &res), 0);
+    CHECK_EQ(res.frames_sent, 100);
+    CHECK_EQ(res.frames_acked, 100);
+    CHECK_EQ(res.commands_sent, 10);
+    CHECK(res.ack_p50_ms > 0);
+    CHECK(res.ack_max_ms >= res.ack_p99_ms);
+
+    // A second step on the same connection continues the sequence.
+    CHECK_EQ(loadgen_run(fds[0], &lg, 500, 50, 1000, rec, &res), 0);
+    CHECK_EQ(res.frames_acked, 50);
+
+    shutdown(fds[0], SHUT_WR);
+    pthread_join(rx, NULL);
+    CHECK_EQ(r.stats.frames, 150);
+    CHECK_EQ(r.stats.commands, 15);
+    CHECK_EQ(r.stats.seq_gaps, 0);
+
+    fclose(rec);
+    int frames, commands;
+    parse_record((const uint8_t *)rec_buf, rec_len, &frames, &commands);
+    CHECK_EQ(frames, 150);
+    CHECK_EQ(commands, 15);
+    free(rec_buf);
+
+    close(fds[0]);
+    close(fds[1]);
+    mirror_receiver_free(&r);
+    mock_decoder_free(&dec);
+}
+
+int main(void) {
+    RUN_TEST(test_same_seed_same_schedule);
+    RUN_TEST(test_idr_interval_and_commands);
+    RUN_TEST(test_intra_refresh_spreads_keyframe_bytes);
+    RUN_TEST(test_profiles_are_ordered);
+    RUN_TEST(test_bursts_scale_p_frames);
+    RUN_TEST(test_filler_payload);
+    RUN_TEST(test_run_against_receiver);
+    return TEST_EXIT();
+}
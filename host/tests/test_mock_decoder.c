@@ -0,0 +1,105 @@
+// test_mock_decoder.c — Timing and slot model of the mock MediaCodec backend.
+
+#include "test_util.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mock_decoder.h"
+
+static mock_decoder_config config(int in_slots, int out_slots, int64_t latency_us) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.input_slots = in_slots;
+    cfg.output_slots = out_slots;
+    cfg.decode_latency_us = latency_us;
+    cfg.input_capacity = 1024;
+    return cfg;
+}
+
+static void queue_frame(mock_decoder *d, int64_t pts) {
+    ssize_t idx = mock_decoder_ops.dequeue_input(d, 0);
+    CHECK(idx >= 0);
+    if (idx >= 0) mock_decoder_ops.queue_input(d, (size_t)idx, 100, pts, 0);
+}
+
+static void test_input_slots_run_out(void) {
+    mock_decoder_config cfg = config(2, 4, 10000);
+    mock_decoder d;
+    mock_decoder_init(&d, &cfg);
+    mock_decoder_ops.configure(&d, mirror_codec_get(MIRROR_CODEC_HEVC), 640, 480);
+
+    queue_frame(&d, 0);
+    queue_frame(&d, 1);
+    CHECK(mock_decoder_ops.dequeue_input(&d, 0) < 0);
+    CHECK_EQ(d.input_timeouts, 1);
+
+    // First frame finishes decoding after ~10ms, freeing its slot.
+    int64_t t0 = mirror_now_us();
+    ssize_t idx = mock_decoder_ops.dequeue_input(&d, 50000);
+    int64_t waited = mirror_now_us() - t0;
+    CHECK(idx >= 0);
+    CHECK(waited >= 5000);
+    CHECK(waited < 40000);
+
+    mock_decoder_free(&d);
+}
+
+static void test_decode_is_serial_and_ordered(void) {
+    mock_decoder_config cfg = config(4, 4, 5000);
+    mock_decoder d;
+    mock_decoder_init(&d, &cfg);
+    mock_decoder_ops.configure(&d, mirror_codec_get(MIRROR_CODEC_HEVC), 640, 480);
+
+    int64_t t0 = mirror_now_us();
+    queue_frame(&d, 7);
+    queue_frame(&d, 8);
+    mirror_output_info info;
+    CHECK(mock_decoder_ops.dequeue_output(&d, &info, 0) < 0);
+
+    ssize_t out = mock_decoder_ops.dequeue_output(&d, &info, 50000);
+    CHECK(out >= 0);
+    CHECK_EQ(info.pts_us, 7);
+    mock_decoder_ops.release_output(&d, (size_t)out, 1);
+
+    out = mock_decoder_ops.dequeue_output(&d, &info, 50000);
+    CHECK(out >= 0);
+    CHECK_EQ(info.pts_us, 8);
+    // Two serial 5ms decodes.
+    CHECK(mirror_now_us() - t0 >= 9000);
+    mock_decoder_ops.release_output(&d, (size_t)out, 0);
+
+    CHECK_EQ(d.rendered, 1);
+    CHECK_EQ(d.discarded, 1);
+    mock_decoder_free(&d);
+}
+
+static void test_full_output_stalls_decode(void) {
+    mock_decoder_config cfg = config(2, 1, 1000);
+    mock_decoder d;
+    mock_decoder_init(&d, &cfg);
+    mock_decoder_ops.configure(&d, mirror_codec_get(MIRROR_CODEC_HEVC), 640, 480);
+
+    queue_frame(&d, 1);
+    queue_frame(&d, 2);
+    mirror_output_info info;
+    ssize_t out = mock_decoder_ops.dequeue_output(&d, &info, 50000);
+    CHECK(out >= 0);
+
+    // The only output buffer is held, so the second frame cannot leave the decoder.
+    struct timespec ts = { 0, 5 * 1000 * 1000 };
+    nanosleep(&ts, NULL);
+    mirror_output_info none;
+    CHECK(mock_decoder_ops.dequeue_output(&d, &none, 0) < 0);
+    CHECK_EQ(d.decoded, 1);
+
+    mock_decoder_ops.release_output(&d, (size_t)out, 1);
+    CHECK(mock_decoder_ops.dequeue_output(&d, &info, 0) >= 0);
+    CHECK_EQ(info.pts_us, 2);
+    mock_decoder_free(&d);
+}
+
+int main(void) {
+    RUN_TEST(test_input_slots_run_out);
+    RUN_TEST(test_decode_is_serial_and_ordered);
+    RUN_TEST(test_full_output_stalls_decode);
+    return TEST_EXIT();
+}
@@ -0,0 +1,159 @@
+// test_phase_ctl.c — Capture tick phase controller, alone and against the
+// simulated receiver display in phase_sim.h.
+
+#include "test_util.h"
+#include "phase_ctl.h"
+#include "phase_sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define PERIOD_US 16667
+
+// Frame seq captured at capture_us, sent 5 ms later, arriving 1 ms after that
+// and ready 3 ms later, is shown at the first latch deadline of a grid anchored
+// at latch0_us. Returns the report's slack.
+static uint32_t report_frame(phase_ctl *c, uint32_t seq, int64_t capture_us, int64_t latch0_us) {
+    int64_t send = capture_us + 5000, arrival = send + 1000, ready = arrival + 3000;
+    int64_t k = (ready - latch0_us + PERIOD_US - 1) / PERIOD_US;
+    int64_t latch = latch0_us + k * PERIOD_US;
+    phase_ctl_on_send(c, seq, capture_us, send);
+    CHECK_EQ(phase_ctl_on_report(c, seq, (uint32_t)(latch - arrival), (uint32_t)(latch - ready), PERIOD_US,
+                                 1000), 1);
+    return (uint32_t)(latch - ready);
+}
+
+static void test_unlocked_until_enough_reports(void) {
+    phase_config cfg;
+    phase_config_default(&cfg, 60);
+    phase_ctl c;
+    phase_ctl_init(&c, &cfg);
+    CHECK_EQ(phase_ctl_next_tick(&c, 0), 0);
+    CHECK_EQ(phase_ctl_interval_us(&c), PERIOD_US);
+
+    // Unknown and evicted frames do not count.
+    CHECK_EQ(phase_ctl_on_report(&c, 7, 5000, 1000, PERIOD_US, 1000), 0);
+    phase_ctl_on_send(&c, 1, 0, 5000);
+    phase_ctl_on_send(&c, 1 + PHASE_CTL_FRAMES, 100000, 105000);
+    CHECK_EQ(phase_ctl_on_report(&c, 1, 5000, 1000, PERIOD_US, 1000), 0);
+    CHECK_EQ(c.unmatched, 2);
+
+    for (int i = 0; i < cfg.lock_reports - 1; i++) report_frame(&c, (uint32_t)i, i * PERIOD_US, 3000);
+    CHECK(!phase_ctl_locked(&c));
+    CHECK_EQ(phase_ctl_next_tick(&c, 0), 0);
+    report_frame(&c, 100, 100 * PERIOD_US, 3000);
+    CHECK(phase_ctl_locked(&c));
+
+    phase_ctl_reset(&c);
+    CHECK(!phase_ctl_locked(&c));
+    CHECK_EQ(c.unmatched, 2);
+}
+
+static void test_ticks_land_margin_before_latch(void) {
+    phase_config cfg;
+    phase_config_default(&cfg, 60);
+    phase_ctl c;
+    phase_ctl_init(&c, &cfg);
+    const int64_t latch0 = 3000;
+    // Free-running ticks 7 ms out of phase with the display.
+    for (uint32_t i = 0; i < 20; i++) report_frame(&c, i, 7000 + (int64_t)i * PERIOD_US, latch0);
+    CHECK(phase_ctl_locked(&c));
+    CHECK(fabs(c.delay_us - 9000) < 1);
+    CHECK(fabs(c.period_us - PERIOD_US) < 1);
+
+    // Steered: ready exactly margin_us before a latch deadline.
+    int64_t tick = phase_ctl_next_tick(&c, 20 * PERIOD_US);
+    CHECK(tick >= 20 * PERIOD_US + PERIOD_US / 2);
+    CHECK(tick < 20 * PERIOD_US + PERIOD_US / 2 + PERIOD_US);
+    int64_t phase = ((tick + 9000 + cfg.margin_us - latch0) % PERIOD_US + PERIOD_US) % PERIOD_US;
+    CHECK(phase <= 1 || phase >= PERIOD_US - 1);
+    uint32_t slack = report_frame(&c, 20, tick, latch0);
+    CHECK(slack >= 999 && slack <= 1001);
+}
+
+static void test_interval_snaps_to_vsyncs(void) {
+    phase_config cfg;
+    phase_config_default(&cfg, 120);
+    phase_ctl c;
+    phase_ctl_init(&c, &cfg);
+    for (uint32_t i = 0; i < 10; i++) report_frame(&c, i, (int64_t)i * 8333, 3000);
+    CHECK_EQ(phase_ctl_interval_us(&c), 8334);     // half of the 60 Hz period
+    int64_t a = phase_ctl_next_tick(&c, 1000000);
+    int64_t b = phase_ctl_next_tick(&c, a);
+    CHECK(llabs(b - a - 8334) <= 1);
+
+    phase_config_default(&cfg, 50);
+    phase_ctl_init(&c, &cfg);
+    for (uint32_t i = 0; i < 10; i++) report_frame(&c, i, (int64_t)i * 20000, 3000);
+    CHECK_EQ(phase_ctl_interval_us(&c), PERIOD_US); // 50 fps → every vsync
+}
+
+static void test_refresh_change_relocks(void) {
+    phase_config cfg;
+    phase_config_default(&cfg, 60);
+    phase_ctl c;
+    phase_ctl_init(&c, &cfg);
+    for (uint32_t i = 0; i < 10; i++) report_frame(&c, i, (int64_t)i * PERIOD_US, 3000);
+    CHECK(phase_ctl_locked(&c));
+    phase_ctl_on_send(&c, 10, 10 * PERIOD_US, 10 * PERIOD_US + 5000);
+    CHECK_EQ(phase_ctl_on_report(&c, 10, 5000, 1000, 8333, 1000), 1);
+    CHECK(!phase_ctl_locked(&c));
+    CHECK(fabs(c.period_us - 8333) < 1);
+}
+
+// Averages over starting phases: a free-running sender keeps its phase.
+static void sim_average(phase_sim_config *cfg, int seeds, double *wait_ms, double *g2g_ms, double *err_ppm) {
+    *wait_ms = *g2g_ms = *err_ppm = 0;
+    for (int i = 1; i <= seeds; i++) {
+        phase_sim_result r;
+        cfg->seed = (uint64_t)i;
+        CHECK_EQ(phase_sim_run(cfg, 20, &r), 0);
+        CHECK(r.shown > 0);
+        if (cfg->locked) CHECK(r.lock_ms > 0 && r.lock_ms < 1000);
+        *wait_ms += r.wait_avg_ms / seeds;
+        *g2g_ms += r.g2g_avg_ms / seeds;
+        *err_ppm += fabs(r.period_err_ppm) / seeds;
+    }
+}
+
+static void test_sim_is_deterministic(void) {
+    phase_sim_config cfg;
+    phase_sim_default_config(&cfg);
+    cfg.locked = 1;
+    phase_sim_result a, b;
+    CHECK_EQ(phase_sim_run(&cfg, 5, &a), 0);
+    CHECK_EQ(phase_sim_run(&cfg, 5, &b), 0);
+    CHECK_EQ(a.shown, b.shown);
+    CHECK(a.g2g_avg_ms == b.g2g_avg_ms);
+}
+
+static void test_sim_lock_follows_drifting_clocks(void) {
+    static const double drifts[] = { 0, 300, -300, 2000 };
+    for (size_t i = 0; i < sizeof(drifts) / sizeof(drifts[0]); i++) {
+        phase_sim_config cfg;
+        phase_sim_default_config(&cfg);
+        cfg.fps = 60;
+        cfg.drift_ppm = drifts[i];
+        double free_wait, free_g2g, locked_wait, locked_g2g, err;
+        sim_average(&cfg, 8, &free_wait, &free_g2g, &err);
+        cfg.locked = 1;
+        sim_average(&cfg, 8, &locked_wait, &locked_g2g, &err);
+        // Unlocked, frames wait about half a period for the latch; locked,
+        // about the margin plus two deviations of the pipeline jitter.
+        if (locked_wait > 2.5 || free_g2g - locked_g2g < 4 || err > 500) {
+            fprintf(stderr, "drift %.0f ppm: wait %.1f → %.1f ms, g2g %.1f → %.1f ms, period err %.0f ppm\n",
+                    drifts[i], free_wait, locked_wait, free_g2g, locked_g2g, err);
+            test_failures++;
+        }
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_unlocked_until_enough_reports);
+    RUN_TEST(test_ticks_land_margin_before_latch);
+    RUN_TEST(test_interval_snaps_to_vsyncs);
+    RUN_TEST(test_refresh_change_relocks);
+    RUN_TEST(test_sim_is_deterministic);
+    RUN_TEST(test_sim_lock_follows_drifting_clocks);
+    return TEST_EXIT();
+}
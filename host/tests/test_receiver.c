@@ -0,0 +1,880 @@
+// test_receiver.c — Receiver core over a socketpair with the mock decoder.
+
+#include "test_util.h"
+#include "host_util.h"
+#include "mirror_codec.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    int connected_calls;
+    uint32_t last_w, last_h;
+    uint8_t last_cmd, last_value;
+} platform_log;
+
+static void rec_connection(void *ctx, int connected) {
+    platform_log *p = (platform_log *)ctx;
+    if (connected) p->connected_calls++;
+}
+
+static void rec_resolution(void *ctx, uint32_t w, uint32_t h) {
+    platform_log *p = (platform_log *)ctx;
+    p->last_w = w;
+    p->last_h = h;
+}
+
+static void rec_command(void *ctx, uint8_t cmd, uint8_t value) {
+    platform_log *p = (platform_log *)ctx;
+    p->last_cmd = cmd;
+    p->last_value = value;
+}
+
+static const mirror_platform_ops recording_platform = {
+    .on_connection_state = rec_connection,
+    .on_resolution = rec_resolution,
+    .on_command = rec_command,
+};
+
+typedef struct {
+    mirror_receiver *r;
+    int sock;
+    int frames;
+} session_arg;
+
+static void *session_thread(void *arg) {
+    session_arg *s = (session_arg *)arg;
+    s->frames = mirror_receiver_session(s->r, s->sock);
+    return NULL;
+}
+
+typedef struct {
+    mock_decoder dec;
+    mirror_receiver r;
+    platform_log log;
+    int fds[2];
+    session_arg arg;
+    pthread_t thread;
+    int joined;
+} fixture;
+
+// Set up the receiver and decoder; fixture_launch() starts the session, so
+// receiver fields can be changed in between.
+static void fixture_init(fixture *f, const mock_decoder_config *cfg) {
+    memset(f, 0, sizeof(*f));
+    mock_decoder_init(&f->dec, cfg);
+    mirror_receiver_init(&f->r, &mock_decoder_ops, &f->dec, &recording_platform, &f->log);
+    f->r.realtime = 0;
+    f->r.running = 1;
+    mirror_receiver_create_decoder(&f->r, DEFAULT_FRAME_W, DEFAULT_FRAME_H);
+}
+
+static void fixture_launch(fixture *f) {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, f->fds);
+    f->arg.r = &f->r;
+    f->arg.sock = f->fds[1];
+    pthread_create(&f->thread, NULL, session_thread, &f->arg);
+}
+
+static void fixture_start(fixture *f, const mock_decoder_config *cfg) {
+    fixture_init(f, cfg);
+    fixture_launch(f);
+}
+
+static void fixture_join(fixture *f) {
+    if (!f->joined) pthread_join(f->thread, NULL);
+    f->joined = 1;
+}
+
+static void fixture_finish(fixture *f) {
+    shutdown(f->fds[0], SHUT_WR);
+    fixture_join(f);
+    close(f->fds[0]);
+    close(f->fds[1]);
+    f->r.running = 0;
+    mirror_receiver_free(&f->r);
+    mock_decoder_free(&f->dec);
+}
+
+static void send_frame(int fd, uint32_t seq, uint32_t len, int idr) {
+    uint8_t hdr[FRAME_HEADER_SIZE];
+    encode_frame_header(hdr, idr ? FLAG_KEYFRAME : 0, seq, len);
+    uint8_t payload[256];
+    memset(payload, 0xAB, sizeof(payload));
+    write_all(fd, hdr, sizeof(hdr));
+    write_all(fd, payload, len);
+}
+
+static int read_ack(int fd, uint32_t *seq) {
+    uint8_t ack[ACK_SIZE];
+    if (read_all(fd, ack, sizeof(ack)) < 0) return 0;
+    if (ack[0] != MAGIC_FRAME_0 || ack[1] != MAGIC_ACK_1) return 0;
+    *seq = read_le32(ack + 2);
+    return 1;
+}
+
+static void test_frames_are_acked_in_order(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    for (uint32_t seq = 0; seq < 5; seq++) send_frame(f.fds[0], seq, 200, seq == 0);
+    for (uint32_t seq = 0; seq < 5; seq++) {
+        uint32_t got = 0xFFFFFFFF;
+        CHECK(read_ack(f.fds[0], &got));
+        CHECK_EQ(got, seq);
+    }
+
+    fixture_finish(&f);
+    CHECK_EQ(f.arg.frames, 5);
+    CHECK_EQ(f.r.stats.frames, 5);
+    CHECK_EQ(f.r.stats.bytes, 1000);
+    CHECK_EQ(f.r.stats.seq_gaps, 0);
+    CHECK_EQ(f.log.connected_calls, 1);
+}
+
+static void test_resolution_command_rebuilds_decoder(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    uint8_t cmd[7] = { MAGIC_FRAME_0, MAGIC_CMD_1, CMD_RESOLUTION };
+    write_le16(cmd + 3, 1600);
+    write_le16(cmd + 5, 1200);
+    write_all(f.fds[0], cmd, sizeof(cmd));
+    send_frame(f.fds[0], 0, 10, 1);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+
+    fixture_finish(&f);
+    CHECK_EQ(f.log.last_w, 1600);
+    CHECK_EQ(f.log.last_h, 1200);
+    CHECK_EQ(f.dec.configures, 2);
+    CHECK_EQ(f.dec.width, 1600);
+    CHECK_EQ(f.dec.height, 1200);
+}
+
+static void test_display_command_is_dispatched(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    uint8_t cmd[4] = { MAGIC_FRAME_0, MAGIC_CMD_1, CMD_WARMTH, 77 };
+    write_all(f.fds[0], cmd, sizeof(cmd));
+    send_frame(f.fds[0], 0, 10, 1);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+
+    fixture_finish(&f);
+    CHECK_EQ(f.log.last_cmd, CMD_WARMTH);
+    CHECK_EQ(f.log.last_value, 77);
+    CHECK_EQ(f.r.stats.commands, 1);
+}
+
+static void test_sequence_gaps_are_counted(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    send_frame(f.fds[0], 10, 10, 1);
+    send_frame(f.fds[0], 13, 10, 0);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+    CHECK(read_ack(f.fds[0], &seq));
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.seq_gaps, 2);
+}
+
+static void test_slot_scarcity_drops_but_still_acks(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.input_slots = 1;
+    cfg.decode_latency_us = 20000;
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    for (uint32_t seq = 0; seq < 4; seq++) send_frame(f.fds[0], seq, 50, seq == 0);
+    for (uint32_t seq = 0; seq < 4; seq++) {
+        uint32_t got;
+        CHECK(read_ack(f.fds[0], &got));
+        CHECK_EQ(got, seq);
+    }
+
+    fixture_finish(&f);
+    CHECK(f.r.stats.input_timeouts >= 1);
+    CHECK_EQ(f.r.stats.input_timeouts, f.dec.input_timeouts);
+    CHECK_EQ(f.r.stats.frames, 4);
+}
+
+// MARK: - Decoder watchdog
+
+// Read one upstream packet: returns MAGIC_ACK_1 (with *value = seq) or
+// MAGIC_CMD_1 (with *value = cmd), 0 on error.
+// The last vsync report read by read_upstream().
+static uint8_t last_vsync_report[VSYNC_REPORT_SIZE];
+
+static int read_upstream(int fd, uint32_t *value) {
+    uint8_t pkt[ACK_SIZE];
+    if (read_all(fd, pkt, 2) < 0 || pkt[0] != MAGIC_FRAME_0) return 0;
+    if (pkt[1] == MAGIC_VSYNC_1 && read_all(fd, last_vsync_report + 2, VSYNC_REPORT_SIZE - 2) == 0) {
+        *value = read_le32(last_vsync_report + 2);
+        return MAGIC_VSYNC_1;
+    }
+    if (pkt[1] == MAGIC_ACK_1 && read_all(fd, pkt + 2, 4) == 0) {
+        *value = read_le32(pkt + 2);
+        return MAGIC_ACK_1;
+    }
+    if (pkt[1] == MAGIC_CMD_1 && read_all(fd, pkt + 2, 2) == 0) {
+        *value = pkt[2];
+        return MAGIC_CMD_1;
+    }
+    return 0;
+}
+
+// Read the upstream packets for `frames` frames; returns keyframe requests seen.
+static int read_upstream_for(int fd, int frames) {
+    int requests = 0;
+    uint32_t v;
+    int type;
+    while (frames > 0 && (type = read_upstream(fd, &v)) != 0) {
+        if (type == MAGIC_ACK_1) frames--;
+        else if (v == CMD_REQUEST_KEYFRAME) requests++;
+    }
+    return requests;
+}
+
+// Send P-frames one at a time until the receiver asks for a keyframe. Returns
+// the number sent, or -1 if no request came within 20 frames.
+static int send_until_keyframe_request(fixture *f, uint32_t *seq) {
+    for (int i = 1; i <= 20; i++) {
+        send_frame(f->fds[0], (*seq)++, 50, 0);
+        if (read_upstream_for(f->fds[0], 1) > 0) return i;
+    }
+    return -1;
+}
+
+static void watchdog_fixture_start(fixture *f) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture_start(f, &cfg);
+    f->r.stall_inputs = 5;
+    f->r.stall_us = 200000;
+}
+
+// Send a keyframe and then a P-frame a little later, whose feed drains the
+// keyframe's output.
+static void send_keyframe_and_drain(fixture *f, uint32_t *seq) {
+    send_frame(f->fds[0], (*seq)++, 50, 1);
+    sleep_until_us(mirror_now_us() + 2000);
+    send_frame(f->fds[0], (*seq)++, 50, 0);
+}
+
+static void test_watchdog_flush_recovers_stalled_decoder(void) {
+    fixture f;
+    watchdog_fixture_start(&f);
+    uint32_t seq = 0;
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    // Inputs fill the slots and then time out: after five without output the
+    // decoder is flushed and a keyframe requested.
+    mock_decoder_stall(&f.dec, MOCK_STALL_FLUSHABLE);
+    // The last healthy P-frame may finish decoding only after a few stalled
+    // inputs went in, which restarts the count once.
+    int sent = send_until_keyframe_request(&f, &seq);
+    CHECK(sent >= 5 && sent <= 10);
+
+    // P-frames before the keyframe are skipped (and ACKed), then decoding resumes.
+    for (int i = 0; i < 3; i++) send_frame(f.fds[0], seq++, 50, 0);
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 5), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.stalls, 1);
+    CHECK_EQ(f.r.stats.flushes, 1);
+    CHECK_EQ(f.r.stats.rebuilds, 0);
+    CHECK_EQ(f.r.stats.keyframe_requests, 1);
+    CHECK_EQ(f.r.stats.recovery_drops, 3);
+    CHECK_EQ(f.r.stats.recoveries, 1);
+    CHECK(f.r.stats.recover_ms_last > 0);
+    CHECK_EQ(f.dec.flushes, 1);
+    CHECK_EQ(f.dec.configures, 1);
+    CHECK_EQ(f.r.wd_stage, MIRROR_WD_IDLE);
+    CHECK_EQ(f.r.stats.frames, seq);
+}
+
+static void test_watchdog_rebuilds_when_flush_does_not_help(void) {
+    fixture f;
+    watchdog_fixture_start(&f);
+    uint32_t seq = 0;
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    mock_decoder_stall(&f.dec, MOCK_STALL_WEDGED);
+    CHECK(send_until_keyframe_request(&f, &seq) > 0);
+    CHECK_EQ(f.r.wd_stage, MIRROR_WD_FLUSHED);
+
+    // The requested keyframe goes in, but the decoder is still wedged.
+    send_frame(f.fds[0], seq++, 50, 1);
+    CHECK_EQ(read_upstream_for(f.fds[0], 1), 0);
+    CHECK_EQ(send_until_keyframe_request(&f, &seq), 4);
+    CHECK_EQ(f.r.wd_stage, MIRROR_WD_REBUILT);
+
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.stalls, 1);
+    CHECK_EQ(f.r.stats.flushes, 1);
+    CHECK_EQ(f.r.stats.rebuilds, 1);
+    CHECK_EQ(f.r.stats.keyframe_requests, 2);
+    CHECK_EQ(f.r.stats.recoveries, 1);
+    CHECK_EQ(f.dec.configures, 2);
+    CHECK_EQ(f.r.wd_stage, MIRROR_WD_IDLE);
+}
+
+static void test_watchdog_ignores_idle_stream(void) {
+    fixture f;
+    watchdog_fixture_start(&f);
+    f.r.stall_us = 20000;
+    uint32_t seq = 0;
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    // Nothing sent for longer than stall_us: a static screen, not a stall.
+    sleep_until_us(mirror_now_us() + 60000);
+    for (int i = 0; i < 3; i++) {
+        send_frame(f.fds[0], seq++, 50, 0);
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+    CHECK_EQ(read_upstream_for(f.fds[0], 3), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.stalls, 0);
+    CHECK_EQ(f.r.stats.keyframe_requests, 0);
+}
+
+static void test_bad_magic_ends_session(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    uint8_t junk[2] = { 0x12, 0x34 };
+    write_all(f.fds[0], junk, sizeof(junk));
+    fixture_join(&f);
+    CHECK_EQ(f.arg.frames, 0);
+    fixture_finish(&f);
+}
+
+// MARK: - Codec negotiation
+
+static void test_codec_list_packing(void) {
+    uint8_t ranked[] = { MIRROR_CODEC_AV1, MIRROR_CODEC_H264, MIRROR_CODEC_HEVC };
+    uint8_t v = mirror_codecs_pack(ranked, 3);
+    uint8_t out[MIRROR_MAX_CODECS];
+    CHECK_EQ(mirror_codecs_unpack(v, out), 3);
+    CHECK(memcmp(out, ranked, 3) == 0);
+    CHECK_EQ(mirror_codecs_unpack(0, out), 0);
+
+    // Unknown ids are left out rather than packed as garbage.
+    uint8_t odd[] = { 9, MIRROR_CODEC_H264 };
+    CHECK_EQ(mirror_codecs_unpack(mirror_codecs_pack(odd, 2), out), 1);
+    CHECK_EQ(out[0], MIRROR_CODEC_H264);
+
+    // The sender takes the receiver's fastest codec it can encode, else HEVC.
+    uint32_t mac = MIRROR_CODEC_BIT(MIRROR_CODEC_HEVC) | MIRROR_CODEC_BIT(MIRROR_CODEC_H264);
+    CHECK_EQ(mirror_codec_pick(ranked, 3, mac), MIRROR_CODEC_H264);
+    CHECK_EQ(mirror_codec_pick(ranked, 1, mac), MIRROR_CODEC_HEVC);
+    CHECK_EQ(mirror_codec_pick(ranked, 3, MIRROR_CODEC_BIT(MIRROR_CODEC_AV1)), MIRROR_CODEC_AV1);
+    CHECK_EQ(mirror_codec_pick(NULL, 0, mac), MIRROR_CODEC_HEVC);
+
+    CHECK(mirror_codec_find("video/avc") == mirror_codec_get(MIRROR_CODEC_H264));
+    CHECK(mirror_codec_find("av1") == mirror_codec_get(MIRROR_CODEC_AV1));
+    CHECK(mirror_codec_find("video/vp9") == NULL);
+    CHECK(mirror_codec_get(MIRROR_CODEC_COUNT) == NULL);
+}
+
+static void test_codecs_advertised_at_session_start(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_init(&f, &cfg);
+    f.r.codecs[0] = MIRROR_CODEC_H264;
+    f.r.codecs[1] = MIRROR_CODEC_HEVC;
+    f.r.n_codecs = 2;
+    fixture_launch(&f);
+
+    uint8_t pkt[CMD_SIZE];
+    CHECK_EQ(read_all(f.fds[0], pkt, sizeof(pkt)), 0);
+    CHECK_EQ(pkt[1], MAGIC_CMD_1);
+    CHECK_EQ(pkt[2], CMD_CODECS);
+    uint8_t ids[MIRROR_MAX_CODECS];
+    CHECK_EQ(mirror_codecs_unpack(pkt[3], ids), 2);
+    CHECK_EQ(ids[0], MIRROR_CODEC_H264);
+    CHECK_EQ(ids[1], MIRROR_CODEC_HEVC);
+
+    send_frame(f.fds[0], 0, 10, 1);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+    fixture_finish(&f);
+}
+
+static void test_codec_command_rebuilds_decoder(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    uint8_t cmd[CMD_SIZE];
+    encode_command(cmd, CMD_CODEC, MIRROR_CODEC_H264);
+    write_all(f.fds[0], cmd, sizeof(cmd));
+    write_all(f.fds[0], cmd, sizeof(cmd));             // repeated: no second rebuild
+    encode_command(cmd, CMD_CODEC, 0x3F);               // unknown: ignored
+    write_all(f.fds[0], cmd, sizeof(cmd));
+    send_frame(f.fds[0], 0, 10, 1);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+
+    fixture_finish(&f);
+    CHECK(f.dec.codec == mirror_codec_get(MIRROR_CODEC_H264));
+    CHECK_EQ(f.dec.configures, 2);
+    CHECK_EQ(f.r.stats.codec_switches, 1);
+    CHECK_EQ(f.r.stats.frames, 1);
+    CHECK_EQ(f.log.last_cmd, 0);                        // not a display command
+}
+
+static void test_features_advertised_and_timing_stripped(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_init(&f, &cfg);
+    f.r.features = MIRROR_FEATURE_FRAME_TIMING;
+    fixture_launch(&f);
+
+    uint8_t pkt[CMD_SIZE];
+    CHECK_EQ(read_all(f.fds[0], pkt, sizeof(pkt)), 0);
+    CHECK_EQ(pkt[1], MAGIC_CMD_1);
+    CHECK_EQ(pkt[2], CMD_FEATURES);
+    CHECK_EQ(pkt[3], MIRROR_FEATURE_FRAME_TIMING);
+
+    // A timed keyframe, then an untimed P-frame: both decode with the block removed.
+    uint8_t frame[FRAME_HEADER_SIZE + FRAME_TIMING_SIZE + 40];
+    encode_frame_header(frame, FLAG_KEYFRAME | FLAG_FRAME_TIMING, 0, FRAME_TIMING_SIZE + 40);
+    mirror_frame_timing sent = { .capture_us = 2100, .queue_us = 400, .encode_us = 3900 };
+    encode_frame_timing(frame + FRAME_HEADER_SIZE, &sent);
+    memset(frame + FRAME_HEADER_SIZE + FRAME_TIMING_SIZE, 0xAB, 40);
+    write_all(f.fds[0], frame, sizeof(frame));
+    send_frame(f.fds[0], 1, 40, 0);
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+    CHECK(read_ack(f.fds[0], &seq));
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.frames, 2);
+    CHECK_EQ(f.r.stats.bytes, 80);
+    CHECK_EQ(f.r.stats.timed_frames, 1);
+    CHECK_EQ(f.r.stats.sender_encode_us, 3900);
+    CHECK_EQ(f.r.stats.timing_last.capture_us, 2100);
+    CHECK_EQ(f.r.stats.timing_last.queue_us, 400);
+}
+
+static void test_recording_keeps_what_replay_needs(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_init(&f, &cfg);
+    char path[] = "/tmp/test_receiver_XXXXXX";
+    f.r.record_fd = mkstemp(path);
+    CHECK(f.r.record_fd >= 0);
+    fixture_launch(&f);
+
+    uint8_t res[RESOLUTION_CMD_SIZE], bright[CMD_SIZE], frame[FRAME_HEADER_SIZE + FRAME_TIMING_SIZE + 40];
+    encode_resolution(res, 800, 600);
+    encode_command(bright, CMD_BRIGHTNESS, 90);
+    encode_frame_header(frame, FLAG_KEYFRAME | FLAG_FRAME_TIMING, 5, FRAME_TIMING_SIZE + 40);
+    mirror_frame_timing t = { .capture_us = 2100, .queue_us = 400, .encode_us = 3900 };
+    encode_frame_timing(frame + FRAME_HEADER_SIZE, &t);
+    memset(frame + FRAME_HEADER_SIZE + FRAME_TIMING_SIZE, 0xAB, 40);
+    write_all(f.fds[0], res, sizeof(res));
+    write_all(f.fds[0], bright, sizeof(bright));
+    write_all(f.fds[0], frame, sizeof(frame));
+    uint32_t seq;
+    CHECK(read_ack(f.fds[0], &seq));
+    fixture_finish(&f);
+
+    // The resolution, then the frame without its timing block; no brightness.
+    uint8_t want[RESOLUTION_CMD_SIZE + FRAME_HEADER_SIZE + 40];
+    memcpy(want, res, sizeof(res));
+    encode_frame_header(want + RESOLUTION_CMD_SIZE, FLAG_KEYFRAME, 5, 40);
+    memset(want + RESOLUTION_CMD_SIZE + FRAME_HEADER_SIZE, 0xAB, 40);
+    uint8_t got[sizeof(want) + 16];
+    ssize_t n = pread(f.r.record_fd, got, sizeof(got), 0);
+    CHECK_EQ(n, sizeof(want));
+    CHECK(memcmp(got, want, sizeof(want)) == 0);
+    close(f.r.record_fd);
+    unlink(path);
+}
+
+// Annex B access units: parameter sets, then a slice or an SEI.
+static const uint8_t hevc_params[] = {
+    0, 0, 0, 1, 0x40, 0x01, 0x0C,       // VPS
+    0, 0, 0, 1, 0x42, 0x01, 0x01,       // SPS
+    0, 0, 0, 1, 0x44, 0x01, 0xC1,       // PPS
+};
+// Prefix SEI: user data whose RBSP 00 00 01 FF needs an emulation prevention
+// byte, then a recovery point.
+static const uint8_t hevc_recovery_sei[] = {
+    0, 0, 1, 0x4E, 0x01, 0x05, 0x04, 0x00, 0x00, 0x03, 0x01, 0xFF, 0x06, 0x01, 0x84, 0x80,
+};
+static const uint8_t hevc_trail[] = { 0, 0, 1, 0x02, 0x01, 0xD0, 0x11 };
+static const uint8_t hevc_cra[] = { 0, 0, 1, 0x2A, 0x01, 0xAF, 0x22 };
+
+static size_t build_au(uint8_t *out, const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len) {
+    memcpy(out, a, a_len);
+    memcpy(out + a_len, b, b_len);
+    return a_len + b_len;
+}
+
+static void test_random_access_scan(void) {
+    const mirror_codec_info *hevc = mirror_codec_get(MIRROR_CODEC_HEVC);
+    const mirror_codec_info *h264 = mirror_codec_get(MIRROR_CODEC_H264);
+    uint8_t au[128];
+    size_t n;
+
+    n = build_au(au, hevc_params, sizeof(hevc_params), hevc_cra, sizeof(hevc_cra));
+    CHECK(mirror_codec_random_access(hevc, au, n));
+    n = build_au(au, hevc_params, sizeof(hevc_params), hevc_recovery_sei, sizeof(hevc_recovery_sei));
+    CHECK(mirror_codec_random_access(hevc, au, n));
+    n = build_au(au, hevc_params, sizeof(hevc_params), hevc_trail, sizeof(hevc_trail));
+    CHECK(!mirror_codec_random_access(hevc, au, n));
+    // A recovery point is no use to a fresh decoder without parameter sets.
+    CHECK(!mirror_codec_random_access(hevc, hevc_recovery_sei, sizeof(hevc_recovery_sei)));
+    // Payload sizes count RBSP bytes (the 03 is not one): one more and the user
+    // data swallows the recovery point.
+    n = build_au(au, hevc_params, sizeof(hevc_params), hevc_recovery_sei, sizeof(hevc_recovery_sei));
+    au[sizeof(hevc_params) + 6] = 0x05;
+    CHECK(!mirror_codec_random_access(hevc, au, n));
+
+    static const uint8_t avc_idr[] = {
+        0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0, 0, 0, 1, 0x68, 0xEE, 0x3C, 0, 0, 1, 0x65, 0x88, 0x84,
+    };
+    static const uint8_t avc_recovery[] = {
+        0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0, 0, 0, 1, 0x68, 0xEE, 0x3C,
+        0, 0, 1, 0x06, 0x06, 0x01, 0x84, 0x80, 0, 0, 1, 0x41, 0x9A, 0x02,
+    };
+    static const uint8_t avc_p[] = { 0, 0, 1, 0x41, 0x9A, 0x02 };
+    CHECK(mirror_codec_random_access(h264, avc_idr, sizeof(avc_idr)));
+    CHECK(mirror_codec_random_access(h264, avc_recovery, sizeof(avc_recovery)));
+    CHECK(!mirror_codec_random_access(h264, avc_p, sizeof(avc_p)));
+    // HEVC NAL types mean something else to H.264 and vice versa.
+    CHECK(!mirror_codec_random_access(hevc, avc_idr, sizeof(avc_idr)));
+    CHECK(!mirror_codec_random_access(mirror_codec_get(MIRROR_CODEC_AV1), avc_idr, sizeof(avc_idr)));
+    CHECK(!mirror_codec_random_access(hevc, au, 2));
+}
+
+static void send_au(int fd, uint32_t seq, uint8_t flags, const uint8_t *au, size_t len) {
+    uint8_t hdr[FRAME_HEADER_SIZE];
+    encode_frame_header(hdr, flags, seq, (uint32_t)len);
+    write_all(fd, hdr, sizeof(hdr));
+    write_all(fd, au, len);
+}
+
+static void test_join_waits_for_recovery_point(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    fixture f;
+    fixture_start(&f, &cfg);
+
+    // Joining mid-stream: the first P-frame asks for a keyframe at once, the
+    // second is skipped quietly.
+    send_frame(f.fds[0], 0, 50, 0);
+    uint32_t v;
+    CHECK_EQ(read_upstream(f.fds[0], &v), MAGIC_CMD_1);
+    CHECK_EQ(v, CMD_REQUEST_KEYFRAME);
+    CHECK_EQ(read_upstream(f.fds[0], &v), MAGIC_ACK_1);
+    send_frame(f.fds[0], 1, 50, 0);
+    CHECK_EQ(read_upstream_for(f.fds[0], 1), 0);
+    CHECK_EQ(f.dec.queued, 0);
+
+    // An intra-refresh stream's recovery point is not flagged, but decodes.
+    uint8_t au[128];
+    size_t n = build_au(au, hevc_params, sizeof(hevc_params), hevc_recovery_sei, sizeof(hevc_recovery_sei));
+    send_au(f.fds[0], 2, 0, au, n);
+    send_frame(f.fds[0], 3, 50, 0);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.join_drops, 2);
+    CHECK_EQ(f.r.stats.recovery_drops, 0);
+    CHECK_EQ(f.r.stats.recovery_points, 1);
+    CHECK_EQ(f.r.stats.keyframe_requests, 1);
+    CHECK_EQ(f.dec.queued, 2);
+    CHECK_EQ(f.r.stats.frames, 4);
+}
+
+static void test_detach_keeps_decoder_and_resumes_at_once(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_start(&f, &cfg);
+    uint32_t seq = 0;
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+    uint64_t rendered = f.dec.rendered;
+
+    // Surface gone: frames keep decoding and being ACKed, nothing renders.
+    mirror_receiver_detach_output(&f.r);
+    CHECK_EQ(f.dec.output_attached, 0);
+    for (int i = 0; i < 4; i++) {
+        send_frame(f.fds[0], seq++, 50, 0);
+        sleep_until_us(mirror_now_us() + 2000);
+    }
+    CHECK_EQ(read_upstream_for(f.fds[0], 4), 0);
+    CHECK_EQ(f.dec.rendered, rendered);
+    CHECK(f.r.held_output >= 0);
+
+    // Back: the held frame goes to the new window before any new frame arrives.
+    CHECK_EQ(mirror_receiver_attach_output(&f.r), 1);
+    CHECK_EQ(f.dec.rendered, rendered + 1);
+    CHECK_EQ(f.r.stats.resumes, 1);
+    CHECK(f.r.stats.resume_ms_last < 50);
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.dec.rendered_detached, 0);
+    CHECK_EQ(f.dec.output_switches, 2);
+    CHECK_EQ(f.dec.configures, 1);
+    CHECK_EQ(f.r.stats.detaches, 1);
+    CHECK_EQ(f.r.stats.resume_rebuilds, 0);
+    CHECK_EQ(f.r.stats.keyframe_requests, 0);
+    CHECK_EQ(f.r.stats.sessions, 1);
+    CHECK_EQ(f.r.stats.frames, seq);
+}
+
+static void test_detach_without_set_output_rebuilds_on_attach(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_start(&f, &cfg);
+    f.dec.set_output_fails = 1;
+    uint32_t seq = 0;
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    // No output switch: the decoder goes, the connection stays.
+    mirror_receiver_detach_output(&f.r);
+    CHECK_EQ(f.dec.configured, 0);
+    for (int i = 0; i < 3; i++) send_frame(f.fds[0], seq++, 50, 0);
+    CHECK_EQ(read_upstream_for(f.fds[0], 3), 0);
+
+    // A fresh decoder joins at the next keyframe, which it asks for.
+    CHECK_EQ(mirror_receiver_attach_output(&f.r), 0);
+    CHECK_EQ(f.dec.configures, 2);
+    send_frame(f.fds[0], seq++, 50, 0);
+    CHECK_EQ(read_upstream_for(f.fds[0], 1), 1);
+    send_keyframe_and_drain(&f, &seq);
+    CHECK_EQ(read_upstream_for(f.fds[0], 2), 0);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.resume_rebuilds, 1);
+    CHECK_EQ(f.r.stats.resumes, 1);
+    CHECK_EQ(f.r.stats.join_drops, 1);
+    CHECK_EQ(f.r.stats.sessions, 1);
+    CHECK_EQ(f.r.stats.frames, seq);
+}
+
+static void test_vsync_clock_learns_period(void) {
+    const int64_t base = 1000000000LL, period = 8333333;
+    mirror_vsync v;
+    mirror_vsync_init(&v);
+    CHECK_EQ(mirror_vsync_next(&v, base), 0);
+
+    // Eight intervals, one of them spanning a missed vsync.
+    int64_t t = base;
+    for (int i = 0; i <= 8; i++) {
+        mirror_vsync_tick(&v, t);
+        t += (i == 3) ? 2 * period : period;
+    }
+    int64_t last = t - period;
+    CHECK_EQ(mirror_vsync_period(&v), period);
+    CHECK_EQ(mirror_vsync_next(&v, last), last);
+    CHECK_EQ(mirror_vsync_next(&v, last + 1), last + period);
+    CHECK_EQ(mirror_vsync_next(&v, last + 2 * period + 5), last + 3 * period);
+    mirror_vsync_tick(&v, last - period);               // out of order: ignored
+    CHECK_EQ(mirror_vsync_next(&v, last + 1), last + period);
+
+    // A slower panel (or drifting clock) is followed, skipped vsyncs included.
+    const int64_t slower = 8400000;
+    for (int i = 0; i < 200; i++) {
+        t += (i % 10 == 0) ? 2 * slower : slower;
+        mirror_vsync_tick(&v, t);
+    }
+    int64_t err = mirror_vsync_period(&v) - slower;
+    CHECK(err > -20000 && err < 20000);
+
+    // No ticks for a while: no prediction until they resume.
+    CHECK_EQ(mirror_vsync_next(&v, t + MIRROR_VSYNC_STALE_NS + 1), 0);
+    mirror_vsync_free(&v);
+}
+
+static void test_frames_present_at_vsync_newest_wins(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_init(&f, &cfg);
+    // A 2 Hz vsync grid: the frames below all land within one or two periods.
+    const int64_t period = 500000000LL;
+    int64_t base = mirror_now_us() * 1000;
+    for (int i = 8; i >= 0; i--) mirror_receiver_vsync(&f.r, base - i * period);
+    fixture_launch(&f);
+
+    uint32_t seq = 0;
+    send_frame(f.fds[0], seq++, 50, 1);
+    for (int i = 0; i < 3; i++) {
+        sleep_until_us(mirror_now_us() + 2000);
+        send_frame(f.fds[0], seq++, 50, 0);
+    }
+    CHECK_EQ(read_upstream_for(f.fds[0], 4), 0);
+
+    fixture_finish(&f);
+    const mirror_receiver_stats *st = &f.r.stats;
+    CHECK(st->timed_presents >= 3);
+    CHECK_EQ(f.dec.timed_renders, st->timed_presents);
+    CHECK_EQ((f.dec.last_present_ns - base) % period, 0);
+    CHECK(f.dec.last_present_ns > base);
+    // At least two of the frames share a vsync; every other one is a judder sample.
+    CHECK(st->superseded >= 1);
+    CHECK_EQ(st->superseded + st->judder_samples + 1, st->timed_presents);
+    CHECK(st->slack_ms_min >= 0);
+    CHECK(st->slack_ms_last <= period / 1e6);
+}
+
+static void test_vsync_reports_when_asked(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_init(&f, &cfg);
+    const int64_t period = 500000000LL;
+    int64_t base = mirror_now_us() * 1000;
+    for (int i = 8; i >= 0; i--) mirror_receiver_vsync(&f.r, base - i * period);
+    fixture_launch(&f);
+
+    uint8_t cmd[CMD_SIZE];
+    encode_command(cmd, CMD_VSYNC_REPORTS, 1);
+    write_all(f.fds[0], cmd, sizeof(cmd));
+    uint32_t seq = 0;
+    send_frame(f.fds[0], seq++, 50, 1);
+    for (int i = 0; i < 3; i++) {
+        sleep_until_us(mirror_now_us() + 2000);
+        send_frame(f.fds[0], seq++, 50, 0);
+    }
+
+    // Each frame's output is released while the next one is fed: reports for
+    // frames 0-2, each ahead of the next frame's ACK.
+    uint32_t v, expect = 0;
+    int acks = 0, type;
+    while (acks < 4 && (type = read_upstream(f.fds[0], &v)) != 0) {
+        if (type == MAGIC_ACK_1) {
+            acks++;
+        } else if (type == MAGIC_VSYNC_1) {
+            CHECK_EQ(v, expect);
+            expect++;
+            uint32_t arrival_to_latch = read_le32(last_vsync_report + 6);
+            uint32_t slack = read_le32(last_vsync_report + 10);
+            CHECK_EQ(read_le32(last_vsync_report + 14), period / 1000);
+            CHECK(slack <= period / 1000);
+            CHECK(arrival_to_latch >= slack);
+        }
+    }
+    CHECK_EQ(acks, 4);
+    CHECK_EQ(expect, 3);
+
+    fixture_finish(&f);
+    CHECK_EQ(f.r.stats.vsync_reports, 3);
+}
+
+static void forward_rendered(void *ctx, int64_t pts_us, int64_t shown_ns) {
+    mirror_receiver_frame_rendered((mirror_receiver *)ctx, pts_us, shown_ns);
+}
+
+static void test_display_timestamps_match_frames(void) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 100;
+    fixture f;
+    fixture_init(&f, &cfg);
+    f.dec.on_rendered = forward_rendered;
+    f.dec.on_rendered_ctx = &f.r;
+    const int64_t period = 20000000LL;
+    int64_t base_us = mirror_now_us();
+    for (int i = 8; i >= 0; i--) mirror_receiver_vsync(&f.r, base_us * 1000 - i * period);
+    fixture_launch(&f);
+
+    // Each frame's output is released while the next one is fed. Frames 0 and
+    // 1 are released for the vsync at 20ms (1 replaces 0), 2 for 60ms and 3
+    // for 100ms; the mock compositor reports 1 and 2 shown once the next
+    // release proves they were latched, and the feed after that collects them.
+    static const int64_t at_ms[] = { 0, 2, 4, 40, 80, 82 };
+    for (uint32_t seq = 0; seq < 6; seq++) {
+        sleep_until_us(base_us + at_ms[seq] * 1000);
+        send_frame(f.fds[0], seq, 50, seq == 0);
+    }
+    CHECK_EQ(read_upstream_for(f.fds[0], 6), 0);
+
+    fixture_finish(&f);
+    const mirror_present_stats *d = &f.r.stats.display;
+    CHECK_EQ(d->displayed, 2);
+    CHECK_EQ(d->undisplayed, 1);
+    CHECK_EQ(d->unmatched, 0);
+    CHECK_EQ(d->arrival_samples, 2);
+    CHECK_EQ(d->latch_samples, 2);
+    CHECK(d->latch_ms_sum < 0.001);                 // shown at the vsync it was released for
+    // Frame 2 was decoded just after 40ms and shown at 60ms.
+    CHECK(d->display_ms_last > 0 && d->display_ms_last <= period / 1e6);
+    CHECK(d->display_ms_max >= d->display_ms_last);
+    CHECK(d->arrival_ms_sum >= d->display_ms_sum);
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_frames_are_acked_in_order);
+    RUN_TEST(test_resolution_command_rebuilds_decoder);
+    RUN_TEST(test_display_command_is_dispatched);
+    RUN_TEST(test_sequence_gaps_are_counted);
+    RUN_TEST(test_slot_scarcity_drops_but_still_acks);
+    RUN_TEST(test_bad_magic_ends_session);
+    RUN_TEST(test_watchdog_flush_recovers_stalled_decoder);
+    RUN_TEST(test_watchdog_rebuilds_when_flush_does_not_help);
+    RUN_TEST(test_watchdog_ignores_idle_stream);
+    RUN_TEST(test_codec_list_packing);
+    RUN_TEST(test_codecs_advertised_at_session_start);
+    RUN_TEST(test_codec_command_rebuilds_decoder);
+    RUN_TEST(test_features_advertised_and_timing_stripped);
+    RUN_TEST(test_recording_keeps_what_replay_needs);
+    RUN_TEST(test_random_access_scan);
+    RUN_TEST(test_join_waits_for_recovery_point);
+    RUN_TEST(test_detach_keeps_decoder_and_resumes_at_once);
+    RUN_TEST(test_detach_without_set_output_rebuilds_on_attach);
+    RUN_TEST(test_vsync_clock_learns_period);
+    RUN_TEST(test_frames_present_at_vsync_newest_wins);
+    RUN_TEST(test_vsync_reports_when_asked);
+    RUN_TEST(test_display_timestamps_match_frames);
+    return TEST_EXIT();
+}
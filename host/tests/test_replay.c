@@ -0,0 +1,277 @@
+// test_replay.c — Headless replay of recorded streams through the mock decoder.
+
+#include "test_util.h"
+#include "mirror_codec.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_replay.h"
+#include "mock_decoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AU_LEN 64
+
+typedef struct {
+    uint8_t buf[64 * 1024];
+    size_t len;
+} recording;
+
+// An HEVC access unit: an IDR slice (NAL type 19) or a trailing picture (1).
+// `tag` varies the bytes, and with them the mock's decoded picture.
+static void add_frame(recording *rec, uint8_t flags, uint32_t seq, int idr, uint8_t tag, int timing) {
+    uint32_t len = AU_LEN + (timing ? FRAME_TIMING_SIZE : 0);
+    encode_frame_header(rec->buf + rec->len, flags | (timing ? FLAG_FRAME_TIMING : 0), seq, len);
+    uint8_t *p = rec->buf + rec->len + FRAME_HEADER_SIZE;
+    if (timing) {
+        mirror_frame_timing t = { 1000 + seq, 200, 3000 };
+        encode_frame_timing(p, &t);
+        p += FRAME_TIMING_SIZE;
+    }
+    static const uint8_t start[4] = { 0, 0, 0, 1 };
+    memcpy(p, start, sizeof(start));
+    p[4] = idr ? 19 << 1 : 1 << 1;
+    p[5] = 1;
+    for (int i = 6; i < AU_LEN; i++) p[i] = (uint8_t)(tag + i);
+    rec->len += FRAME_HEADER_SIZE + len;
+}
+
+static void add_keyframe(recording *rec, uint32_t seq, uint8_t tag) {
+    add_frame(rec, FLAG_KEYFRAME, seq, 1, tag, 0);
+}
+
+static void add_command(recording *rec, uint8_t cmd, uint8_t value) {
+    encode_command(rec->buf + rec->len, cmd, value);
+    rec->len += CMD_SIZE;
+}
+
+static void add_resolution(recording *rec, uint16_t w, uint16_t h) {
+    encode_resolution(rec->buf + rec->len, w, h);
+    rec->len += RESOLUTION_CMD_SIZE;
+}
+
+// One keyframe, then P-frames; every frame distinct.
+static void gop(recording *rec, uint32_t first_seq, int n, int timing) {
+    add_frame(rec, FLAG_KEYFRAME, first_seq, 1, (uint8_t)first_seq, timing);
+    for (int i = 1; i < n; i++) add_frame(rec, 0, first_seq + (uint32_t)i, 0, (uint8_t)(first_seq + i), timing);
+}
+
+static int replay(const recording *rec, int64_t decode_us, mirror_replay_config *cfg,
+                  mirror_replay_result *res, mock_decoder *out_state) {
+    mock_decoder_config dcfg;
+    mock_decoder_default_config(&dcfg);
+    dcfg.decode_latency_us = decode_us;
+    dcfg.input_capacity = 4096;
+    mock_decoder d;
+    mock_decoder_init(&d, &dcfg);
+    mirror_decoder dec = { &mock_decoder_ops, &d };
+    int rc = mirror_replay_run(&dec, rec->buf, rec->len, cfg, res);
+    if (out_state) {
+        out_state->configures = d.configures;
+        out_state->width = d.width;
+        out_state->height = d.height;
+        out_state->codec = d.codec;
+    }
+    mock_decoder_free(&d);
+    return rc;
+}
+
+static void test_replay_reports_throughput_and_latency(void) {
+    static recording rec;
+    rec.len = 0;
+    gop(&rec, 0, 40, 1);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    mirror_replay_result res;
+    CHECK_EQ(replay(&rec, 1000, &cfg, &res, NULL), 0);
+    CHECK_EQ(res.frames, 40);
+    CHECK_EQ(res.decoded, 40);
+    CHECK_EQ(res.skipped, 0);
+    CHECK(res.checksums == NULL);
+    // Decode is serial at 1ms per frame and nothing waits for a display.
+    CHECK(res.fps > 300);
+    CHECK(res.fps < 1100);
+    CHECK(res.latency_ms_p50 >= 1.0);
+    CHECK(res.latency_ms_p50 <= res.latency_ms_p95);
+    CHECK(res.latency_ms_p95 <= res.latency_ms_max);
+    CHECK(res.latency_ms_avg <= res.latency_ms_max);
+    mirror_replay_result_free(&res);
+}
+
+static void test_checksums_are_deterministic(void) {
+    static recording timed, plain;
+    timed.len = plain.len = 0;
+    gop(&timed, 0, 12, 1);
+    gop(&plain, 0, 12, 0);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = 1;
+    mirror_replay_result a, b, c;
+    CHECK_EQ(replay(&timed, 200, &cfg, &a, NULL), 0);
+    CHECK_EQ(replay(&timed, 200, &cfg, &b, NULL), 0);
+    CHECK_EQ(replay(&plain, 200, &cfg, &c, NULL), 0);
+    CHECK_EQ(a.decoded, 12);
+    CHECK(memcmp(a.checksums, b.checksums, 12 * sizeof(uint32_t)) == 0);
+    // Timing blocks are not part of the picture.
+    CHECK(memcmp(a.checksums, c.checksums, 12 * sizeof(uint32_t)) == 0);
+    CHECK(a.checksums[0] != a.checksums[1]);
+    CHECK_EQ(a.mismatches, 0);
+    CHECK_EQ(a.first_mismatch, -1);
+    mirror_replay_result_free(&a);
+    mirror_replay_result_free(&b);
+    mirror_replay_result_free(&c);
+}
+
+static void test_golden_mismatch_is_reported(void) {
+    static recording rec;
+    rec.len = 0;
+    gop(&rec, 0, 10, 0);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = 1;
+    mirror_replay_result res;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, NULL), 0);
+
+    char path[] = "/tmp/test_replay_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    CHECK_EQ(mirror_replay_save_golden(path, res.checksums, res.decoded), 0);
+    uint32_t golden[16];
+    CHECK_EQ(mirror_replay_load_golden(path, golden, 16), 10);
+    unlink(path);
+    CHECK(memcmp(golden, res.checksums, 10 * sizeof(uint32_t)) == 0);
+    mirror_replay_result_free(&res);
+
+    // Same stream: no mismatches.
+    cfg.golden = golden;
+    cfg.n_golden = 10;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, NULL), 0);
+    CHECK_EQ(res.mismatches, 0);
+    mirror_replay_result_free(&res);
+
+    // One corrupted access unit.
+    rec.buf[4 * (FRAME_HEADER_SIZE + AU_LEN) + FRAME_HEADER_SIZE + 20] ^= 0xff;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, NULL), 0);
+    CHECK_EQ(res.mismatches, 1);
+    CHECK_EQ(res.first_mismatch, 4);
+    mirror_replay_result_free(&res);
+
+    // Golden values for frames that never decoded count too.
+    golden[10] = golden[11] = 0;
+    cfg.n_golden = 12;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, NULL), 0);
+    CHECK_EQ(res.mismatches, 3);
+    mirror_replay_result_free(&res);
+}
+
+static void test_grey_and_unjoined_frames_are_skipped(void) {
+    static recording rec;
+    rec.len = 0;
+    add_frame(&rec, 0, 0, 0, 1, 0);                 // P-frames before the first keyframe
+    add_frame(&rec, 0, 1, 0, 2, 0);
+    add_frame(&rec, FLAG_GREY_LZ4, 2, 0, 3, 0);
+    gop(&rec, 3, 5, 0);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    mirror_replay_result res;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, NULL), 0);
+    CHECK_EQ(res.skipped, 3);
+    CHECK_EQ(res.frames, 5);
+    CHECK_EQ(res.decoded, 5);
+    mirror_replay_result_free(&res);
+}
+
+static void test_stream_changes_reconfigure(void) {
+    static recording rec;
+    rec.len = 0;
+    add_resolution(&rec, 640, 480);                 // before any frame: the initial size
+    gop(&rec, 0, 4, 0);
+    add_resolution(&rec, 800, 600);
+    add_keyframe(&rec, 4, 4);
+    add_frame(&rec, 0, 5, 0, 5, 0);
+    add_command(&rec, CMD_BRIGHTNESS, 40);          // ignored
+    add_command(&rec, CMD_CODEC, MIRROR_CODEC_H264);
+    add_keyframe(&rec, 6, 6);
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = 1;
+    mirror_replay_result res;
+    mock_decoder d;
+    CHECK_EQ(replay(&rec, 200, &cfg, &res, &d), 0);
+    CHECK_EQ(res.reconfigures, 2);
+    CHECK_EQ(d.configures, 3);
+    CHECK_EQ(d.width, 800);
+    CHECK_EQ(d.height, 600);
+    CHECK(d.codec && d.codec->id == MIRROR_CODEC_H264);
+    // Frames in flight at each change drain before the decoder is rebuilt.
+    CHECK_EQ(res.decoded, 7);
+    mirror_replay_result_free(&res);
+}
+
+static void test_needs_memory_output(void) {
+    static recording rec;
+    rec.len = 0;
+    gop(&rec, 0, 3, 0);
+    mock_decoder_config dcfg;
+    mock_decoder_default_config(&dcfg);
+    mock_decoder d;
+    mock_decoder_init(&d, &dcfg);
+    mirror_decoder_ops ops = mock_decoder_ops;
+    ops.configure_memory = NULL;
+    mirror_decoder dec = { &ops, &d };
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    mirror_replay_result res;
+    CHECK_EQ(mirror_replay_run(&dec, rec.buf, rec.len, &cfg, &res), -1);
+
+    // A truncated recording is rejected before anything is decoded.
+    dec.ops = &mock_decoder_ops;
+    CHECK_EQ(mirror_replay_run(&dec, rec.buf, rec.len - 5, &cfg, &res), -1);
+    CHECK_EQ(d.configures, 0);
+    mock_decoder_free(&d);
+}
+
+static int configures_left;
+
+static int configure_once(void *ctx, const mirror_codec_info *codec, uint32_t width, uint32_t height) {
+    if (configures_left-- <= 0) return 0;
+    return mock_decoder_ops.configure_memory(ctx, codec, width, height);
+}
+
+static void test_failed_replay_frees_its_result(void) {
+    static recording rec;
+    rec.len = 0;
+    gop(&rec, 0, 3, 0);
+    add_resolution(&rec, 800, 600);                 // the rebuild fails
+    gop(&rec, 3, 3, 0);
+    mock_decoder_config dcfg;
+    mock_decoder_default_config(&dcfg);
+    mock_decoder d;
+    mock_decoder_init(&d, &dcfg);
+    mirror_decoder_ops ops = mock_decoder_ops;
+    ops.configure_memory = configure_once;
+    configures_left = 1;
+    mirror_decoder dec = { &ops, &d };
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = 1;
+    mirror_replay_result res;
+    CHECK_EQ(mirror_replay_run(&dec, rec.buf, rec.len, &cfg, &res), -1);
+    CHECK(res.checksums == NULL);
+    CHECK_EQ(res.decoded, 3);
+    mock_decoder_free(&d);
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_replay_reports_throughput_and_latency);
+    RUN_TEST(test_checksums_are_deterministic);
+    RUN_TEST(test_golden_mismatch_is_reported);
+    RUN_TEST(test_grey_and_unjoined_frames_are_skipped);
+    RUN_TEST(test_stream_changes_reconfigure);
+    RUN_TEST(test_needs_memory_output);
+    RUN_TEST(test_failed_replay_frees_its_result);
+    return TEST_EXIT();
+}
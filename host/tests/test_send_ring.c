@@ -0,0 +1,219 @@
+// test_send_ring.c — Send-timestamp ring: expiry, resets, and random operations
+// checked against a linear-scan model.
+
+#include "test_util.h"
+#include "send_ring.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(rng_state >> 33);
+}
+
+// MARK: - Model
+
+// What the old dictionary-based trackers did: remember every pending frame and
+// search them. A frame expires when a later send lands on its slot.
+#define MODEL_MAX 4096
+
+typedef struct {
+    uint32_t seq[MODEL_MAX];
+    int64_t sent_us[MODEL_MAX];
+    int n;
+    uint32_t mask;
+} model;
+
+static int model_find(const model *m, uint32_t seq) {
+    for (int i = 0; i < m->n; i++)
+        if (m->seq[i] == seq) return i;
+    return -1;
+}
+
+static void model_remove(model *m, int i) {
+    m->seq[i] = m->seq[m->n - 1];
+    m->sent_us[i] = m->sent_us[m->n - 1];
+    m->n--;
+}
+
+static void model_record(model *m, uint32_t seq, int64_t now_us) {
+    for (int i = 0; i < m->n; i++) {
+        if ((m->seq[i] & m->mask) == (seq & m->mask)) {
+            model_remove(m, i);
+            break;
+        }
+    }
+    m->seq[m->n] = seq;
+    m->sent_us[m->n] = now_us;
+    m->n++;
+}
+
+static int model_ack(model *m, uint32_t seq, int64_t *sent_us) {
+    int i = model_find(m, seq);
+    if (i < 0) return 0;
+    *sent_us = m->sent_us[i];
+    model_remove(m, i);
+    return 1;
+}
+
+// MARK: - Tests
+
+static void test_capacity_rounds_to_power_of_two(void) {
+    static const uint32_t cases[][2] = { { 0, 2 }, { 1, 2 }, { 2, 2 }, { 3, 4 },
+                                         { 300, 512 }, { 512, 512 }, { 513, 1024 } };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        send_ring r;
+        CHECK_EQ(send_ring_init(&r, cases[i][0]), 0);
+        CHECK_EQ(send_ring_capacity(&r), cases[i][1]);
+        CHECK_EQ(send_ring_inflight(&r), 0);
+        send_ring_free(&r);
+    }
+}
+
+static void test_ack_returns_send_time_once(void) {
+    send_ring r;
+    send_ring_init(&r, 8);
+    send_ring_record(&r, 10, 1000);
+    send_ring_record(&r, 11, 2000);
+    CHECK_EQ(send_ring_inflight(&r), 2);
+
+    int64_t sent = 0;
+    CHECK_EQ(send_ring_ack(&r, 11, &sent), 1);
+    CHECK_EQ(sent, 2000);
+    CHECK_EQ(send_ring_ack(&r, 11, &sent), 0);      // duplicate
+    CHECK_EQ(send_ring_ack(&r, 12, &sent), 0);      // never sent
+    CHECK_EQ(send_ring_ack(&r, 10 + 8, &sent), 0);  // same slot, different seq
+    CHECK_EQ(send_ring_inflight(&r), 1);
+    CHECK_EQ(send_ring_ack(&r, 10, NULL), 1);
+    CHECK_EQ(send_ring_inflight(&r), 0);
+    send_ring_free(&r);
+}
+
+static void test_unacked_frames_expire_after_capacity_sends(void) {
+    send_ring r;
+    send_ring_init(&r, 4);
+    for (uint32_t seq = 0; seq < 4; seq++) send_ring_record(&r, seq, seq);
+    CHECK_EQ(send_ring_inflight(&r), 4);
+    CHECK_EQ(r.expired, 0);
+
+    // Every further send pushes the oldest pending frame out.
+    for (uint32_t seq = 4; seq < 10; seq++) {
+        send_ring_record(&r, seq, seq);
+        CHECK_EQ(send_ring_inflight(&r), 4);
+    }
+    CHECK_EQ(r.expired, 6);
+    int64_t sent;
+    CHECK_EQ(send_ring_ack(&r, 5, &sent), 0);       // its slot now holds 9
+    CHECK_EQ(send_ring_ack(&r, 9, &sent), 1);
+    CHECK_EQ(sent, 9);
+
+    // An ACKed slot is free: reusing it expires nothing.
+    send_ring_record(&r, 13, 13);
+    CHECK_EQ(r.expired, 6);
+    CHECK_EQ(send_ring_inflight(&r), 4);
+    send_ring_free(&r);
+}
+
+static void test_reset_drops_pending_frames(void) {
+    send_ring r;
+    send_ring_init(&r, 16);
+    for (uint32_t seq = 100; seq < 110; seq++) send_ring_record(&r, seq, seq);
+    send_ring_reset(&r);
+    CHECK_EQ(send_ring_inflight(&r), 0);
+    CHECK_EQ(r.sent, 0);
+
+    int64_t sent;
+    CHECK_EQ(send_ring_ack(&r, 105, &sent), 0);     // ACK from the old connection
+    // Slots still hold the old frames' seqs; sending over them is not an expiry.
+    for (uint32_t seq = 100; seq < 110; seq++) send_ring_record(&r, seq, seq + 1000);
+    CHECK_EQ(r.expired, 0);
+    CHECK_EQ(send_ring_ack(&r, 105, &sent), 1);
+    CHECK_EQ(sent, 1105);
+    send_ring_free(&r);
+}
+
+static void test_seq_wraparound(void) {
+    send_ring r;
+    send_ring_init(&r, 8);
+    uint32_t seq = UINT32_MAX - 3;
+    for (int i = 0; i < 8; i++) send_ring_record(&r, seq + (uint32_t)i, i);
+    CHECK_EQ(send_ring_inflight(&r), 8);
+    int64_t sent;
+    CHECK_EQ(send_ring_ack(&r, UINT32_MAX, &sent), 1);
+    CHECK_EQ(sent, 3);
+    CHECK_EQ(send_ring_ack(&r, 2, &sent), 1);
+    CHECK_EQ(sent, 6);
+    CHECK_EQ(send_ring_inflight(&r), 6);
+    send_ring_free(&r);
+}
+
+// Random sends (mostly in order, with skips and restarts), ACKs of pending,
+// duplicate, expired and unknown frames, and resets: the ring and the model
+// must agree on every ACK and on inflight after every step.
+static void test_random_ops_match_model(void) {
+    static const uint32_t capacities[] = { 2, 8, 64, 256 };
+    static model m;
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        send_ring r;
+        CHECK_EQ(send_ring_init(&r, capacities[c]), 0);
+        memset(&m, 0, sizeof(m));
+        m.mask = capacities[c] - 1;
+
+        uint32_t next_seq = rng();
+        int64_t now = 0;
+        int mismatches = 0;
+        for (int step = 0; step < 200000 && mismatches < 5; step++) {
+            uint32_t op = rng() % 100;
+            now += rng() % 5000;
+            if (op < 50) {
+                // Send; now and then skip ahead (dropped encode) or go back
+                // (sender restarted its counter).
+                if (op == 0) next_seq += rng() % (3 * capacities[c]);
+                if (op == 1) next_seq -= rng() % 16;
+                send_ring_record(&r, next_seq, now);
+                model_record(&m, next_seq, now);
+                next_seq++;
+            } else if (op < 98) {
+                // ACK something recent (pending, already ACKed, expired or never
+                // sent), or once in a while a garbage seq.
+                uint32_t back = rng() % (2 * capacities[c] + 2);
+                uint32_t seq = op == 97 ? rng() : next_seq - 1 - back;
+                int64_t got = -1, want = -1;
+                int ok = send_ring_ack(&r, seq, &got);
+                int model_ok = model_ack(&m, seq, &want);
+                if (ok != model_ok || (ok && got != want)) {
+                    fprintf(stderr, "cap %u step %d: ack %u ring %d/%lld model %d/%lld\n",
+                            capacities[c], step, seq, ok, (long long)got,
+                            model_ok, (long long)want);
+                    mismatches++;
+                }
+            } else if (op < 99) {
+                send_ring_reset(&r);
+                m.n = 0;
+            }
+            if (send_ring_inflight(&r) != (uint32_t)m.n) {
+                fprintf(stderr, "cap %u step %d: inflight %u, model %d\n",
+                        capacities[c], step, send_ring_inflight(&r), m.n);
+                mismatches++;
+            }
+            CHECK(send_ring_inflight(&r) <= send_ring_capacity(&r));
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK_EQ(r.sent, r.acked + r.expired + send_ring_inflight(&r));
+        send_ring_free(&r);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_capacity_rounds_to_power_of_two);
+    RUN_TEST(test_ack_returns_send_time_once);
+    RUN_TEST(test_unacked_frames_expire_after_capacity_sends);
+    RUN_TEST(test_reset_drops_pending_frames);
+    RUN_TEST(test_seq_wraparound);
+    RUN_TEST(test_random_ops_match_model);
+    return TEST_EXIT();
+}
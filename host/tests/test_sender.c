@@ -0,0 +1,151 @@
+// test_sender.c — Linux sender frame server against the receiver core.
+
+#include "test_util.h"
+#include "grey_encoder.h"
+#include "host_util.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "sender_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define W 64
+#define H 48
+
+typedef struct {
+    volatile int presented;
+    uint8_t last[W * H];
+} grey_sink;
+
+static void sink_present(void *ctx, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    grey_sink *s = (grey_sink *)ctx;
+    if (width == W && height == H) memcpy(s->last, pixels, sizeof(s->last));
+    s->presented++;
+}
+
+static const mirror_platform_ops sink_ops = { .present_grey = sink_present };
+
+static int wait_for(volatile int *value, int target, int timeout_ms) {
+    int64_t deadline = mirror_now_us() + (int64_t)timeout_ms * 1000;
+    while (*value < target && mirror_now_us() < deadline) sleep_until_us(mirror_now_us() + 1000);
+    return *value >= target;
+}
+
+static void test_threshold_matches_swift(void) {
+    CHECK_EQ(sender_backpressure_threshold(0.5), 6);
+    CHECK_EQ(sender_backpressure_threshold(15.0), 6);
+    CHECK_EQ(sender_backpressure_threshold(30.0), 4);
+    CHECK_EQ(sender_backpressure_threshold(100.0), 2);
+}
+
+static void test_cached_keyframe_then_deltas(void) {
+    sender_server server;
+    CHECK_EQ(sender_server_start(&server, 0, W, H), 0);
+
+    grey_encoder enc;
+    grey_encoder_init(&enc, GREY_MODE_DELTA, W, H, 0);
+    uint8_t frame[W * H];
+    memset(frame, 0x40, sizeof(frame));
+    uint8_t flags;
+    size_t len;
+    const uint8_t *p = grey_encode(&enc, frame, 1, &flags, &len);
+    sender_server_broadcast(&server, p, len, flags, 0);  // no clients yet: cached only
+
+    mock_decoder dec;
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    mock_decoder_init(&dec, &cfg);
+    grey_sink sink = { 0 };
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &dec, &sink_ops, &sink);
+    r.realtime = 0;
+    mirror_receiver_start(&r, "127.0.0.1", server.port);
+
+    CHECK(sender_server_wait_for_client(&server));
+    CHECK(wait_for(&sink.presented, 1, 2000));
+    CHECK_EQ(sink.last[0], 0x40);
+    CHECK_EQ(r.frame_w, W);
+    CHECK_EQ(r.grey_active, 1);
+    // Joining asks the encoder for a fresh keyframe, once.
+    CHECK_EQ(sender_server_take_keyframe_request(&server), 1);
+    CHECK_EQ(sender_server_take_keyframe_request(&server), 0);
+
+    for (uint32_t seq = 1; seq <= 5; seq++) {
+        frame[seq * 100] = 0xFF;
+        p = grey_encode(&enc, frame, 0, &flags, &len);
+        CHECK_EQ(flags & FLAG_KEYFRAME, 0);
+        sender_server_broadcast(&server, p, len, flags, seq);
+    }
+    CHECK(wait_for(&sink.presented, 6, 2000));
+    CHECK(memcmp(sink.last, frame, sizeof(frame)) == 0);
+
+    // Every frame sent after the join is ACKed; the cached keyframe's ACK resets nothing.
+    int64_t deadline = mirror_now_us() + 2000000;
+    while (sender_server_acks(&server) < 5 && mirror_now_us() < deadline) {
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+    CHECK(sender_server_acks(&server) >= 5);
+    CHECK_EQ(sender_server_inflight(&server), 0);
+    CHECK(sender_server_rtt_avg_ms(&server, -1) >= 0);
+    CHECK_EQ(r.stats.grey_dropped, 0);
+
+    mirror_receiver_stop(&r);
+    mirror_receiver_free(&r);
+    mock_decoder_free(&dec);
+    sender_server_stop(&server);
+    grey_encoder_free(&enc);
+}
+
+// A receiver whose decoder watchdog fired sends [DA 7F 05 v] upstream, possibly
+// split across reads and mixed with ACKs; the encoder sees one keyframe request.
+static void test_upstream_keyframe_request(void) {
+    sender_server server;
+    CHECK_EQ(sender_server_start(&server, 0, W, H), 0);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)server.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    CHECK(sender_server_wait_for_client(&server));
+    CHECK_EQ(sender_server_take_keyframe_request(&server), 1);     // the join
+
+    uint8_t frame[W * H];
+    memset(frame, 0x10, sizeof(frame));
+    sender_server_broadcast(&server, frame, 16, 0, 7);
+
+    uint8_t up[2 + CMD_SIZE + ACK_SIZE];
+    up[0] = 0x55;                                                   // garbage
+    up[1] = MAGIC_FRAME_0;
+    up[2] = MAGIC_FRAME_0;                                          // resync
+    encode_command(up + 2, CMD_REQUEST_KEYFRAME, MIRROR_KEYFRAME_REASON_STALL);
+    encode_ack(up + 2 + CMD_SIZE, 7);
+    CHECK_EQ(write_all(fd, up, 5), 0);
+    sleep_until_us(mirror_now_us() + 20000);
+    CHECK_EQ(write_all(fd, up + 5, sizeof(up) - 5), 0);
+
+    int64_t deadline = mirror_now_us() + 2000000;
+    while (sender_server_acks(&server) < 1 && mirror_now_us() < deadline) {
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+    CHECK_EQ(sender_server_acks(&server), 1);
+    CHECK_EQ(sender_server_take_keyframe_request(&server), 1);
+    CHECK_EQ(sender_server_take_keyframe_request(&server), 0);
+
+    close(fd);
+    sender_server_stop(&server);
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_threshold_matches_swift);
+    RUN_TEST(test_cached_keyframe_then_deltas);
+    RUN_TEST(test_upstream_keyframe_request);
+    return TEST_EXIT();
+}
@@ -0,0 +1,190 @@
+// test_shm.c — Shared-memory rings and the sender/receiver over a shm link.
+
+#include "test_util.h"
+#include "grey_encoder.h"
+#include "host_util.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "sender_server.h"
+#include "shm_ring.h"
+#include "transport.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define MESSAGES 20000
+
+// Message i is (i % 1500) + 1 bytes of (uint8_t)(i + offset).
+static size_t message_len(int i) {
+    return (size_t)(i % 1500) + 1;
+}
+
+static void *producer_thread(void *arg) {
+    shm_ring *r = (shm_ring *)arg;
+    for (int i = 0; i < MESSAGES; i++) {
+        size_t n = message_len(i);
+        uint8_t *p = shm_ring_reserve(r, n);
+        if (!p) break;
+        for (size_t j = 0; j < n; j++) p[j] = (uint8_t)(i + j);
+        shm_ring_commit(r, n);
+    }
+    return NULL;
+}
+
+// A one-page ring wraps every few messages and makes both sides sleep on the
+// futexes constantly; every peeked message must still be contiguous and intact.
+static void test_ring_wraps_contiguously(void) {
+    shm_link l;
+    CHECK_EQ(shm_link_create(&l, 4096), 0);
+    CHECK_EQ(l.down.capacity, 4096);
+
+    pthread_t t;
+    pthread_create(&t, NULL, producer_thread, &l.down);
+    int bad = 0;
+    for (int i = 0; i < MESSAGES && !bad; i++) {
+        size_t n = message_len(i);
+        const uint8_t *p = shm_ring_peek(&l.down, n);
+        if (!p) {
+            bad = 1;
+            break;
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (p[j] != (uint8_t)(i + j)) bad = 1;
+        }
+        shm_ring_release(&l.down);
+    }
+    pthread_join(t, NULL);
+    CHECK(!bad);
+    shm_link_free(&l);
+}
+
+static void test_close_drains_then_fails(void) {
+    shm_link l;
+    CHECK_EQ(shm_link_create(&l, 8192), 0);
+    CHECK_EQ(shm_ring_write(&l.down, "abcdef", 6), 0);
+    shm_link_close(&l);
+    uint8_t buf[6];
+    CHECK_EQ(shm_ring_read(&l.down, buf, 4), 0);   // queued bytes survive the close
+    CHECK(memcmp(buf, "abcd", 4) == 0);
+    CHECK_EQ(shm_ring_read(&l.down, buf, 4), -1);  // only 2 left, and never more
+    CHECK(shm_ring_reserve(&l.down, 1) == NULL);
+    CHECK(shm_ring_reserve(&l.down, 8193) == NULL);
+    shm_link_free(&l);
+}
+
+static void test_open_by_path_shares_memory(void) {
+    shm_link a, b;
+    CHECK_EQ(shm_link_create(&a, 65536), 0);
+    char path[64];
+    shm_link_path(&a, path, sizeof(path));
+    CHECK_EQ(shm_link_open_path(&b, path), 0);
+    CHECK_EQ(b.down.capacity, 65536);
+
+    CHECK_EQ(shm_link_wait_attached(&a, 0), 0);
+    shm_link_accept(&b);
+    CHECK_EQ(shm_link_wait_attached(&a, 0), 1);
+
+    CHECK_EQ(shm_ring_write(&a.down, "frame", 5), 0);
+    CHECK_EQ(shm_ring_write(&b.up, "ack!", 4), 0);
+    uint8_t buf[5];
+    CHECK_EQ(shm_ring_read(&b.down, buf, 5), 0);
+    CHECK(memcmp(buf, "frame", 5) == 0);
+    CHECK_EQ(shm_ring_read(&a.up, buf, 4), 0);
+    CHECK(memcmp(buf, "ack!", 4) == 0);
+    shm_link_free(&b);
+    shm_link_free(&a);
+}
+
+// MARK: - Sender → receiver over shm
+
+#define W 96
+#define H 64
+
+typedef struct {
+    volatile int presented;
+    uint8_t last[W * H];
+} grey_sink;
+
+static void sink_present(void *ctx, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    grey_sink *s = (grey_sink *)ctx;
+    if (width == W && height == H) memcpy(s->last, pixels, sizeof(s->last));
+    s->presented++;
+}
+
+static const mirror_platform_ops sink_ops = { .present_grey = sink_present };
+
+static void *session_thread(void *arg) {
+    mirror_receiver_session((mirror_receiver *)arg, -1);
+    return NULL;
+}
+
+static void test_sender_to_receiver_zero_copy(void) {
+    sender_server server;
+    CHECK_EQ(sender_server_start(&server, 0, W, H), 0);
+    shm_link link;
+    CHECK_EQ(shm_link_create(&link, 1 << 20), 0);
+    CHECK_EQ(sender_server_attach_shm(&server, &link), 0);
+
+    mock_decoder dec;
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    mock_decoder_init(&dec, &cfg);
+    grey_sink sink = { 0 };
+    host_transport reader;
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &dec, &sink_ops, &sink);
+    host_transport_init_shm(&reader, &link);
+    r.transport.ops = host_transport_ops_for(&reader);
+    r.transport.ctx = &reader;
+    r.realtime = 0;
+    r.running = 1;
+    pthread_t t;
+    pthread_create(&t, NULL, session_thread, &r);
+    CHECK(sender_server_wait_for_client(&server));
+
+    grey_encoder enc;
+    grey_encoder_init(&enc, GREY_MODE_TILES, W, H, 32);
+    uint8_t frame[W * H];
+    memset(frame, 0x30, sizeof(frame));
+    for (uint32_t seq = 0; seq < 50; seq++) {
+        frame[(seq * 131) % sizeof(frame)] = (uint8_t)seq;
+        uint8_t flags;
+        uint8_t *dst = sender_server_frame_buffer(&server, enc.out_capacity);
+        // Encoded in place: the buffer lent out is ring memory.
+        CHECK(dst >= link.map && dst < link.map + link.map_size);
+        size_t len = grey_encode_into(&enc, frame, seq == 0, dst, enc.out_capacity, &flags);
+        CHECK(len > 0);
+        sender_server_commit_frame(&server, len, flags, seq);
+    }
+
+    int64_t deadline = mirror_now_us() + 2000000;
+    while (sender_server_acks(&server) < 50 && mirror_now_us() < deadline) {
+        sleep_until_us(mirror_now_us() + 1000);
+    }
+    CHECK_EQ(sender_server_acks(&server), 50);
+    CHECK_EQ(sender_server_inflight(&server), 0);
+    CHECK_EQ(sink.presented, 50);
+    CHECK(memcmp(sink.last, frame, sizeof(frame)) == 0);
+    CHECK_EQ(r.frame_w, W);
+    CHECK_EQ(r.stats.grey_dropped, 0);
+
+    sender_server_stop(&server);    // closes the link; the session ends
+    pthread_join(t, NULL);
+    CHECK_EQ(r.stats.frames, 50);
+
+    mirror_receiver_free(&r);
+    host_transport_free(&reader);
+    mock_decoder_free(&dec);
+    grey_encoder_free(&enc);
+    shm_link_free(&link);
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_ring_wraps_contiguously);
+    RUN_TEST(test_close_drains_then_fails);
+    RUN_TEST(test_open_by_path_shares_memory);
+    RUN_TEST(test_sender_to_receiver_zero_copy);
+    return TEST_EXIT();
+}
@@ -0,0 +1,220 @@
+// test_transport.c — Blocking, epoll and io_uring readers return the same bytes.
+
+#include "test_util.h"
+#include "host_util.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "transport.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define STREAM_BYTES (3 * 1024 * 1024)
+
+static uint8_t pattern_byte(size_t i) {
+    return (uint8_t)(i * 2654435761u >> 13);
+}
+
+typedef struct {
+    int fd;
+    uint64_t seed;
+} writer_args;
+
+// Write the pattern in uneven chunks (1 byte .. 200 KB), then close.
+static void *writer_thread(void *arg) {
+    writer_args *w = (writer_args *)arg;
+    uint8_t *chunk = (uint8_t *)malloc(200 * 1024);
+    size_t off = 0;
+    uint64_t x = w->seed;
+    while (off < STREAM_BYTES) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        size_t n = (x >> 33) % 3 == 0 ? 1 + (x >> 40) % 16 : 1 + (x >> 40) % (200 * 1024);
+        if (n > STREAM_BYTES - off) n = STREAM_BYTES - off;
+        for (size_t i = 0; i < n; i++) chunk[i] = pattern_byte(off + i);
+        if (write_all(w->fd, chunk, n) < 0) break;
+        off += n;
+    }
+    free(chunk);
+    close(w->fd);
+    return NULL;
+}
+
+static void check_stream(transport_kind kind) {
+    host_transport t;
+    CHECK_EQ(host_transport_init(&t, kind), 0);
+    CHECK_EQ(t.kind, kind);
+
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    writer_args w = { sv[1], 7 };
+    pthread_t thread;
+    pthread_create(&thread, NULL, writer_thread, &w);
+
+    CHECK_EQ(host_transport_ops.attach(&t, sv[0]), 0);
+    uint8_t *buf = (uint8_t *)malloc(600 * 1024);
+    size_t off = 0;
+    uint64_t x = 99;
+    int bad = 0;
+    // Mix of header-sized and payload-sized requests, like the receive loop.
+    while (off < STREAM_BYTES) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        size_t n = (x >> 33) % 2 ? 1 + (x >> 40) % 11 : 1 + (x >> 40) % (600 * 1024);
+        if (n > STREAM_BYTES - off) n = STREAM_BYTES - off;
+        if (host_transport_ops.read(&t, sv[0], buf, (int)n) != (int)n) {
+            bad = 1;
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (buf[i] != pattern_byte(off + i)) bad = 1;
+        }
+        if (bad) break;
+        off += n;
+    }
+    CHECK(!bad);
+    CHECK_EQ(off, STREAM_BYTES);
+    CHECK_EQ(t.stats.bytes, STREAM_BYTES);
+    // Writer closed: the next read reports end of stream.
+    CHECK_EQ(host_transport_ops.read(&t, sv[0], buf, 1), -1);
+    host_transport_ops.detach(&t);
+
+    pthread_join(thread, NULL);
+    close(sv[0]);
+    free(buf);
+    host_transport_free(&t);
+}
+
+static void test_blocking_stream(void) { check_stream(TRANSPORT_BLOCKING); }
+static void test_epoll_stream(void) { check_stream(TRANSPORT_EPOLL); }
+
+static void test_uring_stream(void) {
+    struct uring_reader *u = uring_reader_create();
+    if (!u) {
+        printf("SKIP test_uring_stream: io_uring unavailable\n");
+        return;
+    }
+    uring_reader_destroy(u);
+    check_stream(TRANSPORT_URING);
+}
+
+static void test_uring_falls_back_to_epoll(void) {
+    transport_disable_uring = 1;
+    host_transport t;
+    CHECK_EQ(host_transport_init(&t, TRANSPORT_URING), 0);
+    CHECK_EQ(t.kind, TRANSPORT_EPOLL);
+    host_transport_free(&t);
+    transport_disable_uring = 0;
+}
+
+// Detaching mid-stream (session aborted on a bad packet) must leave the reader
+// reusable on the next connection, with nothing from the old socket leaking in.
+static void test_reattach_after_abort(void) {
+    for (int k = TRANSPORT_BLOCKING; k <= TRANSPORT_URING; k++) {
+        host_transport t;
+        CHECK_EQ(host_transport_init(&t, (transport_kind)k), 0);
+        for (int round = 0; round < 3; round++) {
+            int sv[2];
+            CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+            uint8_t data[4096];
+            memset(data, 0xA0 + round, sizeof(data));
+            write_all(sv[1], data, sizeof(data));
+
+            CHECK_EQ(host_transport_ops.attach(&t, sv[0]), 0);
+            uint8_t b[16];
+            CHECK_EQ(host_transport_ops.read(&t, sv[0], b, sizeof(b)), (int)sizeof(b));
+            CHECK_EQ(b[0], 0xA0 + round);
+            CHECK_EQ(b[15], 0xA0 + round);
+            host_transport_ops.detach(&t);  // 4080 bytes left unread
+            close(sv[0]);
+            close(sv[1]);
+        }
+        host_transport_free(&t);
+    }
+}
+
+typedef struct {
+    mirror_receiver *r;
+    int sock;
+} session_arg;
+
+static void *session_thread(void *arg) {
+    session_arg *s = (session_arg *)arg;
+    mirror_receiver_session(s->r, s->sock);
+    return NULL;
+}
+
+// Full receive loop over each backend: frames, commands and ACKs.
+static void test_receiver_over_each_transport(void) {
+    for (int k = TRANSPORT_BLOCKING; k <= TRANSPORT_URING; k++) {
+        host_transport t;
+        CHECK_EQ(host_transport_init(&t, (transport_kind)k), 0);
+
+        mock_decoder dec;
+        mock_decoder_config cfg;
+        mock_decoder_default_config(&cfg);
+        cfg.decode_latency_us = 0;
+        mock_decoder_init(&dec, &cfg);
+        mirror_receiver r;
+        mirror_receiver_init(&r, &mock_decoder_ops, &dec, NULL, NULL);
+        r.realtime = 0;
+        r.running = 1;
+        r.transport.ops = &host_transport_ops;
+        r.transport.ctx = &t;
+        mirror_receiver_create_decoder(&r, r.frame_w, r.frame_h);
+
+        int sv[2];
+        CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+        session_arg sa = { &r, sv[1] };
+        pthread_t thread;
+        pthread_create(&thread, NULL, session_thread, &sa);
+
+        uint8_t payload[3000];
+        memset(payload, 0, sizeof(payload));
+        payload[3] = 0x01;
+        for (uint32_t seq = 0; seq < 100; seq++) {
+            uint8_t hdr[FRAME_HEADER_SIZE];
+            encode_frame_header(hdr, seq == 0 ? FLAG_KEYFRAME : 0, seq, sizeof(payload));
+            write_all(sv[0], hdr, sizeof(hdr));
+            write_all(sv[0], payload, sizeof(payload));
+            if (seq == 50) {
+                uint8_t cmd[CMD_SIZE];
+                encode_command(cmd, CMD_BRIGHTNESS, 128);
+                write_all(sv[0], cmd, sizeof(cmd));
+            }
+        }
+        int acks = 0;
+        uint8_t ack[ACK_SIZE];
+        while (acks < 100 && read_all(sv[0], ack, sizeof(ack)) == 0) {
+            CHECK_EQ(read_le32(ack + 2), (uint32_t)acks);
+            acks++;
+        }
+        shutdown(sv[0], SHUT_WR);
+        pthread_join(thread, NULL);
+
+        CHECK_EQ(acks, 100);
+        CHECK_EQ(r.stats.frames, 100);
+        CHECK_EQ(r.stats.commands, 1);
+        CHECK_EQ(t.stats.bytes, 100 * (FRAME_HEADER_SIZE + sizeof(payload)) + CMD_SIZE);
+
+        close(sv[0]);
+        close(sv[1]);
+        mirror_receiver_free(&r);
+        mock_decoder_free(&dec);
+        host_transport_free(&t);
+    }
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_blocking_stream);
+    RUN_TEST(test_epoll_stream);
+    RUN_TEST(test_uring_stream);
+    RUN_TEST(test_uring_falls_back_to_epoll);
+    RUN_TEST(test_reattach_after_abort);
+    RUN_TEST(test_receiver_over_each_transport);
+    return TEST_EXIT();
+}
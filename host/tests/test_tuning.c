@@ -0,0 +1,302 @@
+// test_tuning.c — Decoder tuning profiles, calibration on the mock decoder, cache file.
+
+#include "test_util.h"
+#include "mirror_common.h"
+#include "mirror_receiver.h"
+#include "mirror_tuning.h"
+#include "mock_decoder.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Mock decode time and failure stand in for vendor keys.
+static const mirror_format_key slow_keys[] = { { "mock-decode-us", 6000 }, { NULL, 0 } };
+static const mirror_format_key fast_keys[] = { { "mock-decode-us", 1000 }, { NULL, 0 } };
+static const mirror_format_key fail_keys[] = { { "mock-fail", 1 }, { NULL, 0 } };
+
+static const mirror_tuning_variant mixed_variants[] = {
+    { "slow", slow_keys },
+    { "broken", fail_keys },
+    { "fast", fast_keys },
+    { NULL, NULL },
+};
+static const mirror_tuning_variant slow_variants[] = { { "slow", slow_keys }, { NULL, NULL } };
+static const mirror_tuning_variant broken_variants[] = { { "broken", fail_keys }, { NULL, NULL } };
+
+static const mirror_tuning_profile test_profiles[] = {
+    { "mock", "h264", mixed_variants },
+    { "mock", "hevc", slow_variants },
+    { "mock", "av1", broken_variants },
+    { NULL, NULL, NULL },
+};
+
+static void mock_init(mock_decoder *d) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.input_capacity = 64 * 1024;
+    mock_decoder_init(d, &cfg);
+}
+
+static int has_key(const mirror_codec_info *codec, const char *key, int32_t value) {
+    for (const mirror_format_key *k = codec->keys; k->key; k++) {
+        if (strcmp(k->key, key) == 0 && k->value == value) return 1;
+    }
+    return 0;
+}
+
+static void test_candidates_follow_soc_and_codec(void) {
+    mirror_tuning t;
+    const mirror_tuning_variant *v[MIRROR_TUNING_MAX_CANDIDATES];
+
+    // MediaTek: vendor variants first, then the generic ones.
+    mirror_tuning_init(&t, NULL, "MT6789", "fp", NULL);
+    int n = mirror_tuning_candidates(&t, mirror_codec_get(MIRROR_CODEC_HEVC), v, MIRROR_TUNING_MAX_CANDIDATES);
+    CHECK_EQ(n, 4);
+    CHECK(strcmp(v[0]->name, "mtk-lowlatency") == 0);
+    CHECK(strcmp(v[n - 1]->name, "realtime") == 0);
+
+    // Qualcomm keys only apply to H.264/HEVC.
+    mirror_tuning_init(&t, NULL, "SM8450", "fp", NULL);
+    n = mirror_tuning_candidates(&t, mirror_codec_get(MIRROR_CODEC_H264), v, MIRROR_TUNING_MAX_CANDIDATES);
+    CHECK_EQ(n, 4);
+    CHECK(strcmp(v[0]->name, "qti-lowlatency") == 0);
+    n = mirror_tuning_candidates(&t, mirror_codec_get(MIRROR_CODEC_AV1), v, MIRROR_TUNING_MAX_CANDIDATES);
+    CHECK_EQ(n, 2);
+    CHECK(strcmp(v[0]->name, "default") == 0);
+
+    // Unknown SoC: generic only. Before calibration every codec has its defaults.
+    mirror_tuning_init(&t, NULL, "", "fp", NULL);
+    CHECK_EQ(mirror_tuning_candidates(&t, mirror_codec_get(MIRROR_CODEC_HEVC), v, 8), 2);
+    CHECK(has_key(mirror_tuning_codec(&t, MIRROR_CODEC_HEVC), "low-latency", 1));
+    CHECK(strcmp(mirror_tuning_codec(&t, MIRROR_CODEC_AV1)->mime, "video/av01") == 0);
+}
+
+static void test_embedded_streams(void) {
+    for (uint8_t id = 0; id < MIRROR_CODEC_COUNT; id++) {
+        const mirror_test_stream *ts = mirror_test_stream_get(id);
+        CHECK(ts != NULL);
+        if (!ts) continue;
+        CHECK_EQ(ts->frames, 8);
+        CHECK_EQ(ts->width, 176);
+        CHECK_EQ(ts->height, 144);
+        // The keyframe comes first and is the largest access unit.
+        for (int i = 1; i < ts->frames; i++) CHECK(ts->sizes[i] > 0 && ts->sizes[i] < ts->sizes[0]);
+    }
+    // HEVC opens with a VPS, H.264 with an SPS, AV1 with a temporal delimiter.
+    static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+    const mirror_test_stream *hevc = mirror_test_stream_get(MIRROR_CODEC_HEVC);
+    CHECK(memcmp(hevc->data, start_code, 4) == 0 && (hevc->data[4] >> 1) == 32);
+    const mirror_test_stream *avc = mirror_test_stream_get(MIRROR_CODEC_H264);
+    CHECK(memcmp(avc->data, start_code, 4) == 0 && (avc->data[4] & 0x1F) == 7);
+    CHECK_EQ(mirror_test_stream_get(MIRROR_CODEC_AV1)->data[0], 0x12);
+    CHECK(mirror_test_stream_get(MIRROR_CODEC_COUNT) == NULL);
+}
+
+static void test_calibration_keeps_fastest_variant(void) {
+    mock_decoder d;
+    mock_init(&d);
+    mirror_decoder dec = { &mock_decoder_ops, &d };
+    mirror_tuning t;
+    mirror_tuning_init(&t, test_profiles, "mock-1", "fp", NULL);
+
+    CHECK(mirror_tuning_calibrate(&t, &dec, MIRROR_CODEC_H264));
+    const mirror_tuned_codec *tc = &t.codecs[MIRROR_CODEC_H264];
+    CHECK_EQ(tc->state, MIRROR_TUNE_OK);
+    CHECK(tc->variant && strcmp(tc->variant->name, "fast") == 0);
+    CHECK(tc->latency_us >= 1000 && tc->latency_us < 6000);
+    // Codec defaults stay, the variant's keys are added.
+    const mirror_codec_info *codec = mirror_tuning_codec(&t, MIRROR_CODEC_H264);
+    CHECK(has_key(codec, "low-latency", 1));
+    CHECK(has_key(codec, "mock-decode-us", 1000));
+    // Two variants configured (the broken one never did); decoder left released.
+    CHECK_EQ(d.configures, 2);
+    CHECK_EQ(d.configured, 0);
+    CHECK_EQ(d.queued, 2 * 2 * 8);
+
+    CHECK(!mirror_tuning_calibrate(&t, &dec, MIRROR_CODEC_AV1));
+    CHECK_EQ(t.codecs[MIRROR_CODEC_AV1].state, MIRROR_TUNE_FAILED);
+    CHECK(!has_key(mirror_tuning_codec(&t, MIRROR_CODEC_AV1), "mock-fail", 1));
+    mock_decoder_free(&d);
+}
+
+static void test_rank_by_latency(void) {
+    mirror_tuning t;
+    mirror_tuning_init(&t, test_profiles, "mock-1", "fp", NULL);
+    t.codecs[MIRROR_CODEC_HEVC].state = MIRROR_TUNE_OK;
+    t.codecs[MIRROR_CODEC_HEVC].latency_us = 4000;
+    t.codecs[MIRROR_CODEC_H264].state = MIRROR_TUNE_OK;
+    t.codecs[MIRROR_CODEC_H264].latency_us = 1500;
+    t.codecs[MIRROR_CODEC_AV1].state = MIRROR_TUNE_FAILED;
+
+    uint8_t codecs[] = { MIRROR_CODEC_AV1, MIRROR_CODEC_HEVC, MIRROR_CODEC_H264 };
+    CHECK_EQ(mirror_tuning_rank(&t, codecs, 3), 2);
+    CHECK_EQ(codecs[0], MIRROR_CODEC_H264);
+    CHECK_EQ(codecs[1], MIRROR_CODEC_HEVC);
+
+    // Uncalibrated codecs go after calibrated ones, in their given order.
+    t.codecs[MIRROR_CODEC_AV1].state = MIRROR_TUNE_NONE;
+    t.codecs[MIRROR_CODEC_H264].state = MIRROR_TUNE_NONE;
+    uint8_t more[] = { MIRROR_CODEC_AV1, MIRROR_CODEC_H264, MIRROR_CODEC_HEVC };
+    CHECK_EQ(mirror_tuning_rank(&t, more, 3), 3);
+    CHECK_EQ(more[0], MIRROR_CODEC_HEVC);
+    CHECK_EQ(more[1], MIRROR_CODEC_AV1);
+    CHECK_EQ(more[2], MIRROR_CODEC_H264);
+}
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+static void test_cache_round_trip_and_rejects(void) {
+    char path[] = "/tmp/test_tuning_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    mirror_tuning t;
+    mirror_tuning_init(&t, test_profiles, "mock-1", "build/1", NULL);
+    mirror_tuned_codec *h264 = &t.codecs[MIRROR_CODEC_H264];
+    h264->variant = &mixed_variants[2];
+    h264->state = MIRROR_TUNE_OK;
+    h264->latency_us = 1234;
+    t.codecs[MIRROR_CODEC_AV1].state = MIRROR_TUNE_FAILED;
+    CHECK(mirror_tuning_save(&t, path));
+
+    mirror_tuning in;
+    mirror_tuning_init(&in, test_profiles, "mock-1", "build/1", NULL);
+    CHECK(mirror_tuning_load(&in, path));
+    CHECK_EQ(in.codecs[MIRROR_CODEC_H264].state, MIRROR_TUNE_OK);
+    CHECK_EQ(in.codecs[MIRROR_CODEC_H264].latency_us, 1234);
+    CHECK(has_key(mirror_tuning_codec(&in, MIRROR_CODEC_H264), "mock-decode-us", 1000));
+    CHECK_EQ(in.codecs[MIRROR_CODEC_AV1].state, MIRROR_TUNE_FAILED);
+    CHECK_EQ(in.codecs[MIRROR_CODEC_HEVC].state, MIRROR_TUNE_NONE);
+
+    // A system update (new fingerprint) or a different SoC string recalibrates.
+    mirror_tuning stale;
+    mirror_tuning_init(&stale, test_profiles, "mock-1", "build/2", NULL);
+    CHECK(!mirror_tuning_load(&stale, path));
+    mirror_tuning_init(&stale, test_profiles, "mock-2", "build/1", NULL);
+    CHECK(!mirror_tuning_load(&stale, path));
+    CHECK_EQ(stale.codecs[MIRROR_CODEC_H264].state, MIRROR_TUNE_NONE);
+
+    // Variants that no longer exist, truncated and foreign files are rejected.
+    write_file(path, "daylight-mirror-tuning 1\nfingerprint build/1\nsoc mock-1\ncodec h264 gone 10\n");
+    CHECK(!mirror_tuning_load(&in, path));
+    write_file(path, "daylight-mirror-tuning 1\nfingerprint build/1\n");
+    CHECK(!mirror_tuning_load(&in, path));
+    write_file(path, "daylight-mirror-tuning 99\nfingerprint build/1\nsoc mock-1\n");
+    CHECK(!mirror_tuning_load(&in, path));
+    write_file(path, "\x01\x02garbage");
+    CHECK(!mirror_tuning_load(&in, path));
+    unlink(path);
+    CHECK(!mirror_tuning_load(&in, path));
+    // A rejected file leaves the loaded tuning alone.
+    CHECK_EQ(in.codecs[MIRROR_CODEC_H264].latency_us, 1234);
+}
+
+static void test_receiver_tunes_once_and_ranks(void) {
+    char path[] = "/tmp/test_tuning_XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+
+    mock_decoder d;
+    mock_init(&d);
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &d, NULL, NULL);
+    uint8_t advertised[] = { MIRROR_CODEC_HEVC, MIRROR_CODEC_H264, MIRROR_CODEC_AV1 };
+    memcpy(r.codecs, advertised, sizeof(advertised));
+    r.n_codecs = 3;
+    mirror_tuning t;
+    mirror_tuning_init(&t, test_profiles, "mock-1", "build/1", path);
+    mirror_receiver_set_tuning(&r, &t);
+    CHECK(mirror_receiver_create_decoder(&r, 640, 480));
+
+    mirror_receiver_tune(&r);
+    CHECK(t.ready);
+    // H.264 decoded fastest; AV1 failed and is no longer advertised.
+    CHECK_EQ(r.n_codecs, 2);
+    CHECK_EQ(r.codecs[0], MIRROR_CODEC_H264);
+    CHECK_EQ(r.codecs[1], MIRROR_CODEC_HEVC);
+    // The stream decoder is rebuilt at stream size with the tuned HEVC keys.
+    CHECK(r.codec_ready);
+    CHECK(d.configured);
+    CHECK_EQ(d.width, 640);
+    CHECK(d.codec == mirror_tuning_codec(&t, MIRROR_CODEC_HEVC));
+    CHECK(has_key(d.codec, "mock-decode-us", 6000));
+    CHECK(access(path, R_OK) == 0);
+
+    // A second launch loads the cache instead of calibrating.
+    uint64_t configures = d.configures;
+    mirror_tuning again;
+    mirror_tuning_init(&again, test_profiles, "mock-1", "build/1", path);
+    memcpy(r.codecs, advertised, sizeof(advertised));
+    r.n_codecs = 3;
+    mirror_receiver_set_tuning(&r, &again);
+    mirror_receiver_tune(&r);
+    CHECK_EQ(d.configures, configures + 1);
+    CHECK_EQ(r.n_codecs, 2);
+    CHECK_EQ(r.codecs[0], MIRROR_CODEC_H264);
+
+    mirror_receiver_free(&r);
+    mock_decoder_free(&d);
+    unlink(path);
+}
+
+static void *tune_thread(void *arg) {
+    mirror_receiver_tune((mirror_receiver *)arg);
+    return NULL;
+}
+
+static void test_detach_does_not_wait_for_calibration(void) {
+    mock_decoder d;
+    mock_init(&d);
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &d, NULL, NULL);
+    r.codecs[0] = MIRROR_CODEC_HEVC;
+    r.n_codecs = 1;
+    mirror_tuning t;
+    mirror_tuning_init(&t, test_profiles, "mock-1", "build/1", "");
+    mirror_receiver_set_tuning(&r, &t);
+    CHECK(mirror_receiver_create_decoder(&r, 640, 480));
+
+    // The slow HEVC variant keeps calibration busy for a while.
+    pthread_t thread;
+    int64_t t0 = mirror_now_us();
+    pthread_create(&thread, NULL, tune_thread, &r);
+    while (!r.calibrating && mirror_now_us() - t0 < 1000000) usleep(100);
+    int64_t start = mirror_now_us();
+    mirror_receiver_detach_output(&r);
+    CHECK(mirror_now_us() - start < 20000);
+    CHECK(r.calibrating);
+    // Calibration decodes to memory, never onto the detached Surface.
+    CHECK(d.to_memory);
+    CHECK(!mirror_receiver_attach_output(&r));
+    pthread_join(thread, NULL);
+
+    // The attach's build was deferred to the end of calibration.
+    CHECK(t.ready);
+    CHECK(r.codec_ready);
+    CHECK(!d.to_memory);
+    CHECK_EQ(d.width, 640);
+    CHECK(d.codec == mirror_tuning_codec(&t, MIRROR_CODEC_HEVC));
+
+    mirror_receiver_free(&r);
+    mock_decoder_free(&d);
+}
+
+int main(void) {
+    mirror_log_quiet = 1;
+    RUN_TEST(test_candidates_follow_soc_and_codec);
+    RUN_TEST(test_embedded_streams);
+    RUN_TEST(test_calibration_keeps_fastest_variant);
+    RUN_TEST(test_rank_by_latency);
+    RUN_TEST(test_cache_round_trip_and_rejects);
+    RUN_TEST(test_receiver_tunes_once_and_ranks);
+    RUN_TEST(test_detach_does_not_wait_for_calibration);
+    return TEST_EXIT();
+}
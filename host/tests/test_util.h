@@ -0,0 +1,34 @@
+// test_util.h — Minimal assertion helpers for the host C tests (run via ctest).
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", \
+                __FILE__, __LINE__, #a, #b, _a, _b); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    int _before = test_failures; \
+    fn(); \
+    printf("%s %s\n", test_failures == _before ? "PASS" : "FAIL", #fn); \
+} while (0)
+
+#define TEST_EXIT() (test_failures == 0 ? 0 : 1)
+
+#endif
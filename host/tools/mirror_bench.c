@@ -0,0 +1,805 @@
+// mirror_bench.c — Microbenchmarks for the host-buildable pipeline, with a baseline gate.
+//
+// One case per stage, named <stage>.<what>, each timed as ns per operation:
+//
+//   parser.*   receiver session parsing a recorded typing stream (frames and
+//              commands) from memory into a null decoder; op = one frame
+//   ring.*     shm_ring reserve/commit/peek/release — the frame buffers the
+//              sender encodes into and the receiver decodes from; op = one frame
+//   nal.*      AVCC length-prefixed slices → Annex B iovecs (frame_iov)
+//   pixels.*   BGRA → grey, SIMD and scalar; op = one 1280x800 frame
+//   lz4.*      grey encoder and mirror_grey decoder, keyframes and typing-sized
+//              deltas in both payload layouts; op = one 1280x800 frame
+//   ack.*      sender_server → receiver → ACK back, tiny frames, 64 in flight;
+//              op = one acknowledged frame
+//   e2e.*      grey encode → link → decode → ACK over shared memory and TCP
+//              loopback; op = one acknowledged frame
+//
+//   mirror_bench --json results.json
+//   mirror_bench --baseline host/bench_baseline.json --tolerance 15
+//   mirror_bench compare old.json new.json
+//
+// With --baseline the run fails (exit 1) if any case's best run is more than
+// --tolerance percent slower than the baseline's. A case that looks regressed is
+// measured up to twice more before it counts, so one noisy run does not fail the
+// gate. Baselines are machine-specific: regenerate with --json on the machine
+// that runs the gate.
+
+#include "bench.h"
+#include "framing.h"
+#include "grey_convert.h"
+#include "grey_encoder.h"
+#include "host_util.h"
+#include "loadgen.h"
+#include "mirror_grey.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "sender_server.h"
+#include "shm_ring.h"
+#include "transport.h"
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#define W 1280
+#define H 800
+#define PIPELINE_WINDOW 64
+#define REGRESSION_RETRIES 2
+
+// MARK: - Null decoder
+
+// Accepts every access unit instantly, so parser and ACK cases measure the
+// receiver rather than the mock decoder's slot model.
+static uint8_t null_input[1 << 20];
+
+static int null_configure(void *ctx, const mirror_codec_info *codec, uint32_t w, uint32_t h) {
+    (void)ctx; (void)codec; (void)w; (void)h;
+    return 1;
+}
+static void null_release(void *ctx) { (void)ctx; }
+static ssize_t null_dequeue_input(void *ctx, int64_t timeout_us) {
+    (void)ctx; (void)timeout_us;
+    return 0;
+}
+static uint8_t *null_get_input(void *ctx, size_t idx, size_t *capacity) {
+    (void)ctx; (void)idx;
+    *capacity = sizeof(null_input);
+    return null_input;
+}
+static int null_queue_input(void *ctx, size_t idx, size_t len, int64_t pts_us, uint32_t flags) {
+    (void)ctx; (void)idx; (void)len; (void)pts_us; (void)flags;
+    return 0;
+}
+static ssize_t null_dequeue_output(void *ctx, mirror_output_info *info, int64_t timeout_us) {
+    (void)ctx; (void)info; (void)timeout_us;
+    return -1;
+}
+static int null_release_output(void *ctx, size_t idx, int render) {
+    (void)ctx; (void)idx; (void)render;
+    return 0;
+}
+
+static const mirror_decoder_ops null_decoder_ops = {
+    .name = "null",
+    .configure = null_configure,
+    .release = null_release,
+    .dequeue_input = null_dequeue_input,
+    .get_input = null_get_input,
+    .queue_input = null_queue_input,
+    .dequeue_output = null_dequeue_output,
+    .release_output = null_release_output,
+};
+
+// MARK: - Parser
+
+// Replays a recorded stream from memory forever; the session is ended from the
+// ACK path once `ops` frames have been acknowledged.
+typedef struct {
+    uint8_t *stream;
+    size_t len;
+    size_t pos;
+    uint64_t frames;            // frames in one pass of the stream
+    uint64_t payload_bytes;
+    uint64_t acks;
+    uint64_t want_acks;
+    mirror_receiver r;
+} parser_state;
+
+static int memory_read(void *ctx, int sock, void *buf, int n) {
+    (void)sock;
+    parser_state *p = (parser_state *)ctx;
+    uint8_t *out = (uint8_t *)buf;
+    size_t want = (size_t)n;
+    while (want > 0) {
+        if (p->pos == p->len) p->pos = 0;
+        size_t take = p->len - p->pos < want ? p->len - p->pos : want;
+        memcpy(out, p->stream + p->pos, take);
+        p->pos += take;
+        out += take;
+        want -= take;
+    }
+    return n;
+}
+
+static void memory_write(void *ctx, int sock, const void *buf, int n) {
+    (void)sock; (void)buf; (void)n;
+    parser_state *p = (parser_state *)ctx;
+    if (++p->acks == p->want_acks) p->r.running = 0;
+}
+
+static const mirror_transport_ops memory_transport_ops = {
+    .name = "memory",
+    .read = memory_read,
+    .write = memory_write,
+};
+
+static int parser_setup(parser_state *p) {
+    memset(p, 0, sizeof(*p));
+    loadgen_config cfg;
+    loadgen_default_config(&cfg);
+    cfg.profile = LOADGEN_TYPING;
+    cfg.idr_interval = 0;
+    cfg.command_interval = 64;
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+
+    size_t cap = 1 << 20;
+    p->stream = (uint8_t *)malloc(cap);
+    if (!p->stream) return -1;
+    // IDR first, then a loop of P-frames: replays stay decodable.
+    for (int i = 0; i < 1024; i++) {
+        loadgen_frame f;
+        loadgen_next(&lg, &f);
+        if (i == 0) continue;
+        size_t need = p->len + CMD_SIZE + FRAME_HEADER_SIZE + f.size;
+        if (need > cap) {
+            cap = need * 2;
+            uint8_t *s = (uint8_t *)realloc(p->stream, cap);
+            if (!s) return -1;
+            p->stream = s;
+        }
+        if (f.has_command) {
+            memcpy(p->stream + p->len, f.command, CMD_SIZE);
+            p->len += CMD_SIZE;
+        }
+        encode_frame_header(p->stream + p->len, f.flags, f.seq, f.size);
+        loadgen_fill_payload(p->stream + p->len + FRAME_HEADER_SIZE, f.size);
+        p->len += FRAME_HEADER_SIZE + f.size;
+        p->frames++;
+        p->payload_bytes += f.size;
+    }
+
+    mirror_receiver_init(&p->r, &null_decoder_ops, NULL, NULL, NULL);
+    p->r.transport.ops = &memory_transport_ops;
+    p->r.transport.ctx = p;
+    p->r.realtime = 0;
+    mirror_receiver_create_decoder(&p->r, W, H);
+    return 0;
+}
+
+static void parser_teardown(parser_state *p) {
+    mirror_receiver_free(&p->r);
+    free(p->stream);
+}
+
+static int bench_parser(void *state, uint64_t ops) {
+    parser_state *p = (parser_state *)state;
+    p->pos = 0;
+    p->acks = 0;
+    p->want_acks = ops;
+    p->r.running = 1;
+    mirror_receiver_session(&p->r, -1);
+    return p->acks == ops ? 0 : -1;
+}
+
+// MARK: - Ring
+
+#define RING_FRAME 4096
+
+static int bench_ring(void *state, uint64_t ops) {
+    shm_link *l = (shm_link *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        uint8_t *p = shm_ring_reserve(&l->down, RING_FRAME);
+        if (!p) return -1;
+        encode_frame_header(p, 0, (uint32_t)i, RING_FRAME - FRAME_HEADER_SIZE);
+        shm_ring_commit(&l->down, RING_FRAME);
+        const uint8_t *v = shm_ring_peek(&l->down, RING_FRAME);
+        if (!v || read_le32(v + 3) != (uint32_t)i) return -1;
+        shm_ring_release(&l->down);
+    }
+    return 0;
+}
+
+// MARK: - NAL
+
+typedef struct {
+    uint8_t *avcc;
+    size_t len;
+} nal_state;
+
+static void nal_setup(nal_state *s, size_t payload, int slices) {
+    size_t per = payload / (size_t)slices;
+    s->len = payload + 4 * (size_t)slices;
+    s->avcc = (uint8_t *)malloc(s->len);
+    size_t off = 0;
+    for (int i = 0; i < slices; i++) {
+        size_t n = i == slices - 1 ? payload - per * (size_t)(slices - 1) : per;
+        s->avcc[off] = (uint8_t)(n >> 24);
+        s->avcc[off + 1] = (uint8_t)(n >> 16);
+        s->avcc[off + 2] = (uint8_t)(n >> 8);
+        s->avcc[off + 3] = (uint8_t)n;
+        memset(s->avcc + off + 4, 0x26 + i, n);
+        off += 4 + n;
+    }
+}
+
+static int bench_nal(void *state, uint64_t ops) {
+    nal_state *s = (nal_state *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        frame_iov f;
+        frame_iov_init(&f);
+        if (frame_iov_add_avcc(&f, s->avcc, s->len) < 0) return -1;
+        frame_iov_finish(&f, 0, (uint32_t)i);
+        if (f.overflow) return -1;
+    }
+    return 0;
+}
+
+// MARK: - Pixels
+
+typedef struct {
+    uint8_t *bgra;
+    uint8_t *grey;
+} pixel_state;
+
+static int bench_bgra_simd(void *state, uint64_t ops) {
+    pixel_state *s = (pixel_state *)state;
+    for (uint64_t i = 0; i < ops; i++) grey_from_bgra(s->grey, s->bgra, W, H, (size_t)W * 4);
+    return 0;
+}
+
+static int bench_bgra_scalar(void *state, uint64_t ops) {
+    pixel_state *s = (pixel_state *)state;
+    for (uint64_t i = 0; i < ops; i++) grey_from_bgra_scalar(s->grey, s->bgra, (size_t)W * H);
+    return 0;
+}
+
+// MARK: - LZ4
+
+static uint64_t xorshift_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// A page of text: 8x12 glyph cells of sparse dark pixels on a light background,
+// one line every 20 rows.
+static void fill_page(uint8_t *frame, uint64_t seed) {
+    memset(frame, 0xF0, (size_t)W * H);
+    uint64_t s = seed | 1;
+    for (uint32_t y = 0; y + 12 <= H; y++) {
+        if (y % 20 >= 12) continue;
+        for (uint32_t x = 32; x < W - 32; x++) {
+            if ((xorshift_next(&s) & 7) == 0) frame[(size_t)y * W + x] = 0x20;
+        }
+    }
+}
+
+// Typing: eight new glyphs on one line plus the cursor moving.
+static void type_into(uint8_t *frame, const uint8_t *from, uint64_t seed) {
+    memcpy(frame, from, (size_t)W * H);
+    uint64_t s = seed | 1;
+    for (uint32_t y = 400; y < 412; y++) {
+        for (uint32_t x = 600; x < 664; x++) {
+            frame[(size_t)y * W + x] = (xorshift_next(&s) & 3) == 0 ? 0x20 : 0xF0;
+        }
+        frame[(size_t)y * W + 664] ^= 0xD0;
+    }
+}
+
+typedef struct {
+    grey_mode mode;
+    uint8_t *a, *b;             // the two frames typing alternates between
+    grey_encoder enc;
+    uint64_t n;
+    // Pre-encoded payloads for the decode cases
+    uint8_t *key, *a_to_b, *b_to_a;
+    size_t key_len, a_to_b_len, b_to_a_len;
+    uint8_t key_flags, a_to_b_flags, b_to_a_flags;
+    mirror_grey_decoder dec;
+} lz4_state;
+
+static uint8_t *dup_payload(const uint8_t *p, size_t len) {
+    uint8_t *c = (uint8_t *)malloc(len ? len : 1);
+    if (c) memcpy(c, p, len);
+    return c;
+}
+
+static int lz4_setup(lz4_state *s, grey_mode mode) {
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    s->a = (uint8_t *)malloc((size_t)W * H);
+    s->b = (uint8_t *)malloc((size_t)W * H);
+    if (!s->a || !s->b || grey_encoder_init(&s->enc, mode, W, H, 64) < 0) return -1;
+    fill_page(s->a, 1);
+    type_into(s->b, s->a, 2);
+
+    size_t len;
+    const uint8_t *p = grey_encode(&s->enc, s->a, 1, &s->key_flags, &len);
+    s->key = dup_payload(p, s->key_len = len);
+    p = grey_encode(&s->enc, s->b, 0, &s->a_to_b_flags, &len);
+    s->a_to_b = dup_payload(p, s->a_to_b_len = len);
+    p = grey_encode(&s->enc, s->a, 0, &s->b_to_a_flags, &len);
+    s->b_to_a = dup_payload(p, s->b_to_a_len = len);
+    mirror_grey_init(&s->dec);
+    if (!s->key || !s->a_to_b || !s->b_to_a) return -1;
+    return mirror_grey_decode(&s->dec, W, H, s->key_flags, s->key, s->key_len) ? 0 : -1;
+}
+
+static void lz4_teardown(lz4_state *s) {
+    grey_encoder_free(&s->enc);
+    mirror_grey_free(&s->dec);
+    free(s->a);
+    free(s->b);
+    free(s->key);
+    free(s->a_to_b);
+    free(s->b_to_a);
+}
+
+static int bench_encode_key(void *state, uint64_t ops) {
+    lz4_state *s = (lz4_state *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        uint8_t flags;
+        size_t len;
+        if (!grey_encode(&s->enc, s->a, 1, &flags, &len)) return -1;
+    }
+    return 0;
+}
+
+static int bench_encode_typing(void *state, uint64_t ops) {
+    lz4_state *s = (lz4_state *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        uint8_t flags;
+        size_t len;
+        if (!grey_encode(&s->enc, s->n++ & 1 ? s->a : s->b, 0, &flags, &len)) return -1;
+    }
+    return 0;
+}
+
+static int bench_decode_key(void *state, uint64_t ops) {
+    lz4_state *s = (lz4_state *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        if (!mirror_grey_decode(&s->dec, W, H, s->key_flags, s->key, s->key_len)) return -1;
+    }
+    s->n = 0;       // decoder now holds frame A
+    return 0;
+}
+
+static int bench_decode_typing(void *state, uint64_t ops) {
+    lz4_state *s = (lz4_state *)state;
+    for (uint64_t i = 0; i < ops; i++) {
+        int ok = s->n++ & 1
+                     ? mirror_grey_decode(&s->dec, W, H, s->b_to_a_flags, s->b_to_a, s->b_to_a_len)
+                     : mirror_grey_decode(&s->dec, W, H, s->a_to_b_flags, s->a_to_b, s->a_to_b_len);
+        if (!ok) return -1;
+    }
+    return 0;
+}
+
+// MARK: - Sender → receiver pipeline
+
+typedef enum { LINK_SHM, LINK_TCP } link_kind;
+
+typedef struct {
+    link_kind kind;
+    int grey;                   // grey typing frames; otherwise 16-byte HEVC-flagged
+    sender_server server;
+    shm_link link;
+    host_transport reader;
+    mirror_receiver r;
+    pthread_t thread;
+    int sock;
+    grey_encoder enc;
+    uint8_t *a, *b;
+    uint32_t seq;
+} pipeline_state;
+
+static void *pipeline_session(void *arg) {
+    pipeline_state *p = (pipeline_state *)arg;
+    mirror_receiver_session(&p->r, p->sock);
+    return NULL;
+}
+
+static int tcp_connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static int pipeline_send(pipeline_state *p, int keyframe) {
+    uint32_t seq = p->seq++;
+    if (!p->grey) {
+        uint8_t *dst = sender_server_frame_buffer(&p->server, 16);
+        if (!dst) return -1;
+        loadgen_fill_payload(dst, 16);
+        sender_server_commit_frame(&p->server, 16, keyframe ? FLAG_KEYFRAME : 0, seq);
+        return 0;
+    }
+    uint8_t *dst = sender_server_frame_buffer(&p->server, p->enc.out_capacity);
+    uint8_t flags;
+    size_t len = dst ? grey_encode_into(&p->enc, seq & 1 ? p->a : p->b, keyframe, dst,
+                                        p->enc.out_capacity, &flags)
+                     : 0;
+    if (len == 0) return -1;
+    sender_server_commit_frame(&p->server, len, flags, seq);
+    return 0;
+}
+
+static int wait_acks(pipeline_state *p, uint64_t want, int window) {
+    int64_t deadline = mirror_now_us() + 5000000;
+    while (sender_server_acks(&p->server) + (uint64_t)window < want) {
+        if (mirror_now_us() > deadline) return -1;
+        sched_yield();
+    }
+    return 0;
+}
+
+static int pipeline_setup(pipeline_state *p, link_kind kind, int grey) {
+    memset(p, 0, sizeof(*p));
+    p->kind = kind;
+    p->grey = grey;
+    p->sock = -1;
+    if (grey) {
+        p->a = (uint8_t *)malloc((size_t)W * H);
+        p->b = (uint8_t *)malloc((size_t)W * H);
+        if (!p->a || !p->b || grey_encoder_init(&p->enc, GREY_MODE_DELTA, W, H, 64) < 0) {
+            return -1;
+        }
+        fill_page(p->a, 1);
+        type_into(p->b, p->a, 2);
+    }
+    if (sender_server_start(&p->server, 0, W, H) < 0) return -1;
+
+    mirror_receiver_init(&p->r, &null_decoder_ops, NULL, NULL, NULL);
+    p->r.realtime = 0;
+    p->r.running = 1;
+    mirror_receiver_create_decoder(&p->r, W, H);
+    if (kind == LINK_SHM) {
+        if (shm_link_create(&p->link, 16u << 20) < 0 ||
+            sender_server_attach_shm(&p->server, &p->link) < 0) {
+            return -1;
+        }
+        host_transport_init_shm(&p->reader, &p->link);
+    } else {
+        p->sock = tcp_connect(p->server.port);
+        if (p->sock < 0 || host_transport_init(&p->reader, TRANSPORT_BLOCKING) < 0) return -1;
+    }
+    p->r.transport.ops = host_transport_ops_for(&p->reader);
+    p->r.transport.ctx = &p->reader;
+    if (pthread_create(&p->thread, NULL, pipeline_session, p) != 0) return -1;
+    if (!sender_server_wait_for_client(&p->server)) return -1;
+
+    // Join traffic and the first keyframe are not part of any timed run.
+    sender_server_take_keyframe_request(&p->server);
+    if (pipeline_send(p, 1) < 0) return -1;
+    return wait_acks(p, 1, 0);
+}
+
+static void pipeline_teardown(pipeline_state *p) {
+    // Stop between frames: the command wakes the session, which then sees running == 0.
+    p->r.running = 0;
+    sender_server_send_command(&p->server, CMD_BRIGHTNESS, 128);
+    pthread_join(p->thread, NULL);
+    sender_server_stop(&p->server);
+    if (p->sock >= 0) close(p->sock);
+    mirror_receiver_free(&p->r);
+    host_transport_free(&p->reader);
+    if (p->kind == LINK_SHM) shm_link_free(&p->link);
+    if (p->grey) grey_encoder_free(&p->enc);
+    free(p->a);
+    free(p->b);
+}
+
+static int bench_pipeline(void *state, uint64_t ops) {
+    pipeline_state *p = (pipeline_state *)state;
+    uint64_t base = sender_server_acks(&p->server);
+    for (uint64_t i = 0; i < ops; i++) {
+        if (wait_acks(p, base + i, PIPELINE_WINDOW) < 0) return -1;
+        if (pipeline_send(p, 0) < 0) return -1;
+    }
+    return wait_acks(p, base + ops, 0);
+}
+
+// MARK: - Cases
+
+typedef enum {
+    STATE_NONE,
+    STATE_PARSER,
+    STATE_RING,
+    STATE_NAL,
+    STATE_PIXELS,
+    STATE_LZ4_DELTA,
+    STATE_LZ4_TILES,
+    STATE_ACK_SHM,
+    STATE_ACK_TCP,
+    STATE_E2E_SHM,
+    STATE_E2E_TCP,
+} state_kind;
+
+typedef struct {
+    const char *name;
+    state_kind state;
+    bench_fn fn;
+    size_t bytes_per_op;        // 0 = from the state (parser, nal)
+} bench_case;
+
+static const bench_case CASES[] = {
+    { "parser.typing_stream", STATE_PARSER, bench_parser, 0 },
+    { "ring.reserve_release", STATE_RING, bench_ring, RING_FRAME },
+    { "nal.avcc_to_annexb", STATE_NAL, bench_nal, 0 },
+    { "pixels.bgra_to_grey", STATE_PIXELS, bench_bgra_simd, (size_t)W * H * 4 },
+    { "pixels.bgra_to_grey_scalar", STATE_PIXELS, bench_bgra_scalar, (size_t)W * H * 4 },
+    { "lz4.encode_delta_key", STATE_LZ4_DELTA, bench_encode_key, (size_t)W * H },
+    { "lz4.encode_delta_typing", STATE_LZ4_DELTA, bench_encode_typing, (size_t)W * H },
+    { "lz4.decode_delta_key", STATE_LZ4_DELTA, bench_decode_key, (size_t)W * H },
+    { "lz4.decode_delta_typing", STATE_LZ4_DELTA, bench_decode_typing, (size_t)W * H },
+    { "lz4.encode_tiles_typing", STATE_LZ4_TILES, bench_encode_typing, (size_t)W * H },
+    { "lz4.decode_tiles_typing", STATE_LZ4_TILES, bench_decode_typing, (size_t)W * H },
+    { "ack.shm", STATE_ACK_SHM, bench_pipeline, 0 },
+    { "ack.tcp", STATE_ACK_TCP, bench_pipeline, 0 },
+    { "e2e.shm_grey_typing", STATE_E2E_SHM, bench_pipeline, (size_t)W * H },
+    { "e2e.tcp_grey_typing", STATE_E2E_TCP, bench_pipeline, (size_t)W * H },
+};
+#define N_CASES ((int)(sizeof(CASES) / sizeof(CASES[0])))
+
+typedef union {
+    parser_state parser;
+    shm_link ring;
+    nal_state nal;
+    pixel_state pixels;
+    lz4_state lz4;
+    pipeline_state pipeline;
+} any_state;
+
+static int state_setup(any_state *s, state_kind kind) {
+    switch (kind) {
+    case STATE_PARSER: return parser_setup(&s->parser);
+    case STATE_RING: return shm_link_create(&s->ring, 1 << 20);
+    case STATE_NAL: nal_setup(&s->nal, 100000, 8); return 0;
+    case STATE_PIXELS:
+        s->pixels.bgra = (uint8_t *)malloc((size_t)W * H * 4);
+        s->pixels.grey = (uint8_t *)malloc((size_t)W * H);
+        if (!s->pixels.bgra || !s->pixels.grey) return -1;
+        for (size_t i = 0; i < (size_t)W * H * 4; i++) s->pixels.bgra[i] = (uint8_t)(i * 37);
+        return 0;
+    case STATE_LZ4_DELTA: return lz4_setup(&s->lz4, GREY_MODE_DELTA);
+    case STATE_LZ4_TILES: return lz4_setup(&s->lz4, GREY_MODE_TILES);
+    case STATE_ACK_SHM: return pipeline_setup(&s->pipeline, LINK_SHM, 0);
+    case STATE_ACK_TCP: return pipeline_setup(&s->pipeline, LINK_TCP, 0);
+    case STATE_E2E_SHM: return pipeline_setup(&s->pipeline, LINK_SHM, 1);
+    case STATE_E2E_TCP: return pipeline_setup(&s->pipeline, LINK_TCP, 1);
+    default: return 0;
+    }
+}
+
+static void state_teardown(any_state *s, state_kind kind) {
+    switch (kind) {
+    case STATE_PARSER: parser_teardown(&s->parser); break;
+    case STATE_RING: shm_link_free(&s->ring); break;
+    case STATE_NAL: free(s->nal.avcc); break;
+    case STATE_PIXELS:
+        free(s->pixels.bgra);
+        free(s->pixels.grey);
+        break;
+    case STATE_LZ4_DELTA:
+    case STATE_LZ4_TILES: lz4_teardown(&s->lz4); break;
+    case STATE_ACK_SHM:
+    case STATE_ACK_TCP:
+    case STATE_E2E_SHM:
+    case STATE_E2E_TCP: pipeline_teardown(&s->pipeline); break;
+    default: break;
+    }
+}
+
+static size_t state_bytes_per_op(const any_state *s, state_kind kind) {
+    switch (kind) {
+    case STATE_PARSER: return (size_t)(s->parser.payload_bytes / s->parser.frames);
+    case STATE_NAL: return s->nal.len;
+    default: return 0;
+    }
+}
+
+static void describe_machine(char *buf, size_t len) {
+    struct utsname u;
+    char model[128] = "";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    while (f && fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && colon) {
+            snprintf(model, sizeof(model), "%s", colon + 2);
+            model[strcspn(model, "\n")] = '\0';
+            break;
+        }
+    }
+    if (f) fclose(f);
+    if (uname(&u) < 0) memset(&u, 0, sizeof(u));
+    snprintf(buf, len, "%s %s, %ld cpus%s%s", u.sysname, u.machine, sysconf(_SC_NPROCESSORS_ONLN),
+             model[0] ? ", " : "", model);
+}
+
+// MARK: - Main
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_bench [options]\n"
+            "       mirror_bench compare BASE.json CURRENT.json [--tolerance PCT]\n"
+            "  --filter S         only cases whose name contains S\n"
+            "  --list             print case names and exit\n"
+            "  --min-ms N         minimum duration of one timed run (default 200)\n"
+            "  --reps N           timed runs per case; the median is kept (default 5)\n"
+            "  --json PATH        write results as JSON (- for stdout)\n"
+            "  --baseline PATH    compare against a results file; exit 1 on regression\n"
+            "  --tolerance PCT    allowed slowdown vs the baseline (default 15)\n");
+}
+
+static int compare_files(const char *base_path, const char *cur_path, double tolerance) {
+    bench_result base[BENCH_MAX_RESULTS], cur[BENCH_MAX_RESULTS];
+    int nb = bench_load_json(base_path, base, BENCH_MAX_RESULTS);
+    int nc = bench_load_json(cur_path, cur, BENCH_MAX_RESULTS);
+    if (nb < 0 || nc < 0) {
+        fprintf(stderr, "[bench] cannot read %s\n", nb < 0 ? base_path : cur_path);
+        return 2;
+    }
+    return bench_compare(base, nb, cur, nc, tolerance, stdout) > 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *baseline = NULL;
+    double tolerance = 15;
+    int min_ms = 200;
+    int reps = 5;
+    int list = 0;
+    int compare = argc > 1 && strcmp(argv[1], "compare") == 0;
+    if (compare) {
+        argv++;
+        argc--;
+    }
+
+    static const struct option opts[] = {
+        { "filter", required_argument, NULL, 'f' },
+        { "list", no_argument, NULL, 'l' },
+        { "min-ms", required_argument, NULL, 'm' },
+        { "reps", required_argument, NULL, 'r' },
+        { "json", required_argument, NULL, 'j' },
+        { "baseline", required_argument, NULL, 'b' },
+        { "tolerance", required_argument, NULL, 't' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'f': filter = optarg; break;
+        case 'l': list = 1; break;
+        case 'm': min_ms = atoi(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'j': json_path = optarg; break;
+        case 'b': baseline = optarg; break;
+        case 't': tolerance = atof(optarg); break;
+        default: usage(); return 2;
+        }
+    }
+    if (compare) {
+        if (argc - optind != 2 || tolerance < 0) {
+            usage();
+            return 2;
+        }
+        return compare_files(argv[optind], argv[optind + 1], tolerance);
+    }
+    if (optind != argc || min_ms <= 0 || reps <= 0 || tolerance < 0) {
+        usage();
+        return 2;
+    }
+    if (list) {
+        for (int i = 0; i < N_CASES; i++) printf("%s\n", CASES[i].name);
+        return 0;
+    }
+
+    bench_result base[BENCH_MAX_RESULTS];
+    int n_base = 0;
+    if (baseline && (n_base = bench_load_json(baseline, base, BENCH_MAX_RESULTS)) < 0) {
+        fprintf(stderr, "[bench] cannot read %s\n", baseline);
+        return 2;
+    }
+
+    mirror_log_quiet = 1;
+    bench_result results[N_CASES];
+    int n = 0;
+    int failed = 0;
+    FILE *table = json_path && strcmp(json_path, "-") == 0 ? stderr : stdout;
+    fprintf(table, "%-28s %12s %12s %10s\n", "case", "ns/op", "best ns/op", "MB/s");
+
+    any_state *state = (any_state *)calloc(1, sizeof(any_state));
+    state_kind current = STATE_NONE;
+    for (int i = 0; i < N_CASES; i++) {
+        const bench_case *bc = &CASES[i];
+        if (filter && !strstr(bc->name, filter)) continue;
+        if (bc->state != current) {
+            state_teardown(state, current);
+            current = STATE_NONE;
+            if (state_setup(state, bc->state) < 0) {
+                // Half-built state is leaked rather than torn down.
+                fprintf(stderr, "[bench] %s: setup failed\n", bc->name);
+                memset(state, 0, sizeof(*state));
+                failed++;
+                continue;
+            }
+            current = bc->state;
+        }
+        size_t bytes = bc->bytes_per_op ? bc->bytes_per_op : state_bytes_per_op(state, current);
+        bench_result *r = &results[n];
+        if (bench_measure(r, bc->name, bc->fn, state, bytes, min_ms, reps) < 0) {
+            fprintf(stderr, "[bench] %s: failed\n", bc->name);
+            failed++;
+            continue;
+        }
+        const bench_result *b = NULL;
+        for (int j = 0; j < n_base && !b; j++) {
+            if (strcmp(base[j].name, r->name) == 0) b = &base[j];
+        }
+        for (int retry = 0; b && retry < REGRESSION_RETRIES && bench_regressed(b, r, tolerance);
+             retry++) {
+            bench_result again;
+            if (bench_measure(&again, bc->name, bc->fn, state, bytes, min_ms, reps) == 0 &&
+                again.min_ns_per_op < r->min_ns_per_op) {
+                *r = again;
+            }
+        }
+        n++;
+        fprintf(table, "%-28s %12.1f %12.1f %10.1f\n", r->name, r->ns_per_op, r->min_ns_per_op,
+                r->mb_per_s);
+        fflush(table);
+    }
+    state_teardown(state, current);
+    free(state);
+
+    if (json_path) {
+        char machine[256];
+        describe_machine(machine, sizeof(machine));
+        FILE *f = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!f) {
+            perror(json_path);
+            return 2;
+        }
+        bench_write_json(f, machine, results, n);
+        if (f != stdout) fclose(f);
+    }
+
+    if (baseline) {
+        fprintf(table, "\n");
+        if (bench_compare(base, n_base, results, n, tolerance, table) > 0) failed++;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+// mirror_framing_bench.c — Copy-based vs scatter-gather frame sending (Linux).
+//
+// Sends the same synthetic encoder output over TCP loopback three ways and
+// reports sender-side cost per frame:
+//
+//   copy   the Mac path: Annex B appended into a growing buffer, header + payload
+//          concatenated into a new buffer, keyframes copied into the join cache,
+//          one write
+//   split  Annex B built by copying, then header and payload as two writes
+//          (the Linux sender before framing.c)
+//   iovec  frame_iov over the encoder's AVCC buffers, one sendmsg, keyframes
+//          flattened into the cache
+//
+// Encoder output is modelled as VideoToolbox delivers it: an AVCC buffer of
+// length-prefixed slices, plus VPS/SPS/PPS on keyframes. A drain thread reads
+// the far end as fast as it can, so the numbers are the sender's CPU and copy
+// cost, not link throughput.
+//
+//   mirror_framing_bench --size 20000,100000,400000 --frames 3000
+
+#include "framing.h"
+#include "host_util.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SIZES 16
+
+typedef enum { PATH_COPY, PATH_SPLIT, PATH_IOVEC, PATH_COUNT } send_path;
+static const char *const PATH_NAMES[PATH_COUNT] = { "copy", "split", "iovec" };
+
+// MARK: - Synthetic encoder output
+
+typedef struct {
+    uint8_t vps[24], sps[40], pps[8];
+    uint8_t *p_avcc;        // P frame: `slices` length-prefixed slices
+    size_t p_len;
+    uint8_t *idr_avcc;      // IDR frame slices
+    size_t idr_len;
+} encoder_output;
+
+static uint8_t *make_avcc(size_t payload, int slices, uint8_t nal_type, size_t *out_len) {
+    size_t per = payload / (size_t)slices;
+    size_t len = payload + 4 * (size_t)slices;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    size_t off = 0;
+    for (int i = 0; i < slices; i++) {
+        size_t n = i == slices - 1 ? payload - per * (size_t)(slices - 1) : per;
+        buf[off] = (uint8_t)(n >> 24);
+        buf[off + 1] = (uint8_t)(n >> 16);
+        buf[off + 2] = (uint8_t)(n >> 8);
+        buf[off + 3] = (uint8_t)n;
+        buf[off + 4] = (uint8_t)(nal_type << 1);
+        for (size_t j = 1; j < n; j++) buf[off + 4 + j] = (uint8_t)(j * 131 + (size_t)i);
+        off += 4 + n;
+    }
+    *out_len = len;
+    return buf;
+}
+
+static void encoder_output_init(encoder_output *e, size_t size, int slices, int idr_scale) {
+    memset(e->vps, 0x40, sizeof(e->vps));
+    memset(e->sps, 0x42, sizeof(e->sps));
+    memset(e->pps, 0x44, sizeof(e->pps));
+    e->p_avcc = make_avcc(size, slices, 1, &e->p_len);                          // TRAIL_R
+    e->idr_avcc = make_avcc(size * (size_t)idr_scale, slices, 19, &e->idr_len);  // IDR_W_RADL
+}
+
+static void encoder_output_free(encoder_output *e) {
+    free(e->p_avcc);
+    free(e->idr_avcc);
+}
+
+// MARK: - Copy path helpers
+
+// Growable byte buffer with Data-like doubling.
+typedef struct {
+    uint8_t *p;
+    size_t len, cap;
+} byte_buf;
+
+static void buf_append(byte_buf *b, const void *data, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 64;
+        while (cap < b->len + n) cap *= 2;
+        b->p = (uint8_t *)realloc(b->p, cap);
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, data, n);
+    b->len += n;
+}
+
+static void append_annexb(byte_buf *b, const uint8_t *avcc, size_t len) {
+    static const uint8_t sc[4] = { 0, 0, 0, 1 };
+    size_t off = 0;
+    while (off + 4 <= len) {
+        uint32_t n = ((uint32_t)avcc[off] << 24) | ((uint32_t)avcc[off + 1] << 16) |
+                     ((uint32_t)avcc[off + 2] << 8) | avcc[off + 3];
+        buf_append(b, sc, sizeof(sc));
+        buf_append(b, avcc + off + 4, n);
+        off += 4 + n;
+    }
+}
+
+// MARK: - Loopback
+
+typedef struct {
+    int fd;
+    uint64_t bytes;
+} drain_args;
+
+static void *drain_thread(void *arg) {
+    drain_args *d = (drain_args *)arg;
+    static uint8_t sink[1 << 18];
+    ssize_t r;
+    while ((r = recv(d->fd, sink, sizeof(sink), 0)) > 0) d->bytes += (uint64_t)r;
+    return NULL;
+}
+
+static int loopback_pair(int *send_fd, int *recv_fd) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    if (ls < 0 || bind(ls, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(ls, 1) < 0 ||
+        getsockname(ls, (struct sockaddr *)&addr, &alen) < 0) {
+        perror("listen");
+        if (ls >= 0) close(ls);
+        return -1;
+    }
+    int c = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(c, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        close(ls);
+        close(c);
+        return -1;
+    }
+    int a = accept(ls, NULL, NULL);
+    close(ls);
+    int one = 1;
+    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    *send_fd = c;
+    *recv_fd = a;
+    return 0;
+}
+
+// MARK: - Benchmark
+
+typedef struct {
+    double build_ns;        // per frame: building the wire bytes / descriptor
+    double total_ns;        // per frame: build + send
+    double mb_per_s;
+    uint64_t bytes;
+} path_result;
+
+static int run_path(send_path path, const encoder_output *e, int frames, int keyframe_interval,
+                    path_result *out) {
+    int fd, rfd;
+    if (loopback_pair(&fd, &rfd) < 0) return -1;
+    drain_args d = { rfd, 0 };
+    pthread_t t;
+    pthread_create(&t, NULL, drain_thread, &d);
+
+    uint8_t *cache = NULL;
+    size_t cache_cap = 0;
+    int64_t build_us = 0;
+    uint64_t sent = 0;
+    int rc = 0;
+    int64_t start = mirror_now_us();
+
+    for (int i = 0; i < frames && rc == 0; i++) {
+        int key = i % keyframe_interval == 0;
+        const uint8_t *avcc = key ? e->idr_avcc : e->p_avcc;
+        size_t avcc_len = key ? e->idr_len : e->p_len;
+        uint8_t flags = key ? FLAG_KEYFRAME : 0;
+        int64_t t0 = mirror_now_us();
+
+        if (path == PATH_IOVEC) {
+            frame_iov f;
+            frame_iov_init(&f);
+            if (key) {
+                frame_iov_add_nal(&f, e->vps, sizeof(e->vps));
+                frame_iov_add_nal(&f, e->sps, sizeof(e->sps));
+                frame_iov_add_nal(&f, e->pps, sizeof(e->pps));
+            }
+            frame_iov_add_avcc(&f, avcc, avcc_len);
+            frame_iov_finish(&f, flags, (uint32_t)i);
+            size_t total = frame_iov_size(&f);
+            if (key) {
+                if (total > cache_cap) cache = (uint8_t *)realloc(cache, cache_cap = total);
+                frame_iov_flatten(&f, cache);
+            }
+            build_us += mirror_now_us() - t0;
+            rc = frame_iov_send(fd, &f);
+            sent += total;
+        } else {
+            // Fresh buffer per frame, as `var annexB = Data()` is in the encoder callback.
+            byte_buf annexb = { 0 };
+            if (key) {
+                static const uint8_t sc[4] = { 0, 0, 0, 1 };
+                buf_append(&annexb, sc, 4);
+                buf_append(&annexb, e->vps, sizeof(e->vps));
+                buf_append(&annexb, sc, 4);
+                buf_append(&annexb, e->sps, sizeof(e->sps));
+                buf_append(&annexb, sc, 4);
+                buf_append(&annexb, e->pps, sizeof(e->pps));
+            }
+            append_annexb(&annexb, avcc, avcc_len);
+            uint8_t hdr[FRAME_HEADER_SIZE];
+            encode_frame_header(hdr, flags, (uint32_t)i, (uint32_t)annexb.len);
+            size_t total = sizeof(hdr) + annexb.len;
+
+            if (path == PATH_COPY) {
+                uint8_t *frame = (uint8_t *)malloc(total);
+                memcpy(frame, hdr, sizeof(hdr));
+                memcpy(frame + sizeof(hdr), annexb.p, annexb.len);
+                if (key) {
+                    if (total > cache_cap) cache = (uint8_t *)realloc(cache, cache_cap = total);
+                    memcpy(cache, frame, total);
+                }
+                build_us += mirror_now_us() - t0;
+                rc = write_all(fd, frame, total);
+                free(frame);
+            } else {
+                if (key) {
+                    if (total > cache_cap) cache = (uint8_t *)realloc(cache, cache_cap = total);
+                    memcpy(cache, hdr, sizeof(hdr));
+                    memcpy(cache + sizeof(hdr), annexb.p, annexb.len);
+                }
+                build_us += mirror_now_us() - t0;
+                rc = write_all(fd, hdr, sizeof(hdr));
+                if (rc == 0) rc = write_all(fd, annexb.p, annexb.len);
+            }
+            free(annexb.p);
+            sent += total;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+    pthread_join(t, NULL);
+    int64_t elapsed = mirror_now_us() - start;
+    close(fd);
+    close(rfd);
+    free(cache);
+
+    if (rc != 0 || d.bytes != sent) {
+        fprintf(stderr, "[bench] %s: sent %llu, received %llu\n", PATH_NAMES[path],
+                (unsigned long long)sent, (unsigned long long)d.bytes);
+        return -1;
+    }
+    out->build_ns = build_us * 1000.0 / frames;
+    out->total_ns = elapsed * 1000.0 / frames;
+    out->mb_per_s = elapsed > 0 ? sent / (double)elapsed : 0;
+    out->bytes = sent;
+    return 0;
+}
+
+static int parse_list(const char *s, int *out, int max) {
+    int n = 0;
+    char *copy = strdup(s);
+    for (char *tok = strtok(copy, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        int v = atoi(tok);
+        if (v > 0) out[n++] = v;
+    }
+    free(copy);
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_framing_bench [options]\n"
+            "  --size LIST        P-frame payload bytes, comma separated (default 20000,100000,400000)\n"
+            "  --frames N         frames per path and size (default 3000)\n"
+            "  --slices N         slices per frame (default 4)\n"
+            "  --idr-scale N      keyframe size multiple (default 8)\n"
+            "  --keyframe-interval N  (default 60)\n");
+}
+
+int main(int argc, char **argv) {
+    int sizes[MAX_SIZES] = { 20000, 100000, 400000 };
+    int n_sizes = 3;
+    int frames = 3000;
+    int slices = 4;
+    int idr_scale = 8;
+    int keyframe_interval = 60;
+
+    static const struct option opts[] = {
+        { "size", required_argument, NULL, 's' },
+        { "frames", required_argument, NULL, 'n' },
+        { "slices", required_argument, NULL, 'c' },
+        { "idr-scale", required_argument, NULL, 'i' },
+        { "keyframe-interval", required_argument, NULL, 'k' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 's': n_sizes = parse_list(optarg, sizes, MAX_SIZES); break;
+        case 'n': frames = atoi(optarg); break;
+        case 'c': slices = atoi(optarg); break;
+        case 'i': idr_scale = atoi(optarg); break;
+        case 'k': keyframe_interval = atoi(optarg); break;
+        default: usage(); return 2;
+        }
+    }
+    if (n_sizes == 0 || frames <= 0 || slices <= 0 || slices > (FRAME_IOV_MAX - 7) / 2 ||
+        idr_scale <= 0 || keyframe_interval <= 0) {
+        usage();
+        return 2;
+    }
+
+    printf("%-8s %-6s %12s %12s %10s %8s\n", "size", "path", "build ns/f", "total ns/f", "MB/s",
+           "vs copy");
+    for (int s = 0; s < n_sizes; s++) {
+        encoder_output e;
+        encoder_output_init(&e, (size_t)sizes[s], slices, idr_scale);
+        double copy_ns = 0;
+        for (int p = 0; p < PATH_COUNT; p++) {
+            path_result r;
+            if (run_path((send_path)p, &e, frames, keyframe_interval, &r) < 0) {
+                encoder_output_free(&e);
+                return 1;
+            }
+            if (p == PATH_COPY) copy_ns = r.total_ns;
+            printf("%-8d %-6s %12.0f %12.0f %10.1f %7.2fx\n", sizes[s], PATH_NAMES[p], r.build_ns,
+                   r.total_ns, r.mb_per_s, r.total_ns > 0 ? copy_ns / r.total_ns : 0.0);
+        }
+        encoder_output_free(&e);
+    }
+    return 0;
+}
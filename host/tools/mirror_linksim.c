@@ -0,0 +1,160 @@
+// mirror_linksim.c — Compare backpressure controllers on simulated USB links.
+//
+// Runs every (link model, load profile, controller) combination through the
+// discrete-event model in link_sim.h and prints capture-to-decode latency
+// percentiles and skip rate side by side. Deterministic: the same arguments
+// always print the same table, so a controller change can be judged by diff.
+//
+//   mirror_linksim                                    # all models, legacy vs bdp
+//   mirror_linksim --model usb2-busy --profile video --controller none,legacy,bdp
+//   mirror_linksim --controller bdp --keyframes periodic,refresh   # IDR spikes vs intra refresh
+
+#include "link_sim.h"
+#include "loadgen.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ITEMS 16
+
+static int split_list(char *s, const char **out, int max) {
+    int n = 0;
+    for (char *tok = strtok(s, ","); tok && n < max; tok = strtok(NULL, ",")) out[n++] = tok;
+    return n;
+}
+
+static void usage(void) {
+    int n;
+    const link_model *models = link_sim_models(&n);
+    fprintf(stderr,
+            "Usage: mirror_linksim [options]\n"
+            "  --model LIST       link models, comma separated (default: all)\n"
+            "  --profile LIST     typing, scrolling, video, constant (default typing,scrolling,video)\n"
+            "  --controller LIST  none, legacy, bdp (default legacy,bdp)\n"
+            "  --fps N            capture rate (default 120)\n"
+            "  --seconds N        simulated time per run (default 60)\n"
+            "  --burst-rate P     per-frame chance of a motion burst (default 0.005)\n"
+            "  --keyframes LIST   periodic (an IDR every --idr-interval frames) and/or\n"
+            "                     refresh (intra refresh, first frame only) (default periodic)\n"
+            "  --idr-interval N   frames between IDRs, or the refresh cycle (default 120)\n"
+            "  --seed N           (default 1)\n"
+            "Models:\n");
+    for (int i = 0; i < n; i++) fprintf(stderr, "  %-12s %s\n", models[i].name, models[i].description);
+}
+
+int main(int argc, char **argv) {
+    char model_arg[256] = "", profile_arg[256] = "typing,scrolling,video", ctl_arg[256] = "legacy,bdp";
+    char key_arg[256] = "periodic";
+    int idr_interval = 120;
+    int fps = 120;
+    int seconds = 60;
+    double burst_rate = 0.005;
+    uint64_t seed = 1;
+
+    static const struct option opts[] = {
+        { "model", required_argument, NULL, 'm' },
+        { "profile", required_argument, NULL, 'p' },
+        { "controller", required_argument, NULL, 'c' },
+        { "fps", required_argument, NULL, 'f' },
+        { "seconds", required_argument, NULL, 't' },
+        { "burst-rate", required_argument, NULL, 'b' },
+        { "keyframes", required_argument, NULL, 'k' },
+        { "idr-interval", required_argument, NULL, 'I' },
+        { "seed", required_argument, NULL, 's' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'm': snprintf(model_arg, sizeof(model_arg), "%s", optarg); break;
+        case 'p': snprintf(profile_arg, sizeof(profile_arg), "%s", optarg); break;
+        case 'c': snprintf(ctl_arg, sizeof(ctl_arg), "%s", optarg); break;
+        case 'f': fps = atoi(optarg); break;
+        case 't': seconds = atoi(optarg); break;
+        case 'b': burst_rate = atof(optarg); break;
+        case 'k': snprintf(key_arg, sizeof(key_arg), "%s", optarg); break;
+        case 'I': idr_interval = atoi(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        default: usage(); return 2;
+        }
+    }
+
+    const link_model *models[MAX_ITEMS];
+    int n_models = 0;
+    if (model_arg[0]) {
+        const char *names[MAX_ITEMS];
+        int n = split_list(model_arg, names, MAX_ITEMS);
+        for (int i = 0; i < n; i++) {
+            if (!(models[n_models++] = link_sim_find_model(names[i]))) {
+                fprintf(stderr, "Unknown model: %s\n", names[i]);
+                usage();
+                return 2;
+            }
+        }
+    } else {
+        const link_model *all = link_sim_models(&n_models);
+        for (int i = 0; i < n_models; i++) models[i] = &all[i];
+    }
+
+    loadgen_profile profiles[MAX_ITEMS];
+    const char *names[MAX_ITEMS];
+    int n_profiles = split_list(profile_arg, names, MAX_ITEMS);
+    for (int i = 0; i < n_profiles; i++) {
+        if (loadgen_parse_profile(names[i], &profiles[i]) < 0) {
+            fprintf(stderr, "Unknown profile: %s\n", names[i]);
+            return 2;
+        }
+    }
+    const char *controllers[MAX_ITEMS];
+    int n_ctl = split_list(ctl_arg, controllers, MAX_ITEMS);
+    const char *key_modes[MAX_ITEMS];
+    int n_keys = split_list(key_arg, key_modes, MAX_ITEMS);
+    for (int i = 0; i < n_keys; i++) {
+        if (strcmp(key_modes[i], "periodic") != 0 && strcmp(key_modes[i], "refresh") != 0) {
+            fprintf(stderr, "Unknown keyframe mode: %s\n", key_modes[i]);
+            return 2;
+        }
+    }
+    if (fps <= 0 || seconds <= 0 || idr_interval < 0 || n_profiles == 0 || n_ctl == 0 || n_keys == 0) {
+        usage();
+        return 2;
+    }
+
+    printf("%-12s %-10s %-8s %-7s %8s %8s %8s %8s %7s %8s %7s %6s\n", "model", "profile", "keys", "ctl",
+           "p50 ms", "p95 ms", "p99 ms", "max ms", "skip %", "inflight", "window", "busy");
+    for (int m = 0; m < n_models; m++) {
+        for (int p = 0; p < n_profiles; p++) {
+            for (int km = 0; km < n_keys; km++) {
+                loadgen_config load;
+                loadgen_default_config(&load);
+                load.profile = profiles[p];
+                load.burst_rate = burst_rate;
+                load.seed = seed;
+                load.idr_interval = idr_interval;
+                load.intra_refresh = strcmp(key_modes[km], "refresh") == 0;
+                for (int k = 0; k < n_ctl; k++) {
+                    link_sim_controller ctl;
+                    if (link_sim_controller_create(&ctl, controllers[k], fps) < 0) {
+                        fprintf(stderr, "Unknown controller: %s\n", controllers[k]);
+                        return 2;
+                    }
+                    link_sim_result r;
+                    int rc = link_sim_run(models[m], &load, fps, fps * seconds, &ctl, &r);
+                    link_sim_controller_destroy(&ctl);
+                    if (rc < 0) {
+                        fprintf(stderr, "Out of memory\n");
+                        return 1;
+                    }
+                    printf("%-12s %-10s %-8s %-7s %8.1f %8.1f %8.1f %8.1f %7.2f %8.2f %7.2f %5.0f%%\n",
+                           models[m]->name, loadgen_profile_name(profiles[p]), key_modes[km], controllers[k],
+                           r.p50_ms, r.p95_ms, r.p99_ms, r.max_ms, r.skip_rate * 100, r.avg_inflight,
+                           r.avg_window, r.link_busy * 100);
+                }
+            }
+        }
+    }
+    return 0;
+}
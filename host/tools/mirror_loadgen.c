@@ -0,0 +1,283 @@
+// mirror_loadgen.c — Synthetic protocol load generator for the receive path.
+//
+// Serves the Daylight Mirror protocol like the Mac sender (listens on :8888 and
+// waits for the receiver to connect), or drives an in-process receiver core with
+// the mock decoder (--loopback). Streams synthetic frames from one of the size
+// profiles in loadgen.h at each requested frame rate and payload size, and prints
+// throughput and ACK latency per step, flagging steps where the receiver could
+// not keep up. Sweeping --fps and --size finds where the receive path saturates.
+//
+// Against a DC-1:  adb reverse tcp:8888 tcp:8888 && mirror_loadgen --fps 60,90,120
+// On host:         mirror_loadgen --loopback --profile video --fps 120,240,480
+//
+// --transport picks the loopback receiver's socket reader (blocking, epoll,
+// uring; see transport.h) to compare syscall counts and ACK tail latency.
+//
+// Payloads are HEVC filler-data NALs, so a real decoder accepts and discards them:
+// the receive path (socket, parser, input slots, ACKs) is measured, not decode.
+
+#include "host_util.h"
+#include "loadgen.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "transport.h"
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_STEPS 32
+
+static int parse_list(const char *s, int *out, int max) {
+    int n = 0;
+    char *copy = strdup(s);
+    for (char *tok = strtok(copy, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        int v = atoi(tok);
+        if (v > 0) out[n++] = v;
+    }
+    free(copy);
+    return n;
+}
+
+static int accept_receiver(int port) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    if (ls < 0) {
+        perror("socket");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(ls, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(ls, 1) < 0) {
+        perror("bind/listen");
+        close(ls);
+        return -1;
+    }
+    fprintf(stderr, "[loadgen] Waiting for receiver on :%d\n", port);
+    int fd = accept(ls, NULL, NULL);
+    close(ls);
+    if (fd < 0) {
+        perror("accept");
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fprintf(stderr, "[loadgen] Receiver connected\n");
+    return fd;
+}
+
+typedef struct {
+    mirror_receiver *r;
+    int fd;
+} session_arg;
+
+static void *session_thread(void *arg) {
+    session_arg *s = (session_arg *)arg;
+    mirror_receiver_session(s->r, s->fd);
+    return NULL;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_loadgen [options]\n"
+            "  --profile P        constant|typing|scrolling|video (default constant)\n"
+            "  --fps LIST         comma-separated frame rates to step through (default 120)\n"
+            "  --size LIST        comma-separated median P-frame sizes (default: profile's)\n"
+            "  --frames N         frames per step (default 1200)\n"
+            "  --idr-size BYTES   IDR payload (default 400000)\n"
+            "  --idr-interval N   frames between IDRs, 0 = first only (default 120)\n"
+            "  --intra-refresh    spread each interval's IDR bytes over its P-frames instead\n"
+            "  --burst-rate P     per-frame probability of a motion burst (default 0)\n"
+            "  --burst-frames N   mean burst length (default 30)\n"
+            "  --burst-scale X    P-frame size multiplier in a burst (default 4)\n"
+            "  --commands N       inject a brightness/warmth command every N frames\n"
+            "  --seed N           random seed (default 1)\n"
+            "  --width W --height H  resolution announced on connect (default 1600x1200)\n"
+            "  --port P           listen port (default 8888)\n"
+            "  --loopback         drive an in-process receiver with the mock decoder\n"
+            "  --slots N          (loopback) mock decoder input slots (default 4)\n"
+            "  --decode-us US     (loopback) mock decode time per frame (default 3000)\n"
+            "  --transport T      (loopback) blocking|epoll|uring socket reader (default blocking)\n"
+            "  --record FILE      also write the raw protocol stream to FILE\n");
+}
+
+int main(int argc, char **argv) {
+    loadgen_config cfg;
+    loadgen_default_config(&cfg);
+    mock_decoder_config mock_cfg;
+    mock_decoder_default_config(&mock_cfg);
+
+    int fps_list[MAX_STEPS] = { 120 }, n_fps = 1;
+    int size_list[MAX_STEPS] = { 0 }, n_size = 1;
+    int frames = 1200;
+    int port = 8888;
+    int width = 1600, height = 1200;
+    int loopback = 0;
+    const char *record_path = NULL;
+    transport_kind transport = TRANSPORT_BLOCKING;
+
+    static const struct option opts[] = {
+        { "profile", required_argument, NULL, 'P' },
+        { "fps", required_argument, NULL, 'f' },
+        { "size", required_argument, NULL, 's' },
+        { "frames", required_argument, NULL, 'n' },
+        { "idr-size", required_argument, NULL, 'i' },
+        { "idr-interval", required_argument, NULL, 'I' },
+        { "intra-refresh", no_argument, NULL, 'R' },
+        { "burst-rate", required_argument, NULL, 'b' },
+        { "burst-frames", required_argument, NULL, 'B' },
+        { "burst-scale", required_argument, NULL, 'x' },
+        { "commands", required_argument, NULL, 'c' },
+        { "seed", required_argument, NULL, 'r' },
+        { "width", required_argument, NULL, 'W' },
+        { "height", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'p' },
+        { "loopback", no_argument, NULL, 'l' },
+        { "slots", required_argument, NULL, 'S' },
+        { "decode-us", required_argument, NULL, 'd' },
+        { "transport", required_argument, NULL, 't' },
+        { "record", required_argument, NULL, 'o' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'P':
+            if (loadgen_parse_profile(optarg, &cfg.profile) < 0) { usage(); return 2; }
+            break;
+        case 'f': n_fps = parse_list(optarg, fps_list, MAX_STEPS); break;
+        case 's': n_size = parse_list(optarg, size_list, MAX_STEPS); break;
+        case 'n': frames = atoi(optarg); break;
+        case 'i': cfg.idr_size = (uint32_t)atoi(optarg); break;
+        case 'I': cfg.idr_interval = atoi(optarg); break;
+        case 'R': cfg.intra_refresh = 1; break;
+        case 'b': cfg.burst_rate = atof(optarg); break;
+        case 'B': cfg.burst_frames = atoi(optarg); break;
+        case 'x': cfg.burst_scale = atof(optarg); break;
+        case 'c': cfg.command_interval = atoi(optarg); break;
+        case 'r': cfg.seed = strtoull(optarg, NULL, 10); break;
+        case 'W': width = atoi(optarg); break;
+        case 'H': height = atoi(optarg); break;
+        case 'p': port = atoi(optarg); break;
+        case 'l': loopback = 1; break;
+        case 'S': mock_cfg.input_slots = atoi(optarg); break;
+        case 'd': mock_cfg.decode_latency_us = atoll(optarg); break;
+        case 't':
+            if (transport_parse_kind(optarg, &transport) < 0) { usage(); return 2; }
+            break;
+        case 'o': record_path = optarg; break;
+        default: usage(); return 2;
+        }
+    }
+    if (n_fps == 0 || n_size == 0 || frames <= 0) { usage(); return 2; }
+
+    FILE *record = NULL;
+    if (record_path && !(record = fopen(record_path, "wb"))) {
+        perror(record_path);
+        return 1;
+    }
+
+    // Loopback: receiver core + mock decoder on a thread, socketpair in between.
+    mock_decoder dec;
+    mirror_receiver r;
+    host_transport reader;
+    pthread_t rx;
+    session_arg sa;
+    int fd, peer = -1;
+    if (loopback) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            perror("socketpair");
+            return 1;
+        }
+        int sndbuf = 2 * 1024 * 1024;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        fd = fds[0];
+        peer = fds[1];
+
+        uint32_t max_p = 0;
+        for (int i = 0; i < n_size; i++) {
+            if ((uint32_t)size_list[i] > max_p) max_p = (uint32_t)size_list[i];
+        }
+        if (max_p == 0) max_p = loadgen_default_p_size(cfg.profile);
+        size_t need = (size_t)(max_p * cfg.burst_scale * 4);
+        if (need < cfg.idr_size) need = cfg.idr_size;
+        if (mock_cfg.input_capacity < need) mock_cfg.input_capacity = need;
+
+        mirror_log_quiet = 1;
+        mock_decoder_init(&dec, &mock_cfg);
+        mirror_receiver_init(&r, &mock_decoder_ops, &dec, NULL, NULL);
+        if (host_transport_init(&reader, transport) < 0) return 1;
+        r.transport.ops = host_transport_ops_for(&reader);
+        r.transport.ctx = &reader;
+        r.realtime = 0;
+        r.running = 1;
+        mirror_receiver_create_decoder(&r, r.frame_w, r.frame_h);
+        sa.r = &r;
+        sa.fd = peer;
+        pthread_create(&rx, NULL, session_thread, &sa);
+    } else {
+        fd = accept_receiver(port);
+        if (fd < 0) return 1;
+    }
+
+    // Announce the resolution first, as TCPServer does on connect.
+    uint8_t res[RESOLUTION_CMD_SIZE];
+    encode_resolution(res, (uint16_t)width, (uint16_t)height);
+    if (record) fwrite(res, 1, sizeof(res), record);
+    write_all(fd, res, sizeof(res));
+
+    loadgen lg;
+    loadgen_init(&lg, &cfg);
+    printf("profile=%s frames/step=%d idr=%u/%d%s burst=%.3f cmds=%d\n",
+           loadgen_profile_name(cfg.profile), frames, cfg.idr_size, cfg.idr_interval,
+           cfg.intra_refresh ? " (intra refresh)" : "",
+           cfg.burst_rate, cfg.command_interval);
+    printf("%6s %8s %9s %9s %8s %8s %8s %8s %8s %6s  %s\n",
+           "fps", "size", "send_fps", "ack_fps", "Mbps", "ack_avg", "ack_p50", "ack_p95", "ack_p99", "late", "");
+
+    int status = 0;
+    for (int si = 0; si < n_size && status == 0; si++) {
+        lg.cfg.p_size = (uint32_t)size_list[si];
+        for (int fi = 0; fi < n_fps && status == 0; fi++) {
+            loadgen_result res_step;
+            status = loadgen_run(fd, &lg, fps_list[fi], frames, 2000, record, &res_step);
+            uint32_t shown = lg.cfg.p_size ? lg.cfg.p_size : loadgen_default_p_size(cfg.profile);
+            printf("%6d %8u %9.1f %9.1f %8.1f %8.2f %8.2f %8.2f %8.2f %6llu  %s\n",
+                   fps_list[fi], shown, res_step.send_fps, res_step.ack_fps, res_step.mbps,
+                   res_step.ack_avg_ms, res_step.ack_p50_ms, res_step.ack_p95_ms, res_step.ack_p99_ms,
+                   (unsigned long long)res_step.late_frames,
+                   status < 0 ? "DISCONNECTED" : loadgen_saturated(&res_step, fps_list[fi]) ? "SATURATED" : "ok");
+            fflush(stdout);
+        }
+    }
+
+    shutdown(fd, SHUT_WR);
+    if (loopback) {
+        pthread_join(rx, NULL);
+        printf("receiver frames=%llu commands=%llu input_timeouts=%llu rendered=%llu\n",
+               (unsigned long long)r.stats.frames, (unsigned long long)r.stats.commands,
+               (unsigned long long)r.stats.input_timeouts, (unsigned long long)r.stats.rendered);
+        double frames_rx = r.stats.frames ? (double)r.stats.frames : 1.0;
+        printf("transport=%s syscalls/frame=%.2f waits/frame=%.2f\n", transport_kind_name(reader.kind),
+               reader.stats.syscalls / frames_rx, reader.stats.waits / frames_rx);
+        close(peer);
+        mirror_receiver_free(&r);
+        host_transport_free(&reader);
+        mock_decoder_free(&dec);
+    }
+    close(fd);
+    if (record) fclose(record);
+    return status < 0 ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+// mirror_phasesim.c — Free-running vs phase-locked capture ticks, simulated.
+//
+// Runs the model in phase_sim.h for each scenario with ticks free-running and
+// steered by phase_ctl, and prints the receiver's wait for the latch and
+// capture → shown latency side by side. With little drift a free-running
+// sender keeps whatever phase it started at for the whole run, so every row
+// averages --seeds runs with different starting phases. Deterministic, like
+// mirror_linksim.
+//
+//   mirror_phasesim                        # built-in scenarios
+//   mirror_phasesim --fps 60 --drift 500   # one custom scenario
+
+#include "phase_sim.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char *name;
+    double fps, refresh_hz, drift_ppm;
+    int64_t pipeline_jitter_us, link_jitter_us;
+} scenario;
+
+static const scenario scenarios[] = {
+    { "120fps-60Hz",    120, 60,   50, 1500,  300 },
+    { "60fps-60Hz",      60, 60,   50, 1500,  300 },
+    { "120fps-120Hz",   120, 120,  50, 1500,  300 },
+    { "drift-500ppm",   120, 60,  500, 1500,  300 },
+    { "jittery",        120, 60,   50, 4000, 1500 },
+};
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_phasesim [options]\n"
+            "  --fps N       capture rate (custom scenario)\n"
+            "  --refresh N   receiver refresh rate, Hz (default 60)\n"
+            "  --drift PPM   receiver clock rate error (default 50)\n"
+            "  --seconds N   simulated time per run (default 60)\n"
+            "  --seeds N     runs per row, averaged (default 16)\n");
+}
+
+// Sums over seeds; divided by the run count when printed.
+typedef struct {
+    double wait, g2g, p95, lock_ms, period_err;
+} totals;
+
+static void add(totals *t, const phase_sim_result *r) {
+    t->wait += r->wait_avg_ms;
+    t->g2g += r->g2g_avg_ms;
+    t->p95 += r->g2g_p95_ms;
+    t->lock_ms += r->lock_ms;
+    t->period_err += r->period_err_ppm < 0 ? -r->period_err_ppm : r->period_err_ppm;
+}
+
+static void run(const scenario *s, double seconds, int seeds) {
+    phase_sim_config cfg;
+    phase_sim_default_config(&cfg);
+    cfg.fps = s->fps;
+    cfg.refresh_hz = s->refresh_hz;
+    cfg.drift_ppm = s->drift_ppm;
+    cfg.pipeline_jitter_us = s->pipeline_jitter_us;
+    cfg.link_jitter_us = s->link_jitter_us;
+    totals f = { 0 }, l = { 0 };
+    for (int i = 1; i <= seeds; i++) {
+        phase_sim_result r;
+        cfg.seed = (uint64_t)i;
+        cfg.locked = 0;
+        if (phase_sim_run(&cfg, seconds, &r) < 0) exit(1);
+        add(&f, &r);
+        cfg.locked = 1;
+        if (phase_sim_run(&cfg, seconds, &r) < 0) exit(1);
+        add(&l, &r);
+    }
+    double n = seeds;
+    printf("%-14s %6.1f %6.1f %7.1f %7.1f   %6.1f %6.1f %7.1f %7.1f   %6.0f %8.0f\n", s->name,
+           f.wait / n, l.wait / n, f.g2g / n, l.g2g / n, f.p95 / n, l.p95 / n,
+           (f.g2g - l.g2g) / n, (f.p95 - l.p95) / n, l.lock_ms / n, l.period_err / n);
+}
+
+int main(int argc, char **argv) {
+    double seconds = 60;
+    int seeds = 16;
+    scenario custom = { "custom", 0, 60, 50, 1500, 300 };
+
+    static const struct option opts[] = {
+        { "fps", required_argument, NULL, 'f' },
+        { "refresh", required_argument, NULL, 'r' },
+        { "drift", required_argument, NULL, 'd' },
+        { "seconds", required_argument, NULL, 's' },
+        { "seeds", required_argument, NULL, 'S' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'f': custom.fps = atof(optarg); break;
+        case 'r': custom.refresh_hz = atof(optarg); break;
+        case 'd': custom.drift_ppm = atof(optarg); break;
+        case 's': seconds = atof(optarg); break;
+        case 'S': seeds = atoi(optarg); break;
+        default: usage(); return 2;
+        }
+    }
+    if (seconds <= 1 || seeds < 1) {
+        usage();
+        return 2;
+    }
+
+    printf("%-14s %13s %15s %15s %16s %6s %8s\n", "", "wait ms", "g2g avg ms", "g2g p95 ms",
+           "gain avg / p95", "lock", "|period|");
+    printf("%-14s %6s %6s %7s %7s   %6s %6s %7s %7s   %6s %8s\n", "scenario", "free", "lock", "free",
+           "lock", "free", "lock", "avg", "p95", "ms", "err ppm");
+    if (custom.fps > 0) {
+        run(&custom, seconds, seeds);
+    } else {
+        for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) run(&scenarios[i], seconds, seeds);
+    }
+    return 0;
+}
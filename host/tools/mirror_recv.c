@@ -0,0 +1,199 @@
+// mirror_recv.c — Host build of the Daylight Mirror receiver.
+//
+// Runs the same receiver core as the Android app, backed by the mock decoder, and
+// connects to a sender exactly like the DC-1 does (default 127.0.0.1:8888), so any
+// sender that serves the protocol can be exercised on Linux without a device.
+//
+// With --shm PATH it reads from a mirror_send --shm link instead of TCP.
+// --codecs advertises a ranked codec list the way a device does, to exercise
+// sender-side negotiation. --record FILE saves the stream for mirror_replay.
+//
+// Usage: mirror_recv [--host H] [--port P] [--slots N] [--decode-us US]
+//                    [--transport blocking|epoll|uring] [--shm PATH]
+//                    [--codecs h264,hevc,...] [--record FILE] [--quiet]
+
+#include "mirror_codec.h"
+#include "mirror_common.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "shm_ring.h"
+#include "transport.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Parse "h264,hevc" into the receiver's advertised list. Returns -1 on an
+// unknown name.
+static int parse_codecs(mirror_receiver *r, const char *list) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", list);
+    r->n_codecs = 0;
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        const mirror_codec_info *codec = mirror_codec_find(tok);
+        if (!codec) {
+            fprintf(stderr, "Unknown codec: %s\n", tok);
+            return -1;
+        }
+        if (r->n_codecs < MIRROR_MAX_CODECS) r->codecs[r->n_codecs++] = codec->id;
+    }
+    return 0;
+}
+
+// Serves the link until the sender closes it, then wakes main's sigwait().
+static void *shm_session_thread(void *arg) {
+    mirror_receiver *r = (mirror_receiver *)arg;
+    mirror_receiver_session(r, -1);
+    kill(getpid(), SIGTERM);
+    return NULL;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_recv [options]\n"
+            "  --host H        sender address (default 127.0.0.1)\n"
+            "  --port P        sender port (default 8888)\n"
+            "  --slots N       mock decoder input slots (default 4)\n"
+            "  --decode-us US  mock decode time per frame (default 3000)\n"
+            "  --transport T   blocking|epoll|uring socket reader (default blocking)\n"
+            "  --shm PATH      read from a shared-memory link (printed by mirror_send --shm)\n"
+            "  --codecs LIST   advertise these codecs, fastest first (hevc,h264,av1)\n"
+            "  --record FILE   save the received stream for mirror_replay\n"
+            "  --quiet         only print the final summary\n");
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1";
+    int port = 8888;
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    transport_kind transport = TRANSPORT_BLOCKING;
+    const char *shm_path = NULL;
+    const char *codecs = NULL;
+    const char *record = NULL;
+
+    static const struct option opts[] = {
+        { "host", required_argument, NULL, 'h' },
+        { "port", required_argument, NULL, 'p' },
+        { "slots", required_argument, NULL, 's' },
+        { "decode-us", required_argument, NULL, 'd' },
+        { "transport", required_argument, NULL, 't' },
+        { "shm", required_argument, NULL, 'm' },
+        { "codecs", required_argument, NULL, 'c' },
+        { "record", required_argument, NULL, 'r' },
+        { "quiet", no_argument, NULL, 'q' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'h': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 's': cfg.input_slots = atoi(optarg); break;
+        case 'd': cfg.decode_latency_us = atoll(optarg); break;
+        case 't':
+            if (transport_parse_kind(optarg, &transport) < 0) { usage(); return 2; }
+            break;
+        case 'm': shm_path = optarg; break;
+        case 'c': codecs = optarg; break;
+        case 'r': record = optarg; break;
+        case 'q': mirror_log_quiet = 1; break;
+        default: usage(); return 2;
+        }
+    }
+
+    // Block SIGINT/SIGTERM before the decode thread starts so only sigwait() sees them.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    mock_decoder dec;
+    mock_decoder_init(&dec, &cfg);
+    mirror_receiver r;
+    mirror_receiver_init(&r, &mock_decoder_ops, &dec, NULL, NULL);
+    r.features = MIRROR_FEATURE_FRAME_TIMING;
+    if (codecs && parse_codecs(&r, codecs) < 0) {
+        usage();
+        return 2;
+    }
+    if (record) {
+        r.record_fd = open(record, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (r.record_fd < 0) {
+            perror(record);
+            return 1;
+        }
+    }
+    host_transport reader;
+    shm_link link;
+    pthread_t shm_thread;
+    if (shm_path) {
+        if (shm_link_open_path(&link, shm_path) < 0) return 1;
+        host_transport_init_shm(&reader, &link);
+    } else if (host_transport_init(&reader, transport) < 0) {
+        return 1;
+    }
+    r.transport.ops = host_transport_ops_for(&reader);
+    r.transport.ctx = &reader;
+    r.realtime = 0;
+    mirror_receiver_create_decoder(&r, r.frame_w, r.frame_h);
+    if (shm_path) {
+        r.running = 1;
+        pthread_create(&shm_thread, NULL, shm_session_thread, &r);
+    } else {
+        mirror_receiver_start(&r, host, port);
+    }
+
+    int sig;
+    sigwait(&stop_signals, &sig);
+
+    if (shm_path) {
+        r.running = 0;
+        shm_link_close(&link);
+        pthread_join(shm_thread, NULL);
+    }
+    mirror_receiver_stop(&r);
+    printf("frames=%llu bytes=%llu seq_gaps=%llu input_timeouts=%llu rendered=%llu sessions=%llu\n",
+           (unsigned long long)r.stats.frames, (unsigned long long)r.stats.bytes,
+           (unsigned long long)r.stats.seq_gaps, (unsigned long long)r.stats.input_timeouts,
+           (unsigned long long)r.stats.rendered, (unsigned long long)r.stats.sessions);
+    if (r.stats.stalls) {
+        printf("stalls=%llu flushes=%llu rebuilds=%llu keyframe_requests=%llu recoveries=%llu "
+               "recover_ms_max=%.1f\n",
+               (unsigned long long)r.stats.stalls, (unsigned long long)r.stats.flushes,
+               (unsigned long long)r.stats.rebuilds, (unsigned long long)r.stats.keyframe_requests,
+               (unsigned long long)r.stats.recoveries, r.stats.recover_ms_max);
+    }
+    if (r.stats.join_drops || r.stats.recovery_points) {
+        printf("join_drops=%llu recovery_points=%llu\n", (unsigned long long)r.stats.join_drops,
+               (unsigned long long)r.stats.recovery_points);
+    }
+    if (r.stats.timed_presents) {
+        printf("timed_presents=%llu superseded=%llu slack_ms_avg=%.2f slack_ms_min=%.2f judder_ms_avg=%.2f\n",
+               (unsigned long long)r.stats.timed_presents, (unsigned long long)r.stats.superseded,
+               r.stats.slack_ms_sum / r.stats.timed_presents, r.stats.slack_ms_min,
+               r.stats.judder_samples ? r.stats.judder_ms_sum / r.stats.judder_samples : 0.0);
+    }
+    if (r.stats.timed_frames) {
+        double n = (double)r.stats.timed_frames;
+        printf("sender_capture_ms=%.2f sender_queue_ms=%.2f sender_encode_ms=%.2f timed_frames=%llu\n",
+               r.stats.sender_capture_us / 1000.0 / n, r.stats.sender_queue_us / 1000.0 / n,
+               r.stats.sender_encode_us / 1000.0 / n, (unsigned long long)r.stats.timed_frames);
+    }
+    printf("transport=%s reads=%llu syscalls=%llu waits=%llu\n", transport_kind_name(reader.kind),
+           (unsigned long long)reader.stats.reads, (unsigned long long)reader.stats.syscalls,
+           (unsigned long long)reader.stats.waits);
+    if (record && r.record_fd >= 0) close(r.record_fd);
+    mirror_receiver_free(&r);
+    host_transport_free(&reader);
+    if (shm_path) shm_link_free(&link);
+    mock_decoder_free(&dec);
+    return 0;
+}
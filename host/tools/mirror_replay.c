@@ -0,0 +1,124 @@
+// mirror_replay.c — Decode a recorded stream headless and report throughput.
+//
+// Host front end for mirror_replay.h, backed by the mock decoder: replays a
+// recording made with mirror_recv --record as fast as the decoder takes it and
+// prints decode fps and queue → output latency. With --write-golden it saves
+// the luma checksum of every decoded frame; with --golden it compares against
+// such a file and exits 1 on any mismatch. The app runs the same replay on
+// device with MediaCodec (see docs/performance.md).
+//
+//   mirror_recv --record session.bin          # capture a session
+//   mirror_replay session.bin --write-golden session.sums
+//   mirror_replay session.bin --golden session.sums
+
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_replay.h"
+#include "mock_decoder.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_replay [options] FILE\n"
+            "  --golden FILE        compare luma checksums, exit 1 on mismatch\n"
+            "  --write-golden FILE  save luma checksums\n"
+            "  --slots N            mock decoder input slots (default 4)\n"
+            "  --decode-us US       mock decode time per frame (default 3000)\n");
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    *len = 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    uint8_t *buf = NULL;
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) buf = (uint8_t *)malloc((size_t)size);
+    if (buf && fread(buf, 1, (size_t)size, f) == (size_t)size) {
+        *len = (size_t)size;
+    } else {
+        fprintf(stderr, "%s: cannot read recording\n", path);
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    const char *golden_path = NULL;
+    const char *write_path = NULL;
+    mock_decoder_config dcfg;
+    mock_decoder_default_config(&dcfg);
+
+    static const struct option opts[] = {
+        { "golden", required_argument, NULL, 'g' },
+        { "write-golden", required_argument, NULL, 'w' },
+        { "slots", required_argument, NULL, 's' },
+        { "decode-us", required_argument, NULL, 'd' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'g': golden_path = optarg; break;
+        case 'w': write_path = optarg; break;
+        case 's': dcfg.input_slots = atoi(optarg); break;
+        case 'd': dcfg.decode_latency_us = atoll(optarg); break;
+        default: usage(); return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 2;
+    }
+
+    size_t len = 0;
+    uint8_t *stream = read_file(argv[optind], &len);
+    if (!stream) return 1;
+
+    mirror_replay_config cfg;
+    mirror_replay_default_config(&cfg);
+    cfg.checksums = golden_path || write_path;
+    uint32_t *golden = NULL;
+    if (golden_path) {
+        int max = (int)(len / FRAME_HEADER_SIZE) + 1;   // every frame has a header
+        golden = (uint32_t *)malloc((size_t)max * sizeof(uint32_t));
+        cfg.n_golden = golden ? mirror_replay_load_golden(golden_path, golden, max) : -1;
+        if (cfg.n_golden < 0) {
+            perror(golden_path);
+            return 1;
+        }
+        cfg.golden = golden;
+    }
+
+    mock_decoder dec;
+    mock_decoder_init(&dec, &dcfg);
+    mirror_decoder backend = { &mock_decoder_ops, &dec };
+    mirror_replay_result res;
+    int rc = mirror_replay_run(&backend, stream, len, &cfg, &res);
+    if (rc == 0) {
+        printf("frames=%d decoded=%d skipped=%d reconfigures=%d seconds=%.3f fps=%.1f\n", res.frames,
+               res.decoded, res.skipped, res.reconfigures, res.seconds, res.fps);
+        printf("latency_ms_avg=%.2f latency_ms_p50=%.2f latency_ms_p95=%.2f latency_ms_max=%.2f\n",
+               res.latency_ms_avg, res.latency_ms_p50, res.latency_ms_p95, res.latency_ms_max);
+        if (golden) printf("golden=%d mismatches=%d first_mismatch=%d\n", cfg.n_golden, res.mismatches,
+                           res.first_mismatch);
+        if (write_path && mirror_replay_save_golden(write_path, res.checksums, res.decoded) < 0) {
+            perror(write_path);
+            rc = -1;
+        }
+    }
+    int status = rc < 0 ? 1 : res.mismatches ? 1 : 0;
+    mirror_replay_result_free(&res);
+    mock_decoder_free(&dec);
+    free(golden);
+    free(stream);
+    return status;
+}
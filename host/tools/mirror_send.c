@@ -0,0 +1,312 @@
+// mirror_send.c — Linux sender: stream raw grey/BGRA or Y4M frames to a DC-1.
+//
+// Reads frames from a file or pipe, converts them to greyscale (SIMD), encodes
+// them as LZ4 deltas or changed tiles with the vendored lz4.c, and serves the
+// Daylight Mirror protocol on port 8888 exactly where the Mac app would — so
+// `adb reverse tcp:8888 tcp:8888` and the unmodified Android app just work.
+// --adb-reverse sets that tunnel up itself through the adb server socket.
+//
+// Backpressure follows ScreenCapture.swift: a frame is skipped (not queued) when
+// it would not fit in the bandwidth-delay-product window (bdp_ctl.h), except
+// keyframes. --legacy-backpressure uses the old rule instead (skip when more
+// frames are unACKed than max(2, min(6, 120 / rtt_ms))). Deltas are always
+// relative to the last frame actually sent.
+//
+// With --fps 0 the loop runs unpaced, limited only by the source and by
+// backpressure, which makes this a high-throughput reference sender for
+// benchmarking the receiver without a Mac.
+//
+// --shm also serves a same-host receiver over a memfd ring (mirror_recv --shm
+// PATH). --shm-loopback runs the receiver core in this process on that ring
+// instead: frames are encoded into the ring and decoded out of it with no copies
+// and no sockets, so the numbers are the pipeline's compute cost alone.
+//
+// Examples:
+//   ffmpeg -f x11grab -framerate 60 -video_size 1600x1200 -i :0 -pix_fmt gray -f rawvideo - |
+//       mirror_send --format grey --size 1600x1200
+//   mirror_send --input clip.y4m --format y4m --loop --mode tiles
+//   mirror_send --input clip.y4m --loop --fps 0 --frames 3000 --shm-loopback
+
+#include "adb_client.h"
+#include "frame_source.h"
+#include "grey_encoder.h"
+#include "host_util.h"
+#include "mirror_common.h"
+#include "mirror_protocol.h"
+#include "mirror_receiver.h"
+#include "mock_decoder.h"
+#include "sender_server.h"
+#include "shm_ring.h"
+#include "transport.h"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+// In-process receiver for --shm-loopback.
+typedef struct {
+    mock_decoder dec;
+    host_transport reader;
+    mirror_receiver r;
+    pthread_t thread;
+} local_receiver;
+
+static void *local_receiver_thread(void *arg) {
+    local_receiver *lr = (local_receiver *)arg;
+    mirror_receiver_session(&lr->r, -1);
+    return NULL;
+}
+
+static void local_receiver_start(local_receiver *lr, shm_link *link) {
+    mock_decoder_config cfg;
+    mock_decoder_default_config(&cfg);
+    cfg.decode_latency_us = 0;
+    mock_decoder_init(&lr->dec, &cfg);
+    host_transport_init_shm(&lr->reader, link);
+    mirror_receiver_init(&lr->r, &mock_decoder_ops, &lr->dec, NULL, NULL);
+    lr->r.transport.ops = host_transport_ops_for(&lr->reader);
+    lr->r.transport.ctx = &lr->reader;
+    lr->r.realtime = 0;
+    lr->r.running = 1;
+    pthread_create(&lr->thread, NULL, local_receiver_thread, lr);
+}
+
+static void local_receiver_finish(local_receiver *lr) {
+    pthread_join(lr->thread, NULL);
+    printf("receiver frames=%llu bytes=%llu grey_dropped=%llu seq_gaps=%llu\n",
+           (unsigned long long)lr->r.stats.frames, (unsigned long long)lr->r.stats.bytes,
+           (unsigned long long)lr->r.stats.grey_dropped, (unsigned long long)lr->r.stats.seq_gaps);
+    mirror_receiver_free(&lr->r);
+    host_transport_free(&lr->reader);
+    mock_decoder_free(&lr->dec);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mirror_send [options]\n"
+            "  --input PATH       frame source, - for stdin (default -)\n"
+            "  --format F         grey|bgra|y4m (default y4m)\n"
+            "  --size WxH         raw frame size (grey/bgra)\n"
+            "  --fps N            pace to N fps, 0 = unpaced (default 60)\n"
+            "  --loop             rewind the input file at EOF\n"
+            "  --mode M           delta|tiles (default delta)\n"
+            "  --tile N           tile edge in pixels (default 64)\n"
+            "  --keyframe-interval N  frames between keyframes (default 120)\n"
+            "  --brightness N     send a brightness command (0-255) on connect\n"
+            "  --port P           listen port (default 8888)\n"
+            "  --adb-reverse      run `adb reverse tcp:P tcp:P` via the adb server\n"
+            "  --frames N         stop after N frames (default: until EOF)\n"
+            "  --no-backpressure  never skip frames\n"
+            "  --legacy-backpressure  skip on the old RTT threshold instead of the BDP window\n"
+            "  --shm              also serve a same-host receiver over shared memory\n"
+            "  --shm-loopback     run the receiver in-process over shared memory\n");
+}
+
+int main(int argc, char **argv) {
+    const char *input = "-";
+    frame_format format = FRAME_Y4M;
+    uint32_t width = 0, height = 0;
+    int fps = 60;
+    int loop = 0;
+    grey_mode mode = GREY_MODE_DELTA;
+    uint32_t tile = 64;
+    int keyframe_interval = 120;
+    int brightness = -1;
+    int port = 8888;
+    long max_frames = -1;
+    int backpressure = 1;           // 0 off, 1 BDP window, 2 legacy threshold
+    int shm = 0, shm_loopback = 0;
+    int adb_reverse = 0;
+
+    static const struct option opts[] = {
+        { "input", required_argument, NULL, 'i' },
+        { "format", required_argument, NULL, 'F' },
+        { "size", required_argument, NULL, 's' },
+        { "fps", required_argument, NULL, 'f' },
+        { "loop", no_argument, NULL, 'l' },
+        { "mode", required_argument, NULL, 'm' },
+        { "tile", required_argument, NULL, 't' },
+        { "keyframe-interval", required_argument, NULL, 'k' },
+        { "brightness", required_argument, NULL, 'b' },
+        { "port", required_argument, NULL, 'p' },
+        { "adb-reverse", no_argument, NULL, 'A' },
+        { "frames", required_argument, NULL, 'n' },
+        { "no-backpressure", no_argument, NULL, 'B' },
+        { "legacy-backpressure", no_argument, NULL, 'R' },
+        { "shm", no_argument, NULL, 'S' },
+        { "shm-loopback", no_argument, NULL, 'L' },
+        { "help", no_argument, NULL, '?' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (c) {
+        case 'i': input = optarg; break;
+        case 'F':
+            if (frame_source_parse_format(optarg, &format) < 0) { usage(); return 2; }
+            break;
+        case 's':
+            if (sscanf(optarg, "%ux%u", &width, &height) != 2) { usage(); return 2; }
+            break;
+        case 'f': fps = atoi(optarg); break;
+        case 'l': loop = 1; break;
+        case 'm':
+            if (strcmp(optarg, "delta") == 0) mode = GREY_MODE_DELTA;
+            else if (strcmp(optarg, "tiles") == 0) mode = GREY_MODE_TILES;
+            else { usage(); return 2; }
+            break;
+        case 't': tile = (uint32_t)atoi(optarg); break;
+        case 'k': keyframe_interval = atoi(optarg); break;
+        case 'b': brightness = atoi(optarg); break;
+        case 'p': port = atoi(optarg); break;
+        case 'A': adb_reverse = 1; break;
+        case 'n': max_frames = atol(optarg); break;
+        case 'B': backpressure = 0; break;
+        case 'R': backpressure = 2; break;
+        case 'S': shm = 1; break;
+        case 'L': shm = shm_loopback = 1; break;
+        default: usage(); return 2;
+        }
+    }
+    if (keyframe_interval <= 0) keyframe_interval = 1;
+
+    frame_source src;
+    if (frame_source_open(&src, input, format, width, height, loop) < 0) return 1;
+    if (src.width > 0xFFFF || src.height > 0xFFFF) {
+        fprintf(stderr, "Frame size %ux%u too large\n", src.width, src.height);
+        return 1;
+    }
+    grey_encoder enc;
+    if (grey_encoder_init(&enc, mode, src.width, src.height, tile) < 0) {
+        fprintf(stderr, "Encoder init failed (tile %u)\n", tile);
+        return 1;
+    }
+    uint8_t *grey = (uint8_t *)malloc((size_t)src.width * src.height);
+
+    sender_server server;
+    if (sender_server_start(&server, port, (uint16_t)src.width, (uint16_t)src.height) < 0) return 1;
+    if (fps > 0) sender_server_set_capture_fps(&server, fps);
+    if (brightness >= 0) sender_server_send_command(&server, CMD_BRIGHTNESS, (uint8_t)brightness);
+    shm_link link;
+    local_receiver local;
+    if (shm) {
+        if (shm_link_create(&link, SHM_LINK_DEFAULT_CAPACITY) < 0 ||
+            sender_server_attach_shm(&server, &link) < 0) {
+            sender_server_stop(&server);
+            return 1;
+        }
+        if (shm_loopback) local_receiver_start(&local, &link);
+    }
+
+    if (adb_reverse) {
+        adb_client adb;
+        adb_client_init(&adb, 0);
+        char spec[16];
+        snprintf(spec, sizeof(spec), "tcp:%d", port);
+        if (adb_client_reverse(&adb, NULL, spec, spec) < 0)
+            fprintf(stderr, "[ADB] reverse %s failed: %s\n", spec, adb.error);
+        else
+            fprintf(stderr, "[ADB] reverse %s set up\n", spec);
+    }
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "[Send] %ux%u %s, %s, waiting for receiver on :%d\n", src.width, src.height,
+            format == FRAME_Y4M ? "y4m" : format == FRAME_BGRA ? "bgra" : "grey",
+            mode == GREY_MODE_TILES ? "tiles" : "delta", port);
+    while (!g_stop && sender_server_client_count(&server) == 0) {
+        sleep_until_us(mirror_now_us() + 10000);
+    }
+
+    uint32_t seq = 0;
+    long frame_count = 0;
+    uint64_t sent = 0, skipped = 0, bytes = 0;
+    int stat_frames = 0;
+    double read_sum = 0, encode_sum = 0;
+    int64_t stat_start = mirror_now_us();
+    int64_t period_us = fps > 0 ? 1000000 / fps : 0;
+    int64_t next = mirror_now_us();
+    int64_t run_start = next;
+
+    while (!g_stop && (max_frames < 0 || frame_count < max_frames)) {
+        int64_t t0 = mirror_now_us();
+        int r = frame_source_read(&src, grey);
+        if (r <= 0) {
+            if (r < 0) fprintf(stderr, "[Send] Malformed input after %ld frames\n", frame_count);
+            break;
+        }
+        int64_t t1 = mirror_now_us();
+
+        int scheduled_key = frame_count % keyframe_interval == 0;
+        int rejoin_key = sender_server_take_keyframe_request(&server);
+        double rtt = sender_server_rtt_avg_ms(&server, 15.0);
+        int over = backpressure == 2
+            ? sender_server_inflight(&server) > sender_backpressure_threshold(rtt)
+            : !sender_server_should_send(&server);
+        if (backpressure && !scheduled_key && !rejoin_key && over) {
+            skipped++;
+        } else {
+            // Encode straight into the server's frame buffer (ring space over shm).
+            uint8_t flags;
+            uint8_t *dst = sender_server_frame_buffer(&server, enc.out_capacity);
+            size_t len = dst ? grey_encode_into(&enc, grey, scheduled_key || rejoin_key, dst,
+                                                enc.out_capacity, &flags) : 0;
+            if (len) {
+                sender_server_commit_frame(&server, len, flags, seq++);
+                sent++;
+                bytes += len;
+            }
+        }
+        int64_t t2 = mirror_now_us();
+
+        frame_count++;
+        stat_frames++;
+        read_sum += (t1 - t0) / 1000.0;
+        encode_sum += (t2 - t1) / 1000.0;
+
+        double elapsed = (t2 - stat_start) / 1e6;
+        if (elapsed >= 5.0) {
+            fprintf(stderr, "[Send] FPS: %.1f | read: %.2fms | encode+send: %.2fms | %.1fKB/frame | "
+                    "skipped: %llu | inflight: %d/%d | rtt: %.1fms | clients: %d\n",
+                    stat_frames / elapsed, read_sum / stat_frames, encode_sum / stat_frames,
+                    sent ? bytes / 1024.0 / sent : 0.0, (unsigned long long)skipped,
+                    sender_server_inflight(&server), sender_server_window_frames(&server), rtt,
+                    sender_server_client_count(&server));
+            stat_frames = 0;
+            read_sum = encode_sum = 0;
+            stat_start = t2;
+        }
+
+        if (period_us > 0) {
+            next += period_us;
+            sleep_until_us(next);
+        }
+    }
+
+    double run_s = (mirror_now_us() - run_start) / 1e6;
+    printf("frames=%ld fps=%.1f sent=%llu skipped=%llu bytes=%llu acks=%llu rtt_avg=%.2fms\n",
+           frame_count, run_s > 0 ? frame_count / run_s : 0.0, (unsigned long long)sent,
+           (unsigned long long)skipped,
+           (unsigned long long)bytes, (unsigned long long)sender_server_acks(&server),
+           sender_server_rtt_avg_ms(&server, 0));
+    sender_server_stop(&server);
+    if (shm_loopback) local_receiver_finish(&local);
+    if (shm) shm_link_free(&link);
+    grey_encoder_free(&enc);
+    frame_source_close(&src);
+    free(grey);
+    return 0;
+}
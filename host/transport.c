@@ -0,0 +1,235 @@
+// transport.c — Blocking, epoll and shared-memory readers, and backend selection.
+
+#include "transport.h"
+#include "mirror_common.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define EPOLL_BUF_SIZE (256 * 1024)
+
+int transport_disable_uring = 0;
+
+static const char *const KIND_NAMES[] = { "blocking", "epoll", "uring", "shm" };
+
+int transport_parse_kind(const char *s, transport_kind *out) {
+    for (int i = 0; i <= TRANSPORT_URING; i++) {
+        if (strcmp(s, KIND_NAMES[i]) == 0) {
+            *out = (transport_kind)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *transport_kind_name(transport_kind kind) {
+    return KIND_NAMES[kind];
+}
+
+int host_transport_init(host_transport *t, transport_kind want) {
+    memset(t, 0, sizeof(*t));
+    t->epfd = -1;
+    t->sock = -1;
+    t->kind = want;
+
+    if (want == TRANSPORT_URING) {
+        t->uring = transport_disable_uring ? NULL : uring_reader_create();
+        if (t->uring) return 0;
+        LOGI("[transport] io_uring unavailable, falling back to epoll");
+        t->kind = TRANSPORT_EPOLL;
+    }
+    if (t->kind == TRANSPORT_EPOLL) {
+        t->epfd = epoll_create1(EPOLL_CLOEXEC);
+        t->buf = (uint8_t *)malloc(EPOLL_BUF_SIZE);
+        if (t->epfd < 0 || !t->buf) {
+            LOGE("[transport] epoll setup failed: %s", strerror(errno));
+            host_transport_free(t);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void host_transport_init_shm(host_transport *t, shm_link *link) {
+    memset(t, 0, sizeof(*t));
+    t->epfd = -1;
+    t->sock = -1;
+    t->kind = TRANSPORT_SHM;
+    t->shm = link;
+    shm_link_accept(link);
+}
+
+void host_transport_free(host_transport *t) {
+    if (t->uring) uring_reader_destroy(t->uring);
+    t->uring = NULL;
+    if (t->epfd >= 0) close(t->epfd);
+    t->epfd = -1;
+    free(t->buf);
+    t->buf = NULL;
+}
+
+// MARK: - Blocking
+
+static int blocking_read(host_transport *t, int sock, void *buf, int n) {
+    int total = 0;
+    while (total < n) {
+        int r = (int)recv(sock, (uint8_t *)buf + total, (size_t)(n - total), MSG_WAITALL);
+        t->stats.syscalls++;
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        total += r;
+    }
+    return total;
+}
+
+// MARK: - epoll
+
+static int epoll_attach(host_transport *t, int sock) {
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.fd = sock };
+    if (epoll_ctl(t->epfd, EPOLL_CTL_ADD, sock, &ev) < 0) return -1;
+    t->sock = sock;
+    t->buf_off = t->buf_len = 0;
+    return 0;
+}
+
+static void epoll_detach(host_transport *t) {
+    if (t->sock >= 0) epoll_ctl(t->epfd, EPOLL_CTL_DEL, t->sock, NULL);
+    t->sock = -1;
+    t->buf_off = t->buf_len = 0;
+}
+
+static int epoll_read(host_transport *t, int sock, void *buf, int n) {
+    uint8_t *out = (uint8_t *)buf;
+    size_t want = (size_t)n;
+    while (want > 0) {
+        size_t avail = t->buf_len - t->buf_off;
+        if (avail > 0) {
+            size_t take = avail < want ? avail : want;
+            memcpy(out, t->buf + t->buf_off, take);
+            t->buf_off += take;
+            out += take;
+            want -= take;
+            continue;
+        }
+
+        // Staging buffer empty: large remainders go straight to the caller.
+        ssize_t r;
+        if (want >= EPOLL_BUF_SIZE) {
+            r = recv(sock, out, want, MSG_DONTWAIT);
+            if (r > 0) {
+                out += r;
+                want -= (size_t)r;
+            }
+        } else {
+            r = recv(sock, t->buf, EPOLL_BUF_SIZE, MSG_DONTWAIT);
+            if (r > 0) {
+                t->buf_off = 0;
+                t->buf_len = (size_t)r;
+            }
+        }
+        t->stats.syscalls++;
+        if (r > 0) continue;
+        if (r == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+        struct epoll_event ev;
+        t->stats.waits++;
+        t->stats.syscalls++;
+        if (epoll_wait(t->epfd, &ev, 1, -1) < 0 && errno != EINTR) return -1;
+    }
+    return n;
+}
+
+// MARK: - Shared memory
+
+// Futex sleeps happen inside shm_ring.c and are not counted as syscalls here.
+static int shm_read(void *ctx, int sock, void *buf, int n) {
+    (void)sock;
+    host_transport *t = (host_transport *)ctx;
+    if (shm_ring_read(&t->shm->down, buf, (size_t)n) < 0) return -1;
+    t->stats.reads++;
+    t->stats.bytes += (uint64_t)n;
+    return n;
+}
+
+static const uint8_t *shm_view(void *ctx, int sock, int n) {
+    (void)sock;
+    host_transport *t = (host_transport *)ctx;
+    shm_ring_release(&t->shm->down);    // the previous view is done with
+    const uint8_t *p = shm_ring_peek(&t->shm->down, (size_t)n);
+    if (p) {
+        t->stats.reads++;
+        t->stats.bytes += (uint64_t)n;
+    }
+    return p;
+}
+
+static void shm_write(void *ctx, int sock, const void *buf, int n) {
+    (void)sock;
+    host_transport *t = (host_transport *)ctx;
+    shm_ring_write(&t->shm->up, buf, (size_t)n);
+}
+
+static void shm_detach(void *ctx) {
+    host_transport *t = (host_transport *)ctx;
+    shm_ring_release(&t->shm->down);
+}
+
+static const mirror_transport_ops host_shm_transport_ops = {
+    .name = "shm",
+    .read = shm_read,
+    .view = shm_view,
+    .write = shm_write,
+    .detach = shm_detach,
+};
+
+// MARK: - mirror_transport_ops
+
+static int host_attach(void *ctx, int sock) {
+    host_transport *t = (host_transport *)ctx;
+    switch (t->kind) {
+    case TRANSPORT_EPOLL: return epoll_attach(t, sock);
+    case TRANSPORT_URING: return uring_reader_attach(t->uring, sock);
+    default: return 0;
+    }
+}
+
+static int host_read(void *ctx, int sock, void *buf, int n) {
+    host_transport *t = (host_transport *)ctx;
+    int r;
+    switch (t->kind) {
+    case TRANSPORT_EPOLL: r = epoll_read(t, sock, buf, n); break;
+    case TRANSPORT_URING: r = uring_reader_read(t->uring, buf, n, &t->stats); break;
+    default: r = blocking_read(t, sock, buf, n); break;
+    }
+    if (r > 0) {
+        t->stats.reads++;
+        t->stats.bytes += (uint64_t)r;
+    }
+    return r;
+}
+
+static void host_detach(void *ctx) {
+    host_transport *t = (host_transport *)ctx;
+    switch (t->kind) {
+    case TRANSPORT_EPOLL: epoll_detach(t); break;
+    case TRANSPORT_URING: uring_reader_detach(t->uring); break;
+    default: break;
+    }
+}
+
+const mirror_transport_ops host_transport_ops = {
+    .name = "host",
+    .attach = host_attach,
+    .read = host_read,
+    .detach = host_detach,
+};
+
+const mirror_transport_ops *host_transport_ops_for(const host_transport *t) {
+    return t->kind == TRANSPORT_SHM ? &host_shm_transport_ops : &host_transport_ops;
+}
@@ -0,0 +1,95 @@
+// transport.h — Host socket read backends for the receiver core.
+//
+// Three implementations of mirror_transport_ops (mirror_transport.h), so the
+// receive path can be measured with each on the same traffic:
+//   blocking  recv(MSG_WAITALL) per request, like the device build — three
+//             syscalls per frame (magic, header, payload)
+//   epoll     non-blocking recv into a 256 KB staging buffer; small header reads
+//             are served from memory, the socket is only waited on when empty
+//   uring     io_uring multishot recv into a ring of kernel-registered provided
+//             buffers: the kernel fills buffers as data arrives and the reader
+//             only enters the kernel when no completion is queued
+// plus a non-socket one for same-host runs:
+//   shm       memfd ring shared with the sender (shm_ring.h); payloads are
+//             decoded in place and ACKs go back through the link's up ring
+//
+// io_uring needs Linux 5.19 (provided buffer rings) and 6.0 (multishot recv).
+// When setup or buffer registration fails — old kernel, seccomp, or
+// kernel.io_uring_disabled — host_transport_init() falls back to epoll, and a
+// kernel that rejects multishot recv is served with single-shot recvs instead.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mirror_transport.h"
+#include "shm_ring.h"
+
+typedef enum {
+    TRANSPORT_BLOCKING = 0,
+    TRANSPORT_EPOLL,
+    TRANSPORT_URING,
+    TRANSPORT_SHM,
+} transport_kind;
+
+typedef struct {
+    uint64_t reads;             // read requests served
+    uint64_t bytes;
+    uint64_t syscalls;          // recv / epoll_wait / io_uring_enter
+    uint64_t waits;             // times the reader blocked for data
+} transport_stats;
+
+struct uring_reader;
+
+typedef struct {
+    transport_kind kind;        // backend in use, after any fallback
+    transport_stats stats;
+
+    // epoll
+    int epfd;
+    int sock;
+    uint8_t *buf;
+    size_t buf_off;
+    size_t buf_len;
+
+    // io_uring
+    struct uring_reader *uring;
+
+    // shared memory
+    shm_link *shm;
+} host_transport;
+
+// Set by tests to make io_uring look unavailable.
+extern int transport_disable_uring;
+
+// Socket kinds only: blocking, epoll, uring.
+int transport_parse_kind(const char *s, transport_kind *out);
+const char *transport_kind_name(transport_kind kind);
+
+// Create a reader of the requested kind (falling back from uring to epoll).
+// Returns 0 on success, -1 if even the fallback could not be created.
+int host_transport_init(host_transport *t, transport_kind want);
+// Read from a shared-memory link instead of a socket (the link is not owned).
+// Marks the link accepted so the sender starts streaming.
+void host_transport_init_shm(host_transport *t, shm_link *link);
+void host_transport_free(host_transport *t);
+
+// mirror_transport_ops for a host_transport (ctx = host_transport *). The shm
+// kind adds zero-copy view() and ACK write().
+const mirror_transport_ops *host_transport_ops_for(const host_transport *t);
+// Socket kinds; used directly by tests.
+extern const mirror_transport_ops host_transport_ops;
+
+// MARK: - io_uring reader (transport_uring.c)
+
+// NULL if io_uring or provided buffer rings are unavailable.
+struct uring_reader *uring_reader_create(void);
+void uring_reader_destroy(struct uring_reader *u);
+int uring_reader_attach(struct uring_reader *u, int sock);
+int uring_reader_read(struct uring_reader *u, void *buf, int n, transport_stats *stats);
+void uring_reader_detach(struct uring_reader *u);
+// 0 once the kernel rejected multishot recv and single-shot recvs are used.
+int uring_reader_multishot(const struct uring_reader *u);
+
+#endif
@@ -0,0 +1,316 @@
+// transport_uring.c — io_uring socket reader: multishot recv into provided buffers.
+//
+// Raw syscalls, no liburing. One ring per reader:
+//   - a provided buffer ring (IORING_REGISTER_PBUF_RING) of URING_BUF_COUNT
+//     buffers that the kernel picks from as data arrives
+//   - one multishot IORING_OP_RECV with IOSQE_BUFFER_SELECT, armed at attach and
+//     re-armed whenever the kernel ends it (buffers ran out, or no multishot)
+// Each completion names a filled buffer; reads copy out of it and hand it back
+// to the kernel once consumed. The reader only calls io_uring_enter() when the
+// completion queue is empty.
+
+#include "transport.h"
+#include "mirror_common.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_ENTRIES 8
+#define URING_CQ_ENTRIES 128        // > URING_BUF_COUNT: one CQE per filled buffer
+#define URING_BUF_COUNT 64          // power of two
+#define URING_BUF_SIZE (64 * 1024)
+#define URING_BGID 0
+
+#define UD_RECV 1
+#define UD_CANCEL 2
+
+struct uring_reader {
+    int ring_fd;
+
+    void *sq_ptr;
+    size_t sq_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    uint8_t *bufs;
+    uint16_t br_tail;
+
+    int sock;
+    int armed;                      // recv request outstanding in the kernel
+    int multishot;                  // cleared if the kernel rejects IORING_RECV_MULTISHOT
+    int received;                   // any data completed on this ring yet
+    int eof;
+    unsigned to_submit;
+
+    int cur_bid;                    // buffer being consumed, -1 = none
+    uint32_t cur_off;
+    uint32_t cur_len;
+};
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned opcode, void *arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+// MARK: - Buffers
+
+static void recycle_buffer(struct uring_reader *u, int bid) {
+    struct io_uring_buf *b = &u->br->bufs[u->br_tail & (URING_BUF_COUNT - 1)];
+    b->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * URING_BUF_SIZE);
+    b->len = URING_BUF_SIZE;
+    b->bid = (uint16_t)bid;
+    u->br_tail++;
+    __atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+}
+
+// MARK: - Submission / completion
+
+static struct io_uring_sqe *next_sqe(struct uring_reader *u) {
+    unsigned tail = *u->sq_tail;
+    unsigned idx = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[idx] = idx;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    u->to_submit++;
+    return sqe;
+}
+
+static void arm_recv(struct uring_reader *u) {
+    struct io_uring_sqe *sqe = next_sqe(u);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = u->sock;
+    sqe->ioprio = u->multishot ? IORING_RECV_MULTISHOT : 0;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = UD_RECV;
+    u->armed = 1;
+}
+
+static int enter(struct uring_reader *u, unsigned min_complete, transport_stats *stats) {
+    unsigned submit = u->to_submit;
+    int r = sys_enter(u->ring_fd, submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+    if (stats) stats->syscalls++;
+    if (r < 0) return errno == EINTR ? 0 : -1;
+    u->to_submit -= (unsigned)r < submit ? (unsigned)r : submit;
+    return 0;
+}
+
+// Pop one completion if any. Returns 1 and fills res/flags/user_data, or 0.
+static int pop_cqe(struct uring_reader *u, int32_t *res, uint32_t *flags, uint64_t *user_data) {
+    unsigned head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    *res = cqe->res;
+    *flags = cqe->flags;
+    *user_data = cqe->user_data;
+    __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Apply one recv completion to the reader state.
+static void handle_recv_cqe(struct uring_reader *u, int32_t res, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) u->armed = 0;
+    int bid = (flags & IORING_CQE_F_BUFFER) ? (int)(flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+
+    if (res > 0 && bid >= 0) {
+        u->received = 1;
+        u->cur_bid = bid;
+        u->cur_off = 0;
+        u->cur_len = (uint32_t)res;
+        return;
+    }
+    if (bid >= 0) recycle_buffer(u, bid);
+    if (res == -EINVAL && u->multishot && !u->received) {
+        LOGI("[transport] multishot recv unsupported, using single-shot recv");
+        u->multishot = 0;
+    } else if (res == 0 || (res < 0 && res != -ENOBUFS && res != -EINTR && res != -EAGAIN &&
+                            res != -ECANCELED)) {
+        u->eof = 1;   // peer closed, shutdown() or socket error
+    }
+    // -ENOBUFS: every buffer is queued for us; re-armed once some are consumed.
+}
+
+// MARK: - Setup
+
+struct uring_reader *uring_reader_create(void) {
+    struct uring_reader *u = (struct uring_reader *)calloc(1, sizeof(*u));
+    if (!u) return NULL;
+    u->ring_fd = -1;
+    u->sock = -1;
+    u->cur_bid = -1;
+    u->multishot = 1;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = URING_CQ_ENTRIES;
+    u->ring_fd = sys_setup(URING_ENTRIES, &p);
+    if (u->ring_fd < 0) {
+        LOGI("[transport] io_uring_setup: %s", strerror(errno));
+        goto fail;
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) goto fail;
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->sq_size = sq_size > cq_size ? sq_size : cq_size;
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        u->sq_ptr = NULL;
+        goto fail;
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe *)mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        goto fail;
+    }
+    uint8_t *ring = (uint8_t *)u->sq_ptr;
+    u->sq_tail = (unsigned *)(ring + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(ring + p.sq_off.array);
+    u->cq_head = (unsigned *)(ring + p.cq_off.head);
+    u->cq_tail = (unsigned *)(ring + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+
+    // Provided buffer ring: page-aligned entries shared with the kernel.
+    u->br_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    u->br = (struct io_uring_buf_ring *)mmap(NULL, u->br_size, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->br == MAP_FAILED) {
+        u->br = NULL;
+        goto fail;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BGID;
+    if (sys_register(u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        LOGI("[transport] IORING_REGISTER_PBUF_RING: %s", strerror(errno));
+        goto fail;
+    }
+    u->bufs = (uint8_t *)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!u->bufs) goto fail;
+    for (int i = 0; i < URING_BUF_COUNT; i++) recycle_buffer(u, i);
+    return u;
+
+fail:
+    uring_reader_destroy(u);
+    return NULL;
+}
+
+void uring_reader_destroy(struct uring_reader *u) {
+    if (!u) return;
+    uring_reader_detach(u);
+    if (u->ring_fd >= 0) close(u->ring_fd);   // also unregisters the buffer ring
+    if (u->br) munmap(u->br, u->br_size);
+    if (u->sqes) munmap(u->sqes, u->sqes_size);
+    if (u->sq_ptr) munmap(u->sq_ptr, u->sq_size);
+    free(u->bufs);
+    free(u);
+}
+
+// MARK: - Reader
+
+int uring_reader_attach(struct uring_reader *u, int sock) {
+    u->sock = sock;
+    u->eof = 0;
+    u->received = 0;
+    arm_recv(u);
+    return enter(u, 0, NULL);
+}
+
+int uring_reader_read(struct uring_reader *u, void *buf, int n, transport_stats *stats) {
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t want = (uint32_t)n;
+    while (want > 0) {
+        if (u->cur_bid >= 0) {
+            uint32_t avail = u->cur_len - u->cur_off;
+            uint32_t take = avail < want ? avail : want;
+            memcpy(out, u->bufs + (size_t)u->cur_bid * URING_BUF_SIZE + u->cur_off, take);
+            u->cur_off += take;
+            out += take;
+            want -= take;
+            if (u->cur_off == u->cur_len) {
+                recycle_buffer(u, u->cur_bid);
+                u->cur_bid = -1;
+            }
+            continue;
+        }
+
+        int32_t res;
+        uint32_t flags;
+        uint64_t ud;
+        if (pop_cqe(u, &res, &flags, &ud)) {
+            if (ud == UD_RECV) handle_recv_cqe(u, res, flags);
+            continue;
+        }
+        if (u->eof) return -1;
+        if (!u->armed) arm_recv(u);
+        stats->waits++;
+        if (enter(u, 1, stats) < 0) return -1;
+    }
+    return n;
+}
+
+void uring_reader_detach(struct uring_reader *u) {
+    if (u->sock < 0) return;
+    // Cancel the outstanding recv and reap until the kernel has let go of it, so
+    // every buffer is back in the ring before the socket is closed or reused.
+    int cancel_pending = 0;
+    if (u->armed) {
+        struct io_uring_sqe *sqe = next_sqe(u);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD_RECV;
+        sqe->user_data = UD_CANCEL;
+        cancel_pending = 1;
+    }
+    while (u->armed || cancel_pending || u->to_submit > 0) {
+        int32_t res;
+        uint32_t flags;
+        uint64_t ud;
+        while (pop_cqe(u, &res, &flags, &ud)) {
+            if (ud == UD_CANCEL) {
+                cancel_pending = 0;
+            } else if (ud == UD_RECV) {
+                if (!(flags & IORING_CQE_F_MORE)) u->armed = 0;
+                if (flags & IORING_CQE_F_BUFFER) recycle_buffer(u, (int)(flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        }
+        if ((u->armed || cancel_pending || u->to_submit > 0) && enter(u, 1, NULL) < 0) break;
+    }
+    if (u->cur_bid >= 0) recycle_buffer(u, u->cur_bid);
+    u->cur_bid = -1;
+    u->sock = -1;
+}
+
+int uring_reader_multishot(const struct uring_reader *u) {
+    return u->multishot;
+}